@@ -1,7 +1,5 @@
 #version 330
 
-#define MAX_BONE_NUM 128
-
 // Input vertex attributes
 in vec3 vertexPosition;
 in vec2 vertexTexCoord;
@@ -15,8 +13,10 @@ in mat4 instanceTransform;
 in vec4 instanceTint;  // Per-instance tint color
 
 // Input uniform values
-uniform mat4 mvp;                         // View-projection matrix (shared across all instances)
-uniform mat4 boneMatrices[MAX_BONE_NUM];  // Shared bone matrices for all instances
+uniform mat4 mvp;                       // View-projection matrix (shared across all instances)
+uniform samplerBuffer bonePalette;      // Bone matrices of every instance this frame, 4 texels (rows) per matrix
+uniform usamplerBuffer paletteOffsets;  // First bone of each instance in bonePalette
+uniform int paletteInstanceBase;        // Where this draw's instances start in paletteOffsets
 
 // Output vertex attributes (to fragment shader)
 out vec3 fragPosition;
@@ -25,22 +25,32 @@ out vec4 fragColor;
 out vec3 fragNormal;
 out vec4 fragInstanceTint;  // Pass instance tint to fragment shader
 
+// Matrices are stored the way raylib lays them out in memory, one row per texel
+mat4 fetchBone(int boneIndex) {
+    int texel = boneIndex * 4;
+    return transpose(mat4(texelFetch(bonePalette, texel + 0),
+                          texelFetch(bonePalette, texel + 1),
+                          texelFetch(bonePalette, texel + 2),
+                          texelFetch(bonePalette, texel + 3)));
+}
+
 void main() {
-    // GPU Skinning path - apply bone transforms
-    int boneIndex0 = int(vertexBoneIds.x);
-    int boneIndex1 = int(vertexBoneIds.y);
-    int boneIndex2 = int(vertexBoneIds.z);
-    int boneIndex3 = int(vertexBoneIds.w);
-
-    vec4 skinnedPosition = vertexBoneWeights.x * (boneMatrices[boneIndex0] * vec4(vertexPosition, 1.0)) +
-                           vertexBoneWeights.y * (boneMatrices[boneIndex1] * vec4(vertexPosition, 1.0)) +
-                           vertexBoneWeights.z * (boneMatrices[boneIndex2] * vec4(vertexPosition, 1.0)) +
-                           vertexBoneWeights.w * (boneMatrices[boneIndex3] * vec4(vertexPosition, 1.0));
-
-    vec4 skinnedNormal = vertexBoneWeights.x * (boneMatrices[boneIndex0] * vec4(vertexNormal, 0.0)) +
-                         vertexBoneWeights.y * (boneMatrices[boneIndex1] * vec4(vertexNormal, 0.0)) +
-                         vertexBoneWeights.z * (boneMatrices[boneIndex2] * vec4(vertexNormal, 0.0)) +
-                         vertexBoneWeights.w * (boneMatrices[boneIndex3] * vec4(vertexNormal, 0.0));
+    // GPU Skinning path - apply this instance's bone transforms
+    int paletteBase = int(texelFetch(paletteOffsets, paletteInstanceBase + gl_InstanceID).r);
+    mat4 bone0 = fetchBone(paletteBase + int(vertexBoneIds.x));
+    mat4 bone1 = fetchBone(paletteBase + int(vertexBoneIds.y));
+    mat4 bone2 = fetchBone(paletteBase + int(vertexBoneIds.z));
+    mat4 bone3 = fetchBone(paletteBase + int(vertexBoneIds.w));
+
+    vec4 skinnedPosition = vertexBoneWeights.x * (bone0 * vec4(vertexPosition, 1.0)) +
+                           vertexBoneWeights.y * (bone1 * vec4(vertexPosition, 1.0)) +
+                           vertexBoneWeights.z * (bone2 * vec4(vertexPosition, 1.0)) +
+                           vertexBoneWeights.w * (bone3 * vec4(vertexPosition, 1.0));
+
+    vec4 skinnedNormal = vertexBoneWeights.x * (bone0 * vec4(vertexNormal, 0.0)) +
+                         vertexBoneWeights.y * (bone1 * vec4(vertexNormal, 0.0)) +
+                         vertexBoneWeights.z * (bone2 * vec4(vertexNormal, 0.0)) +
+                         vertexBoneWeights.w * (bone3 * vec4(vertexNormal, 0.0));
 
     // Apply instance transform to skinned position
     vec4 worldPosition = instanceTransform * skinnedPosition;
@@ -7,6 +7,7 @@
 #include "cvar.hpp"
 #include "debug.hpp"
 #include "info.hpp"
+#include "job.hpp"
 #include "log.hpp"
 #include "memory.hpp"
 #include "message.hpp"
@@ -30,6 +31,8 @@
 
 Assets g_assets = {};
 
+U64 static i_frame = 1;  // Starts at 1 so that a last_access_frame of 0 means never accessed
+
 C8 static const *i_assets_type_to_cstr[A_TYPE_COUNT] = {
     "Model",
     "Texture",
@@ -40,6 +43,12 @@ C8 static const *i_assets_type_to_cstr[A_TYPE_COUNT] = {
     "Terrain"
 };
 
+C8 static const *i_assets_model_socket_to_cstr[A_MODEL_SOCKET_COUNT] = {
+    "socket_hat",
+    "socket_hand_L",
+    "socket_hand_R",
+};
+
 void static i_fill_header(AHeader *header, C8 const *path, AType type) {
     if (ou_strlen(path) > A_PATH_MAX_LENGTH) {
         lle("Asset path %s (%zu) is longer than %d characters which is the maximum allowed", path, ou_strlen(path), A_PATH_MAX_LENGTH);
@@ -98,9 +107,81 @@ void static i_fill_header(AHeader *header, C8 const *path, AType type) {
     header->type          = type;
 }
 
+AHeader static *i_get_header(AType type, SZ index) {
+    switch (type) {
+        case A_TYPE_MODEL:          return &g_assets.models[index].header;
+        case A_TYPE_TEXTURE:        return &g_assets.textures[index].header;
+        case A_TYPE_SOUND:          return &g_assets.sounds[index].header;
+        case A_TYPE_SHADER:         return &g_assets.shaders[index].header;
+        case A_TYPE_COMPUTE_SHADER: return &g_assets.compute_shaders[index].header;
+        case A_TYPE_FONT:           return &g_assets.fonts[index].header;
+        case A_TYPE_SKYBOX:         return &g_assets.skyboxes[index].header;
+        case A_TYPE_TERRAIN:        return &g_assets.terrains[index].header;
+        default:                    _unreachable_();
+    }
+    return nullptr;
+}
+
+SZ static i_get_count(AType type) {
+    switch (type) {
+        case A_TYPE_MODEL:          return g_assets.model_count;
+        case A_TYPE_TEXTURE:        return g_assets.texture_count;
+        case A_TYPE_SOUND:          return g_assets.sound_count;
+        case A_TYPE_SHADER:         return g_assets.shader_count;
+        case A_TYPE_COMPUTE_SHADER: return g_assets.compute_shader_count;
+        case A_TYPE_FONT:           return g_assets.font_count;
+        case A_TYPE_SKYBOX:         return g_assets.skybox_count;
+        case A_TYPE_TERRAIN:        return g_assets.terrain_count;
+        default:                    _unreachable_();
+    }
+    return 0;
+}
+
+// Fonts are keyed by name and size, the prepared but unloaded ones use size 0
+U64 static inline i_index_key(U32 name_hash, S32 font_size) {
+    return ((U64)(U32)font_size << 32) | name_hash;
+}
+
+S32 static inline i_font_size_of(AType type, SZ index) {
+    return type == A_TYPE_FONT ? g_assets.fonts[index].font_size : 0;
+}
+
+void static inline i_touch(AHeader *header) {
+    header->last_access_frame = i_frame;
+}
+
+// Has to be called once the header is filled, the first asset with a given key wins just like the old linear scan did
+void static i_index_add(AType type, SZ index) {
+    AIndexMap *map = &g_assets.index[type];
+    if (map->capacity == 0) { AIndexMap_init(map, MEMORY_TYPE_ARENA_PERMANENT, A_PER_TYPE_MAX * 2); }  // Assets can get loaded before asset_init
+
+    U64 const key = i_index_key(i_get_header(type, index)->name_hash, i_font_size_of(type, index));
+    if (!AIndexMap_has(map, key)) { AIndexMap_insert(map, key, index); }
+}
+
+SZ static i_index_find_by_hash(AType type, U32 name_hash, S32 font_size) {
+    SZ const *index = AIndexMap_get(&g_assets.index[type], i_index_key(name_hash, font_size));
+    return index ? *index : A_INDEX_NONE;
+}
+
+SZ static i_index_find_by_name(AType type, C8 const *name, S32 font_size) {
+    SZ const index = i_index_find_by_hash(type, (U32)hash_cstr(name), font_size);
+    if (index == A_INDEX_NONE) { return A_INDEX_NONE; }
+    if (ou_strcmp(i_get_header(type, index)->name, name) == 0) { return index; }
+
+    // Hash collision with another name, rare enough for a linear scan
+    SZ const count = i_get_count(type);
+    for (SZ i = 0; i < count; ++i) {
+        if (ou_strcmp(i_get_header(type, i)->name, name) == 0 && i_font_size_of(type, i) == font_size) { return i; }
+    }
+
+    return A_INDEX_NONE;
+}
+
 void static i_load_model(C8 const *path) {
     AModel *a = &g_assets.models[g_assets.model_count++];
     i_fill_header(&a->header, path, A_TYPE_MODEL);
+    i_index_add(A_TYPE_MODEL, g_assets.model_count - 1);
 
     a->base = LoadModel(a->header.path);
     if (!IsModelValid(a->base)) {
@@ -133,6 +214,17 @@ void static i_load_model(C8 const *path) {
     // Compute has_animations flag once on load
     a->has_animations = (a->animation_count > 0 && a->base.boneCount > 0);
 
+    // Resolve sockets to bone indices once so nothing has to compare bone names per frame
+    for (S32 socket = 0; socket < A_MODEL_SOCKET_COUNT; ++socket) {
+        a->socket_bones[socket] = A_MODEL_SOCKET_NONE;
+        for (S32 bone = 0; bone < a->base.boneCount; ++bone) {
+            if (ou_strcmp(a->base.bones[bone].name, i_assets_model_socket_to_cstr[socket]) == 0) {
+                a->socket_bones[socket] = bone;
+                break;
+            }
+        }
+    }
+
     // Generate icon
     F32 radius     = Vector3Distance(a->bb.min, a->bb.max) * 0.5F; // Bounding sphere radius
     F32 distance   = radius * 1.25F;
@@ -165,6 +257,7 @@ void static i_load_model(C8 const *path) {
 void static i_load_texture(C8 const *path) {
     ATexture *a = &g_assets.textures[g_assets.texture_count++];
     i_fill_header(&a->header, path, A_TYPE_TEXTURE);
+    i_index_add(A_TYPE_TEXTURE, g_assets.texture_count - 1);
 
     a->base = LoadTexture(a->header.path);
     if (!IsTextureValid(a->base)) {
@@ -187,6 +280,7 @@ void static i_load_texture(C8 const *path) {
 void static i_load_sound(C8 const *path) {
     ASound *a = &g_assets.sounds[g_assets.sound_count++];
     i_fill_header(&a->header, path, A_TYPE_SOUND);
+    i_index_add(A_TYPE_SOUND, g_assets.sound_count - 1);
 
     FMOD::System *s = audio_get_fmod_system();
     FMOD_RESULT r = s->createSound(a->header.path, FMOD_DEFAULT, nullptr, &a->base);
@@ -236,12 +330,14 @@ void static i_load_shader_part2(AShader *a) {
 void static i_load_shader_part1(C8 const *path) {
     AShader *a = &g_assets.shaders[g_assets.shader_count++];
     i_fill_header(&a->header, path, A_TYPE_SHADER);
+    i_index_add(A_TYPE_SHADER, g_assets.shader_count - 1);
     i_load_shader_part2(a);
 }
 
 void static i_load_compute_shader(C8 const *path) {
     AComputeShader *a = &g_assets.compute_shaders[g_assets.compute_shader_count++];
     i_fill_header(&a->header, path, A_TYPE_COMPUTE_SHADER);
+    i_index_add(A_TYPE_COMPUTE_SHADER, g_assets.compute_shader_count - 1);
 
     C8 const *cpath = TS("%s/compute.glsl", a->header.path)->c;
 
@@ -330,6 +426,7 @@ AFont static *i_load_font(C8 const *path, S32 font_size) {
     i_fill_header(&a->header, path, A_TYPE_FONT);
     a->font_size     = font_size;
     a->header.loaded = true;
+    i_index_add(A_TYPE_FONT, (SZ)(a - g_assets.fonts));
 
     return a;
 }
@@ -337,6 +434,7 @@ AFont static *i_load_font(C8 const *path, S32 font_size) {
 void static i_prepare_font(C8 const *path) {
     AFont *a = &g_assets.fonts[g_assets.font_count++];
     i_fill_header(&a->header, path, A_TYPE_FONT);
+    i_index_add(A_TYPE_FONT, g_assets.font_count - 1);
 }
 
 void static i_prepare_fonts() {
@@ -425,6 +523,7 @@ TextureCubemap static i_skybox_gen_cubemap(ASkybox *a) {
 void static i_load_skybox(C8 const *path) {
     ASkybox *a = &g_assets.skyboxes[g_assets.skybox_count++];
     i_fill_header(&a->header, path, A_TYPE_SKYBOX);
+    i_index_add(A_TYPE_SKYBOX, g_assets.skybox_count - 1);
 
     a->mesh                      = GenMeshCube(1.0F, 1.0F, 1.0F);
     a->model                     = LoadModelFromMesh(a->mesh);
@@ -476,33 +575,165 @@ void static i_delete_outdated_terrain_caches(C8 const *path, S64 heightmap_modti
     UnloadDirectoryFiles(files);
 }
 
-struct ICreateTerrainThreadData {
+#define A_TERRAIN_RASTER_ROWS_PER_BAND 16
+#define A_TERRAIN_RASTER_EPSILON 1e-4F
+#define A_TERRAIN_HEIGHT_UNSET (-F32_MAX)
+
+// The height field is rasterized in bands of rows, every band only looks at the triangles that overlap it.
+struct ITerrainRasterData {
+    Mesh const *mesh;
+    Matrix transform;
+    Vector2 to_grid;  // World xz to sample coordinates
+    U32 sample_rate;
+    U32 band_count;
+    U32 *band_offsets;    // band_count + 1 entries into band_triangles
+    U32 *band_triangles;  // Triangle ids sorted by band, triangles spanning several bands are in each of them
+    F32 *height_field;
+};
+
+void static inline i_terrain_triangle(ITerrainRasterData const *data, U32 triangle, Vector3 *out) {
+    for (U32 k = 0; k < 3; ++k) {
+        U32 const vertex = data->mesh->indices ? data->mesh->indices[(triangle * 3) + k] : (triangle * 3) + k;
+        F32 const *v     = &data->mesh->vertices[vertex * 3];
+        Vector3 const p  = Vector3Transform({v[0], v[1], v[2]}, data->transform);
+        out[k]           = {p.x * data->to_grid.x, p.y, p.z * data->to_grid.y};
+    }
+}
+
+// Sample rows [first, last] the triangle covers, false if it covers none
+BOOL static inline i_terrain_triangle_rows(ITerrainRasterData const *data, Vector3 const *t, S32 *first, S32 *last) {
+    F32 const min_z = glm::min(t[0].z, glm::min(t[1].z, t[2].z));
+    F32 const max_z = glm::max(t[0].z, glm::max(t[1].z, t[2].z));
+    *first          = glm::max((S32)glm::ceil(min_z - A_TERRAIN_RASTER_EPSILON), 0);
+    *last           = glm::min((S32)glm::floor(max_z + A_TERRAIN_RASTER_EPSILON), (S32)data->sample_rate - 1);
+    return *first <= *last;
+}
+
+S32 static i_terrain_raster_bands(U32 begin, U32 end, void *ctx) {
+    auto const *data = (ITerrainRasterData *)ctx;
+    S32 const n      = (S32)data->sample_rate;
+
+    for (U32 band = begin; band < end; ++band) {
+        S32 const band_first = (S32)(band * A_TERRAIN_RASTER_ROWS_PER_BAND);
+        S32 const band_last  = glm::min(band_first + A_TERRAIN_RASTER_ROWS_PER_BAND, n) - 1;
+
+        for (U32 i = data->band_offsets[band]; i < data->band_offsets[band + 1]; ++i) {
+            Vector3 t[3] = {};
+            i_terrain_triangle(data, data->band_triangles[i], t);
+
+            // Vertical triangles have no area on the xz plane and are never hit by a downward ray either
+            F32 const area = ((t[1].x - t[0].x) * (t[2].z - t[0].z)) - ((t[2].x - t[0].x) * (t[1].z - t[0].z));
+            if (glm::abs(area) < A_TERRAIN_RASTER_EPSILON) { continue; }
+            F32 const inv_area = 1.0F / area;
+
+            S32 first_row = 0;
+            S32 last_row  = 0;
+            if (!i_terrain_triangle_rows(data, t, &first_row, &last_row)) { continue; }
+            first_row = glm::max(first_row, band_first);
+            last_row  = glm::min(last_row, band_last);
+
+            F32 const min_x = glm::min(t[0].x, glm::min(t[1].x, t[2].x));
+            F32 const max_x = glm::max(t[0].x, glm::max(t[1].x, t[2].x));
+            S32 const first_col = glm::max((S32)glm::ceil(min_x - A_TERRAIN_RASTER_EPSILON), 0);
+            S32 const last_col  = glm::min((S32)glm::floor(max_x + A_TERRAIN_RASTER_EPSILON), n - 1);
+
+            for (S32 z = first_row; z <= last_row; ++z) {
+                F32 *row = &data->height_field[(SZ)z * (SZ)n];
+                for (S32 x = first_col; x <= last_col; ++x) {
+                    // Barycentric weights of the sample
+                    F32 const px = (F32)x;
+                    F32 const pz = (F32)z;
+                    F32 const w0 = (((t[1].x - px) * (t[2].z - pz)) - ((t[2].x - px) * (t[1].z - pz))) * inv_area;
+                    F32 const w1 = (((t[2].x - px) * (t[0].z - pz)) - ((t[0].x - px) * (t[2].z - pz))) * inv_area;
+                    F32 const w2 = 1.0F - w0 - w1;
+                    if (w0 < -A_TERRAIN_RASTER_EPSILON || w1 < -A_TERRAIN_RASTER_EPSILON || w2 < -A_TERRAIN_RASTER_EPSILON) { continue; }
+
+                    // Overlapping triangles keep the highest surface, that is what a ray from above hits first
+                    F32 const height = (w0 * t[0].y) + (w1 * t[1].y) + (w2 * t[2].y);
+                    row[x]           = glm::max(row[x], height);
+                }
+            }
+        }
+
+        // Samples outside of the mesh, the raycast reported no hit for those
+        for (SZ idx = (SZ)band_first * (SZ)n; idx < (SZ)(band_last + 1) * (SZ)n; ++idx) {
+            if (data->height_field[idx] == A_TERRAIN_HEIGHT_UNSET) { data->height_field[idx] = 0.0F; }
+        }
+    }
+
+    return 0;
+}
+
+void asset_terrain_build_height_field(ATerrain const *terrain, U32 sample_rate, F32 *height_field) {
+    ITerrainRasterData data = {};
+    data.mesh               = &terrain->mesh;
+    data.transform          = terrain->transform;
+    data.to_grid            = {(F32)(sample_rate - 1) / terrain->dimensions.x, (F32)(sample_rate - 1) / terrain->dimensions.z};
+    data.sample_rate        = sample_rate;
+    data.band_count         = (sample_rate + A_TERRAIN_RASTER_ROWS_PER_BAND - 1) / A_TERRAIN_RASTER_ROWS_PER_BAND;
+    data.band_offsets       = mcta(U32 *, data.band_count + 1, sizeof(U32));
+    data.height_field       = height_field;
+
+    SZ const sample_count = (SZ)sample_rate * sample_rate;
+    for (SZ i = 0; i < sample_count; ++i) { height_field[i] = A_TERRAIN_HEIGHT_UNSET; }
+
+    // Bin the triangles by band, counting first and then filling
+    U32 const triangle_count = (U32)terrain->mesh.triangleCount;
+    for (U32 tri = 0; tri < triangle_count; ++tri) {
+        Vector3 t[3] = {};
+        S32 first    = 0;
+        S32 last     = 0;
+        i_terrain_triangle(&data, tri, t);
+        if (!i_terrain_triangle_rows(&data, t, &first, &last)) { continue; }
+        for (S32 band = first / A_TERRAIN_RASTER_ROWS_PER_BAND; band <= last / A_TERRAIN_RASTER_ROWS_PER_BAND; ++band) { data.band_offsets[band + 1]++; }
+    }
+    for (U32 band = 0; band < data.band_count; ++band) { data.band_offsets[band + 1] += data.band_offsets[band]; }
+
+    data.band_triangles = mmta(U32 *, sizeof(U32) * glm::max(data.band_offsets[data.band_count], 1U));
+    U32 *cursor         = mmta(U32 *, sizeof(U32) * data.band_count);
+    ou_memcpy(cursor, data.band_offsets, sizeof(U32) * data.band_count);
+
+    for (U32 tri = 0; tri < triangle_count; ++tri) {
+        Vector3 t[3] = {};
+        S32 first    = 0;
+        S32 last     = 0;
+        i_terrain_triangle(&data, tri, t);
+        if (!i_terrain_triangle_rows(&data, t, &first, &last)) { continue; }
+        for (S32 band = first / A_TERRAIN_RASTER_ROWS_PER_BAND; band <= last / A_TERRAIN_RASTER_ROWS_PER_BAND; ++band) { data.band_triangles[cursor[band]++] = tri; }
+    }
+
+    job_wait(job_parallel_for(0, data.band_count, 1, i_terrain_raster_bands, &data));
+}
+
+struct ITerrainRaycastData {
     ATerrain *terrain;
-    Vector3 dimensions;
-    U32 start_z;
-    U32 end_z;
+    U32 sample_rate;
+    F32 *height_field;
 };
 
-S32 static i_create_terrain_thread_func(void *arg) {
-    ICreateTerrainThreadData *data = (ICreateTerrainThreadData *)arg;
-    ATerrain *a                    = data->terrain;
-    Vector3 const dimensions       = data->dimensions;
-
-    for (U32 z = data->start_z; z < data->end_z; z++) {
-        U32 const z_idx = z * A_TERRAIN_SAMPLE_RATE;
-        for (U32 x = 0U; x < A_TERRAIN_SAMPLE_RATE; x++) {
-            U32 const idx                = z_idx + x;
-            F32 const world_x            = ((F32)x / (F32)(A_TERRAIN_SAMPLE_RATE - 1U)) * dimensions.x;
-            F32 const world_z            = ((F32)z / (F32)(A_TERRAIN_SAMPLE_RATE - 1U)) * dimensions.z;
+S32 static i_terrain_raycast_rows(U32 begin, U32 end, void *ctx) {
+    auto const *data         = (ITerrainRaycastData *)ctx;
+    Vector3 const dimensions = data->terrain->dimensions;
+
+    for (U32 z = begin; z < end; z++) {
+        U32 const z_idx = z * data->sample_rate;
+        for (U32 x = 0U; x < data->sample_rate; x++) {
+            F32 const world_x            = ((F32)x / (F32)(data->sample_rate - 1U)) * dimensions.x;
+            F32 const world_z            = ((F32)z / (F32)(data->sample_rate - 1U)) * dimensions.z;
             Vector3 const ray_start      = {world_x, dimensions.y * 2.0F, world_z};
-            RayCollision const collision = math_ray_collision_to_terrain(a, ray_start, {0.0F, -1.0F, 0.0F});
-            a->height_field[idx]         = collision.hit ? collision.point.y : 0.0F;
+            RayCollision const collision = math_ray_collision_to_terrain(data->terrain, ray_start, {0.0F, -1.0F, 0.0F});
+            data->height_field[z_idx + x] = collision.hit ? collision.point.y : 0.0F;
         }
     }
 
     return 0;
 }
 
+void asset_terrain_build_height_field_raycast(ATerrain *terrain, U32 sample_rate, F32 *height_field) {
+    ITerrainRaycastData data = {terrain, sample_rate, height_field};
+    job_wait(job_parallel_for(0, sample_rate, 1, i_terrain_raycast_rows, &data));
+}
+
 struct IGenerateTerrainInfoThreadData {
     ATerrain *terrain;
     Vector3 dimensions;
@@ -538,6 +769,7 @@ S32 static i_generate_terrain_info_thread_func(void *arg) {
 void static i_load_terrain(C8 const *path, Vector3 dimensions) {
     ATerrain *a = &g_assets.terrains[g_assets.terrain_count++];
     i_fill_header(&a->header, path, A_TYPE_TERRAIN);
+    i_index_add(A_TYPE_TERRAIN, g_assets.terrain_count - 1);
     a->dimensions = dimensions;
 
     String *height_path  = TS("%s/%s", path, "height.png");
@@ -552,6 +784,8 @@ void static i_load_terrain(C8 const *path, Vector3 dimensions) {
     ATexture *height_tex = &g_assets.textures[g_assets.texture_count++];
     i_fill_header(&height_tex->header, height_path->c, A_TYPE_TEXTURE);
     ou_strncpy((C8 *)height_tex->header.name, unique_height_name->c, A_NAME_MAX_LENGTH);
+    height_tex->header.name_hash = (U32)hash_cstr(height_tex->header.name);
+    i_index_add(A_TYPE_TEXTURE, g_assets.texture_count - 1);
     height_tex->base = LoadTexture(height_path->c);
     if (!IsTextureValid(height_tex->base)) {
         lle("Could not load height texture %s", height_path->c);
@@ -566,6 +800,8 @@ void static i_load_terrain(C8 const *path, Vector3 dimensions) {
     ATexture *diffuse_tex = &g_assets.textures[g_assets.texture_count++];
     i_fill_header(&diffuse_tex->header, diffuse_path->c, A_TYPE_TEXTURE);
     ou_strncpy((C8 *)diffuse_tex->header.name, unique_diffuse_name->c, A_NAME_MAX_LENGTH);
+    diffuse_tex->header.name_hash = (U32)hash_cstr(diffuse_tex->header.name);
+    i_index_add(A_TYPE_TEXTURE, g_assets.texture_count - 1);
     diffuse_tex->base = LoadTexture(diffuse_path->c);
     if (!IsTextureValid(diffuse_tex->base)) {
         lle("Could not load diffuse texture %s", diffuse_path->c);
@@ -621,38 +857,12 @@ void static i_load_terrain(C8 const *path, Vector3 dimensions) {
     a->model.materials[0].maps[MATERIAL_MAP_DIFFUSE].texture = a->diffuse_texture->base;
     a->transform                                             = MatrixTranslate(0.0F, 0.0F, 0.0F);
 
-    // In i_load_terrain, replace the height field generation with:
     if (need_generate) {
-        SZ const core_count = info_get_cpu_core_count();
-
-        lld("Generating terrain heights with %zu threads for %s", core_count, path);
-
-        U32 const sample_count    = A_TERRAIN_SAMPLE_RATE * A_TERRAIN_SAMPLE_RATE;
-        a->height_field           = mmpa(F32 *, sizeof(F32) * sample_count);
-        auto *threads             = mmta(thrd_t *, sizeof(thrd_t) * core_count);
-        auto *thread_data         = mmta(ICreateTerrainThreadData *, sizeof(ICreateTerrainThreadData) * core_count);
-        U32 const rows_per_thread = A_TERRAIN_SAMPLE_RATE / core_count;
-        U32 const remaining_rows  = A_TERRAIN_SAMPLE_RATE % core_count;
-        U32 current_row           = 0;
-
-        for (U32 i = 0; i < core_count; i++) {
-            thread_data[i].terrain    = a;
-            thread_data[i].dimensions = dimensions;
-            thread_data[i].start_z    = current_row;
-            thread_data[i].end_z      = current_row + rows_per_thread + (i < remaining_rows ? 1 : 0);
-            current_row               = thread_data[i].end_z;
+        lld("Generating terrain heights for %s", path);
 
-            if (thrd_create(&threads[i], i_create_terrain_thread_func, &thread_data[i]) != thrd_success) {
-                lle("Failed to create thread %u", i);
-                return;
-            }
-        }
-
-        for (U32 i = 0; i < core_count; i++) {
-            S32 res = S32_MAX;
-            thrd_join(threads[i], &res);
-            lld("Thread %u/%zu completed", i + 1, core_count);
-        }
+        U32 const sample_count = A_TERRAIN_SAMPLE_RATE * A_TERRAIN_SAMPLE_RATE;
+        a->height_field        = mmpa(F32 *, sizeof(F32) * sample_count);
+        asset_terrain_build_height_field(a, A_TERRAIN_SAMPLE_RATE, a->height_field);
 
         SaveFileData(cache_path->c, a->height_field, (S32)(sizeof(F32) * sample_count));
         lld("Saved terrain heights to cache: %s", cache_path->c);
@@ -763,7 +973,7 @@ void static i_load_terrain(C8 const *path, Vector3 dimensions) {
 
 void static i_shader_check_if_reload_needed(AShader *asset) {
     // We only check for reload if the asset has been loaded and is not marked for reload already.
-    if (asset->header.last_access == 0 || asset->header.want_reload) { return; }
+    if (asset->header.last_access_frame == 0 || asset->header.want_reload) { return; }
 
     C8 vpath[A_PATH_MAX_LENGTH];
     C8 fpath[A_PATH_MAX_LENGTH];
@@ -942,6 +1152,8 @@ void asset_quit() {
 }
 
 void asset_update() {
+    i_frame++;
+
     if (g_assets.run_update_thread) {
         F32 static last_update = 0.0F;
         F32 const current_time = time_get_glfw();
@@ -952,13 +1164,16 @@ void asset_update() {
     }
 }
 
+U64 asset_get_frame() {
+    return i_frame;
+}
+
 AModel *asset_get_model(C8 const *name) {
-    for (SZ i = 0; i < g_assets.model_count; ++i) {
-        AModel *asset = &g_assets.models[i];
-        if (ou_strcmp(asset->header.name, name) == 0) {
-            asset->header.last_access = time(nullptr);
-            return asset;
-        }
+    SZ const index = i_index_find_by_name(A_TYPE_MODEL, name, 0);
+    if (index != A_INDEX_NONE) {
+        AModel *asset = &g_assets.models[index];
+        i_touch(&asset->header);
+        return asset;
     }
 
     F32 const start_time = time_get_glfw();
@@ -972,24 +1187,22 @@ AModel *asset_get_model(C8 const *name) {
 }
 
 AModel *asset_get_model_by_hash(U32 name_hash) {
-    for (SZ i = 0; i < g_assets.model_count; ++i) {
-        AModel *asset = &g_assets.models[i];
-        if (asset->header.name_hash == name_hash) {
-            asset->header.last_access = time(nullptr);
-            return asset;
-        }
+    SZ const index = i_index_find_by_hash(A_TYPE_MODEL, name_hash, 0);
+    if (index != A_INDEX_NONE) {
+        AModel *asset = &g_assets.models[index];
+        i_touch(&asset->header);
+        return asset;
     }
     lle("Model with hash 0x%08X not found (asset not loaded or invalid hash). Hash lookups do not support auto-loading.", name_hash);
     return nullptr;
 }
 
 ATexture *asset_get_texture(C8 const *name) {
-    for (SZ i = 0; i < g_assets.texture_count; ++i) {
-        ATexture *asset = &g_assets.textures[i];
-        if (ou_strcmp(asset->header.name, name) == 0) {
-            asset->header.last_access = time(nullptr);
-            return asset;
-        }
+    SZ const index = i_index_find_by_name(A_TYPE_TEXTURE, name, 0);
+    if (index != A_INDEX_NONE) {
+        ATexture *asset = &g_assets.textures[index];
+        i_touch(&asset->header);
+        return asset;
     }
 
     F32 const start_time = time_get_glfw();
@@ -1003,24 +1216,22 @@ ATexture *asset_get_texture(C8 const *name) {
 }
 
 ATexture *asset_get_texture_by_hash(U32 name_hash) {
-    for (SZ i = 0; i < g_assets.texture_count; ++i) {
-        ATexture *asset = &g_assets.textures[i];
-        if (asset->header.name_hash == name_hash) {
-            asset->header.last_access = time(nullptr);
-            return asset;
-        }
+    SZ const index = i_index_find_by_hash(A_TYPE_TEXTURE, name_hash, 0);
+    if (index != A_INDEX_NONE) {
+        ATexture *asset = &g_assets.textures[index];
+        i_touch(&asset->header);
+        return asset;
     }
     lle("Texture with hash 0x%08X not found (asset not loaded or invalid hash). Hash lookups do not support auto-loading.", name_hash);
     return nullptr;
 }
 
 ASound *asset_get_sound(C8 const *name) {
-    for (SZ i = 0; i < g_assets.sound_count; ++i) {
-        ASound *asset = &g_assets.sounds[i];
-        if (ou_strcmp(asset->header.name, name) == 0) {
-            asset->header.last_access = time(nullptr);
-            return asset;
-        }
+    SZ const index = i_index_find_by_name(A_TYPE_SOUND, name, 0);
+    if (index != A_INDEX_NONE) {
+        ASound *asset = &g_assets.sounds[index];
+        i_touch(&asset->header);
+        return asset;
     }
 
     F32 const start_time = time_get_glfw();
@@ -1034,24 +1245,22 @@ ASound *asset_get_sound(C8 const *name) {
 }
 
 ASound *asset_get_sound_by_hash(U32 name_hash) {
-    for (SZ i = 0; i < g_assets.sound_count; ++i) {
-        ASound *asset = &g_assets.sounds[i];
-        if (asset->header.name_hash == name_hash) {
-            asset->header.last_access = time(nullptr);
-            return asset;
-        }
+    SZ const index = i_index_find_by_hash(A_TYPE_SOUND, name_hash, 0);
+    if (index != A_INDEX_NONE) {
+        ASound *asset = &g_assets.sounds[index];
+        i_touch(&asset->header);
+        return asset;
     }
     lle("Sound with hash 0x%08X not found (asset not loaded or invalid hash). Hash lookups do not support auto-loading.", name_hash);
     return nullptr;
 }
 
 AShader *asset_get_shader(C8 const *name) {
-    for (SZ i = 0; i < g_assets.shader_count; ++i) {
-        AShader *asset = &g_assets.shaders[i];
-        if (ou_strcmp(asset->header.name, name) == 0) {
-            asset->header.last_access = time(nullptr);
-            return asset;
-        }
+    SZ const index = i_index_find_by_name(A_TYPE_SHADER, name, 0);
+    if (index != A_INDEX_NONE) {
+        AShader *asset = &g_assets.shaders[index];
+        i_touch(&asset->header);
+        return asset;
     }
 
     F32 const start_time = time_get_glfw();
@@ -1065,24 +1274,22 @@ AShader *asset_get_shader(C8 const *name) {
 }
 
 AShader *asset_get_shader_by_hash(U32 name_hash) {
-    for (SZ i = 0; i < g_assets.shader_count; ++i) {
-        AShader *asset = &g_assets.shaders[i];
-        if (asset->header.name_hash == name_hash) {
-            asset->header.last_access = time(nullptr);
-            return asset;
-        }
+    SZ const index = i_index_find_by_hash(A_TYPE_SHADER, name_hash, 0);
+    if (index != A_INDEX_NONE) {
+        AShader *asset = &g_assets.shaders[index];
+        i_touch(&asset->header);
+        return asset;
     }
     lle("Shader with hash 0x%08X not found (asset not loaded or invalid hash). Hash lookups do not support auto-loading.", name_hash);
     return nullptr;
 }
 
 AComputeShader *asset_get_compute_shader(C8 const *name) {
-    for (SZ i = 0; i < g_assets.compute_shader_count; ++i) {
-        AComputeShader *asset = &g_assets.compute_shaders[i];
-        if (ou_strcmp(asset->header.name, name) == 0) {
-            asset->header.last_access = time(nullptr);
-            return asset;
-        }
+    SZ const index = i_index_find_by_name(A_TYPE_COMPUTE_SHADER, name, 0);
+    if (index != A_INDEX_NONE) {
+        AComputeShader *asset = &g_assets.compute_shaders[index];
+        i_touch(&asset->header);
+        return asset;
     }
 
     F32 const start_time = time_get_glfw();
@@ -1096,12 +1303,11 @@ AComputeShader *asset_get_compute_shader(C8 const *name) {
 }
 
 AComputeShader *asset_get_compute_shader_by_hash(U32 name_hash) {
-    for (SZ i = 0; i < g_assets.compute_shader_count; ++i) {
-        AComputeShader *asset = &g_assets.compute_shaders[i];
-        if (asset->header.name_hash == name_hash) {
-            asset->header.last_access = time(nullptr);
-            return asset;
-        }
+    SZ const index = i_index_find_by_hash(A_TYPE_COMPUTE_SHADER, name_hash, 0);
+    if (index != A_INDEX_NONE) {
+        AComputeShader *asset = &g_assets.compute_shaders[index];
+        i_touch(&asset->header);
+        return asset;
     }
     lle("Compute shader with hash 0x%08X not found (asset not loaded or invalid hash). Hash lookups do not support auto-loading.", name_hash);
     return nullptr;
@@ -1118,25 +1324,22 @@ AFont *asset_get_font(C8 const *name, S32 font_size) {
         g_assets.fonts_prepared = true;
     }
 
-    AFont *asset = nullptr;
-
-    for (SZ i = 0; i < g_assets.font_count; ++i) {
-        if (ou_strcmp(g_assets.fonts[i].header.name, name) == 0) {
-            asset = &g_assets.fonts[i];
-            if (asset->font_size == font_size) {
-                asset->header.last_access = time(nullptr);
-                return asset;
-            }
-        }
+    SZ const index = i_index_find_by_name(A_TYPE_FONT, name, font_size);
+    if (index != A_INDEX_NONE) {
+        AFont *asset = &g_assets.fonts[index];
+        i_touch(&asset->header);
+        return asset;
     }
 
-    if (asset == nullptr) {
+    // Not loaded in this size yet, the prepared entry tells us where the file is
+    SZ const prepared_index = i_index_find_by_name(A_TYPE_FONT, name, 0);
+    if (prepared_index == A_INDEX_NONE) {
         llw("Could not find font %s (font size: %d), returning default font %s (font size: %d)", name, font_size, A_DEFAULT_FONT, A_DEFAULT_FONT_SIZE);
         return asset_get_font(A_DEFAULT_FONT, A_DEFAULT_FONT_SIZE);
     }
 
     F32 const start_time = time_get_glfw();
-    i_load_font(asset->header.path, font_size);
+    i_load_font(g_assets.fonts[prepared_index].header.path, font_size);
     F32 const end_time = time_get_glfw();
     if (end_time - start_time > A_MAX_LOAD_TIME_BEFORE_WARNING) {
         llw("Loading font %s took %.2f seconds and is above the threshold of %.2f seconds.", name, end_time - start_time, A_MAX_LOAD_TIME_BEFORE_WARNING);
@@ -1156,24 +1359,22 @@ AFont *asset_get_font_by_hash(U32 name_hash, S32 font_size) {
         g_assets.fonts_prepared = true;
     }
 
-    for (SZ i = 0; i < g_assets.font_count; ++i) {
-        AFont *asset = &g_assets.fonts[i];
-        if (asset->header.name_hash == name_hash && asset->font_size == font_size) {
-            asset->header.last_access = time(nullptr);
-            return asset;
-        }
+    SZ const index = i_index_find_by_hash(A_TYPE_FONT, name_hash, font_size);
+    if (index != A_INDEX_NONE) {
+        AFont *asset = &g_assets.fonts[index];
+        i_touch(&asset->header);
+        return asset;
     }
     lle("Font with hash 0x%08X and size %d not found (asset not loaded or invalid hash). Hash lookups do not support auto-loading.", name_hash, font_size);
     return nullptr;
 }
 
 ASkybox *asset_get_skybox(C8 const *name) {
-    for (SZ i = 0; i < g_assets.skybox_count; ++i) {
-        ASkybox *asset = &g_assets.skyboxes[i];
-        if (ou_strcmp(asset->header.name, name) == 0) {
-            asset->header.last_access = time(nullptr);
-            return asset;
-        }
+    SZ const index = i_index_find_by_name(A_TYPE_SKYBOX, name, 0);
+    if (index != A_INDEX_NONE) {
+        ASkybox *asset = &g_assets.skyboxes[index];
+        i_touch(&asset->header);
+        return asset;
     }
 
     F32 const start_time = time_get_glfw();
@@ -1187,26 +1388,36 @@ ASkybox *asset_get_skybox(C8 const *name) {
 }
 
 ASkybox *asset_get_skybox_by_hash(U32 name_hash) {
-    for (SZ i = 0; i < g_assets.skybox_count; ++i) {
-        ASkybox *asset = &g_assets.skyboxes[i];
-        if (asset->header.name_hash == name_hash) {
-            asset->header.last_access = time(nullptr);
-            return asset;
-        }
+    SZ const index = i_index_find_by_hash(A_TYPE_SKYBOX, name_hash, 0);
+    if (index != A_INDEX_NONE) {
+        ASkybox *asset = &g_assets.skyboxes[index];
+        i_touch(&asset->header);
+        return asset;
     }
     lle("Skybox with hash 0x%08X not found (asset not loaded or invalid hash). Hash lookups do not support auto-loading.", name_hash);
     return nullptr;
 }
 
-ATerrain *asset_get_terrain(C8 const *name, Vector3 dimensions) {
+// The index only knows one terrain per name, the same terrain in other dimensions falls back to a scan over the few terrains we have.
+ATerrain static *i_find_terrain(SZ index, U32 name_hash, C8 const *name, Vector3 dimensions) {
+    if (index != A_INDEX_NONE && Vector3Equals(g_assets.terrains[index].dimensions, dimensions)) { return &g_assets.terrains[index]; }
+
     for (SZ i = 0; i < g_assets.terrain_count; ++i) {
         ATerrain *asset            = &g_assets.terrains[i];
-        BOOL const same_name       = ou_strcmp(asset->header.name, name) == 0;
+        BOOL const same_name       = name ? ou_strcmp(asset->header.name, name) == 0 : asset->header.name_hash == name_hash;
         BOOL const same_dimensions = Vector3Equals(asset->dimensions, dimensions);
-        if (same_name && same_dimensions) {
-            asset->header.last_access = time(nullptr);
-            return asset;
-        }
+        if (same_name && same_dimensions) { return asset; }
+    }
+
+    return nullptr;
+}
+
+ATerrain *asset_get_terrain(C8 const *name, Vector3 dimensions) {
+    SZ const index  = i_index_find_by_name(A_TYPE_TERRAIN, name, 0);
+    ATerrain *asset = index != A_INDEX_NONE ? i_find_terrain(index, 0, name, dimensions) : nullptr;
+    if (asset) {
+        i_touch(&asset->header);
+        return asset;
     }
 
     F32 const start_time = time_get_glfw();
@@ -1220,14 +1431,11 @@ ATerrain *asset_get_terrain(C8 const *name, Vector3 dimensions) {
 }
 
 ATerrain *asset_get_terrain_by_hash(U32 name_hash, Vector3 dimensions) {
-    for (SZ i = 0; i < g_assets.terrain_count; ++i) {
-        ATerrain *asset            = &g_assets.terrains[i];
-        BOOL const same_hash       = asset->header.name_hash == name_hash;
-        BOOL const same_dimensions = Vector3Equals(asset->dimensions, dimensions);
-        if (same_hash && same_dimensions) {
-            asset->header.last_access = time(nullptr);
-            return asset;
-        }
+    SZ const index  = i_index_find_by_hash(A_TYPE_TERRAIN, name_hash, 0);
+    ATerrain *asset = index != A_INDEX_NONE ? i_find_terrain(index, name_hash, nullptr, dimensions) : nullptr;
+    if (asset) {
+        i_touch(&asset->header);
+        return asset;
     }
     lle("Terrain with hash 0x%08X and dimensions (%.2f, %.2f, %.2f) not found (asset not loaded or invalid hash). Hash lookups do not support auto-loading.",
         name_hash, dimensions.x, dimensions.y, dimensions.z);
@@ -1257,13 +1465,12 @@ void static i_dump(void *asset) {
     unit_to_pretty_prefix_binary_u("B", header->file_size, pretty_size, PRETTY_BUFFER_SIZE, UNIT_PREFIX_BINARY_MEBI);
 
     time_t const current_unix_time         = time(nullptr);
-    F64 const ns_since_access              = header->last_access > 0 ? BASE_TO_NANO(difftime(current_unix_time, header->last_access)) : 0.0;
     F64 const ns_since_modified            = header->last_modified > 0 ? BASE_TO_NANO(difftime(current_unix_time, header->last_modified)) : 0.0;
     C8 pretty_access[PRETTY_BUFFER_SIZE]   = {};
     C8 pretty_modified[PRETTY_BUFFER_SIZE] = {};
 
-    if (header->last_access > 0) {
-        unit_to_pretty_time_f(ns_since_access, pretty_access, PRETTY_BUFFER_SIZE, UNIT_TIME_DAYS);
+    if (header->last_access_frame > 0) {
+        ou_snprintf(pretty_access, PRETTY_BUFFER_SIZE, "%" PRIu64 " frames", i_frame - header->last_access_frame);
     } else {
         ou_snprintf(pretty_access, PRETTY_BUFFER_SIZE, "never");
     }
@@ -1354,6 +1561,10 @@ C8 const *asset_type_to_cstr(AType type) {
     return i_assets_type_to_cstr[type];
 }
 
+C8 const *asset_model_socket_to_cstr(AModelSocket socket) {
+    return i_assets_model_socket_to_cstr[socket];
+}
+
 F32 asset_get_animation_duration(C8 const *model_name, U32 anim_index, F32 fps, F32 anim_speed) {
     AModel *model = asset_get_model(model_name);
     if (!model)                                    { return 0.0F; }
@@ -2,6 +2,7 @@
 
 #include "common.hpp"
 #include "array.hpp"
+#include "map.hpp"
 #include "string.hpp"
 
 #include <raylib.h>
@@ -16,6 +17,7 @@
 fwd_decl_ns(FMOD, Sound);
 
 #define A_PER_TYPE_MAX 512
+#define A_INDEX_NONE SZ_MAX
 #define A_RELOAD_THREAD_SLEEP_DURATION_MS 64
 #define A_TERRAIN_DEFAULT_SCALE 1.0F
 #define A_TERRAIN_DEFAULT_SIZE 1024
@@ -58,13 +60,23 @@ enum AType : U8 {
     A_TYPE_COUNT,
 };
 
+// Bones things get attached to, looked up by name once when the model loads
+enum AModelSocket : U8 {
+    A_MODEL_SOCKET_HAT,
+    A_MODEL_SOCKET_HAND_L,
+    A_MODEL_SOCKET_HAND_R,
+    A_MODEL_SOCKET_COUNT,
+};
+
+#define A_MODEL_SOCKET_NONE -1
+
 struct AHeader {
     BOOL loaded;
     AType type;
     C8 path[A_PATH_MAX_LENGTH];
     C8 name[A_NAME_MAX_LENGTH];
     U32 name_hash;
-    time_t last_access;
+    U64 last_access_frame;  // asset_get_frame() at the last lookup, 0 if never looked up
     time_t last_modified;
     BOOL want_reload;
     SZ file_size;
@@ -76,6 +88,7 @@ struct AModel {
     ModelAnimation *animations;
     S32 animation_count;
     BOOL has_animations;
+    S32 socket_bones[A_MODEL_SOCKET_COUNT];  // Bone index per socket, A_MODEL_SOCKET_NONE if the model does not have it
     BoundingBox bb;
     SZ vertex_count;
     Texture2D icon;
@@ -154,6 +167,9 @@ struct ABlob {
 ARRAY_DECLARE(ABlobArray, ABlob);
 ARRAY_DECLARE(ATextureArray, ATexture*);
 
+// Name hash (fonts also mix in the size) -> index into the per type array
+MAP_DECLARE(AIndexMap, U64, SZ, MAP_HASH_U64, MAP_EQUAL_U64);
+
 struct Assets {
     BOOL initialized;
     BOOL run_update_thread;
@@ -171,6 +187,8 @@ struct Assets {
     ASkybox skyboxes               [A_PER_TYPE_MAX]; SZ skybox_count;
     ATerrain terrains              [A_PER_TYPE_MAX]; SZ terrain_count;
 
+    AIndexMap index[A_TYPE_COUNT];
+
     ABlobArray blobs;
 };
 
@@ -180,6 +198,7 @@ void asset_init();
 void asset_start_reload_thread();
 void asset_quit();
 void asset_update();
+U64 asset_get_frame();
 AModel *asset_get_model(C8 const *name);
 AModel *asset_get_model_by_hash(U32 name_hash);
 ATexture *asset_get_texture(C8 const *name);
@@ -196,12 +215,17 @@ ASkybox *asset_get_skybox(C8 const *name);
 ASkybox *asset_get_skybox_by_hash(U32 name_hash);
 ATerrain *asset_get_terrain(C8 const *name, Vector3 dimensions);
 ATerrain *asset_get_terrain_by_hash(U32 name_hash, Vector3 dimensions);
+// Fill sample_rate * sample_rate heights spread over the terrain dimensions, row major by z, 0 where the mesh is missing.
+// The raycast version is the reference, it is way slower and only used for validation.
+void asset_terrain_build_height_field(ATerrain const *terrain, U32 sample_rate, F32 *height_field);
+void asset_terrain_build_height_field_raycast(ATerrain *terrain, U32 sample_rate, F32 *height_field);
 void asset_set_model_shader(AModel *model, Shader shader);
 void asset_set_model_shader_rl(Model *model, Shader shader);
 void asset_set_skybox_shader(ASkybox *skybox, Shader shader);
 void asset_set_terrain_shader(ATerrain *terrain, Shader shader);
 void asset_print_state();
 C8 const *asset_type_to_cstr(AType type);
+C8 const *asset_model_socket_to_cstr(AModelSocket socket);
 
 void asset_blob_init();
 void asset_blob_write();
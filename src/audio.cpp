@@ -1,9 +1,12 @@
 #include "audio.hpp"
 #include "assert.hpp"
 #include "asset.hpp"
+#include "audio_voice.hpp"
 #include "color.hpp"
+#include "command.hpp"
 #include "cvar.hpp"
 #include "log.hpp"
+#include "map.hpp"
 #include "math.hpp"
 #include "render.hpp"
 #include "scene.hpp"
@@ -28,7 +31,7 @@ struct AudioState {
     BOOL needs_update[ACG_COUNT];
 } static i_state = {};
 
-AudioCommandQueue static g_audio_command_queue = {};
+AudioSoundInternSlot static i_sound_intern[AUDIO_SOUND_INTERN_MAX] = {};
 
 // Helper macros for FMOD error checking
 #define FC(call, msg)                              \
@@ -75,12 +78,13 @@ U32 static i_parse_message(String *s) {
     return line_number;
 }
 
+// The path is transient and log records outlive it, so it goes into the message instead of the file field
 void static *i_fmod_malloc(U32 size, FMOD_MEMORY_TYPE type, C8 const *src) {
     unused(type);
     String *path          = TS("%s", src);
     U32 const line_number = i_parse_message(path);
     void *ptr             = malloc(size);  // NOLINT
-    llog_format(LLOG_LEVEL_TRACE, path->c, "unknown", line_number, "Allocating memory of size %d at %p", size, ptr);
+    llog_format(LLOG_LEVEL_TRACE, "fmod", "unknown", line_number, "%s: Allocating memory of size %d at %p", path->c, size, ptr);
     return ptr;
 }
 
@@ -89,7 +93,7 @@ void static *i_fmod_realloc(void *ptr, U32 size, FMOD_MEMORY_TYPE type, C8 const
     String *path          = TS("%s", src);
     U32 const line_number = i_parse_message(path);
     void *new_ptr         = realloc(ptr, size);  // NOLINT
-    llog_format(LLOG_LEVEL_TRACE, path->c, "unknown", line_number, "Reallocating memory of size %d at %p", size, new_ptr);
+    llog_format(LLOG_LEVEL_TRACE, "fmod", "unknown", line_number, "%s: Reallocating memory of size %d at %p", path->c, size, new_ptr);
     return new_ptr;
 }
 
@@ -97,7 +101,7 @@ void static i_fmod_free(void *ptr, FMOD_MEMORY_TYPE type, C8 const *src) {
     unused(type);
     String *path          = TS("%s", src);
     U32 const line_number = i_parse_message(path);
-    llog_format(LLOG_LEVEL_TRACE, path->c, "unknown", line_number, "Freeing memory at %p", ptr);
+    llog_format(LLOG_LEVEL_TRACE, "fmod", "unknown", line_number, "%s: Freeing memory at %p", path->c, ptr);
     free(ptr);  // NOLINT
 }
 
@@ -122,50 +126,111 @@ F32 static *i_acg_pan_ptr[ACG_COUNT] = {
     &c_audio__pan_voice,
 };
 
-AudioHandle static i_generate_handle() {
-    return ++g_audio.next_handle;
-}
+// ====== VOICE BACKEND ======
 
-ActiveSound static *i_find_free_slot() {
-    for (auto &active_sound : g_audio.active_sounds) {
-        if (!active_sound.in_use) { return &active_sound; }
+FMOD_MODE static i_rolloff_mode() {
+    switch (g_audio.rolloff_type) {
+        case AUDIO_3D_ROLLOFF_INVERSE:          return FMOD_3D_INVERSEROLLOFF;
+        case AUDIO_3D_ROLLOFF_LINEAR:           return FMOD_3D_LINEARROLLOFF;
+        case AUDIO_3D_ROLLOFF_LINEAR_SQUARE:    return FMOD_3D_LINEARSQUAREROLLOFF;
+        case AUDIO_3D_ROLLOFF_INVERSE_TAPERED:  return FMOD_3D_INVERSETAPEREDROLLOFF;
+        case AUDIO_3D_ROLLOFF_CUSTOM:           return FMOD_3D_CUSTOMROLLOFF;
+        default:                                return FMOD_3D_INVERSEROLLOFF;
     }
-    return nullptr;
 }
 
-ActiveSound static *i_find_sound_by_handle(AudioHandle handle) {
-    if (handle == AUDIO_INVALID_HANDLE) { return nullptr; }
+void static *i_fmod_voice_start(void *user, AudioVoice const *voice) {
+    unused(user);
+    C8 const *name = audio_get_interned_sound(voice->sound_id);
+    if (!name) { return nullptr; }
+
+    FMOD::Channel *channel = nullptr;
+    // Start paused to set up attributes
+    FMOD_RESULT const result = g_audio.fmod_system->playSound(asset_get_sound(name)->base, g_audio.groups[voice->group], true, &channel);
+    if (result != FMOD_OK || !channel) {
+        llw("Could not play sound %s: %s", name, FMOD_ErrorString(result));
+        return nullptr;
+    }
+
+    // Set up the sound mode
+    FMOD_MODE mode = voice->is_3d ? FMOD_3D : FMOD_2D;
+    if (voice->is_looping) { mode |= FMOD_LOOP_NORMAL; }
+
+    // For 3D sounds, set position, distance settings and rolloff
+    if (voice->is_3d) {
+        FMOD_VECTOR const pos = {voice->position.x, voice->position.y, -voice->position.z};  // Convert coordinate system
+        FMOD_VECTOR const vel = {0, 0, 0};
+        FCR(channel->set3DAttributes(&pos, &vel), "Could not set 3D attributes", nullptr);
+        FCR(channel->set3DMinMaxDistance(c_audio__min_distance, c_audio__max_distance), "Could not set 3D min/max distance", nullptr);
+        mode |= i_rolloff_mode();
+    }
+    FCR(channel->setMode(mode), "Could not set sound mode", nullptr);
+
+    // A voice coming back from being virtual continues where it would be by now
+    if (voice->elapsed > 0.0F && voice->length > 0.0F) {
+        F32 const offset = voice->is_looping ? math_mod_f32(voice->elapsed, voice->length) : voice->elapsed;
+        FCR(channel->setPosition((U32)(offset * 1000.0F), FMOD_TIMEUNIT_MS), "Could not set sound position", nullptr);
+    }
+
+    // Resume playback
+    FCR(channel->setPaused(false), "Could not unpause sound", nullptr);
 
-    for (auto &active_sound : g_audio.active_sounds) {
-        if (active_sound.in_use && active_sound.handle == handle) { return &active_sound; }
+    if (voice->is_3d) {
+        llt("Playing 3D sound '%s' at position (%.2f, %.2f, %.2f) (handle %u)", name, voice->position.x, voice->position.y, voice->position.z, voice->handle);
+    } else {
+        llt("Playing 2D sound '%s' (handle %u)", name, voice->handle);
     }
-    return nullptr;
+
+    return channel;
 }
 
-void static i_cleanup_finished_sounds() {
-    for (auto &active_sound : g_audio.active_sounds) {
-        ActiveSound *sound = &active_sound;
-        if (!sound->in_use) { continue; }
+void static i_fmod_voice_stop(void *user, void *channel) {
+    unused(user);
+    ((FMOD::Channel *)channel)->stop();  // Fails harmlessly if the channel group got stopped already
+}
 
-        BOOL is_playing = false;
-        if (sound->channel) {
-            FMOD_RESULT const result = sound->channel->isPlaying(&is_playing);
-            if (result != FMOD_OK || !is_playing) {
-                // Sound finished, clean up
-                sound->in_use  = false;
-                sound->channel = nullptr;
+BOOL static i_fmod_voice_is_playing(void *user, void *channel) {
+    unused(user);
+    BOOL is_playing = false;
+    return ((FMOD::Channel *)channel)->isPlaying(&is_playing) == FMOD_OK && is_playing;
+}
 
-                // Clear background music/ambience tracking if this was it
-                if (sound->handle == g_audio.current_music_handle) {
-                    g_audio.current_music_handle = AUDIO_INVALID_HANDLE;
-                    ou_memset(g_audio.current_music_name, 0, AUDIO_NAME_MAX_LENGTH);
-                }
-                if (sound->handle == g_audio.current_ambience_handle) {
-                    g_audio.current_ambience_handle = AUDIO_INVALID_HANDLE;
-                    ou_memset(g_audio.current_ambience_name, 0, AUDIO_NAME_MAX_LENGTH);
-                }
-            }
-        }
+void static i_fmod_voice_set_position(void *user, void *channel, Vector3 position) {
+    unused(user);
+    audio_3d_set_position((FMOD::Channel *)channel, position);
+}
+
+F32 static i_fmod_voice_get_length(void *user, U32 sound_id) {
+    unused(user);
+    C8 const *name = audio_get_interned_sound(sound_id);
+    if (!name) { return 0.0F; }
+
+    U32 length_ms = 0;
+    FCR(asset_get_sound(name)->base->getLength(&length_ms, FMOD_TIMEUNIT_MS), "Could not get sound length", 0.0F);
+    return (F32)length_ms / 1000.0F;
+}
+
+void static i_update_voices(F32 dt) {
+    AudioVoiceManager *mgr = g_audio.voices;
+
+    // Cvars can change at any time and the audibility has to follow what FMOD does
+    mgr->real_max            = (U32)glm::clamp(c_audio__voice_real_max, 1, AUDIO_CHANNEL_GROUP_MAX);
+    mgr->sound_limit_default = (U16)glm::clamp(c_audio__voice_sound_limit, 1, AUDIO_VOICE_MAX);
+    mgr->rolloff             = g_audio.rolloff_type;
+    mgr->min_distance        = c_audio__min_distance;
+    mgr->max_distance        = c_audio__max_distance;
+    mgr->rolloff_scale       = c_audio__rolloff_scale;
+
+    audio_voice_update(mgr, dt, g_audio.last_listener_position);
+
+    // Clear background music/ambience tracking once it ended
+    if (g_audio.current_music_handle != AUDIO_INVALID_HANDLE && !audio_voice_get(mgr, g_audio.current_music_handle)) {
+        g_audio.current_music_handle = AUDIO_INVALID_HANDLE;
+        ou_memset(g_audio.current_music_name, 0, AUDIO_NAME_MAX_LENGTH);
+    }
+    if (g_audio.current_ambience_handle != AUDIO_INVALID_HANDLE && !audio_voice_get(mgr, g_audio.current_ambience_handle)) {
+        g_audio.current_ambience_handle = AUDIO_INVALID_HANDLE;
+        ou_memset(g_audio.current_ambience_name, 0, AUDIO_NAME_MAX_LENGTH);
     }
 }
 
@@ -197,87 +262,25 @@ void static i_update_group_properties(AudioChannelGroup channel_group) {
 }
 
 AudioHandle static i_play_sound_internal(AudioChannelGroup channel_group, C8 const *name, BOOL is_3d, BOOL loop, Vector3 position = {0, 0, 0}) {
-    ActiveSound *slot = i_find_free_slot();
-    if (!slot) {
-        llt("No free audio slots available");
-        return AUDIO_INVALID_HANDLE;
-    }
-
-    FMOD::Channel *channel = nullptr;
-    // Start paused to set up attributes
-    FMOD_RESULT const result = g_audio.fmod_system->playSound(asset_get_sound(name)->base, g_audio.groups[channel_group], true, &channel);
-    if (result != FMOD_OK || !channel) {
-        llw("Could not play sound %s: %s", name, FMOD_ErrorString(result));
-        return AUDIO_INVALID_HANDLE;
-    }
-
-    // Set up the sound mode
-    FMOD_MODE mode = is_3d ? FMOD_3D : FMOD_2D;
-    if (loop) { mode |= FMOD_LOOP_NORMAL; }
+    U32 const sound_id = audio_intern_sound(name);
+    if (sound_id == AUDIO_SOUND_ID_NONE) { return AUDIO_INVALID_HANDLE; }
 
-    FCR(channel->setMode(mode), "Could not set sound mode", AUDIO_INVALID_HANDLE);
-
-    // For 3D sounds, set position and distance settings
-    if (is_3d) {
-        FMOD_VECTOR const pos = {position.x, position.y, -position.z};  // Convert coordinate system
-        FMOD_VECTOR const vel = {0, 0, 0};
-        FCR(channel->set3DAttributes(&pos, &vel), "Could not set 3D attributes", AUDIO_INVALID_HANDLE);
-        FCR(channel->set3DMinMaxDistance(c_audio__min_distance, c_audio__max_distance), "Could not set 3D min/max distance", AUDIO_INVALID_HANDLE);
-
-        // Set rolloff mode
-        FMOD_MODE rolloff_mode = FMOD_DEFAULT;
-        switch (g_audio.rolloff_type) {
-            case AUDIO_3D_ROLLOFF_INVERSE: {
-                rolloff_mode = FMOD_3D_INVERSEROLLOFF;
-            } break;
-            case AUDIO_3D_ROLLOFF_LINEAR: {
-                rolloff_mode = FMOD_3D_LINEARROLLOFF;
-            } break;
-            case AUDIO_3D_ROLLOFF_LINEAR_SQUARE: {
-                rolloff_mode = FMOD_3D_LINEARSQUAREROLLOFF;
-            } break;
-            case AUDIO_3D_ROLLOFF_INVERSE_TAPERED: {
-                rolloff_mode = FMOD_3D_INVERSETAPEREDROLLOFF;
-            } break;
-            case AUDIO_3D_ROLLOFF_CUSTOM: {
-                rolloff_mode = FMOD_3D_CUSTOMROLLOFF;
-            } break;
-            default: {
-                rolloff_mode = FMOD_3D_INVERSEROLLOFF;
-            } break;
-        }
-        FCR(channel->setMode(mode | rolloff_mode), "Could not set rolloff mode", AUDIO_INVALID_HANDLE);
-    }
-
-    // Resume playback
-    FCR(channel->setPaused(false), "Could not unpause sound", AUDIO_INVALID_HANDLE);
-
-    // Fill in the slot
-    slot->handle     = i_generate_handle();
-    slot->channel    = channel;
-    slot->group      = channel_group;
-    slot->is_3d      = is_3d;
-    slot->is_looping = loop;
-    slot->in_use     = true;
-    ou_strncpy(slot->name, name, sizeof(slot->name) - 1);
-
-    if (is_3d) {
-        llt("Playing 3D sound '%s' at position (%.2f, %.2f, %.2f) (handle %u)", name, position.x, position.y, position.z, slot->handle);
-    } else {
-        llt("Playing 2D sound '%s' (handle %u)", name, slot->handle);
-    }
-
-    return slot->handle;
+    AudioHandle const handle = audio_voice_play(g_audio.voices, sound_id, channel_group, is_3d, loop, position);
+    if (handle == AUDIO_INVALID_HANDLE) { llt("Sound '%s' got culled or lost against the playing voices", name); }
+    return handle;
 }
 
 void audio_init() {
-    // Initialize active sounds array
-    for (auto &active_sound : g_audio.active_sounds) {
-        active_sound.in_use  = false;
-        active_sound.handle  = AUDIO_INVALID_HANDLE;
-        active_sound.channel = nullptr;
-    }
-    g_audio.next_handle             = 1;  // Start from 1, 0 is invalid
+    AudioVoiceBackend backend = {};
+    backend.start             = i_fmod_voice_start;
+    backend.stop              = i_fmod_voice_stop;
+    backend.is_playing        = i_fmod_voice_is_playing;
+    backend.set_position      = i_fmod_voice_set_position;
+    backend.get_length        = i_fmod_voice_get_length;
+
+    g_audio.voices = mmpa(AudioVoiceManager *, sizeof(AudioVoiceManager));
+    audio_voice_init(g_audio.voices, backend, (U32)c_audio__voice_real_max, (U16)c_audio__voice_sound_limit);
+
     g_audio.current_music_handle    = AUDIO_INVALID_HANDLE;
     g_audio.current_ambience_handle = AUDIO_INVALID_HANDLE;
 
@@ -376,9 +379,6 @@ FMOD::System *audio_get_fmod_system() {
 void audio_update(F32 dt) {
     FC(g_audio.fmod_system->update(), "Could not update FMOD system");
 
-    // Clean up finished sounds
-    i_cleanup_finished_sounds();
-
     // Check if time scaling changed
     F32 const current_dt_mod = time_get_delta_mod();
     if (i_state.last_dt_mod != current_dt_mod) {
@@ -413,6 +413,7 @@ void audio_update(F32 dt) {
     }
 
     audio_3d_update_listener(dt);
+    i_update_voices(dt);
 }
 
 void audio_reset_all() {
@@ -457,23 +458,14 @@ void audio_stop_all() {
     g_audio.current_music_handle    = AUDIO_INVALID_HANDLE;
     g_audio.current_ambience_handle = AUDIO_INVALID_HANDLE;
 
-    // Mark all active sounds as not in use
-    for (auto &active_sound : g_audio.active_sounds) {
-        active_sound.in_use = false;
-        active_sound.channel = nullptr;
-    }
+    audio_voice_stop_all(g_audio.voices);
 }
 
 void audio_stop(AudioChannelGroup channel_group) {
     FC(g_audio.groups[channel_group]->stop(), TS("Could not stop FMOD channelgroup %s", i_channel_group_names[channel_group])->c);
 
     // Clean up tracking for this channel group
-    for (auto &active_sound : g_audio.active_sounds) {
-        if (active_sound.in_use && active_sound.group == channel_group) {
-            active_sound.in_use  = false;
-            active_sound.channel = nullptr;
-        }
-    }
+    audio_voice_stop_group(g_audio.voices, channel_group);
 
     if (channel_group == ACG_MUSIC) {
         ou_memset(g_audio.current_music_name, 0, AUDIO_NAME_MAX_LENGTH);
@@ -536,10 +528,7 @@ FMOD::Channel *audio_play_with_channel(AudioChannelGroup channel_group, C8 const
 
     // Simple version for SFX - just play and return the channel
     AudioHandle const handle = i_play_sound_internal(channel_group, name, false, false);
-    if (handle == AUDIO_INVALID_HANDLE) { return nullptr; }
-
-    ActiveSound *sound = i_find_sound_by_handle(handle);
-    return sound ? sound->channel : nullptr;
+    return (FMOD::Channel *)audio_voice_get_channel(g_audio.voices, handle);  // nullptr while virtual
 }
 
 void audio_attach_dsp_by_type(AudioChannelGroup channel_group, FMOD_DSP_TYPE type) {
@@ -708,10 +697,7 @@ void audio_3d_update_listener(F32 dt) {
 
 FMOD::Channel *audio_play_3d_at_position(AudioChannelGroup channel_group, C8 const *name, Vector3 position) {
     AudioHandle const handle = i_play_sound_internal(channel_group, name, true, false, position);
-    if (handle == AUDIO_INVALID_HANDLE) { return nullptr; }
-
-    ActiveSound *sound = i_find_sound_by_handle(handle);
-    return sound ? sound->channel : nullptr;
+    return (FMOD::Channel *)audio_voice_get_channel(g_audio.voices, handle);  // nullptr while virtual
 }
 
 FMOD::Channel *audio_play_3d_at_entity(AudioChannelGroup channel_group, C8 const *name, EID entity_id) {
@@ -787,24 +773,18 @@ void audio_draw_3d_dbg() {
     d3d_line(listener_pos, Vector3Add(listener_pos, Vector3Scale(right, 2.0F)), RED);        // Right (red)
     d3d_sphere(listener_pos, 0.3F, YELLOW);
 
-    // Draw active 3D sounds
-    for (auto &active_sound : g_audio.active_sounds) {
-        ActiveSound *sound = &active_sound;
-        if (!sound->in_use || !sound->is_3d || !sound->channel) { continue; }
+    // Draw 3D voices, virtual ones only exist on our side so we use the tracked position for all of them
+    for (AudioVoice const &voice : g_audio.voices->voices) {
+        if (voice.state == AUDIO_VOICE_STATE_FREE || !voice.is_3d) { continue; }
 
-        // Get 3D attributes from FMOD
-        FMOD_VECTOR fmod_pos;
-        FMOD_VECTOR fmod_vel;
-        FMOD_RESULT const result = sound->channel->get3DAttributes(&fmod_pos, &fmod_vel);
-        if (result != FMOD_OK) { continue; }
-
-        // Convert back from FMOD coordinate system
-        Vector3 const sound_pos = {fmod_pos.x, fmod_pos.y, -fmod_pos.z};
+        Vector3 const sound_pos = voice.position;
         F32 const distance      = Vector3Distance(listener_pos, sound_pos);
 
-        // Color code by distance and volume
+        // Color code by voice state, distance and volume
         auto sound_color = WHITE;
-        if (distance > c_audio__max_distance) {
+        if (voice.state == AUDIO_VOICE_STATE_VIRTUAL) {
+            sound_color = PURPLE;  // Tracked, but no channel
+        } else if (distance > c_audio__max_distance) {
             sound_color = GRAY;  // Too far, silent
         } else if (distance < c_audio__min_distance) {
             sound_color = RED;  // Very close, full volume
@@ -826,39 +806,57 @@ void audio_draw_3d_dbg() {
     }
 }
 
-// Thread-safe audio command queue implementation
-void static i_audio_queue_command(AudioCommandType type, AudioChannelGroup channel_group, C8 const *name, Vector3 position, EID entity_id) {
-    // WARN: Copy name to stack immediately to prevent transient arena corruption from other threads
-    // The 'name' parameter might point to a TS() transient string that can be overwritten by another
-    // worker thread before we lock the mutex and copy it to the command queue
-    C8 name_copy[AUDIO_NAME_MAX_LENGTH];
-    ou_strncpy(name_copy, name, AUDIO_NAME_MAX_LENGTH - 1);
-    name_copy[AUDIO_NAME_MAX_LENGTH - 1] = '\0';
-
-    // Lazy mutex initialization
-    static BOOL mutex_initialized = false;
-    if (!mutex_initialized) {
-        mtx_init(&g_audio_command_queue.mutex, mtx_plain);
-        mutex_initialized = true;
-    }
-
-    mtx_lock(&g_audio_command_queue.mutex);
-    {
-        if (g_audio_command_queue.count < AUDIO_COMMAND_QUEUE_MAX) {
-            AudioCommand *cmd = &g_audio_command_queue.commands[g_audio_command_queue.count++];
-            cmd->type = type;
-            cmd->channel_group = channel_group;
-            cmd->position = position;
-            cmd->entity_id = entity_id;
-
-            // Copy from our stack-protected copy
-            ou_strncpy(cmd->name, name_copy, AUDIO_NAME_MAX_LENGTH - 1);
-            cmd->name[AUDIO_NAME_MAX_LENGTH - 1] = '\0';
-        } else {
-            llt("Audio command queue full, dropping command");
+// Command buffer integration
+
+U32 audio_intern_sound(C8 const *name) {
+    U32 hash = (U32)hash_cstr(name);
+    if (hash == 0) { hash = 1; }  // 0 marks a free slot
+
+    for (U32 probe = 0; probe < AUDIO_SOUND_INTERN_MAX; ++probe) {
+        U32 const index            = (hash + probe) & (AUDIO_SOUND_INTERN_MAX - 1);
+        AudioSoundInternSlot *slot = &i_sound_intern[index];
+        U32 current                = slot->hash.load(std::memory_order_acquire);
+
+        if (current == 0) {
+            // Claim it, the winner copies the name and everyone else waits until it is there
+            if (slot->hash.compare_exchange_strong(current, hash, std::memory_order_acq_rel)) {
+                ou_strncpy(slot->name, name, AUDIO_NAME_MAX_LENGTH - 1);
+                slot->name[AUDIO_NAME_MAX_LENGTH - 1] = '\0';
+                slot->ready.store(true, std::memory_order_release);
+                return index;
+            }
+        }
+
+        if (current == hash) {
+            while (!slot->ready.load(std::memory_order_acquire)) {}
+            return index;
         }
     }
-    mtx_unlock(&g_audio_command_queue.mutex);
+
+    llw("Sound intern table full (Max: %d), dropping %s", AUDIO_SOUND_INTERN_MAX, name);
+    return AUDIO_SOUND_ID_NONE;
+}
+
+C8 const *audio_get_interned_sound(U32 sound_id) {
+    if (sound_id >= AUDIO_SOUND_INTERN_MAX) { return nullptr; }
+
+    AudioSoundInternSlot const *slot = &i_sound_intern[sound_id];
+    return slot->ready.load(std::memory_order_acquire) ? slot->name : nullptr;
+}
+
+void static i_audio_queue_command(AudioCommandType type, AudioChannelGroup channel_group, C8 const *name, Vector3 position, EID entity_id) {
+    // The name usually is a TS() string, interning copies it before another thread can reuse the transient memory
+    U32 const sound_id = audio_intern_sound(name);
+    if (sound_id == AUDIO_SOUND_ID_NONE) { return; }
+
+    Command cmd             = {};
+    cmd.type                = COMMAND_TYPE_AUDIO;
+    cmd.audio.type          = type;
+    cmd.audio.channel_group = channel_group;
+    cmd.audio.sound_id      = sound_id;
+    cmd.audio.position      = position;
+    cmd.audio.entity_id     = entity_id;
+    command_push(&cmd);
 }
 
 void audio_queue_play_3d_at_position(AudioChannelGroup channel_group, C8 const *name, Vector3 position) {
@@ -869,45 +867,24 @@ void audio_queue_play_3d_at_entity(AudioChannelGroup channel_group, C8 const *na
     i_audio_queue_command(AUDIO_CMD_PLAY_3D_AT_ENTITY, channel_group, name, {}, entity_id);
 }
 
-void audio_process_command_queue() {
-    // Get command count and take snapshot
-    mtx_lock(&g_audio_command_queue.mutex);
-    U32 const cmd_count = g_audio_command_queue.count;
-    mtx_unlock(&g_audio_command_queue.mutex);
-
-    if (cmd_count == 0) { return; }
-
-    // Process all commands
-    for (U32 i = 0; i < cmd_count; ++i) {
-        AudioCommand const *cmd = &g_audio_command_queue.commands[i];
-
-        switch (cmd->type) {
-            case AUDIO_CMD_PLAY_3D_AT_POSITION: {
-                audio_play_3d_at_position(cmd->channel_group, cmd->name, cmd->position);
-            } break;
+void audio_execute_command(AudioCommand const *cmd) {
+    C8 const *name = audio_get_interned_sound(cmd->sound_id);
+    if (!name) {
+        llw("Unknown sound id %u", cmd->sound_id);
+        return;
+    }
 
-            case AUDIO_CMD_PLAY_3D_AT_ENTITY: {
-                audio_play_3d_at_entity(cmd->channel_group, cmd->name, cmd->entity_id);
-            } break;
+    switch (cmd->type) {
+        case AUDIO_CMD_PLAY_3D_AT_POSITION: {
+            audio_play_3d_at_position(cmd->channel_group, name, cmd->position);
+        } break;
 
-            default: {
-                llw("Unknown audio command type: %d", cmd->type);
-            } break;
-        }
-    }
+        case AUDIO_CMD_PLAY_3D_AT_ENTITY: {
+            audio_play_3d_at_entity(cmd->channel_group, name, cmd->entity_id);
+        } break;
 
-    // Remove processed commands and shift remaining ones to the front
-    mtx_lock(&g_audio_command_queue.mutex);
-    if (cmd_count < g_audio_command_queue.count) {
-        // New commands were added while we were processing - shift them to the front
-        U32 const remaining = g_audio_command_queue.count - cmd_count;
-        ou_memmove(&g_audio_command_queue.commands[0],
-                   &g_audio_command_queue.commands[cmd_count],
-                   remaining * sizeof(AudioCommand));
-        g_audio_command_queue.count = remaining;
-    } else {
-        // No new commands added, just clear
-        g_audio_command_queue.count = 0;
+        default: {
+            llw("Unknown audio command type: %d", cmd->type);
+        } break;
     }
-    mtx_unlock(&g_audio_command_queue.mutex);
 }
@@ -2,6 +2,7 @@
 
 #include "common.hpp"
 
+#include <atomic>
 #include <raylib.h>
 #include <fmod.hpp>
 #include <tinycthread.h>
@@ -11,11 +12,12 @@
 #undef call_once
 #endif
 
+fwd_decl(AudioVoiceManager);
+
 #define AUDIO_CHANNEL_GROUP_MAX 128
 #define AUDIO_VOLUME_DEFAULT_VALUE 0.5F
 #define AUDIO_PITCH_DEFAULT_VALUE 1.0F
 #define AUDIO_PAN_DEFAULT_VALUE 0.0F
-#define AUDIO_MAX_ACTIVE_SOUNDS 1024
 #define AUDIO_INVALID_HANDLE 0
 #define AUDIO_NAME_MAX_LENGTH 256
 
@@ -24,7 +26,8 @@
 #define AUDIO_3D_ROLLOFF_SCALE 1.0f
 #define AUDIO_3D_DOPPLER_SCALE 0.1F
 
-#define AUDIO_COMMAND_QUEUE_MAX 16384
+#define AUDIO_SOUND_INTERN_MAX 512  // Distinct sound names, must be a power of two
+#define AUDIO_SOUND_ID_NONE U32_MAX
 
 using AudioHandle = U32;
 
@@ -45,7 +48,7 @@ enum AudioChannelGroup : U8 {
     ACG_COUNT,
 };
 
-// Command queue for thread-safe audio playback
+// Sound playback recorded from worker threads, see command.hpp
 enum AudioCommandType : U8 {
     AUDIO_CMD_PLAY_3D_AT_POSITION,
     AUDIO_CMD_PLAY_3D_AT_ENTITY,
@@ -55,25 +58,16 @@ enum AudioCommandType : U8 {
 struct AudioCommand {
     AudioCommandType type;
     AudioChannelGroup channel_group;
-    C8 name[AUDIO_NAME_MAX_LENGTH];
+    U32 sound_id;      // From audio_intern_sound
     Vector3 position;  // Used for PLAY_3D_AT_POSITION
     EID entity_id;     // Used for PLAY_3D_AT_ENTITY
 };
 
-struct AudioCommandQueue {
-    AudioCommand commands[AUDIO_COMMAND_QUEUE_MAX];
-    U32 count;
-    mtx_t mutex;
-};
-
-struct ActiveSound {
-    AudioHandle handle;
-    FMOD::Channel *channel;
-    AudioChannelGroup group;
+// Sound names interned by any thread, open addressing on the name hash, a slot never changes once it is ready
+struct AudioSoundInternSlot {
+    std::atomic<U32> hash;  // 0 while free
+    std::atomic<BOOL> ready;
     C8 name[AUDIO_NAME_MAX_LENGTH];
-    BOOL is_3d;
-    BOOL is_looping;
-    BOOL in_use;
 };
 
 struct Audio {
@@ -81,9 +75,8 @@ struct Audio {
     FMOD::DSP *dsps[ACG_COUNT];
     FMOD::ChannelGroup *groups[ACG_COUNT];
 
-    // Active sound tracking
-    ActiveSound active_sounds[AUDIO_MAX_ACTIVE_SOUNDS];
-    U32 next_handle;
+    // Every playing sound is a voice, see audio_voice.hpp
+    AudioVoiceManager *voices;
 
     // Background music/ambience tracking (for the old API compatibility)
     C8 current_music_name[AUDIO_NAME_MAX_LENGTH];
@@ -148,9 +141,13 @@ void audio_3d_set_doppler_enabled(BOOL enabled);
 void audio_3d_set_doppler_scale(F32 scale);
 void audio_draw_3d_dbg();
 
-// Thread-safe command queue API (safe to call from worker threads)
+// Recorded into the command buffers (safe to call from worker threads)
 void audio_queue_play_3d_at_position(AudioChannelGroup channel_group, C8 const *name, Vector3 position);
 void audio_queue_play_3d_at_entity(AudioChannelGroup channel_group, C8 const *name, EID entity_id);
 
-// Main thread only: process all queued commands
-void audio_process_command_queue();
+// Thread safe, the same name always gives the same id. AUDIO_SOUND_ID_NONE once the table is full.
+U32 audio_intern_sound(C8 const *name);
+C8 const *audio_get_interned_sound(U32 sound_id);
+
+// Main thread only, runs a recorded command
+void audio_execute_command(AudioCommand const *cmd);
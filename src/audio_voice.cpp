@@ -0,0 +1,343 @@
+#include "audio_voice.hpp"
+#include "log.hpp"
+#include "math.hpp"
+#include "std.hpp"
+
+#include <raymath.h>
+#include <stdlib.h>
+
+#define AUDIO_VOICE_REAL_BONUS 1.1F  // Real voices keep their channel against slightly better virtual ones, no flip-flopping
+
+C8 static const *i_voice_state_to_cstr[AUDIO_VOICE_STATE_COUNT] = {"Free", "Real", "Virtual"};
+
+// Music and ambience barely ever compete, SFX is where the crowds are
+U16 static const i_group_limit_default[ACG_COUNT]   = {4, 128, 8, 32};
+U8 static const i_group_priority_default[ACG_COUNT] = {255, 100, 200, 150};
+
+struct AudioVoiceRank {
+    F32 score;
+    U16 index;
+};
+
+S32 static i_compare_ranks(void const *a, void const *b) {
+    auto const *x = (AudioVoiceRank const *)a;
+    auto const *y = (AudioVoiceRank const *)b;
+    if (x->score != y->score) { return x->score > y->score ? -1 : 1; }
+    return (S32)x->index - (S32)y->index;
+}
+
+U32 static i_index(AudioHandle handle) {
+    return handle & (AUDIO_VOICE_MAX - 1);
+}
+
+// Priority decides, audibility only orders voices of the same priority
+F32 static i_score(AudioVoice const *voice) {
+    return (F32)voice->priority + voice->audibility;
+}
+
+// What a virtual voice has to beat to take the channel
+F32 static i_real_score(AudioVoice const *voice) {
+    F32 const bonus = voice->state == AUDIO_VOICE_STATE_REAL ? AUDIO_VOICE_REAL_BONUS : 1.0F;
+    return (F32)voice->priority + (voice->audibility * bonus);
+}
+
+U16 static i_sound_limit(AudioVoiceManager const *mgr, U32 sound_id) {
+    U16 const limit = mgr->sound_limit[sound_id];
+    return limit > 0 ? limit : mgr->sound_limit_default;
+}
+
+BOOL static i_make_real(AudioVoiceManager *mgr, AudioVoice *voice) {
+    void *channel = mgr->backend.start(mgr->backend.user, voice);
+    if (!channel) { return false; }
+
+    voice->channel = channel;
+    voice->state   = AUDIO_VOICE_STATE_REAL;
+    mgr->real_count++;
+    return true;
+}
+
+void static i_make_virtual(AudioVoiceManager *mgr, AudioVoice *voice) {
+    mgr->backend.stop(mgr->backend.user, voice->channel);
+    voice->channel = nullptr;
+    voice->state   = AUDIO_VOICE_STATE_VIRTUAL;
+    mgr->real_count--;
+    mgr->stats.virtualized++;
+}
+
+void static i_free(AudioVoiceManager *mgr, AudioVoice *voice) {
+    if (voice->state == AUDIO_VOICE_STATE_REAL) {
+        mgr->backend.stop(mgr->backend.user, voice->channel);
+        mgr->real_count--;
+    }
+
+    mgr->sound_count[voice->sound_id]--;
+    mgr->group_count[voice->group]--;
+    mgr->free_indices[mgr->free_count++] = (U16)i_index(voice->handle);
+
+    voice->handle  = AUDIO_INVALID_HANDLE;
+    voice->state   = AUDIO_VOICE_STATE_FREE;
+    voice->channel = nullptr;
+}
+
+// Lowest rated voice in use, restricted to one sound or one group unless they are U32_MAX / ACG_COUNT
+AudioVoice static *i_find_lowest(AudioVoiceManager *mgr, U32 sound_id, AudioChannelGroup group, BOOL real_only) {
+    AudioVoice *lowest = nullptr;
+    F32 lowest_score   = F32_MAX;
+    for (AudioVoice &voice : mgr->voices) {
+        if (voice.state == AUDIO_VOICE_STATE_FREE)              { continue; }
+        if (real_only && voice.state != AUDIO_VOICE_STATE_REAL) { continue; }
+        if (sound_id != U32_MAX && voice.sound_id != sound_id)  { continue; }
+        if (group != ACG_COUNT && voice.group != group)         { continue; }
+
+        F32 const score = i_score(&voice);
+        if (score < lowest_score) {
+            lowest       = &voice;
+            lowest_score = score;
+        }
+    }
+    return lowest;
+}
+
+// Makes room for a voice with the given score by stealing the lowest one, false if the new voice is the lowest
+BOOL static i_make_room(AudioVoiceManager *mgr, F32 score, U32 sound_id, AudioChannelGroup group) {
+    AudioVoice *victim = i_find_lowest(mgr, sound_id, group, false);
+    if (!victim || i_score(victim) >= score) { return false; }
+
+    i_free(mgr, victim);
+    mgr->stats.stolen++;
+    return true;
+}
+
+void audio_voice_init(AudioVoiceManager *mgr, AudioVoiceBackend backend, U32 real_max, U16 sound_limit_default) {
+    ou_memset(mgr, 0, sizeof(AudioVoiceManager));
+
+    mgr->backend             = backend;
+    mgr->real_max            = real_max;
+    mgr->sound_limit_default = sound_limit_default;
+    mgr->next_serial         = 1;  // Handle 0 is AUDIO_INVALID_HANDLE
+    mgr->rolloff             = AUDIO_3D_ROLLOFF_INVERSE;
+    mgr->min_distance        = AUDIO_3D_MIN_DISTANCE;
+    mgr->max_distance        = AUDIO_3D_MAX_DISTANCE;
+    mgr->rolloff_scale       = AUDIO_3D_ROLLOFF_SCALE;
+
+    for (S32 i = 0; i < ACG_COUNT; ++i) {
+        mgr->group_limit[i]    = i_group_limit_default[i];
+        mgr->group_priority[i] = i_group_priority_default[i];
+    }
+
+    // Hand out low indices first, they are popped from the back
+    for (U32 i = 0; i < AUDIO_VOICE_MAX; ++i) { mgr->free_indices[i] = (U16)(AUDIO_VOICE_MAX - 1 - i); }
+    mgr->free_count = AUDIO_VOICE_MAX;
+}
+
+F32 audio_voice_audibility(AudioVoiceManager const *mgr, Vector3 position) {
+    F32 const distance = Vector3Distance(mgr->listener, position);
+    if (distance >= mgr->max_distance) { return 0.0F; }
+    if (distance <= mgr->min_distance) { return 1.0F; }
+
+    F32 const inverse = mgr->min_distance / (mgr->min_distance + (mgr->rolloff_scale * (distance - mgr->min_distance)));
+    F32 const linear  = 1.0F - ((distance - mgr->min_distance) / (mgr->max_distance - mgr->min_distance));
+
+    switch (mgr->rolloff) {
+        case AUDIO_3D_ROLLOFF_LINEAR:          return linear;
+        case AUDIO_3D_ROLLOFF_LINEAR_SQUARE:   return linear * linear;
+        case AUDIO_3D_ROLLOFF_INVERSE_TAPERED: return glm::min(inverse, linear * linear);
+        case AUDIO_3D_ROLLOFF_INVERSE:
+        case AUDIO_3D_ROLLOFF_CUSTOM:
+        default:                               return inverse;
+    }
+}
+
+AudioHandle audio_voice_play(AudioVoiceManager *mgr, U32 sound_id, AudioChannelGroup group, BOOL is_3d, BOOL loop, Vector3 position) {
+    if (sound_id >= AUDIO_SOUND_INTERN_MAX) { return AUDIO_INVALID_HANDLE; }
+
+    F32 const audibility = is_3d ? audio_voice_audibility(mgr, position) : 1.0F;
+    if (audibility <= 0.0F && !loop) {
+        mgr->stats.culled++;
+        return AUDIO_INVALID_HANDLE;
+    }
+
+    F32 const score = (F32)mgr->group_priority[group] + audibility;
+    if (mgr->sound_count[sound_id] >= i_sound_limit(mgr, sound_id) && !i_make_room(mgr, score, sound_id, ACG_COUNT)) {
+        mgr->stats.rejected++;
+        return AUDIO_INVALID_HANDLE;
+    }
+    if (mgr->group_count[group] >= mgr->group_limit[group] && !i_make_room(mgr, score, U32_MAX, group)) {
+        mgr->stats.rejected++;
+        return AUDIO_INVALID_HANDLE;
+    }
+    if (mgr->free_count == 0 && !i_make_room(mgr, score, U32_MAX, ACG_COUNT)) {
+        mgr->stats.rejected++;
+        return AUDIO_INVALID_HANDLE;
+    }
+
+    if ((mgr->next_serial << AUDIO_VOICE_INDEX_BITS) == 0) { mgr->next_serial = 1; }  // Wrapped, keep 0 for invalid
+
+    U32 const index   = mgr->free_indices[--mgr->free_count];
+    AudioVoice *voice = &mgr->voices[index];
+    voice->handle     = (mgr->next_serial++ << AUDIO_VOICE_INDEX_BITS) | index;
+    voice->state      = AUDIO_VOICE_STATE_VIRTUAL;
+    voice->group      = group;
+    voice->priority   = mgr->group_priority[group];
+    voice->is_3d      = is_3d;
+    voice->is_looping = loop;
+    voice->sound_id   = sound_id;
+    voice->channel    = nullptr;
+    voice->position   = position;
+    voice->audibility = audibility;
+    voice->elapsed    = 0.0F;
+    voice->length     = mgr->backend.get_length(mgr->backend.user, sound_id);
+
+    mgr->sound_count[sound_id]++;
+    mgr->group_count[group]++;
+    mgr->stats.played++;
+
+    // Straight to a channel if one is free or the worst real voice is worse than us, otherwise wait virtually
+    if (audibility > 0.0F) {
+        if (mgr->real_count >= mgr->real_max) {
+            AudioVoice *lowest = i_find_lowest(mgr, U32_MAX, ACG_COUNT, true);
+            if (lowest && i_real_score(lowest) < score) { i_make_virtual(mgr, lowest); }
+        }
+        if (mgr->real_count < mgr->real_max) { i_make_real(mgr, voice); }
+    }
+
+    return voice->handle;
+}
+
+void audio_voice_update(AudioVoiceManager *mgr, F32 dt, Vector3 listener) {
+    mgr->listener = listener;
+
+    AudioVoiceRank ranks[AUDIO_VOICE_MAX];
+    U32 rank_count = 0;
+
+    for (U32 i = 0; i < AUDIO_VOICE_MAX; ++i) {
+        AudioVoice *voice = &mgr->voices[i];
+        if (voice->state == AUDIO_VOICE_STATE_FREE) { continue; }
+
+        voice->elapsed += dt;
+
+        // Real voices end when the backend says so, virtual one-shots once their time is up
+        BOOL const has_ended = voice->state == AUDIO_VOICE_STATE_REAL && mgr->backend.is_playing
+                                   ? !mgr->backend.is_playing(mgr->backend.user, voice->channel)
+                                   : !voice->is_looping && voice->elapsed >= voice->length;
+        if (has_ended) {
+            i_free(mgr, voice);
+            continue;
+        }
+
+        if (voice->is_3d) { voice->audibility = audio_voice_audibility(mgr, voice->position); }
+        if (voice->audibility <= 0.0F) {
+            if (voice->state == AUDIO_VOICE_STATE_REAL) { i_make_virtual(mgr, voice); }
+            continue;
+        }
+
+        ranks[rank_count].score   = i_real_score(voice);
+        ranks[rank_count++].index = (U16)i;
+    }
+
+    // Everything audible fits, otherwise only the best real_max keep or get a channel
+    if (rank_count > mgr->real_max) { qsort(ranks, rank_count, sizeof(AudioVoiceRank), i_compare_ranks); }
+    U32 const real_target = glm::min(rank_count, mgr->real_max);
+
+    // Free the channels first so the promoted voices find one
+    for (U32 i = real_target; i < rank_count; ++i) {
+        AudioVoice *voice = &mgr->voices[ranks[i].index];
+        if (voice->state == AUDIO_VOICE_STATE_REAL) { i_make_virtual(mgr, voice); }
+    }
+    for (U32 i = 0; i < real_target; ++i) {
+        AudioVoice *voice = &mgr->voices[ranks[i].index];
+        if (voice->state == AUDIO_VOICE_STATE_VIRTUAL && i_make_real(mgr, voice)) { mgr->stats.devirtualized++; }
+    }
+}
+
+AudioVoice *audio_voice_get(AudioVoiceManager *mgr, AudioHandle handle) {
+    if (handle == AUDIO_INVALID_HANDLE) { return nullptr; }
+
+    AudioVoice *voice = &mgr->voices[i_index(handle)];
+    return voice->handle == handle ? voice : nullptr;
+}
+
+void *audio_voice_get_channel(AudioVoiceManager *mgr, AudioHandle handle) {
+    AudioVoice const *voice = audio_voice_get(mgr, handle);
+    return voice ? voice->channel : nullptr;
+}
+
+void audio_voice_stop(AudioVoiceManager *mgr, AudioHandle handle) {
+    AudioVoice *voice = audio_voice_get(mgr, handle);
+    if (voice) { i_free(mgr, voice); }
+}
+
+void audio_voice_stop_group(AudioVoiceManager *mgr, AudioChannelGroup group) {
+    for (AudioVoice &voice : mgr->voices) {
+        if (voice.state != AUDIO_VOICE_STATE_FREE && voice.group == group) { i_free(mgr, &voice); }
+    }
+}
+
+void audio_voice_stop_all(AudioVoiceManager *mgr) {
+    for (AudioVoice &voice : mgr->voices) {
+        if (voice.state != AUDIO_VOICE_STATE_FREE) { i_free(mgr, &voice); }
+    }
+}
+
+void audio_voice_set_position(AudioVoiceManager *mgr, AudioHandle handle, Vector3 position) {
+    AudioVoice *voice = audio_voice_get(mgr, handle);
+    if (!voice) { return; }
+
+    voice->position = position;
+    if (voice->state == AUDIO_VOICE_STATE_REAL) { mgr->backend.set_position(mgr->backend.user, voice->channel, position); }
+}
+
+void audio_voice_set_sound_limit(AudioVoiceManager *mgr, U32 sound_id, U16 limit) {
+    if (sound_id >= AUDIO_SOUND_INTERN_MAX) { return; }
+    mgr->sound_limit[sound_id] = limit;
+}
+
+void audio_voice_set_group_limit(AudioVoiceManager *mgr, AudioChannelGroup group, U16 limit, U8 priority) {
+    mgr->group_limit[group]    = limit;
+    mgr->group_priority[group] = priority;
+}
+
+AudioVoiceStats audio_voice_get_stats(AudioVoiceManager const *mgr) {
+    AudioVoiceStats stats = mgr->stats;
+    stats.real_count      = mgr->real_count;
+    stats.virtual_count   = AUDIO_VOICE_MAX - mgr->free_count - mgr->real_count;
+    return stats;
+}
+
+C8 const *audio_voice_state_to_cstr(AudioVoiceState state) {
+    return i_voice_state_to_cstr[state];
+}
+
+// ====== NULL BACKEND ======
+
+void static *i_null_start(void *user, AudioVoice const *voice) {
+    unused(user);
+    return (void *)(SZ)voice->handle;  // Never dereferenced, only has to be non-null
+}
+
+void static i_null_stop(void *user, void *channel) {
+    unused(user);
+    unused(channel);
+}
+
+void static i_null_set_position(void *user, void *channel, Vector3 position) {
+    unused(user);
+    unused(channel);
+    unused(position);
+}
+
+F32 static i_null_get_length(void *user, U32 sound_id) {
+    unused(user);
+    unused(sound_id);
+    return AUDIO_VOICE_NULL_SOUND_LENGTH;
+}
+
+AudioVoiceBackend audio_voice_null_backend() {
+    AudioVoiceBackend backend = {};
+    backend.start             = i_null_start;
+    backend.stop              = i_null_stop;
+    backend.is_playing        = nullptr;
+    backend.set_position      = i_null_set_position;
+    backend.get_length        = i_null_get_length;
+    return backend;
+}
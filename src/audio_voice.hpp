@@ -0,0 +1,106 @@
+#pragma once
+
+#include "audio.hpp"
+#include "common.hpp"
+
+#include <raylib.h>
+
+// Decides which of the requested sounds actually get a channel. Every play becomes a voice, voices are limited per
+// sound and per channel group and rated by group priority plus audibility (distance through the rolloff curve, 0 - 1).
+// When a limit is hit the lowest rated voice gets stolen, or the new one is dropped if it would be the lowest itself.
+// Only the best AudioVoiceManager.real_max voices are real and own a backend channel, the rest are virtual: they keep
+// their position and play time without costing any mixing and get a channel back once they are among the best again.
+// The backend is a set of callbacks so the manager runs the same without FMOD (see audio_voice_null_backend()).
+
+#define AUDIO_VOICE_MAX 1024             // Real and virtual, must be a power of two
+#define AUDIO_VOICE_INDEX_BITS 10        // log2(AUDIO_VOICE_MAX), the rest of a handle is a serial number
+#define AUDIO_VOICE_NULL_SOUND_LENGTH 1.0F  // Seconds, every sound of the null backend is this long
+
+enum AudioVoiceState : U8 {
+    AUDIO_VOICE_STATE_FREE,
+    AUDIO_VOICE_STATE_REAL,
+    AUDIO_VOICE_STATE_VIRTUAL,
+    AUDIO_VOICE_STATE_COUNT,
+};
+
+struct AudioVoice {
+    AudioHandle handle;  // AUDIO_INVALID_HANDLE while free
+    AudioVoiceState state;
+    AudioChannelGroup group;
+    U8 priority;
+    BOOL is_3d;
+    BOOL is_looping;
+    U32 sound_id;        // From audio_intern_sound
+    void *channel;       // Backend channel while real
+    Vector3 position;
+    F32 audibility;
+    F32 elapsed;         // Seconds since the start, a voice that gets real again resumes from here
+    F32 length;          // Seconds, 0 if the backend does not know
+};
+
+struct AudioVoiceBackend {
+    void *(*start)(void *user, AudioVoice const *voice);  // Returns the channel or nullptr
+    void (*stop)(void *user, void *channel);
+    BOOL (*is_playing)(void *user, void *channel);        // Optional, without it voices end after their length
+    void (*set_position)(void *user, void *channel, Vector3 position);
+    F32 (*get_length)(void *user, U32 sound_id);
+    void *user;
+};
+
+struct AudioVoiceStats {
+    U64 played;
+    U64 culled;    // One-shots out of hearing range, never got a voice
+    U64 rejected;  // Lost against every voice of a full limit
+    U64 stolen;
+    U64 virtualized;
+    U64 devirtualized;
+    U32 real_count;
+    U32 virtual_count;
+};
+
+struct AudioVoiceManager {
+    AudioVoice voices[AUDIO_VOICE_MAX];
+    U16 free_indices[AUDIO_VOICE_MAX];
+    U32 free_count;
+    U32 next_serial;
+    AudioVoiceBackend backend;
+
+    // Limits
+    U32 real_max;
+    U16 sound_limit_default;
+    U16 sound_limit[AUDIO_SOUND_INTERN_MAX];  // 0 uses sound_limit_default
+    U16 group_limit[ACG_COUNT];
+    U8 group_priority[ACG_COUNT];
+
+    // Attenuation, should match what the backend does
+    Audio3DRolloff rolloff;
+    F32 min_distance;
+    F32 max_distance;
+    F32 rolloff_scale;
+    Vector3 listener;
+
+    // Voices in use, real and virtual
+    U16 sound_count[AUDIO_SOUND_INTERN_MAX];
+    U16 group_count[ACG_COUNT];
+    U32 real_count;
+
+    AudioVoiceStats stats;
+};
+
+void audio_voice_init(AudioVoiceManager *mgr, AudioVoiceBackend backend, U32 real_max, U16 sound_limit_default);
+AudioVoiceBackend audio_voice_null_backend();
+// AUDIO_INVALID_HANDLE if the sound got culled or rejected, a valid handle may still be virtual
+AudioHandle audio_voice_play(AudioVoiceManager *mgr, U32 sound_id, AudioChannelGroup group, BOOL is_3d, BOOL loop, Vector3 position);
+// Advances play time, ends finished voices and hands the channels to the best rated voices
+void audio_voice_update(AudioVoiceManager *mgr, F32 dt, Vector3 listener);
+void audio_voice_stop(AudioVoiceManager *mgr, AudioHandle handle);
+void audio_voice_stop_group(AudioVoiceManager *mgr, AudioChannelGroup group);
+void audio_voice_stop_all(AudioVoiceManager *mgr);
+void audio_voice_set_position(AudioVoiceManager *mgr, AudioHandle handle, Vector3 position);
+AudioVoice *audio_voice_get(AudioVoiceManager *mgr, AudioHandle handle);  // nullptr once the voice ended
+void *audio_voice_get_channel(AudioVoiceManager *mgr, AudioHandle handle);  // nullptr while virtual
+void audio_voice_set_sound_limit(AudioVoiceManager *mgr, U32 sound_id, U16 limit);
+void audio_voice_set_group_limit(AudioVoiceManager *mgr, AudioChannelGroup group, U16 limit, U8 priority);
+F32 audio_voice_audibility(AudioVoiceManager const *mgr, Vector3 position);
+AudioVoiceStats audio_voice_get_stats(AudioVoiceManager const *mgr);
+C8 const *audio_voice_state_to_cstr(AudioVoiceState state);
@@ -0,0 +1,253 @@
+#include "bench.hpp"
+#include "audio.hpp"
+#include "command.hpp"
+#include "core.hpp"
+#include "entity_actor.hpp"
+#include "entity_spawn.hpp"
+#include "grid.hpp"
+#include "job.hpp"
+#include "log.hpp"
+#include "math.hpp"
+#include "memory.hpp"
+#include "scene.hpp"
+#include "std.hpp"
+#include "string.hpp"
+#include "time.hpp"
+#include "unit.hpp"
+#include "world.hpp"
+
+#include <stdlib.h>
+
+#define BENCH_SPAWN_NPC_INTERVAL 10   // Frames between two spawn waves in the spawn_npc scenario
+#define BENCH_SPAWN_NPC_COUNT 50
+#define BENCH_SPAWN_VEGETATION_COUNT 25
+
+struct BenchScenario {
+    C8 const *name;
+    C8 const *desc;
+    void (*setup)();
+    void (*frame)(U32 frame);  // Scripted input for this frame, runs inside the spawn phase
+};
+
+C8 static const *i_phase_names[BENCH_PHASE_COUNT] = {
+    "spawn",
+    "grid_populate",
+    "vegetation_collision",
+    "world_update",
+    "draw_prepare",
+    "frame",
+};
+
+C8 const *bench_phase_to_cstr(BenchPhase phase) {
+    return i_phase_names[phase];
+}
+
+// ====== SCENARIOS ======
+
+void static i_command_npcs_to_harvest() {
+    WORLD_LIST_EACH(&g_world->type_lists[ENTITY_TYPE_NPC], i) {
+        entity_actor_start_looking_for_target(i, ENTITY_TYPE_VEGETATION);
+    }
+}
+
+// Same world as the collision test scene: the test set, TREE_COUNT * 2 trees and 1000 NPCs around the cursor
+void static i_setup_collision_test() {
+    scenes_set_scene(SCENE_COLLISION_TEST);
+    audio_reset_all();
+}
+
+void static i_setup_harvest_trees() {
+    i_setup_collision_test();
+    i_command_npcs_to_harvest();
+}
+
+void static i_frame_harvest_trees(U32 frame) {
+    unused(frame);
+}
+
+void static i_setup_spawn_npc() {
+    i_setup_collision_test();
+}
+
+void static i_frame_spawn_npc(U32 frame) {
+    if (frame % BENCH_SPAWN_NPC_INTERVAL != 0) { return; }
+
+    entity_spawn_npc(BENCH_SPAWN_NPC_COUNT, false);
+    entity_spawn_queue_random_vegetation_on_terrain(BENCH_SPAWN_VEGETATION_COUNT, false);
+}
+
+BenchScenario static i_scenarios[] = {
+    {"harvest_trees", "Collision test world, every NPC goes harvesting at once",                     i_setup_harvest_trees, i_frame_harvest_trees},
+    {"spawn_npc",     "Collision test world, NPCs and trees keep getting spawned while it runs", i_setup_spawn_npc,     i_frame_spawn_npc    },
+};
+
+// ====== MEASURING ======
+
+S32 static i_compare_f64(void const *a, void const *b) {
+    F64 const x = *(F64 const *)a;
+    F64 const y = *(F64 const *)b;
+    return (x > y) - (x < y);
+}
+
+BenchPhaseStats static i_phase_stats(F64 *samples, U32 count) {
+    BenchPhaseStats stats = {};
+    if (count == 0) { return stats; }
+
+    F64 sum = 0.0;
+    for (U32 i = 0; i < count; ++i) { sum += samples[i]; }
+    qsort(samples, count, sizeof(F64), i_compare_f64);
+
+    stats.mean = sum / (F64)count;
+    stats.p50  = samples[(count - 1) / 2];
+    stats.p99  = samples[((count - 1) * 99) / 100];
+    stats.max  = samples[count - 1];
+    return stats;
+}
+
+#define BENCH_PHASE(samples, phase, frame, call) do {             \
+    F64 const phase_start_ = time_get_glfw_f64();                  \
+    call;                                                          \
+    (samples)[phase][frame] = time_get_glfw_f64() - phase_start_;  \
+} while(0)
+
+void static i_run_frame(BenchScenario const *scenario, U32 frame, F64 **samples, U32 sample_index) {
+    F32 const dt = BENCH_FIXED_DT;
+    F64 const frame_start = time_get_glfw_f64();
+
+    // Same order as core_update and the scene update, the command buffers get flushed where core_update does it
+    BENCH_PHASE(samples, BENCH_PHASE_SPAWN, sample_index, {
+        scenario->frame(frame);
+        command_flush();
+    });
+    BENCH_PHASE(samples, BENCH_PHASE_GRID_POPULATE, sample_index, grid_populate());
+    BENCH_PHASE(samples, BENCH_PHASE_VEGETATION_COLLISION, sample_index, world_vegetation_collision());
+    BENCH_PHASE(samples, BENCH_PHASE_WORLD_UPDATE, sample_index, world_update(dt, dt));
+    BENCH_PHASE(samples, BENCH_PHASE_DRAW_PREPARE, sample_index, {
+        WorldDrawList list = {};
+        world_draw_3d_sketch_prepare(&list);
+    });
+
+    samples[BENCH_PHASE_FRAME][sample_index] = time_get_glfw_f64() - frame_start;
+}
+
+// ====== REPORT ======
+
+BOOL static i_write_report(BenchReport const *report) {
+    if (!DirectoryExists(BENCH_REPORT_FOLDER "/")) { MakeDirectory(BENCH_REPORT_FOLDER "/"); }
+    C8 const *path = TS(BENCH_REPORT_FOLDER "/%s_%" PRIu64 ".json", report->scenario, (U64)time(nullptr))->c;
+    FILE *file     = fopen(path, "w");
+    if (!file) {
+        lle("Could not open %s to write the benchmark report", path);
+        return false;
+    }
+
+    fprintf(file, "{\n");
+    fprintf(file, "  \"scenario\": \"%s\",\n", report->scenario);
+    fprintf(file, "  \"version\": \"%s\",\n", g_core.version_info.c);
+    fprintf(file, "  \"build\": \"%s\",\n", g_core.version_info.build_type);
+    fprintf(file, "  \"threads\": %u,\n", job_system_get_thread_count());
+    fprintf(file, "  \"seed\": %u,\n", RANDOM_SEED);
+    fprintf(file, "  \"dt\": %.9f,\n", (F64)BENCH_FIXED_DT);
+    fprintf(file, "  \"frames\": %u,\n", report->frame_count);
+    fprintf(file, "  \"warmup_frames\": %u,\n", BENCH_WARMUP_FRAME_COUNT);
+    fprintf(file, "  \"entities\": {\"start\": %u, \"end\": %u},\n", report->start_entity_count, report->end_entity_count);
+    fprintf(file, "  \"phases_us\": {\n");
+    for (U32 phase = 0; phase < BENCH_PHASE_COUNT; ++phase) {
+        BenchPhaseStats const *s = &report->phases[phase];
+        fprintf(file, "    \"%s\": {\"mean\": %.3f, \"p50\": %.3f, \"p99\": %.3f, \"max\": %.3f}%s\n", i_phase_names[phase], BASE_TO_MICRO(s->mean),
+                BASE_TO_MICRO(s->p50), BASE_TO_MICRO(s->p99), BASE_TO_MICRO(s->max), phase + 1 < BENCH_PHASE_COUNT ? "," : "");
+    }
+    fprintf(file, "  },\n");
+    fprintf(file, "  \"allocations_per_frame\": {\"transient_count\": %.2f, \"transient_bytes\": %.0f, \"permanent_bytes\": %.0f}\n",
+            report->transient_allocations_per_frame, report->transient_bytes_per_frame, report->permanent_bytes_per_frame);
+    fprintf(file, "}\n");
+    fclose(file);
+
+    lli("Benchmark report written to %s", path);
+    return true;
+}
+
+void static i_log_report(BenchReport const *report) {
+    C8 pretty_mean[PRETTY_BUFFER_SIZE] = {};
+    C8 pretty_p50[PRETTY_BUFFER_SIZE]  = {};
+    C8 pretty_p99[PRETTY_BUFFER_SIZE]  = {};
+    C8 pretty_max[PRETTY_BUFFER_SIZE]  = {};
+
+    lli("Benchmark %s: %u frames, %u -> %u entities", report->scenario, report->frame_count, report->start_entity_count, report->end_entity_count);
+    for (U32 phase = 0; phase < BENCH_PHASE_COUNT; ++phase) {
+        BenchPhaseStats const *s = &report->phases[phase];
+        unit_to_pretty_time_f(BASE_TO_NANO(s->mean), pretty_mean, PRETTY_BUFFER_SIZE, UNIT_TIME_SECONDS);
+        unit_to_pretty_time_f(BASE_TO_NANO(s->p50), pretty_p50, PRETTY_BUFFER_SIZE, UNIT_TIME_SECONDS);
+        unit_to_pretty_time_f(BASE_TO_NANO(s->p99), pretty_p99, PRETTY_BUFFER_SIZE, UNIT_TIME_SECONDS);
+        unit_to_pretty_time_f(BASE_TO_NANO(s->max), pretty_max, PRETTY_BUFFER_SIZE, UNIT_TIME_SECONDS);
+        lli("  %-20s mean %10s  p50 %10s  p99 %10s  max %10s", i_phase_names[phase], pretty_mean, pretty_p50, pretty_p99, pretty_max);
+    }
+
+    C8 pretty_transient[PRETTY_BUFFER_SIZE] = {};
+    C8 pretty_permanent[PRETTY_BUFFER_SIZE] = {};
+    unit_to_pretty_prefix_binary_u("B", (U64)report->transient_bytes_per_frame, pretty_transient, PRETTY_BUFFER_SIZE, UNIT_PREFIX_BINARY_MEBI);
+    unit_to_pretty_prefix_binary_u("B", (U64)report->permanent_bytes_per_frame, pretty_permanent, PRETTY_BUFFER_SIZE, UNIT_PREFIX_BINARY_MEBI);
+    lli("  allocations/frame    transient %.1f (%s), permanent %s", report->transient_allocations_per_frame, pretty_transient, pretty_permanent);
+}
+
+BOOL bench_run(C8 const *scenario_name, U32 frame_count) {
+    BenchScenario const *scenario = nullptr;
+    for (BenchScenario const &s : i_scenarios) {
+        if (ou_strcmp(s.name, scenario_name) == 0) { scenario = &s; }
+    }
+
+    if (!scenario) {
+        lle("Unknown benchmark scenario: %s", scenario_name);
+        for (BenchScenario const &s : i_scenarios) { lli("  %-16s %s", s.name, s.desc); }
+        return false;
+    }
+
+    if (frame_count == 0) { frame_count = BENCH_DEFAULT_FRAME_COUNT; }
+    lli("Running benchmark %s (%s) for %u frames", scenario->name, scenario->desc, frame_count);
+
+    random_seed(RANDOM_SEED);
+    scenario->setup();
+    memory_post();
+
+    for (U32 frame = 0; frame < BENCH_WARMUP_FRAME_COUNT; ++frame) {
+        F64 *warmup_samples[BENCH_PHASE_COUNT] = {};
+        F64 warmup_sink[BENCH_PHASE_COUNT]     = {};
+        for (U32 phase = 0; phase < BENCH_PHASE_COUNT; ++phase) { warmup_samples[phase] = &warmup_sink[phase]; }
+        i_run_frame(scenario, frame, warmup_samples, 0);
+        memory_post();
+    }
+
+    F64 *samples[BENCH_PHASE_COUNT] = {};
+    for (auto &phase_samples : samples) { phase_samples = mcpa(F64 *, frame_count, sizeof(F64)); }
+
+    BenchReport report        = {};
+    report.scenario           = scenario->name;
+    report.frame_count        = frame_count;
+    report.start_entity_count = g_world->active_entity_count;
+
+    SZ transient_allocations = 0;
+    SZ transient_bytes       = 0;
+    SZ const permanent_start = memory_get_current_arena_stats(MEMORY_TYPE_ARENA_PERMANENT).total_used;
+
+    for (U32 frame = 0; frame < frame_count; ++frame) {
+        i_run_frame(scenario, BENCH_WARMUP_FRAME_COUNT + frame, samples, frame);
+
+        // The transient arena only gets reset by memory_post, so whatever it holds now is this frame's.
+        // The count is one per allocation, the bytes round up to the thread chunks every thread carved this frame.
+        ArenaStats const transient = memory_get_current_arena_stats(MEMORY_TYPE_ARENA_TRANSIENT);
+        transient_allocations     += transient.total_allocation_count;
+        transient_bytes           += transient.total_used;
+        memory_post();
+    }
+
+    SZ const permanent_end = memory_get_current_arena_stats(MEMORY_TYPE_ARENA_PERMANENT).total_used;
+
+    report.end_entity_count                = g_world->active_entity_count;
+    report.transient_allocations_per_frame = (F64)transient_allocations / (F64)frame_count;
+    report.transient_bytes_per_frame       = (F64)transient_bytes / (F64)frame_count;
+    report.permanent_bytes_per_frame       = (F64)(permanent_end - permanent_start) / (F64)frame_count;
+    for (U32 phase = 0; phase < BENCH_PHASE_COUNT; ++phase) { report.phases[phase] = i_phase_stats(samples[phase], frame_count); }
+
+    i_log_report(&report);
+    return i_write_report(&report);
+}
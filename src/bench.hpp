@@ -0,0 +1,44 @@
+#pragma once
+
+#include "common.hpp"
+
+// Headless benchmark mode (--bench <scenario>), runs the CPU side of a scripted scenario with a fixed timestep and
+// writes a JSON report with per phase timings and allocations per frame to BENCH_REPORT_FOLDER.
+// No frame is ever drawn or presented, input is never polled and the RNG is seeded with RANDOM_SEED.
+
+#define BENCH_REPORT_FOLDER "bench"
+#define BENCH_DEFAULT_FRAME_COUNT 600
+#define BENCH_WARMUP_FRAME_COUNT 30  // Run before measuring so lazy allocations and caches settle
+#define BENCH_FIXED_DT (1.0F / 60.0F)
+
+enum BenchPhase : U8 {
+    BENCH_PHASE_SPAWN,
+    BENCH_PHASE_GRID_POPULATE,
+    BENCH_PHASE_VEGETATION_COLLISION,
+    BENCH_PHASE_WORLD_UPDATE,  // Entity, animation and actor AI jobs
+    BENCH_PHASE_DRAW_PREPARE,  // CPU side of world_draw_3d_sketch
+    BENCH_PHASE_FRAME,
+    BENCH_PHASE_COUNT,
+};
+
+struct BenchPhaseStats {
+    F64 mean;
+    F64 p50;
+    F64 p99;
+    F64 max;
+};
+
+struct BenchReport {
+    C8 const *scenario;
+    U32 frame_count;
+    U32 start_entity_count;
+    U32 end_entity_count;
+    BenchPhaseStats phases[BENCH_PHASE_COUNT];  // Seconds
+    F64 transient_allocations_per_frame;  // Every transient allocation, thread chunk or shared
+    F64 transient_bytes_per_frame;        // Arena space used, thread chunks count in full as soon as they are carved
+    F64 permanent_bytes_per_frame;
+};
+
+// Returns false if the scenario does not exist or the report could not be written
+BOOL bench_run(C8 const *scenario_name, U32 frame_count);
+C8 const *bench_phase_to_cstr(BenchPhase phase);
@@ -0,0 +1,255 @@
+#include "command.hpp"
+#include "entity.hpp"
+#include "job.hpp"
+#include "log.hpp"
+#include "memory.hpp"
+#include "world.hpp"
+
+#include <stdlib.h>
+
+CommandState static i_command = {};
+
+void static i_buffer_init(CommandThreadBuffer *buffer, U32 capacity, U64 key) {
+    buffer->commands = mmpa(Command *, sizeof(Command) * capacity);
+    buffer->count    = 0;
+    buffer->capacity = capacity;
+    buffer->key      = key;
+    buffer->sequence = 0;
+}
+
+U64 static i_unkeyed_key(U32 thread_index) {
+    return COMMAND_KEY(COMMAND_SOURCE_UNKEYED, thread_index);
+}
+
+S32 static i_compare_commands(void const *a, void const *b) {
+    Command const *x = *(Command const **)a;
+    Command const *y = *(Command const **)b;
+    if (x->key != y->key)           { return x->key < y->key ? -1 : 1; }
+    if (x->phase != y->phase)       { return x->phase < y->phase ? -1 : 1; }
+    if (x->sequence != y->sequence) { return x->sequence < y->sequence ? -1 : 1; }
+
+    // qsort is not stable, fall back to where the command sits in the merge (thread buffer, then push order)
+    return ((uintptr_t)x > (uintptr_t)y) - ((uintptr_t)x < (uintptr_t)y);
+}
+
+void static i_execute(Command const *cmd) {
+    switch (cmd->type) {
+        case COMMAND_TYPE_PARTICLES_3D: {
+            particles3d_execute_command(&cmd->particles_3d);
+        } break;
+
+        case COMMAND_TYPE_AUDIO: {
+            audio_execute_command(&cmd->audio);
+        } break;
+
+        case COMMAND_TYPE_ENTITY_SPAWN: {
+            entity_spawn_execute_command(&cmd->entity_spawn);
+        } break;
+
+        case COMMAND_TYPE_ENTITY_SCALE: {
+            // The entity might have been destroyed since, the generation tells us if the slot got reused
+            CommandEntityScale const *scale = &cmd->entity_scale;
+            if (!entity_is_valid(scale->id))                          { break; }
+            if (g_world->generation[scale->id] != scale->generation) { break; }
+            entity_set_scale(scale->id, scale->scale);
+        } break;
+
+        case COMMAND_TYPE_HEALTHBAR: {
+            render_healthbar_add(cmd->healthbar.screen_pos, cmd->healthbar.bar_size, cmd->healthbar.health_perc);
+        } break;
+
+        default: {
+            llw("Unknown command type: %d", cmd->type);
+        } break;
+    }
+}
+
+void command_init() {
+    i_command.thread_count = job_system_get_thread_count();
+    i_command.threads      = mcpa(CommandThreadBuffer *, i_command.thread_count, sizeof(CommandThreadBuffer));
+    for (U32 i = 0; i < i_command.thread_count; ++i) { i_buffer_init(&i_command.threads[i], COMMAND_BUFFER_CAPACITY, i_unkeyed_key(i)); }
+
+    i_buffer_init(&i_command.foreign, COMMAND_BUFFER_FOREIGN_CAPACITY, COMMAND_KEY(COMMAND_SOURCE_FOREIGN, 0));
+    mtx_init(&i_command.foreign_mutex, mtx_plain);
+
+    i_command.dropped_count = 0;
+    i_command.initialized   = true;
+    lli("Command buffers initialized (%u threads, %d commands each, %zu bytes per command)", i_command.thread_count, COMMAND_BUFFER_CAPACITY, sizeof(Command));
+}
+
+void command_begin(CommandSource source, U32 item) {
+    U32 const thread_index = job_system_get_thread_index();
+    if (thread_index >= i_command.thread_count) { return; }  // Foreign threads are always ordered by arrival
+
+    CommandThreadBuffer *buffer = &i_command.threads[thread_index];
+    buffer->key                 = COMMAND_KEY(source, item);
+    buffer->sequence            = 0;
+}
+
+void command_next_phase() {
+    i_command.phase++;
+}
+
+void command_end() {
+    U32 const thread_index = job_system_get_thread_index();
+    if (thread_index >= i_command.thread_count) { return; }
+
+    CommandThreadBuffer *buffer = &i_command.threads[thread_index];
+    buffer->key                 = i_unkeyed_key(thread_index);
+    buffer->sequence            = 0;
+}
+
+BOOL command_push(Command const *cmd) {
+    if (!i_command.initialized) {
+        llt("Command buffers not initialized, dropping command");
+        return false;
+    }
+
+    U32 const thread_index      = job_system_get_thread_index();
+    BOOL const foreign          = thread_index >= i_command.thread_count;
+    CommandThreadBuffer *buffer = foreign ? &i_command.foreign : &i_command.threads[thread_index];
+
+    if (foreign) { mtx_lock(&i_command.foreign_mutex); }
+    BOOL const fits = buffer->count < buffer->capacity;
+    if (fits) {
+        Command *slot  = &buffer->commands[buffer->count++];
+        *slot          = *cmd;
+        slot->key      = buffer->key;
+        slot->phase    = i_command.phase;
+        slot->sequence = buffer->sequence++;
+    }
+    if (foreign) { mtx_unlock(&i_command.foreign_mutex); }
+
+    if (!fits) {
+        i_command.dropped_count.fetch_add(1, std::memory_order_relaxed);
+        llt("Command buffer full, dropping command");
+    }
+    return fits;
+}
+
+// Only the first counts[i] commands of every buffer, anything pushed later waits for the next merge
+Command const static **i_merge(U32 const *counts, U32 foreign_count, SZ *out_count) {
+    SZ total = foreign_count;
+    for (U32 i = 0; i < i_command.thread_count; ++i) { total += counts[i]; }
+
+    *out_count = 0;
+    if (total == 0) { return nullptr; }
+
+    auto *sorted = mmta(Command const **, sizeof(Command const *) * total);
+    SZ count     = 0;
+    for (U32 i = 0; i < i_command.thread_count; ++i) {
+        for (U32 j = 0; j < counts[i]; ++j) { sorted[count++] = &i_command.threads[i].commands[j]; }
+    }
+    for (U32 j = 0; j < foreign_count; ++j) { sorted[count++] = &i_command.foreign.commands[j]; }
+
+    if (count > 1) { qsort((void *)sorted, count, sizeof(Command const *), i_compare_commands); }
+
+    *out_count = count;
+    return sorted;
+}
+
+U32 static i_snapshot(U32 *counts) {
+    for (U32 i = 0; i < i_command.thread_count; ++i) { counts[i] = i_command.threads[i].count; }
+
+    mtx_lock(&i_command.foreign_mutex);
+    U32 const foreign_count = i_command.foreign.count;
+    mtx_unlock(&i_command.foreign_mutex);
+    return foreign_count;
+}
+
+Command const **command_merge(SZ *out_count) {
+    *out_count = 0;
+    if (!i_command.initialized) { return nullptr; }
+
+    auto *counts            = mmta(U32 *, sizeof(U32) * i_command.thread_count);
+    U32 const foreign_count = i_snapshot(counts);
+    return i_merge(counts, foreign_count, out_count);
+}
+
+void command_clear() {
+    for (U32 i = 0; i < i_command.thread_count; ++i) {
+        i_command.threads[i].count    = 0;
+        i_command.threads[i].key      = i_unkeyed_key(i);
+        i_command.threads[i].sequence = 0;
+    }
+
+    mtx_lock(&i_command.foreign_mutex);
+    i_command.foreign.count    = 0;
+    i_command.foreign.sequence = 0;
+    mtx_unlock(&i_command.foreign_mutex);
+
+    i_command.phase = 0;
+}
+
+// Drops the first count commands and moves whatever got pushed after them to the front
+void static i_buffer_consume(CommandThreadBuffer *buffer, U32 count) {
+    U32 const remaining = buffer->count - count;
+    if (remaining > 0) { ou_memmove(&buffer->commands[0], &buffer->commands[count], remaining * sizeof(Command)); }
+    buffer->count = remaining;
+}
+
+// Drops the commands of one source out of the first count and closes the gaps, the rest keeps its push order
+void static i_buffer_consume_source(CommandThreadBuffer *buffer, U32 count, CommandSource source) {
+    U32 kept = 0;
+    for (U32 i = 0; i < count; ++i) {
+        if (COMMAND_KEY_SOURCE(buffer->commands[i].key) == source) { continue; }
+        buffer->commands[kept++] = buffer->commands[i];
+    }
+
+    U32 const remaining = buffer->count - count;
+    if (remaining > 0 && kept != count) { ou_memmove(&buffer->commands[kept], &buffer->commands[count], remaining * sizeof(Command)); }
+    buffer->count = kept + remaining;
+}
+
+void command_flush() {
+    if (!i_command.initialized) { return; }
+
+    // Executing may queue new commands (e.g. a spawn playing a sound), those wait for the next flush
+    auto *counts            = mmta(U32 *, sizeof(U32) * i_command.thread_count);
+    U32 const foreign_count = i_snapshot(counts);
+
+    SZ count               = 0;
+    Command const **sorted = i_merge(counts, foreign_count, &count);
+    for (SZ i = 0; i < count; ++i) { i_execute(sorted[i]); }
+
+    BOOL empty = true;
+    for (U32 i = 0; i < i_command.thread_count; ++i) {
+        CommandThreadBuffer *buffer = &i_command.threads[i];
+        i_buffer_consume(buffer, counts[i]);
+        buffer->key = i_unkeyed_key(i);  // A job that forgot command_end() must not leak its key into the next frame
+        if (buffer->count == 0) { buffer->sequence = 0; }
+        empty &= buffer->count == 0;
+    }
+
+    mtx_lock(&i_command.foreign_mutex);
+    i_buffer_consume(&i_command.foreign, foreign_count);
+    empty &= i_command.foreign.count == 0;
+    mtx_unlock(&i_command.foreign_mutex);
+
+    // Commands queued while executing keep their phase, the count only starts over once nothing is left behind
+    if (empty) { i_command.phase = 0; }
+}
+
+void command_flush_source(CommandSource source) {
+    if (!i_command.initialized) { return; }
+
+    auto *counts            = mmta(U32 *, sizeof(U32) * i_command.thread_count);
+    U32 const foreign_count = i_snapshot(counts);
+
+    // The merge is sorted by key and the source sits in its top bits, so ours are one contiguous run
+    SZ count               = 0;
+    Command const **sorted = i_merge(counts, foreign_count, &count);
+    for (SZ i = 0; i < count; ++i) {
+        if (COMMAND_KEY_SOURCE(sorted[i]->key) == source) { i_execute(sorted[i]); }
+    }
+
+    for (U32 i = 0; i < i_command.thread_count; ++i) { i_buffer_consume_source(&i_command.threads[i], counts[i], source); }
+
+    mtx_lock(&i_command.foreign_mutex);
+    i_buffer_consume_source(&i_command.foreign, foreign_count, source);
+    mtx_unlock(&i_command.foreign_mutex);
+}
+
+U64 command_get_dropped_count() {
+    return i_command.dropped_count.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "audio.hpp"
+#include "common.hpp"
+#include "entity_spawn.hpp"
+#include "particles_3d.hpp"
+#include "render_healthbar.hpp"
+
+#include <atomic>
+#include <tinycthread.h>
+
+// Need for tinycthread on macOS
+#ifdef call_once
+#undef call_once
+#endif
+
+// Deferred side effects (particles, sounds, spawns, healthbars, ...) that jobs record and the main thread applies.
+// Every thread of the job system appends to its own buffer without locking, threads outside of it share one buffer
+// behind a mutex. At a sync point command_flush() merges all buffers, sorts them by (key, phase, sequence) and executes
+// them, so the order never depends on which worker ended up running what and replays stay reproducible.
+// Jobs pick the key with command_begin(), usually the entity they are working on, and reset it with command_end().
+// The same key can get recorded again in a later pass of the frame, the main thread separates those passes with
+// command_next_phase() so their sequences do not collide.
+
+#define COMMAND_BUFFER_CAPACITY 8192          // Per job system thread
+#define COMMAND_BUFFER_FOREIGN_CAPACITY 1024  // Shared by all threads outside of the job system
+#define COMMAND_KEY(source, item) (((U64)(source) << 32) | (U64)(item))
+#define COMMAND_KEY_SOURCE(key) ((CommandSource)((key) >> 32))
+
+// Sort order of the merge, everything of one source runs before the next one
+enum CommandSource : U8 {
+    COMMAND_SOURCE_UNKEYED,    // No command_begin, item is the thread index
+    COMMAND_SOURCE_ACTOR,      // Item is the entity
+    COMMAND_SOURCE_BUILDING,   // Item is the entity
+    COMMAND_SOURCE_HEALTHBAR,  // Item is the index into the selection
+    COMMAND_SOURCE_FOREIGN,    // Threads outside the job system, in arrival order
+    COMMAND_SOURCE_COUNT,
+};
+
+enum CommandType : U8 {
+    COMMAND_TYPE_PARTICLES_3D,
+    COMMAND_TYPE_AUDIO,
+    COMMAND_TYPE_ENTITY_SPAWN,
+    COMMAND_TYPE_ENTITY_SCALE,
+    COMMAND_TYPE_HEALTHBAR,
+    COMMAND_TYPE_COUNT,
+};
+
+struct CommandEntityScale {
+    EID id;
+    U32 generation;  // Skipped if the entity got destroyed or its slot reused in the meantime
+    Vector3 scale;
+};
+
+struct CommandHealthbar {
+    Vector2 screen_pos;
+    Vector2 bar_size;
+    F32 health_perc;
+};
+
+struct Command {
+    U64 key;       // COMMAND_KEY(source, item)
+    U32 phase;     // Order within one key, command_next_phase() calls since the buffers were last empty
+    U32 sequence;  // Order within one key and phase
+    CommandType type;
+    union {
+        Particle3DCommand particles_3d;
+        AudioCommand audio;
+        EntitySpawnCommand entity_spawn;
+        CommandEntityScale entity_scale;
+        CommandHealthbar healthbar;
+    };
+};
+
+struct alignas(64) CommandThreadBuffer {
+    Command *commands;
+    U32 count;
+    U32 capacity;
+    U64 key;
+    U32 sequence;
+};
+
+struct CommandState {
+    BOOL initialized;
+    CommandThreadBuffer *threads;  // job_system_get_thread_count() entries
+    U32 thread_count;
+    CommandThreadBuffer foreign;
+    mtx_t foreign_mutex;
+    U32 phase;
+    std::atomic<U64> dropped_count;
+};
+
+void command_init();
+// Every following push of the calling thread is ordered by this key until the next begin or end
+void command_begin(CommandSource source, U32 item);
+void command_end();
+// Main thread only while no job records, everything pushed from now on sorts after what got pushed before with the same key
+void command_next_phase();
+// Copies the command, key and sequence get filled in from the calling thread. False when the buffer is full.
+BOOL command_push(Command const *cmd);
+// Main thread only, all commands recorded so far in execution order. The array lives in the transient arena.
+Command const **command_merge(SZ *out_count);
+void command_clear();
+// Main thread only, merge, execute and clear
+void command_flush();
+// Main thread only, like command_flush() but only for one source, everything else stays queued in its order
+void command_flush_source(CommandSource source);
+U64 command_get_dropped_count();
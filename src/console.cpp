@@ -62,6 +62,7 @@ con_cmd_decl(teleport);
 con_cmd_decl(test);
 con_cmd_decl(rebuild_blob);
 con_cmd_decl(history);
+con_cmd_decl(profiler_capture);
 
 enum ConCMDType : U8 {
     CON_CMD_TYPE_CVARS,
@@ -88,6 +89,7 @@ enum ConCMDType : U8 {
     CON_CMD_TYPE_TEST,
     CON_CMD_TYPE_REBUILD_BLOB,
     CON_CMD_TYPE_HISTORY,
+    CON_CMD_TYPE_PROFILER_CAPTURE,
     CON_CMD_TYPE_COUNT,
 };
 
@@ -126,6 +128,7 @@ struct ConCMD {
     { "test",                 "Runs all tests n times",                                          "test {count}",                            CON_CMD_TYPE_TEST,          con_cmd_test          },
     { "rebuild_blob",         "Force recreation of the asset blob file",                         "rebuild_blob",                            CON_CMD_TYPE_REBUILD_BLOB,  con_cmd_rebuild_blob  },
     { "history",              "Shows command history",                                           "history",                                 CON_CMD_TYPE_HISTORY,       con_cmd_history       },
+    { "profiler_capture",     "Records all threads for n frames into a Chrome trace",            "profiler_capture {frames}",               CON_CMD_TYPE_PROFILER_CAPTURE, con_cmd_profiler_capture },
 };
 
 void static i_print_help_for_cmd(ConCMD *cmd) {
@@ -167,29 +170,18 @@ struct IConsoleColorPair {
 };
 
 void static i_list_cvars() {
-    // Create header and entry format strings
-    C8 header_format[256];
-    C8 entry_format[256];
-    C8 divider_format[256];
-
-    // Header with clean, professional formatting
-    ou_snprintf(header_format, sizeof(header_format),
-                "\\ouc{#ff3300ff}%%-%ds \\ouc{#ff3300ff}%%-%ds   \\ouc{#ff3300ff}%%-%ds    \\ouc{#ff3300ff}%%s",
-                CVAR_LONGEST_NAME_LENGTH, CVAR_LONGEST_VALUE_LENGTH, CVAR_LONGEST_TYPE_LENGTH);
-
-    // Entry format with delimiters and comment support
-    ou_snprintf(entry_format, sizeof(entry_format),
-                "\\ouc{#ffcc00ff}%%-%ds \\ouc{#aaaaffff}%%-%ds   \\ouc{#ffaaaaff}%%-%ds    \\ouc{#00ff00ff}%%s",
-                CVAR_LONGEST_NAME_LENGTH, CVAR_LONGEST_VALUE_LENGTH, CVAR_LONGEST_TYPE_LENGTH);
-
-    // Simple divider
-    ou_snprintf(divider_format, sizeof(divider_format), "\\ouc{#ff3300ff}%%s");
+    // The log formats later on its own thread and only keeps the pointer, so the formats have to be literals
+    // and the column widths go in as arguments.
+    S32 const name_width  = CVAR_LONGEST_NAME_LENGTH;
+    S32 const value_width = CVAR_LONGEST_VALUE_LENGTH;
+    S32 const type_width  = CVAR_LONGEST_TYPE_LENGTH;
 
     // Print header
     lln("Available CVars (%d):", CVAR_COUNT);
 
     // Print column headers
-    lln(header_format, "NAME", "VALUE", "TYPE", "COMMENT");
+    lln("\\ouc{#ff3300ff}%-*s \\ouc{#ff3300ff}%-*s   \\ouc{#ff3300ff}%-*s    \\ouc{#ff3300ff}%s", name_width, "NAME", value_width, "VALUE", type_width,
+        "TYPE", "COMMENT");
 
     // List all CVars with their current values and types (using sorted indices)
     for (const auto &cvar : cvar_meta_table) {
@@ -219,7 +211,8 @@ void static i_list_cvars() {
             }
         }
 
-        lln(entry_format, cvar.name, value_str, type_str, cvar.comment[0] != '\0' ? cvar.comment : "");
+        lln("\\ouc{#ffcc00ff}%-*s \\ouc{#aaaaffff}%-*s   \\ouc{#ffaaaaff}%-*s    \\ouc{#00ff00ff}%s", name_width, cvar.name, value_width, value_str,
+            type_width, type_str, cvar.comment[0] != '\0' ? cvar.comment : "");
     }
 }
 
@@ -364,7 +357,7 @@ void static i_print_header(AHeader *header) {
     lln("%s:", header->name);
     lln("  Path: %s", header->path);
     lln("  Hash: 0x%08X", header->name_hash);
-    lln("  Last Access: %s", ctime(&header->last_access));
+    lln("  Last Access: %" PRIu64 " frames ago", asset_get_frame() - header->last_access_frame);
     lln("  Last Modified: %s", ctime(&header->last_modified));
 
     switch (header->type) {
@@ -1210,6 +1203,27 @@ BOOL con_cmd_history(ConCMD const *cmd) {
     return true;
 }
 
+BOOL con_cmd_profiler_capture(ConCMD const *cmd) {
+    // If it is not specified, we default to one second at 60 fps.
+    U32 frames     = 60;
+    C8 *frames_str = cmd->args[0];
+    if (frames_str) {
+        if (ou_sscanf(frames_str, "%u", &frames) != 1 || frames == 0) {
+            llw("Could not parse frames as a positive U32: %s", frames_str);
+            return false;
+        }
+    }
+
+#if !defined(OURO_PROFILE)
+    llw("Without OURO_PROFILE the capture only contains the main loop track");
+#endif
+
+    if (!profiler_capture(frames)) { return false; }
+    lln("Capturing the next %u frames into " PROFILER_CAPTURE_FOLDER "/", frames);
+
+    return true;
+}
+
 SZ static i_get_visible_line_count() {
     Vector2 const res   = render_get_render_resolution();
     F32 const font_size = (F32)c_console__font_size;
@@ -1254,7 +1268,7 @@ void static i_load_history_from_file() {
 void console_init() {
     g_console.scrollbar = asset_get_texture("cursor_re_vertical.png");
 
-    ring_init(MEMORY_TYPE_ARENA_DEBUG, &g_console.output_buffer, 1000);
+    ring_init(MEMORY_TYPE_ARENA_DEBUG, &g_console.output_buffer, CON_OUTPUT_BUFFER_CAPACITY);
     ring_init(MEMORY_TYPE_ARENA_DEBUG, &g_console.cmd_history_buffer, 1000);
 
     g_console.visible_line_count = i_get_visible_line_count();
@@ -2229,14 +2243,16 @@ BOOL console_autocomplete_input_buffer() {
 
 void console_print_to_output(C8 const *message) {
     if (!g_console.initialized) { return; }
-    // Duplicate the message on the heap since the callee will free it.
-    C8 const *message_copy = ou_strdup(message, MEMORY_TYPE_ARENA_DEBUG);
-    if (message_copy == nullptr) { return; }
-    ring_push(&g_console.output_buffer, message_copy);
+    // The ring's tail is the slot that gets written next, so the line it held before is the one being evicted
+    C8 *line = g_console.output_lines[g_console.output_buffer.tail];
+    ou_strncpy(line, message, CON_OUTPUT_LINE_MAX_LENGTH - 1);
+    line[CON_OUTPUT_LINE_MAX_LENGTH - 1] = '\0';
+    ring_push(&g_console.output_buffer, line);
 }
 
 void console_draw_separator() {
-    ring_push(&g_console.output_buffer, ou_strdup("----", MEMORY_TYPE_ARENA_DEBUG));
+    // Goes through the logger so it lands after the lines that are still in flight
+    lln("----");
 }
 
 void console_clear() {
@@ -6,6 +6,7 @@
 #define CON_IN_BUF_MAX 1024
 #define CON_CMD_ARGS_MAX 5
 #define CON_OUTPUT_BUFFER_CAPACITY 1000
+#define CON_OUTPUT_LINE_MAX_LENGTH 1024  // Longer lines get cut
 #define CON_CMD_HISTORY_CAPACITY 1000
 
 #define CONSOLE_FONT "GoMono"
@@ -24,7 +25,8 @@ struct Console {
     SZ vertical_history_offset;
     CstrRing cmd_history_buffer;
     SZ cmd_history_cursor;
-    CstrRing output_buffer;
+    CstrRing output_buffer;  // Points into output_lines, slots are reused once the ring wraps
+    C8 output_lines[CON_OUTPUT_BUFFER_CAPACITY][CON_OUTPUT_LINE_MAX_LENGTH];
     C8 input_buffer[CON_IN_BUF_MAX];
     C8 prediction_buffer[CON_IN_BUF_MAX];
     SZ input_buffer_cursor;
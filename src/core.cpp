@@ -1,11 +1,12 @@
 #include "core.hpp"
 #include "arg.hpp"
 #include "asset.hpp"
+#include "bench.hpp"
 #include "color.hpp"
+#include "command.hpp"
 #include "console.hpp"
 #include "cvar.hpp"
 #include "debug.hpp"
-#include "entity_spawn.hpp"
 #include "input.hpp"
 #include "log.hpp"
 #include "math.hpp"
@@ -62,13 +63,18 @@ void core_init(U8 major, U8 minor, U8 patch, C8 const *build_type) {
     // Load cvars from config file before using any cvar values
     cvar_load();
 
+    // The asset pipeline uploads meshes and textures while loading, so benchmarks still need a GL context. They get a hidden
+    // window that is never drawn to or presented.
+    BOOL const bench = args_get_string("Bench")[0] != '\0';
+
     U32 flags = FLAG_WINDOW_RESIZABLE;
 #ifdef __APPLE__
-    flags |= FLAG_WINDOW_HIGHDPI | FLAG_FULLSCREEN_MODE;
+    if (!bench) { flags |= FLAG_WINDOW_HIGHDPI | FLAG_FULLSCREEN_MODE; }
 #endif
-    if (c_video__vsync) { flags |= FLAG_VSYNC_HINT; }
+    if (bench) { flags |= FLAG_WINDOW_HIDDEN; }
+    if (c_video__vsync && !bench) { flags |= FLAG_VSYNC_HINT; }
     SetConfigFlags(flags);
-    SetTargetFPS(c_video__fps_max);
+    SetTargetFPS(bench ? 0 : c_video__fps_max);
 
     // When the arguments claim that we are in a debugger build
     // (not to be confused with a debug build), we will set the
@@ -102,7 +108,9 @@ void core_init(U8 major, U8 minor, U8 patch, C8 const *build_type) {
     LD_TRACK(&g_core.loading, "Initializing \\ouc{#b3ffb3ff}Asset Manager", asset_init());
     LD_TRACK(&g_core.loading, "Initializing \\ouc{#b3ffb3ff}World",         world_init());
     LD_TRACK(&g_core.loading, "Initializing \\ouc{#b3ffb3ff}Scenes",        scenes_init());
-    LD_TRACK(&g_core.loading, TS("Entering \\ouc{#b3ffb3ff}Scene: \\ouc{#9db4c0ff}%s", scenes_to_str(start_scene)->c)->c, scenes_set_scene(start_scene));
+    if (!bench) {  // The benchmark sets up its own scenario once the RNG got seeded
+        LD_TRACK(&g_core.loading, TS("Entering \\ouc{#b3ffb3ff}Scene: \\ouc{#9db4c0ff}%s", scenes_to_str(start_scene)->c)->c, scenes_set_scene(start_scene));
+    }
 
     if (g_options.fresh_install) { option_set_optimal_settings(); };
 
@@ -131,6 +139,7 @@ void core_quit() {
     i_exit_if_not_initialized();
 
     dbg_quit();
+    world_recorder_quit();
     CloseWindow();
     audio_quit();
     asset_quit();
@@ -153,6 +162,14 @@ void core_run() {
         return;
     }
 
+    C8 const *bench_scenario = args_get_string("Bench");
+    if (bench_scenario[0] != '\0') {
+        S32 const frames = args_get_s32("BenchFrames");
+        if (!bench_run(bench_scenario, frames > 0 ? (U32)frames : 0)) { core_error_quit(); }
+        lli("Exiting after benchmark.");
+        return;
+    }
+
     while (g_core.running) {
         if (WindowShouldClose()) { g_core.running = false; }
         ML_PROFILE(core_loop());
@@ -172,6 +189,7 @@ void core_update() {
 
     PP(time_update(dt, dtu));
     PP(profiler_update());
+    PP(llog_update());
     PP(option_update());
     PP(input_update());
     PP(asset_update());
@@ -182,10 +200,8 @@ void core_update() {
     PP(particles3d_update(dt));
     PP(math_update());
     PP(scenes_update(dt, dtu));
-    PP(particles3d_process_command_queue());
+    PP(command_flush());
     PP(particles2d_process_command_queue());
-    PP(entity_spawn_process_command_queue());
-    PP(audio_process_command_queue());
     PP(messages_update(dtu));
     PP(dbg_update());
 }
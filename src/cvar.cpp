@@ -23,6 +23,8 @@ F32     c_audio__pitch_music                     = 1.00000000F;
 F32     c_audio__pitch_sfx                       = 1.00000000F;
 F32     c_audio__pitch_voice                     = 1.00000000F;
 F32     c_audio__rolloff_scale                   = 1.00000000F;
+S32     c_audio__voice_real_max                  = 64;
+S32     c_audio__voice_sound_limit               = 8;
 F32     c_audio__volume_ambience                 = 0.00000000F;
 F32     c_audio__volume_music                    = 0.00000000F;
 F32     c_audio__volume_sfx                      = 0.50000000F;
@@ -72,6 +74,7 @@ F32     c_render__dungeon_fog_density            = 0.03300000F;
 BOOL    c_render__fboy                           = false;
 BOOL    c_render__hud                            = true;
 F32     c_render__overworld_fog_density          = 0.00050000F;
+BOOL    c_render__particles3d_cpu                = false;
 BOOL    c_render__sketch                         = true;
 BOOL    c_render__skybox                         = true;
 BOOL    c_render__skybox_night                   = true;
@@ -85,6 +88,8 @@ S32     c_video__window_resolution_height        = 2160;
 S32     c_video__window_resolution_width         = 3840;
 BOOL    c_world__actor_healthbar                 = true;
 BOOL    c_world__actor_info                      = false;
+S32     c_world__bone_cache_budget_mb            = 64;
+F32     c_world__path_budget_ms                  = 2.00000000F;
 BOOL    c_world__verbose_actors                  = false;
 
 CVarMeta const cvar_meta_table[CVAR_COUNT] = {
@@ -101,6 +106,8 @@ CVarMeta const cvar_meta_table[CVAR_COUNT] = {
     {"audio__pitch_sfx",                        &c_audio__pitch_sfx,                        CVAR_TYPE_F32,      ""},
     {"audio__pitch_voice",                      &c_audio__pitch_voice,                      CVAR_TYPE_F32,      ""},
     {"audio__rolloff_scale",                    &c_audio__rolloff_scale,                    CVAR_TYPE_F32,      ""},
+    {"audio__voice_real_max",                   &c_audio__voice_real_max,                   CVAR_TYPE_S32,      ""},
+    {"audio__voice_sound_limit",                &c_audio__voice_sound_limit,                CVAR_TYPE_S32,      ""},
     {"audio__volume_ambience",                  &c_audio__volume_ambience,                  CVAR_TYPE_F32,      ""},
     {"audio__volume_music",                     &c_audio__volume_music,                     CVAR_TYPE_F32,      ""},
     {"audio__volume_sfx",                       &c_audio__volume_sfx,                       CVAR_TYPE_F32,      ""},
@@ -150,6 +157,7 @@ CVarMeta const cvar_meta_table[CVAR_COUNT] = {
     {"render__fboy",                            &c_render__fboy,                            CVAR_TYPE_BOOL,     ""},
     {"render__hud",                             &c_render__hud,                             CVAR_TYPE_BOOL,     ""},
     {"render__overworld_fog_density",           &c_render__overworld_fog_density,           CVAR_TYPE_F32,      ""},
+    {"render__particles3d_cpu",                 &c_render__particles3d_cpu,                 CVAR_TYPE_BOOL,     ""},
     {"render__sketch",                          &c_render__sketch,                          CVAR_TYPE_BOOL,     ""},
     {"render__skybox",                          &c_render__skybox,                          CVAR_TYPE_BOOL,     ""},
     {"render__skybox_night",                    &c_render__skybox_night,                    CVAR_TYPE_BOOL,     ""},
@@ -163,6 +171,8 @@ CVarMeta const cvar_meta_table[CVAR_COUNT] = {
     {"video__window_resolution_width",          &c_video__window_resolution_width,          CVAR_TYPE_S32,      ""},
     {"world__actor_healthbar",                  &c_world__actor_healthbar,                  CVAR_TYPE_BOOL,     ""},
     {"world__actor_info",                       &c_world__actor_info,                       CVAR_TYPE_BOOL,     ""},
+    {"world__bone_cache_budget_mb",             &c_world__bone_cache_budget_mb,             CVAR_TYPE_S32,      ""},
+    {"world__path_budget_ms",                   &c_world__path_budget_ms,                   CVAR_TYPE_F32,      ""},
     {"world__verbose_actors",                   &c_world__verbose_actors,                   CVAR_TYPE_BOOL,     ""}
 };
 
@@ -4,7 +4,7 @@
 
 // WARN: DO NOT EDIT - THIS IS A GENERATED FILE!
 
-#define CVAR_COUNT 76
+#define CVAR_COUNT 81
 #define CVAR_FILE_NAME "ouro.cvar"
 #define CVAR_NAME_MAX_LENGTH 128
 #define CVAR_STR_MAX_LENGTH 128
@@ -44,6 +44,8 @@ extern F32     c_audio__pitch_music;
 extern F32     c_audio__pitch_sfx;
 extern F32     c_audio__pitch_voice;
 extern F32     c_audio__rolloff_scale;
+extern S32     c_audio__voice_real_max;
+extern S32     c_audio__voice_sound_limit;
 extern F32     c_audio__volume_ambience;
 extern F32     c_audio__volume_music;
 extern F32     c_audio__volume_sfx;
@@ -93,6 +95,7 @@ extern F32     c_render__dungeon_fog_density;
 extern BOOL    c_render__fboy;
 extern BOOL    c_render__hud;
 extern F32     c_render__overworld_fog_density;
+extern BOOL    c_render__particles3d_cpu;
 extern BOOL    c_render__sketch;
 extern BOOL    c_render__skybox;
 extern BOOL    c_render__skybox_night;
@@ -106,6 +109,8 @@ extern S32     c_video__window_resolution_height;
 extern S32     c_video__window_resolution_width;
 extern BOOL    c_world__actor_healthbar;
 extern BOOL    c_world__actor_info;
+extern S32     c_world__bone_cache_budget_mb;
+extern F32     c_world__path_budget_ms;
 extern BOOL    c_world__verbose_actors;
 
 extern const CVarMeta cvar_meta_table[CVAR_COUNT];
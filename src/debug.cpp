@@ -178,6 +178,21 @@ void static i_setup_arena_info(C8 const *title, MemoryType type, ArenaStats *sta
 
     F32 const max = type == MEMORY_TYPE_ARENA_DEBUG ? DBG_ARENA_ALLOCATIONS_TILL_RESET : 100000.0F;
     dwitl(LIME, NEARBLACK, tl->total_allocations_count, ARENA_TIMELINE_MAX_COUNT, 0.00F, max, "%.0f %s", "allocs");
+
+    // Only arenas that get reset every frame have anything interesting to say here.
+    if (stats->reset_count == 0) { return; }
+
+    C8 pretty_buffer_3[PRETTY_BUFFER_SIZE] = {};
+    unit_to_pretty_prefix_binary_u("B", stats->reset_bytes, pretty_buffer_1, PRETTY_BUFFER_SIZE, UNIT_PREFIX_BINARY_MEBI);
+    unit_to_pretty_prefix_binary_u("B", stats->resident_bytes, pretty_buffer_2, PRETTY_BUFFER_SIZE, UNIT_PREFIX_BINARY_MEBI);
+    unit_to_pretty_prefix_binary_u("B", stats->trimmed_bytes, pretty_buffer_3, PRETTY_BUFFER_SIZE, UNIT_PREFIX_BINARY_MEBI);
+
+    dwilo(TS("%8s: \\ouc{%s}%s (%zu arenas)", "Reset", value_color, pretty_buffer_1, stats->reset_count)->c, medium_font, GREEN);
+    dwilo(TS("%8s: \\ouc{%s}%s", "Resident", value_color, pretty_buffer_2)->c, medium_font, GREEN);
+    dwilo(TS("%8s: \\ouc{%s}%s", "Trimmed", value_color, pretty_buffer_3)->c, medium_font, GREEN);
+
+    dwitl(SKYBLUE, NEARBLACK, tl->reset_bytes, ARENA_TIMELINE_MAX_COUNT, 0.00F, (F32)stats->total_capacity, "%.0f %s", "B reset");
+    dwitl(ORANGE, NEARBLACK, tl->resident_bytes, ARENA_TIMELINE_MAX_COUNT, 0.00F, (F32)stats->total_capacity, "%.0f %s", "B resident");
 }
 
 void static i_setup_light_arena_info(C8 const *name, Arena *arena) {
@@ -361,7 +376,7 @@ void static i_setup_dbg_gui() {
         dwis(5.0F);
 
         dwil(TS("3DP (%d)", PARTICLES_3D_MAX)->c, medium_font, NAYBEIGE);
-        dwilo(TS("%zu idx | %zu tex", g_particles3d.write_index, g_particles3d.textures.count)->c, medium_font, DARKGRAY);
+        dwilo(TS("%s | %zu live | %zu tex", g_particles3d.backend == PARTICLE3D_BACKEND_CPU ? "cpu" : "gpu", g_particles3d.live_count, g_particles3d.textures.count)->c, medium_font, DARKGRAY);
         // Reorder 3D ring buffer for chronological display (oldest to newest, left to right)
         F32 static particles3d_ordered[PARTICLES_3D_SPAWN_RATE_HISTORY_SIZE] = {};
         SZ const particles3d_read_index = g_particles3d.spawn_rate_index;
@@ -470,6 +485,20 @@ void static i_setup_dbg_gui() {
 
         dwis(5.0F);
 
+        MathBoneCacheStats const bone_cache = math_get_bone_cache_stats();
+        U64 const bone_cache_lookups        = bone_cache.hits + bone_cache.misses;
+        F32 const bone_cache_hit_rate       = bone_cache_lookups > 0 ? (F32)bone_cache.hits / (F32)bone_cache_lookups * 100.0F : 0.0F;
+        unit_to_pretty_prefix_binary_u("B", bone_cache.budget_bytes, pretty_buffer_2, PRETTY_BUFFER_SIZE, UNIT_PREFIX_BINARY_MEBI);
+
+        dwil("Bone Cache", large_font, contrast_color);
+        qil("Slots", TS("%zu / %zu (%s)", bone_cache.used_slot_count, bone_cache.slot_count, pretty_buffer_2)->c);
+        qil("Hits", TS("%" PRIu64 " (%.1f%%)", bone_cache.hits, bone_cache_hit_rate)->c);
+        qil("Misses", TS("%" PRIu64, bone_cache.misses)->c);
+        qil("Evictions", TS("%" PRIu64, bone_cache.evictions)->c);
+        qil("Skipped Inserts", TS("%" PRIu64, bone_cache.skipped_inserts)->c);
+
+        dwis(5.0F);
+
         SZ const recorder_cursor = world_recorder_get_record_cursor();
         SZ const playback_cursor = world_recorder_get_playback_cursor();
         BOOL const is_recording  = world_recorder_is_recording_state();
@@ -480,15 +509,25 @@ void static i_setup_dbg_gui() {
         dwil("Recorder", large_font, contrast_color);
 
         // Size information
-        SZ const single_state_size   = world_recorder_get_state_size_bytes();
+        SZ const bytes_per_frame     = world_recorder_get_bytes_per_frame();
+        SZ const last_frame_raw      = world_recorder_get_last_frame_raw_bytes();
+        SZ const pending_size        = world_recorder_get_pending_bytes();
         SZ const total_recorded_size = world_recorder_get_total_recorded_size_bytes();
+        F64 const time_per_frame     = world_recorder_get_time_per_frame();
 
-        unit_to_pretty_prefix_binary_u("B", single_state_size, pretty_buffer_2, PRETTY_BUFFER_SIZE, UNIT_PREFIX_BINARY_MEBI);
+        unit_to_pretty_prefix_binary_u("B", bytes_per_frame, pretty_buffer_2, PRETTY_BUFFER_SIZE, UNIT_PREFIX_BINARY_MEBI);
         unit_to_pretty_prefix_binary_u("B", total_recorded_size, pretty_buffer_3, PRETTY_BUFFER_SIZE, UNIT_PREFIX_BINARY_MEBI);
-
-        qil("Single State Size", pretty_buffer_2);
+        qil("Bytes/Frame", pretty_buffer_2);
         qil("Total Recorded Size", pretty_buffer_3);
 
+        unit_to_pretty_prefix_binary_u("B", last_frame_raw, pretty_buffer_2, PRETTY_BUFFER_SIZE, UNIT_PREFIX_BINARY_MEBI);
+        unit_to_pretty_prefix_binary_u("B", pending_size, pretty_buffer_3, PRETTY_BUFFER_SIZE, UNIT_PREFIX_BINARY_MEBI);
+        qil("Last Frame (uncompressed)", pretty_buffer_2);
+        qil("Waiting For Writer", pretty_buffer_3);
+
+        unit_to_pretty_time_f(BASE_TO_NANO(time_per_frame), pretty_buffer_2, PRETTY_BUFFER_SIZE, UNIT_TIME_SECONDS);
+        qil("Time/Frame", pretty_buffer_2);
+
         dwis(3.0F);
 
         // Controls
@@ -783,10 +822,10 @@ void static i_setup_dbg_gui() {
             ProfilerTrack *sorted_tracks[PROFILER_TRACK_MAX_COUNT];
             SZ sorted_track_count    = 0;
             S32 max_track_char_count = 0;  // Apparently this needs to be an integer for format specifiers.
-            C8 const **label_k       = nullptr;
-            ProfilerTrack *track_v   = nullptr;
-            MAP_EACH_PTR(&g_profiler.track_map, label_k, track_v) {
-                sorted_tracks[sorted_track_count] = track_v;
+            U32 const track_count    = g_profiler.track_count.load(std::memory_order_acquire);
+            for (U32 i = 0; i < track_count; ++i) {
+                if (g_profiler.tracks[i].executions == 0) { continue; }  // Only ever ran off the main thread
+                sorted_tracks[sorted_track_count] = &g_profiler.tracks[i];
                 String *temp = TS("%s", sorted_tracks[sorted_track_count]->label);
                 string_delete_after_first(temp, '(');
                 max_track_char_count = glm::max(max_track_char_count, (S32)ou_strlen(temp->c));
@@ -5,11 +5,15 @@
 #include "asset.hpp"
 #include "common.hpp"
 #include "cvar.hpp"
+#include "entity.hpp"
+#include "job.hpp"
 #include "math.hpp"
 #include "memory.hpp"
+#include "nav.hpp"
 #include "raymath.h"
 #include "render.hpp"
 #include "player.hpp"
+#include "profiler.hpp"
 #include "world.hpp"
 
 #include <raylib.h>
@@ -20,6 +24,11 @@
 #define DUNGEON_FLOOR_THICKNESS 0.1F
 #define FOOTSTEP_DISTANCE_THRESHOLD 4.0F
 #define WALL_BUFFER_DISTANCE 2.0F
+#define DUNGEON_WALL_COLLISION_GRAIN 128
+#define DUNGEON_PVS_SECTOR_TILES 8     // Sectors of 8x8 tiles, about the size of a room
+#define DUNGEON_PVS_BUILD_GRAIN 2      // Source sectors per job
+#define DUNGEON_PVS_SLOPE_EPSILON 1e-9 // Slopes right on a rounding boundary go both ways
+#define DUNGEON_VISIBILITY_GRAIN 4     // Words of 64 entities per job
 
 enum DungeonTileType : U8 {
     DUNGEON_TILE_TYPE_NONE,
@@ -84,28 +93,34 @@ ARRAY_DECLARE(DungeonCollisionWallArray, IDungeonCollisionWall);
 
 struct IDungeonData {
     Vector2 player_position;
+    BOOL has_player_position;
     DungeonTileArray tiles;
     DungeonCollisionWallArray collision_walls;
     Model combined_model;
     OrientedBoundingBox *mesh_bounding_boxes;  // One per mesh for frustum culling
     SZ mesh_bbox_count;
     S32 *wall_grid;     // 2D grid for fast wall lookups (wall index or -1 for no wall)
+    U64 *floor_bits;    // Same grid, one bit per floor tile
     S32 grid_min_x;
     S32 grid_min_z;
     S32 grid_max_x;
     S32 grid_max_z;
     S32 grid_width;
     S32 grid_height;
+    U64 *pvs_bits;      // Potentially visible set, one row of pvs_row_words per sector, one bit per sector it might see
+    S32 pvs_width;      // Sectors per row of the grid
+    S32 pvs_height;
+    S32 pvs_row_words;
 };
 
-IDungeonData static i_parse_dungeon(C8 const* filepath) {
-    IDungeonData data = {};
-    array_init(MEMORY_TYPE_ARENA_PERMANENT, &data.tiles, (SZ)(100 * 100));
-    array_init(MEMORY_TYPE_ARENA_PERMANENT, &data.collision_walls, (SZ)(100 * 100));
+// Tiles, walls and the player start out of the .dun text, nothing in here needs a GPU
+void static i_parse_tiles(IDungeonData *data, C8 const *dun_text, MemoryType memory_type) {
+    array_init(memory_type, &data->tiles, (SZ)(100 * 100));
+    array_init(memory_type, &data->collision_walls, (SZ)(100 * 100));
 
     IDungeonTileData tdata = {};
 
-    C8 *ptr =  LoadFileText(filepath);
+    C8 const *ptr = dun_text;
 
     F32 const tile_size       = DUNGEON_TILE_SIZE;
     Vector3 const wall_dim    = {tile_size, tile_size * DUNGEON_WALL_HEIGHT_MULTIPLIER, tile_size};
@@ -127,14 +142,14 @@ IDungeonData static i_parse_dungeon(C8 const* filepath) {
               tdata.position = {(F32)curr_x * tile_size, 0.0F, (F32)curr_y * tile_size};
               tdata.size     = floor_dim;
               tdata.tint     = DARKBROWN;
-              array_push(&data.tiles, tdata);
+              array_push(&data->tiles, tdata);
 
               // Ceiling
               tdata.type     = type;
               tdata.position = {(F32)curr_x * tile_size, wall_dim.y - ceiling_dim.y, (F32)curr_y * tile_size};
               tdata.size     = ceiling_dim;
               tdata.tint     = BEIGE;
-              array_push(&data.tiles, tdata);
+              array_push(&data->tiles, tdata);
             } break;
 
             case DUNGEON_TILE_TYPE_BASIC_WALL: {
@@ -142,18 +157,18 @@ IDungeonData static i_parse_dungeon(C8 const* filepath) {
               tdata.position = {(F32)curr_x * tile_size, 0.0F, (F32)curr_y * tile_size};
               tdata.size     = wall_dim;
               tdata.tint     = BEIGE;
-              array_push(&data.tiles, tdata);
+              array_push(&data->tiles, tdata);
 
               // Add collision data for this wall
               IDungeonCollisionWall wall = {};
               wall.position              = tdata.position;
               wall.size                  = wall_dim;
-              array_push(&data.collision_walls, wall);
+              array_push(&data->collision_walls, wall);
             } break;
 
             case DUNGEON_TILE_TYPE_PLAYER_POSITION: {
-                data.player_position = {(F32)(curr_x) * DUNGEON_TILE_SIZE, (F32)(curr_y) * DUNGEON_TILE_SIZE};
-                c3d_set_position({data.player_position.x, 0.0F, data.player_position.y}); // TODO: This needs to happen elsewhere later.
+                data->player_position     = {(F32)(curr_x) * DUNGEON_TILE_SIZE, (F32)(curr_y) * DUNGEON_TILE_SIZE};
+                data->has_player_position = true;
             } break;
 
             default: {
@@ -163,385 +178,569 @@ IDungeonData static i_parse_dungeon(C8 const* filepath) {
 
         ptr++;
     }
+}
 
-    // Build spatial grid for fast wall lookups
-    SZ const tile_count = data.tiles.count;
-    if (tile_count > 0) {
-        // Find grid bounds
-        data.grid_min_x = S32_MAX;
-        data.grid_min_z = S32_MAX;
-        data.grid_max_x = S32_MIN;
-        data.grid_max_z = S32_MIN;
-
-        F32 const half_tile = tile_size * 0.5F;
-        for (SZ i = 0; i < tile_count; i++) {
-            // Tiles are centered, offset by half to get grid-aligned coordinates
-            S32 const grid_x = (S32)math_floor_f32((data.tiles.data[i].position.x + half_tile) / tile_size);
-            S32 const grid_z = (S32)math_floor_f32((data.tiles.data[i].position.z + half_tile) / tile_size);
-            data.grid_min_x = glm::min(data.grid_min_x, grid_x);
-            data.grid_min_z = glm::min(data.grid_min_z, grid_z);
-            data.grid_max_x = glm::max(data.grid_max_x, grid_x);
-            data.grid_max_z = glm::max(data.grid_max_z, grid_z);
-        }
+S32 static inline i_tile_coord(F32 world_coord) {
+    // Tiles are centered, offset by half to get grid-aligned coordinates
+    return (S32)math_floor_f32((world_coord + (DUNGEON_TILE_SIZE * 0.5F)) / DUNGEON_TILE_SIZE);
+}
 
-        data.grid_width  = data.grid_max_x - data.grid_min_x + 1;
-        data.grid_height = data.grid_max_z - data.grid_min_z + 1;
+// Spatial grid over the tiles, the wall index and a floor bit per tile is all the collision queries look at
+void static i_build_tile_grid(IDungeonData *data, MemoryType memory_type) {
+    SZ const tile_count = data->tiles.count;
+
+    // Find grid bounds
+    data->grid_min_x = S32_MAX;
+    data->grid_min_z = S32_MAX;
+    data->grid_max_x = S32_MIN;
+    data->grid_max_z = S32_MIN;
+
+    for (SZ i = 0; i < tile_count; i++) {
+        S32 const grid_x = i_tile_coord(data->tiles.data[i].position.x);
+        S32 const grid_z = i_tile_coord(data->tiles.data[i].position.z);
+        data->grid_min_x = glm::min(data->grid_min_x, grid_x);
+        data->grid_min_z = glm::min(data->grid_min_z, grid_z);
+        data->grid_max_x = glm::max(data->grid_max_x, grid_x);
+        data->grid_max_z = glm::max(data->grid_max_z, grid_z);
+    }
 
-        // Allocate and initialize the grid with -1 (no wall)
-        SZ const grid_size = (SZ)data.grid_width * (SZ)data.grid_height;
-        data.wall_grid = mmpa(S32*, grid_size * sizeof(S32));
-        for (SZ i = 0; i < grid_size; i++) {
-            data.wall_grid[i] = -1;
-        }
+    data->grid_width  = data->grid_max_x - data->grid_min_x + 1;
+    data->grid_height = data->grid_max_z - data->grid_min_z + 1;
 
-        // Mark wall cells with their index
-        for (SZ i = 0; i < data.collision_walls.count; i++) {
-            IDungeonCollisionWall const *wall = &data.collision_walls.data[i];
-            // Walls are centered, offset by half to get grid-aligned coordinates
-            S32 const grid_x = (S32)math_floor_f32((wall->position.x + half_tile) / tile_size);
-            S32 const grid_z = (S32)math_floor_f32((wall->position.z + half_tile) / tile_size);
-            S32 const local_x = grid_x - data.grid_min_x;
-            S32 const local_z = grid_z - data.grid_min_z;
-
-            if (local_x >= 0 && local_x < data.grid_width && local_z >= 0 && local_z < data.grid_height) {
-                data.wall_grid[(local_z * data.grid_width) + local_x] = (S32)i;
-            }
+    // Allocate and initialize the grid with -1 (no wall)
+    SZ const grid_size = (SZ)data->grid_width * (SZ)data->grid_height;
+    data->wall_grid    = (S32 *)memory_malloc(grid_size * sizeof(S32), memory_type);
+    data->floor_bits   = (U64 *)memory_calloc((grid_size + 63) / 64, sizeof(U64), memory_type);
+    for (SZ i = 0; i < grid_size; i++) {
+        data->wall_grid[i] = -1;
+    }
+
+    // Mark wall cells with their index
+    for (SZ i = 0; i < data->collision_walls.count; i++) {
+        IDungeonCollisionWall const *wall = &data->collision_walls.data[i];
+        S32 const local_x = i_tile_coord(wall->position.x) - data->grid_min_x;
+        S32 const local_z = i_tile_coord(wall->position.z) - data->grid_min_z;
+
+        if (local_x >= 0 && local_x < data->grid_width && local_z >= 0 && local_z < data->grid_height) {
+            data->wall_grid[(local_z * data->grid_width) + local_x] = (S32)i;
         }
+    }
+
+    // Floor and ceiling share the footprint, one bit covers both
+    for (SZ i = 0; i < tile_count; i++) {
+        IDungeonTileData const *tile = &data->tiles.data[i];
+        if (tile->type != DUNGEON_TILE_TYPE_BASIC_FLOOR) { continue; }
+
+        SZ const cell = (SZ)(((i_tile_coord(tile->position.z) - data->grid_min_z) * data->grid_width) + (i_tile_coord(tile->position.x) - data->grid_min_x));
+        data->floor_bits[cell / 64] |= 1ULL << (cell % 64);
+    }
+}
+
+// Slopes of the walks from one tile that are still open, minor axis steps per major axis step
+struct IDungeonPVSSlopes {
+    F64 lo;
+    F64 hi;
+};
+
+struct IDungeonPVSBuildData {
+    IDungeonData const *data;
+    U64 *rows;
+    IDungeonPVSSlopes *scratch;  // Two buffers of scratch_capacity per thread
+    SZ scratch_capacity;
+};
 
-        // Generate combined model with multiple meshes from all tiles
-        SZ const MAX_TILES_PER_MESH = 300; // Smaller chunks for better frustum culling (face culling fixed for boundaries)
+void static inline i_pvs_set(U64 *rows, S32 row_words, S32 from_sector, S32 to_sector) {
+    rows[((SZ)from_sector * (SZ)row_words) + ((SZ)to_sector / 64)] |= 1ULL << (to_sector % 64);
+}
 
-        // Sort tiles by spatial location to keep adjacent tiles in same mesh
-        // This prevents seams between meshes at tile boundaries
-        for (SZ i = 0; i < tile_count - 1; i++) {
-            for (SZ j = i + 1; j < tile_count; j++) {
-                IDungeonTileData* a = &data.tiles.data[i];
-                IDungeonTileData* b = &data.tiles.data[j];
+BOOL static inline i_pvs_has(U64 const *rows, S32 row_words, S32 from_sector, S32 to_sector) {
+    return (rows[((SZ)from_sector * (SZ)row_words) + ((SZ)to_sector / 64)] >> (to_sector % 64)) & 1;
+}
 
-                // Sort by Z first, then X (row-major order)
-                F32 const a_key = (a->position.z * 1000.0F) + a->position.x;
-                F32 const b_key = (b->position.z * 1000.0F) + b->position.x;
+S32 static inline i_pvs_sector_of_tile(IDungeonData const *data, S32 local_x, S32 local_z) {
+    return ((local_z / DUNGEON_PVS_SECTOR_TILES) * data->pvs_width) + (local_x / DUNGEON_PVS_SECTOR_TILES);
+}
 
-                if (a_key > b_key) {
-                    IDungeonTileData const temp = *a;
-                    *a = *b;
-                    *b = temp;
+// Every tile the occlusion walk (Bresenham from camera tile to entity tile) reaches from one tile, in one octant.
+// Along the major axis the walk to a slope s sits at ceil(step * s - 0.5) on the minor one, so its tiles only depend on
+// the slope. All walks that are still open get carried as merged slope intervals and each step splits them by tile,
+// the same as shadowcasting but exact for the walk the occlusion test does.
+void static i_pvs_scan_octant(IDungeonData const *data, U64 *rows, S32 from_sector, S32 x0, S32 z0, S32 major_x, S32 major_z, S32 minor_x,
+                              S32 minor_z, IDungeonPVSSlopes *current, IDungeonPVSSlopes *next) {
+    F64 const eps    = DUNGEON_PVS_SLOPE_EPSILON;
+    SZ current_count = 1;
+    current[0]       = {0.0, 1.0};
+
+    for (S32 step = 1; current_count > 0; ++step) {
+        SZ next_count = 0;
+
+        for (SZ i = 0; i < current_count; ++i) {
+            S32 const minor_first = (S32)math_ceil_f64(((F64)step * current[i].lo) - 0.5 - eps);
+            S32 const minor_last  = (S32)math_ceil_f64(((F64)step * current[i].hi) - 0.5 + eps);
+
+            for (S32 minor = minor_first; minor <= minor_last; ++minor) {
+                F64 const lo = glm::max(current[i].lo, (((F64)minor - 0.5) / (F64)step) - eps);
+                F64 const hi = glm::min(current[i].hi, (((F64)minor + 0.5) / (F64)step) + eps);
+                if (lo > hi) { continue; }
+
+                S32 const x = x0 + (major_x * step) + (minor_x * minor);
+                S32 const z = z0 + (major_z * step) + (minor_z * minor);
+                if (x < 0 || x >= data->grid_width || z < 0 || z >= data->grid_height) { continue; }
+
+                // The tile itself is seen, whatever is behind a wall is not
+                i_pvs_set(rows, data->pvs_row_words, from_sector, i_pvs_sector_of_tile(data, x, z));
+                if (data->wall_grid[(z * data->grid_width) + x] >= 0) { continue; }
+
+                if (next_count > 0 && next[next_count - 1].hi >= lo) {
+                    next[next_count - 1].hi = glm::max(next[next_count - 1].hi, hi);
+                } else {
+                    next[next_count++] = {lo, hi};
                 }
             }
         }
 
-        SZ const mesh_count = (tile_count + MAX_TILES_PER_MESH - 1) / MAX_TILES_PER_MESH;
-
-        // Initialize model
-        data.combined_model.meshCount     = (S32)mesh_count;
-        data.combined_model.materialCount = 1;
-        data.combined_model.meshes        = mmpa(Mesh*, mesh_count * sizeof(Mesh));
-        data.combined_model.materials     = mmpa(Material*, sizeof(Material));
-        data.combined_model.meshMaterial  = mmpa(S32*, mesh_count * sizeof(S32));
-        data.combined_model.transform     = MatrixIdentity();
-
-        // Use default material with rock texture
-        data.combined_model.materials[0]        = g_render.default_material;
-        data.combined_model.materials[0].shader = asset_get_shader("model")->base;
-
-        // Load and apply rock texture
-        ATexture *texture = asset_get_texture("cracked_mud.jpg");
-        data.combined_model.materials[0].maps[MATERIAL_MAP_DIFFUSE].texture = texture->base;
-
-        for (SZ i = 0; i < mesh_count; i++) { data.combined_model.meshMaterial[i] = 0; }
-
-        // Allocate bounding boxes for frustum culling
-        data.mesh_bounding_boxes = mmpa(OrientedBoundingBox*, mesh_count * sizeof(OrientedBoundingBox));
-        data.mesh_bbox_count = mesh_count;
-
-        // Create each mesh
-        for (SZ mesh_idx = 0; mesh_idx < mesh_count; mesh_idx++) {
-            SZ const start_tile = mesh_idx * MAX_TILES_PER_MESH;
-            SZ const end_tile   = (start_tile + MAX_TILES_PER_MESH < tile_count) ? (start_tile + MAX_TILES_PER_MESH) : tile_count;
-
-            // Pre-count merged shapes to allocate correct memory
-            SZ merged_shape_count = 0;
-            for (SZ tile_idx = start_tile; tile_idx < end_tile; ) {
-                IDungeonTileData* tile = &data.tiles.data[tile_idx];
-                SZ run_end             = tile_idx + 1;
-
-                while (run_end < end_tile) {
-                    IDungeonTileData* next_tile = &data.tiles.data[run_end];
-                    if (next_tile->type == tile->type &&
-                        next_tile->tint.r == tile->tint.r && next_tile->tint.g == tile->tint.g &&
-                        next_tile->tint.b == tile->tint.b && next_tile->tint.a == tile->tint.a &&
-                        next_tile->size.x == tile->size.x && next_tile->size.y == tile->size.y && next_tile->size.z == tile->size.z &&
-                        next_tile->position.y == tile->position.y && next_tile->position.z == tile->position.z &&
-                        next_tile->position.x == data.tiles.data[run_end - 1].position.x + tile->size.x) {
-                        run_end++;
-                    } else {
-                        break;
+        IDungeonPVSSlopes *swap = current;
+        current                 = next;
+        next                    = swap;
+        current_count           = next_count;
+    }
+}
+
+S32 static i_pvs_build_range(U32 begin, U32 end, void *ctx) {
+    auto const *build        = (IDungeonPVSBuildData *)ctx;
+    IDungeonData const *data = build->data;
+    IDungeonPVSSlopes *first = build->scratch + ((SZ)job_system_get_thread_index() * build->scratch_capacity * 2);
+    IDungeonPVSSlopes *other = first + build->scratch_capacity;
+
+    for (U32 sector = begin; sector < end; ++sector) {
+        S32 const sector_x = ((S32)sector % data->pvs_width) * DUNGEON_PVS_SECTOR_TILES;
+        S32 const sector_z = ((S32)sector / data->pvs_width) * DUNGEON_PVS_SECTOR_TILES;
+        S32 const max_x    = glm::min(sector_x + DUNGEON_PVS_SECTOR_TILES, data->grid_width);
+        S32 const max_z    = glm::min(sector_z + DUNGEON_PVS_SECTOR_TILES, data->grid_height);
+
+        i_pvs_set(build->rows, data->pvs_row_words, (S32)sector, (S32)sector);
+
+        // Every open tile of the sector scans, but only ever writes the row of this sector
+        for (S32 z = sector_z; z < max_z; ++z) {
+            for (S32 x = sector_x; x < max_x; ++x) {
+                if (data->wall_grid[(z * data->grid_width) + x] >= 0) { continue; }
+
+                for (S32 sign_x = -1; sign_x <= 1; sign_x += 2) {
+                    for (S32 sign_z = -1; sign_z <= 1; sign_z += 2) {
+                        i_pvs_scan_octant(data, build->rows, (S32)sector, x, z, sign_x, 0, 0, sign_z, first, other);  // X major
+                        i_pvs_scan_octant(data, build->rows, (S32)sector, x, z, 0, sign_z, sign_x, 0, first, other);  // Z major
                     }
                 }
-
-                merged_shape_count++;
-                tile_idx = run_end;
             }
+        }
+    }
 
-            // Allocate mesh with worst-case size (will resize after face extraction)
-            Mesh* mesh = &data.combined_model.meshes[mesh_idx];
-
-            // Extract and merge faces using greedy meshing
-            SZ face_count = 0;
-            struct Face {
-                Vector3 corners[4];  // 4 corners of quad
-                Vector3 normal;
-                Color color;
-            };
-            Face* faces = mmpa(Face*, merged_shape_count * 6 * sizeof(Face)); // worst case: 6 faces per shape
-
-            // Generate faces for each tile, merging adjacent ones
-            for (SZ tile_idx = start_tile; tile_idx < end_tile; tile_idx++) {
-                IDungeonTileData* tile = &data.tiles.data[tile_idx];
-                Vector3 const pos      = tile->position;
-                Vector3 const size     = tile->size;
-                Color const color      = tile->tint;
-                F32 const half_x       = size.x/2;
-                F32 const half_z       = size.z/2;
-
-                // Check which faces are exposed (not hidden by adjacent tiles)
-                BOOL front_exposed  = true;
-                BOOL back_exposed   = true;
-                BOOL top_exposed    = true;
-                BOOL bottom_exposed = true;
-                BOOL right_exposed  = true;
-                BOOL left_exposed   = true;
-
-                // Check adjacency across ALL tiles (not just current mesh) for proper face culling at boundaries
-                for (SZ other_idx = 0; other_idx < tile_count; other_idx++) {
-                    if (other_idx == tile_idx) { continue; }
-                    IDungeonTileData* other = &data.tiles.data[other_idx];
-
-                    if (other->type == tile->type &&
-                        other->size.x == size.x && other->size.y == size.y && other->size.z == size.z) {
-
-                        Vector3 const diff = {other->position.x - pos.x, other->position.y - pos.y, other->position.z - pos.z};
-
-                        if (math_abs_f32(diff.y) < 0.01F && math_abs_f32(diff.z) < 0.01F) {
-                            if (math_abs_f32(diff.x - size.x) < 0.01F) { right_exposed = false; }
-                            if (math_abs_f32(diff.x + size.x) < 0.01F) { left_exposed = false; }
-                        }
-
-                        if (math_abs_f32(diff.x) < 0.01F && math_abs_f32(diff.z) < 0.01F) {
-                            if (math_abs_f32(diff.y - size.y) < 0.01F) { top_exposed = false; }
-                            if (math_abs_f32(diff.y + size.y) < 0.01F) { bottom_exposed = false; }
-                        }
-
-                        if (math_abs_f32(diff.x) < 0.01F && math_abs_f32(diff.y) < 0.01F) {
-                            if (math_abs_f32(diff.z - size.z) < 0.01F) { front_exposed = false; }
-                            if (math_abs_f32(diff.z + size.z) < 0.01F) { back_exposed = false; }
-                        }
-                    }
-                }
+    return 0;
+}
 
-                // Add exposed faces
-                if (front_exposed) {
-                    faces[face_count].corners[0] = {pos.x - half_x, pos.y, pos.z + half_z};
-                    faces[face_count].corners[1] = {pos.x + half_x, pos.y, pos.z + half_z};
-                    faces[face_count].corners[2] = {pos.x + half_x, pos.y + size.y, pos.z + half_z};
-                    faces[face_count].corners[3] = {pos.x - half_x, pos.y + size.y, pos.z + half_z};
-                    faces[face_count].normal = {0.0F, 0.0F, 1.0F};
-                    faces[face_count].color = color;
-                    face_count++;
+// Sector to sector potentially visible set out of the tile layout. The walks are exact from tile centers, the ray test
+// starts from wherever in the tile the camera is though, so what they reach is grown by one sector and made symmetric.
+// The PVS has to stay conservative, it only ever rejects.
+void static i_build_pvs(IDungeonData *data, MemoryType memory_type) {
+    data->pvs_width     = (data->grid_width + DUNGEON_PVS_SECTOR_TILES - 1) / DUNGEON_PVS_SECTOR_TILES;
+    data->pvs_height    = (data->grid_height + DUNGEON_PVS_SECTOR_TILES - 1) / DUNGEON_PVS_SECTOR_TILES;
+    S32 const count     = data->pvs_width * data->pvs_height;
+    data->pvs_row_words = (count + 63) / 64;
+
+    SZ const word_count = (SZ)count * (SZ)data->pvs_row_words;
+    auto *hit_rows      = mcta(U64 *, word_count, sizeof(U64));
+    data->pvs_bits      = (U64 *)memory_calloc(word_count, sizeof(U64), memory_type);
+
+    // Per step every tile of the minor axis can start a new interval, twice that for the ones that overlap on a boundary
+    IDungeonPVSBuildData build = {};
+    build.data                 = data;
+    build.rows                 = hit_rows;
+    build.scratch_capacity     = 2 * ((SZ)glm::max(data->grid_width, data->grid_height) + 2);
+    build.scratch              = mmta(IDungeonPVSSlopes *, job_system_get_thread_count() * build.scratch_capacity * 2 * sizeof(IDungeonPVSSlopes));
+    job_wait(job_parallel_for(0, (U32)count, DUNGEON_PVS_BUILD_GRAIN, i_pvs_build_range, &build));
+
+    for (S32 from = 0; from < count; ++from) {
+        for (S32 to = 0; to < count; ++to) {
+            if (!i_pvs_has(hit_rows, data->pvs_row_words, from, to)) { continue; }
+
+            S32 const to_x = to % data->pvs_width;
+            S32 const to_z = to / data->pvs_width;
+            for (S32 z = glm::max(to_z - 1, 0); z <= glm::min(to_z + 1, data->pvs_height - 1); ++z) {
+                for (S32 x = glm::max(to_x - 1, 0); x <= glm::min(to_x + 1, data->pvs_width - 1); ++x) {
+                    S32 const neighbor = (z * data->pvs_width) + x;
+                    i_pvs_set(data->pvs_bits, data->pvs_row_words, from, neighbor);
+                    i_pvs_set(data->pvs_bits, data->pvs_row_words, neighbor, from);
                 }
+            }
+        }
+    }
+}
 
-                if (back_exposed) {
-                    faces[face_count].corners[0] = {pos.x + half_x, pos.y, pos.z - half_z};
-                    faces[face_count].corners[1] = {pos.x - half_x, pos.y, pos.z - half_z};
-                    faces[face_count].corners[2] = {pos.x - half_x, pos.y + size.y, pos.z - half_z};
-                    faces[face_count].corners[3] = {pos.x + half_x, pos.y + size.y, pos.z - half_z};
-                    faces[face_count].normal = {0.0F, 0.0F, -1.0F};
-                    faces[face_count].color = color;
-                    face_count++;
-                }
+void static i_build_meshes(IDungeonData *data) {
+    SZ const tile_count = data->tiles.count;
 
-                if (top_exposed) {
-                    faces[face_count].corners[0] = {pos.x - half_x, pos.y + size.y, pos.z - half_z};
-                    faces[face_count].corners[1] = {pos.x - half_x, pos.y + size.y, pos.z + half_z};
-                    faces[face_count].corners[2] = {pos.x + half_x, pos.y + size.y, pos.z + half_z};
-                    faces[face_count].corners[3] = {pos.x + half_x, pos.y + size.y, pos.z - half_z};
-                    faces[face_count].normal = {0.0F, 1.0F, 0.0F};
-                    faces[face_count].color = color;
-                    face_count++;
-                }
+    // Generate combined model with multiple meshes from all tiles
+    SZ const MAX_TILES_PER_MESH = 300; // Smaller chunks for better frustum culling (face culling fixed for boundaries)
 
-                if (bottom_exposed) {
-                    faces[face_count].corners[0] = {pos.x - half_x, pos.y, pos.z + half_z};
-                    faces[face_count].corners[1] = {pos.x - half_x, pos.y, pos.z - half_z};
-                    faces[face_count].corners[2] = {pos.x + half_x, pos.y, pos.z - half_z};
-                    faces[face_count].corners[3] = {pos.x + half_x, pos.y, pos.z + half_z};
-                    faces[face_count].normal = {0.0F, -1.0F, 0.0F};
-                    faces[face_count].color = color;
-                    face_count++;
-                }
+    // Sort tiles by spatial location to keep adjacent tiles in same mesh
+    // This prevents seams between meshes at tile boundaries
+    for (SZ i = 0; i < tile_count - 1; i++) {
+        for (SZ j = i + 1; j < tile_count; j++) {
+            IDungeonTileData* a = &data->tiles.data[i];
+            IDungeonTileData* b = &data->tiles.data[j];
 
-                if (right_exposed) {
-                    faces[face_count].corners[0] = {pos.x + half_x, pos.y, pos.z + half_z};
-                    faces[face_count].corners[1] = {pos.x + half_x, pos.y, pos.z - half_z};
-                    faces[face_count].corners[2] = {pos.x + half_x, pos.y + size.y, pos.z - half_z};
-                    faces[face_count].corners[3] = {pos.x + half_x, pos.y + size.y, pos.z + half_z};
-                    faces[face_count].normal = {1.0F, 0.0F, 0.0F};
-                    faces[face_count].color = color;
-                    face_count++;
-                }
+            // Sort by Z first, then X (row-major order)
+            F32 const a_key = (a->position.z * 1000.0F) + a->position.x;
+            F32 const b_key = (b->position.z * 1000.0F) + b->position.x;
 
-                if (left_exposed) {
-                    faces[face_count].corners[0] = {pos.x - half_x, pos.y, pos.z - half_z};
-                    faces[face_count].corners[1] = {pos.x - half_x, pos.y, pos.z + half_z};
-                    faces[face_count].corners[2] = {pos.x - half_x, pos.y + size.y, pos.z + half_z};
-                    faces[face_count].corners[3] = {pos.x - half_x, pos.y + size.y, pos.z - half_z};
-                    faces[face_count].normal = {-1.0F, 0.0F, 0.0F};
-                    faces[face_count].color = color;
-                    face_count++;
-                }
+            if (a_key > b_key) {
+                IDungeonTileData const temp = *a;
+                *a = *b;
+                *b = temp;
             }
+        }
+    }
 
-            // Allocate mesh memory based on actual face count
-            mesh->vertexCount   = (S32)(face_count * 4);
-            mesh->triangleCount = (S32)(face_count * 2);
-            mesh->vertices      = mmpa(F32*, face_count * 4 * 3 * sizeof(F32));
-            mesh->normals       = mmpa(F32*, face_count * 4 * 3 * sizeof(F32));
-            mesh->texcoords     = mmpa(F32*, face_count * 4 * 2 * sizeof(F32));
-            mesh->indices       = mmpa(U16*, face_count * 6 * sizeof(U16));
-            mesh->colors        = mmpa(U8*, face_count * 4 * 4 * sizeof(U8));
-
-            // Generate mesh from faces
-            for (SZ face_idx = 0; face_idx < face_count; face_idx++) {
-                Face* face = &faces[face_idx];
-
-                // Add 4 vertices for this face
-                for (SZ i = 0; i < 4; i++) {
-                    SZ const vert_idx = (face_idx * 4 + i) * 3;
-                    mesh->vertices[vert_idx + 0] = face->corners[i].x;
-                    mesh->vertices[vert_idx + 1] = face->corners[i].y;
-                    mesh->vertices[vert_idx + 2] = face->corners[i].z;
-
-                    mesh->normals[vert_idx + 0] = face->normal.x;
-                    mesh->normals[vert_idx + 1] = face->normal.y;
-                    mesh->normals[vert_idx + 2] = face->normal.z;
+    SZ const mesh_count = (tile_count + MAX_TILES_PER_MESH - 1) / MAX_TILES_PER_MESH;
+
+    // Initialize model
+    data->combined_model.meshCount     = (S32)mesh_count;
+    data->combined_model.materialCount = 1;
+    data->combined_model.meshes        = mmpa(Mesh*, mesh_count * sizeof(Mesh));
+    data->combined_model.materials     = mmpa(Material*, sizeof(Material));
+    data->combined_model.meshMaterial  = mmpa(S32*, mesh_count * sizeof(S32));
+    data->combined_model.transform     = MatrixIdentity();
+
+    // Use default material with rock texture
+    data->combined_model.materials[0]        = g_render.default_material;
+    data->combined_model.materials[0].shader = asset_get_shader("model")->base;
+
+    // Load and apply rock texture
+    ATexture *texture = asset_get_texture("cracked_mud.jpg");
+    data->combined_model.materials[0].maps[MATERIAL_MAP_DIFFUSE].texture = texture->base;
+
+    for (SZ i = 0; i < mesh_count; i++) { data->combined_model.meshMaterial[i] = 0; }
+
+    // Allocate bounding boxes for frustum culling
+    data->mesh_bounding_boxes = mmpa(OrientedBoundingBox*, mesh_count * sizeof(OrientedBoundingBox));
+    data->mesh_bbox_count = mesh_count;
+
+    // Create each mesh
+    for (SZ mesh_idx = 0; mesh_idx < mesh_count; mesh_idx++) {
+        SZ const start_tile = mesh_idx * MAX_TILES_PER_MESH;
+        SZ const end_tile   = (start_tile + MAX_TILES_PER_MESH < tile_count) ? (start_tile + MAX_TILES_PER_MESH) : tile_count;
+
+        // Pre-count merged shapes to allocate correct memory
+        SZ merged_shape_count = 0;
+        for (SZ tile_idx = start_tile; tile_idx < end_tile; ) {
+            IDungeonTileData* tile = &data->tiles.data[tile_idx];
+            SZ run_end             = tile_idx + 1;
+
+            while (run_end < end_tile) {
+                IDungeonTileData* next_tile = &data->tiles.data[run_end];
+                if (next_tile->type == tile->type &&
+                    next_tile->tint.r == tile->tint.r && next_tile->tint.g == tile->tint.g &&
+                    next_tile->tint.b == tile->tint.b && next_tile->tint.a == tile->tint.a &&
+                    next_tile->size.x == tile->size.x && next_tile->size.y == tile->size.y && next_tile->size.z == tile->size.z &&
+                    next_tile->position.y == tile->position.y && next_tile->position.z == tile->position.z &&
+                    next_tile->position.x == data->tiles.data[run_end - 1].position.x + tile->size.x) {
+                    run_end++;
+                } else {
+                    break;
                 }
+            }
 
-                // Add texture coordinates
-                SZ const tex_idx = face_idx * 4 * 2;
-                F32 const tex_coords[] = {0.0F, 1.0F, 1.0F, 1.0F, 1.0F, 0.0F, 0.0F, 0.0F};
-                for (SZ i = 0; i < 8; i++) {
-                    mesh->texcoords[tex_idx + i] = tex_coords[i];
-                }
+            merged_shape_count++;
+            tile_idx = run_end;
+        }
 
-                // Add colors
-                for (SZ i = 0; i < 4; i++) {
-                    SZ const color_idx = (face_idx * 4 + i) * 4;
-                    mesh->colors[color_idx + 0] = face->color.r;
-                    mesh->colors[color_idx + 1] = face->color.g;
-                    mesh->colors[color_idx + 2] = face->color.b;
-                    mesh->colors[color_idx + 3] = face->color.a;
+        // Allocate mesh with worst-case size (will resize after face extraction)
+        Mesh* mesh = &data->combined_model.meshes[mesh_idx];
+
+        // Extract and merge faces using greedy meshing
+        SZ face_count = 0;
+        struct Face {
+            Vector3 corners[4];  // 4 corners of quad
+            Vector3 normal;
+            Color color;
+        };
+        Face* faces = mmpa(Face*, merged_shape_count * 6 * sizeof(Face)); // worst case: 6 faces per shape
+
+        // Generate faces for each tile, merging adjacent ones
+        for (SZ tile_idx = start_tile; tile_idx < end_tile; tile_idx++) {
+            IDungeonTileData* tile = &data->tiles.data[tile_idx];
+            Vector3 const pos      = tile->position;
+            Vector3 const size     = tile->size;
+            Color const color      = tile->tint;
+            F32 const half_x       = size.x/2;
+            F32 const half_z       = size.z/2;
+
+            // Check which faces are exposed (not hidden by adjacent tiles)
+            BOOL front_exposed  = true;
+            BOOL back_exposed   = true;
+            BOOL top_exposed    = true;
+            BOOL bottom_exposed = true;
+            BOOL right_exposed  = true;
+            BOOL left_exposed   = true;
+
+            // Check adjacency across ALL tiles (not just current mesh) for proper face culling at boundaries
+            for (SZ other_idx = 0; other_idx < tile_count; other_idx++) {
+                if (other_idx == tile_idx) { continue; }
+                IDungeonTileData* other = &data->tiles.data[other_idx];
+
+                if (other->type == tile->type &&
+                    other->size.x == size.x && other->size.y == size.y && other->size.z == size.z) {
+
+                    Vector3 const diff = {other->position.x - pos.x, other->position.y - pos.y, other->position.z - pos.z};
+
+                    if (math_abs_f32(diff.y) < 0.01F && math_abs_f32(diff.z) < 0.01F) {
+                        if (math_abs_f32(diff.x - size.x) < 0.01F) { right_exposed = false; }
+                        if (math_abs_f32(diff.x + size.x) < 0.01F) { left_exposed = false; }
+                    }
+
+                    if (math_abs_f32(diff.x) < 0.01F && math_abs_f32(diff.z) < 0.01F) {
+                        if (math_abs_f32(diff.y - size.y) < 0.01F) { top_exposed = false; }
+                        if (math_abs_f32(diff.y + size.y) < 0.01F) { bottom_exposed = false; }
+                    }
+
+                    if (math_abs_f32(diff.x) < 0.01F && math_abs_f32(diff.y) < 0.01F) {
+                        if (math_abs_f32(diff.z - size.z) < 0.01F) { front_exposed = false; }
+                        if (math_abs_f32(diff.z + size.z) < 0.01F) { back_exposed = false; }
+                    }
                 }
+            }
+
+            // Add exposed faces
+            if (front_exposed) {
+                faces[face_count].corners[0] = {pos.x - half_x, pos.y, pos.z + half_z};
+                faces[face_count].corners[1] = {pos.x + half_x, pos.y, pos.z + half_z};
+                faces[face_count].corners[2] = {pos.x + half_x, pos.y + size.y, pos.z + half_z};
+                faces[face_count].corners[3] = {pos.x - half_x, pos.y + size.y, pos.z + half_z};
+                faces[face_count].normal = {0.0F, 0.0F, 1.0F};
+                faces[face_count].color = color;
+                face_count++;
+            }
+
+            if (back_exposed) {
+                faces[face_count].corners[0] = {pos.x + half_x, pos.y, pos.z - half_z};
+                faces[face_count].corners[1] = {pos.x - half_x, pos.y, pos.z - half_z};
+                faces[face_count].corners[2] = {pos.x - half_x, pos.y + size.y, pos.z - half_z};
+                faces[face_count].corners[3] = {pos.x + half_x, pos.y + size.y, pos.z - half_z};
+                faces[face_count].normal = {0.0F, 0.0F, -1.0F};
+                faces[face_count].color = color;
+                face_count++;
+            }
+
+            if (top_exposed) {
+                faces[face_count].corners[0] = {pos.x - half_x, pos.y + size.y, pos.z - half_z};
+                faces[face_count].corners[1] = {pos.x - half_x, pos.y + size.y, pos.z + half_z};
+                faces[face_count].corners[2] = {pos.x + half_x, pos.y + size.y, pos.z + half_z};
+                faces[face_count].corners[3] = {pos.x + half_x, pos.y + size.y, pos.z - half_z};
+                faces[face_count].normal = {0.0F, 1.0F, 0.0F};
+                faces[face_count].color = color;
+                face_count++;
+            }
 
-                // Add indices for 2 triangles
-                SZ const idx_base = face_idx * 4;
-                SZ const indices_idx = face_idx * 6;
-                mesh->indices[indices_idx + 0] = (U16)(idx_base + 0);
-                mesh->indices[indices_idx + 1] = (U16)(idx_base + 1);
-                mesh->indices[indices_idx + 2] = (U16)(idx_base + 2);
-                mesh->indices[indices_idx + 3] = (U16)(idx_base + 2);
-                mesh->indices[indices_idx + 4] = (U16)(idx_base + 3);
-                mesh->indices[indices_idx + 5] = (U16)(idx_base + 0);
+            if (bottom_exposed) {
+                faces[face_count].corners[0] = {pos.x - half_x, pos.y, pos.z + half_z};
+                faces[face_count].corners[1] = {pos.x - half_x, pos.y, pos.z - half_z};
+                faces[face_count].corners[2] = {pos.x + half_x, pos.y, pos.z - half_z};
+                faces[face_count].corners[3] = {pos.x + half_x, pos.y, pos.z + half_z};
+                faces[face_count].normal = {0.0F, -1.0F, 0.0F};
+                faces[face_count].color = color;
+                face_count++;
             }
 
-            // Upload this mesh to GPU
-            UploadMesh(mesh, false);
-
-            // Calculate bounding box for this mesh
-            Vector3 min_bounds = {F32_MAX, F32_MAX, F32_MAX};
-            Vector3 max_bounds = {-F32_MAX, -F32_MAX, -F32_MAX};
-
-            for (SZ tile_idx = start_tile; tile_idx < end_tile; tile_idx++) {
-                IDungeonTileData* tile = &data.tiles.data[tile_idx];
-                Vector3 const pos = tile->position;
-                Vector3 const size = tile->size;
-
-                // Calculate tile bounds
-                Vector3 const tile_min = {pos.x - (size.x/2), pos.y, pos.z - (size.z/2)};
-                Vector3 const tile_max = {pos.x + (size.x/2), pos.y + size.y, pos.z + (size.z/2)};
-
-                // Update mesh bounds
-                min_bounds.x = glm::min(min_bounds.x, tile_min.x);
-                min_bounds.y = glm::min(min_bounds.y, tile_min.y);
-                min_bounds.z = glm::min(min_bounds.z, tile_min.z);
-                max_bounds.x = glm::max(max_bounds.x, tile_max.x);
-                max_bounds.y = glm::max(max_bounds.y, tile_max.y);
-                max_bounds.z = glm::max(max_bounds.z, tile_max.z);
+            if (right_exposed) {
+                faces[face_count].corners[0] = {pos.x + half_x, pos.y, pos.z + half_z};
+                faces[face_count].corners[1] = {pos.x + half_x, pos.y, pos.z - half_z};
+                faces[face_count].corners[2] = {pos.x + half_x, pos.y + size.y, pos.z - half_z};
+                faces[face_count].corners[3] = {pos.x + half_x, pos.y + size.y, pos.z + half_z};
+                faces[face_count].normal = {1.0F, 0.0F, 0.0F};
+                faces[face_count].color = color;
+                face_count++;
             }
 
-            // Create axis-aligned OBB
-            data.mesh_bounding_boxes[mesh_idx].center = {
-                (min_bounds.x + max_bounds.x) * 0.5F,
-                (min_bounds.y + max_bounds.y) * 0.5F,
-                (min_bounds.z + max_bounds.z) * 0.5F
-            };
-            data.mesh_bounding_boxes[mesh_idx].extents = {
-                (max_bounds.x - min_bounds.x) * 0.5F,
-                (max_bounds.y - min_bounds.y) * 0.5F,
-                (max_bounds.z - min_bounds.z) * 0.5F
-            };
-            // Axis-aligned, so axes are identity
-            data.mesh_bounding_boxes[mesh_idx].axes[0] = {1.0F, 0.0F, 0.0F};
-            data.mesh_bounding_boxes[mesh_idx].axes[1] = {0.0F, 1.0F, 0.0F};
-            data.mesh_bounding_boxes[mesh_idx].axes[2] = {0.0F, 0.0F, 1.0F};
+            if (left_exposed) {
+                faces[face_count].corners[0] = {pos.x - half_x, pos.y, pos.z - half_z};
+                faces[face_count].corners[1] = {pos.x - half_x, pos.y, pos.z + half_z};
+                faces[face_count].corners[2] = {pos.x - half_x, pos.y + size.y, pos.z + half_z};
+                faces[face_count].corners[3] = {pos.x - half_x, pos.y + size.y, pos.z - half_z};
+                faces[face_count].normal = {-1.0F, 0.0F, 0.0F};
+                faces[face_count].color = color;
+                face_count++;
+            }
         }
+
+        // Allocate mesh memory based on actual face count
+        mesh->vertexCount   = (S32)(face_count * 4);
+        mesh->triangleCount = (S32)(face_count * 2);
+        mesh->vertices      = mmpa(F32*, face_count * 4 * 3 * sizeof(F32));
+        mesh->normals       = mmpa(F32*, face_count * 4 * 3 * sizeof(F32));
+        mesh->texcoords     = mmpa(F32*, face_count * 4 * 2 * sizeof(F32));
+        mesh->indices       = mmpa(U16*, face_count * 6 * sizeof(U16));
+        mesh->colors        = mmpa(U8*, face_count * 4 * 4 * sizeof(U8));
+
+        // Generate mesh from faces
+        for (SZ face_idx = 0; face_idx < face_count; face_idx++) {
+            Face* face = &faces[face_idx];
+
+            // Add 4 vertices for this face
+            for (SZ i = 0; i < 4; i++) {
+                SZ const vert_idx = (face_idx * 4 + i) * 3;
+                mesh->vertices[vert_idx + 0] = face->corners[i].x;
+                mesh->vertices[vert_idx + 1] = face->corners[i].y;
+                mesh->vertices[vert_idx + 2] = face->corners[i].z;
+
+                mesh->normals[vert_idx + 0] = face->normal.x;
+                mesh->normals[vert_idx + 1] = face->normal.y;
+                mesh->normals[vert_idx + 2] = face->normal.z;
+            }
+
+            // Add texture coordinates
+            SZ const tex_idx = face_idx * 4 * 2;
+            F32 const tex_coords[] = {0.0F, 1.0F, 1.0F, 1.0F, 1.0F, 0.0F, 0.0F, 0.0F};
+            for (SZ i = 0; i < 8; i++) {
+                mesh->texcoords[tex_idx + i] = tex_coords[i];
+            }
+
+            // Add colors
+            for (SZ i = 0; i < 4; i++) {
+                SZ const color_idx = (face_idx * 4 + i) * 4;
+                mesh->colors[color_idx + 0] = face->color.r;
+                mesh->colors[color_idx + 1] = face->color.g;
+                mesh->colors[color_idx + 2] = face->color.b;
+                mesh->colors[color_idx + 3] = face->color.a;
+            }
+
+            // Add indices for 2 triangles
+            SZ const idx_base = face_idx * 4;
+            SZ const indices_idx = face_idx * 6;
+            mesh->indices[indices_idx + 0] = (U16)(idx_base + 0);
+            mesh->indices[indices_idx + 1] = (U16)(idx_base + 1);
+            mesh->indices[indices_idx + 2] = (U16)(idx_base + 2);
+            mesh->indices[indices_idx + 3] = (U16)(idx_base + 2);
+            mesh->indices[indices_idx + 4] = (U16)(idx_base + 3);
+            mesh->indices[indices_idx + 5] = (U16)(idx_base + 0);
+        }
+
+        // Upload this mesh to GPU
+        UploadMesh(mesh, false);
+
+        // Calculate bounding box for this mesh
+        Vector3 min_bounds = {F32_MAX, F32_MAX, F32_MAX};
+        Vector3 max_bounds = {-F32_MAX, -F32_MAX, -F32_MAX};
+
+        for (SZ tile_idx = start_tile; tile_idx < end_tile; tile_idx++) {
+            IDungeonTileData* tile = &data->tiles.data[tile_idx];
+            Vector3 const pos = tile->position;
+            Vector3 const size = tile->size;
+
+            // Calculate tile bounds
+            Vector3 const tile_min = {pos.x - (size.x/2), pos.y, pos.z - (size.z/2)};
+            Vector3 const tile_max = {pos.x + (size.x/2), pos.y + size.y, pos.z + (size.z/2)};
+
+            // Update mesh bounds
+            min_bounds.x = glm::min(min_bounds.x, tile_min.x);
+            min_bounds.y = glm::min(min_bounds.y, tile_min.y);
+            min_bounds.z = glm::min(min_bounds.z, tile_min.z);
+            max_bounds.x = glm::max(max_bounds.x, tile_max.x);
+            max_bounds.y = glm::max(max_bounds.y, tile_max.y);
+            max_bounds.z = glm::max(max_bounds.z, tile_max.z);
+        }
+
+        // Create axis-aligned OBB
+        data->mesh_bounding_boxes[mesh_idx].center = {
+            (min_bounds.x + max_bounds.x) * 0.5F,
+            (min_bounds.y + max_bounds.y) * 0.5F,
+            (min_bounds.z + max_bounds.z) * 0.5F
+        };
+        data->mesh_bounding_boxes[mesh_idx].extents = {
+            (max_bounds.x - min_bounds.x) * 0.5F,
+            (max_bounds.y - min_bounds.y) * 0.5F,
+            (max_bounds.z - min_bounds.z) * 0.5F
+        };
+        // Axis-aligned, so axes are identity
+        data->mesh_bounding_boxes[mesh_idx].axes[0] = {1.0F, 0.0F, 0.0F};
+        data->mesh_bounding_boxes[mesh_idx].axes[1] = {0.0F, 1.0F, 0.0F};
+        data->mesh_bounding_boxes[mesh_idx].axes[2] = {0.0F, 0.0F, 1.0F};
+    }
+}
+
+IDungeonData static i_parse_dungeon(C8 const* filepath) {
+    IDungeonData data = {};
+
+    C8 *text = LoadFileText(filepath);
+    i_parse_tiles(&data, text, MEMORY_TYPE_ARENA_PERMANENT);
+    UnloadFileText(text);
+
+    if (data.has_player_position) {
+        c3d_set_position({data.player_position.x, 0.0F, data.player_position.y}); // TODO: This needs to happen elsewhere later.
+    }
+
+    if (data.tiles.count > 0) {
+        i_build_tile_grid(&data, MEMORY_TYPE_ARENA_PERMANENT);
+        i_build_pvs(&data, MEMORY_TYPE_ARENA_PERMANENT);
+        i_build_meshes(&data);
     }
 
     return data;
 }
 
+
 IDungeonData static g_dungeon_data = {};
 BOOL static g_dungeon_loaded = false;
 
-BOOL static i_is_position_on_floor(Vector3 position) {
-    F32 const tile_size = DUNGEON_TILE_SIZE;
-    F32 const half_tile = tile_size / 2.0F;
+// The dungeon that was live before dungeon_load_from_text(), dungeon_unload() puts it back
+IDungeonData static g_dungeon_saved_data = {};
+BOOL static g_dungeon_saved_loaded       = false;
+BOOL static g_dungeon_from_text          = false;
 
-    for (SZ i = 0; i < g_dungeon_data.tiles.count; i++) {
-        IDungeonTileData *tile = &g_dungeon_data.tiles.data[i];
-        if (tile->type == DUNGEON_TILE_TYPE_BASIC_FLOOR) {
-            // Check if player position is within the floor tile bounds
-            F32 const tile_min_x = tile->position.x - half_tile;
-            F32 const tile_max_x = tile->position.x + half_tile;
-            F32 const tile_min_z = tile->position.z - half_tile;
-            F32 const tile_max_z = tile->position.z + half_tile;
-
-            if (position.x >= tile_min_x && position.x <= tile_max_x &&
-                position.z >= tile_min_z && position.z <= tile_max_z &&
-                position.y >= tile->position.y &&
-                position.y <= tile->position.y + tile->size.y + PLAYER_HEIGHT_TO_EYES) {
-                return true;
-            }
-        }
-    }
-    return false;
+S32 static inline i_tile_index(S32 grid_x, S32 grid_z) {
+    S32 const local_x = grid_x - g_dungeon_data.grid_min_x;
+    S32 const local_z = grid_z - g_dungeon_data.grid_min_z;
+    if (local_x < 0 || local_x >= g_dungeon_data.grid_width || local_z < 0 || local_z >= g_dungeon_data.grid_height) { return -1; }
+    return (local_z * g_dungeon_data.grid_width) + local_x;
+}
+
+BOOL dungeon_is_position_on_floor(Vector3 position) {
+    if (!g_dungeon_data.floor_bits) { return false; }
+
+    S32 const cell = i_tile_index(i_tile_coord(position.x), i_tile_coord(position.z));
+    if (cell < 0) { return false; }
+    if ((g_dungeon_data.floor_bits[cell / 64] & (1ULL << (cell % 64))) == 0) { return false; }
+
+    // Standing on the floor or on top of the ceiling, same heights as the tiles the parser creates
+    F32 const ceiling_y = (DUNGEON_TILE_SIZE * DUNGEON_WALL_HEIGHT_MULTIPLIER) - DUNGEON_CEILING_THICKNESS;
+    if (position.y >= 0.0F && position.y <= DUNGEON_FLOOR_THICKNESS + PLAYER_HEIGHT_TO_EYES) { return true; }
+    return position.y >= ceiling_y && position.y <= ceiling_y + DUNGEON_CEILING_THICKNESS + PLAYER_HEIGHT_TO_EYES;
 }
 
-// Check if position would be too close to any wall
-BOOL static i_is_position_too_close_to_wall(Vector3 pos) {
-    for (SZ i = 0; i < g_dungeon_data.collision_walls.count; i++) {
-        IDungeonCollisionWall *wall = &g_dungeon_data.collision_walls.data[i];
+BOOL dungeon_is_position_colliding(Vector3 position, F32 radius) {
+    if (!g_dungeon_data.wall_grid) { return false; }
 
-        // Calculate distance from player position to wall center
-        F32 const dist_x = math_abs_f32(pos.x - wall->position.x);
-        F32 const dist_z = math_abs_f32(pos.z - wall->position.z);
+    // Only walls in the tiles the radius overlaps can be close enough
+    S32 const min_x = glm::max(i_tile_coord(position.x - radius), g_dungeon_data.grid_min_x);
+    S32 const max_x = glm::min(i_tile_coord(position.x + radius), g_dungeon_data.grid_max_x);
+    S32 const min_z = glm::max(i_tile_coord(position.z - radius), g_dungeon_data.grid_min_z);
+    S32 const max_z = glm::min(i_tile_coord(position.z + radius), g_dungeon_data.grid_max_z);
 
-        // Check if we're too close (wall half-size + buffer distance)
-        F32 const wall_half_size = DUNGEON_TILE_SIZE * 0.5F;
-        F32 const min_dist_x     = wall_half_size + WALL_BUFFER_DISTANCE;
-        F32 const min_dist_z     = wall_half_size + WALL_BUFFER_DISTANCE;
+    F32 const wall_half_size = DUNGEON_TILE_SIZE * 0.5F;
+    F32 const min_dist       = wall_half_size + radius;
 
-        if (dist_x < min_dist_x && dist_z < min_dist_z) {
-            return true;
+    for (S32 z = min_z; z <= max_z; ++z) {
+        for (S32 x = min_x; x <= max_x; ++x) {
+            S32 const wall_idx = g_dungeon_data.wall_grid[i_tile_index(x, z)];
+            if (wall_idx < 0) { continue; }
+
+            // Calculate distance from position to wall center
+            IDungeonCollisionWall const *wall = &g_dungeon_data.collision_walls.data[wall_idx];
+            F32 const dist_x                  = math_abs_f32(position.x - wall->position.x);
+            F32 const dist_z                  = math_abs_f32(position.z - wall->position.z);
+
+            if (dist_x < min_dist && dist_z < min_dist) {
+                return true; // Colliding with wall
+            }
         }
     }
     return false;
@@ -586,7 +785,7 @@ void dungeon_update(F32 dt) {
     BOOL const is_moving        = movement_distance > 0.001F;
 
     // Play footstep on movement start
-    if (is_moving && !was_moving && i_is_position_on_floor(current_pos)) {
+    if (is_moving && !was_moving && dungeon_is_position_on_floor(current_pos)) {
         player_step();
         accumulated_distance = 0.0F;
     }
@@ -599,7 +798,7 @@ void dungeon_update(F32 dt) {
     // Track distance for footsteps during continuous movement
     accumulated_distance += movement_distance;
     if (accumulated_distance >= FOOTSTEP_DISTANCE_THRESHOLD) {
-        if (i_is_position_on_floor(current_pos)) {
+        if (dungeon_is_position_on_floor(current_pos)) {
             player_step();
         }
         accumulated_distance = 0.0F;
@@ -610,7 +809,7 @@ void dungeon_update(F32 dt) {
 
     // Try X movement
     Vector3 const test_pos_x = {prev_player_pos.x + movement.x, current_pos.y, prev_player_pos.z};
-    if (!i_is_position_too_close_to_wall(test_pos_x)) {
+    if (!dungeon_is_position_colliding(test_pos_x, WALL_BUFFER_DISTANCE)) {
         new_position.x = test_pos_x.x;
     } else {
         new_position.x = prev_player_pos.x;  // Keep old X if blocked
@@ -618,7 +817,7 @@ void dungeon_update(F32 dt) {
 
     // Try Z movement
     Vector3 const test_pos_z = {new_position.x, current_pos.y, prev_player_pos.z + movement.z};
-    if (!i_is_position_too_close_to_wall(test_pos_z)) {
+    if (!dungeon_is_position_colliding(test_pos_z, WALL_BUFFER_DISTANCE)) {
         new_position.z = test_pos_z.z;
     } else {
         new_position.z = prev_player_pos.z;  // Keep old Z if blocked
@@ -633,6 +832,32 @@ void dungeon_update(F32 dt) {
     was_moving      = is_moving;
 }
 
+// Sector of a position for the PVS, -1 outside the grid
+S32 static i_pvs_sector(Vector3 position) {
+    S32 const local_x = i_tile_coord(position.x) - g_dungeon_data.grid_min_x;
+    S32 const local_z = i_tile_coord(position.z) - g_dungeon_data.grid_min_z;
+    if (local_x < 0 || local_x >= g_dungeon_data.grid_width || local_z < 0 || local_z >= g_dungeon_data.grid_height) { return -1; }
+    return i_pvs_sector_of_tile(&g_dungeon_data, local_x, local_z);
+}
+
+BOOL dungeon_is_potentially_visible(Vector3 from, Vector3 to) {
+    if (!g_dungeon_loaded || !g_dungeon_data.pvs_bits) { return true; }
+
+    // The walls only hide what is between floor and wall top, above them everything sees everything
+    F32 const wall_top = DUNGEON_TILE_SIZE * DUNGEON_WALL_HEIGHT_MULTIPLIER;
+    if (from.y < 0.0F || from.y > wall_top || to.y < 0.0F || to.y > wall_top) { return true; }
+
+    // Only open tiles got scanned from, a camera inside a wall has no row
+    S32 const from_tile = i_tile_index(i_tile_coord(from.x), i_tile_coord(from.z));
+    if (from_tile < 0 || g_dungeon_data.wall_grid[from_tile] >= 0) { return true; }
+
+    S32 const from_sector = i_pvs_sector(from);
+    S32 const to_sector   = i_pvs_sector(to);
+    if (to_sector < 0) { return true; }
+
+    return i_pvs_has(g_dungeon_data.pvs_bits, g_dungeon_data.pvs_row_words, from_sector, to_sector);
+}
+
 BOOL dungeon_is_entity_occluded(EID entity_id) {
     if (!g_dungeon_loaded) { return false; }
 
@@ -640,6 +865,9 @@ BOOL dungeon_is_entity_occluded(EID entity_id) {
     Vector3 const camera_pos = cam->position;
     Vector3 const entity_pos = g_world->position[entity_id];
 
+    // Whole rooms the camera can not see from where it is, no need to walk the ray
+    if (!dungeon_is_potentially_visible(camera_pos, entity_pos)) { return true; }
+
     // Get entity size for tolerance (use largest horizontal extent)
     F32 const entity_radius = glm::max(g_world->obb[entity_id].extents.x, g_world->obb[entity_id].extents.z);
 
@@ -738,34 +966,13 @@ BOOL dungeon_is_entity_occluded(EID entity_id) {
     return false; // No walls blocking line of sight
 }
 
-BOOL static i_check_position_collision(Vector3 pos, F32 radius) {
-    for (SZ i = 0; i < g_dungeon_data.collision_walls.count; i++) {
-        IDungeonCollisionWall *wall = &g_dungeon_data.collision_walls.data[i];
-
-        // Calculate distance from position to wall center
-        F32 const dist_x = math_abs_f32(pos.x - wall->position.x);
-        F32 const dist_z = math_abs_f32(pos.z - wall->position.z);
-
-        // Check if we're too close (wall half-size + entity radius)
-        F32 const wall_half_size = DUNGEON_TILE_SIZE * 0.5F;
-        F32 const min_dist_x     = wall_half_size + radius;
-        F32 const min_dist_z     = wall_half_size + radius;
-
-        if (dist_x < min_dist_x && dist_z < min_dist_z) {
-            return true; // Colliding with wall
-        }
-    }
-    return false;
+F32 static inline i_entity_radius(EID entity_id) {
+    return glm::max(g_world->obb[entity_id].extents.x, g_world->obb[entity_id].extents.z);
 }
 
-Vector3 dungeon_resolve_wall_collision(EID entity_id, Vector3 desired_pos) {
-    if (!g_dungeon_loaded) { return desired_pos; }
-
-    Vector3 const current_pos = g_world->position[entity_id];
-    F32 const radius = glm::max(g_world->obb[entity_id].extents.x, g_world->obb[entity_id].extents.z);
-
+Vector3 static i_resolve_wall_collision(Vector3 current_pos, Vector3 desired_pos, F32 radius) {
     // If desired position doesn't collide, use it
-    if (!i_check_position_collision(desired_pos, radius)) {
+    if (!dungeon_is_position_colliding(desired_pos, radius)) {
         return desired_pos;
     }
 
@@ -773,8 +980,8 @@ Vector3 dungeon_resolve_wall_collision(EID entity_id, Vector3 desired_pos) {
     Vector3 slide_x = {desired_pos.x, desired_pos.y, current_pos.z}; // Slide along X only
     Vector3 slide_z = {current_pos.x, desired_pos.y, desired_pos.z}; // Slide along Z only
 
-    BOOL const x_valid = !i_check_position_collision(slide_x, radius);
-    BOOL const z_valid = !i_check_position_collision(slide_z, radius);
+    BOOL const x_valid = !dungeon_is_position_colliding(slide_x, radius);
+    BOOL const z_valid = !dungeon_is_position_colliding(slide_z, radius);
 
     // Return the valid slide direction, prefer whichever moved us further
     if (x_valid && z_valid) {
@@ -791,6 +998,109 @@ Vector3 dungeon_resolve_wall_collision(EID entity_id, Vector3 desired_pos) {
     return current_pos;
 }
 
+Vector3 dungeon_resolve_wall_collision(EID entity_id, Vector3 desired_pos) {
+    if (!g_dungeon_loaded) { return desired_pos; }
+    return i_resolve_wall_collision(g_world->position[entity_id], desired_pos, i_entity_radius(entity_id));
+}
+
+S32 static i_resolve_wall_collision_range(U32 begin, U32 end, void *ctx) {
+    unused(ctx);
+
+    WorldEntityList const *actors = &g_world->actor_list;
+    for (U32 idx = begin; idx < end; ++idx) {
+        EID const id                       = actors->entities[idx];
+        EntityMovementController *movement = &g_world->actor[id].movement;
+        if (!movement->wall_collision_pending) { continue; }
+
+        movement->wall_collision_pending = false;
+
+        Vector3 const desired_pos  = g_world->position[id];
+        Vector3 const resolved_pos = i_resolve_wall_collision(movement->wall_collision_from, desired_pos, i_entity_radius(id));
+        if (!Vector3Equals(resolved_pos, desired_pos)) { entity_set_position(id, resolved_pos); }
+    }
+
+    return 0;
+}
+
+void dungeon_resolve_wall_collision_batch() {
+    U32 const count = g_world->actor_list.count;
+    if (count == 0) { return; }
+
+    PBEGIN("dungeon_resolve_wall_collision_batch");
+    job_wait(job_parallel_for(0, count, DUNGEON_WALL_COLLISION_GRAIN, i_resolve_wall_collision_range, nullptr));
+    PEND("dungeon_resolve_wall_collision_batch");
+}
+
+// Each job owns whole words of the bitset, no two jobs ever write the same one
+S32 static i_update_visibility_range(U32 begin, U32 end, void *ctx) {
+    unused(ctx);
+
+    for (U32 word = begin; word < end; ++word) {
+        U64 occluded    = 0;
+        EID const first = word * 64;
+        EID const last  = glm::min(first + 64, (EID)WORLD_MAX_ENTITIES);
+        for (EID id = first; id < last; ++id) {
+            U32 const flags = g_world->flags[id];
+            if (!ENTITY_HAS_FLAG(flags, ENTITY_FLAG_IN_USE) || !ENTITY_HAS_FLAG(flags, ENTITY_FLAG_IN_FRUSTUM)) { continue; }
+            if (dungeon_is_entity_occluded(id)) { occluded |= 1ULL << (id - first); }
+        }
+        g_world->occluded_bits[word] = occluded;
+    }
+
+    return 0;
+}
+
+void dungeon_update_visibility() {
+    PBEGIN("dungeon_update_visibility");
+    job_wait(job_parallel_for(0, WORLD_ENTITY_WORD_COUNT, DUNGEON_VISIBILITY_GRAIN, i_update_visibility_range, nullptr));
+    PEND("dungeon_update_visibility");
+}
+
+void dungeon_load_from_text(C8 const *dun_text, MemoryType memory_type) {
+    // Only the first load saves, a second one without unload replaces the text dungeon and not the live one
+    if (!g_dungeon_from_text) {
+        g_dungeon_saved_data   = g_dungeon_data;
+        g_dungeon_saved_loaded = g_dungeon_loaded;
+        g_dungeon_from_text    = true;
+    }
+
+    g_dungeon_data = {};
+    i_parse_tiles(&g_dungeon_data, dun_text, memory_type);
+    if (g_dungeon_data.tiles.count > 0) {
+        i_build_tile_grid(&g_dungeon_data, memory_type);
+        i_build_pvs(&g_dungeon_data, memory_type);
+    }
+    g_dungeon_loaded = true;
+}
+
+void dungeon_unload() {
+    if (!g_dungeon_from_text) { return; }
+
+    // The live dungeon keeps its meshes and the camera stays put, nothing gets parsed again on the next draw
+    g_dungeon_data         = g_dungeon_saved_data;
+    g_dungeon_loaded       = g_dungeon_saved_loaded;
+    g_dungeon_saved_data   = {};
+    g_dungeon_saved_loaded = false;
+    g_dungeon_from_text    = false;
+}
+
+void dungeon_build_nav_graph(Nav *nav, MemoryType memory_type) {
+    if (!g_dungeon_data.floor_bits || nav->graph.source == g_dungeon_data.floor_bits) { return; }
+
+    // One cell per tile, the tile centers sit on multiples of the tile size
+    Vector2 const origin = {(F32)g_dungeon_data.grid_min_x * DUNGEON_TILE_SIZE, (F32)g_dungeon_data.grid_min_z * DUNGEON_TILE_SIZE};
+    nav_set_graph(nav, g_dungeon_data.grid_width, g_dungeon_data.grid_height, DUNGEON_TILE_SIZE, origin, g_dungeon_data.floor_bits, memory_type);
+
+    for (S32 z = 0; z < g_dungeon_data.grid_height; ++z) {
+        for (S32 x = 0; x < g_dungeon_data.grid_width; ++x) {
+            S32 const cell   = (z * g_dungeon_data.grid_width) + x;
+            BOOL const floor = (g_dungeon_data.floor_bits[cell / 64] & (1ULL << (cell % 64))) != 0;
+            BOOL const wall  = g_dungeon_data.wall_grid[cell] >= 0;
+            nav_set_cell_cost(nav, x, z, floor && !wall ? (U8)NAV_COST_FLAT : (U8)NAV_COST_BLOCKED);
+        }
+    }
+}
+
 void dungeon_draw_3d_sketch() {
     if (!g_dungeon_loaded) {
         g_dungeon_data = i_parse_dungeon("assets/dungeons/example.dun");
@@ -942,7 +1252,7 @@ void dungeon_draw_2d_dbg() {
             entity_color = GRAY; // Not in frustum - skip expensive occlusion check
         } else {
             // Only check occlusion for entities in frustum
-            BOOL const is_occluded = dungeon_is_entity_occluded(i);
+            BOOL const is_occluded = world_is_entity_occluded(i);
             entity_color = is_occluded ? RED : GREEN;
         }
 
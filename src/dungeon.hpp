@@ -1,11 +1,27 @@
 #pragma once
 
 #include "common.hpp"
+#include "memory.hpp"
 
 #include <raylib.h>
 
+fwd_decl(Nav);
+
 void dungeon_update(F32 dt);
 void dungeon_draw_3d_sketch();
 void dungeon_draw_2d_dbg();
-BOOL dungeon_is_entity_occluded(EID entity_id);
+BOOL dungeon_is_entity_occluded(EID entity_id);  // Ray against the walls, the draw passes read world_is_entity_occluded instead
+BOOL dungeon_is_potentially_visible(Vector3 from, Vector3 to);  // PVS lookup, false means the walls of the layout hide it for sure
+// Main thread, after the actor phase. Occlusion of every entity in the frustum into g_world->occluded_bits, in parallel.
+void dungeon_update_visibility();
+BOOL dungeon_is_position_on_floor(Vector3 position);
+BOOL dungeon_is_position_colliding(Vector3 position, F32 radius);  // Only looks at the tiles the radius overlaps
 Vector3 dungeon_resolve_wall_collision(EID entity_id, Vector3 desired_pos);
+// Main thread, after the actor phase. Slides every actor that moved this frame out of the walls, in parallel.
+void dungeon_resolve_wall_collision_batch();
+// Tiles and collision only, no meshes, so generated dungeons can be loaded headless for tests and benchmarks.
+// Stands in for the live dungeon until dungeon_unload() restores it.
+void dungeon_load_from_text(C8 const *dun_text, MemoryType memory_type);
+void dungeon_unload();
+// Floor tiles are walkable, everything else is blocked. Does nothing without a dungeon or if the graph is of this one already.
+void dungeon_build_nav_graph(Nav *nav, MemoryType memory_type);
@@ -17,64 +17,6 @@
 
 EditState static i_state = {};
 
-// ============================================================================
-// Multi-selection helper functions
-// ============================================================================
-
-void static world_clear_selection() {
-    g_world->selected_entity_count = 0;
-}
-
-void static world_add_to_selection(EID id) {
-    // Check if already selected
-    for (SZ i = 0; i < g_world->selected_entity_count; ++i) {
-        if (g_world->selected_entities[i] == id) {
-            return; // Already selected
-        }
-    }
-
-    // Add to selection
-    if (g_world->selected_entity_count < WORLD_MAX_ENTITIES) {
-        g_world->selected_entities[g_world->selected_entity_count++] = id;
-    }
-}
-
-void static world_remove_from_selection(EID id) {
-    for (SZ i = 0; i < g_world->selected_entity_count; ++i) {
-        if (g_world->selected_entities[i] == id) {
-            // Shift remaining elements
-            for (SZ j = i; j < g_world->selected_entity_count - 1; ++j) {
-                g_world->selected_entities[j] = g_world->selected_entities[j + 1];
-            }
-            g_world->selected_entity_count--;
-
-            return;
-        }
-    }
-}
-
-BOOL static world_is_selected(EID id) {
-    for (SZ i = 0; i < g_world->selected_entity_count; ++i) {
-        if (g_world->selected_entities[i] == id) {
-            return true;
-        }
-    }
-    return false;
-}
-
-void static world_set_single_selection(EID id) {
-    world_clear_selection();
-    world_add_to_selection(id);
-}
-
-void static world_toggle_selection(EID id) {
-    if (world_is_selected(id)) {
-        world_remove_from_selection(id);
-    } else {
-        world_add_to_selection(id);
-    }
-}
-
 // Check if entity position is inside screen-space rectangle
 BOOL static is_entity_in_screen_rect(EID id, Vector2 rect_min, Vector2 rect_max, Camera camera) {
     Vector3 const world_pos = g_world->position[id];
@@ -320,7 +262,7 @@ void edit_update(F32 dt, F32 dtu) {
 
             // Clear selection if not holding shift
             if (!shift_down) {
-                world_clear_selection();
+                world_selection_clear();
             }
 
             // Select all entities in rectangle
@@ -334,7 +276,7 @@ void edit_update(F32 dt, F32 dtu) {
                 }
 
                 if (is_entity_in_screen_rect(id, rect_min, rect_max, current_camera)) {
-                    world_add_to_selection(id);
+                    world_selection_add(id);
                 }
             }
         } else {
@@ -344,14 +286,15 @@ void edit_update(F32 dt, F32 dtu) {
             if (entity_id != INVALID_EID) {
                 if (shift_down) {
                     // Shift+click: toggle selection
-                    world_toggle_selection(entity_id);
+                    world_selection_toggle(entity_id);
                 } else {
                     // Normal click: replace selection
-                    world_set_single_selection(entity_id);
+                    world_selection_clear();
+                    world_selection_add(entity_id);
                 }
             } else if (!shift_down) {
                 // Clicked empty space without shift: clear selection
-                world_clear_selection();
+                world_selection_clear();
             }
         }
 
@@ -365,9 +308,10 @@ void edit_update(F32 dt, F32 dtu) {
 
         if (entity_id != INVALID_EID) {
             if (shift_down) {
-                world_toggle_selection(entity_id);
+                world_selection_toggle(entity_id);
             } else {
-                world_set_single_selection(entity_id);
+                world_selection_clear();
+                world_selection_add(entity_id);
             }
         }
     }
@@ -377,7 +321,7 @@ void edit_update(F32 dt, F32 dtu) {
         // Check if we clicked on an entity
         EID const clicked_entity = entity_find_at_mouse();
 
-        if (clicked_entity != INVALID_EID && !world_is_selected(clicked_entity)) {
+        if (clicked_entity != INVALID_EID && !world_is_entity_selected(clicked_entity)) {
             // We clicked on a different entity
             Vector3 const target_pos = g_world->position[clicked_entity];
             F32 const target_radius = g_world->radius[clicked_entity];
@@ -98,7 +98,8 @@ EID entity_create(EntityType type, C8 const *name, Vector3 position, F32 rotatio
     g_world->animation[id].prev_anim_frame  = 0;
     // Initialize bone matrices to identity
     for (auto &bone_matrice : g_animation_bones[id].bone_matrices) { bone_matrice = MatrixIdentity(); }
-    for (auto &prev_bone_matrice : g_animation_bones[id].prev_bone_matrices) { prev_bone_matrice = MatrixIdentity(); }
+    for (auto &prev_bone : g_animation_bones[id].prev_bone_trs) { prev_bone = {{0.0F, 0.0F, 0.0F}, QuaternionIdentity(), {1.0F, 1.0F, 1.0F}}; }
+    g_animation_bones[id].socket_mask = 0;
     // Auto-play first animation if model has animations
     if (g_world->animation[id].has_animations) {
         entity_set_animation(id, 0, true, 1.0F);
@@ -162,6 +163,11 @@ EID entity_create(EntityType type, C8 const *name, Vector3 position, F32 rotatio
     g_world->actor[id].movement.separation_force    = {0, 0, 0};
     g_world->actor[id].movement.last_position       = position;
     g_world->actor[id].movement.stuck_timer         = 0.0F;
+    g_world->actor[id].movement.path                = NAV_INVALID_HANDLE;
+    g_world->actor[id].movement.path_point          = 0;
+    g_world->actor[id].movement.path_goal           = {0, 0, 0};
+    g_world->actor[id].movement.path_is_flow_field  = false;
+    g_world->actor[id].movement.path_requested      = false;
     g_world->actor[id].movement.target_offset_angle = 0.0F;
     g_world->actor[id].movement.use_target_offset   = false;
     g_world->actor[id].movement.goal_type           = ENTITY_MOVEMENT_GOAL_NONE;
@@ -182,25 +188,23 @@ EID entity_create(EntityType type, C8 const *name, Vector3 position, F32 rotatio
     entity_set_scale(id, scale);
 
     grid_add_entity(id, type, g_world->position[id]);
+    world_register_entity(id);
 
     return id;
 }
 
 void entity_destroy(EID id) {
     // The entity we destroy might be in the selection - remove it
-    for (SZ i = 0; i < g_world->selected_entity_count; ++i) {
-        if (g_world->selected_entities[i] == id) {
-            // Shift remaining elements
-            for (SZ j = i; j < g_world->selected_entity_count - 1; ++j) {
-                g_world->selected_entities[j] = g_world->selected_entities[j + 1];
-            }
-            g_world->selected_entity_count--;
-            break;
-        }
+    world_selection_remove(id);
+
+    // If this entity was an actor targeting something, remove it from target tracking and let go of its path
+    if (g_world->type[id] == ENTITY_TYPE_NPC) {
+        entity_actor_clear_actor_target(id);
+        entity_actor_release_path(id);
     }
 
-    // If this entity was an actor targeting something, remove it from target tracking
-    if (g_world->type[id] == ENTITY_TYPE_NPC) { entity_actor_clear_actor_target(id); }
+    grid_remove_entity(id);
+    world_unregister_entity(id);
 
     g_world->flags[id] = 0;
     g_world->type[id]  = ENTITY_TYPE_NONE;
@@ -412,11 +416,11 @@ void entity_disable_talker(EID id) {
 }
 
 void entity_enable_actor(EID id) {
-    ENTITY_SET_FLAG(g_world->flags[id], ENTITY_FLAG_ACTOR);
+    world_set_entity_flag(id, ENTITY_FLAG_ACTOR);
 }
 
 void entity_disable_actor(EID id) {
-    ENTITY_CLEAR_FLAG(g_world->flags[id], ENTITY_FLAG_ACTOR);
+    world_clear_entity_flag(id, ENTITY_FLAG_ACTOR);
 }
 
 F32 entity_distance_to_position(EID id, Vector2 position) {
@@ -627,7 +631,8 @@ void entity_set_model(EID id, C8 const *model_name) {
 
     // Initialize bone matrices
     for (auto &bone_matrice : g_animation_bones[id].bone_matrices) { bone_matrice = MatrixIdentity(); }
-    for (auto &prev_bone_matrice : g_animation_bones[id].prev_bone_matrices) { prev_bone_matrice = MatrixIdentity(); }
+    for (auto &prev_bone : g_animation_bones[id].prev_bone_trs) { prev_bone = {{0.0F, 0.0F, 0.0F}, QuaternionIdentity(), {1.0F, 1.0F, 1.0F}}; }
+    g_animation_bones[id].socket_mask = 0;
 
     // Auto-play first animation if new model has animations
     if (g_world->animation[id].has_animations) {
@@ -649,10 +654,10 @@ void entity_set_animation(EID id, U32 anim_index, BOOL loop, F32 speed) {
     g_world->animation[id].prev_anim_index  = g_world->animation[id].anim_index;
     g_world->animation[id].prev_anim_frame  = g_world->animation[id].anim_frame;
 
-    // Store current bone matrices as previous state
-    ou_memcpy(g_animation_bones[id].prev_bone_matrices,
-              g_animation_bones[id].bone_matrices,
-              sizeof(Matrix) * ENTITY_MAX_BONES);
+    // Store current bone matrices as previous state, decomposed here once instead of every blended frame
+    for (S32 bone_id = 0; bone_id < ENTITY_MAX_BONES; ++bone_id) {
+        math_bone_trs_from_matrix(g_animation_bones[id].bone_matrices[bone_id], &g_animation_bones[id].prev_bone_trs[bone_id]);
+    }
 
     // Set new animation
     g_world->animation[id].anim_index = anim_index;
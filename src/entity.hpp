@@ -1,5 +1,6 @@
 #pragma once
 
+#include "asset.hpp"
 #include "common.hpp"
 #include "math.hpp"
 #include "talk.hpp"
@@ -70,7 +71,9 @@ struct EntityAnimation {
 // Computed bone matrices - stored separately from World (not saved by recorder)
 struct AnimationBoneData {
     Matrix bone_matrices[ENTITY_MAX_BONES];
-    Matrix prev_bone_matrices[ENTITY_MAX_BONES];
+    MathBoneTRS prev_bone_trs[ENTITY_MAX_BONES];  // Pose blended from, decomposed once when the animation changes
+    Matrix socket_transforms[A_MODEL_SOCKET_COUNT];  // Entity space, the entity transform is applied when they get read
+    U8 socket_mask;                                   // One bit per socket that has a transform
 };
 
 AnimationBoneData extern *g_animation_bones;
@@ -3,14 +3,17 @@
 #include "asset.hpp"
 #include "audio.hpp"
 #include "color.hpp"
+#include "command.hpp"
 #include "common.hpp"
 #include "cvar.hpp"
 #include "dungeon.hpp"
 #include "entity.hpp"
 #include "entity_spawn.hpp"
+#include "job.hpp"
 #include "log.hpp"
 #include "math.hpp"
 #include "message.hpp"
+#include "nav.hpp"
 #include "particles_3d.hpp"
 #include "profiler.hpp"
 #include "render.hpp"
@@ -69,10 +72,34 @@ void static inline i_play_agree(EID id) {
 }
 
 
-EID static inline i_find_target(EID searcher_id, EntityType target_type) {
-    Vector3 const searcher_pos = g_world->position[searcher_id];
+// Followers per target plus the reservations of the running entity_actor_assign_targets(), only read for vegetation.
+// Only the main thread writes them, between the search rounds.
+U16 static i_target_reservations[WORLD_MAX_ENTITIES];
+
+struct ActorTargetRequest {
+    EID id;
+    EntityType target_type;  // Turns into the lumberyard when there are no trees left but wood to deliver
+    EID target_id;           // INVALID_EID if nothing was found
+    F32 distance_sqr;        // To target_id, decides who gets a contested tree
+    BOOL fell_back;          // target_type switched to the lumberyard because of that
+};
+
+// One search round over the requests that are still pending
+struct ActorTargetRound {
+    ActorTargetRequest *requests;
+    U32 const *pending;
+};
+
+// Request that found a tree, sorted by target so all contenders of one tree sit next to each other
+struct ActorTargetCandidate {
+    EID target_id;
+    F32 distance_sqr;
+    EID id;
+    U32 request;
+};
 
-    if (target_type == ENTITY_TYPE_VEGETATION) { world_update_follower_cache(); }
+EID static inline i_find_target(EID searcher_id, EntityType target_type, F32 *out_distance_sqr) {
+    Vector3 const searcher_pos = g_world->position[searcher_id];
 
     EID best_candidate            = INVALID_EID;
     F32 best_distance_sq          = F32_MAX;
@@ -93,17 +120,14 @@ EID static inline i_find_target(EID searcher_id, EntityType target_type) {
 
             SZ const cell_index = grid_get_cell_index_xy(searcher_x, searcher_y);
             GridCell *cell      = &g_grid.cells[cell_index];
-            SZ const count      = cell->count_per_type[target_type];
-
-            for (SZ i = 0; i < count; ++i) {
-                EID const entity_id = cell->entities_by_type[target_type][i];
+            GRID_CELL_EACH(cell, target_type, entity_id) {
                 if (entity_id == searcher_id) { continue; }
 
                 if (!entity_is_valid(entity_id)) { continue; }
                 if (g_world->type[entity_id] != target_type) { continue; }
 
                 if (target_type == ENTITY_TYPE_VEGETATION) {
-                    S32 const followers = (S32)g_world->follower_cache.follower_counts[entity_id];
+                    S32 const followers = (S32)i_target_reservations[entity_id];
                     if (followers >= HARVEST_TARGET_MAX_FOLLOWERS) { continue; }
                 }
 
@@ -130,17 +154,14 @@ EID static inline i_find_target(EID searcher_id, EntityType target_type) {
 
                     SZ const cell_index = grid_get_cell_index_xy(cell_x, cell_y);
                     GridCell *cell      = &g_grid.cells[cell_index];
-                    SZ const count      = cell->count_per_type[target_type];
-
-                    for (SZ i = 0; i < count; ++i) {
-                        EID const entity_id = cell->entities_by_type[target_type][i];
+                    GRID_CELL_EACH(cell, target_type, entity_id) {
                         if (entity_id == searcher_id) { continue; }
 
                         if (!entity_is_valid(entity_id)) { continue; }
                         if (g_world->type[entity_id] != target_type) { continue; }
 
                         if (target_type == ENTITY_TYPE_VEGETATION) {
-                            S32 const followers = (S32)g_world->follower_cache.follower_counts[entity_id];
+                            S32 const followers = (S32)i_target_reservations[entity_id];
                             if (followers >= HARVEST_TARGET_MAX_FOLLOWERS) { continue; }
                         }
 
@@ -166,17 +187,14 @@ EID static inline i_find_target(EID searcher_id, EntityType target_type) {
 
                     SZ const cell_index = grid_get_cell_index_xy(cell_x, cell_y);
                     GridCell *cell      = &g_grid.cells[cell_index];
-                    SZ const count      = cell->count_per_type[target_type];
-
-                    for (SZ i = 0; i < count; ++i) {
-                        EID const entity_id = cell->entities_by_type[target_type][i];
+                    GRID_CELL_EACH(cell, target_type, entity_id) {
                         if (entity_id == searcher_id) { continue; }
 
                         if (!entity_is_valid(entity_id)) { continue; }
                         if (g_world->type[entity_id] != target_type) { continue; }
 
                         if (target_type == ENTITY_TYPE_VEGETATION) {
-                            S32 const followers = (S32)g_world->follower_cache.follower_counts[entity_id];
+                            S32 const followers = (S32)i_target_reservations[entity_id];
                             if (followers >= HARVEST_TARGET_MAX_FOLLOWERS) { continue; }
                         }
 
@@ -196,6 +214,7 @@ EID static inline i_find_target(EID searcher_id, EntityType target_type) {
         if (found_in_ring) { break; }
     }
 
+    *out_distance_sqr = best_distance_sq;
     return best_candidate;
 }
 
@@ -261,11 +280,7 @@ Vector3 static inline i_calculate_separation_force(EID id) {
 
             // Process relevant entity types directly
             for (EntityType other_type : relevant_types) {
-                SZ const count = cell->count_per_type[other_type];
-                if (count == 0) { continue; }
-
-                for (SZ i = 0; i < count; ++i) {
-                    EID const other_id = cell->entities_by_type[other_type][i];
+                GRID_CELL_EACH(cell, other_type, other_id) {
                     if (other_id == id) { continue; }
 
                     // Cache other entity's position and radius - single memory access
@@ -397,9 +412,7 @@ U32 static inline i_count_harvesters_for_target(EID target_id, F32 *lowest_timer
             SZ const cell_index = grid_get_cell_index_xy(cell_x, cell_y);
             GridCell *cell      = &g_grid.cells[cell_index];
 
-            SZ const count = cell->count_per_type[ENTITY_TYPE_NPC];
-            for (SZ i = 0; i < count; ++i) {
-                EID const entity_id = cell->entities_by_type[ENTITY_TYPE_NPC][i];
+            GRID_CELL_EACH(cell, ENTITY_TYPE_NPC, entity_id) {
 
                 if (!ENTITY_HAS_FLAG(g_world->flags[entity_id], ENTITY_FLAG_IN_USE)) { continue; }
 
@@ -475,6 +488,7 @@ void static inline i_movement_set_goal_move_to_position(EID id, Vector3 position
     movement->target_gen      = 0;
     movement->goal_completed  = false;
     movement->goal_failed     = false;
+    movement->path_requested  = true;
 
     i_movement_transition_to_state(id, ENTITY_MOVEMENT_STATE_MOVING);
 }
@@ -487,6 +501,7 @@ void static inline i_movement_set_goal_move_to_target(EID id, EID target_id, U32
     movement->target_gen     = target_gen;
     movement->goal_completed = false;
     movement->goal_failed    = false;
+    movement->path_requested = true;
 
     if (i_is_target_valid(target_id, target_gen)) {
         movement->target_position = g_world->position[target_id];
@@ -531,6 +546,70 @@ void static inline i_movement_set_goal_stop(EID id) {
     i_movement_transition_to_state(id, ENTITY_MOVEMENT_STATE_STOPPING);
 }
 
+// In the dungeon the walls get resolved for all actors at once after the actor phase, we only remember where we came from
+void static inline i_movement_set_position(EID id, Vector3 new_position) {
+    EntityMovementController *movement = &g_world->actor[id].movement;
+    if (g_scenes.current_scene_type == SCENE_DUNGEON && !movement->wall_collision_pending) {
+        movement->wall_collision_from    = g_world->position[id];
+        movement->wall_collision_pending = true;
+    }
+
+    entity_set_position(id, new_position);
+}
+
+F32 static inline i_distance_sqr_xz(Vector3 a, Vector3 b) {
+    F32 const dx = a.x - b.x;
+    F32 const dz = a.z - b.z;
+    return (dx * dx) + (dz * dz);
+}
+
+// Where to head this frame: the next waypoint of the path or flow field, straight at the target without one or once it
+// is close. Runs in the actor jobs, the nav only gets read and a new path only gets asked for.
+Vector3 static inline i_movement_steer_position(EID id) {
+    EntityMovementController *movement = &g_world->actor[id].movement;
+    Nav const *nav                     = &g_world->nav;
+    Vector3 const position             = g_world->position[id];
+    Vector3 const target               = movement->target_position;
+    if (movement->path == NAV_INVALID_HANDLE) { return target; }
+
+    F32 const arrive_distance = nav->graph.cell_size * ACTOR_PATH_ARRIVE_CELLS;
+    F32 const arrive_sqr      = arrive_distance * arrive_distance;
+    if (i_distance_sqr_xz(position, target) < arrive_sqr) { return target; }
+
+    // Followed entities move, once the target is a few cells away from where the path leads it needs a new one
+    if (i_distance_sqr_xz(movement->path_goal, target) > arrive_sqr) {
+        movement->path_requested = true;
+        return target;
+    }
+
+    Vector3 waypoint = target;
+    if (movement->path_is_flow_field) {
+        if (nav_flow_field_steer(nav, movement->path, position, &waypoint)) { return waypoint; }
+        if (nav_get_flow_field_state(nav, movement->path) == NAV_STATE_FREE) { movement->path_requested = true; }
+        return target;
+    }
+
+    // Still queued or no way there walks straight, a stale handle (recorder seek) asks again
+    NavPath const *path = nav_get_path(nav, movement->path);
+    if (!path) {
+        if (nav_get_state(nav, movement->path) == NAV_STATE_FREE) { movement->path_requested = true; }
+        return target;
+    }
+
+    F32 const cell_sqr = nav->graph.cell_size * nav->graph.cell_size;
+    while (movement->path_point + 1 < path->count && i_distance_sqr_xz(position, path->points[movement->path_point]) < cell_sqr) { movement->path_point++; }
+
+    BOOL const is_last = movement->path_point + 1 >= path->count;
+    if (is_last && !path->partial) { return target; }
+
+    // The end of a partial path is not the goal, the rest gets searched from there
+    waypoint = path->points[glm::min(movement->path_point, path->count - 1)];
+    if (is_last && i_distance_sqr_xz(position, waypoint) < cell_sqr) { movement->path_requested = true; }
+
+    waypoint.y = position.y;
+    return waypoint;
+}
+
 BOOL static inline i_movement_is_goal_completed(EID id) {
     return g_world->actor[id].movement.goal_completed;
 }
@@ -557,7 +636,7 @@ void static inline i_evaluate_behavior_transitions(EID id) {
 
         case ENTITY_BEHAVIOR_STATE_GOING_TO_TARGET: {
             if (movement->goal_failed) {
-                entity_actor_search_and_transition_to_target(id, "Movement goal failed");
+                entity_actor_request_target(id, "Movement goal failed");
             } else if (movement->goal_completed) {
                 // Decide what to do based on target type
                 if (behavior->target_entity_type == ENTITY_TYPE_BUILDING_LUMBERYARD) {
@@ -565,7 +644,7 @@ void static inline i_evaluate_behavior_transitions(EID id) {
                         entity_actor_behavior_transition_to_state(id, ENTITY_BEHAVIOR_STATE_DELIVERING_TO_LUMBERYARD, "Reached lumberyard with wood");
                     } else {
                         behavior->target_entity_type = ENTITY_TYPE_VEGETATION;
-                        entity_actor_search_and_transition_to_target(id, "Reached lumberyard but have no wood");
+                        entity_actor_request_target(id, "Reached lumberyard but have no wood");
                     }
                 } else if (behavior->target_entity_type == ENTITY_TYPE_VEGETATION) {
                     entity_actor_behavior_transition_to_state(id, ENTITY_BEHAVIOR_STATE_HARVESTING_TARGET, "Reached vegetation and starting harvest");
@@ -581,10 +660,10 @@ void static inline i_evaluate_behavior_transitions(EID id) {
             if (i_actor_is_full(id)) {
                 // Check if full
                 behavior->target_entity_type = ENTITY_TYPE_BUILDING_LUMBERYARD;
-                entity_actor_search_and_transition_to_target(id, TS("Became full (%zu/%d)", behavior->wood_count, ACTOR_WOOD_COLLECTED_MAX)->c);
+                entity_actor_request_target(id, TS("Became full (%zu/%d)", behavior->wood_count, ACTOR_WOOD_COLLECTED_MAX)->c);
             } else if (!i_is_target_valid(behavior->target_id, behavior->target_gen)) {
                 // Check if gone
-                entity_actor_search_and_transition_to_target(id, "Target disappeared");
+                entity_actor_request_target(id, "Target disappeared");
             } else if (behavior->action_timer <= 0.0F) {
                 // Harvest complete
                 if (c_world__verbose_actors) {
@@ -613,14 +692,14 @@ void static inline i_evaluate_behavior_transitions(EID id) {
 
                 world_notify_actors_target_destroyed(behavior->target_id);
 
-                entity_actor_search_and_transition_to_target(id, TS("Harvested tree, wood: %zu/%d", behavior->wood_count, ACTOR_WOOD_COLLECTED_MAX)->c);
+                entity_actor_request_target(id, TS("Harvested tree, wood: %zu/%d", behavior->wood_count, ACTOR_WOOD_COLLECTED_MAX)->c);
             }
         } break;
 
         case ENTITY_BEHAVIOR_STATE_DELIVERING_TO_LUMBERYARD: {
             if (!i_is_target_valid(behavior->target_id, behavior->target_gen)) {
                 // Check if gone
-                entity_actor_search_and_transition_to_target(id, "Target disappeared");
+                entity_actor_request_target(id, "Target disappeared");
             } else if (behavior->action_timer <= 0.0F) {
                 // Delivery complete
                 SZ const wood_delivered = behavior->wood_count;
@@ -689,7 +768,7 @@ void static inline i_evaluate_behavior_transitions(EID id) {
                 entity_actor_clear_actor_target(id);
 
                 behavior->target_entity_type = ENTITY_TYPE_VEGETATION;
-                entity_actor_search_and_transition_to_target(id, TS("Delivered %zu wood", wood_delivered)->c);
+                entity_actor_request_target(id, TS("Delivered %zu wood", wood_delivered)->c);
             }
         } break;
 
@@ -732,8 +811,7 @@ void static inline i_evaluate_behavior_transitions(EID id) {
 }
 
 void entity_actor_init() {
-    g_world->follower_cache.dirty = true;
-    world_update_follower_cache();
+    for (EID i = 0; i < WORLD_MAX_ENTITIES; ++i) { entity_actor_clear_target_tracker(i); }
 }
 
 void entity_actor_update(EID id, F32 dt) {
@@ -741,8 +819,8 @@ void entity_actor_update(EID id, F32 dt) {
     EntityBehaviorController *behavior = &actor->behavior;
     EntityMovementController *movement = &actor->movement;
 
-    // First evaluate if any state transitions are needed
-    i_evaluate_behavior_transitions(id);
+    // First evaluate if any state transitions are needed, unless we are still waiting for a target
+    if (!behavior->target_requested) { i_evaluate_behavior_transitions(id); }
 
     // Then update the current states
     switch (movement->state) {
@@ -755,13 +833,7 @@ void entity_actor_update(EID id, F32 dt) {
                 Vector3 const repulsion_velocity = Vector3Scale(separation, idle_repulsion_strength);
                 Vector3 new_position = Vector3Add(g_world->position[id], Vector3Scale(repulsion_velocity, dt));
                 new_position.y = math_get_terrain_height(g_world->base_terrain, new_position.x, new_position.z);
-
-                // Resolve dungeon wall collision with sliding if in dungeon scene
-                if (g_scenes.current_scene_type == SCENE_DUNGEON) {
-                    new_position = dungeon_resolve_wall_collision(id, new_position);
-                }
-
-                entity_set_position(id, new_position);
+                i_movement_set_position(id, new_position);
             }
 
             switch (movement->goal_type) {
@@ -821,8 +893,9 @@ void entity_actor_update(EID id, F32 dt) {
             }
             movement->last_position = current_pos;
 
-            // Calculate desired movement direction
-            Vector3 const desired_direction = Vector3Normalize(direction);
+            // Calculate desired movement direction, along the path if there is one
+            Vector3 const steer_position    = i_movement_steer_position(id);
+            Vector3 const desired_direction = Vector3Normalize(Vector3Subtract(steer_position, current_pos));
             F32 target_speed                = movement->speed;
 
             // Apply separation force
@@ -846,13 +919,7 @@ void entity_actor_update(EID id, F32 dt) {
             // Apply movement
             Vector3 new_position = Vector3Add(g_world->position[id], Vector3Scale(desired_velocity, dt));
             new_position.y       = math_get_terrain_height(g_world->base_terrain, new_position.x, new_position.z);
-
-            // Resolve dungeon wall collision with sliding if in dungeon scene
-            if (g_scenes.current_scene_type == SCENE_DUNGEON) {
-                new_position = dungeon_resolve_wall_collision(id, new_position);
-            }
-
-            entity_set_position(id, new_position);
+            i_movement_set_position(id, new_position);
 
             movement->velocity = desired_velocity;
 
@@ -932,8 +999,7 @@ void entity_actor_update(EID id, F32 dt) {
                 F32 lowest_timer           = F32_MAX;
                 U32 const harvesters_count = i_count_harvesters_for_target(target_id, &lowest_timer);
 
-                // Thread-safe scale modification (only one harvester modifies scale at a time)
-                mtx_lock(&g_world->mt_sync.entity_mutation_mutex);
+                // Only the harvester with the lowest timer drives the shrinking, the scale gets applied at the command flush
                 if (behavior->action_timer == lowest_timer) {
                     F32 const progress      = 1.0F - (behavior->action_timer / ACTION_DURATION_HARVEST);
                     // Use expo ease-in to keep scale high until the very end, then drop quickly
@@ -951,8 +1017,12 @@ void entity_actor_update(EID id, F32 dt) {
                         scale_factor              += shake;
                     }
 
-                    Vector3 const new_scale = Vector3Scale(g_world->original_scale[target_id], scale_factor);
-                    entity_set_scale(target_id, new_scale);
+                    Command cmd                  = {};
+                    cmd.type                     = COMMAND_TYPE_ENTITY_SCALE;
+                    cmd.entity_scale.id          = target_id;
+                    cmd.entity_scale.generation  = behavior->target_gen;
+                    cmd.entity_scale.scale       = Vector3Scale(g_world->original_scale[target_id], scale_factor);
+                    command_push(&cmd);
 
                     // Frame-rate independent particle spawning during harvest
                     Vector3 const target_pos        = g_world->position[target_id];
@@ -963,7 +1033,6 @@ void entity_actor_update(EID id, F32 dt) {
                         behavior->particle_spawn_timer -= spawn_interval;
                     }
                 }
-                mtx_unlock(&g_world->mt_sync.entity_mutation_mutex);
 
                 behavior->action_timer -= dt * (F32)harvesters_count;
             }
@@ -1097,39 +1166,150 @@ void entity_actor_behavior_transition_to_state(EID id, EntityBehaviorState new_s
     }
 
     behavior->state = new_state;
-
-    world_mark_follower_cache_dirty();
 }
 
-void entity_actor_search_and_transition_to_target(EID id, C8 const *reason) {
+void entity_actor_request_target(EID id, C8 const *reason) {
     EntityBehaviorController *behavior = &g_world->actor[id].behavior;
 
     // Check if we should switch to lumberyard
     if (behavior->target_entity_type == ENTITY_TYPE_VEGETATION && i_actor_is_full(id)) { behavior->target_entity_type = ENTITY_TYPE_BUILDING_LUMBERYARD; }
 
-    EID const target_id = i_find_target(id, behavior->target_entity_type);
+    // The reason has to outlive this frame's transient memory
+    _assert_(ou_strlen(reason) < ENTITY_STATE_REASON_MAX, "Reason string exceeds limit");
+    ou_strncpy(behavior->state_reason, reason, ENTITY_STATE_REASON_MAX - 1);
+    behavior->state_reason[ENTITY_STATE_REASON_MAX - 1] = '\0';
 
-    if (target_id != INVALID_EID) {
-        Vector3 const actor_pos  = g_world->position[id];
-        Vector3 const target_pos = g_world->position[target_id];
+    behavior->target_requested = true;
+}
 
-        behavior->target_position = target_pos;
-        behavior->target_id       = target_id;
-        behavior->target_gen      = g_world->generation[target_id];
-        world_target_tracker_add(target_id, id);
+// The only place a target gets set, the old one is released first so the follower counts stay exact
+void static i_set_actor_target(EID actor_id, EID target_id) {
+    EntityBehaviorController *behavior = &g_world->actor[actor_id].behavior;
+    entity_actor_clear_actor_target(actor_id);
 
-        C8 const *type_name = entity_type_to_cstr(behavior->target_entity_type);
-        entity_actor_behavior_transition_to_state(id, ENTITY_BEHAVIOR_STATE_GOING_TO_TARGET, TS("%s - Found %s %04d", reason, type_name, target_id)->c);
-    } else {
-        // No target found - smart fallback
-        if (behavior->target_entity_type == ENTITY_TYPE_VEGETATION && behavior->wood_count > 0) {
-            behavior->target_entity_type = ENTITY_TYPE_BUILDING_LUMBERYARD;
-            entity_actor_search_and_transition_to_target(id, TS("No trees found, delivering wood (%zu)", behavior->wood_count)->c);
+    behavior->target_id  = target_id;
+    behavior->target_gen = g_world->generation[target_id];
+    world_target_tracker_add(target_id, actor_id);
+}
+
+// Nearest first and the lower id on a tie, whoever wins does not depend on which thread searched for whom
+S32 static i_compare_candidates(void const *a, void const *b) {
+    auto const *x = (ActorTargetCandidate const *)a;
+    auto const *y = (ActorTargetCandidate const *)b;
+    if (x->target_id != y->target_id)       { return x->target_id < y->target_id ? -1 : 1; }
+    if (x->distance_sqr != y->distance_sqr) { return x->distance_sqr < y->distance_sqr ? -1 : 1; }
+    return (x->id > y->id) - (x->id < y->id);
+}
+
+// Searches only, the reservations stay untouched until the round is over
+S32 static i_assign_targets_range(U32 begin, U32 end, void *ctx) {
+    auto const *round = (ActorTargetRound *)ctx;
+
+    for (U32 idx = begin; idx < end; ++idx) {
+        ActorTargetRequest *request = &round->requests[round->pending[idx]];
+        request->target_id          = i_find_target(request->id, request->target_type, &request->distance_sqr);
+    }
+
+    return 0;
+}
+
+SZ entity_actor_assign_targets() {
+    PBEGIN("entity_actor_assign_targets");
+
+    // The actor list is in swap-remove order, not by id. That order only follows from what happened to the world, so
+    // the write back below is the same every run. The targets themselves are decided by (distance, id) further down.
+    auto *requests = mmta(ActorTargetRequest *, sizeof(ActorTargetRequest) * (g_world->actor_list.count + 1));
+    U32 count      = 0;
+    WORLD_LIST_EACH(&g_world->actor_list, id) {
+        EntityBehaviorController const *behavior = &g_world->actor[id].behavior;
+        if (!behavior->target_requested) { continue; }
+
+        requests[count++] = {id, behavior->target_entity_type, INVALID_EID, 0.0F, false};
+    }
+
+    if (count == 0) {
+        PEND("entity_actor_assign_targets");
+        return 0;
+    }
+
+    // The reservations start out as the current followers
+    for (EID i = 0; i < WORLD_MAX_ENTITIES; ++i) { i_target_reservations[i] = (U16)g_world->target_trackers[i].count.load(std::memory_order_relaxed); }
+
+    auto *pending     = mmta(U32 *, sizeof(U32) * count);
+    auto *candidates  = mmta(ActorTargetCandidate *, sizeof(ActorTargetCandidate) * count);
+    U32 pending_count = count;
+    for (U32 idx = 0; idx < count; ++idx) { pending[idx] = idx; }
+
+    // Everyone pending searches in parallel, then the main thread hands out the trees. The losers of a tree search
+    // again in the next round, by then it is full and gets skipped. Every round with a loser fills up a tree, so this ends.
+    while (pending_count > 0) {
+        ActorTargetRound round = {requests, pending};
+        job_wait(job_parallel_for(0, pending_count, ENTITY_ACTOR_ASSIGN_TARGETS_GRAIN, i_assign_targets_range, &round));
+
+        U32 next_pending_count = 0;
+        U32 candidate_count    = 0;
+        for (U32 idx = 0; idx < pending_count; ++idx) {
+            ActorTargetRequest *request = &requests[pending[idx]];
+
+            // No target found - smart fallback, the lumberyard gets searched in the next round
+            if (request->target_id == INVALID_EID) {
+                if (request->target_type == ENTITY_TYPE_VEGETATION && g_world->actor[request->id].behavior.wood_count > 0) {
+                    request->target_type          = ENTITY_TYPE_BUILDING_LUMBERYARD;
+                    request->fell_back            = true;
+                    pending[next_pending_count++] = pending[idx];
+                }
+                continue;
+            }
+
+            // Only trees have a follower limit
+            if (request->target_type != ENTITY_TYPE_VEGETATION) { continue; }
+            candidates[candidate_count++] = {request->target_id, request->distance_sqr, request->id, pending[idx]};
+        }
+
+        if (candidate_count > 1) { qsort(candidates, candidate_count, sizeof(ActorTargetCandidate), i_compare_candidates); }
+
+        for (U32 idx = 0; idx < candidate_count; ++idx) {
+            ActorTargetCandidate const *candidate = &candidates[idx];
+            if (i_target_reservations[candidate->target_id] < HARVEST_TARGET_MAX_FOLLOWERS) {
+                i_target_reservations[candidate->target_id]++;
+                continue;
+            }
+
+            requests[candidate->request].target_id = INVALID_EID;
+            pending[next_pending_count++]          = candidate->request;
+        }
+
+        pending_count = next_pending_count;
+    }
+
+    // Write back, the transitions touch trackers of other entities so this stays on the main thread
+    for (U32 idx = 0; idx < count; ++idx) {
+        ActorTargetRequest const *request  = &requests[idx];
+        EID const id                       = request->id;
+        EntityBehaviorController *behavior = &g_world->actor[id].behavior;
+
+        command_begin(COMMAND_SOURCE_ACTOR, id);
+
+        behavior->target_requested   = false;
+        behavior->target_entity_type = request->target_type;
+
+        String const *reason = request->fell_back ? TS("No trees found, delivering wood (%zu)", behavior->wood_count) : TS("%s", behavior->state_reason);
+        C8 const *type_name  = entity_type_to_cstr(request->target_type);
+
+        if (request->target_id != INVALID_EID) {
+            behavior->target_position = g_world->position[request->target_id];
+            i_set_actor_target(id, request->target_id);
+
+            entity_actor_behavior_transition_to_state(id, ENTITY_BEHAVIOR_STATE_GOING_TO_TARGET, TS("%s - Found %s %04d", reason->c, type_name, request->target_id)->c);
         } else {
-            C8 const *type_name = entity_type_to_cstr(behavior->target_entity_type);
-            entity_actor_behavior_transition_to_state(id, ENTITY_BEHAVIOR_STATE_IDLE, TS("%s - No %ss found, going idle", reason, type_name)->c);
+            entity_actor_behavior_transition_to_state(id, ENTITY_BEHAVIOR_STATE_IDLE, TS("%s - No %ss found, going idle", reason->c, type_name)->c);
         }
     }
+    command_end();
+
+    PEND("entity_actor_assign_targets");
+
+    return count;
 }
 
 void entity_actor_start_looking_for_target(EID id, EntityType target_type) {
@@ -1143,14 +1323,15 @@ void entity_actor_start_looking_for_target(EID id, EntityType target_type) {
     i_play_agree(id);
 
     C8 const *type_name = entity_type_to_cstr(behavior->target_entity_type);
-    entity_actor_search_and_transition_to_target(id, TS("Commanded to search for %ss", type_name)->c);
+    entity_actor_request_target(id, TS("Commanded to search for %ss", type_name)->c);
 }
 
 void entity_actor_set_move_target(EID id, Vector3 target) {
     if (!ENTITY_HAS_FLAG(g_world->flags[id], ENTITY_FLAG_ACTOR)) { return; }
 
     EntityBehaviorController *behavior = &g_world->actor[id].behavior;
-    behavior->target_position = target;
+    behavior->target_position  = target;
+    behavior->target_requested = false;
     entity_actor_clear_actor_target(id);
     behavior->target_entity_type = ENTITY_TYPE_NONE;
 
@@ -1166,10 +1347,9 @@ void entity_actor_set_attack_target_npc(EID attacker_id, EID target_id) {
     if (attacker_id == target_id)                                         { return; }
 
     EntityBehaviorController *behavior = &g_world->actor[attacker_id].behavior;
-    behavior->target_id          = target_id;
-    behavior->target_gen         = g_world->generation[target_id];
     behavior->target_entity_type = ENTITY_TYPE_NPC;
-    world_target_tracker_add(target_id, attacker_id);
+    behavior->target_requested   = false;
+    i_set_actor_target(attacker_id, target_id);
 
     i_play_agree(attacker_id);
 
@@ -1186,18 +1366,104 @@ void entity_actor_set_attack_target_npc(EID attacker_id, EID target_id) {
 
 void entity_actor_clear_target_tracker(EID target_id) {
     if (target_id >= WORLD_MAX_ENTITIES) { return; }
-    g_world->target_trackers[target_id].count = 0;
+
+    // Followers that still point at it fail the generation check from here on and do not get uncounted again
+    auto *tracker = &g_world->target_trackers[target_id];
+    for (auto &slot : tracker->actors) { slot.store(0, std::memory_order_relaxed); }
+    tracker->count.store(0, std::memory_order_relaxed);
 }
 
 void entity_actor_clear_actor_target(EID actor_id) {
     EntityBehaviorController *behavior = &g_world->actor[actor_id].behavior;
     if (behavior->target_id != INVALID_EID) {
-        world_target_tracker_remove(behavior->target_id, actor_id);
+        // A destroyed target already dropped its followers
+        if (i_is_target_valid(behavior->target_id, behavior->target_gen)) { world_target_tracker_remove(behavior->target_id, actor_id); }
         behavior->target_id  = INVALID_EID;
         behavior->target_gen = 0;
     }
 }
 
+// Shared destinations get a flow field, everyone delivering to the same lumberyard walks the same way
+BOOL static inline i_is_shared_destination(EID target_id) {
+    return target_id != INVALID_EID && g_world->type[target_id] == ENTITY_TYPE_BUILDING_LUMBERYARD;
+}
+
+void static i_release_path(Nav *nav, EntityMovementController *movement) {
+    if (movement->path == NAV_INVALID_HANDLE) { return; }
+
+    if (movement->path_is_flow_field) {
+        nav_release_flow_field(nav, movement->path);
+    } else {
+        nav_release(nav, movement->path);
+    }
+    movement->path               = NAV_INVALID_HANDLE;
+    movement->path_point         = 0;
+    movement->path_is_flow_field = false;
+}
+
+SZ entity_actor_request_paths() {
+    Nav *nav = &g_world->nav;
+    if (!nav_has_graph(nav)) { return 0; }
+
+    PBEGIN("entity_actor_request_paths");
+
+    F32 const arrive_distance = nav->graph.cell_size * ACTOR_PATH_ARRIVE_CELLS;
+    SZ requested              = 0;
+    WORLD_LIST_EACH(&g_world->actor_list, id) {
+        EntityMovementController *movement = &g_world->actor[id].movement;
+        if (movement->goal_type != ENTITY_MOVEMENT_GOAL_MOVE_TO_POSITION || movement->goal_completed || movement->goal_failed) {
+            movement->path_requested = false;
+            i_release_path(nav, movement);
+            continue;
+        }
+        if (!movement->path_requested) { continue; }
+
+        movement->path_requested = false;
+        i_release_path(nav, movement);
+
+        // Close enough to walk straight
+        Vector3 const position = g_world->position[id];
+        Vector3 const goal     = movement->target_position;
+        movement->path_goal    = goal;
+        if (i_distance_sqr_xz(position, goal) < arrive_distance * arrive_distance) { continue; }
+
+        if (i_is_shared_destination(movement->target_id)) {
+            movement->path               = nav_acquire_flow_field(nav, g_world->position[movement->target_id]);
+            movement->path_is_flow_field = movement->path != NAV_INVALID_HANDLE;
+        }
+        if (movement->path == NAV_INVALID_HANDLE) { movement->path = nav_request_path(nav, position, goal); }
+
+        // Every request slot is taken, walk straight for now and ask again next frame
+        if (movement->path == NAV_INVALID_HANDLE) {
+            movement->path_requested = true;
+            continue;
+        }
+        requested++;
+    }
+
+    PEND("entity_actor_request_paths");
+
+    return requested;
+}
+
+void entity_actor_release_path(EID id) {
+    g_world->actor[id].movement.path_requested = false;
+    i_release_path(&g_world->nav, &g_world->actor[id].movement);
+}
+
+void entity_actor_reset_paths() {
+    nav_reset(&g_world->nav);
+
+    // Whatever the actors hold now belongs to the nav as it was before, not to the one we just reset
+    WORLD_LIST_EACH(&g_world->actor_list, id) {
+        EntityMovementController *movement = &g_world->actor[id].movement;
+        movement->path_requested          |= movement->path != NAV_INVALID_HANDLE;
+        movement->path                     = NAV_INVALID_HANDLE;
+        movement->path_point               = 0;
+        movement->path_is_flow_field       = false;
+    }
+}
+
 C8 const *entity_actor_behavior_state_to_cstr(EntityBehaviorState state) {
     return i_behavior_state_strings[state];
 }
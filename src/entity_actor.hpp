@@ -2,6 +2,7 @@
 
 #include "common.hpp"
 #include "ease.hpp"
+#include "nav.hpp"
 
 #include <raylib.h>
 
@@ -12,9 +13,11 @@ fwd_decl_enum(EntityType, U8);
 #define ACTION_DURATION_HARVEST 3.0F
 #define ACTOR_WOOD_COLLECTED_MAX 3
 #define ACTOR_MAX_STUCK_TIME 2.0F
+#define ACTOR_PATH_ARRIVE_CELLS 2.0F  // Closer than this many nav cells to the target the actor walks straight
 #define ATTACK_DAMAGE 25.0F
 #define ATTACK_RANGE 3.0F
 #define ATTACK_RANGE_EXIT 6.0F
+#define ENTITY_ACTOR_ASSIGN_TARGETS_GRAIN 16  // Ring searches are expensive, keep the chunks small
 #define HARVEST_TARGET_MAX_FOLLOWERS 3
 #define MAX_ACTORS_PER_TARGET 8
 
@@ -66,7 +69,14 @@ struct EntityMovementController {
 
     Vector3 separation_force;
     Vector3 last_position;
+    Vector3 wall_collision_from;  // Position before the first move this frame
+    BOOL wall_collision_pending;  // Moved in the dungeon, see dungeon_resolve_wall_collision_batch()
     F32 stuck_timer;
+    NavHandle path;           // Path or flow field to target_position, straight at it while NAV_INVALID_HANDLE
+    U32 path_point;           // Next waypoint of the path
+    Vector3 path_goal;        // target_position when the path got requested, too far off asks for a new one
+    BOOL path_is_flow_field;
+    BOOL path_requested;      // Set by new goals and the actor jobs, see entity_actor_request_paths()
     F32 target_offset_angle;
     BOOL use_target_offset;
 
@@ -96,6 +106,7 @@ struct EntityBehaviorController {
     Vector3 target_position;
     EID target_id;
     U32 target_gen;
+    BOOL target_requested;  // Waiting for entity_actor_assign_targets(), state_reason holds the reason
 
     F32 action_timer;
     F32 particle_spawn_timer;  // For frame-rate independent particle spawning
@@ -111,12 +122,21 @@ struct EntityActor {
 void entity_actor_init();
 void entity_actor_update(EID id, F32 dt);
 void entity_actor_behavior_transition_to_state(EID id, EntityBehaviorState new_state, C8 const *reason);
-void entity_actor_search_and_transition_to_target(EID id, C8 const *reason);
+// Safe from the actor jobs, the search itself happens in the next entity_actor_assign_targets()
+void entity_actor_request_target(EID id, C8 const *reason);
+// Main thread, once per frame after grid_populate(). Returns the number of handled requests.
+SZ entity_actor_assign_targets();
 void entity_actor_start_looking_for_target(EID id, EntityType target_type);
 void entity_actor_set_move_target(EID id, Vector3 target);
 void entity_actor_set_attack_target_npc(EID attacker_id, EID target_id);
 void entity_actor_clear_target_tracker(EID target_id);
 void entity_actor_clear_actor_target(EID actor_id);
+// Main thread, after entity_actor_assign_targets(). Hands the path requests of the actors to g_world->nav and lets go of
+// the paths of actors that stopped moving. Returns the number of requested paths.
+SZ entity_actor_request_paths();
+void entity_actor_release_path(EID id);
+// Drops every request and flow field, for when the actors got their handles from somewhere else (recorder seek)
+void entity_actor_reset_paths();
 
 C8 const *entity_actor_behavior_state_to_cstr(EntityBehaviorState state);
 C8 const *entity_actor_movement_state_to_cstr(EntityMovementState state);
@@ -2,6 +2,7 @@
 #include "assert.hpp"
 #include "asset.hpp"
 #include "color.hpp"
+#include "command.hpp"
 #include "entity.hpp"
 #include "entity_actor.hpp"
 #include "input.hpp"
@@ -16,113 +17,49 @@
 #include <raymath.h>
 #include <glm/gtc/type_ptr.hpp>
 
-EntitySpawnCommandQueue static g_entity_spawn_command_queue = {};
-
-void static i_entity_spawn_queue_command(EntitySpawnCommandType type, SZ count, BOOL notify) {
-    // Lazy mutex initialization
-    BOOL static mutex_initialized = false;
-    if (!mutex_initialized) {
-        mtx_init(&g_entity_spawn_command_queue.mutex, mtx_plain);
-        mutex_initialized = true;
-    }
-
-    mtx_lock(&g_entity_spawn_command_queue.mutex);
-    {
-        if (g_entity_spawn_command_queue.count < ENTITY_SPAWN_COMMAND_QUEUE_MAX) {
-            EntitySpawnCommand *cmd = &g_entity_spawn_command_queue.commands[g_entity_spawn_command_queue.count++];
-            cmd->type = type;
-            cmd->vegetation.count = count;
-            cmd->vegetation.notify = notify;
-        } else {
-            llt("EntitySpawn command queue full, dropping command");
-        }
-    }
-    mtx_unlock(&g_entity_spawn_command_queue.mutex);
-}
-
 void entity_spawn_queue_random_vegetation_on_terrain(SZ count, BOOL notify) {
-    i_entity_spawn_queue_command(ENTITY_SPAWN_CMD_RANDOM_VEGETATION,count, notify);
+    Command cmd                          = {};
+    cmd.type                             = COMMAND_TYPE_ENTITY_SPAWN;
+    cmd.entity_spawn.type                = ENTITY_SPAWN_CMD_RANDOM_VEGETATION;
+    cmd.entity_spawn.vegetation.count    = count;
+    cmd.entity_spawn.vegetation.notify   = notify;
+    command_push(&cmd);
 }
 
 void entity_spawn_queue_arbitrary_entity(EntityType type, C8 const *name, Vector3 position, F32 rotation, Vector3 scale, Color tint, C8 const *model_name) {
-    // Lazy mutex initialization
-    BOOL static mutex_initialized = false;
-    if (!mutex_initialized) {
-        mtx_init(&g_entity_spawn_command_queue.mutex, mtx_plain);
-        mutex_initialized = true;
-    }
-
-    mtx_lock(&g_entity_spawn_command_queue.mutex);
-    {
-        if (g_entity_spawn_command_queue.count < ENTITY_SPAWN_COMMAND_QUEUE_MAX) {
-            EntitySpawnCommand *cmd = &g_entity_spawn_command_queue.commands[g_entity_spawn_command_queue.count++];
-            cmd->type = ENTITY_SPAWN_CMD_ARBITRARY_ENTITY;
-            cmd->arbitrary.entity_type = type;
-            cmd->arbitrary.position = position;
-            cmd->arbitrary.rotation = rotation;
-            cmd->arbitrary.scale = scale;
-            cmd->arbitrary.tint = tint;
-
-            // Copy strings safely
-            ou_strncpy(cmd->arbitrary.name, name, sizeof(cmd->arbitrary.name) - 1);
-            cmd->arbitrary.name[sizeof(cmd->arbitrary.name) - 1] = '\0';
-
-            ou_strncpy(cmd->arbitrary.model_name, model_name, sizeof(cmd->arbitrary.model_name) - 1);
-            cmd->arbitrary.model_name[sizeof(cmd->arbitrary.model_name) - 1] = '\0';
-        } else {
-            llt("EntitySpawn command queue full, dropping command");
-        }
-    }
-    mtx_unlock(&g_entity_spawn_command_queue.mutex);
+    Command cmd                                   = {};
+    cmd.type                                      = COMMAND_TYPE_ENTITY_SPAWN;
+    cmd.entity_spawn.type                         = ENTITY_SPAWN_CMD_ARBITRARY_ENTITY;
+    cmd.entity_spawn.arbitrary.entity_type        = type;
+    cmd.entity_spawn.arbitrary.position           = position;
+    cmd.entity_spawn.arbitrary.rotation           = rotation;
+    cmd.entity_spawn.arbitrary.scale              = scale;
+    cmd.entity_spawn.arbitrary.tint               = tint;
+    ou_strncpy(cmd.entity_spawn.arbitrary.name, name, ENTITY_NAME_MAX_LENGTH - 1);
+    ou_strncpy(cmd.entity_spawn.arbitrary.model_name, model_name, A_PATH_MAX_LENGTH - 1);
+    command_push(&cmd);
 }
 
-void entity_spawn_process_command_queue() {
-    // Get command count and take snapshot
-    mtx_lock(&g_entity_spawn_command_queue.mutex);
-    U32 const cmd_count = g_entity_spawn_command_queue.count;
-    mtx_unlock(&g_entity_spawn_command_queue.mutex);
-
-    if (cmd_count == 0) { return; }
-
-    // Process all commands
-    for (U32 i = 0; i < cmd_count; ++i) {
-        EntitySpawnCommand const *cmd = &g_entity_spawn_command_queue.commands[i];
-
-        switch (cmd->type) {
-            case ENTITY_SPAWN_CMD_RANDOM_VEGETATION: {
-                entity_spawn_random_vegetation_on_terrain(cmd->vegetation.count, cmd->vegetation.notify);
-            } break;
-
-            case ENTITY_SPAWN_CMD_ARBITRARY_ENTITY: {
-                entity_create(cmd->arbitrary.entity_type,
-                              cmd->arbitrary.name,
-                              cmd->arbitrary.position,
-                              cmd->arbitrary.rotation,
-                              cmd->arbitrary.scale,
-                              cmd->arbitrary.tint,
-                              cmd->arbitrary.model_name);
-            } break;
-
-            default: {
-                llw("Unknown entity spawn command type: %d", cmd->type);
-            } break;
-        }
-    }
-
-    // Remove processed commands and shift remaining ones to the front
-    mtx_lock(&g_entity_spawn_command_queue.mutex);
-    if (cmd_count < g_entity_spawn_command_queue.count) {
-        // New commands were added while we were processing - shift them to the front
-        U32 const remaining = g_entity_spawn_command_queue.count - cmd_count;
-        ou_memmove(&g_entity_spawn_command_queue.commands[0],
-                   &g_entity_spawn_command_queue.commands[cmd_count],
-                   remaining * sizeof(EntitySpawnCommand));
-        g_entity_spawn_command_queue.count = remaining;
-    } else {
-        // No new commands added, just clear
-        g_entity_spawn_command_queue.count = 0;
+void entity_spawn_execute_command(EntitySpawnCommand const *cmd) {
+    switch (cmd->type) {
+        case ENTITY_SPAWN_CMD_RANDOM_VEGETATION: {
+            entity_spawn_random_vegetation_on_terrain(cmd->vegetation.count, cmd->vegetation.notify);
+        } break;
+
+        case ENTITY_SPAWN_CMD_ARBITRARY_ENTITY: {
+            entity_create(cmd->arbitrary.entity_type,
+                          cmd->arbitrary.name,
+                          cmd->arbitrary.position,
+                          cmd->arbitrary.rotation,
+                          cmd->arbitrary.scale,
+                          cmd->arbitrary.tint,
+                          cmd->arbitrary.model_name);
+        } break;
+
+        default: {
+            llw("Unknown entity spawn command type: %d", cmd->type);
+        } break;
     }
-    mtx_unlock(&g_entity_spawn_command_queue.mutex);
 }
 
 void entity_spawn_random_vegetation_on_terrain(SZ count, BOOL notify) {
@@ -269,9 +206,10 @@ void entity_spawn_random_vegetation_on_terrain(SZ count, BOOL notify) {
 }
 
 void entity_despawn_random_vegetation(SZ count, BOOL notify) {
-    for (SZ idx = 0; idx < g_world->active_entity_count; ++idx) {
-        EID const i = g_world->active_entities[idx];
-        if (g_world->type[i] != ENTITY_TYPE_VEGETATION) { continue; }
+    // Backwards since entity_destroy swap-removes from the list we walk
+    WorldEntityList const *vegetation = &g_world->type_lists[ENTITY_TYPE_VEGETATION];
+    for (U32 idx = vegetation->count; idx-- > 0;) {
+        EID const i = vegetation->entities[idx];
 
         Vector3 const position = g_world->position[i];
         entity_destroy(i);
@@ -365,9 +303,10 @@ void entity_spawn_npc(SZ count, BOOL notify) {
 }
 
 void entity_despawn_npc(SZ count, BOOL notify) {
-    for (SZ idx = 0; idx < g_world->active_entity_count; ++idx) {
-        EID const i = g_world->active_entities[idx];
-        if (g_world->type[i] != ENTITY_TYPE_NPC) { continue; }
+    // Backwards since entity_destroy swap-removes from the list we walk
+    WorldEntityList const *npcs = &g_world->type_lists[ENTITY_TYPE_NPC];
+    for (U32 idx = npcs->count; idx-- > 0;) {
+        EID const i = npcs->entities[idx];
 
         if (notify) { mio(TS("Removed NPC \\ouc{%s}%s", "#00ffffff", g_world->name[i])->c, WHITE); }
 
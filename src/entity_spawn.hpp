@@ -5,16 +5,7 @@
 #include "entity.hpp"
 #include "asset.hpp"
 
-#include <tinycthread.h>
-
-// Need for tinycthread on macOS
-#ifdef call_once
-#undef call_once
-#endif
-
-#define ENTITY_SPAWN_COMMAND_QUEUE_MAX 16384
-
-// Command queue for thread-safe entity spawning
+// Recorded by workers as COMMAND_TYPE_ENTITY_SPAWN, see command.hpp
 enum EntitySpawnCommandType : U8 {
     ENTITY_SPAWN_CMD_RANDOM_VEGETATION,
     ENTITY_SPAWN_CMD_ARBITRARY_ENTITY,
@@ -43,12 +34,6 @@ struct EntitySpawnCommand {
     };
 };
 
-struct EntitySpawnCommandQueue {
-    EntitySpawnCommand commands[ENTITY_SPAWN_COMMAND_QUEUE_MAX];
-    U32 count;
-    mtx_t mutex;
-};
-
 struct EntityTestOverworldSet {
     EID cesiums[CESIUM_COUNT];
     EID lumberyards[LUMBERYARD_COUNT];
@@ -63,9 +48,9 @@ void entity_despawn_npc(SZ count, BOOL notify);
 void entity_spawn_test_overworld_set(EntityTestOverworldSet *set);
 void entity_init_test_overworld_set_talkers(EntityTestOverworldSet *set, void (*cb_trigger_gong)(void *data), void (*cb_trigger_end)(void *data));
 
-// Thread-safe command queue API (safe to call from worker threads)
+// Safe to call from worker threads, recorded into the command buffer of the calling thread
 void entity_spawn_queue_random_vegetation_on_terrain(SZ count, BOOL notify);
 void entity_spawn_queue_arbitrary_entity(EntityType type, C8 const *name, Vector3 position, F32 rotation, Vector3 scale, Color tint, C8 const *model_name);
 
-// Main thread only: process all queued commands
-void entity_spawn_process_command_queue();
+// Main thread only, called by command_flush()
+void entity_spawn_execute_command(EntitySpawnCommand const *cmd);
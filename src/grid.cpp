@@ -5,6 +5,7 @@
 #include "cvar.hpp"
 #include "log.hpp"
 #include "math.hpp"
+#include "memory.hpp"
 #include "render.hpp"
 #include "std.hpp"
 #include "world.hpp"
@@ -17,36 +18,118 @@ void grid_init(Vector2 terrain_size) {
     g_grid.terrain_size   = terrain_size;
     g_grid.cell_size      = terrain_size.x / (F32)GRID_CELLS_PER_ROW;
     g_grid.inv_cell_size  = 1.0F / g_grid.cell_size;
+    if (!g_grid.links) { g_grid.links = mmpa(GridLink *, sizeof(GridLink) * WORLD_MAX_ENTITIES); }
+    grid_clear();
     llt("Grid initialized: %dx%d cells, cell_size: %.2f", GRID_CELLS_PER_ROW, GRID_CELLS_PER_ROW, g_grid.cell_size);
 }
 
 void grid_clear() {
-    ou_memset(g_grid.cells, 0, sizeof(g_grid.cells));
+    for (GridCell &cell : g_grid.cells) {
+        for (SZ type = 0; type < ENTITY_TYPE_COUNT; ++type) {
+            cell.head_by_type[type]   = INVALID_EID;
+            cell.count_per_type[type] = 0;
+        }
+    }
+
+    // NOTE: world_reset clears the grid before grid_init ran for the first time.
+    if (g_grid.links) {
+        for (EID i = 0; i < WORLD_MAX_ENTITIES; ++i) { g_grid.links[i] = {INVALID_EID, INVALID_EID, GRID_CELL_NONE, ENTITY_TYPE_NONE}; }
+    }
+
+    g_grid.linked_world = nullptr;
+}
+
+U32 static i_cell_index_or_none(Vector3 position) {
+    if (!grid_is_position_valid(position)) { return GRID_CELL_NONE; }
+    return (U32)grid_get_cell_index(position);
+}
+
+void static i_link(EID id, EntityType type, U32 cell_index) {
+    GridLink *link = &g_grid.links[id];
+    GridCell *cell = &g_grid.cells[cell_index];
+    EID const head = cell->head_by_type[type];
+
+    link->next       = head;
+    link->prev       = INVALID_EID;
+    link->cell_index = cell_index;
+    link->type       = type;
+
+    if (head != INVALID_EID) { g_grid.links[head].prev = id; }
+    cell->head_by_type[type] = id;
+    cell->count_per_type[type]++;
+}
+
+void static i_unlink(EID id) {
+    GridLink *link = &g_grid.links[id];
+    if (link->cell_index == GRID_CELL_NONE) { return; }
+
+    GridCell *cell = &g_grid.cells[link->cell_index];
+
+    if (link->prev != INVALID_EID) {
+        g_grid.links[link->prev].next = link->next;
+    } else {
+        cell->head_by_type[link->type] = link->next;
+    }
+    if (link->next != INVALID_EID) { g_grid.links[link->next].prev = link->prev; }
+
+    cell->count_per_type[link->type]--;
+    *link = {INVALID_EID, INVALID_EID, GRID_CELL_NONE, ENTITY_TYPE_NONE};
 }
 
 void grid_populate() {
+    // Links belong to one world, after a world switch or grid_clear everything gets linked from scratch once
+    if (g_grid.linked_world != g_world) {
+        grid_rebuild();
+        return;
+    }
+
+    g_grid.relinked_count = 0;
+
+    // Entity creation and destruction keep the grid up to date themselves, here we only catch movement
+    for (SZ idx = 0; idx < g_world->active_entity_count; ++idx) {
+        EID const i = g_world->active_entities[idx];
+        if (!ENTITY_HAS_FLAG(g_world->flags[i], ENTITY_FLAG_IN_USE)) { continue; }
+
+        U32 const cell_index  = i_cell_index_or_none(g_world->position[i]);
+        EntityType const type = g_world->type[i];
+        GridLink const *link  = &g_grid.links[i];
+
+        if (link->cell_index == cell_index && (cell_index == GRID_CELL_NONE || link->type == type)) { continue; }
+
+        i_unlink(i);
+        if (cell_index != GRID_CELL_NONE) { i_link(i, type, cell_index); }
+        g_grid.relinked_count++;
+    }
+}
+
+void grid_rebuild() {
     grid_clear();
+    g_grid.linked_world = g_world;
 
     for (SZ idx = 0; idx < g_world->active_entity_count; ++idx) {
         EID const i = g_world->active_entities[idx];
+        if (!ENTITY_HAS_FLAG(g_world->flags[i], ENTITY_FLAG_IN_USE)) { continue; }
         grid_add_entity(i, g_world->type[i], g_world->position[i]);
     }
+
+    g_grid.relinked_count = g_world->active_entity_count;
 }
 
 void grid_add_entity(EID id, EntityType type, Vector3 position) {
-    if (!grid_is_position_valid(position)) { return; }
+    // Not linked to this world yet, the next grid_populate picks the entity up with the full rebuild
+    if (g_grid.linked_world != g_world) { return; }
 
-    SZ const cell_index = grid_get_cell_index(position);
-    GridCell *cell      = &g_grid.cells[cell_index];
+    i_unlink(id);
 
-    SZ const type_count = cell->count_per_type[type];
-    if (type_count >= GRID_MAX_ENTITIES_PER_CELL) {
-        llt("Grid cell %zu is full for type %d, cannot add entity %u", cell_index, type, id);
-        return;
-    }
+    U32 const cell_index = i_cell_index_or_none(position);
+    if (cell_index == GRID_CELL_NONE) { return; }
 
-    cell->entities_by_type[type][type_count] = id;
-    cell->count_per_type[type]++;
+    i_link(id, type, cell_index);
+}
+
+void grid_remove_entity(EID id) {
+    if (g_grid.linked_world != g_world) { return; }
+    i_unlink(id);
 }
 
 SZ grid_get_cell_index(Vector3 position) {
@@ -88,9 +171,7 @@ void grid_query_entities_in_radius(Vector3 center, F32 radius, EID *out_entities
             GridCell *cell = &g_grid.cells[grid_get_cell_index_xy(x, y)];
 
             for (SZ type = 0; type < ENTITY_TYPE_COUNT; ++type) {
-                SZ const count = cell->count_per_type[type];
-                for (SZ i = 0; i < count; ++i) {
-                    EID const entity_id      = cell->entities_by_type[type][i];
+                GRID_CELL_EACH(cell, type, entity_id) {
                     Vector3 const entity_pos = g_world->position[entity_id];
 
                     // Check actual distance
@@ -110,9 +191,9 @@ void grid_query_entities_in_cell(Vector3 position, EID *out_entities, SZ *out_co
 
     GridCell *cell = grid_get_cell(position);
     for (SZ type = 0; type < ENTITY_TYPE_COUNT; ++type) {
-        SZ const count = cell->count_per_type[type];
-        for (SZ i = 0; i < count && *out_count < max_entities; ++i) {
-            out_entities[*out_count] = cell->entities_by_type[type][i];
+        GRID_CELL_EACH(cell, type, entity_id) {
+            if (*out_count >= max_entities) { return; }
+            out_entities[*out_count] = entity_id;
             (*out_count)++;
         }
     }
@@ -137,9 +218,9 @@ void grid_query_entities_around_cell(Vector3 position, EID *out_entities, SZ *ou
             GridCell *cell = &g_grid.cells[grid_get_cell_index_xy(x, y)];
 
             for (SZ type = 0; type < ENTITY_TYPE_COUNT; ++type) {
-                SZ const count = cell->count_per_type[type];
-                for (SZ i = 0; i < count && *out_count < max_entities; ++i) {
-                    out_entities[*out_count] = cell->entities_by_type[type][i];
+                GRID_CELL_EACH(cell, type, entity_id) {
+                    if (*out_count >= max_entities) { return; }
+                    out_entities[*out_count] = entity_id;
                     (*out_count)++;
                 }
             }
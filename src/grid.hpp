@@ -7,21 +7,33 @@
 
 #define GRID_CELLS_PER_ROW 150
 #define GRID_TOTAL_CELLS (GRID_CELLS_PER_ROW * GRID_CELLS_PER_ROW)
-#define GRID_MAX_ENTITIES_PER_CELL 50
 #define GRID_NEARBY_ENTITIES_MAX 64
+#define GRID_CELL_NONE U32_MAX
 
 fwd_decl(World);
 
+// Entities of one type in a cell form an intrusive doubly linked list through Grid::links, so a cell has no cap.
 struct GridCell {
-    EID entities_by_type[ENTITY_TYPE_COUNT][GRID_MAX_ENTITIES_PER_CELL];
+    EID head_by_type[ENTITY_TYPE_COUNT];  // INVALID_EID if empty
     SZ count_per_type[ENTITY_TYPE_COUNT];
 };
 
+// Per entity, remembers where it is linked so that only entities that changed cell have to be touched.
+struct GridLink {
+    EID next;
+    EID prev;
+    U32 cell_index;  // GRID_CELL_NONE if not linked
+    EntityType type;
+};
+
 struct Grid {
     Vector2 terrain_size;  // Total terrain dimensions
     F32 cell_size;         // Size of each cell (terrain_size.x / GRID_CELLS_PER_ROW)
     F32 inv_cell_size;     // 1.0 / cell_size (for fast multiplication instead of division)
     GridCell cells[GRID_TOTAL_CELLS];
+    GridLink *links;       // WORLD_MAX_ENTITIES entries, indexed by EID
+    World *linked_world;   // Links are only valid for this world, anything else forces a full rebuild
+    SZ relinked_count;     // Entities that changed cell during the last grid_populate
 };
 
 Grid extern g_grid;
@@ -29,7 +41,9 @@ Grid extern g_grid;
 void grid_init(Vector2 terrain_size);
 void grid_clear();
 void grid_populate();
+void grid_rebuild();
 void grid_add_entity(EID id, EntityType type, Vector3 position);
+void grid_remove_entity(EID id);
 SZ grid_get_cell_index(Vector3 position);
 GridCell *grid_get_cell(Vector3 position);
 GridCell *grid_get_cell_by_index(SZ cell_index);
@@ -44,3 +58,6 @@ Vector3 grid_cell_center(SZ cell_index);
 SZ static inline grid_get_cell_index_xy(S32 grid_x, S32 grid_y) {
     return ((SZ)grid_y * GRID_CELLS_PER_ROW) + (SZ)grid_x;
 }
+
+// Iterate all entities of a type in a cell, e.g. GRID_CELL_EACH(cell, ENTITY_TYPE_NPC, id) { ... }
+#define GRID_CELL_EACH(cell, type, id) for (EID id = (cell)->head_by_type[type]; id != INVALID_EID; id = g_grid.links[id].next)
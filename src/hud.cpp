@@ -179,11 +179,7 @@ void hud_draw_2d_hud() {
 
     // HACK: TOTAL WOOD
     SZ total_wood = 0;
-    for (SZ i = 0; i < WORLD_MAX_ENTITIES; ++i) {
-        if (g_world->type[i] == ENTITY_TYPE_BUILDING_LUMBERYARD) {
-            total_wood += g_world->building[i].lumberyard.wood_count;
-        }
-    }
+    WORLD_LIST_EACH(&g_world->type_lists[ENTITY_TYPE_BUILDING_LUMBERYARD], i) { total_wood += g_world->building[i].lumberyard.wood_count; }
 
     F32 const alpha   = 1.0F;
     F32 const padding = ui_scale_x(0.75F);
@@ -2,70 +2,281 @@
 #include "info.hpp"
 #include "log.hpp"
 #include "memory.hpp"
+#include "profiler.hpp"
+
+#include <glm/common.hpp>
+
+#define JOB_WORKER_SPIN_COUNT 64  // Rounds an idle worker keeps looking for work before it goes to sleep
 
 JobSystem g_job_system = {};
+U32 static thread_local i_thread_index = JOB_THREAD_INDEX_NONE;
 
-S32 static i_job_worker_thread(void *arg) {
-    auto *worker = (JobWorker *)arg;
+// ===============================================================
+// ============================ DEQUE ============================
+// ===============================================================
 
-    lld("Job worker %u started", worker->worker_id);
+// Only called by the owning thread
+BOOL static i_deque_push(JobDeque *deque, Job *job) {
+    S64 const bottom = deque->bottom.load(std::memory_order_relaxed);
+    S64 const top    = deque->top.load(std::memory_order_acquire);
 
-    for (;;) {
-        Job job = {};
-        BOOL has_job = false;
+    if (bottom - top >= JOB_DEQUE_CAPACITY) { return false; }
 
-        // Check for work
-        mtx_lock(&g_job_system.queue_mutex);
-        {
-            // Wait for work or exit signal
-            while (g_job_system.job_count == 0 && !worker->should_exit) {
-                cnd_wait(&g_job_system.work_available_cond, &g_job_system.queue_mutex);
-            }
+    deque->entries[bottom & (JOB_DEQUE_CAPACITY - 1)].store(job, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    deque->bottom.store(bottom + 1, std::memory_order_relaxed);
 
-            // Check if we should exit
-            if (worker->should_exit) {
-                mtx_unlock(&g_job_system.queue_mutex);
-                break;
-            }
+    return true;
+}
 
-            // Get job from queue (ring buffer)
-            if (g_job_system.job_count > 0) {
-                job = g_job_system.jobs[g_job_system.job_read_idx];
-                g_job_system.jobs[g_job_system.job_read_idx].status = JOB_STATUS_IN_PROGRESS;
-                g_job_system.job_read_idx = (g_job_system.job_read_idx + 1) % JOB_SYSTEM_MAX_JOBS;
-                g_job_system.job_count--;
-                g_job_system.active_job_count++;
-                has_job = true;
-            }
+// Only called by the owning thread, takes the most recently pushed job
+Job static *i_deque_pop(JobDeque *deque) {
+    S64 const bottom = deque->bottom.load(std::memory_order_relaxed) - 1;
+    deque->bottom.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    S64 top = deque->top.load(std::memory_order_relaxed);
+
+    if (top > bottom) {
+        // Empty, undo the reservation
+        deque->bottom.store(bottom + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    Job *job = deque->entries[bottom & (JOB_DEQUE_CAPACITY - 1)].load(std::memory_order_relaxed);
+    if (top == bottom) {
+        // Last entry, race against thieves for it
+        if (!deque->top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) { job = nullptr; }
+        deque->bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+
+    return job;
+}
+
+// Called by any thread, takes the oldest job
+Job static *i_deque_steal(JobDeque *deque) {
+    S64 top = deque->top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    S64 const bottom = deque->bottom.load(std::memory_order_acquire);
+
+    if (top >= bottom) { return nullptr; }
+
+    Job *job = deque->entries[top & (JOB_DEQUE_CAPACITY - 1)].load(std::memory_order_relaxed);
+    if (!deque->top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) { return nullptr; }
+
+    return job;
+}
+
+// ===============================================================
+// ============================= JOB =============================
+// ===============================================================
+
+// Only called by the owning thread, returns nullptr if every slot of its pool is still busy
+Job static *i_job_alloc(U32 thread_index) {
+    JobThread *thread = &g_job_system.threads[thread_index];
+
+    for (U32 attempt = 0; attempt < JOB_SYSTEM_MAX_JOBS; ++attempt) {
+        Job *job = &thread->jobs[thread->job_cursor++ & (JOB_SYSTEM_MAX_JOBS - 1)];
+        if (job->in_use.load(std::memory_order_acquire)) { continue; }
+
+        job->in_use.store(true, std::memory_order_relaxed);
+        job->generation.fetch_add(1, std::memory_order_release);
+        job->unfinished.store(1, std::memory_order_release);
+        job->dependency_count.store(1, std::memory_order_relaxed);
+
+        return job;
+    }
+
+    return nullptr;
+}
+
+Job static *i_job_create(JobWorkFunc work_func, void *work_arg, JobPriority priority, Job *parent) {
+    U32 const thread_index = i_thread_index;
+    if (thread_index == JOB_THREAD_INDEX_NONE) { return nullptr; }
+
+    Job *job = i_job_alloc(thread_index);
+    if (!job) {
+        lle("Job pool of thread %u is exhausted", thread_index);
+        return nullptr;
+    }
+
+    job->work_func = work_func;
+    job->work_arg  = work_arg;
+    job->range     = {};
+    job->priority  = priority;
+    job->parent    = parent;
+
+    if (parent) { parent->unfinished.fetch_add(1, std::memory_order_relaxed); }
+
+    return job;
+}
+
+// Whether the handle still refers to the job it was created for and that job has not finished yet
+BOOL static i_job_handle_pending(JobHandle handle) {
+    if (!handle.job) { return false; }
+
+    // Generation is read around unfinished so that a slot reused in between is never mistaken for the original job
+    U32 const generation_before = handle.job->generation.load(std::memory_order_acquire);
+    U32 const unfinished        = handle.job->unfinished.load(std::memory_order_acquire);
+    U32 const generation_after  = handle.job->generation.load(std::memory_order_acquire);
+
+    return generation_before == handle.generation && generation_after == handle.generation && unfinished > 0;
+}
+
+void static i_job_execute(Job *job);
+
+void static i_job_enqueue(Job *job) {
+    U32 const thread_index = i_thread_index;
+
+    // Threads without deques and full deques just run the job right away
+    if (thread_index == JOB_THREAD_INDEX_NONE || !i_deque_push(&g_job_system.threads[thread_index].deques[job->priority], job)) {
+        i_job_execute(job);
+        return;
+    }
+
+    g_job_system.queued_job_count.fetch_add(1, std::memory_order_seq_cst);
+
+    // Sleeping workers are counted under the sleep mutex, so either they see the queued job or we see them
+    if (g_job_system.sleeping_worker_count.load(std::memory_order_seq_cst) > 0) {
+        mtx_lock(&g_job_system.sleep_mutex);
+        cnd_signal(&g_job_system.work_available_cond);
+        mtx_unlock(&g_job_system.sleep_mutex);
+    }
+}
+
+void static i_job_finish(Job *job) {
+    if (job->unfinished.fetch_sub(1, std::memory_order_acq_rel) != 1) { return; }
+
+    Job *parent = job->parent;
+
+    // Detach the continuations under the lock, job_add_dependency checks unfinished under the same lock
+    Job *continuations[JOB_MAX_CONTINUATIONS];
+    while (job->continuation_lock.test_and_set(std::memory_order_acquire)) {}
+    U32 const continuation_count = job->continuation_count;
+    for (U32 i = 0; i < continuation_count; ++i) { continuations[i] = job->continuations[i]; }
+    job->continuation_count = 0;
+    job->continuation_lock.clear(std::memory_order_release);
+
+    // From here on the owner may hand out this slot again
+    job->in_use.store(false, std::memory_order_release);
+
+    for (U32 i = 0; i < continuation_count; ++i) {
+        if (continuations[i]->dependency_count.fetch_sub(1, std::memory_order_acq_rel) == 1) { i_job_enqueue(continuations[i]); }
+    }
+
+    g_job_system.outstanding_job_count.fetch_sub(1, std::memory_order_acq_rel);
+
+    if (parent) { i_job_finish(parent); }
+}
+
+// Splits a job_parallel_for range into children and runs the first chunk itself
+S32 static i_job_run_range(Job *job) {
+    JobRange const range = job->range;
+    if (range.begin >= range.end) { return 0; }
+
+    U32 chunk_begin = range.begin + range.grain;
+    while (chunk_begin < range.end) {
+        U32 const chunk_end = glm::min(chunk_begin + range.grain, range.end);
+
+        Job *child = i_job_create(nullptr, nullptr, job->priority, job);
+        if (!child) {
+            // Pool is exhausted, do the rest on this thread
+            S32 const result = range.func(chunk_begin, range.end, range.ctx);
+            if (result != 0) { return result; }
+            break;
+        }
+
+        child->range = {chunk_begin, chunk_end, chunk_end - chunk_begin, range.func, range.ctx};
+        job_submit({child, child->generation.load(std::memory_order_relaxed)});
+
+        chunk_begin = chunk_end;
+    }
+
+    return range.func(range.begin, glm::min(range.begin + range.grain, range.end), range.ctx);
+}
+
+void static i_job_execute(Job *job) {
+    PBEGIN("job");
+    S32 const result = job->range.func ? i_job_run_range(job) : job->work_func(job->work_arg);
+    PEND("job");
+    if (result != 0) { lle("Job on thread %u failed with error %d", i_thread_index, result); }
+
+    i_job_finish(job);
+}
+
+// Own deques first, then steal, higher priorities are drained across all threads before lower ones
+Job static *i_job_find(U32 thread_index) {
+    JobThread *thread = &g_job_system.threads[thread_index];
+
+    for (U32 priority = 0; priority < JOB_PRIORITY_COUNT; ++priority) {
+        Job *job = i_deque_pop(&thread->deques[priority]);
+
+        for (U32 i = 1; !job && i < g_job_system.thread_count; ++i) {
+            U32 const victim = (thread->steal_victim + i) % g_job_system.thread_count;
+            if (victim == thread_index) { continue; }
+
+            job = i_deque_steal(&g_job_system.threads[victim].deques[priority]);
+            if (job) { thread->steal_victim = victim; }
         }
-        mtx_unlock(&g_job_system.queue_mutex);
 
-        // Execute job outside of lock
-        if (has_job) {
-            S32 const result = job.work_func(job.work_arg);
+        if (job) {
+            g_job_system.queued_job_count.fetch_sub(1, std::memory_order_relaxed);
+            return job;
+        }
+    }
+
+    return nullptr;
+}
+
+// Runs one pending job on the calling thread, returns false if there was nothing to do
+BOOL static i_job_help() {
+    U32 const thread_index = i_thread_index;
+    if (thread_index == JOB_THREAD_INDEX_NONE) { return false; }
+
+    Job *job = i_job_find(thread_index);
+    if (!job) { return false; }
+
+    i_job_execute(job);
+    return true;
+}
+
+// ===============================================================
+// =========================== WORKER ============================
+// ===============================================================
+
+S32 static i_job_worker_thread(void *arg) {
+    auto *worker = (JobWorker *)arg;
+    i_thread_index = worker->worker_id;
 
-            // Update job status
-            mtx_lock(&g_job_system.queue_mutex);
-            {
-                g_job_system.active_job_count--;
+    lld("Job worker %u started", worker->worker_id);
 
-                if (result != 0) {
-                    lle("Job worker %u: job failed with error %d", worker->worker_id, result);
-                }
+    while (!g_job_system.should_exit.load(std::memory_order_acquire)) {
+        BOOL found = false;
+        for (U32 spin = 0; spin < JOB_WORKER_SPIN_COUNT && !found; ++spin) {
+            found = i_job_help();
+            if (!found) { thrd_yield(); }
+        }
+        if (found) { continue; }
 
-                // Signal if all work is done
-                if (g_job_system.job_count == 0 && g_job_system.active_job_count == 0) {
-                    cnd_broadcast(&g_job_system.work_done_cond);
-                }
+        // Nothing to steal anywhere, sleep until a job gets queued
+        mtx_lock(&g_job_system.sleep_mutex);
+        {
+            g_job_system.sleeping_worker_count.fetch_add(1, std::memory_order_seq_cst);
+            while (g_job_system.queued_job_count.load(std::memory_order_seq_cst) <= 0 && !g_job_system.should_exit.load(std::memory_order_acquire)) {
+                cnd_wait(&g_job_system.work_available_cond, &g_job_system.sleep_mutex);
             }
-            mtx_unlock(&g_job_system.queue_mutex);
+            g_job_system.sleeping_worker_count.fetch_sub(1, std::memory_order_seq_cst);
         }
+        mtx_unlock(&g_job_system.sleep_mutex);
     }
 
     lld("Job worker %u exiting", worker->worker_id);
     return 0;
 }
 
+// ===============================================================
+// ========================= JOB SYSTEM ==========================
+// ===============================================================
+
 void job_system_init(U32 worker_count) {
     if (g_job_system.initialized) {
         llw("Job system already initialized");
@@ -83,52 +294,49 @@ void job_system_init(U32 worker_count) {
     }
 
     g_job_system.worker_count = worker_count;
-    g_job_system.job_write_idx = 0;
-    g_job_system.job_read_idx = 0;
-    g_job_system.job_count = 0;
-    g_job_system.active_job_count = 0;
+    g_job_system.thread_count = worker_count + 1;
+    g_job_system.threads      = mcpa(JobThread *, g_job_system.thread_count, sizeof(JobThread));
+    g_job_system.queued_job_count.store(0);
+    g_job_system.outstanding_job_count.store(0);
+    g_job_system.sleeping_worker_count.store(0);
+    g_job_system.should_exit.store(false);
+
+    // The initializing thread takes the last slot so that it can submit, wait and help out
+    i_thread_index = worker_count;
 
     // Initialize synchronization primitives
-    if (mtx_init(&g_job_system.queue_mutex, mtx_plain) != thrd_success) {
+    if (mtx_init(&g_job_system.sleep_mutex, mtx_plain) != thrd_success) {
         lle("Failed to initialize job system mutex");
         return;
     }
 
     if (cnd_init(&g_job_system.work_available_cond) != thrd_success) {
         lle("Failed to initialize work available condition variable");
-        mtx_destroy(&g_job_system.queue_mutex);
-        return;
-    }
-
-    if (cnd_init(&g_job_system.work_done_cond) != thrd_success) {
-        lle("Failed to initialize work done condition variable");
-        mtx_destroy(&g_job_system.queue_mutex);
-        cnd_destroy(&g_job_system.work_available_cond);
+        mtx_destroy(&g_job_system.sleep_mutex);
         return;
     }
 
     // Create worker threads
     for (U32 i = 0; i < worker_count; ++i) {
         g_job_system.workers[i].worker_id = i;
-        g_job_system.workers[i].should_exit = false;
 
         if (thrd_create(&g_job_system.workers[i].thread, i_job_worker_thread, &g_job_system.workers[i]) != thrd_success) {
             lle("Failed to create job worker thread %u", i);
 
             // Signal existing threads to exit
-            for (U32 j = 0; j < i; ++j) {
-                g_job_system.workers[j].should_exit = true;
-            }
+            mtx_lock(&g_job_system.sleep_mutex);
+            g_job_system.should_exit.store(true);
             cnd_broadcast(&g_job_system.work_available_cond);
+            mtx_unlock(&g_job_system.sleep_mutex);
 
             // Wait for created threads to exit
             for (U32 j = 0; j < i; ++j) {
                 thrd_join(g_job_system.workers[j].thread, nullptr);
             }
 
-            mtx_destroy(&g_job_system.queue_mutex);
+            mtx_destroy(&g_job_system.sleep_mutex);
             cnd_destroy(&g_job_system.work_available_cond);
-            cnd_destroy(&g_job_system.work_done_cond);
+            i_thread_index = JOB_THREAD_INDEX_NONE;
             return;
         }
     }
@@ -144,17 +352,13 @@ void job_system_quit() {
 
     lld("Job system shutting down...");
 
-    // Signal all workers to exit
-    mtx_lock(&g_job_system.queue_mutex);
+    // Signal all workers to exit and wake up the sleeping ones
+    mtx_lock(&g_job_system.sleep_mutex);
     {
-        for (U32 i = 0; i < g_job_system.worker_count; ++i) {
-            g_job_system.workers[i].should_exit = true;
-        }
+        g_job_system.should_exit.store(true, std::memory_order_release);
+        cnd_broadcast(&g_job_system.work_available_cond);
     }
-    mtx_unlock(&g_job_system.queue_mutex);
-
-    // Wake up all waiting workers
-    cnd_broadcast(&g_job_system.work_available_cond);
+    mtx_unlock(&g_job_system.sleep_mutex);
 
     // Wait for all workers to exit
     for (U32 i = 0; i < g_job_system.worker_count; ++i) {
@@ -164,10 +368,10 @@ void job_system_quit() {
     }
 
     // Cleanup synchronization primitives
-    mtx_destroy(&g_job_system.queue_mutex);
+    mtx_destroy(&g_job_system.sleep_mutex);
     cnd_destroy(&g_job_system.work_available_cond);
-    cnd_destroy(&g_job_system.work_done_cond);
 
+    i_thread_index = JOB_THREAD_INDEX_NONE;
     g_job_system.initialized = false;
     lli("Job system shutdown complete");
 }
@@ -183,47 +387,150 @@ BOOL job_system_submit(JobWorkFunc work_func, void *work_arg) {
         return false;
     }
 
-    mtx_lock(&g_job_system.queue_mutex);
-    {
-        // Check if queue is full
-        if (g_job_system.job_count >= JOB_SYSTEM_MAX_JOBS) {
-            mtx_unlock(&g_job_system.queue_mutex);
-            lle("Job queue is full");
-            return false;
-        }
+    // Threads that are not part of the job system have no deque to push to
+    if (i_thread_index == JOB_THREAD_INDEX_NONE) {
+        S32 const result = work_func(work_arg);
+        if (result != 0) { lle("Inline job failed with error %d", result); }
+        return true;
+    }
 
-        // Add job to queue (ring buffer)
-        Job *job = &g_job_system.jobs[g_job_system.job_write_idx];
-        job->work_func = work_func;
-        job->work_arg = work_arg;
-        job->status = JOB_STATUS_PENDING;
+    JobHandle const job = job_run(work_func, work_arg, JOB_PRIORITY_NORMAL);
+    return job.job != nullptr;
+}
 
-        g_job_system.job_write_idx = (g_job_system.job_write_idx + 1) % JOB_SYSTEM_MAX_JOBS;
-        g_job_system.job_count++;
+void job_system_wait() {
+    if (!g_job_system.initialized) {
+        return;
     }
-    mtx_unlock(&g_job_system.queue_mutex);
 
-    // Signal that work is available
-    cnd_signal(&g_job_system.work_available_cond);
+    // Wait until all jobs are done
+    while (g_job_system.outstanding_job_count.load(std::memory_order_acquire) > 0) {
+        if (!i_job_help()) { thrd_yield(); }
+    }
+}
 
-    return true;
+U32 job_system_get_worker_count() {
+    return g_job_system.worker_count;
 }
 
-void job_system_wait() {
+U32 job_system_get_thread_count() {
+    return g_job_system.thread_count;
+}
+
+U32 job_system_get_thread_index() {
+    return i_thread_index;
+}
+
+JobHandle job_create(JobWorkFunc work_func, void *work_arg, JobPriority priority) {
     if (!g_job_system.initialized) {
-        return;
+        lle("Job system not initialized");
+        return {};
+    }
+
+    if (!work_func) {
+        lle("Invalid work function");
+        return {};
     }
 
-    mtx_lock(&g_job_system.queue_mutex);
+    Job *job = i_job_create(work_func, work_arg, priority, nullptr);
+    if (!job) { return {}; }
+
+    return {job, job->generation.load(std::memory_order_relaxed)};
+}
+
+BOOL job_add_dependency(JobHandle job, JobHandle dependency) {
+    if (!job.job) {
+        lle("Invalid job handle");
+        return false;
+    }
+
+    Job *dep = dependency.job;
+    if (!dep) { return true; }
+
+    BOOL added = true;
+    while (dep->continuation_lock.test_and_set(std::memory_order_acquire)) {}
     {
-        // Wait until all jobs are done
-        while (g_job_system.job_count > 0 || g_job_system.active_job_count > 0) {
-            cnd_wait(&g_job_system.work_done_cond, &g_job_system.queue_mutex);
+        if (!i_job_handle_pending(dependency)) {
+            // Already finished, nothing to wait for
+        } else if (dep->continuation_count >= JOB_MAX_CONTINUATIONS) {
+            added = false;
+        } else {
+            job.job->dependency_count.fetch_add(1, std::memory_order_relaxed);
+            dep->continuations[dep->continuation_count++] = job.job;
         }
     }
-    mtx_unlock(&g_job_system.queue_mutex);
+    dep->continuation_lock.clear(std::memory_order_release);
+
+    if (!added) { lle("Job has too many continuations (max %d)", JOB_MAX_CONTINUATIONS); }
+
+    return added;
 }
 
-U32 job_system_get_worker_count() {
-    return g_job_system.worker_count;
+void job_submit(JobHandle job) {
+    if (!job.job) {
+        lle("Invalid job handle");
+        return;
+    }
+
+    g_job_system.outstanding_job_count.fetch_add(1, std::memory_order_acq_rel);
+
+    // Drop the submission guard, if all dependencies already finished the job is runnable now
+    if (job.job->dependency_count.fetch_sub(1, std::memory_order_acq_rel) == 1) { i_job_enqueue(job.job); }
+}
+
+JobHandle job_run(JobWorkFunc work_func, void *work_arg, JobPriority priority) {
+    JobHandle const job = job_create(work_func, work_arg, priority);
+    if (job.job) { job_submit(job); }
+
+    return job;
+}
+
+BOOL job_is_done(JobHandle job) {
+    return !i_job_handle_pending(job);
+}
+
+void job_wait(JobHandle job) {
+    while (i_job_handle_pending(job)) {
+        if (!i_job_help()) { thrd_yield(); }
+    }
+}
+
+JobHandle job_parallel_for_create(U32 begin, U32 end, U32 grain, JobRangeFunc func, void *ctx, JobPriority priority) {
+    if (!g_job_system.initialized) {
+        lle("Job system not initialized");
+        return {};
+    }
+
+    if (!func) {
+        lle("Invalid range function");
+        return {};
+    }
+
+    Job *job = i_job_create(nullptr, nullptr, priority, nullptr);
+    if (!job) { return {}; }
+
+    // Keep the chunk count bounded so a tiny grain on a huge range can not drain the job pool
+    U32 const count     = end > begin ? end - begin : 0;
+    U32 const min_grain = (count + JOB_PARALLEL_FOR_MAX_CHUNKS - 1) / JOB_PARALLEL_FOR_MAX_CHUNKS;
+    grain               = glm::max(glm::max(grain, min_grain), 1U);
+
+    job->range = {begin, glm::max(begin, end), grain, func, ctx};
+
+    return {job, job->generation.load(std::memory_order_relaxed)};
+}
+
+JobHandle job_parallel_for(U32 begin, U32 end, U32 grain, JobRangeFunc func, void *ctx) {
+    JobHandle const job = job_parallel_for_create(begin, end, grain, func, ctx, JOB_PRIORITY_NORMAL);
+
+    if (!job.job) {
+        // No job to hand out, still get the work done on this thread
+        if (func && end > begin) {
+            S32 const result = func(begin, end, ctx);
+            if (result != 0) { lle("Inline range failed with error %d", result); }
+        }
+        return job;
+    }
+
+    job_submit(job);
+    return job;
 }
@@ -2,6 +2,7 @@
 
 #include "common.hpp"
 
+#include <atomic>
 #include <tinycthread.h>
 
 // Need for tinycthread on macOS
@@ -10,33 +11,85 @@
 #endif
 
 // Job system for parallel task execution
-// Uses persistent worker threads to avoid thread creation overhead
+// Uses persistent worker threads to avoid thread creation overhead.
+// Every participating thread (workers + the thread that called job_system_init) owns one Chase-Lev deque per priority,
+// it pushes and pops at the bottom of its own deques while idle threads steal from the top of everyone else's.
+// Jobs are handed out as handles, a job can depend on other jobs and only becomes runnable once all of them finished.
+// NOTE: The job API is meant to be used from the main thread and from inside jobs, other threads run submissions inline.
 
 #define JOB_SYSTEM_MAX_WORKERS 16
-#define JOB_SYSTEM_MAX_JOBS 1024
+#define JOB_SYSTEM_MAX_THREADS (JOB_SYSTEM_MAX_WORKERS + 1)  // Workers + main thread
+#define JOB_SYSTEM_MAX_JOBS 1024                              // Job pool size per thread, must be a power of two
+#define JOB_DEQUE_CAPACITY 1024                               // Per thread and priority, must be a power of two
+#define JOB_MAX_CONTINUATIONS 8                               // Jobs that can depend on a single job
+#define JOB_PARALLEL_FOR_MAX_CHUNKS 512                       // Grain gets raised if a range would split into more
+#define JOB_THREAD_INDEX_NONE U32_MAX
 
 // Function signature for job work
 // arg: User data passed to the job
 // Returns: 0 on success, non-zero on error
 typedef S32 (*JobWorkFunc)(void *arg);
 
-enum JobStatus : U8 {
-    JOB_STATUS_PENDING,
-    JOB_STATUS_IN_PROGRESS,
-    JOB_STATUS_COMPLETED,
-    JOB_STATUS_ERROR,
+// Function signature for job_parallel_for
+// [begin, end): Sub range this invocation is responsible for
+// ctx: User data passed to job_parallel_for
+// Returns: 0 on success, non-zero on error
+typedef S32 (*JobRangeFunc)(U32 begin, U32 end, void *ctx);
+
+enum JobPriority : U8 {
+    JOB_PRIORITY_HIGH,
+    JOB_PRIORITY_NORMAL,
+    JOB_PRIORITY_LOW,
+    JOB_PRIORITY_COUNT,
+};
+
+struct JobRange {
+    U32 begin;
+    U32 end;
+    U32 grain;
+    JobRangeFunc func;
+    void *ctx;
 };
 
-struct Job {
+struct alignas(64) Job {
     JobWorkFunc work_func;
     void *work_arg;
-    JobStatus status;
+    JobRange range;  // Only used by job_parallel_for, the job then splits itself into children
+    Job *parent;
+    JobPriority priority;
+
+    std::atomic<BOOL> in_use;           // Cleared once the job finished and released its continuations
+    std::atomic<U32> generation;        // Bumped whenever the slot is reused, invalidates old handles
+    std::atomic<U32> unfinished;        // 1 for the job itself + 1 per unfinished child, done at 0
+    std::atomic<U32> dependency_count;  // 1 submission guard + 1 per unfinished dependency, runnable at 0
+
+    std::atomic_flag continuation_lock;
+    U32 continuation_count;
+    Job *continuations[JOB_MAX_CONTINUATIONS];
+};
+
+struct JobHandle {
+    Job *job;
+    U32 generation;
+};
+
+// Chase-Lev work-stealing deque, the owner pushes/pops at the bottom, thieves take from the top.
+struct alignas(64) JobDeque {
+    std::atomic<S64> top;
+    alignas(64) std::atomic<S64> bottom;
+    std::atomic<Job *> entries[JOB_DEQUE_CAPACITY];
 };
 
 struct JobWorker {
     thrd_t thread;
     U32 worker_id;
-    BOOL should_exit;
+};
+
+struct JobThread {
+    JobDeque deques[JOB_PRIORITY_COUNT];
+    Job jobs[JOB_SYSTEM_MAX_JOBS];  // Only ever allocated from by the owning thread
+    U32 job_cursor;
+    U32 steal_victim;               // Round robin start for stealing
 };
 
 struct JobSystem {
@@ -45,18 +98,18 @@ struct JobSystem {
     // Worker threads
     JobWorker workers[JOB_SYSTEM_MAX_WORKERS];
     U32 worker_count;
+    U32 thread_count;  // worker_count + 1, the last one is the thread that called job_system_init
+
+    JobThread *threads;  // thread_count entries, allocated from the permanent arena
+
+    std::atomic<S32> queued_job_count;       // Sitting in a deque
+    std::atomic<S32> outstanding_job_count;  // Submitted but not finished, used by job_system_wait
+    std::atomic<U32> sleeping_worker_count;
+    std::atomic<BOOL> should_exit;
 
-    // Job queue (ring buffer)
-    Job jobs[JOB_SYSTEM_MAX_JOBS];
-    U32 job_write_idx;  // Where to write next job
-    U32 job_read_idx;   // Where to read next job
-    U32 job_count;      // Number of pending jobs
-
-    // Synchronization
-    mtx_t queue_mutex;
-    cnd_t work_available_cond;  // Signal when work is available
-    cnd_t work_done_cond;       // Signal when all work is done
-    U32 active_job_count;       // Jobs currently being processed
+    // Synchronization, only used to put idle workers to sleep
+    mtx_t sleep_mutex;
+    cnd_t work_available_cond;
 };
 
 JobSystem extern g_job_system;
@@ -71,8 +124,39 @@ void job_system_quit();
 // Returns: BOOL indicating success
 BOOL job_system_submit(JobWorkFunc work_func, void *work_arg);
 
-// Wait for all submitted jobs to complete
+// Wait for all submitted jobs to complete, the calling thread helps out while waiting
 void job_system_wait();
 
 // Get number of worker threads
 U32 job_system_get_worker_count();
+
+// Get number of threads that can run jobs (workers + main thread), use this to size per-thread scratch data
+U32 job_system_get_thread_count();
+
+// Index of the calling thread in [0, job_system_get_thread_count()) or JOB_THREAD_INDEX_NONE
+U32 job_system_get_thread_index();
+
+// Create a job without starting it, dependencies can be added until it is submitted
+JobHandle job_create(JobWorkFunc work_func, void *work_arg, JobPriority priority);
+
+// Make job wait for dependency, has to be called before job is submitted
+// Returns: BOOL indicating success
+BOOL job_add_dependency(JobHandle job, JobHandle dependency);
+
+// Hand the job over to the scheduler, it runs as soon as all its dependencies finished
+void job_submit(JobHandle job);
+
+// Shorthand for job_create + job_submit
+JobHandle job_run(JobWorkFunc work_func, void *work_arg, JobPriority priority);
+
+// Whether the job and all of its children finished, stale handles count as finished
+BOOL job_is_done(JobHandle job);
+
+// Block until the job finished, the calling thread runs other jobs in the meantime
+void job_wait(JobHandle job);
+
+// Create a job that calls func over [begin, end) in chunks of at least grain elements, not yet submitted
+JobHandle job_parallel_for_create(U32 begin, U32 end, U32 grain, JobRangeFunc func, void *ctx, JobPriority priority);
+
+// Shorthand for job_parallel_for_create + job_submit with normal priority
+JobHandle job_parallel_for(U32 begin, U32 end, U32 grain, JobRangeFunc func, void *ctx);
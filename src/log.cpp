@@ -5,7 +5,12 @@
 #include "core.hpp"
 #include "std.hpp"
 
+#include <stdlib.h>
+#include <time.h>
+
 LLogger static i_logger = {};
+LLogRing static thread_local *i_ring = nullptr;
+BOOL static thread_local i_ring_unavailable = false;
 
 C8 static const *i_level_str[LLOG_LEVEL_COUNT] = {
     "TRC", "DBG", "INF", "WRN", "ERR", "FAT", "NON", "TTY",
@@ -25,9 +30,513 @@ C8 static const *i_get_short_file_name(C8 const *filepath) {
     return filepath;
 }
 
+// ====== ARGUMENT PACKING ======
+
+// One printf conversion, only what we need to pull the argument and to rebuild the spec for the writer
+struct LLogSpec {
+    C8 const *start;  // At the '%'
+    C8 const *end;    // One past the conversion character
+    BOOL width_arg;   // '*' width
+    BOOL precision_arg;
+    S32 length;       // 0 none, 1 hh, 2 h, 3 l, 4 ll, 5 j, 6 z, 7 t, 8 L
+    C8 conversion;
+};
+
+// Returns the position after the spec or nullptr at the end of fmt, literal text in between is skipped
+C8 static const *i_next_spec(C8 const *fmt, LLogSpec *spec) {
+    while (*fmt) {
+        if (*fmt != '%') {
+            fmt++;
+            continue;
+        }
+        if (fmt[1] == '%') {
+            fmt += 2;
+            continue;
+        }
+
+        *spec       = {};
+        spec->start = fmt++;
+        while (*fmt && ou_strchr("-+ #0'", *fmt)) { fmt++; }
+        if (*fmt == '*') {
+            spec->width_arg = true;
+            fmt++;
+        }
+        while (*fmt >= '0' && *fmt <= '9') { fmt++; }
+        if (*fmt == '.') {
+            fmt++;
+            if (*fmt == '*') {
+                spec->precision_arg = true;
+                fmt++;
+            }
+            while (*fmt >= '0' && *fmt <= '9') { fmt++; }
+        }
+        switch (*fmt) {
+            case 'h': spec->length = fmt[1] == 'h' ? 1 : 2; fmt += fmt[1] == 'h' ? 2 : 1; break;
+            case 'l': spec->length = fmt[1] == 'l' ? 4 : 3; fmt += fmt[1] == 'l' ? 2 : 1; break;
+            case 'j': spec->length = 5; fmt++; break;
+            case 'z': spec->length = 6; fmt++; break;
+            case 't': spec->length = 7; fmt++; break;
+            case 'L': spec->length = 8; fmt++; break;
+            default: break;
+        }
+        if (!*fmt) { return nullptr; }
+        spec->conversion = *fmt++;
+        spec->end        = fmt;
+        return fmt;
+    }
+    return nullptr;
+}
+
+BOOL static i_pack(U8 *out, SZ capacity, SZ *size, void const *value, SZ value_size) {
+    if (*size + value_size > capacity) { return false; }
+    ou_memcpy(out + *size, value, value_size);
+    *size += value_size;
+    return true;
+}
+
+// Copies every argument into out in the order fmt consumes them, returns false if they do not fit
+BOOL static i_pack_args(U8 *out, SZ capacity, SZ *size, C8 const *fmt, va_list args) {
+    *size = 0;
+    LLogSpec spec = {};
+    while ((fmt = i_next_spec(fmt, &spec))) {
+        if (spec.width_arg) {
+            S32 const width = va_arg(args, S32);
+            if (!i_pack(out, capacity, size, &width, sizeof(width))) { return false; }
+        }
+        S32 precision = -1;
+        if (spec.precision_arg) {
+            precision = va_arg(args, S32);
+            if (!i_pack(out, capacity, size, &precision, sizeof(precision))) { return false; }
+        }
+
+        switch (spec.conversion) {
+            case 'd':
+            case 'i': {
+                S64 value = 0;
+                switch (spec.length) {
+                    case 3:  value = va_arg(args, long);      break;
+                    case 4:  value = va_arg(args, long long); break;
+                    case 5:  value = va_arg(args, intmax_t);  break;
+                    case 6:  value = va_arg(args, ssize_t);   break;
+                    case 7:  value = va_arg(args, ptrdiff_t); break;
+                    default: value = va_arg(args, S32);       break;
+                }
+                if (!i_pack(out, capacity, size, &value, sizeof(value))) { return false; }
+            } break;
+            case 'u':
+            case 'o':
+            case 'x':
+            case 'X':
+            case 'c': {
+                U64 value = 0;
+                switch (spec.length) {
+                    case 3:  value = va_arg(args, unsigned long);      break;
+                    case 4:  value = va_arg(args, unsigned long long); break;
+                    case 5:  value = va_arg(args, uintmax_t);          break;
+                    case 6:  value = va_arg(args, SZ);                 break;
+                    case 7:  value = (U64)va_arg(args, ptrdiff_t);     break;
+                    default: value = va_arg(args, U32);                break;
+                }
+                if (!i_pack(out, capacity, size, &value, sizeof(value))) { return false; }
+            } break;
+            case 'f':
+            case 'F':
+            case 'e':
+            case 'E':
+            case 'g':
+            case 'G':
+            case 'a':
+            case 'A': {
+                F64 const value = spec.length == 8 ? (F64)va_arg(args, long double) : va_arg(args, F64);
+                if (!i_pack(out, capacity, size, &value, sizeof(value))) { return false; }
+            } break;
+            case 'p': {
+                void *value = va_arg(args, void *);
+                if (!i_pack(out, capacity, size, &value, sizeof(value))) { return false; }
+            } break;
+            case 's': {
+                C8 const *value = va_arg(args, C8 const *);
+                if (!value) { value = "(null)"; }
+                // A precision caps how much of the string gets printed, so there is no need to copy more than that
+                SZ length = 0;
+                while (value[length] && (precision < 0 || length < (SZ)precision)) { length++; }
+                if (!i_pack(out, capacity, size, value, length)) { return false; }
+                if (!i_pack(out, capacity, size, "", 1)) { return false; }
+            } break;
+            default: {
+                // %n and friends, nothing we can replay
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Replays fmt with the packed arguments, the counterpart of i_pack_args
+SZ static i_unpack_format(C8 *out, SZ capacity, C8 const *fmt, U8 const *args) {
+    SZ written = 0;
+    auto append = [&](S32 count) { if (count > 0) { written = (written + (SZ)count < capacity - 1) ? written + (SZ)count : capacity - 1; } };
+
+    C8 spec_fmt[64];
+    LLogSpec spec    = {};
+    C8 const *cursor = fmt;
+    C8 const *next   = nullptr;
+    while ((next = i_next_spec(cursor, &spec))) {
+        // Literal text up to the spec, %% collapses to a single %
+        for (C8 const *c = cursor; c < spec.start && written < capacity - 1; ++c) {
+            out[written++] = *c;
+            if (c[0] == '%' && c[1] == '%') { c++; }
+        }
+
+        S32 width     = 0;
+        S32 precision = 0;
+        if (spec.width_arg) {
+            ou_memcpy(&width, args, sizeof(width));
+            args += sizeof(width);
+        }
+        if (spec.precision_arg) {
+            ou_memcpy(&precision, args, sizeof(precision));
+            args += sizeof(precision);
+        }
+
+        // Rebuild the spec with '*' resolved and the length modifier matching what we stored
+        SZ spec_len = 0;
+        for (C8 const *c = spec.start; c < spec.end - 1 && spec_len < sizeof(spec_fmt) - 24; ++c) {
+            if (ou_strchr("hljztL", *c)) { continue; }
+            if (*c == '*') {
+                spec_len += (SZ)ou_snprintf(spec_fmt + spec_len, sizeof(spec_fmt) - spec_len, "%d", c == spec.start + 1 || c[-1] != '.' ? width : precision);
+                continue;
+            }
+            spec_fmt[spec_len++] = *c;
+        }
+
+        C8 *dst         = out + written;
+        SZ const remain = capacity - written;
+        switch (spec.conversion) {
+            case 'd':
+            case 'i': {
+                S64 value = 0;
+                ou_memcpy(&value, args, sizeof(value));
+                args += sizeof(value);
+                ou_snprintf(spec_fmt + spec_len, sizeof(spec_fmt) - spec_len, "ll%c", spec.conversion);
+                append(ou_snprintf(dst, remain, spec_fmt, (long long)value));
+            } break;
+            case 'u':
+            case 'o':
+            case 'x':
+            case 'X': {
+                U64 value = 0;
+                ou_memcpy(&value, args, sizeof(value));
+                args += sizeof(value);
+                ou_snprintf(spec_fmt + spec_len, sizeof(spec_fmt) - spec_len, "ll%c", spec.conversion);
+                append(ou_snprintf(dst, remain, spec_fmt, (unsigned long long)value));
+            } break;
+            case 'c': {
+                U64 value = 0;
+                ou_memcpy(&value, args, sizeof(value));
+                args += sizeof(value);
+                ou_snprintf(spec_fmt + spec_len, sizeof(spec_fmt) - spec_len, "c");
+                append(ou_snprintf(dst, remain, spec_fmt, (S32)value));
+            } break;
+            case 'p': {
+                void *value = nullptr;
+                ou_memcpy(&value, args, sizeof(value));
+                args += sizeof(value);
+                ou_snprintf(spec_fmt + spec_len, sizeof(spec_fmt) - spec_len, "p");
+                append(ou_snprintf(dst, remain, spec_fmt, value));
+            } break;
+            case 's': {
+                C8 const *value = (C8 const *)args;
+                args += ou_strlen(value) + 1;
+                ou_snprintf(spec_fmt + spec_len, sizeof(spec_fmt) - spec_len, "s");
+                append(ou_snprintf(dst, remain, spec_fmt, value));
+            } break;
+            default: {
+                F64 value = 0.0;
+                ou_memcpy(&value, args, sizeof(value));
+                args += sizeof(value);
+                ou_snprintf(spec_fmt + spec_len, sizeof(spec_fmt) - spec_len, "%c", spec.conversion);
+                append(ou_snprintf(dst, remain, spec_fmt, value));
+            } break;
+        }
+
+        cursor = next;
+    }
+
+    for (C8 const *c = cursor; *c && written < capacity - 1; ++c) {
+        out[written++] = *c;
+        if (c[0] == '%' && c[1] == '%') { c++; }
+    }
+    out[written] = '\0';
+    return written;
+}
+
+// ====== WRITER ======
+
+// Everything below runs with the consumer mutex held, so the static buffers are shared safely
+C8 static i_message[LLOG_MESSAGE_MAX_LENGTH];
+C8 static i_stdout_batch[64 * 1024];
+SZ static i_stdout_batch_size = 0;
+S64 static i_cached_second    = -1;
+C8 static i_cached_time[16]   = {};
+
+void static i_stdout_flush_batch() {
+    if (i_stdout_batch_size == 0) { return; }
+    fwrite(i_stdout_batch, 1, i_stdout_batch_size, stdout);
+    i_stdout_batch_size = 0;
+}
+
+void static i_stdout_append(C8 const *fmt, ...) __attribute__((format(printf, 1, 2)));
+void static i_stdout_append(C8 const *fmt, ...) {
+    for (S32 attempt = 0; attempt < 2; ++attempt) {
+        SZ const remain = sizeof(i_stdout_batch) - i_stdout_batch_size;
+        va_list args;
+        va_start(args, fmt);
+        S32 const count = ou_vsnprintf(i_stdout_batch + i_stdout_batch_size, remain, fmt, args);
+        va_end(args);
+        if (count < 0) { return; }
+        if ((SZ)count < remain) {
+            i_stdout_batch_size += (SZ)count;
+            return;
+        }
+        i_stdout_flush_batch();
+    }
+
+    // Bigger than the whole batch buffer, bypass it
+    va_list args;
+    va_start(args, fmt);
+    ou_vfprintf(stdout, fmt, args);
+    va_end(args);
+}
+
+void static i_console_push(C8 const *line) {
+    LLogConsoleQueue *q = &i_logger.console_queue;
+    U32 const head      = q->head.load(std::memory_order_relaxed);
+    if (head - q->tail.load(std::memory_order_acquire) >= LLOG_CONSOLE_QUEUE_CAPACITY) {
+        i_logger.dropped_console_count.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    C8 *slot = q->lines[head & (LLOG_CONSOLE_QUEUE_CAPACITY - 1)];
+    ou_strncpy(slot, line, LLOG_CONSOLE_LINE_MAX_LENGTH - 1);
+    slot[LLOG_CONSOLE_LINE_MAX_LENGTH - 1] = '\0';
+    q->head.store(head + 1, std::memory_order_release);
+}
+
+void static i_emit(LLogRecordHeader const *header, U8 const *args) {
+    LLogLevel const level = header->level;
+    i_unpack_format(i_message, sizeof(i_message), header->fmt, args);
+
+    // Skip buffer output for NONE level
+    if (level != LLOG_LEVEL_NONE) {
+        BOOL const use_color = FLAG_HAS(i_logger.flags, LLOG_FLAG_COLOR);
+        BOOL const in_emacs  = FLAG_HAS(i_logger.flags, LLOG_FLAG_EMACS);
+
+        C8 const *display_file = header->file;
+        if (FLAG_HAS(i_logger.flags, LLOG_FLAG_SHORTFILE)) { display_file = i_get_short_file_name(header->file); }
+
+        // Timestamp, localtime only runs once per second of log output
+        S64 const second = header->time_ns / 1000000000;
+        if (second != i_cached_second) {
+            time_t const t = (time_t)second;
+            struct tm tm_info;
+            localtime_r(&t, &tm_info);
+            strftime(i_cached_time, sizeof(i_cached_time), "%H:%M:%S", &tm_info);
+            i_cached_second = second;
+        }
+        S64 const millis = (header->time_ns / 1000000) % 1000;
+
+        // File buffer output (stdout)
+        if (in_emacs) {
+            if (use_color) {
+                i_stdout_append("%s%s:%u: \x1b[0m%s\n", i_color_codes[level], header->file, header->line, i_message);
+            } else {
+                i_stdout_append("%s:%u: %s\n", header->file, header->line, i_message);
+            }
+        } else if (use_color) {
+            i_stdout_append("\x1b[90m[%s.%03" PRId64 "]\x1b[0m %s[%s] %s:%s:%u: %s\x1b[0m\n", i_cached_time, millis, i_color_codes[level], i_level_str[level],
+                            display_file, header->func, header->line, i_message);
+        } else {
+            i_stdout_append("[%s.%03" PRId64 "] [%s] %s:%s:%u: %s\n", i_cached_time, millis, i_level_str[level], display_file, header->func, header->line,
+                            i_message);
+        }
+    }
+
+    // Console output (for in-game console)
+    if (level != LLOG_LEVEL_TTY) {
+        C8 console_msg[LLOG_CONSOLE_LINE_MAX_LENGTH];
+        if (level != LLOG_LEVEL_NONE) {
+            ou_snprintf(console_msg, sizeof(console_msg), "%s: |%s", i_level_str[level], i_message);
+        } else {
+            ou_snprintf(console_msg, sizeof(console_msg), "%s", i_message);
+        }
+        i_console_push(console_msg);
+    }
+}
+
+struct LLogBatchEntry {
+    LLogRecord const *record;
+    U32 order;  // Keeps records of one thread in ring order when their timestamps tie
+};
+
+S32 static i_compare_records(void const *a, void const *b) {
+    LLogBatchEntry const *x = (LLogBatchEntry const *)a;
+    LLogBatchEntry const *y = (LLogBatchEntry const *)b;
+    if (x->record->header.time_ns != y->record->header.time_ns) { return x->record->header.time_ns < y->record->header.time_ns ? -1 : 1; }
+    return (x->order > y->order) - (x->order < y->order);
+}
+
+// Caller holds the consumer mutex. Takes whatever is in the rings right now, orders it by time and writes it out.
+SZ static i_drain_locked() {
+    LLogBatchEntry static batch[LLOG_RING_MAX_COUNT * LLOG_RING_CAPACITY];
+    U32 static batch_end[LLOG_RING_MAX_COUNT];
+
+    SZ count             = 0;
+    U32 ring_count       = i_logger.ring_count.load(std::memory_order_acquire);
+    if (ring_count > LLOG_RING_MAX_COUNT) { ring_count = LLOG_RING_MAX_COUNT; }  // Claims past the end never got a ring
+    for (U32 r = 0; r < ring_count; ++r) {
+        LLogRing *ring = &i_logger.rings[r];
+        U32 const tail = ring->tail.load(std::memory_order_relaxed);
+        U32 const head = ring->head.load(std::memory_order_acquire);
+        for (U32 i = tail; i != head; ++i) {
+            batch[count] = {&ring->records[i & (LLOG_RING_CAPACITY - 1)], (U32)count};
+            count++;
+        }
+        batch_end[r] = head;
+    }
+
+    if (count > 1) { qsort(batch, count, sizeof(LLogBatchEntry), i_compare_records); }
+    for (SZ i = 0; i < count; ++i) { i_emit(&batch[i].record->header, batch[i].record->args); }
+
+    // Hand the slots back only after we are done reading them
+    for (U32 r = 0; r < ring_count; ++r) { i_logger.rings[r].tail.store(batch_end[r], std::memory_order_release); }
+
+    U64 const dropped = i_logger.dropped_count.load(std::memory_order_relaxed);
+    if (dropped != i_logger.reported_dropped_count) {
+        i_stdout_append("[%s] log: dropped %" PRIu64 " records so far, the per thread rings hold %d\n", i_level_str[LLOG_LEVEL_WARN], dropped,
+                        LLOG_RING_CAPACITY);
+        i_logger.reported_dropped_count = dropped;
+    }
+
+    i_stdout_flush_batch();
+    if (count > 0) { ou_fflush(stdout); }
+    return count;
+}
+
+// Before llog_init there is no writer and no mutex, everything runs on the main thread
+void static i_consumer_lock() {
+    if (i_logger.consumer_mutex_ready) { mtx_lock(&i_logger.consumer_mutex); }
+}
+
+void static i_consumer_unlock() {
+    if (i_logger.consumer_mutex_ready) { mtx_unlock(&i_logger.consumer_mutex); }
+}
+
+S32 static i_writer_thread(void *data) {
+    unused(data);
+
+    while (!i_logger.writer_should_exit.load(std::memory_order_acquire)) {
+        mtx_lock(&i_logger.consumer_mutex);
+        SZ const count = i_drain_locked();
+        mtx_unlock(&i_logger.consumer_mutex);
+
+        if (count == 0) {
+            struct timespec const duration = {0, (S64)LLOG_WRITER_IDLE_SLEEP_MS * 1000000};
+            struct timespec remaining      = {0, 0};
+            thrd_sleep(&duration, &remaining);
+        }
+    }
+
+    return 0;
+}
+
+// ====== PRODUCERS ======
+
+LLogRing static *i_get_ring() {
+    if (i_ring || i_ring_unavailable) { return i_ring; }
+
+    // Every thread claims its own ring the first time it logs, there is no way to give one back
+    U32 const index = i_logger.ring_count.fetch_add(1, std::memory_order_acq_rel);
+    if (index >= LLOG_RING_MAX_COUNT) {
+        i_ring_unavailable = true;
+        return nullptr;
+    }
+
+    i_ring = &i_logger.rings[index];
+    return i_ring;
+}
+
+// Oversized records, threads without a ring and logging before the writer runs end up here
+void static i_log_sync(LLogLevel level, C8 const *file, C8 const *func, U32 line, S64 time_ns, C8 const *fmt, va_list args) {
+    LLogRecord static big_header = {};
+    U8 static big_args[LLOG_MESSAGE_MAX_LENGTH];
+
+    i_consumer_lock();
+    i_drain_locked();  // Keep whatever this thread logged earlier in front
+
+    SZ size = 0;
+    if (i_pack_args(big_args, sizeof(big_args), &size, fmt, args)) {
+        big_header.header = {time_ns, file, func, fmt, line, (U16)(size > U16_MAX ? U16_MAX : size), level};
+        i_emit(&big_header.header, big_args);
+    } else {
+        big_header.header = {time_ns, file, func, "%s", line, 0, level};
+        C8 const *message = "Log message too big to display.";
+        i_emit(&big_header.header, (U8 const *)message);
+    }
+
+    i_stdout_flush_batch();
+    ou_fflush(stdout);
+    i_consumer_unlock();
+}
+
+void static i_quit_at_exit() {
+    llog_quit();
+}
+
 void llog_init() {
     llog_enable_flag(LLOG_FLAG_EXIT_ON_ERROR);
     llog_enable_flag(LLOG_FLAG_QUIET_THIRD_PARTY);
+
+    if (mtx_init(&i_logger.consumer_mutex, mtx_plain) != thrd_success) {
+        ou_fprintf(stderr, "Failed to create the log mutex, logging synchronously\n");
+        return;
+    }
+    i_logger.consumer_mutex_ready = true;
+
+    i_logger.writer_should_exit.store(false, std::memory_order_relaxed);
+    if (thrd_create(&i_logger.writer_thread, i_writer_thread, nullptr) != thrd_success) {
+        ou_fprintf(stderr, "Failed to create the log writer thread, logging synchronously\n");
+        return;
+    }
+    i_logger.writer_running.store(true, std::memory_order_release);
+    atexit(i_quit_at_exit);
+}
+
+void llog_quit() {
+    if (!i_logger.writer_running.exchange(false, std::memory_order_acq_rel)) { return; }
+
+    i_logger.writer_should_exit.store(true, std::memory_order_release);
+    thrd_join(i_logger.writer_thread, nullptr);
+    llog_flush();
+}
+
+void llog_update() {
+    // Finished lines go into the console's recycled line pool
+    LLogConsoleQueue *q = &i_logger.console_queue;
+    U32 const head      = q->head.load(std::memory_order_acquire);
+    U32 tail            = q->tail.load(std::memory_order_relaxed);
+    for (; tail != head; ++tail) { console_print_to_output(q->lines[tail & (LLOG_CONSOLE_QUEUE_CAPACITY - 1)]); }
+    q->tail.store(tail, std::memory_order_release);
+}
+
+void llog_flush() {
+    i_consumer_lock();
+    i_drain_locked();
+    i_consumer_unlock();
+}
+
+U64 llog_get_dropped_count() {
+    return i_logger.dropped_count.load(std::memory_order_relaxed) + i_logger.dropped_console_count.load(std::memory_order_relaxed);
 }
 
 void llog_set_level(LLogLevel level) {
@@ -58,70 +567,46 @@ C8 const *llog_level_to_cstr(LLogLevel level) {
 void llog_format(LLogLevel level, C8 const *file, C8 const *func, U32 line, C8 const *fmt, ...) {
     if (level < i_logger.level && level != LLOG_LEVEL_NONE) { return; }
 
-    while (i_logger.lock.test_and_set()) {}
-
-    C8 const *display_file = file;
-    if (FLAG_HAS(i_logger.flags, LLOG_FLAG_SHORTFILE)) { display_file = i_get_short_file_name(file); }
-
-    BOOL const use_color = FLAG_HAS(i_logger.flags, LLOG_FLAG_COLOR);
-    BOOL const in_emacs  = FLAG_HAS(i_logger.flags, LLOG_FLAG_EMACS);
-
-    // Skip buffer output for NONE level
-    if (level != LLOG_LEVEL_NONE) {
-        // Timestamp for file output
-        struct timespec ts_spec;
-        clock_gettime(CLOCK_REALTIME, &ts_spec);
-        struct tm *tm_info = localtime(&ts_spec.tv_sec);
-        C8 ts[20];
-        SZ const len = strftime(ts, sizeof(ts) - 4, "%H:%M:%S", tm_info);
-        ou_snprintf(ts + len, sizeof(ts) - len, ".%03ld", ts_spec.tv_nsec / 1000000);
-
-        // File buffer output (stdout)
-        if (in_emacs) {
-            if (use_color) { ou_fprintf(stdout, "%s", i_color_codes[level]); }
-            ou_fprintf(stdout, "%s:%d: ", file, line);
-            if (use_color) { ou_fprintf(stdout, "\x1b[0m"); }
-        } else {
-            if (use_color) {
-                ou_fprintf(stdout, "\x1b[90m[%s]\x1b[0m %s[%s] %s:%s:%d: ", ts, i_color_codes[level], i_level_str[level], display_file, func, line);
-            } else {
-                ou_fprintf(stdout, "[%s] [%s] %s:%s:%d: ", ts, i_level_str[level], display_file, func, line);
-            }
-        }
-
-        va_list args;
-        va_start(args, fmt);
-        ou_vfprintf(stdout, fmt, args);
-        va_end(args);
+    struct timespec ts_spec;
+    clock_gettime(CLOCK_REALTIME, &ts_spec);
+    S64 const time_ns = ((S64)ts_spec.tv_sec * 1000000000) + (S64)ts_spec.tv_nsec;
 
-        if (use_color && !in_emacs) { ou_fprintf(stdout, "\x1b[0m"); }
-        ou_fprintf(stdout, "\n");
-        ou_fflush(stdout);
-    }
+    BOOL const fatal = (level == LLOG_LEVEL_ERROR || level == LLOG_LEVEL_FATAL);
+    LLogRing *ring   = i_logger.writer_running.load(std::memory_order_acquire) ? i_get_ring() : nullptr;
 
-    // Console output (for in-game console)
-    if (level != LLOG_LEVEL_TTY) {
-        C8 console_msg[1024];
-        SZ msg_len = 0;
+    va_list args;
+    va_start(args, fmt);
 
-        if (level != LLOG_LEVEL_NONE) { msg_len = (SZ)ou_snprintf(console_msg, sizeof(console_msg), "%s: |", i_level_str[level]); }
+    BOOL queued = false;
+    if (ring) {
+        U32 const head = ring->head.load(std::memory_order_relaxed);
+        while (head - ring->tail.load(std::memory_order_acquire) >= LLOG_RING_CAPACITY && fatal) { thrd_yield(); }  // Errors are never dropped
 
-        if (msg_len < sizeof(console_msg)) {
-            va_list args;
-            va_start(args, fmt);
-            ou_vsnprintf(console_msg + msg_len, sizeof(console_msg) - msg_len, fmt, args);
+        if (head - ring->tail.load(std::memory_order_acquire) >= LLOG_RING_CAPACITY) {
+            ring->dropped_count.fetch_add(1, std::memory_order_relaxed);
+            i_logger.dropped_count.fetch_add(1, std::memory_order_relaxed);
             va_end(args);
-        } else {
-            ou_strncpy(console_msg + msg_len, "Message too big to display.", sizeof(console_msg) - msg_len);
+            return;
         }
 
-        console_print_to_output(console_msg);
+        LLogRecord *record = &ring->records[head & (LLOG_RING_CAPACITY - 1)];
+        SZ size            = 0;
+        va_list pack_args;
+        va_copy(pack_args, args);
+        if (i_pack_args(record->args, sizeof(record->args), &size, fmt, pack_args)) {
+            record->header = {time_ns, file, func, fmt, line, (U16)size, level};
+            ring->head.store(head + 1, std::memory_order_release);
+            queued = true;
+        }
+        va_end(pack_args);
     }
 
-    i_logger.lock.clear();
+    if (!queued) { i_log_sync(level, file, func, line, time_ns, fmt, args); }
+    va_end(args);
 
     // Exit on error if flag is set
-    if ((level == LLOG_LEVEL_ERROR || level == LLOG_LEVEL_FATAL) && FLAG_HAS(i_logger.flags, LLOG_FLAG_EXIT_ON_ERROR)) {
+    if (fatal && FLAG_HAS(i_logger.flags, LLOG_FLAG_EXIT_ON_ERROR)) {
+        llog_flush();
         _break_();
         core_error_quit();
     }
@@ -5,6 +5,26 @@
 #include <fmod_common.h>
 #include <stdio.h>
 #include <atomic>
+#include <tinycthread.h>
+
+// Need for tinycthread on macOS
+#ifdef call_once
+#undef call_once
+#endif
+
+// Logging never formats on the calling thread. Every thread gets its own SPSC ring that it fills with binary records
+// (timestamp, level, format pointer, packed arguments) and a writer thread turns them into text in batches.
+// Console lines travel back to the main thread through another SPSC queue and are drained by llog_update.
+// NOTE: The format string, file and func have to outlive the record. The macros only accept literal formats, anything
+// built at runtime goes in through "%s". Strings passed as %s arguments are copied into the record.
+
+#define LLOG_RING_CAPACITY 256            // Records per thread, must be a power of two
+#define LLOG_RING_MAX_COUNT 64            // Threads beyond this log synchronously
+#define LLOG_RECORD_SIZE 512              // Bigger records skip the ring and get written synchronously
+#define LLOG_MESSAGE_MAX_LENGTH 16384
+#define LLOG_CONSOLE_LINE_MAX_LENGTH 1024
+#define LLOG_CONSOLE_QUEUE_CAPACITY 1024  // Lines in flight to the console, covers its whole scrollback so startup logs survive
+#define LLOG_WRITER_IDLE_SLEEP_MS 2
 
 enum LLogLevel : U8 {
     LLOG_LEVEL_TRACE,
@@ -27,13 +47,58 @@ enum LLogFlags : U8 {
     LLOG_FLAG_EXIT_ON_ERROR = 1 << 5,
 };
 
+struct LLogRecordHeader {
+    S64 time_ns;  // CLOCK_REALTIME
+    C8 const *file;
+    C8 const *func;
+    C8 const *fmt;
+    U32 line;
+    U16 arg_size;
+    LLogLevel level;
+};
+
+struct LLogRecord {
+    LLogRecordHeader header;
+    U8 args[LLOG_RECORD_SIZE - sizeof(LLogRecordHeader)];  // Same order as the conversions in fmt, strings are copied inline
+};
+
+struct alignas(64) LLogRing {
+    std::atomic<U32> head;  // Written by the owning thread
+    alignas(64) std::atomic<U32> tail;  // Written by whoever holds the consumer mutex
+    std::atomic<U32> dropped_count;
+    LLogRecord records[LLOG_RING_CAPACITY];
+};
+
+struct LLogConsoleQueue {
+    std::atomic<U32> head;  // Written by whoever holds the consumer mutex
+    alignas(64) std::atomic<U32> tail;  // Written by the main thread in llog_update
+    C8 lines[LLOG_CONSOLE_QUEUE_CAPACITY][LLOG_CONSOLE_LINE_MAX_LENGTH];
+};
+
 struct LLogger {
     LLogLevel level;
     U32 flags;
-    std::atomic_flag lock;
+
+    LLogRing rings[LLOG_RING_MAX_COUNT];
+    std::atomic<U32> ring_count;
+    LLogConsoleQueue console_queue;
+
+    mtx_t consumer_mutex;  // Serializes the writer thread and synchronous flushes, the rings' only consumers
+    BOOL consumer_mutex_ready;
+    thrd_t writer_thread;
+    std::atomic<BOOL> writer_running;
+    std::atomic<BOOL> writer_should_exit;
+
+    std::atomic<U64> dropped_count;          // Records lost to full rings
+    std::atomic<U64> dropped_console_count;  // Lines lost to a full console queue
+    U64 reported_dropped_count;
 };
 
 void llog_init();
+void llog_quit();    // Drains everything and stops the writer, also registered with atexit
+void llog_update();  // Main thread only, moves finished lines into the console
+void llog_flush();   // Blocks until every record logged so far is written
+U64 llog_get_dropped_count();
 void llog_set_level(LLogLevel level);
 void llog_set_flags(U32 flags);
 void llog_enable_flag(LLogFlags flag);
@@ -47,15 +112,16 @@ void llog_format(LLogLevel level, C8 const *file, C8 const *func, U32 line, C8 c
 void llog_raylib_cb(S32 log_level, C8 const *text, va_list args) __attribute__((format(printf, 2, 0)));
 FMOD_RESULT F_CALL llog_fmod_cb(FMOD_DEBUG_FLAGS flags, C8 const *file, S32 line, C8 const *func, C8 const *message);
 
-#define lll(level, ...) llog_format (level,            __FILE__, __func__, __LINE__, __VA_ARGS__)
-#define llt(...)        llog_format (LLOG_LEVEL_TRACE, __FILE__, __func__, __LINE__, __VA_ARGS__)
-#define lld(...)        llog_format (LLOG_LEVEL_DEBUG, __FILE__, __func__, __LINE__, __VA_ARGS__)
-#define lli(...)        llog_format (LLOG_LEVEL_INFO,  __FILE__, __func__, __LINE__, __VA_ARGS__)
-#define llw(...)        llog_format (LLOG_LEVEL_WARN,  __FILE__, __func__, __LINE__, __VA_ARGS__)
-#define lle(...)        llog_format (LLOG_LEVEL_ERROR, __FILE__, __func__, __LINE__, __VA_ARGS__)
-#define llf(...)        llog_format (LLOG_LEVEL_FATAL, __FILE__, __func__, __LINE__, __VA_ARGS__)
-#define lln(...)        llog_format (LLOG_LEVEL_NONE,  "",       "",       0,        __VA_ARGS__)
-#define lltty(...)      llog_format (LLOG_LEVEL_TTY,   __FILE__, __func__, __LINE__, __VA_ARGS__)
-#define llaaa           llog_format (LLOG_LEVEL_WARN,  __FILE__, __func__, __LINE__, "aaa")
-#define llbbb           llog_format (LLOG_LEVEL_WARN,  __FILE__, __func__, __LINE__, "bbb")
-#define lleee           llog_format (LLOG_LEVEL_FATAL, __FILE__, __func__, __LINE__, "eee")
+// The "" in front of fmt only compiles for string literals, see the NOTE at the top
+#define lll(level, fmt, ...) llog_format (level,            __FILE__, __func__, __LINE__, "" fmt __VA_OPT__(,) __VA_ARGS__)
+#define llt(fmt, ...)        llog_format (LLOG_LEVEL_TRACE, __FILE__, __func__, __LINE__, "" fmt __VA_OPT__(,) __VA_ARGS__)
+#define lld(fmt, ...)        llog_format (LLOG_LEVEL_DEBUG, __FILE__, __func__, __LINE__, "" fmt __VA_OPT__(,) __VA_ARGS__)
+#define lli(fmt, ...)        llog_format (LLOG_LEVEL_INFO,  __FILE__, __func__, __LINE__, "" fmt __VA_OPT__(,) __VA_ARGS__)
+#define llw(fmt, ...)        llog_format (LLOG_LEVEL_WARN,  __FILE__, __func__, __LINE__, "" fmt __VA_OPT__(,) __VA_ARGS__)
+#define lle(fmt, ...)        llog_format (LLOG_LEVEL_ERROR, __FILE__, __func__, __LINE__, "" fmt __VA_OPT__(,) __VA_ARGS__)
+#define llf(fmt, ...)        llog_format (LLOG_LEVEL_FATAL, __FILE__, __func__, __LINE__, "" fmt __VA_OPT__(,) __VA_ARGS__)
+#define lln(fmt, ...)        llog_format (LLOG_LEVEL_NONE,  "",       "",       0,        "" fmt __VA_OPT__(,) __VA_ARGS__)
+#define lltty(fmt, ...)      llog_format (LLOG_LEVEL_TTY,   __FILE__, __func__, __LINE__, "" fmt __VA_OPT__(,) __VA_ARGS__)
+#define llaaa                llog_format (LLOG_LEVEL_WARN,  __FILE__, __func__, __LINE__, "aaa")
+#define llbbb                llog_format (LLOG_LEVEL_WARN,  __FILE__, __func__, __LINE__, "bbb")
+#define lleee                llog_format (LLOG_LEVEL_FATAL, __FILE__, __func__, __LINE__, "eee")
@@ -18,6 +18,8 @@ S32 main(S32 argc, C8 const **argv) {
     args_add("InEmacs",      "Adjust log format for Emacs compilation buffer parsing", "-e",  "--emacs",        ARG_TYPE_BOOL);
     args_add("RebuildBlob",  "Force recreation of the asset blob file",                "-r",  "--rebuild-blob", ARG_TYPE_BOOL);
     args_add("Platform",     "Platform configuration (steam-deck, macbookair, etc)",   "-p",  "--platform",     ARG_TYPE_STRING);
+    args_add("Bench",        "Run a headless benchmark scenario and terminate",        "-b",  "--bench",        ARG_TYPE_STRING);
+    args_add("BenchFrames",  "Frames to measure in benchmark mode (0 = default)",      "-bf", "--bench-frames", ARG_TYPE_INTEGER);
     args_add("Help",         "Show this help message and exit",                        "-h",  "--help",         ARG_TYPE_BOOL);
 
     args_parse(OURO_TITLE, argc, argv);
@@ -65,10 +67,10 @@ S32 main(S32 argc, C8 const **argv) {
 
     memory_init({
         .alignment                             = 64,
-        .per_type[MEMORY_TYPE_ARENA_PERMANENT] = {false, MEBI(1024)},
-        .per_type[MEMORY_TYPE_ARENA_TRANSIENT] = {false, MEBI(512)},
-        .per_type[MEMORY_TYPE_ARENA_DEBUG]     = {false, MEBI(256)},
-        .per_type[MEMORY_TYPE_ARENA_MATH]      = {false, MEBI(64)},
+        .per_type[MEMORY_TYPE_ARENA_PERMANENT] = {false, MEBI(1024), false},
+        .per_type[MEMORY_TYPE_ARENA_TRANSIENT] = {false, MEBI(512),  true},
+        .per_type[MEMORY_TYPE_ARENA_DEBUG]     = {false, MEBI(256),  false},
+        .per_type[MEMORY_TYPE_ARENA_MATH]      = {false, MEBI(64),   false},
     });
 
     core_init(OURO_MAJOR, OURO_MINOR, OURO_PATCH, build_type);
@@ -14,6 +14,10 @@
 #include <raymath.h>
 #include <tinycthread.h>
 
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
 // Need for tinycthread on macOS
 #ifdef call_once
 #undef call_once
@@ -48,43 +52,148 @@ MAP_DECLARE(ITextCache, ITextCacheKey, ITextCacheValue, i_text_cache_hash, i_tex
 // ====================== BONE MATRIX CACHE ======================
 // ===============================================================
 
-// Bone matrix cache: Cache computed bone matrices to avoid redundant matrix math
-// Key: (model_name_hash, anim_index, frame)
+// Bone matrix cache: Cache computed bone matrices to avoid redundant matrix math, see MathBoneCache in math.hpp
+// Key: MATH_BONE_CACHE_KEY(model_name_hash, anim_index, frame)
 // Value: Array of bone matrices for all bones in the animation
-struct IBoneMatrixCacheKey {
-    U32 model_name_hash;  // Hash of model name
-    U16 anim_index;       // Animation index (max 65,536 animations)
-    U16 frame;            // Frame number    (max 65,536 frames)
-};
-struct IBoneMatrixCacheValue {
-    Matrix *bone_matrices;  // Pointer to allocated array (not inline, to keep slots small)
-    S32 bone_count;
-};
-U64 static inline i_bone_matrix_cache_hash(IBoneMatrixCacheKey key) {
-    // | 32 bits: model_name_hash | 16 bits: anim_index | 16 bits: frame |
-    return (U64)key.model_name_hash | ((U64)key.anim_index << 32) | ((U64)key.frame << 48);
+
+SZ static inline i_bone_cache_get_set_base(MathBoneCache const *cache, U64 key) {
+    return (hash_u64(key) & (cache->set_count - 1)) * MATH_BONE_CACHE_WAYS;
+}
+
+void math_bone_cache_init(MathBoneCache *cache, MemoryType type, SZ budget_bytes, S32 max_bones) {
+    // Whole sets only, and a power of two of them so the set lookup is a mask
+    SZ const slot_size = sizeof(MathBoneCacheSlot) + ((SZ)max_bones * (sizeof(Matrix) + sizeof(MathBoneTRS)));
+    SZ const max_sets  = glm::max(budget_bytes / (slot_size * MATH_BONE_CACHE_WAYS), (SZ)1);
+    SZ set_count       = 1;
+    while (set_count * 2 <= max_sets) { set_count *= 2; }
+
+    cache->set_count    = set_count;
+    cache->slot_count   = set_count * MATH_BONE_CACHE_WAYS;
+    cache->max_bones    = max_bones;
+    cache->budget_bytes = budget_bytes;
+    cache->slots        = mc(MathBoneCacheSlot *, cache->slot_count, sizeof(MathBoneCacheSlot), type);
+    cache->hands        = mc(std::atomic<U32> *, set_count, sizeof(std::atomic<U32>), type);
+
+    auto *matrices = mm(Matrix *, cache->slot_count * (SZ)max_bones * sizeof(Matrix), type);
+    auto *trs      = mm(MathBoneTRS *, cache->slot_count * (SZ)max_bones * sizeof(MathBoneTRS), type);
+    for (SZ i = 0; i < cache->slot_count; ++i) {
+        cache->slots[i].bone_matrices = &matrices[i * (SZ)max_bones];
+        cache->slots[i].bone_trs      = &trs[i * (SZ)max_bones];
+    }
+
+    cache->hits            = 0;
+    cache->misses          = 0;
+    cache->evictions       = 0;
+    cache->skipped_inserts = 0;
+    cache->used_slot_count = 0;
+}
+
+// Copies out either the matrices or the decomposed bones of a slot
+BOOL static i_bone_cache_get(MathBoneCache *cache, U64 key, Matrix *out_matrices, MathBoneTRS *out_trs, S32 bone_count) {
+    SZ const base = i_bone_cache_get_set_base(cache, key);
+    for (SZ way = 0; way < MATH_BONE_CACHE_WAYS; ++way) {
+        MathBoneCacheSlot *slot = &cache->slots[base + way];
+
+        U32 const version = slot->version.load(std::memory_order_acquire);
+        if (version == 0 || (version & 1) != 0) { continue; }
+        if (slot->key.load(std::memory_order_relaxed) != key) { continue; }
+        if (slot->bone_count.load(std::memory_order_relaxed) < bone_count) { continue; }
+
+        if (out_matrices) { ou_memcpy(out_matrices, slot->bone_matrices, sizeof(Matrix) * (SZ)bone_count); }
+        if (out_trs)      { ou_memcpy(out_trs, slot->bone_trs, sizeof(MathBoneTRS) * (SZ)bone_count); }
+
+        // A writer got in while we were copying, what we have might be torn
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot->version.load(std::memory_order_relaxed) != version) { continue; }
+
+        slot->referenced.store(1, std::memory_order_relaxed);
+        cache->hits.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    cache->misses.fetch_add(1, std::memory_order_relaxed);
+    return false;
 }
-BOOL static inline i_bone_matrix_cache_equal(IBoneMatrixCacheKey a, IBoneMatrixCacheKey b) {
-    return a.model_name_hash == b.model_name_hash && a.anim_index == b.anim_index && a.frame == b.frame;
+
+BOOL math_bone_cache_get(MathBoneCache *cache, U64 key, Matrix *out_matrices, S32 bone_count) {
+    return i_bone_cache_get(cache, key, out_matrices, nullptr, bone_count);
+}
+
+BOOL math_bone_cache_get_trs(MathBoneCache *cache, U64 key, MathBoneTRS *out_trs, S32 bone_count) {
+    return i_bone_cache_get(cache, key, nullptr, out_trs, bone_count);
+}
+
+void math_bone_cache_put(MathBoneCache *cache, U64 key, Matrix const *matrices, MathBoneTRS const *trs, S32 bone_count) {
+    if (bone_count > cache->max_bones) { return; }
+
+    SZ const base = i_bone_cache_get_set_base(cache, key);
+
+    // Another thread may have missed on the same key and beaten us to it
+    for (SZ way = 0; way < MATH_BONE_CACHE_WAYS; ++way) {
+        MathBoneCacheSlot const *slot = &cache->slots[base + way];
+        U32 const version             = slot->version.load(std::memory_order_acquire);
+        if (version != 0 && (version & 1) == 0 && slot->key.load(std::memory_order_relaxed) == key) { return; }
+    }
+
+    // CLOCK, referenced slots get a second chance, two sweeps clear every bit at least once
+    std::atomic<U32> *hand = &cache->hands[base / MATH_BONE_CACHE_WAYS];
+    for (SZ step = 0; step < MATH_BONE_CACHE_WAYS * 2; ++step) {
+        MathBoneCacheSlot *slot = &cache->slots[base + (hand->fetch_add(1, std::memory_order_relaxed) % MATH_BONE_CACHE_WAYS)];
+
+        U32 version = slot->version.load(std::memory_order_relaxed);
+        if ((version & 1) != 0) { continue; }
+        if (version != 0 && slot->referenced.exchange(0, std::memory_order_relaxed) != 0) { continue; }
+        if (!slot->version.compare_exchange_strong(version, version + 1, std::memory_order_acq_rel)) { continue; }
+
+        if (version == 0) {
+            cache->used_slot_count.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            cache->evictions.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        slot->key.store(key, std::memory_order_relaxed);
+        slot->bone_count.store(bone_count, std::memory_order_relaxed);
+        ou_memcpy(slot->bone_matrices, matrices, sizeof(Matrix) * (SZ)bone_count);
+        ou_memcpy(slot->bone_trs, trs, sizeof(MathBoneTRS) * (SZ)bone_count);
+        slot->version.store(version + 2, std::memory_order_release);
+        return;
+    }
+
+    cache->skipped_inserts.fetch_add(1, std::memory_order_relaxed);
+}
+
+MathBoneCacheStats math_bone_cache_get_stats(MathBoneCache const *cache) {
+    MathBoneCacheStats stats = {};
+    stats.hits               = cache->hits.load(std::memory_order_relaxed);
+    stats.misses             = cache->misses.load(std::memory_order_relaxed);
+    stats.evictions          = cache->evictions.load(std::memory_order_relaxed);
+    stats.skipped_inserts    = cache->skipped_inserts.load(std::memory_order_relaxed);
+    stats.used_slot_count    = cache->used_slot_count.load(std::memory_order_relaxed);
+    stats.slot_count         = cache->slot_count;
+    stats.budget_bytes       = cache->budget_bytes;
+    return stats;
 }
-#define BONE_MATRIX_CACHE_INITIAL_CAPACITY 256
-MAP_DECLARE(IBoneMatrixCache, IBoneMatrixCacheKey, IBoneMatrixCacheValue, i_bone_matrix_cache_hash, i_bone_matrix_cache_equal)
 
 // ===============================================================
 
 struct IMathCache {
     ITextCache text;
-    IBoneMatrixCache bone_matrices;
+    MathBoneCache bone_matrices;
 };
 
 IMathCache static i_cache = {};
-mtx_t static i_bone_cache_write_mutex = {};
 
 void math_init() {
     random_seed(RANDOM_SEED);
     ITextCache_init(&i_cache.text, MEMORY_TYPE_ARENA_MATH, TEXT_CACHE_INITIAL_CAPACITY);
-    IBoneMatrixCache_init(&i_cache.bone_matrices, MEMORY_TYPE_ARENA_PERMANENT, BONE_MATRIX_CACHE_INITIAL_CAPACITY);
-    mtx_init(&i_bone_cache_write_mutex, mtx_plain);
+
+    // Sized once, the animation jobs read it without a lock so it can never be reallocated under them
+    SZ const bone_cache_budget = (SZ)glm::max(c_world__bone_cache_budget_mb, 1) * 1024 * 1024;
+    math_bone_cache_init(&i_cache.bone_matrices, MEMORY_TYPE_ARENA_PERMANENT, bone_cache_budget, ENTITY_MAX_BONES);
+}
+
+MathBoneCacheStats math_get_bone_cache_stats() {
+    return math_bone_cache_get_stats(&i_cache.bone_matrices);
 }
 
 void math_update() {
@@ -737,11 +846,248 @@ void math_matrix_decompose(Matrix mat, Vector3 *translation, Quaternion *rotatio
     *rotation = QuaternionFromMatrix(rot_mat);
 }
 
+// ====== BONE BLENDING ======
+
+#if defined(__AVX2__)
+
+#define I_BONE_BLEND_WIDTH 8
+using IBoneF32x = __m256;
+
+IBoneF32x static inline i_bone_load(F32 const *p)                { return _mm256_loadu_ps(p); }
+void static inline i_bone_store(F32 *p, IBoneF32x v)             { _mm256_storeu_ps(p, v); }
+IBoneF32x static inline i_bone_set1(F32 v)                       { return _mm256_set1_ps(v); }
+IBoneF32x static inline i_bone_add(IBoneF32x a, IBoneF32x b)     { return _mm256_add_ps(a, b); }
+IBoneF32x static inline i_bone_sub(IBoneF32x a, IBoneF32x b)     { return _mm256_sub_ps(a, b); }
+IBoneF32x static inline i_bone_mul(IBoneF32x a, IBoneF32x b)     { return _mm256_mul_ps(a, b); }
+IBoneF32x static inline i_bone_rsqrt(IBoneF32x a)                { return _mm256_div_ps(_mm256_set1_ps(1.0F), _mm256_sqrt_ps(a)); }
+IBoneF32x static inline i_bone_sign(IBoneF32x a)                 { return _mm256_and_ps(_mm256_cmp_ps(a, _mm256_setzero_ps(), _CMP_LT_OQ), _mm256_set1_ps(-0.0F)); }
+IBoneF32x static inline i_bone_flip(IBoneF32x a, IBoneF32x sign) { return _mm256_xor_ps(a, sign); }
+
+#elif defined(__SSE2__)
+
+#define I_BONE_BLEND_WIDTH 4
+using IBoneF32x = __m128;
+
+IBoneF32x static inline i_bone_load(F32 const *p)                { return _mm_loadu_ps(p); }
+void static inline i_bone_store(F32 *p, IBoneF32x v)             { _mm_storeu_ps(p, v); }
+IBoneF32x static inline i_bone_set1(F32 v)                       { return _mm_set1_ps(v); }
+IBoneF32x static inline i_bone_add(IBoneF32x a, IBoneF32x b)     { return _mm_add_ps(a, b); }
+IBoneF32x static inline i_bone_sub(IBoneF32x a, IBoneF32x b)     { return _mm_sub_ps(a, b); }
+IBoneF32x static inline i_bone_mul(IBoneF32x a, IBoneF32x b)     { return _mm_mul_ps(a, b); }
+IBoneF32x static inline i_bone_rsqrt(IBoneF32x a)                { return _mm_div_ps(_mm_set1_ps(1.0F), _mm_sqrt_ps(a)); }
+IBoneF32x static inline i_bone_sign(IBoneF32x a)                 { return _mm_and_ps(_mm_cmplt_ps(a, _mm_setzero_ps()), _mm_set1_ps(-0.0F)); }
+IBoneF32x static inline i_bone_flip(IBoneF32x a, IBoneF32x sign) { return _mm_xor_ps(a, sign); }
+
+#else
+
+#define I_BONE_BLEND_WIDTH 1
+using IBoneF32x = F32;
+
+IBoneF32x static inline i_bone_load(F32 const *p)                { return *p; }
+void static inline i_bone_store(F32 *p, IBoneF32x v)             { *p = v; }
+IBoneF32x static inline i_bone_set1(F32 v)                       { return v; }
+IBoneF32x static inline i_bone_add(IBoneF32x a, IBoneF32x b)     { return a + b; }
+IBoneF32x static inline i_bone_sub(IBoneF32x a, IBoneF32x b)     { return a - b; }
+IBoneF32x static inline i_bone_mul(IBoneF32x a, IBoneF32x b)     { return a * b; }
+IBoneF32x static inline i_bone_rsqrt(IBoneF32x a)                { return 1.0F / math_sqrt_f32(a); }
+IBoneF32x static inline i_bone_sign(IBoneF32x a)                 { return a < 0.0F ? -1.0F : 1.0F; }
+IBoneF32x static inline i_bone_flip(IBoneF32x a, IBoneF32x sign) { return a * sign; }
+
+#endif
+
+static_assert(MATH_BONE_BLEND_BATCH_SIZE % I_BONE_BLEND_WIDTH == 0, "Batch must be a whole number of lanes");
+
+void math_bone_trs_from_matrix(Matrix mat, MathBoneTRS *out) {
+    math_matrix_decompose(mat, &out->translation, &out->rotation, &out->scale);
+}
+
+void math_bone_blend_batch_add(MathBoneBlendBatch *batch, MathBoneTRS const *prev, MathBoneTRS const *next, F32 t, Matrix *out) {
+    if (batch->count == MATH_BONE_BLEND_BATCH_SIZE) { math_bone_blend_batch_flush(batch); }
+
+    SZ const i = batch->count++;
+    F32 const p[10] = {prev->translation.x, prev->translation.y, prev->translation.z, prev->rotation.x, prev->rotation.y,
+                       prev->rotation.z,    prev->rotation.w,    prev->scale.x,       prev->scale.y,    prev->scale.z};
+    F32 const n[10] = {next->translation.x, next->translation.y, next->translation.z, next->rotation.x, next->rotation.y,
+                       next->rotation.z,    next->rotation.w,    next->scale.x,       next->scale.y,    next->scale.z};
+    for (SZ c = 0; c < 10; ++c) {
+        batch->prev[c][i] = p[c];
+        batch->next[c][i] = n[c];
+    }
+    batch->t[i]   = t;
+    batch->out[i] = out;
+}
+
+// Lerps translation and scale, rotation is an nlerp with the corrected t from "Approximating slerp" (Kapoulkine),
+// close to a real slerp without any trig. Recomposes the same S * R * T matrix the scalar path used to build.
+void math_bone_blend_batch_flush(MathBoneBlendBatch *batch) {
+    SZ const count = batch->count;
+    if (count == 0) { return; }
+
+    // Pad the last lanes with identity so nothing in them divides by zero
+    SZ const padded = ((count + I_BONE_BLEND_WIDTH - 1) / I_BONE_BLEND_WIDTH) * I_BONE_BLEND_WIDTH;
+    for (SZ i = count; i < padded; ++i) {
+        for (SZ c = 0; c < 10; ++c) {
+            batch->prev[c][i] = c == 6 ? 1.0F : 0.0F;
+            batch->next[c][i] = c == 6 ? 1.0F : 0.0F;
+        }
+        batch->t[i] = 0.0F;
+    }
+
+    IBoneF32x const one  = i_bone_set1(1.0F);
+    IBoneF32x const two  = i_bone_set1(2.0F);
+    IBoneF32x const half = i_bone_set1(0.5F);
+
+    for (SZ i = 0; i < padded; i += I_BONE_BLEND_WIDTH) {
+        IBoneF32x const t  = i_bone_load(&batch->t[i]);
+        IBoneF32x const it = i_bone_sub(one, t);
+
+        IBoneF32x p[10];
+        IBoneF32x n[10];
+        for (SZ c = 0; c < 10; ++c) {
+            p[c] = i_bone_load(&batch->prev[c][i]);
+            n[c] = i_bone_load(&batch->next[c][i]);
+        }
+
+        // Shortest arc, then the slerp correction of t based on how far apart the rotations are
+        IBoneF32x const dot  = i_bone_add(i_bone_add(i_bone_mul(p[3], n[3]), i_bone_mul(p[4], n[4])), i_bone_add(i_bone_mul(p[5], n[5]), i_bone_mul(p[6], n[6])));
+        IBoneF32x const sign = i_bone_sign(dot);
+        IBoneF32x const d    = i_bone_flip(dot, sign);
+        IBoneF32x const a    = i_bone_add(i_bone_set1(1.0904F), i_bone_mul(d, i_bone_add(i_bone_set1(-3.2452F), i_bone_mul(d, i_bone_sub(i_bone_set1(3.55645F), i_bone_mul(d, i_bone_set1(1.43519F)))))));
+        IBoneF32x const b    = i_bone_add(i_bone_set1(0.848013F), i_bone_mul(d, i_bone_add(i_bone_set1(-1.06021F), i_bone_mul(d, i_bone_set1(0.215638F)))));
+        IBoneF32x const th   = i_bone_sub(t, half);
+        IBoneF32x const k    = i_bone_add(i_bone_mul(a, i_bone_mul(th, th)), b);
+        IBoneF32x const ot   = i_bone_add(t, i_bone_mul(i_bone_mul(t, th), i_bone_mul(i_bone_sub(t, one), k)));
+        IBoneF32x const iot  = i_bone_sub(one, ot);
+
+        IBoneF32x q[4];
+        for (SZ c = 0; c < 4; ++c) { q[c] = i_bone_add(i_bone_mul(p[3 + c], iot), i_bone_mul(i_bone_flip(n[3 + c], sign), ot)); }
+        IBoneF32x const inv_len = i_bone_rsqrt(i_bone_add(i_bone_add(i_bone_mul(q[0], q[0]), i_bone_mul(q[1], q[1])), i_bone_add(i_bone_mul(q[2], q[2]), i_bone_mul(q[3], q[3]))));
+        IBoneF32x const x       = i_bone_mul(q[0], inv_len);
+        IBoneF32x const y       = i_bone_mul(q[1], inv_len);
+        IBoneF32x const z       = i_bone_mul(q[2], inv_len);
+        IBoneF32x const w       = i_bone_mul(q[3], inv_len);
+
+        IBoneF32x const tx = i_bone_add(i_bone_mul(p[0], it), i_bone_mul(n[0], t));
+        IBoneF32x const ty = i_bone_add(i_bone_mul(p[1], it), i_bone_mul(n[1], t));
+        IBoneF32x const tz = i_bone_add(i_bone_mul(p[2], it), i_bone_mul(n[2], t));
+        IBoneF32x const sx = i_bone_add(i_bone_mul(p[7], it), i_bone_mul(n[7], t));
+        IBoneF32x const sy = i_bone_add(i_bone_mul(p[8], it), i_bone_mul(n[8], t));
+        IBoneF32x const sz = i_bone_add(i_bone_mul(p[9], it), i_bone_mul(n[9], t));
+
+        // Same layout as raymath's QuaternionToMatrix, every basis vector scaled by its axis
+        IBoneF32x const xx = i_bone_mul(x, x);
+        IBoneF32x const yy = i_bone_mul(y, y);
+        IBoneF32x const zz = i_bone_mul(z, z);
+        IBoneF32x const xy = i_bone_mul(x, y);
+        IBoneF32x const xz = i_bone_mul(x, z);
+        IBoneF32x const yz = i_bone_mul(y, z);
+        IBoneF32x const xw = i_bone_mul(x, w);
+        IBoneF32x const yw = i_bone_mul(y, w);
+        IBoneF32x const zw = i_bone_mul(z, w);
+
+        F32 lanes[12][I_BONE_BLEND_WIDTH];
+        i_bone_store(lanes[0], i_bone_mul(i_bone_sub(one, i_bone_mul(two, i_bone_add(yy, zz))), sx));  // m0
+        i_bone_store(lanes[1], i_bone_mul(i_bone_mul(two, i_bone_add(xy, zw)), sx));                   // m1
+        i_bone_store(lanes[2], i_bone_mul(i_bone_mul(two, i_bone_sub(xz, yw)), sx));                   // m2
+        i_bone_store(lanes[3], i_bone_mul(i_bone_mul(two, i_bone_sub(xy, zw)), sy));                   // m4
+        i_bone_store(lanes[4], i_bone_mul(i_bone_sub(one, i_bone_mul(two, i_bone_add(xx, zz))), sy));  // m5
+        i_bone_store(lanes[5], i_bone_mul(i_bone_mul(two, i_bone_add(yz, xw)), sy));                   // m6
+        i_bone_store(lanes[6], i_bone_mul(i_bone_mul(two, i_bone_add(xz, yw)), sz));                   // m8
+        i_bone_store(lanes[7], i_bone_mul(i_bone_mul(two, i_bone_sub(yz, xw)), sz));                   // m9
+        i_bone_store(lanes[8], i_bone_mul(i_bone_sub(one, i_bone_mul(two, i_bone_add(xx, yy))), sz));  // m10
+        i_bone_store(lanes[9], tx);
+        i_bone_store(lanes[10], ty);
+        i_bone_store(lanes[11], tz);
+
+        SZ const lane_count = glm::min((SZ)I_BONE_BLEND_WIDTH, count - i);
+        for (SZ l = 0; l < lane_count; ++l) {
+            Matrix *m = batch->out[i + l];
+            m->m0     = lanes[0][l];
+            m->m1     = lanes[1][l];
+            m->m2     = lanes[2][l];
+            m->m3     = 0.0F;
+            m->m4     = lanes[3][l];
+            m->m5     = lanes[4][l];
+            m->m6     = lanes[5][l];
+            m->m7     = 0.0F;
+            m->m8     = lanes[6][l];
+            m->m9     = lanes[7][l];
+            m->m10    = lanes[8][l];
+            m->m11    = 0.0F;
+            m->m12    = lanes[9][l];
+            m->m13    = lanes[10][l];
+            m->m14    = lanes[11][l];
+            m->m15    = 1.0F;
+        }
+    }
+
+    batch->count = 0;
+}
+
+// ====== SOCKETS ======
+
+// Same world transform d3d_model_animated draws the entity with
+Matrix static i_entity_transform(EID id) {
+    Vector3 const position = g_world->position[id];
+    Vector3 const scale    = g_world->scale[id];
+    F32 const rotation     = g_world->rotation[id];
+
+    Matrix mat_scale    = MatrixScale(scale.x, scale.y, scale.z);
+    Matrix mat_rotation = MatrixRotate((Vector3){0, 1, 0}, rotation * DEG2RAD);
+    Matrix mat_position = MatrixTranslate(position.x, position.y, position.z);
+    return MatrixMultiply(MatrixMultiply(mat_scale, mat_rotation), mat_position);
+}
+
+// Bone in entity space the way raylib's socket example builds it, rotation relative to the bind pose
+Matrix static i_socket_local_transform(AModel const *model, ModelAnimation const &anim, U32 frame, S32 bone_index) {
+    Transform const *bone_transform = &anim.framePoses[frame][bone_index];
+    Quaternion const rotate         = QuaternionMultiply(bone_transform->rotation, QuaternionInvert(model->base.bindPose[bone_index].rotation));
+    return MatrixMultiply(QuaternionToMatrix(rotate),
+                          MatrixTranslate(bone_transform->translation.x, bone_transform->translation.y, bone_transform->translation.z));
+}
+
+// Runs in the animation jobs next to the bone matrices, every entity only writes its own sockets
+void static i_compute_entity_sockets(EID id, AModel const *model, ModelAnimation const &anim, U32 frame) {
+    AnimationBoneData *bones = &g_animation_bones[id];
+    bones->socket_mask       = 0;
+
+    // While blending the sockets move from where they were in the previous animation
+    ModelAnimation const *prev_anim = nullptr;
+    U32 prev_frame                  = 0;
+    F32 blend_t                     = 1.0F;
+    U32 const prev_anim_idx         = g_world->animation[id].prev_anim_index;
+    if (g_world->animation[id].is_blending && prev_anim_idx < (U32)model->animation_count) {
+        prev_anim  = &model->animations[prev_anim_idx];
+        prev_frame = glm::min((U32)prev_anim->frameCount - 1, frame);
+        blend_t    = glm::clamp(g_world->animation[id].blend_time / g_world->animation[id].blend_duration, 0.0F, 1.0F);
+    }
+
+    for (S32 socket = 0; socket < A_MODEL_SOCKET_COUNT; ++socket) {
+        S32 const bone = model->socket_bones[socket];
+        if (bone == A_MODEL_SOCKET_NONE || bone >= anim.boneCount) { continue; }
+
+        Matrix local = i_socket_local_transform(model, anim, frame, bone);
+        if (prev_anim && bone < prev_anim->boneCount) {
+            MathBoneTRS from = {};
+            MathBoneTRS to   = {};
+            math_bone_trs_from_matrix(i_socket_local_transform(model, *prev_anim, prev_frame, bone), &from);
+            math_bone_trs_from_matrix(local, &to);
+
+            Quaternion const rotation = QuaternionSlerp(from.rotation, to.rotation, blend_t);
+            Vector3 const translation = Vector3Lerp(from.translation, to.translation, blend_t);
+            local = MatrixMultiply(QuaternionToMatrix(rotation), MatrixTranslate(translation.x, translation.y, translation.z));
+        }
+
+        bones->socket_transforms[socket] = local;
+        bones->socket_mask              |= (U8)(1U << socket);
+    }
+}
+
 // Compute bone matrices for entity based on its animation state
 // Similar to UpdateModelAnimationBones but writes to per-entity storage
 // Supports blending between animations for smooth transitions
 // Uses caching to avoid redundant matrix computation for same model/animation/frame
-void  math_compute_entity_bone_matrices(EID id) {
+void math_compute_entity_bone_matrices(EID id, MathBoneBlendBatch *batch) {
     AModel *model = asset_get_model_by_hash(g_world->model_name_hash[id]);
 
     // Skip if model has no animations or bones
@@ -758,28 +1104,21 @@ void  math_compute_entity_bone_matrices(EID id) {
     // Validate frame
     if (frame >= (U32)anim.frameCount) { return; }
 
-    // Check cache for already-computed bone matrices (using pre-computed hash from asset)
-    IBoneMatrixCacheKey const key = {model->header.name_hash, (U16)anim_idx, (U16)frame};
-    S32 bone_count                = anim.boneCount < ENTITY_MAX_BONES ? anim.boneCount : ENTITY_MAX_BONES;
-
-    IBoneMatrixCacheValue *cached = IBoneMatrixCache_get(&i_cache.bone_matrices, key);
-    Matrix *source_matrices       = nullptr;
-
-    if (cached != nullptr) {
-        // Cache hit - use cached matrices directly
-        source_matrices = cached->bone_matrices;
-    } else {
-        // Cache miss - compute and store in cache (thread-safe with mutex)
-        mtx_lock(&i_bone_cache_write_mutex);
-
-        // Double-check cache after acquiring lock (another thread may have inserted)
-        cached = IBoneMatrixCache_get(&i_cache.bone_matrices, key);
-        if (cached != nullptr) {
-            mtx_unlock(&i_bone_cache_write_mutex);
-            source_matrices = cached->bone_matrices;
-        } else {
-            Matrix *allocated_matrices = mcpa(Matrix *, (SZ)bone_count, sizeof(Matrix));
+    // Sockets come straight from the frame poses, so they do not have to wait for the blend batch
+    i_compute_entity_sockets(id, model, anim, frame);
 
+    // Check cache for already-computed bone matrices (using pre-computed hash from asset)
+    U64 const key           = MATH_BONE_CACHE_KEY(model->header.name_hash, anim_idx, frame);
+    S32 const bone_count   = anim.boneCount < ENTITY_MAX_BONES ? anim.boneCount : ENTITY_MAX_BONES;
+    BOOL const is_blending = g_world->animation[id].is_blending;
+
+    // Blending only needs the decomposed pose, everything else copies the matrices straight into the entity.
+    // On a miss the entity's own array is the scratch space, a blend overwrites it once the batch is flushed.
+    Matrix *bone_matrices = g_animation_bones[id].bone_matrices;
+    MathBoneTRS target_trs[ENTITY_MAX_BONES];
+    BOOL const hit = is_blending ? math_bone_cache_get_trs(&i_cache.bone_matrices, key, target_trs, bone_count)
+                                 : math_bone_cache_get(&i_cache.bone_matrices, key, bone_matrices, bone_count);
+    if (!hit) {
         for (S32 bone_id = 0; bone_id < bone_count; bone_id++) {
             Transform *bind_transform = &model->base.bindPose[bone_id];
             Matrix bind_matrix        = MatrixMultiply(MatrixMultiply(
@@ -793,53 +1132,39 @@ void  math_compute_entity_bone_matrices(EID id) {
                 QuaternionToMatrix(target_transform->rotation)),
                 MatrixTranslate(target_transform->translation.x, target_transform->translation.y, target_transform->translation.z));
 
-            allocated_matrices[bone_id] = MatrixMultiply(MatrixInvert(bind_matrix), target_matrix);
+            bone_matrices[bone_id] = MatrixMultiply(MatrixInvert(bind_matrix), target_matrix);
+            math_bone_trs_from_matrix(bone_matrices[bone_id], &target_trs[bone_id]);
         }
 
-            IBoneMatrixCacheValue value = {};
-            value.bone_matrices         = allocated_matrices;
-            value.bone_count            = bone_count;
-            IBoneMatrixCache_insert(&i_cache.bone_matrices, key, value);
-
-            mtx_unlock(&i_bone_cache_write_mutex);
-            source_matrices = allocated_matrices;
-        }
+        math_bone_cache_put(&i_cache.bone_matrices, key, bone_matrices, target_trs, bone_count);
     }
 
-    // If blending, interpolate between previous and new bone matrices
-    if (g_world->animation[id].is_blending) {
-        F32 blend_t = g_world->animation[id].blend_time / g_world->animation[id].blend_duration;
-        blend_t = glm::clamp(blend_t, 0.0F, 1.0F);
+    if (!is_blending) { return; }
 
-        for (S32 bone_id = 0; bone_id < bone_count; bone_id++) {
-            // Decompose both matrices into TRS components
-            Vector3 prev_trans;
-            Vector3 new_trans;
-            Vector3 prev_scale;
-            Vector3 new_scale;
-            Quaternion prev_rot;
-            Quaternion new_rot;
-
-            math_matrix_decompose(g_animation_bones[id].prev_bone_matrices[bone_id], &prev_trans, &prev_rot, &prev_scale);
-            math_matrix_decompose(source_matrices[bone_id], &new_trans, &new_rot, &new_scale);
-
-            // Interpolate components
-            Vector3 blended_trans  = Vector3Lerp(prev_trans, new_trans, blend_t);
-            Quaternion blended_rot = QuaternionSlerp(prev_rot, new_rot, blend_t);
-            Vector3 blended_scale  = Vector3Lerp(prev_scale, new_scale, blend_t);
-
-            // Reconstruct blended matrix
-            g_animation_bones[id].bone_matrices[bone_id] = MatrixMultiply(MatrixMultiply(
-                MatrixScale(blended_scale.x, blended_scale.y, blended_scale.z),
-                QuaternionToMatrix(blended_rot)),
-                MatrixTranslate(blended_trans.x, blended_trans.y, blended_trans.z));
-        }
-    } else {
-        // No blending - single copy from cache/computed matrices to entity
-        ou_memcpy(g_animation_bones[id].bone_matrices, source_matrices, sizeof(Matrix) * (SZ)bone_count);
+    // Queue every bone, the batch writes the blended matrices into the entity when it gets flushed
+    F32 blend_t = g_world->animation[id].blend_time / g_world->animation[id].blend_duration;
+    blend_t     = glm::clamp(blend_t, 0.0F, 1.0F);
+    for (S32 bone_id = 0; bone_id < bone_count; bone_id++) {
+        math_bone_blend_batch_add(batch, &g_animation_bones[id].prev_bone_trs[bone_id], &target_trs[bone_id], blend_t, &bone_matrices[bone_id]);
     }
 }
 
+BOOL math_get_entity_socket_transform(EID id, AModelSocket socket, Matrix *out_transform) {
+    AnimationBoneData const *bones = &g_animation_bones[id];
+    if (!(bones->socket_mask & (1U << socket))) { return false; }
+
+    *out_transform = MatrixMultiply(bones->socket_transforms[socket], i_entity_transform(id));
+    return true;
+}
+
+BOOL math_get_entity_socket_position(EID id, AModelSocket socket, Vector3 *out_position) {
+    Matrix transform = {};
+    if (!math_get_entity_socket_transform(id, socket, &transform)) { return false; }
+
+    *out_position = {transform.m12, transform.m13, transform.m14};
+    return true;
+}
+
 BOOL math_get_bone_world_position_by_index(EID id, S32 bone_index, Vector3 *out_position) {
     AModel *model = asset_get_model_by_hash(g_world->model_name_hash[id]);
 
@@ -854,36 +1179,11 @@ BOOL math_get_bone_world_position_by_index(EID id, S32 bone_index, Vector3 *out_
     S32 const bone_count = g_world->animation[id].bone_count;
     if (bone_index < 0 || bone_index >= bone_count) { return false; }
 
-    // Build entity world transform matrix (same as d3d_model_animated)
-    Vector3 const position = g_world->position[id];
-    Vector3 const scale    = g_world->scale[id];
-    F32 const rotation     = g_world->rotation[id];
-
-    Matrix mat_scale    = MatrixScale(scale.x, scale.y, scale.z);
-    Matrix mat_rotation = MatrixRotate((Vector3){0, 1, 0}, rotation * DEG2RAD);
-    Matrix mat_position = MatrixTranslate(position.x, position.y, position.z);
-    Matrix entity_transform = MatrixMultiply(MatrixMultiply(mat_scale, mat_rotation), mat_position);
-
-    // Get bone transforms
-    Transform *bone_transform = &anim.framePoses[frame][bone_index];
-    Quaternion in_rotation = model->base.bindPose[bone_index].rotation;
-    Quaternion out_rotation = bone_transform->rotation;
-
-    // Calculate socket rotation (angle between bone in initial pose and current frame)
-    Quaternion rotate = QuaternionMultiply(out_rotation, QuaternionInvert(in_rotation));
-    Matrix matrix_transform = QuaternionToMatrix(rotate);
-
-    // Translate socket to its position in the current animation
-    matrix_transform = MatrixMultiply(matrix_transform,
-                      MatrixTranslate(bone_transform->translation.x,
-                                     bone_transform->translation.y,
-                                     bone_transform->translation.z));
-
-    // Transform using the entity's world transform
-    matrix_transform = MatrixMultiply(matrix_transform, entity_transform);
+    Matrix const entity_transform = i_entity_transform(id);
 
     // Extract world position
-    Vector3 bone_pos = (Vector3){matrix_transform.m12, matrix_transform.m13, matrix_transform.m14};
+    Matrix matrix_transform = MatrixMultiply(i_socket_local_transform(model, anim, frame, bone_index), entity_transform);
+    Vector3 bone_pos        = (Vector3){matrix_transform.m12, matrix_transform.m13, matrix_transform.m14};
 
     // If blending, compute previous animation's bone position using raylib socket method
     if (g_world->animation[id].is_blending) {
@@ -894,26 +1194,8 @@ BOOL math_get_bone_world_position_by_index(EID id, S32 bone_index, Vector3 *out_
             // Use last frame of previous animation (or current frame if available)
             U32 const prev_frame = glm::min((U32)prev_anim.frameCount - 1, frame);
 
-            // Get previous bone transforms using raylib socket method
-            Transform *prev_bone_transform = &prev_anim.framePoses[prev_frame][bone_index];
-            Quaternion prev_in_rotation = model->base.bindPose[bone_index].rotation;
-            Quaternion prev_out_rotation = prev_bone_transform->rotation;
-
-            // Calculate socket rotation for previous frame
-            Quaternion prev_rotate = QuaternionMultiply(prev_out_rotation, QuaternionInvert(prev_in_rotation));
-            Matrix prev_matrix_transform = QuaternionToMatrix(prev_rotate);
-
-            // Translate socket to its position in the previous animation
-            prev_matrix_transform = MatrixMultiply(prev_matrix_transform,
-                                  MatrixTranslate(prev_bone_transform->translation.x,
-                                                 prev_bone_transform->translation.y,
-                                                 prev_bone_transform->translation.z));
-
-            // Transform using the entity's world transform
-            prev_matrix_transform = MatrixMultiply(prev_matrix_transform, entity_transform);
-
-            // Extract previous world position
-            Vector3 prev_bone_pos = (Vector3){prev_matrix_transform.m12, prev_matrix_transform.m13, prev_matrix_transform.m14};
+            Matrix prev_matrix_transform = MatrixMultiply(i_socket_local_transform(model, prev_anim, prev_frame, bone_index), entity_transform);
+            Vector3 prev_bone_pos        = (Vector3){prev_matrix_transform.m12, prev_matrix_transform.m13, prev_matrix_transform.m14};
 
             // Interpolate between previous and current position
             F32 blend_t = g_world->animation[id].blend_time / g_world->animation[id].blend_duration;
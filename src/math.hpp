@@ -1,7 +1,9 @@
 #pragma once
 
 #include "common.hpp"
+#include "memory.hpp"
 
+#include <atomic>
 #include <math.h>
 #include <raylib.h>
 #include <glm/common.hpp>
@@ -9,6 +11,7 @@
 #include <glm/trigonometric.hpp>
 
 fwd_decl(AFont);
+fwd_decl_enum(AModelSocket, U8);
 fwd_decl(ATerrain);
 fwd_decl(World);
 
@@ -16,6 +19,67 @@ fwd_decl(World);
 
 enum MoveDirection : U8 { MOVE_FORWARD, MOVE_BACKWARD, MOVE_LEFT, MOVE_RIGHT, TURN_LEFT, TURN_RIGHT, TURN_180 };
 
+// Fixed-capacity bone matrix cache keyed by (model, animation, frame), shared by the animation jobs without a lock.
+// Slots are grouped into sets of MATH_BONE_CACHE_WAYS, a key only ever lives in its own set and eviction runs CLOCK
+// inside that set. Every slot is a seqlock: writers claim it by making the version odd, readers copy the matrices out
+// and retry nothing, a copy that raced a writer simply counts as a miss. Nothing is ever freed or moved while running.
+#define MATH_BONE_CACHE_WAYS 8
+#define MATH_BONE_CACHE_KEY(model_hash, anim, frame) ((U64)(model_hash) | ((U64)(U16)(anim) << 32) | ((U64)(U16)(frame) << 48))
+
+// A bone matrix decomposed into what blending interpolates, rotation is a unit quaternion
+struct MathBoneTRS {
+    Vector3 translation;
+    Quaternion rotation;
+    Vector3 scale;
+};
+
+struct MathBoneCacheSlot {
+    std::atomic<U32> version;    // 0 when never filled, odd while a writer owns the slot
+    std::atomic<U8> referenced;  // CLOCK bit, set on every hit
+    std::atomic<U64> key;
+    std::atomic<S32> bone_count;
+    Matrix *bone_matrices;       // max_bones matrices owned by this slot
+    MathBoneTRS *bone_trs;       // The same bones decomposed, so blending never has to decompose per entity
+};
+
+struct MathBoneCache {
+    MathBoneCacheSlot *slots;
+    std::atomic<U32> *hands;  // One CLOCK hand per set
+    SZ set_count;             // Power of two
+    SZ slot_count;
+    S32 max_bones;
+    SZ budget_bytes;
+
+    std::atomic<U64> hits;
+    std::atomic<U64> misses;
+    std::atomic<U64> evictions;
+    std::atomic<U64> skipped_inserts;  // Every candidate slot in the set was busy
+    std::atomic<SZ> used_slot_count;
+};
+
+struct MathBoneCacheStats {
+    U64 hits;
+    U64 misses;
+    U64 evictions;
+    U64 skipped_inserts;
+    SZ used_slot_count;
+    SZ slot_count;
+    SZ budget_bytes;
+};
+
+// Blending works on many entities at once, every blending bone of a job range is queued here and blended with SIMD
+// when the batch fills up or gets flushed. Each bone writes its final skinning matrix straight to its destination.
+#define MATH_BONE_BLEND_BATCH_SIZE 256
+
+struct MathBoneBlendBatch {
+    // Structure of arrays so a lane is one bone, prev/next as T(xyz) R(xyzw) S(xyz)
+    F32 prev[10][MATH_BONE_BLEND_BATCH_SIZE];
+    F32 next[10][MATH_BONE_BLEND_BATCH_SIZE];
+    F32 t[MATH_BONE_BLEND_BATCH_SIZE];
+    Matrix *out[MATH_BONE_BLEND_BATCH_SIZE];
+    SZ count;
+};
+
 struct OrientedBoundingBox {
     Vector3 center;   // Center point of the box
     Vector3 extents;  // Half-lengths along local axes
@@ -55,9 +119,21 @@ BOOL math_ray_triangle_intersection(Vector3 ray_origin, Vector3 ray_direction, V
 BOOL math_aabb_sphere_intersection(Vector3 aabb_min, Vector3 aabb_max, Vector3 sphere_center, F32 sphere_radius);
 BoundingBox math_transform_aabb(BoundingBox bb, Vector3 position, Vector3 scale);
 void math_matrix_decompose(Matrix mat, Vector3 *translation, Quaternion *rotation, Vector3 *scale);
-void  math_compute_entity_bone_matrices(EID id);
-BOOL math_get_bone_world_position_by_name(EID id, C8 const *bone_name, Vector3 *out_position);
+void math_bone_trs_from_matrix(Matrix mat, MathBoneTRS *out);
+void math_bone_blend_batch_add(MathBoneBlendBatch *batch, MathBoneTRS const *prev, MathBoneTRS const *next, F32 t, Matrix *out);
+void math_bone_blend_batch_flush(MathBoneBlendBatch *batch);
+void math_compute_entity_bone_matrices(EID id, MathBoneBlendBatch *batch);  // Blending bones are queued, flush the batch after
+void math_bone_cache_init(MathBoneCache *cache, MemoryType type, SZ budget_bytes, S32 max_bones);
+BOOL math_bone_cache_get(MathBoneCache *cache, U64 key, Matrix *out_matrices, S32 bone_count);  // Copies out on a hit
+BOOL math_bone_cache_get_trs(MathBoneCache *cache, U64 key, MathBoneTRS *out_trs, S32 bone_count);
+void math_bone_cache_put(MathBoneCache *cache, U64 key, Matrix const *matrices, MathBoneTRS const *trs, S32 bone_count);
+MathBoneCacheStats math_bone_cache_get_stats(MathBoneCache const *cache);
+MathBoneCacheStats math_get_bone_cache_stats();  // The cache the animation jobs use
+BOOL math_get_bone_world_position_by_name(EID id, C8 const *bone_name, Vector3 *out_position);  // Slow, debug only
 BOOL math_get_bone_world_position_by_index(EID id, S32 bone_index, Vector3 *out_position);
+// Sockets get computed with the bone matrices, these only apply the current entity transform
+BOOL math_get_entity_socket_transform(EID id, AModelSocket socket, Matrix *out_transform);
+BOOL math_get_entity_socket_position(EID id, AModelSocket socket, Vector3 *out_position);
 
 // ===============================================================
 // =========================== INLINES ===========================
@@ -127,6 +203,10 @@ F32 inline math_ceil_f32(F32 value) {
     return glm::ceil(value);
 }
 
+F64 inline math_ceil_f64(F64 value) {
+    return glm::ceil(value);
+}
+
 F32 inline math_lerp_f32(F32 a, F32 b, F32 t) {
     return glm::mix(a, b, t);  // GLM's mix is equivalent to lerp
 }
@@ -139,6 +219,14 @@ F32 inline math_exp_f32(F32 value) {
     return glm::exp(value);
 }
 
+F32 inline math_exp2_f32(F32 value) {
+    return glm::exp2(value);
+}
+
+F32 inline math_log2_f32(F32 value) {
+    return glm::log2(value);
+}
+
 F32 inline math_pow_f32(F32 base, F32 exponent) {
     return glm::pow(base, exponent);
 }
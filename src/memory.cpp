@@ -6,7 +6,13 @@
 #include <stdlib.h>
 #include <glm/common.hpp>
 
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 Memory static i_memory = {};
+ArenaThreadChunk static thread_local i_thread_chunks[MEMORY_TYPE_COUNT] = {};
 
 C8 static const *i_type_to_cstr[MEMORY_TYPE_COUNT] = {
     "Permanent Arena",
@@ -27,7 +33,11 @@ void static i_free(void* ptr) {
 // ============================ ARENA ============================
 // ===============================================================
 
-Arena static *i_arena_create(SZ capacity) {
+SZ static i_round_up_to_page(SZ size) {
+    return (size + i_memory.page_size - 1) & ~(i_memory.page_size - 1);
+}
+
+Arena static *i_arena_create(SZ capacity, BOOL resident) {
     if (capacity < 1) {
         lle("Arena size must be at least 1");
         return nullptr;
@@ -40,9 +50,17 @@ Arena static *i_arena_create(SZ capacity) {
     }
 
 #ifdef _WIN32
-    arena->memory = _aligned_malloc(capacity, i_memory.memory_alignment);  // NOLINT
+    // NOTE: No madvise on Windows, resident arenas just never trim there.
+    arena->memory = _aligned_malloc(capacity, i_memory.setup.alignment);  // NOLINT
 #else
-    arena->memory = aligned_alloc(i_memory.setup.alignment, capacity);  // NOLINT
+    if (resident) {
+        // Resident arenas are mapped directly so that we can hand tail pages back with madvise.
+        // mmap memory is page aligned which also satisfies our allocation alignment.
+        arena->memory = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (arena->memory == MAP_FAILED) { arena->memory = nullptr; }
+    } else {
+        arena->memory = aligned_alloc(i_memory.setup.alignment, capacity);  // NOLINT
+    }
 #endif
     if (!arena->memory) {
         i_free(arena);  // NOLINT
@@ -51,15 +69,55 @@ Arena static *i_arena_create(SZ capacity) {
     }
 
     arena->capacity = capacity;
+    arena->resident = resident;
 
     return arena;
 }
 
 void static i_arena_destroy(Arena *arena) {
+#ifndef _WIN32
+    if (arena->resident) {
+        munmap(arena->memory, arena->capacity);
+        i_free(arena);  // NOLINT
+        return;
+    }
+#endif
     i_free(arena->memory);  // NOLINT
     i_free(arena);          // NOLINT
 }
 
+// Returns the bytes that were given back to the OS.
+SZ static i_arena_trim(Arena *arena) {
+    if (arena->used > arena->high_water_mark) { arena->high_water_mark = i_round_up_to_page(arena->used); }
+
+    arena->quiet_peak = glm::max(arena->quiet_peak, arena->used);
+
+    // As soon as a frame touches (almost) everything we keep mapped the streak is over.
+    if (i_round_up_to_page(arena->quiet_peak) >= arena->high_water_mark) {
+        arena->quiet_frames = 0;
+        arena->quiet_peak   = 0;
+        return 0;
+    }
+
+    if (++arena->quiet_frames < ARENA_TRIM_QUIET_FRAMES) { return 0; }
+
+    SZ const keep    = i_round_up_to_page(arena->quiet_peak);
+    SZ const trimmed = arena->high_water_mark - keep;
+
+#ifndef _WIN32
+    if (madvise((U8 *)arena->memory + keep, trimmed, MADV_DONTNEED) != 0) {
+        llw("Could not trim resident arena tail (%zu bytes)", trimmed);
+        return 0;
+    }
+#endif
+
+    arena->high_water_mark = keep;
+    arena->quiet_frames    = 0;
+    arena->quiet_peak      = 0;
+
+    return trimmed;
+}
+
 void static *i_arena_alloc(Arena *arena, SZ size) {
     if (arena->used + size > arena->capacity) {
         llt("Arena is full, %zu + %zu > %zu", arena->used, size, arena->capacity);
@@ -69,18 +127,21 @@ void static *i_arena_alloc(Arena *arena, SZ size) {
     void *ptr       = (U8 *)arena->memory + arena->used;
     arena->used    += size;
     arena->max_used = glm::max(arena->max_used, arena->used);
-    arena->allocation_count++;
 
     return ptr;
 }
 
+SZ static i_align_size(SZ size) {
+    return (size + i_memory.setup.alignment - 1) & ~(i_memory.setup.alignment - 1);
+}
+
 void static *i_arena_allocator_alloc(ArenaAllocator *allocator, SZ size) {
     if (size < 1) {
         lle("Allocation size must be at least 1");
         return nullptr;
     }
 
-    SZ const aligned_size = (size + i_memory.setup.alignment - 1) & ~(i_memory.setup.alignment - 1);
+    SZ const aligned_size = i_align_size(size);
 
     if (aligned_size > allocator->arena_capacity) {
         lle("Allocation size is too big %zu > %zu", size, allocator->arena_capacity);
@@ -97,7 +158,7 @@ void static *i_arena_allocator_alloc(ArenaAllocator *allocator, SZ size) {
         return nullptr;
     }
 
-    Arena *arena = i_arena_create(allocator->arena_capacity);
+    Arena *arena = i_arena_create(allocator->arena_capacity, allocator->resident);
     if (!arena) {
         lle("Could not allocate memory for arena");
         return nullptr;
@@ -108,6 +169,62 @@ void static *i_arena_allocator_alloc(ArenaAllocator *allocator, SZ size) {
     return i_arena_alloc(arena, aligned_size);
 }
 
+// ===============================================================
+// ======================== THREAD CHUNK =========================
+// ===============================================================
+
+// Invalidates every thread chunk of this allocator, has to be called whenever its arenas are rewound or freed.
+void static i_arena_allocator_bump_epoch(ArenaAllocator *allocator) {
+    allocator->epoch.fetch_add(1, std::memory_order_release);
+    allocator->allocation_count.store(0, std::memory_order_relaxed);
+}
+
+BOOL static i_thread_chunk_refill(ArenaAllocator *allocator, ArenaThreadChunk *chunk, U32 epoch) {
+    // Only reached when the chunk is used up or stale, this is the one place the thread path takes the lock.
+    mtx_lock(&allocator->mutex);
+    auto *base = (U8 *)i_arena_allocator_alloc(allocator, ARENA_THREAD_CHUNK_SIZE);
+    mtx_unlock(&allocator->mutex);
+
+    if (!base) { return false; }
+
+    chunk->cursor = base;
+    chunk->end    = base + ARENA_THREAD_CHUNK_SIZE;
+    chunk->last   = nullptr;
+    chunk->epoch  = epoch;
+
+    return true;
+}
+
+void static *i_thread_chunk_alloc(MemoryType type, SZ aligned_size) {
+    ArenaAllocator *allocator = &i_memory.arena_allocators[type];
+    ArenaThreadChunk *chunk   = &i_thread_chunks[type];
+    U32 const epoch           = allocator->epoch.load(std::memory_order_acquire);
+
+    if (chunk->epoch != epoch || !chunk->cursor || chunk->cursor + aligned_size > chunk->end) {
+        if (!i_thread_chunk_refill(allocator, chunk, epoch)) { return nullptr; }
+    }
+
+    void *ptr      = chunk->cursor;
+    chunk->cursor += aligned_size;
+    chunk->last    = ptr;
+    allocator->allocation_count.fetch_add(1, std::memory_order_relaxed);
+
+    return ptr;
+}
+
+BOOL static i_thread_chunk_resize_last(MemoryType type, void *ptr, SZ new_capacity) {
+    ArenaAllocator *allocator = &i_memory.arena_allocators[type];
+    ArenaThreadChunk *chunk   = &i_thread_chunks[type];
+
+    if (chunk->last != ptr || chunk->epoch != allocator->epoch.load(std::memory_order_acquire)) { return false; }
+
+    U8 *new_cursor = (U8 *)ptr + i_align_size(new_capacity);
+    if (new_cursor > chunk->end) { return false; }
+
+    chunk->cursor = new_cursor;
+    return true;
+}
+
 // ===============================================================
 // =========================== MEMORY ============================
 // ===============================================================
@@ -120,6 +237,12 @@ void memory_init(MemorySetup setup) {
         return;
     }
 
+#ifdef _WIN32
+    i_memory.page_size = 4096;
+#else
+    i_memory.page_size = (SZ)sysconf(_SC_PAGESIZE);
+#endif
+
     // Initialize mutex for each arena allocator
     for (SZ i = 0; i < MEMORY_TYPE_COUNT; ++i) {
         if (mtx_init(&i_memory.arena_allocators[i].mutex, mtx_plain) != thrd_success) {
@@ -136,13 +259,14 @@ void memory_init(MemorySetup setup) {
             return;
         }
 
-        i_memory.arena_allocators[i].arenas[0] = i_arena_create(s->capacity);
+        i_memory.arena_allocators[i].arenas[0] = i_arena_create(s->capacity, s->resident);
         if (!i_memory.arena_allocators[i].arenas[0]) {
             lle("Could not allocate memory for \"%s\" allocator", i_type_to_cstr[i]);
             return;
         }
         i_memory.arena_allocators[i].arena_count    = 1;
         i_memory.arena_allocators[i].arena_capacity = s->capacity;
+        i_memory.arena_allocators[i].resident       = s->resident;
     }
 }
 
@@ -160,11 +284,25 @@ void *memory_malloc_verbose(SZ size, MemoryType type, C8 const *file, S32 line)
     return memory_malloc(size, type);
 }
 void *memory_malloc(SZ size, MemoryType type) {
+    // Small allocations are bumped out of the calling thread's chunk without touching the shared lock.
+    if (size > 0) {
+        SZ const aligned_size = i_align_size(size);
+        if (aligned_size <= ARENA_THREAD_CHUNK_MAX_ALLOC) {
+            void *ptr = i_thread_chunk_alloc(type, aligned_size);
+            if (ptr) { return ptr; }
+        }
+    }
+
+    return memory_malloc_shared(size, type);
+}
+
+void *memory_malloc_shared(SZ size, MemoryType type) {
     // Lock allocator for thread safety
     ArenaAllocator *allocator = &i_memory.arena_allocators[type];
     mtx_lock(&allocator->mutex);
     void *ptr = i_arena_allocator_alloc(allocator, size);
     mtx_unlock(&allocator->mutex);
+    if (ptr) { allocator->allocation_count.fetch_add(1, std::memory_order_relaxed); }
     return ptr;
 }
 
@@ -182,6 +320,9 @@ void *memory_calloc(SZ count, SZ size, MemoryType type) {
 }
 
 void *memory_realloc(void *ptr, SZ old_capacity, SZ new_capacity, MemoryType type) {
+    // If this was the last thing this thread bumped out of its chunk we can just move the cursor.
+    if (ptr && i_thread_chunk_resize_last(type, ptr, new_capacity)) { return ptr; }
+
     void *new_ptr = memory_malloc(new_capacity, type);
     if (!new_ptr) { return nullptr; }
     ou_memmove(new_ptr, ptr, old_capacity);
@@ -198,29 +339,58 @@ void memory_post() {
     for (S32 i = 0; i < MEMORY_TYPE_COUNT; ++i) {
         ArenaAllocator *a = &i_memory.arena_allocators[i];
         a->previous_stats = memory_get_current_arena_stats((MemoryType)i);
+    }
 
-        for (SZ j = 0; j < ARENA_TIMELINE_MAX_COUNT - 1; ++j) { a->timeline.total_allocations_count[j] = a->timeline.total_allocations_count[j + 1]; }
+    ArenaAllocator *transient = &i_memory.arena_allocators[MEMORY_TYPE_ARENA_TRANSIENT];
+    ArenaStats *transient_stats = &transient->previous_stats;
 
-        a->timeline.total_allocations_count[ARENA_TIMELINE_MAX_COUNT - 1] = (F32)a->previous_stats.total_allocation_count;
+    i_arena_allocator_bump_epoch(transient);
+
+    if (transient->resident) {
+        // Keep the arenas mapped and only rewind them, the next frame then allocates into already faulted-in pages.
+        for (SZ i = 0; i < transient->arena_count; ++i) {
+            Arena *arena = transient->arenas[i];
+
+            transient_stats->reset_count++;
+            transient_stats->reset_bytes   += arena->used;
+            transient_stats->trimmed_bytes += i_arena_trim(arena);
+
+            arena->used = 0;
+        }
+    } else {
+        for (SZ i = 0; i < transient->arena_count; ++i) {
+            Arena *arena = transient->arenas[i];
+            if (arena) {
+                transient_stats->reset_count++;
+                transient_stats->reset_bytes += arena->used;
+                i_arena_destroy(arena);
+            }
+            transient->arenas[i] = nullptr;
+        }
+        transient->arena_count = 0;
     }
 
-    for (SZ i = 0; i < i_memory.arena_allocators[MEMORY_TYPE_ARENA_TRANSIENT].arena_count; ++i) {
-        Arena *arena = i_memory.arena_allocators[MEMORY_TYPE_ARENA_TRANSIENT].arenas[i];
-        if (arena) {
-            i_free(arena->memory);  // NOLINT
-            i_free(arena);          // NOLINT
+    // Re-read the resident size since trimming might have changed it.
+    transient_stats->resident_bytes = memory_get_current_arena_stats(MEMORY_TYPE_ARENA_TRANSIENT).resident_bytes;
+
+    for (auto &a : i_memory.arena_allocators) {
+        for (SZ j = 0; j < ARENA_TIMELINE_MAX_COUNT - 1; ++j) {
+            a.timeline.total_allocations_count[j] = a.timeline.total_allocations_count[j + 1];
+            a.timeline.reset_bytes[j]             = a.timeline.reset_bytes[j + 1];
+            a.timeline.resident_bytes[j]          = a.timeline.resident_bytes[j + 1];
         }
-        i_memory.arena_allocators[MEMORY_TYPE_ARENA_TRANSIENT].arenas[i] = nullptr;
+
+        a.timeline.total_allocations_count[ARENA_TIMELINE_MAX_COUNT - 1] = (F32)a.previous_stats.total_allocation_count;
+        a.timeline.reset_bytes[ARENA_TIMELINE_MAX_COUNT - 1]             = (F32)a.previous_stats.reset_bytes;
+        a.timeline.resident_bytes[ARENA_TIMELINE_MAX_COUNT - 1]          = (F32)a.previous_stats.resident_bytes;
     }
-    i_memory.arena_allocators[MEMORY_TYPE_ARENA_TRANSIENT].arena_count = 0;
 }
 
 void memory_reset_type(MemoryType type) {
     ArenaAllocator *allocator = &i_memory.arena_allocators[type];
+    i_arena_allocator_bump_epoch(allocator);
     for (SZ i = 0; i < allocator->arena_count; ++i) {
-        Arena *arena            = allocator->arenas[i];
-        arena->used             = 0;
-        arena->allocation_count = 0;
+        allocator->arenas[i]->used = 0;
     }
 }
 
@@ -228,13 +398,15 @@ ArenaStats memory_get_current_arena_stats(MemoryType type) {
     ArenaStats stats = {};
     ArenaAllocator *arena_allocator = &i_memory.arena_allocators[type];
 
+    stats.total_allocation_count = arena_allocator->allocation_count.load(std::memory_order_relaxed);
+
     for (SZ i = 0; i < arena_allocator->arena_count; ++i) {
         Arena const *arena = arena_allocator->arenas[i];
         stats.arena_count++;
-        stats.total_allocation_count += arena->allocation_count;
         stats.total_capacity         += arena->capacity;
         stats.total_used             += arena->used;
         stats.max_used                = glm::max(stats.max_used, arena->max_used);
+        stats.resident_bytes         += arena->resident ? glm::max(arena->high_water_mark, arena->used) : 0;
     }
 
     return stats;
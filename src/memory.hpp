@@ -3,6 +3,7 @@
 #include "common.hpp"
 
 #include <tinycthread.h>
+#include <atomic>
 
 // Need for tinycthread on macOS
 #ifdef call_once
@@ -23,6 +24,9 @@ enum MemoryType : U8 {
 
 #define ARENA_MAX 128
 #define ARENA_TIMELINE_MAX_COUNT 180
+#define ARENA_TRIM_QUIET_FRAMES 120  // Resident arenas give back untouched tail pages after this many frames below their high-water mark
+#define ARENA_THREAD_CHUNK_SIZE ((SZ)256 * 1024)     // Size of the chunk every thread carves out of a shared allocator
+#define ARENA_THREAD_CHUNK_MAX_ALLOC ((SZ)16 * 1024)  // Bigger allocations skip the thread chunk and go straight to the shared arenas
 
 struct ArenaStats {
     SZ arena_count;
@@ -30,29 +34,54 @@ struct ArenaStats {
     SZ total_capacity;
     SZ total_used;
     SZ max_used;
+    SZ resident_bytes;  // Pages kept mapped by resident arenas (sum of high-water marks)
+    SZ reset_count;     // Arenas whose offsets were reset in the last memory_post()
+    SZ reset_bytes;     // Bytes handed back by those resets
+    SZ trimmed_bytes;   // Bytes returned to the OS via madvise in the last memory_post()
 };
 
 // INFO: We store these as F32 so that our debug timeline impl is easier. We would rather have a better type.
 struct ArenaTimeline {
     F32 total_allocations_count[ARENA_TIMELINE_MAX_COUNT];
+    F32 reset_bytes[ARENA_TIMELINE_MAX_COUNT];
+    F32 resident_bytes[ARENA_TIMELINE_MAX_COUNT];
 };
 
 struct Arena {
     C8 const *name;
-    SZ allocation_count;
     SZ capacity;
     SZ used;
     SZ max_used;
     void *memory;
+
+    // Resident mode: the arena stays mapped across frames and only its offset is reset.
+    BOOL resident;
+    SZ high_water_mark;  // Page-rounded amount of memory that has been touched and not trimmed yet
+    SZ quiet_peak;       // Highest usage seen during the current quiet streak
+    U32 quiet_frames;    // Consecutive frames whose usage stayed below the high-water mark
 };
 
 struct ArenaAllocator {
     Arena *arenas[ARENA_MAX];
     SZ arena_count;
     SZ arena_capacity;
+    BOOL resident;
     ArenaStats previous_stats;
     ArenaTimeline timeline;
     mtx_t mutex;  // Thread-safe allocations for this allocator
+
+    // Thread chunks are only valid for the epoch they were carved in, every reset bumps it.
+    std::atomic<U32> epoch;
+    // Every allocation since the last reset, thread chunk or shared. Chunk refills are not counted, only what they serve.
+    std::atomic<SZ> allocation_count;
+};
+
+// Per-thread bump region carved out of an ArenaAllocator. Only ever touched by the owning thread.
+struct ArenaThreadChunk {
+    U8 *cursor;
+    U8 *end;
+    void *last;  // Most recent allocation, can be grown in place by memory_realloc
+    U32 epoch;
 };
 
 // ===============================================================
@@ -62,6 +91,7 @@ struct ArenaAllocator {
 struct MemoryTypeSetup {
     BOOL verbose;
     SZ capacity;
+    BOOL resident;  // Keep arenas mapped across memory_post() and reset offsets instead of freeing them
 };
 
 struct MemorySetup {
@@ -71,6 +101,7 @@ struct MemorySetup {
 
 struct Memory {
     MemorySetup setup;
+    SZ page_size;
     ArenaAllocator arena_allocators[MEMORY_TYPE_COUNT];
 };
 
@@ -84,6 +115,7 @@ ArenaTimeline *memory_get_arena_timeline(MemoryType type);
 C8 const *memory_type_to_cstr(MemoryType type);
 
 void *memory_malloc(SZ size, MemoryType type);
+void *memory_malloc_shared(SZ size, MemoryType type);
 void *memory_calloc(SZ count, SZ size, MemoryType type);
 void *memory_realloc(void *ptr, SZ old_capacity, SZ new_capacity, MemoryType type);
 
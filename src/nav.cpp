@@ -0,0 +1,710 @@
+#include "nav.hpp"
+#include "asset.hpp"
+#include "assert.hpp"
+#include "job.hpp"
+#include "math.hpp"
+#include "profiler.hpp"
+#include "std.hpp"
+#include "time.hpp"
+
+#include <raymath.h>
+
+#define NAV_STEP_STRAIGHT 10
+#define NAV_STEP_DIAGONAL 14
+#define NAV_BATCH_MAX (JOB_SYSTEM_MAX_THREADS * NAV_BATCH_PER_THREAD)
+#define NAV_BATCH_FIELD_BIT 0x80000000U  // Batch item is a flow field index, a request index otherwise
+#define NAV_HEAP_CLOSED U32_MAX          // heap_index of a cell that got expanded
+
+C8 static const *i_state_to_cstr[NAV_STATE_COUNT] = {"Free", "Queued", "Ready", "Failed", "Cancelled"};
+
+// Straight neighbors first, then the diagonals
+S32 static const i_dir_x[8]      = {1, -1, 0, 0, 1, 1, -1, -1};
+S32 static const i_dir_z[8]      = {0, 0, 1, -1, 1, -1, 1, -1};
+U8 static const i_dir_opposite[8] = {1, 0, 3, 2, 7, 6, 5, 4};
+
+struct NavBatch {
+    Nav *nav;
+    U32 items[NAV_BATCH_MAX];
+    U32 expanded[NAV_BATCH_MAX];
+    U32 count;
+};
+
+U32 static i_request_index(NavHandle handle) {
+    return handle & (NAV_REQUEST_MAX - 1);
+}
+
+U32 static i_field_index(NavHandle handle) {
+    return handle & (NAV_FLOW_FIELD_MAX - 1);
+}
+
+NavRequest static *i_get_request(Nav *nav, NavHandle handle) {
+    if (handle == NAV_INVALID_HANDLE) { return nullptr; }
+
+    NavRequest *request = &nav->requests[i_request_index(handle)];
+    return request->handle == handle ? request : nullptr;
+}
+
+NavFlowField static *i_get_field(Nav *nav, NavHandle handle) {
+    if (handle == NAV_INVALID_HANDLE) { return nullptr; }
+
+    NavFlowField *field = &nav->fields[i_field_index(handle)];
+    return field->handle == handle ? field : nullptr;
+}
+
+NavRequest static const *i_get_request(Nav const *nav, NavHandle handle) {
+    return i_get_request((Nav *)nav, handle);
+}
+
+NavFlowField static const *i_get_field(Nav const *nav, NavHandle handle) {
+    return i_get_field((Nav *)nav, handle);
+}
+
+// Blocked cells only ever show up in a path as its start or goal, they are walked like flat ones there
+U8 static i_path_cost(NavGraph const *graph, U32 cell) {
+    U8 const cost = graph->cost[cell];
+    return cost == NAV_COST_BLOCKED ? (U8)NAV_COST_FLAT : cost;
+}
+
+BOOL static i_is_walkable(NavGraph const *graph, S32 x, S32 z, U8 max_cost) {
+    U8 const cost = graph->cost[(z * graph->width) + x];
+    return cost != NAV_COST_BLOCKED && cost <= max_cost;
+}
+
+// Diagonal steps need both cells next to the corner, nobody squeezes between two blocked ones
+BOOL static i_can_step(NavGraph const *graph, S32 x, S32 z, S32 dir) {
+    if (dir < 4) { return true; }
+    return i_is_walkable(graph, x + i_dir_x[dir], z, U8_MAX) && i_is_walkable(graph, x, z + i_dir_z[dir], U8_MAX);
+}
+
+// Octile distance with every cell flat, never more than the real cost
+U32 static i_heuristic(NavGraph const *graph, U32 cell, U32 goal) {
+    S32 const dx    = math_abs_s32(((S32)cell % graph->width) - ((S32)goal % graph->width));
+    S32 const dz    = math_abs_s32(((S32)cell / graph->width) - ((S32)goal / graph->width));
+    S32 const lo    = glm::min(dx, dz);
+    S32 const hi    = glm::max(dx, dz);
+    return (U32)((NAV_STEP_STRAIGHT * (hi - lo)) + (NAV_STEP_DIAGONAL * lo)) * NAV_COST_FLAT;
+}
+
+// Every cell the straight line between two cell centers touches, both sides where it passes exactly through a corner.
+// None of them may be blocked or costlier than max_cost, the end cell is let through blocked if allowed.
+BOOL static i_is_line_walkable(NavGraph const *graph, U32 from, U32 to, U8 max_cost, BOOL allow_blocked_end) {
+    S32 x        = (S32)from % graph->width;
+    S32 z        = (S32)from / graph->width;
+    S32 const dx = ((S32)to % graph->width) - x;
+    S32 const dz = ((S32)to / graph->width) - z;
+    S32 const nx = math_abs_s32(dx);
+    S32 const nz = math_abs_s32(dz);
+    S32 const sx = dx > 0 ? 1 : -1;
+    S32 const sz = dz > 0 ? 1 : -1;
+
+    for (S32 ix = 0, iz = 0; ix < nx || iz < nz;) {
+        S64 const decision = ((S64)(1 + (2 * ix)) * nz) - ((S64)(1 + (2 * iz)) * nx);
+        if (decision == 0) {
+            if (!i_is_walkable(graph, x + sx, z, max_cost) || !i_is_walkable(graph, x, z + sz, max_cost)) { return false; }
+            x += sx;
+            z += sz;
+            ix++;
+            iz++;
+        } else if (decision < 0) {
+            x += sx;
+            ix++;
+        } else {
+            z += sz;
+            iz++;
+        }
+
+        U32 const cell = (U32)((z * graph->width) + x);
+        if (cell == to && allow_blocked_end && graph->cost[cell] == NAV_COST_BLOCKED) { continue; }
+        if (!i_is_walkable(graph, x, z, max_cost)) { return false; }
+    }
+    return true;
+}
+
+// ====== SEARCH ======
+
+NavSearch static *i_thread_search(Nav *nav) {
+    U32 const index = job_system_get_thread_index();
+    if (index == JOB_THREAD_INDEX_NONE) { return &nav->searches[0]; }
+
+    _assert_(index < nav->search_count, "Nav search missing for this thread");
+    return &nav->searches[index];
+}
+
+void static i_search_begin(NavSearch *search, S32 capacity) {
+    search->heap_count = 0;
+    if (++search->generation == 0) {
+        ou_memset(search->stamp, 0, (SZ)capacity * sizeof(U32));
+        search->generation = 1;
+    }
+}
+
+// First time this search sees the cell, the leftovers of older searches do not count
+void static i_search_touch(NavSearch *search, U32 cell) {
+    if (search->stamp[cell] == search->generation) { return; }
+
+    search->stamp[cell]      = search->generation;
+    search->g[cell]          = U32_MAX;
+    search->heap_index[cell] = 0;
+}
+
+// Lower f first, the deeper cell on a tie so straight runs finish before their siblings get looked at
+BOOL static i_heap_less(NavSearch const *search, U32 a, U32 b) {
+    if (search->f[a] != search->f[b]) { return search->f[a] < search->f[b]; }
+    return search->g[a] > search->g[b];
+}
+
+void static i_heap_set(NavSearch *search, U32 pos, U32 cell) {
+    search->heap[pos]        = cell;
+    search->heap_index[cell] = pos + 1;
+}
+
+void static i_heap_up(NavSearch *search, U32 pos) {
+    U32 const cell = search->heap[pos];
+    while (pos > 0) {
+        U32 const parent = (pos - 1) / 2;
+        if (!i_heap_less(search, cell, search->heap[parent])) { break; }
+        i_heap_set(search, pos, search->heap[parent]);
+        pos = parent;
+    }
+    i_heap_set(search, pos, cell);
+}
+
+void static i_heap_down(NavSearch *search, U32 pos) {
+    U32 const cell = search->heap[pos];
+    for (;;) {
+        U32 child = (2 * pos) + 1;
+        if (child >= search->heap_count) { break; }
+        if (child + 1 < search->heap_count && i_heap_less(search, search->heap[child + 1], search->heap[child])) { child++; }
+        if (!i_heap_less(search, search->heap[child], cell)) { break; }
+        i_heap_set(search, pos, search->heap[child]);
+        pos = child;
+    }
+    i_heap_set(search, pos, cell);
+}
+
+// Opens the cell or moves it up after its f got lower
+void static i_heap_push(NavSearch *search, U32 cell) {
+    if (search->heap_index[cell] == 0) {
+        search->heap[search->heap_count] = cell;
+        search->heap_index[cell]         = ++search->heap_count;
+    }
+    i_heap_up(search, search->heap_index[cell] - 1);
+}
+
+U32 static i_heap_pop(NavSearch *search) {
+    U32 const cell = search->heap[0];
+    search->heap_index[cell] = NAV_HEAP_CLOSED;
+
+    if (--search->heap_count > 0) {
+        search->heap[0] = search->heap[search->heap_count];
+        i_heap_down(search, 0);
+    }
+    return cell;
+}
+
+// A* between two cells, the cells of the path end up in search->heap goal first. Returns their count, 0 if unreachable.
+U32 static i_search_path(NavGraph const *graph, NavSearch *search, U32 start, U32 goal, U32 *expanded) {
+    i_search_begin(search, graph->capacity);
+    i_search_touch(search, start);
+    search->g[start]      = 0;
+    search->f[start]      = i_heuristic(graph, start, goal);
+    search->parent[start] = start;
+    i_heap_push(search, start);
+
+    while (search->heap_count > 0) {
+        U32 const cell = i_heap_pop(search);
+        (*expanded)++;
+
+        if (cell == goal) {
+            U32 count = 0;
+            for (U32 at = goal; at != start; at = search->parent[at]) { search->heap[count++] = at; }
+            search->heap[count++] = start;
+            return count;
+        }
+
+        S32 const x = (S32)cell % graph->width;
+        S32 const z = (S32)cell / graph->width;
+        for (S32 dir = 0; dir < 8; ++dir) {
+            S32 const nx = x + i_dir_x[dir];
+            S32 const nz = z + i_dir_z[dir];
+            if (nx < 0 || nz < 0 || nx >= graph->width || nz >= graph->height) { continue; }
+
+            U32 const next = (U32)((nz * graph->width) + nx);
+            if (graph->cost[next] == NAV_COST_BLOCKED && next != goal) { continue; }
+            if (!i_can_step(graph, x, z, dir))                         { continue; }
+
+            i_search_touch(search, next);
+            if (search->heap_index[next] == NAV_HEAP_CLOSED) { continue; }
+
+            U32 const step = dir < 4 ? NAV_STEP_STRAIGHT : NAV_STEP_DIAGONAL;
+            U32 const g    = search->g[cell] + (step * i_path_cost(graph, next));
+            if (g >= search->g[next]) { continue; }
+
+            search->g[next]      = g;
+            search->f[next]      = g + i_heuristic(graph, next, goal);
+            search->parent[next] = cell;
+            i_heap_push(search, next);
+        }
+    }
+
+    return 0;
+}
+
+// String pulling over the cells of a search, goal first. The line to a later cell may only replace the cells in between
+// if it is walkable and no costlier than the costliest of them, so a path around a hill does not get smoothed across it.
+void static i_smooth_path(Nav const *nav, U32 const *cells, U32 count, Vector3 to, NavPath *path) {
+    NavGraph const *graph = &nav->graph;
+    path->count           = 0;
+    path->partial         = false;
+
+    U32 anchor = count - 1;
+    while (anchor > 0) {
+        if (path->count == NAV_PATH_MAX_POINTS) {
+            path->partial = true;
+            return;
+        }
+
+        U32 next     = anchor - 1;
+        U8 max_cost  = glm::max(i_path_cost(graph, cells[anchor]), i_path_cost(graph, cells[next]));
+        for (U32 candidate = next; candidate > 0; --candidate) {
+            U8 const cost = glm::max(max_cost, i_path_cost(graph, cells[candidate - 1]));
+            if (!i_is_line_walkable(graph, cells[anchor], cells[candidate - 1], cost, candidate - 1 == 0)) { break; }
+            next     = candidate - 1;
+            max_cost = cost;
+        }
+
+        path->points[path->count++] = next == 0 ? to : nav_get_cell_center(nav, (S32)cells[next]);
+        anchor                      = next;
+    }
+
+    // Start and goal share a cell
+    if (path->count == 0) { path->points[path->count++] = to; }
+}
+
+BOOL static i_solve_path(Nav *nav, NavSearch *search, Vector3 from, Vector3 to, NavPath *path, U32 *expanded) {
+    U32 const start = (U32)nav_get_cell(nav, from);
+    U32 const goal  = (U32)nav_get_cell(nav, to);
+    U32 const count = i_search_path(&nav->graph, search, start, goal, expanded);
+    if (count == 0) {
+        path->count   = 0;
+        path->partial = false;
+        return false;
+    }
+
+    i_smooth_path(nav, search->heap, count, to, path);
+    return true;
+}
+
+// Dijkstra backwards from the goal, every cell remembers the neighbor that is one step closer. Blocked cells get a
+// direction so actors that ended up on one can leave it, but nothing is routed through them.
+void static i_solve_flow_field(NavGraph const *graph, NavSearch *search, NavFlowField *field, U32 *expanded) {
+    ou_memset(field->next, NAV_DIRECTION_NONE, (SZ)graph->width * (SZ)graph->height);
+
+    U32 const goal = (U32)field->goal_cell;
+    i_search_begin(search, graph->capacity);
+    i_search_touch(search, goal);
+    search->g[goal]   = 0;
+    search->f[goal]   = 0;
+    field->next[goal] = NAV_DIRECTION_GOAL;
+    i_heap_push(search, goal);
+
+    while (search->heap_count > 0) {
+        U32 const cell = i_heap_pop(search);
+        (*expanded)++;
+        if (cell != goal && graph->cost[cell] == NAV_COST_BLOCKED) { continue; }
+
+        S32 const x    = (S32)cell % graph->width;
+        S32 const z    = (S32)cell / graph->width;
+        U32 const cost = i_path_cost(graph, cell);
+        for (S32 dir = 0; dir < 8; ++dir) {
+            S32 const nx = x + i_dir_x[dir];
+            S32 const nz = z + i_dir_z[dir];
+            if (nx < 0 || nz < 0 || nx >= graph->width || nz >= graph->height) { continue; }
+            if (!i_can_step(graph, x, z, dir))                                 { continue; }
+
+            U32 const prev = (U32)((nz * graph->width) + nx);
+            i_search_touch(search, prev);
+            if (search->heap_index[prev] == NAV_HEAP_CLOSED) { continue; }
+
+            // Stepping from prev onto cell costs what cell costs
+            U32 const step = dir < 4 ? NAV_STEP_STRAIGHT : NAV_STEP_DIAGONAL;
+            U32 const g    = search->g[cell] + (step * cost);
+            if (g >= search->g[prev]) { continue; }
+
+            search->g[prev]   = g;
+            search->f[prev]   = g;
+            field->next[prev] = i_dir_opposite[dir];
+            i_heap_push(search, prev);
+        }
+    }
+}
+
+S32 static i_solve_range(U32 begin, U32 end, void *ctx) {
+    auto *batch       = (NavBatch *)ctx;
+    Nav *nav          = batch->nav;
+    NavSearch *search = i_thread_search(nav);
+
+    for (U32 i = begin; i < end; ++i) {
+        U32 const item = batch->items[i];
+        U32 expanded   = 0;
+        if ((item & NAV_BATCH_FIELD_BIT) != 0) {
+            NavFlowField *field = &nav->fields[item & ~NAV_BATCH_FIELD_BIT];
+            i_solve_flow_field(&nav->graph, search, field, &expanded);
+            field->state = NAV_STATE_READY;
+        } else {
+            NavRequest *request = &nav->requests[item];
+            BOOL const found    = i_solve_path(nav, search, request->from, request->to, &request->path, &expanded);
+            request->state      = found ? NAV_STATE_READY : NAV_STATE_FAILED;
+        }
+        batch->expanded[i] = expanded;
+    }
+
+    return 0;
+}
+
+// ====== ALLOCATION ======
+
+void static i_alloc_search(NavSearch *search, S32 capacity, MemoryType memory_type) {
+    SZ const size      = (SZ)capacity * sizeof(U32);
+    search->g          = (U32 *)memory_malloc(size, memory_type);
+    search->f          = (U32 *)memory_malloc(size, memory_type);
+    search->parent     = (U32 *)memory_malloc(size, memory_type);
+    search->stamp      = (U32 *)memory_calloc((SZ)capacity, sizeof(U32), memory_type);
+    search->heap_index = (U32 *)memory_malloc(size, memory_type);
+    search->heap       = (U32 *)memory_malloc(size, memory_type);
+    search->heap_count = 0;
+    search->generation = 0;
+}
+
+// The job system might not be up yet when the first graph gets built, threads that are missing a search get one here
+void static i_ensure_searches(Nav *nav) {
+    U32 const thread_count = glm::min(glm::max(job_system_get_thread_count(), 1U), (U32)JOB_SYSTEM_MAX_THREADS);
+    for (; nav->search_count < thread_count; ++nav->search_count) {
+        i_alloc_search(&nav->searches[nav->search_count], nav->graph.capacity, nav->memory_type);
+    }
+}
+
+void static i_grow(Nav *nav, S32 cell_count, MemoryType memory_type) {
+    if (cell_count <= nav->graph.capacity) { return; }
+
+    nav->graph.cost     = (U8 *)memory_malloc((SZ)cell_count, memory_type);
+    nav->graph.capacity = cell_count;
+    nav->memory_type    = memory_type;
+    for (NavFlowField &field : nav->fields) { field.next = (U8 *)memory_malloc((SZ)cell_count, memory_type); }
+
+    U32 const search_count = nav->search_count;
+    nav->search_count      = 0;
+    for (U32 i = 0; i < search_count; ++i) { i_alloc_search(&nav->searches[i], cell_count, memory_type); }
+    nav->search_count = search_count;
+    i_ensure_searches(nav);
+}
+
+// ====== PUBLIC ======
+
+void nav_reset(Nav *nav) {
+    for (NavRequest &request : nav->requests) {
+        request.handle = NAV_INVALID_HANDLE;
+        request.state  = NAV_STATE_FREE;
+    }
+
+    // Hand out low indices first, they are popped from the back
+    for (U32 i = 0; i < NAV_REQUEST_MAX; ++i) { nav->free_indices[i] = (U16)(NAV_REQUEST_MAX - 1 - i); }
+    nav->free_count  = NAV_REQUEST_MAX;
+    nav->queue_head  = 0;
+    nav->queue_count = 0;
+    nav->next_serial = 1;  // Handle 0 is NAV_INVALID_HANDLE
+
+    for (NavFlowField &field : nav->fields) {
+        field.handle    = NAV_INVALID_HANDLE;
+        field.state     = NAV_STATE_FREE;
+        field.ref_count = 0;
+    }
+    nav->next_field_serial = 1;
+
+    nav->frame = 0;
+    nav->stats = {};
+}
+
+void nav_set_graph(Nav *nav, S32 width, S32 height, F32 cell_size, Vector2 origin, void const *source, MemoryType memory_type) {
+    S32 const cell_count = width * height;
+    i_grow(nav, cell_count, memory_type);
+    ou_memset(nav->graph.cost, NAV_COST_FLAT, (SZ)cell_count);
+
+    nav->graph.width     = width;
+    nav->graph.height    = height;
+    nav->graph.cell_size = cell_size;
+    nav->graph.origin    = origin;
+    nav->graph.source    = source;
+    nav->graph.version++;
+
+    // Held fields get solved again on the new graph, the others are of no use anymore
+    for (NavFlowField &field : nav->fields) {
+        if (field.handle == NAV_INVALID_HANDLE) { continue; }
+
+        if (field.ref_count > 0) {
+            field.state         = NAV_STATE_QUEUED;
+            field.goal_cell     = nav_get_cell(nav, field.goal);
+            field.graph_version = nav->graph.version;
+        } else {
+            field.handle = NAV_INVALID_HANDLE;
+            field.state  = NAV_STATE_FREE;
+        }
+    }
+}
+
+void nav_set_cell_cost(Nav *nav, S32 x, S32 z, U8 cost) {
+    if (x < 0 || z < 0 || x >= nav->graph.width || z >= nav->graph.height) { return; }
+    nav->graph.cost[(z * nav->graph.width) + x] = cost;
+}
+
+void nav_build_from_terrain(Nav *nav, ATerrain const *terrain, S32 cells_per_row, MemoryType memory_type) {
+    if (nav->graph.source == terrain) { return; }
+
+    F32 const cell_size = terrain->dimensions.x / (F32)cells_per_row;
+    F32 const half      = cell_size * 0.5F;
+    F32 const quarter   = cell_size * 0.25F;
+    nav_set_graph(nav, cells_per_row, cells_per_row, cell_size, {half, half}, terrain, memory_type);
+
+    // The center and the middle of every quarter, a single sample misses ridges that run through a cell
+    Vector2 const samples[] = {{0.0F, 0.0F}, {-quarter, -quarter}, {quarter, -quarter}, {-quarter, quarter}, {quarter, quarter}};
+
+    for (S32 z = 0; z < cells_per_row; ++z) {
+        for (S32 x = 0; x < cells_per_row; ++x) {
+            Vector3 const center = nav_get_cell_center(nav, (z * cells_per_row) + x);
+
+            F32 normal_y = 1.0F;
+            for (Vector2 const sample : samples) {
+                normal_y = glm::min(normal_y, math_get_terrain_normal(terrain, center.x + sample.x, center.z + sample.y).y);
+            }
+
+            U8 cost = NAV_COST_BLOCKED;
+            if (normal_y >= NAV_SLOPE_MAX_NORMAL_Y) {
+                F32 const steepness = (1.0F - normal_y) / (1.0F - NAV_SLOPE_MAX_NORMAL_Y);
+                cost                = (U8)(NAV_COST_FLAT + (S32)((F32)(NAV_COST_SLOPE_MAX - NAV_COST_FLAT) * steepness));
+            }
+            nav_set_cell_cost(nav, x, z, cost);
+        }
+    }
+}
+
+BOOL nav_has_graph(Nav const *nav) {
+    return nav->graph.cost != nullptr && nav->graph.width > 0 && nav->graph.height > 0;
+}
+
+S32 nav_get_cell(Nav const *nav, Vector3 position) {
+    NavGraph const *graph = &nav->graph;
+    F32 const inv_size    = 1.0F / graph->cell_size;
+    S32 const x           = (S32)math_floor_f32(((position.x - graph->origin.x) * inv_size) + 0.5F);
+    S32 const z           = (S32)math_floor_f32(((position.z - graph->origin.y) * inv_size) + 0.5F);
+    return (glm::clamp(z, 0, graph->height - 1) * graph->width) + glm::clamp(x, 0, graph->width - 1);
+}
+
+Vector3 nav_get_cell_center(Nav const *nav, S32 cell) {
+    NavGraph const *graph = &nav->graph;
+    return {graph->origin.x + ((F32)(cell % graph->width) * graph->cell_size), 0.0F, graph->origin.y + ((F32)(cell / graph->width) * graph->cell_size)};
+}
+
+NavHandle nav_request_path(Nav *nav, Vector3 from, Vector3 to) {
+    if (!nav_has_graph(nav) || nav->free_count == 0) { return NAV_INVALID_HANDLE; }
+
+    U32 const index = nav->free_indices[--nav->free_count];
+    if ((nav->next_serial << NAV_REQUEST_INDEX_BITS) == 0) { nav->next_serial = 1; }  // Wrapped, keep 0 for invalid
+
+    NavRequest *request   = &nav->requests[index];
+    request->handle       = (nav->next_serial++ << NAV_REQUEST_INDEX_BITS) | index;
+    request->state        = NAV_STATE_QUEUED;
+    request->from         = from;
+    request->to           = to;
+    request->queued_frame = nav->frame;
+    request->path.count   = 0;
+
+    // Cancelled requests keep their slot until the queue got to them, so the ring never holds more than NAV_REQUEST_MAX
+    nav->queue[(nav->queue_head + nav->queue_count) & (NAV_REQUEST_MAX - 1)] = (U16)index;
+    nav->queue_count++;
+
+    return request->handle;
+}
+
+NavState nav_get_state(Nav const *nav, NavHandle handle) {
+    NavRequest const *request = i_get_request(nav, handle);
+    return request ? request->state : NAV_STATE_FREE;
+}
+
+NavPath const *nav_get_path(Nav const *nav, NavHandle handle) {
+    NavRequest const *request = i_get_request(nav, handle);
+    return request && request->state == NAV_STATE_READY ? &request->path : nullptr;
+}
+
+void nav_release(Nav *nav, NavHandle handle) {
+    NavRequest *request = i_get_request(nav, handle);
+    if (!request) { return; }
+
+    request->handle = NAV_INVALID_HANDLE;
+    if (request->state == NAV_STATE_QUEUED) {
+        request->state = NAV_STATE_CANCELLED;
+        return;
+    }
+
+    request->state                        = NAV_STATE_FREE;
+    nav->free_indices[nav->free_count++] = (U16)(request - nav->requests);
+}
+
+BOOL nav_find_path(Nav *nav, Vector3 from, Vector3 to, NavPath *path) {
+    if (!nav_has_graph(nav)) { return false; }
+
+    i_ensure_searches(nav);
+    U32 expanded     = 0;
+    BOOL const found = i_solve_path(nav, i_thread_search(nav), from, to, path, &expanded);
+    nav->stats.cells_expanded += expanded;
+    return found;
+}
+
+NavHandle nav_acquire_flow_field(Nav *nav, Vector3 goal) {
+    if (!nav_has_graph(nav)) { return NAV_INVALID_HANDLE; }
+
+    // Cached fields for the same cell are shared, nobody holding them does not matter
+    S32 const goal_cell = nav_get_cell(nav, goal);
+    NavFlowField *unused = nullptr;
+    NavFlowField *oldest = nullptr;
+    for (NavFlowField &field : nav->fields) {
+        if (field.handle == NAV_INVALID_HANDLE) {
+            if (!unused) { unused = &field; }
+            continue;
+        }
+        if (field.goal_cell == goal_cell) {
+            field.ref_count++;
+            field.last_used_frame = nav->frame;
+            return field.handle;
+        }
+        if (field.ref_count == 0 && (!oldest || field.last_used_frame < oldest->last_used_frame)) { oldest = &field; }
+    }
+
+    NavFlowField *field = unused ? unused : oldest;
+    if (!field) { return NAV_INVALID_HANDLE; }
+
+    if ((nav->next_field_serial << NAV_FLOW_FIELD_INDEX_BITS) == 0) { nav->next_field_serial = 1; }
+    field->handle          = (nav->next_field_serial++ << NAV_FLOW_FIELD_INDEX_BITS) | (U32)(field - nav->fields);
+    field->state           = NAV_STATE_QUEUED;
+    field->goal_cell       = goal_cell;
+    field->goal            = goal;
+    field->graph_version   = nav->graph.version;
+    field->ref_count       = 1;
+    field->last_used_frame = nav->frame;
+    return field->handle;
+}
+
+void nav_release_flow_field(Nav *nav, NavHandle handle) {
+    NavFlowField *field = i_get_field(nav, handle);
+    if (!field || field->ref_count == 0) { return; }
+
+    // Stays cached until the slot is needed for another goal
+    field->ref_count--;
+    field->last_used_frame = nav->frame;
+}
+
+NavState nav_get_flow_field_state(Nav const *nav, NavHandle handle) {
+    NavFlowField const *field = i_get_field(nav, handle);
+    return field ? field->state : NAV_STATE_FREE;
+}
+
+BOOL nav_flow_field_steer(Nav const *nav, NavHandle handle, Vector3 position, Vector3 *waypoint) {
+    NavFlowField const *field = i_get_field(nav, handle);
+    if (!field || field->state != NAV_STATE_READY) { return false; }
+
+    NavGraph const *graph = &nav->graph;
+    U32 const start       = (U32)nav_get_cell(nav, position);
+    if (field->next[start] == NAV_DIRECTION_NONE) { return false; }
+
+    // The first step is always fine, further ones only if the straight line there is no costlier than the steps
+    U32 best    = start;
+    U32 current = start;
+    U8 max_cost = i_path_cost(graph, start);
+    for (S32 i = 0; i < NAV_FLOW_LOOKAHEAD; ++i) {
+        U8 const dir = field->next[current];
+        if (dir == NAV_DIRECTION_GOAL) { break; }
+
+        current  = (U32)((S32)current + i_dir_x[dir] + (i_dir_z[dir] * graph->width));
+        max_cost = glm::max(max_cost, i_path_cost(graph, current));
+        if (i > 0 && !i_is_line_walkable(graph, start, current, max_cost, current == (U32)field->goal_cell)) { break; }
+        best = current;
+    }
+
+    if (best == (U32)field->goal_cell) {
+        *waypoint = field->goal;
+    } else {
+        *waypoint   = nav_get_cell_center(nav, (S32)best);
+        waypoint->y = position.y;
+    }
+    return true;
+}
+
+void nav_update(Nav *nav, F64 budget_seconds) {
+    nav->stats.max_wait_frames = 0;
+
+    if (nav_has_graph(nav)) {
+        PBEGIN("nav_update");
+        i_ensure_searches(nav);
+
+        F64 const start_time = time_get_glfw_f64();
+        U32 const batch_max  = glm::clamp(job_system_get_thread_count() * NAV_BATCH_PER_THREAD, (U32)NAV_BATCH_PER_THREAD, (U32)NAV_BATCH_MAX);
+        NavBatch batch       = {};
+        batch.nav            = nav;
+
+        for (;;) {
+            // Flow fields first, one of them answers a whole crowd
+            batch.count = 0;
+            for (U32 i = 0; i < NAV_FLOW_FIELD_MAX && batch.count < batch_max; ++i) {
+                if (nav->fields[i].state == NAV_STATE_QUEUED) { batch.items[batch.count++] = i | NAV_BATCH_FIELD_BIT; }
+            }
+
+            while (nav->queue_count > 0 && batch.count < batch_max) {
+                U16 const index  = nav->queue[nav->queue_head];
+                nav->queue_head  = (nav->queue_head + 1) & (NAV_REQUEST_MAX - 1);
+                nav->queue_count--;
+
+                NavRequest *request = &nav->requests[index];
+                if (request->state == NAV_STATE_CANCELLED) {
+                    request->state                        = NAV_STATE_FREE;
+                    nav->free_indices[nav->free_count++] = index;
+                    continue;
+                }
+
+                nav->stats.max_wait_frames = glm::max(nav->stats.max_wait_frames, (U32)(nav->frame - request->queued_frame));
+                batch.items[batch.count++] = index;
+            }
+
+            if (batch.count == 0) { break; }
+
+            job_wait(job_parallel_for(0, batch.count, 1, i_solve_range, &batch));
+
+            for (U32 i = 0; i < batch.count; ++i) {
+                U32 const item             = batch.items[i];
+                nav->stats.cells_expanded += batch.expanded[i];
+                if ((item & NAV_BATCH_FIELD_BIT) != 0) {
+                    nav->stats.fields_solved++;
+                } else if (nav->requests[item].state == NAV_STATE_READY) {
+                    nav->stats.paths_solved++;
+                } else {
+                    nav->stats.paths_failed++;
+                }
+            }
+            nav->stats.batches++;
+
+            if (time_get_glfw_f64() - start_time >= budget_seconds) { break; }
+        }
+
+        nav->stats.queued           = nav->queue_count;
+        nav->stats.last_update_time = time_get_glfw_f64() - start_time;
+        PEND("nav_update");
+    }
+
+    nav->frame++;
+}
+
+NavStats nav_get_stats(Nav const *nav) {
+    return nav->stats;
+}
+
+C8 const *nav_state_to_cstr(NavState state) {
+    return i_state_to_cstr[state];
+}
@@ -0,0 +1,158 @@
+#pragma once
+
+#include "common.hpp"
+#include "job.hpp"
+#include "memory.hpp"
+
+#include <raylib.h>
+
+// Pathfinding over a grid of cells with a traversal cost each, the overworld grid with slope costs out of the terrain
+// or the dungeon tiles. Paths are requested from the main thread, queued and solved in batches on the job system by
+// nav_update() until the frame budget is used up, results are read through the handle once they are ready.
+// Destinations a lot of actors walk to (lumberyards, build sites, gather points) get a flow field instead: one reverse
+// Dijkstra from the goal answers every start at once and stays cached for as long as someone holds it.
+// NOTE: Everything that changes the Nav is main thread only, the getters are safe from jobs while nav_update() is not running.
+
+fwd_decl(ATerrain);
+
+#define NAV_REQUEST_MAX 2048             // Must be a power of two
+#define NAV_REQUEST_INDEX_BITS 11        // log2(NAV_REQUEST_MAX), the rest of a handle is a serial number
+#define NAV_FLOW_FIELD_MAX 16            // Must be a power of two
+#define NAV_FLOW_FIELD_INDEX_BITS 4      // log2(NAV_FLOW_FIELD_MAX)
+#define NAV_PATH_MAX_POINTS 32           // After smoothing, longer paths stop early and are marked partial
+#define NAV_BATCH_PER_THREAD 4           // Requests per thread in one batch of nav_update()
+#define NAV_FLOW_LOOKAHEAD 4             // Cells a flow field steers ahead when the way there is clear
+#define NAV_INVALID_HANDLE 0
+
+#define NAV_COST_BLOCKED 0               // Can not be entered, only left
+#define NAV_COST_FLAT 10                 // Cheapest walkable cell, the A* heuristic relies on nothing being cheaper
+#define NAV_COST_SLOPE_MAX 100           // Steepest walkable slope
+#define NAV_SLOPE_MAX_NORMAL_Y 0.7F      // Anything steeper (about 45 degrees) is blocked
+
+#define NAV_DIRECTION_GOAL 8             // Flow field cell that is the goal itself
+#define NAV_DIRECTION_NONE 255           // Flow field cell the goal can not be reached from
+
+typedef U32 NavHandle;
+
+enum NavState : U8 {
+    NAV_STATE_FREE,
+    NAV_STATE_QUEUED,
+    NAV_STATE_READY,
+    NAV_STATE_FAILED,     // Goal can not be reached
+    NAV_STATE_CANCELLED,  // Released while still queued, the slot comes back once the queue gets to it
+    NAV_STATE_COUNT,
+};
+
+struct NavGraph {
+    U8 *cost;            // Per cell, row major
+    S32 width;
+    S32 height;
+    S32 capacity;        // Cells the graph, the searches and the flow fields are allocated for
+    F32 cell_size;
+    Vector2 origin;      // World x/z of the center of cell 0
+    void const *source;  // What the graph got built from, building from the same source again is a no-op
+    U32 version;         // Bumped by nav_set_graph(), flow fields are solved against one version
+};
+
+struct NavPath {
+    Vector3 points[NAV_PATH_MAX_POINTS];  // Waypoints after the start, the last one is the requested goal unless partial
+    U32 count;
+    BOOL partial;
+};
+
+struct NavRequest {
+    NavHandle handle;  // NAV_INVALID_HANDLE while free or cancelled
+    NavState state;
+    Vector3 from;
+    Vector3 to;
+    U64 queued_frame;
+    NavPath path;
+};
+
+struct NavFlowField {
+    NavHandle handle;  // NAV_INVALID_HANDLE while free
+    NavState state;
+    S32 goal_cell;
+    Vector3 goal;
+    U32 graph_version;
+    U32 ref_count;     // Only fields nobody holds get evicted
+    U64 last_used_frame;
+    U8 *next;          // Per cell the neighbor to step to, NAV_DIRECTION_GOAL or NAV_DIRECTION_NONE
+};
+
+// Scratch of one thread, sized to the graph capacity. Entries only count if their stamp matches the generation of
+// the current search, so nothing has to be cleared between searches.
+struct NavSearch {
+    U32 *g;           // Cost from the start
+    U32 *f;           // g + heuristic, the heap key
+    U32 *parent;      // Cell we got here from
+    U32 *stamp;
+    U32 *heap_index;  // Position in heap + 1, 0 while not open
+    U32 *heap;        // Open cells as a binary min-heap on f, also the path buffer once the search is done
+    U32 heap_count;
+    U32 generation;
+};
+
+struct NavStats {
+    U64 paths_solved;
+    U64 paths_failed;
+    U64 fields_solved;
+    U64 cells_expanded;
+    U64 batches;
+    U32 queued;           // Requests still waiting after the last nav_update()
+    U32 max_wait_frames;  // Longest a request solved during the last nav_update() was queued
+    F64 last_update_time;
+};
+
+struct Nav {
+    NavGraph graph;
+    NavSearch searches[JOB_SYSTEM_MAX_THREADS];
+    U32 search_count;
+    MemoryType memory_type;  // Of the graph allocations, searches for threads that show up later come out of it too
+
+    NavRequest requests[NAV_REQUEST_MAX];
+    U16 free_indices[NAV_REQUEST_MAX];
+    U32 free_count;
+    U16 queue[NAV_REQUEST_MAX];  // Ring of queued request indices, oldest first
+    U32 queue_head;
+    U32 queue_count;
+    U32 next_serial;
+
+    NavFlowField fields[NAV_FLOW_FIELD_MAX];
+    U32 next_field_serial;
+
+    U64 frame;
+    NavStats stats;
+};
+
+// Drops every request and flow field, the graph and the allocations stay
+void nav_reset(Nav *nav);
+// Every cell starts out flat, invalidates the flow fields. Grows the allocations if the graph is bigger than any before.
+void nav_set_graph(Nav *nav, S32 width, S32 height, F32 cell_size, Vector2 origin, void const *source, MemoryType memory_type);
+void nav_set_cell_cost(Nav *nav, S32 x, S32 z, U8 cost);  // While building the graph, before anything is solved on it
+// cells_per_row^2 cells over the terrain dimensions, cost out of the steepest normal of each cell
+void nav_build_from_terrain(Nav *nav, ATerrain const *terrain, S32 cells_per_row, MemoryType memory_type);
+BOOL nav_has_graph(Nav const *nav);
+S32 nav_get_cell(Nav const *nav, Vector3 position);  // Clamped to the graph
+Vector3 nav_get_cell_center(Nav const *nav, S32 cell);
+
+// Queues an A* search, NAV_INVALID_HANDLE if all requests are in use
+NavHandle nav_request_path(Nav *nav, Vector3 from, Vector3 to);
+NavState nav_get_state(Nav const *nav, NavHandle handle);  // NAV_STATE_FREE for released or stale handles
+NavPath const *nav_get_path(Nav const *nav, NavHandle handle);  // nullptr unless ready
+void nav_release(Nav *nav, NavHandle handle);
+// Solves right away on the calling thread, false if the goal can not be reached
+BOOL nav_find_path(Nav *nav, Vector3 from, Vector3 to, NavPath *path);
+
+// Shares the field of any holder with the same goal cell, NAV_INVALID_HANDLE if every field is held for another goal
+NavHandle nav_acquire_flow_field(Nav *nav, Vector3 goal);
+void nav_release_flow_field(Nav *nav, NavHandle handle);
+NavState nav_get_flow_field_state(Nav const *nav, NavHandle handle);
+// Furthest cell of the next NAV_FLOW_LOOKAHEAD the way to is clear, false if the field is not ready or can not help from here
+BOOL nav_flow_field_steer(Nav const *nav, NavHandle handle, Vector3 position, Vector3 *waypoint);
+
+// Solves queued flow fields, then queued requests oldest first, one batch after the other until the budget is used up.
+// At least one batch runs every call so nothing starves.
+void nav_update(Nav *nav, F64 budget_seconds);
+NavStats nav_get_stats(Nav const *nav);
+C8 const *nav_state_to_cstr(NavState state);
@@ -1,7 +1,9 @@
 #include "particles_3d.hpp"
 #include "asset.hpp"
 #include "color.hpp"
+#include "command.hpp"
 #include "cvar.hpp"
+#include "job.hpp"
 #include "log.hpp"
 #include "math.hpp"
 #include "message.hpp"
@@ -11,22 +13,347 @@
 #include "time.hpp"
 #include "world.hpp"
 
+#include <atomic>
 #include <raymath.h>
 #include <rlgl.h>
 #include <external/glad.h>
 #include <glm/gtc/type_ptr.hpp>
 
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
 Particles3D g_particles3d = {};
-Particle3DCommandQueue static g_particle3d_command_queue = {};
 
 #ifndef __APPLE__
 
-void particles3d_init() {
-    // Initialize command queue mutex
-    mtx_init(&g_particle3d_command_queue.mutex, mtx_plain);
-    g_particle3d_command_queue.count = 0;
+#define PARTICLES_3D_JOB_GRAIN 8192
+
+struct IParticles3DIntegrateData {
+    F32 dt;
+    U32 scene_id;
+    std::atomic<SZ> dead_count;
+};
+
+// ====== SIMD ======
+
+#if PARTICLES_3D_SIMD_WIDTH == 8
+
+using IF32x = __m256;
+
+IF32x static inline i_load(F32 const *p)                    { return _mm256_loadu_ps(p); }
+void static inline i_store(F32 *p, IF32x v)                 { _mm256_storeu_ps(p, v); }
+IF32x static inline i_set1(F32 v)                           { return _mm256_set1_ps(v); }
+IF32x static inline i_add(IF32x a, IF32x b)                 { return _mm256_add_ps(a, b); }
+IF32x static inline i_sub(IF32x a, IF32x b)                 { return _mm256_sub_ps(a, b); }
+IF32x static inline i_mul(IF32x a, IF32x b)                 { return _mm256_mul_ps(a, b); }
+IF32x static inline i_div(IF32x a, IF32x b)                 { return _mm256_div_ps(a, b); }
+IF32x static inline i_and(IF32x a, IF32x b)                 { return _mm256_and_ps(a, b); }
+IF32x static inline i_select(IF32x mask, IF32x a, IF32x b)  { return _mm256_blendv_ps(b, a, mask); }
+IF32x static inline i_gt(IF32x a, IF32x b)                  { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+IF32x static inline i_le(IF32x a, IF32x b)                  { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+S32 static inline i_mask_bits(IF32x mask)                   { return _mm256_movemask_ps(mask); }
+
+IF32x static inline i_eq_u32(U32 const *p, U32 v) {
+    __m256i const a = _mm256_loadu_si256((__m256i const *)p);
+    return _mm256_castsi256_ps(_mm256_cmpeq_epi32(a, _mm256_set1_epi32((S32)v)));
+}
+
+// 2^x for x in roughly [-126, 126], ~1e-7 relative error, polynomial on [-0.5, 0.5] after splitting off the nearest integer
+IF32x static inline i_exp2(IF32x x) {
+    x                  = _mm256_max_ps(_mm256_min_ps(x, i_set1(126.0F)), i_set1(-126.0F));
+    IF32x const whole  = _mm256_round_ps(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    IF32x const f      = i_sub(x, whole);
+    __m256i const bits = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(whole), _mm256_set1_epi32(127)), 23);
+    IF32x p            = i_set1(1.5353362e-4F);
+    p                  = i_add(i_mul(p, f), i_set1(1.3398874e-3F));
+    p                  = i_add(i_mul(p, f), i_set1(9.6184374e-3F));
+    p                  = i_add(i_mul(p, f), i_set1(5.5503325e-2F));
+    p                  = i_add(i_mul(p, f), i_set1(2.4022648e-1F));
+    p                  = i_add(i_mul(p, f), i_set1(6.9314720e-1F));
+    p                  = i_add(i_mul(p, f), i_set1(1.0F));
+    return i_mul(p, _mm256_castsi256_ps(bits));
+}
+
+#elif PARTICLES_3D_SIMD_WIDTH == 4
+
+using IF32x = __m128;
+
+IF32x static inline i_load(F32 const *p)                    { return _mm_loadu_ps(p); }
+void static inline i_store(F32 *p, IF32x v)                 { _mm_storeu_ps(p, v); }
+IF32x static inline i_set1(F32 v)                           { return _mm_set1_ps(v); }
+IF32x static inline i_add(IF32x a, IF32x b)                 { return _mm_add_ps(a, b); }
+IF32x static inline i_sub(IF32x a, IF32x b)                 { return _mm_sub_ps(a, b); }
+IF32x static inline i_mul(IF32x a, IF32x b)                 { return _mm_mul_ps(a, b); }
+IF32x static inline i_div(IF32x a, IF32x b)                 { return _mm_div_ps(a, b); }
+IF32x static inline i_and(IF32x a, IF32x b)                 { return _mm_and_ps(a, b); }
+IF32x static inline i_select(IF32x mask, IF32x a, IF32x b)  { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+IF32x static inline i_gt(IF32x a, IF32x b)                  { return _mm_cmpgt_ps(a, b); }
+IF32x static inline i_le(IF32x a, IF32x b)                  { return _mm_cmple_ps(a, b); }
+S32 static inline i_mask_bits(IF32x mask)                   { return _mm_movemask_ps(mask); }
+
+IF32x static inline i_eq_u32(U32 const *p, U32 v) {
+    __m128i const a = _mm_loadu_si128((__m128i const *)p);
+    return _mm_castsi128_ps(_mm_cmpeq_epi32(a, _mm_set1_epi32((S32)v)));
+}
+
+// Same as the AVX2 version, cvtps rounds to nearest by default
+IF32x static inline i_exp2(IF32x x) {
+    x                  = _mm_max_ps(_mm_min_ps(x, i_set1(126.0F)), i_set1(-126.0F));
+    __m128i const n    = _mm_cvtps_epi32(x);
+    IF32x const f      = i_sub(x, _mm_cvtepi32_ps(n));
+    __m128i const bits = _mm_slli_epi32(_mm_add_epi32(n, _mm_set1_epi32(127)), 23);
+    IF32x p            = i_set1(1.5353362e-4F);
+    p                  = i_add(i_mul(p, f), i_set1(1.3398874e-3F));
+    p                  = i_add(i_mul(p, f), i_set1(9.6184374e-3F));
+    p                  = i_add(i_mul(p, f), i_set1(5.5503325e-2F));
+    p                  = i_add(i_mul(p, f), i_set1(2.4022648e-1F));
+    p                  = i_add(i_mul(p, f), i_set1(6.9314720e-1F));
+    p                  = i_add(i_mul(p, f), i_set1(1.0F));
+    return i_mul(p, _mm_castsi128_ps(bits));
+}
+
+#endif
+
+// ====== CPU BACKEND ======
+
+void static i_soa_alloc() {
+    Particle3DSoA *soa = &g_particles3d.soa;
+    if (soa->position_x) { return; }
+
+    soa->position_x     = mcpa(F32 *, PARTICLES_3D_MAX, sizeof(F32));
+    soa->position_y     = mcpa(F32 *, PARTICLES_3D_MAX, sizeof(F32));
+    soa->position_z     = mcpa(F32 *, PARTICLES_3D_MAX, sizeof(F32));
+    soa->velocity_x     = mcpa(F32 *, PARTICLES_3D_MAX, sizeof(F32));
+    soa->velocity_y     = mcpa(F32 *, PARTICLES_3D_MAX, sizeof(F32));
+    soa->velocity_z     = mcpa(F32 *, PARTICLES_3D_MAX, sizeof(F32));
+    soa->acceleration_x = mcpa(F32 *, PARTICLES_3D_MAX, sizeof(F32));
+    soa->acceleration_y = mcpa(F32 *, PARTICLES_3D_MAX, sizeof(F32));
+    soa->acceleration_z = mcpa(F32 *, PARTICLES_3D_MAX, sizeof(F32));
+    soa->initial_life   = mcpa(F32 *, PARTICLES_3D_MAX, sizeof(F32));
+    soa->size           = mcpa(F32 *, PARTICLES_3D_MAX, sizeof(F32));
+    soa->initial_size   = mcpa(F32 *, PARTICLES_3D_MAX, sizeof(F32));
+    soa->alpha          = mcpa(F32 *, PARTICLES_3D_MAX, sizeof(F32));
+    soa->gravity        = mcpa(F32 *, PARTICLES_3D_MAX, sizeof(F32));
+    soa->rotation_speed = mcpa(F32 *, PARTICLES_3D_MAX, sizeof(F32));
+    soa->damping_log2   = mcpa(F32 *, PARTICLES_3D_MAX, sizeof(F32));
+    soa->stretch_factor = mcpa(F32 *, PARTICLES_3D_MAX, sizeof(F32));
+    soa->texture_index  = mcpa(U32 *, PARTICLES_3D_MAX, sizeof(U32));
+    soa->billboard_mode = mcpa(U32 *, PARTICLES_3D_MAX, sizeof(U32));
+    soa->start_color    = mcpa(ColorF *, PARTICLES_3D_MAX, sizeof(ColorF));
+    soa->end_color      = mcpa(ColorF *, PARTICLES_3D_MAX, sizeof(ColorF));
+}
+
+void static i_soa_move(SZ from, SZ to) {
+    Particle3DSoA *soa = &g_particles3d.soa;
+
+    soa->position_x[to]     = soa->position_x[from];
+    soa->position_y[to]     = soa->position_y[from];
+    soa->position_z[to]     = soa->position_z[from];
+    soa->velocity_x[to]     = soa->velocity_x[from];
+    soa->velocity_y[to]     = soa->velocity_y[from];
+    soa->velocity_z[to]     = soa->velocity_z[from];
+    soa->acceleration_x[to] = soa->acceleration_x[from];
+    soa->acceleration_y[to] = soa->acceleration_y[from];
+    soa->acceleration_z[to] = soa->acceleration_z[from];
+    soa->life[to]           = soa->life[from];
+    soa->initial_life[to]   = soa->initial_life[from];
+    soa->size[to]           = soa->size[from];
+    soa->initial_size[to]   = soa->initial_size[from];
+    soa->alpha[to]          = soa->alpha[from];
+    soa->gravity[to]        = soa->gravity[from];
+    soa->rotation_speed[to] = soa->rotation_speed[from];
+    soa->damping_log2[to]   = soa->damping_log2[from];
+    soa->stretch_factor[to] = soa->stretch_factor[from];
+    soa->scene_id[to]       = soa->scene_id[from];
+    soa->texture_index[to]  = soa->texture_index[from];
+    soa->billboard_mode[to] = soa->billboard_mode[from];
+    soa->start_color[to]    = soa->start_color[from];
+    soa->end_color[to]      = soa->end_color[from];
+}
+
+// Mirrors the compute shader, particles of other scenes are frozen
+void static i_integrate_scalar(SZ begin, SZ end, F32 dt, U32 scene_id, SZ *dead_count) {
+    Particle3DSoA *soa = &g_particles3d.soa;
+    F32 const damping_exponent = dt * 60.0F;
+
+    for (SZ i = begin; i < end; ++i) {
+        if (soa->scene_id[i] != scene_id) { continue; }
+
+        soa->life[i] -= dt;
+        if (soa->life[i] <= 0.0F) {
+            (*dead_count)++;
+            continue;
+        }
+
+        soa->velocity_x[i] += soa->acceleration_x[i] * dt;
+        soa->velocity_y[i] += (soa->acceleration_y[i] - soa->gravity[i]) * dt;
+        soa->velocity_z[i] += soa->acceleration_z[i] * dt;
+
+        F32 const damping   = math_exp2_f32(soa->damping_log2[i] * damping_exponent);
+        soa->velocity_x[i] *= damping;
+        soa->velocity_y[i] *= damping;
+        soa->velocity_z[i] *= damping;
+
+        soa->position_x[i] += soa->velocity_x[i] * dt;
+        soa->position_y[i] += soa->velocity_y[i] * dt;
+        soa->position_z[i] += soa->velocity_z[i] * dt;
+
+        F32 const t = 1.0F - (soa->life[i] / soa->initial_life[i]);
+        if (soa->stretch_factor[i] > 0.0F) {
+            soa->size[i]  = soa->initial_size[i] * (1.0F - (0.9F * t));
+            soa->alpha[i] = 1.0F - (t * t * t);
+        } else {
+            soa->size[i] = soa->initial_size[i];
+        }
+    }
+}
+
+S32 static i_integrate_range(U32 begin, U32 end, void *ctx) {
+    auto *data    = (IParticles3DIntegrateData *)ctx;
+    SZ dead_count = 0;
+    SZ i          = begin;
+
+#if PARTICLES_3D_SIMD_WIDTH > 1
+    Particle3DSoA *soa           = &g_particles3d.soa;
+    IF32x const zero             = i_set1(0.0F);
+    IF32x const one              = i_set1(1.0F);
+    IF32x const shrink           = i_set1(0.9F);
+    IF32x const damping_exponent = i_set1(data->dt * 60.0F);
+
+    for (; i + PARTICLES_3D_SIMD_WIDTH <= end; i += PARTICLES_3D_SIMD_WIDTH) {
+        // Lanes of other scenes integrate with a dt of 0, which leaves them untouched
+        IF32x const active = i_eq_u32(&soa->scene_id[i], data->scene_id);
+        IF32x const dt     = i_and(active, i_set1(data->dt));
+
+        IF32x const life = i_sub(i_load(&soa->life[i]), dt);
+        i_store(&soa->life[i], life);
+        dead_count += (SZ)__builtin_popcount((U32)i_mask_bits(i_le(life, zero)));
+
+        IF32x const damping = i_exp2(i_mul(i_mul(i_load(&soa->damping_log2[i]), damping_exponent), i_and(active, one)));
+
+        IF32x vx = i_add(i_load(&soa->velocity_x[i]), i_mul(i_load(&soa->acceleration_x[i]), dt));
+        IF32x vy = i_add(i_load(&soa->velocity_y[i]), i_mul(i_sub(i_load(&soa->acceleration_y[i]), i_load(&soa->gravity[i])), dt));
+        IF32x vz = i_add(i_load(&soa->velocity_z[i]), i_mul(i_load(&soa->acceleration_z[i]), dt));
+        vx       = i_mul(vx, damping);
+        vy       = i_mul(vy, damping);
+        vz       = i_mul(vz, damping);
+        i_store(&soa->velocity_x[i], vx);
+        i_store(&soa->velocity_y[i], vy);
+        i_store(&soa->velocity_z[i], vz);
+
+        i_store(&soa->position_x[i], i_add(i_load(&soa->position_x[i]), i_mul(vx, dt)));
+        i_store(&soa->position_y[i], i_add(i_load(&soa->position_y[i]), i_mul(vy, dt)));
+        i_store(&soa->position_z[i], i_add(i_load(&soa->position_z[i]), i_mul(vz, dt)));
+
+        IF32x const t        = i_sub(one, i_div(life, i_load(&soa->initial_life[i])));
+        IF32x const animated = i_gt(i_load(&soa->stretch_factor[i]), zero);
+        IF32x const scale    = i_select(animated, i_sub(one, i_mul(shrink, t)), one);
+        i_store(&soa->size[i], i_mul(i_load(&soa->initial_size[i]), scale));
+        i_store(&soa->alpha[i], i_sub(one, i_mul(i_mul(t, t), t)));
+    }
+#endif
+
+    i_integrate_scalar(i, end, data->dt, data->scene_id, &dead_count);
+
+    if (dead_count > 0) { data->dead_count.fetch_add(dead_count, std::memory_order_relaxed); }
+    return 0;
+}
+
+// Swap-remove, only dead particles cost anything
+void static i_compact() {
+    F32 const *life = g_particles3d.soa.life;
+    SZ i            = 0;
+    while (i < g_particles3d.live_count) {
+        if (life[i] > 0.0F) {
+            ++i;
+            continue;
+        }
+        g_particles3d.live_count--;
+        if (i != g_particles3d.live_count) { i_soa_move(g_particles3d.live_count, i); }
+    }
+    if (g_particles3d.write_index >= g_particles3d.live_count) { g_particles3d.write_index = 0; }
+}
+
+// Only what the vertex shader reads, one full struct store per particle since the mapping is write-combined
+S32 static i_upload_range(U32 begin, U32 end, void *ctx) {
+    unused(ctx);
+    Particle3DSoA const *soa = &g_particles3d.soa;
+
+    for (U32 i = begin; i < end; ++i) {
+        Particle3D p = {};
+        p.position       = {soa->position_x[i], soa->position_y[i], soa->position_z[i]};
+        p.velocity       = {soa->velocity_x[i], soa->velocity_y[i], soa->velocity_z[i]};
+        p.start_color    = soa->start_color[i];
+        p.end_color      = soa->end_color[i];
+        p.life           = soa->life[i];
+        p.initial_life   = soa->initial_life[i];
+        p.size           = soa->size[i];
+        p.initial_size   = soa->initial_size[i];
+        p.texture_index  = soa->texture_index[i];
+        p.rotation_speed = soa->rotation_speed[i];
+        p.scene_id       = soa->scene_id[i];
+        p.billboard_mode = soa->billboard_mode[i];
+        p.stretch_factor = soa->stretch_factor[i];
+        if (p.stretch_factor > 0.0F) {
+            p.start_color.a = soa->alpha[i];
+            p.end_color.a   = soa->alpha[i];
+        }
+        g_particles3d.mapped_data[i] = p;
+    }
+
+    return 0;
+}
+
+void static i_update_cpu(F32 dt, U32 scene_id) {
+    IParticles3DIntegrateData data = {};
+    data.dt                        = dt;
+    data.scene_id                  = scene_id;
+
+    job_wait(job_parallel_for(0, (U32)g_particles3d.live_count, PARTICLES_3D_JOB_GRAIN, i_integrate_range, &data));
+    if (data.dead_count.load(std::memory_order_relaxed) > 0) { i_compact(); }
+
+    if (g_particles3d.gpu_ready) { job_wait(job_parallel_for(0, (U32)g_particles3d.live_count, PARTICLES_3D_JOB_GRAIN, i_upload_range, nullptr)); }
+}
+
+// ====== GPU BACKEND ======
+
+// Shrink live_count to the highest slot that is still alive, dead slots below it stay holes until the tail dies
+void static i_trim_gpu_slots() {
+    F32 const *life = g_particles3d.soa.life;
+    while (g_particles3d.live_count > 0 && life[g_particles3d.live_count - 1] <= 0.0F) { g_particles3d.live_count--; }
+    if (g_particles3d.write_index >= g_particles3d.live_count) { g_particles3d.write_index = 0; }
+}
+
+void static i_update_gpu(F32 dt, U32 scene_id) {
+    // The compute shader's life math replayed on the CPU
+    F32 *life      = g_particles3d.soa.life;
+    U32 const *ids = g_particles3d.soa.scene_id;
+    for (SZ i = 0; i < g_particles3d.live_count; ++i) {
+        if (ids[i] == scene_id && life[i] > 0.0F) { life[i] -= dt; }
+    }
+    i_trim_gpu_slots();
+    if (g_particles3d.live_count == 0) { return; }
+
+    U32 const particle_count = (U32)g_particles3d.live_count;
+    U32 const work_groups    = (particle_count + 63) / 64;
+
+    glUseProgram(g_particles3d.compute_shader->base.id);
+    glUniform1f(g_particles3d.comp_delta_time_loc, dt);
+    glUniform1f(g_particles3d.comp_time_loc, time_get());
+    glUniform1ui(g_particles3d.comp_particle_count_loc, particle_count);
+    glUniform1ui(g_particles3d.comp_current_scene_loc, scene_id);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, g_particles3d.ssbo);
+
+    glDispatchCompute(work_groups, 1, 1);
+
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+}
+
+BOOL static i_init_gpu() {
     // Load bindless texture extension
-    if (!render_load_bindless_texture_extension()) { return; }
+    if (!render_load_bindless_texture_extension()) { return false; }
 
    // Initialize shaders and cache all uniform locations
     g_particles3d.draw_shader    = asset_get_shader("particles3d");
@@ -45,10 +372,6 @@ void particles3d_init() {
     g_particles3d.comp_particle_count_loc = GetShaderLocation(g_particles3d.compute_shader->base, "u_particle_count");
     g_particles3d.comp_current_scene_loc  = GetShaderLocation(g_particles3d.compute_shader->base, "u_current_scene");
 
-    // Initialize dynamic texture array and bindless handles array
-    array_init(MEMORY_TYPE_ARENA_PERMANENT, &g_particles3d.textures, 8);
-    array_init(MEMORY_TYPE_ARENA_PERMANENT, &g_particles3d.texture_handles, 8);
-
     // Base quad vertices for instanced rendering (billboards)
     F32 const quad_vertices[] = {
         // Positions  // TexCoords
@@ -86,7 +409,7 @@ void particles3d_init() {
                                                           GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT);
     if (!g_particles3d.mapped_data) {
         lle("Failed to map 3D particle buffer!");
-        return;
+        return false;
     }
 
     // Create SSBO for bindless texture handles (allows unlimited textures)
@@ -99,18 +422,35 @@ void particles3d_init() {
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 
+    return true;
+}
+
+// ====== API ======
+
+void particles3d_init() {
+    // Initialize dynamic texture array and bindless handles array
+    array_init(MEMORY_TYPE_ARENA_PERMANENT, &g_particles3d.textures, 8);
+    array_init(MEMORY_TYPE_ARENA_PERMANENT, &g_particles3d.texture_handles, 8);
+
+    // Both backends track life per slot, the rest of the SoA is only allocated once the CPU backend is used
+    g_particles3d.soa.life     = mcpa(F32 *, PARTICLES_3D_MAX, sizeof(F32));
+    g_particles3d.soa.scene_id = mcpa(U32 *, PARTICLES_3D_MAX, sizeof(U32));
+
+    g_particles3d.gpu_ready = i_init_gpu();
+    if (!g_particles3d.gpu_ready) { llw("3D particles are simulated on the CPU and not drawn"); }
+
     // Initialize debug tracking
     g_particles3d.spawn_rate_index     = 0;
-    g_particles3d.previous_write_index = 0;
+    g_particles3d.spawned_since_update = 0;
     for (F32 &v : g_particles3d.spawn_rate_history) { v = 0.0F; }
 
-    // Clear particle state to start fresh
-    particles3d_clear();
+    particles3d_set_backend(c_render__particles3d_cpu ? PARTICLE3D_BACKEND_CPU : PARTICLE3D_BACKEND_GPU);
 }
 
 void particles3d_clear() {
-    // Reset write index
+    // Reset slot state
     g_particles3d.write_index = 0;
+    g_particles3d.live_count  = 0;
 
     // Clear all particle data in the mapped buffer and mark as dead
     if (g_particles3d.mapped_data) {
@@ -126,60 +466,55 @@ void particles3d_clear() {
 }
 
 void particles3d_clear_scene(SceneType scene_type) {
-    // Clear only particles belonging to the specified scene
-    if (g_particles3d.mapped_data) {
-        for (SZ i = 0; i < PARTICLES_3D_MAX; ++i) {
-            if (g_particles3d.mapped_data[i].scene_id == (U32)scene_type) {
-                // Mark particle as dead by setting life to 0
-                g_particles3d.mapped_data[i].life = 0.0F;
-            }
-        }
+    // Clear only particles belonging to the specified scene, by setting life to 0
+    for (SZ i = 0; i < g_particles3d.live_count; ++i) {
+        if (g_particles3d.soa.scene_id[i] != (U32)scene_type) { continue; }
+        g_particles3d.soa.life[i] = 0.0F;
+        if (g_particles3d.backend == PARTICLE3D_BACKEND_GPU) { g_particles3d.mapped_data[i].life = 0.0F; }
     }
-}
 
-void particles3d_update(F32 dt) {
-    // Calculate spawn rate for debug tracking
-    SZ const current_write_index  = g_particles3d.write_index;
-    SZ const previous_write_index = g_particles3d.previous_write_index;
-    SZ spawned_this_frame         = 0;
-
-    // Handle ring buffer wrap-around when calculating delta
-    if (current_write_index >= previous_write_index) {
-        spawned_this_frame = current_write_index - previous_write_index;
+    if (g_particles3d.backend == PARTICLE3D_BACKEND_CPU) {
+        i_compact();
+        if (g_particles3d.gpu_ready) { job_wait(job_parallel_for(0, (U32)g_particles3d.live_count, PARTICLES_3D_JOB_GRAIN, i_upload_range, nullptr)); }
     } else {
-        spawned_this_frame = (PARTICLES_3D_MAX - previous_write_index) + current_write_index;
+        i_trim_gpu_slots();
     }
+}
+
+void particles3d_set_backend(Particle3DBackend backend) {
+    if (!g_particles3d.gpu_ready) { backend = PARTICLE3D_BACKEND_CPU; }
+    if (backend == PARTICLE3D_BACKEND_CPU) { i_soa_alloc(); }
+
+    g_particles3d.backend = backend;
+    particles3d_clear();
+}
+
+void particles3d_update(F32 dt) {
+    // Picked up at runtime, switching drops all live particles
+    Particle3DBackend const backend = c_render__particles3d_cpu || !g_particles3d.gpu_ready ? PARTICLE3D_BACKEND_CPU : PARTICLE3D_BACKEND_GPU;
+    if (backend != g_particles3d.backend) { particles3d_set_backend(backend); }
 
     // Convert to particles per second (avoid division by zero)
-    F32 const spawn_rate = (dt > 0.0F) ? (F32)spawned_this_frame / dt : 0.0F;
+    F32 const spawn_rate = (dt > 0.0F) ? (F32)g_particles3d.spawned_since_update / dt : 0.0F;
+    g_particles3d.spawned_since_update = 0;
 
     // Store in history ring buffer
     g_particles3d.spawn_rate_history[g_particles3d.spawn_rate_index] = spawn_rate;
     g_particles3d.spawn_rate_index                                   = (g_particles3d.spawn_rate_index + 1) % PARTICLES_3D_SPAWN_RATE_HISTORY_SIZE;
-    g_particles3d.previous_write_index                               = current_write_index;
 
-    // Always update all particles (ring buffer)
-    F32 const current_time       = time_get();
-    U32 const particle_count     = (U32)PARTICLES_3D_MAX;
     // Use overlay scene if active, otherwise use current scene
     SceneType const active_scene = g_scenes.current_overlay_scene_type != SCENE_NONE ? g_scenes.current_overlay_scene_type : g_scenes.current_scene_type;
-    U32 const current_scene      = (U32)active_scene;
-    U32 const work_groups        = (U32)((PARTICLES_3D_MAX + 63) / 64);
-
-    glUseProgram(g_particles3d.compute_shader->base.id);
-    glUniform1f(g_particles3d.comp_delta_time_loc, dt);
-    glUniform1f(g_particles3d.comp_time_loc, current_time);
-    glUniform1ui(g_particles3d.comp_particle_count_loc, particle_count);
-    glUniform1ui(g_particles3d.comp_current_scene_loc, current_scene);
-
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, g_particles3d.ssbo);
-
-    glDispatchCompute(work_groups, 1, 1);
 
-    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+    if (g_particles3d.backend == PARTICLE3D_BACKEND_CPU) {
+        i_update_cpu(dt, (U32)active_scene);
+    } else {
+        i_update_gpu(dt, (U32)active_scene);
+    }
 }
 
 void particles3d_draw() {
+    if (!g_particles3d.gpu_ready || g_particles3d.live_count == 0) { return; }
+
     Camera3D* camera = g_render.cameras.c3d.active_cam;
 
     glDisable(GL_CULL_FACE); // Disable face culling so particles are visible from both sides
@@ -220,9 +555,9 @@ void particles3d_draw() {
     // Bind bindless texture handles SSBO (binding point 3)
     glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, g_particles3d.texture_handles_ssbo);
 
-    // Draw all particles using instancing - vertex shader culls dead particles
+    // Draw only up to the last live slot using instancing - vertex shader culls dead particles
     glBindVertexArray(g_particles3d.vao);
-    glDrawArraysInstanced(GL_TRIANGLES, 0, 6, (S32)PARTICLES_3D_MAX);
+    glDrawArraysInstanced(GL_TRIANGLES, 0, 6, (S32)g_particles3d.live_count);
 
     glBindVertexArray(0);
     glEnable(GL_CULL_FACE); // Re-enable face culling
@@ -244,6 +579,9 @@ U32 particles3d_register_texture(ATexture *texture) {
     array_push(&g_particles3d.textures, texture);
     U32 const index = (U32)(g_particles3d.textures.count - 1);
 
+    // Without the GPU path the index is all the CPU backend needs
+    if (!g_particles3d.gpu_ready) { return index; }
+
     // Create bindless handle for this texture (allows shader to access it by handle)
     U64 const handle = render_get_texture_handle(texture->base.id);
     if (handle == 0) {
@@ -282,12 +620,55 @@ void particles3d_add(Vector3 *positions,
                    SZ count) {
     // Use overlay scene if active, otherwise use current scene
     SceneType const active_scene = g_scenes.current_overlay_scene_type != SCENE_NONE ? g_scenes.current_overlay_scene_type : g_scenes.current_scene_type;
+    BOOL const cpu               = g_particles3d.backend == PARTICLE3D_BACKEND_CPU;
+    Particle3DSoA *soa           = &g_particles3d.soa;
 
     for (SZ i = 0; i < count; ++i) {
+        if (lives[i] <= 0.0F) { continue; }  // Would never be simulated, and compaction relies on everything below live_count being alive
+
+        // Append behind the last live slot, once all slots are taken overwrite them round robin like a ring buffer
+        SZ slot = g_particles3d.live_count;
+        if (slot < PARTICLES_3D_MAX) {
+            g_particles3d.live_count++;
+        } else {
+            slot                      = g_particles3d.write_index;
+            g_particles3d.write_index = (g_particles3d.write_index + 1) % PARTICLES_3D_MAX;
+        }
+
         ColorF const start_col = color_to_colorf(start_colors[i]);
         ColorF const end_col   = color_to_colorf(end_colors[i]);
 
-        Particle3D *p = &g_particles3d.mapped_data[g_particles3d.write_index];
+        soa->life[slot]     = lives[i];
+        soa->scene_id[slot] = (U32)active_scene;
+
+        if (cpu) {
+            soa->position_x[slot]     = positions[i].x;
+            soa->position_y[slot]     = positions[i].y;
+            soa->position_z[slot]     = positions[i].z;
+            soa->velocity_x[slot]     = velocities[i].x;
+            soa->velocity_y[slot]     = velocities[i].y;
+            soa->velocity_z[slot]     = velocities[i].z;
+            soa->acceleration_x[slot] = accelerations[i].x;
+            soa->acceleration_y[slot] = accelerations[i].y;
+            soa->acceleration_z[slot] = accelerations[i].z;
+            soa->initial_life[slot]   = lives[i];
+            soa->size[slot]           = sizes[i];
+            soa->initial_size[slot]   = sizes[i];
+            soa->alpha[slot]          = 1.0F;
+            soa->gravity[slot]        = gravities[i];
+            soa->rotation_speed[slot] = rotation_speeds[i];
+            soa->damping_log2[slot]   = math_log2_f32(glm::max(1.0F - air_resistances[i], F32_MIN));
+            soa->stretch_factor[slot] = stretch_factors[i];
+            soa->texture_index[slot]  = texture_indices[i];
+            soa->billboard_mode[slot] = billboard_modes[i];
+            soa->start_color[slot]    = start_col;
+            soa->end_color[slot]      = end_col;
+        }
+
+        // Written straight to the GPU so the particle shows up this frame, the CPU backend re-uploads it on the next update
+        if (!g_particles3d.gpu_ready) { continue; }
+
+        Particle3D *p = &g_particles3d.mapped_data[slot];
         p->position       = positions[i];
         p->velocity       = velocities[i];
         p->acceleration   = accelerations[i];
@@ -308,9 +689,9 @@ void particles3d_add(Vector3 *positions,
         p->extra1         = 0.0F;
         p->extra2         = 0.0F;
         p->extra3         = 0.0F;
-
-        g_particles3d.write_index = (g_particles3d.write_index + 1) % PARTICLES_3D_MAX;
     }
+
+    g_particles3d.spawned_since_update += count;
 }
 
 void particles3d_add_explosion(Vector3 center, F32 radius, Color start_color, Color end_color, F32 size_multiplier, SZ count) {
@@ -1655,22 +2036,18 @@ void particles3d_add_spawn(Vector3 center, Color start_color, Color end_color, F
 // Thread-safe command queue functions (safe to call from worker threads)
 
 void static i_particles3d_queue_command_full(Particle3DCommandType type, Vector3 center, Vector3 extra_vec, Color start_color, Color end_color, F32 param1, F32 param2, F32 size_multiplier, SZ count) {
-    mtx_lock(&g_particle3d_command_queue.mutex);
-    if (g_particle3d_command_queue.count < PARTICLES_3D_COMMAND_QUEUE_MAX) {
-        Particle3DCommand *cmd = &g_particle3d_command_queue.commands[g_particle3d_command_queue.count++];
-        cmd->type = type;
-        cmd->center = center;
-        cmd->extra_vec = extra_vec;
-        cmd->start_color = start_color;
-        cmd->end_color = end_color;
-        cmd->param1 = param1;
-        cmd->param2 = param2;
-        cmd->size_multiplier = size_multiplier;
-        cmd->count = count;
-    } else {
-        llt("Particle3D command queue full, dropping command");
-    }
-    mtx_unlock(&g_particle3d_command_queue.mutex);
+    Command cmd                      = {};
+    cmd.type                         = COMMAND_TYPE_PARTICLES_3D;
+    cmd.particles_3d.type            = type;
+    cmd.particles_3d.center          = center;
+    cmd.particles_3d.extra_vec       = extra_vec;
+    cmd.particles_3d.start_color     = start_color;
+    cmd.particles_3d.end_color       = end_color;
+    cmd.particles_3d.param1          = param1;
+    cmd.particles_3d.param2          = param2;
+    cmd.particles_3d.size_multiplier = size_multiplier;
+    cmd.particles_3d.count           = (U32)count;
+    command_push(&cmd);
 }
 
 void particles3d_queue_explosion(Vector3 center, F32 radius, Color start_color, Color end_color, F32 size_multiplier, SZ count) {
@@ -1749,93 +2126,69 @@ void particles3d_queue_spawn(Vector3 center, Color start_color, Color end_color,
     i_particles3d_queue_command_full(PARTICLE3D_CMD_SPAWN, center, {}, start_color, end_color, 0.0F, 0.0F, size_multiplier, count);
 }
 
-// Main thread only: process all queued commands
-void particles3d_process_command_queue() {
-    mtx_lock(&g_particle3d_command_queue.mutex);
-    U32 const cmd_count = g_particle3d_command_queue.count;
-    mtx_unlock(&g_particle3d_command_queue.mutex);
-
-    // Process commands without holding lock (main thread is the only processor)
-    for (U32 i = 0; i < cmd_count; ++i) {
-        Particle3DCommand const *cmd = &g_particle3d_command_queue.commands[i];
-
-        switch (cmd->type) {
-            case PARTICLE3D_CMD_EXPLOSION:
-                particles3d_add_explosion(cmd->center, cmd->param1, cmd->start_color, cmd->end_color, cmd->size_multiplier, cmd->count);
-                break;
-            case PARTICLE3D_CMD_SMOKE:
-                particles3d_add_smoke(cmd->center, cmd->param1, cmd->start_color, cmd->end_color, cmd->size_multiplier, cmd->count);
-                break;
-            case PARTICLE3D_CMD_SPARKLE:
-                particles3d_add_sparkle(cmd->center, cmd->param1, cmd->start_color, cmd->end_color, cmd->size_multiplier, cmd->count);
-                break;
-            case PARTICLE3D_CMD_FIRE:
-                particles3d_add_fire(cmd->center, cmd->param1, cmd->start_color, cmd->end_color, cmd->size_multiplier, cmd->count);
-                break;
-            case PARTICLE3D_CMD_SPIRAL:
-                particles3d_add_spiral(cmd->center, cmd->param1, cmd->param2, cmd->start_color, cmd->end_color, cmd->size_multiplier, cmd->count);
-                break;
-            case PARTICLE3D_CMD_FOUNTAIN:
-                particles3d_add_fountain(cmd->center, cmd->param1, cmd->param2, cmd->start_color, cmd->end_color, cmd->size_multiplier, cmd->count);
-                break;
-            case PARTICLE3D_CMD_TRAIL:
-                particles3d_add_trail(cmd->center, cmd->extra_vec, cmd->start_color, cmd->end_color, cmd->size_multiplier, cmd->count);
-                break;
-            case PARTICLE3D_CMD_DUST_CLOUD:
-                particles3d_add_dust_cloud(cmd->center, cmd->param1, cmd->start_color, cmd->end_color, cmd->size_multiplier, cmd->count);
-                break;
-            case PARTICLE3D_CMD_MAGIC_BURST:
-                particles3d_add_magic_burst(cmd->center, cmd->start_color, cmd->end_color, cmd->size_multiplier, cmd->count);
-                break;
-            case PARTICLE3D_CMD_DEBRIS:
-                particles3d_add_debris(cmd->center, cmd->extra_vec, cmd->start_color, cmd->end_color, cmd->size_multiplier, cmd->count);
-                break;
-            case PARTICLE3D_CMD_AMBIENT_RAIN:
-                particles3d_add_ambient_rain(cmd->center, cmd->param1, cmd->param2, cmd->start_color, cmd->end_color, cmd->size_multiplier, cmd->count);
-                break;
-            case PARTICLE3D_CMD_CHAOS_STRESS_TEST:
-                particles3d_add_chaos_stress_test(cmd->center, cmd->param1, cmd->count);
-                break;
-            case PARTICLE3D_CMD_HARVEST_IMPACT:
-                particles3d_add_harvest_impact(cmd->center, cmd->start_color, cmd->end_color, cmd->size_multiplier, cmd->count);
-                break;
-            case PARTICLE3D_CMD_HARVEST_ACTIVE:
-                particles3d_add_harvest_active(cmd->center, cmd->start_color, cmd->end_color, cmd->size_multiplier, cmd->count);
-                break;
-            case PARTICLE3D_CMD_HARVEST_COMPLETE:
-                particles3d_add_harvest_complete(cmd->center, cmd->start_color, cmd->end_color, cmd->size_multiplier, cmd->count);
-                break;
-            case PARTICLE3D_CMD_CLICK_INDICATOR:
-                particles3d_add_click_indicator(cmd->center, cmd->param1, cmd->start_color, cmd->end_color, cmd->count);
-                break;
-            case PARTICLE3D_CMD_BLOOD_HIT:
-                particles3d_add_blood_hit(cmd->center, cmd->start_color, cmd->end_color, cmd->size_multiplier, cmd->count);
-                break;
-            case PARTICLE3D_CMD_BLOOD_DEATH:
-                particles3d_add_blood_death(cmd->center, cmd->start_color, cmd->end_color, cmd->size_multiplier, cmd->count);
-                break;
-            case PARTICLE3D_CMD_SPAWN:
-                particles3d_add_spawn(cmd->center, cmd->start_color, cmd->end_color, cmd->size_multiplier, cmd->count);
-                break;
-            default:
-                break;
-        }
-    }
-
-    // Remove processed commands and shift remaining ones to the front
-    mtx_lock(&g_particle3d_command_queue.mutex);
-    if (cmd_count < g_particle3d_command_queue.count) {
-        // New commands were added while we were processing - shift them to the front
-        U32 const remaining = g_particle3d_command_queue.count - cmd_count;
-        ou_memmove(&g_particle3d_command_queue.commands[0],
-                   &g_particle3d_command_queue.commands[cmd_count],
-                   remaining * sizeof(Particle3DCommand));
-        g_particle3d_command_queue.count = remaining;
-    } else {
-        // No new commands added, just clear
-        g_particle3d_command_queue.count = 0;
+// Main thread only, called for every particle command when the command buffers get flushed
+void particles3d_execute_command(Particle3DCommand const *cmd) {
+    switch (cmd->type) {
+        case PARTICLE3D_CMD_EXPLOSION:
+            particles3d_add_explosion(cmd->center, cmd->param1, cmd->start_color, cmd->end_color, cmd->size_multiplier, cmd->count);
+            break;
+        case PARTICLE3D_CMD_SMOKE:
+            particles3d_add_smoke(cmd->center, cmd->param1, cmd->start_color, cmd->end_color, cmd->size_multiplier, cmd->count);
+            break;
+        case PARTICLE3D_CMD_SPARKLE:
+            particles3d_add_sparkle(cmd->center, cmd->param1, cmd->start_color, cmd->end_color, cmd->size_multiplier, cmd->count);
+            break;
+        case PARTICLE3D_CMD_FIRE:
+            particles3d_add_fire(cmd->center, cmd->param1, cmd->start_color, cmd->end_color, cmd->size_multiplier, cmd->count);
+            break;
+        case PARTICLE3D_CMD_SPIRAL:
+            particles3d_add_spiral(cmd->center, cmd->param1, cmd->param2, cmd->start_color, cmd->end_color, cmd->size_multiplier, cmd->count);
+            break;
+        case PARTICLE3D_CMD_FOUNTAIN:
+            particles3d_add_fountain(cmd->center, cmd->param1, cmd->param2, cmd->start_color, cmd->end_color, cmd->size_multiplier, cmd->count);
+            break;
+        case PARTICLE3D_CMD_TRAIL:
+            particles3d_add_trail(cmd->center, cmd->extra_vec, cmd->start_color, cmd->end_color, cmd->size_multiplier, cmd->count);
+            break;
+        case PARTICLE3D_CMD_DUST_CLOUD:
+            particles3d_add_dust_cloud(cmd->center, cmd->param1, cmd->start_color, cmd->end_color, cmd->size_multiplier, cmd->count);
+            break;
+        case PARTICLE3D_CMD_MAGIC_BURST:
+            particles3d_add_magic_burst(cmd->center, cmd->start_color, cmd->end_color, cmd->size_multiplier, cmd->count);
+            break;
+        case PARTICLE3D_CMD_DEBRIS:
+            particles3d_add_debris(cmd->center, cmd->extra_vec, cmd->start_color, cmd->end_color, cmd->size_multiplier, cmd->count);
+            break;
+        case PARTICLE3D_CMD_AMBIENT_RAIN:
+            particles3d_add_ambient_rain(cmd->center, cmd->param1, cmd->param2, cmd->start_color, cmd->end_color, cmd->size_multiplier, cmd->count);
+            break;
+        case PARTICLE3D_CMD_CHAOS_STRESS_TEST:
+            particles3d_add_chaos_stress_test(cmd->center, cmd->param1, cmd->count);
+            break;
+        case PARTICLE3D_CMD_HARVEST_IMPACT:
+            particles3d_add_harvest_impact(cmd->center, cmd->start_color, cmd->end_color, cmd->size_multiplier, cmd->count);
+            break;
+        case PARTICLE3D_CMD_HARVEST_ACTIVE:
+            particles3d_add_harvest_active(cmd->center, cmd->start_color, cmd->end_color, cmd->size_multiplier, cmd->count);
+            break;
+        case PARTICLE3D_CMD_HARVEST_COMPLETE:
+            particles3d_add_harvest_complete(cmd->center, cmd->start_color, cmd->end_color, cmd->size_multiplier, cmd->count);
+            break;
+        case PARTICLE3D_CMD_CLICK_INDICATOR:
+            particles3d_add_click_indicator(cmd->center, cmd->param1, cmd->start_color, cmd->end_color, cmd->count);
+            break;
+        case PARTICLE3D_CMD_BLOOD_HIT:
+            particles3d_add_blood_hit(cmd->center, cmd->start_color, cmd->end_color, cmd->size_multiplier, cmd->count);
+            break;
+        case PARTICLE3D_CMD_BLOOD_DEATH:
+            particles3d_add_blood_death(cmd->center, cmd->start_color, cmd->end_color, cmd->size_multiplier, cmd->count);
+            break;
+        case PARTICLE3D_CMD_SPAWN:
+            particles3d_add_spawn(cmd->center, cmd->start_color, cmd->end_color, cmd->size_multiplier, cmd->count);
+            break;
+        default:
+            break;
     }
-    mtx_unlock(&g_particle3d_command_queue.mutex);
 }
 
 #else
@@ -1845,6 +2198,7 @@ void particles3d_clear() {}
 void particles3d_clear_scene(SceneType scene_type) {}
 void particles3d_update(F32 dt) {}
 void particles3d_draw() {}
+void particles3d_set_backend(Particle3DBackend backend) {}
 U32 particles3d_register_texture(ATexture *texture) {return 0;}
 void particles3d_add(Vector3 *positions,
                    Vector3 *velocities,
@@ -1899,6 +2253,6 @@ void particles3d_queue_click_indicator   (Vector3 position, F32 radius, Color st
 void particles3d_queue_blood_hit         (Vector3 center, Color start_color, Color end_color, F32 size_multiplier, SZ count) {}
 void particles3d_queue_blood_death       (Vector3 center, Color start_color, Color end_color, F32 size_multiplier, SZ count) {}
 void particles3d_queue_spawn             (Vector3 center, Color start_color, Color end_color, F32 size_multiplier, SZ count) {}
-void particles3d_process_command_queue   () {}
+void particles3d_execute_command         (Particle3DCommand const *cmd) {}
 
 #endif
@@ -17,7 +17,20 @@
 
 #define PARTICLES_3D_MAX 500'000
 #define PARTICLES_3D_SPAWN_RATE_HISTORY_SIZE 128
-#define PARTICLES_3D_COMMAND_QUEUE_MAX 16384
+
+// Lanes the CPU backend integrates at once
+#if defined(__AVX2__)
+#define PARTICLES_3D_SIMD_WIDTH 8
+#elif defined(__SSE2__)
+#define PARTICLES_3D_SIMD_WIDTH 4
+#else
+#define PARTICLES_3D_SIMD_WIDTH 1
+#endif
+
+enum Particle3DBackend : U8 {
+    PARTICLE3D_BACKEND_GPU,  // Compute shader integrates the slots in place
+    PARTICLE3D_BACKEND_CPU,  // SoA storage integrated with SSE/AVX, only live particles get uploaded
+};
 
 enum Particle3DBillboardMode : U32 { // NOLINT(performance-enum-size)
     PARTICLE3D_BILLBOARD_CAMERA_FACING    = 0,  // Spherical billboard - faces camera
@@ -26,7 +39,7 @@ enum Particle3DBillboardMode : U32 { // NOLINT(performance-enum-size)
     PARTICLE3D_BILLBOARD_HORIZONTAL       = 3,  // Flat on ground (XZ plane)
 };
 
-// Command queue for thread-safe particle spawning
+// Particle spawns recorded from worker threads, see command.hpp
 enum Particle3DCommandType : U8 {
     PARTICLE3D_CMD_EXPLOSION,
     PARTICLE3D_CMD_SMOKE,
@@ -59,13 +72,7 @@ struct Particle3DCommand {
     F32 param1;             // radius, spread, spread_angle, height, etc.
     F32 param2;             // power, fall_height, etc.
     F32 size_multiplier;
-    SZ count;
-};
-
-struct Particle3DCommandQueue {
-    Particle3DCommand commands[PARTICLES_3D_COMMAND_QUEUE_MAX];
     U32 count;
-    mtx_t mutex;
 };
 
 // GPU-aligned particle structure (must match compute shader)
@@ -93,7 +100,39 @@ struct Particle3D {
     F32 extra3;            // 4 bytes - extra data slot 3
 };
 
+// CPU side particle storage, one array per field so the integrator can load 4/8 particles per instruction.
+// CPU backend: live particles are packed into [0, live_count).
+// GPU backend: only life and scene_id are used, indexed by slot, to know which slots are still alive.
+struct Particle3DSoA {
+    F32 *position_x;
+    F32 *position_y;
+    F32 *position_z;
+    F32 *velocity_x;
+    F32 *velocity_y;
+    F32 *velocity_z;
+    F32 *acceleration_x;
+    F32 *acceleration_y;
+    F32 *acceleration_z;
+    F32 *life;
+    F32 *initial_life;
+    F32 *size;
+    F32 *initial_size;
+    F32 *alpha;            // Faded alpha of animated particles (stretch_factor > 0)
+    F32 *gravity;
+    F32 *rotation_speed;
+    F32 *damping_log2;     // log2(1 - air_resistance), the integrator only needs an exp2 per particle
+    F32 *stretch_factor;
+    U32 *scene_id;
+    U32 *texture_index;
+    U32 *billboard_mode;
+    ColorF *start_color;
+    ColorF *end_color;
+};
+
 struct Particles3D {
+    Particle3DBackend backend;
+    BOOL gpu_ready;                // False without bindless textures (e.g. headless), the CPU backend still works
+
     // Rendering
     U32 vao;
     AShader* draw_shader;
@@ -106,13 +145,17 @@ struct Particles3D {
     U32 texture_handles_ssbo;      // SSBO for bindless texture handles
     Particle3D* mapped_data;
 
-    // Ring buffer state
-    SZ write_index; // Where to write next particle
+    // CPU data
+    Particle3DSoA soa;
+
+    // Slot state
+    SZ write_index;  // Where to write next particle once all slots are taken
+    SZ live_count;   // CPU: live particles, GPU: highest slot that may still be alive + 1, sizes dispatch and draw
 
     // Debug tracking
     F32 spawn_rate_history[PARTICLES_3D_SPAWN_RATE_HISTORY_SIZE];   // Ring buffer of spawn rates (particles per second)
     SZ spawn_rate_index;                                             // Current position in spawn_rate_history
-    SZ previous_write_index;                                         // Previous frame's write_index for delta calculation
+    SZ spawned_since_update;                                         // Particles added since the last particles3d_update
 
     // Cached uniform locations - draw shader
     S32 draw_view_proj_loc;
@@ -135,6 +178,7 @@ void particles3d_clear();
 void particles3d_clear_scene(SceneType scene_type);
 void particles3d_update(F32 dt);
 void particles3d_draw();
+void particles3d_set_backend(Particle3DBackend backend);  // Clears all particles, falls back to CPU if the GPU path is unavailable
 U32 particles3d_register_texture(ATexture *texture);
 
 // Core particle spawning API
@@ -174,7 +218,7 @@ void particles3d_add_blood_hit           (Vector3 center, Color start_color, Col
 void particles3d_add_blood_death         (Vector3 center, Color start_color, Color end_color, F32 size_multiplier, SZ count);
 void particles3d_add_spawn               (Vector3 center, Color start_color, Color end_color, F32 size_multiplier, SZ count);
 
-// Thread-safe command queue API (safe to call from worker threads)
+// Recorded into the command buffers (safe to call from worker threads)
 void particles3d_queue_explosion         (Vector3 center, F32 radius, Color start_color, Color end_color, F32 size_multiplier, SZ count);
 void particles3d_queue_smoke             (Vector3 origin, F32 spread, Color start_color, Color end_color, F32 size_multiplier, SZ count);
 void particles3d_queue_sparkle           (Vector3 center, F32 radius, Color start_color, Color end_color, F32 size_multiplier, SZ count);
@@ -195,5 +239,5 @@ void particles3d_queue_blood_hit         (Vector3 center, Color start_color, Col
 void particles3d_queue_blood_death       (Vector3 center, Color start_color, Color end_color, F32 size_multiplier, SZ count);
 void particles3d_queue_spawn             (Vector3 center, Color start_color, Color end_color, F32 size_multiplier, SZ count);
 
-// Main thread only: process all queued commands
-void particles3d_process_command_queue   ();
+// Main thread only, runs a recorded command
+void particles3d_execute_command         (Particle3DCommand const *cmd);
@@ -6,6 +6,7 @@
 #include "cvar.hpp"
 #include "ease.hpp"
 #include "input.hpp"
+#include "job.hpp"
 #include "log.hpp"
 #include "math.hpp"
 #include "message.hpp"
@@ -30,6 +31,10 @@
 
 Profiler g_profiler = {};
 
+// Aggregated stats and the flame graph only ever see the main thread, everyone else just records events during captures
+BOOL static thread_local i_is_main_thread = false;
+ProfilerThread static thread_local *i_thread = nullptr;
+
 void static inline i_reset_track(ProfilerTrack *t) {
     t->executions       = 0;
     t->sum_e_frequency  = 0.0;
@@ -54,13 +59,10 @@ C8 static const *i_get_stack_overflow_debug_info(ProfilerTrack *t) {
     string_appendf(s, "\n");
 
     // Count and show active tracks
-    SZ active_count      = 0;
-    SZ total_tracks      = 0;
-    C8 const **label     = nullptr;
-    ProfilerTrack *track = nullptr;
-    MAP_EACH_PTR(&g_profiler.track_map, label, track) {
-        total_tracks++;
-        if (track->previous_generation == g_profiler.current_generation) { active_count++; }
+    SZ active_count        = 0;
+    SZ const total_tracks  = g_profiler.track_count.load(std::memory_order_acquire);
+    for (SZ i = 0; i < total_tracks; ++i) {
+        if (g_profiler.tracks[i].previous_generation == g_profiler.current_generation) { active_count++; }
     }
 
     string_appendf(s, "Active tracks: %zu / %zu total tracks\n", active_count, total_tracks);
@@ -76,9 +78,10 @@ C8 static const *i_get_stack_overflow_debug_info(ProfilerTrack *t) {
     SZ min_depth  = SIZE_MAX;
 
     // Collect active tracks and find minimum depth
-    MAP_EACH_PTR(&g_profiler.track_map, label, track) {
+    for (SZ i = 0; i < total_tracks; ++i) {
+        ProfilerTrack *track = &g_profiler.tracks[i];
         if (track->previous_generation == g_profiler.current_generation && active_idx < PROFILER_TRACK_MAX_COUNT) {
-            active_tracks[active_idx].label = *label;
+            active_tracks[active_idx].label = track->label;
             active_tracks[active_idx].track = track;
             min_depth = glm::min(min_depth, track->depth);
             active_idx++;
@@ -195,12 +198,85 @@ void static inline i_end_frame(ProfilerTrack *t) {
     g_profiler.call_stack_depth--;
 }
 
-void profiler_init() {
-    g_profiler.call_stack_depth = 0;
+void static i_intern_lock() {
+    while (g_profiler.intern_lock.test_and_set(std::memory_order_acquire)) {}
+}
+
+void static i_intern_unlock() {
+    g_profiler.intern_lock.clear(std::memory_order_release);
+}
+
+// Caller holds the intern lock
+U32 static i_find_track_id(C8 const *label, U64 hash) {
+    if (g_profiler.track_ids.capacity == 0) { return PROFILER_TRACK_ID_NONE; }
+
+    U32 const *id = ProfilerTrackIdMap_get(&g_profiler.track_ids, hash);
+    if (!id) { return PROFILER_TRACK_ID_NONE; }
+    if (ou_strcmp(g_profiler.tracks[*id].label, label) == 0) { return *id; }
+
+    // Hash collision, only the first label got into the map so everything else is found the slow way
+    U32 const track_count = g_profiler.track_count.load(std::memory_order_relaxed);
+    for (U32 i = 0; i < track_count; ++i) {
+        if (ou_strcmp(g_profiler.tracks[i].label, label) == 0) { return i; }
+    }
+    return PROFILER_TRACK_ID_NONE;
+}
+
+ProfilerThread static *i_get_thread() {
+    if (i_thread) { return i_thread; }
+
+    U32 const index = g_profiler.thread_count.fetch_add(1, std::memory_order_relaxed);
+    if (index >= PROFILER_THREAD_MAX_COUNT) {
+        g_profiler.thread_count.store(PROFILER_THREAD_MAX_COUNT, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    ProfilerThread *t    = &g_profiler.threads[index];
+    U32 const job_thread = job_system_get_thread_index();
+    t->events            = mmpa(ProfilerEvent *, sizeof(ProfilerEvent) * PROFILER_THREAD_MAX_EVENTS);
+    t->capture_generation.store(U32_MAX, std::memory_order_relaxed);
+    if (i_is_main_thread) {
+        ou_snprintf(t->name, PROFILER_THREAD_MAX_NAME_LENGTH, "Main");
+    } else if (job_thread != JOB_THREAD_INDEX_NONE) {
+        ou_snprintf(t->name, PROFILER_THREAD_MAX_NAME_LENGTH, "Job %u", job_thread);
+    } else {
+        ou_snprintf(t->name, PROFILER_THREAD_MAX_NAME_LENGTH, "Thread %u", index);
+    }
+
+    i_thread = t;
+    return t;
+}
+
+// Only the owning thread writes, the exporter reads [0, event_count) once the capture stopped
+void static inline i_push_event(U32 id, ProfilerEventType type, F64 time) {
+    if (!g_profiler.capture.active.load(std::memory_order_acquire)) { return; }
+
+    ProfilerThread *t = i_get_thread();
+    if (!t) { return; }
 
-    ProfilerTrackMap_init(&g_profiler.track_map, MEMORY_TYPE_ARENA_PERMANENT, 0);
+    U32 const generation = g_profiler.capture.generation.load(std::memory_order_acquire);
+    U32 count            = t->event_count.load(std::memory_order_relaxed);
+    if (t->capture_generation.load(std::memory_order_relaxed) != generation) {
+        count = 0;
+        t->dropped_count.store(0, std::memory_order_relaxed);
+        t->event_count.store(0, std::memory_order_relaxed);
+        t->capture_generation.store(generation, std::memory_order_release);
+    }
+
+    if (count >= PROFILER_THREAD_MAX_EVENTS) {
+        t->dropped_count.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
 
-    g_profiler.initialized = true;
+    t->events[count] = {time, id, type};
+    t->event_count.store(count + 1, std::memory_order_release);
+}
+
+void profiler_init() {
+    // Tracks may already have been interned by call sites that ran earlier, their ids are cached in statics so we keep them
+    g_profiler.call_stack_depth = 0;
+    i_is_main_thread            = true;
+    g_profiler.initialized      = true;
 }
 
 void profiler_update() {
@@ -882,7 +958,138 @@ void profiler_draw() {
     }
 }
 
+// ====== CAPTURE ======
+
+void static i_write_json_string(FILE *file, C8 const *s) {
+    fputc('"', file);
+    for (; *s; ++s) {
+        C8 const c = *s;
+        if (c == '"' || c == '\\') {
+            fputc('\\', file);
+            fputc(c, file);
+        } else if ((U8)c < 0x20) {
+            fprintf(file, "\\u%04x", (U32)c);
+        } else {
+            fputc(c, file);
+        }
+    }
+    fputc('"', file);
+}
+
+// Chrome trace event format, open with chrome://tracing, https://ui.perfetto.dev or speedscope
+void static i_capture_export() {
+    ProfilerCapture *capture = &g_profiler.capture;
+
+    if (!DirectoryExists(PROFILER_CAPTURE_FOLDER "/")) { MakeDirectory(PROFILER_CAPTURE_FOLDER "/"); }
+    C8 const *path = TS(PROFILER_CAPTURE_FOLDER "/trace_%" PRIu64 ".json", (U64)time(nullptr))->c;
+    FILE *file     = fopen(path, "w");
+    if (!file) {
+        lle("Could not open %s to write the profiler capture", path);
+        return;
+    }
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+    U32 const generation   = capture->generation.load(std::memory_order_acquire);
+    U32 const thread_count = glm::min(g_profiler.thread_count.load(std::memory_order_acquire), (U32)PROFILER_THREAD_MAX_COUNT);
+    SZ event_total         = 0;
+    SZ unmatched_total     = 0;
+    U32 dropped_total      = 0;
+    BOOL first             = true;
+
+    for (U32 tid = 0; tid < thread_count; ++tid) {
+        ProfilerThread const *t = &g_profiler.threads[tid];
+        if (t->capture_generation.load(std::memory_order_acquire) != generation) { continue; }
+
+        fprintf(file, "%s{\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"name\":\"thread_name\",\"args\":{\"name\":", first ? "" : ",\n", tid);
+        i_write_json_string(file, t->name);
+        fprintf(file, "}}");
+        first = false;
+
+        // Pair every end with its begin, anything that straddles the capture boundaries gets dropped
+        U32 const event_count = t->event_count.load(std::memory_order_acquire);
+        U32 stack[PROFILER_CALL_STACK_MAX_DEPTH];
+        U32 depth = 0;
+        for (U32 i = 0; i < event_count; ++i) {
+            ProfilerEvent const *e = &t->events[i];
+            if (e->type == PROFILER_EVENT_BEGIN) {
+                if (depth < PROFILER_CALL_STACK_MAX_DEPTH) { stack[depth] = i; }
+                depth++;
+                continue;
+            }
+
+            if (depth == 0) {
+                unmatched_total++;
+                continue;
+            }
+            depth--;
+            if (depth >= PROFILER_CALL_STACK_MAX_DEPTH) { continue; }
+
+            ProfilerEvent const *b = &t->events[stack[depth]];
+            if (b->track_id != e->track_id) {
+                unmatched_total++;
+                continue;
+            }
+
+            fprintf(file, ",\n{\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"name\":", tid,
+                    BASE_TO_MICRO(b->time - capture->start_time), BASE_TO_MICRO(e->time - b->time));
+            i_write_json_string(file, g_profiler.tracks[b->track_id].label);
+            fprintf(file, "}");
+            event_total++;
+        }
+        unmatched_total += depth;
+        dropped_total   += t->dropped_count.load(std::memory_order_relaxed);
+    }
+
+    fprintf(file, "\n]}\n");
+    fclose(file);
+
+    lli("Profiler capture of %u frames written to %s (%zu events over %u threads)", capture->frame_count, path, event_total, thread_count);
+    if (dropped_total > 0) { llw("Profiler capture dropped %u events, per thread buffers hold %d", dropped_total, PROFILER_THREAD_MAX_EVENTS); }
+    if (unmatched_total > 0) { lld("Profiler capture skipped %zu events without a partner", unmatched_total); }
+}
+
+BOOL profiler_capture(U32 frame_count) {
+    if (frame_count == 0) { return false; }
+    if (profiler_is_capturing()) {
+        llw("Profiler capture already running, %u frames left", g_profiler.capture.frames_left);
+        return false;
+    }
+
+    g_profiler.capture.requested_frames = frame_count;
+    return true;
+}
+
+BOOL profiler_is_capturing() {
+    return g_profiler.capture.requested_frames > 0 || g_profiler.capture.active.load(std::memory_order_relaxed);
+}
+
+// Called at every frame boundary, captures start and stop here so they always contain whole frames
+void static i_capture_update() {
+    ProfilerCapture *capture = &g_profiler.capture;
+
+    if (capture->active.load(std::memory_order_relaxed)) {
+        capture->frames_left--;
+        if (capture->frames_left > 0) { return; }
+
+        capture->active.store(false, std::memory_order_release);
+        i_capture_export();
+        return;
+    }
+
+    if (capture->requested_frames == 0) { return; }
+
+    capture->frame_count      = capture->requested_frames;
+    capture->frames_left      = capture->requested_frames;
+    capture->requested_frames = 0;
+    capture->start_time       = time_get_glfw_f64();
+    capture->generation.fetch_add(1, std::memory_order_release);
+    capture->active.store(true, std::memory_order_release);
+}
+
 void profiler_finalize() {
+    i_capture_update();
+
     if (g_profiler.flame_graph.paused) { return; }
 
     ProfilerFlameGraph *fg = &g_profiler.flame_graph;
@@ -895,9 +1102,9 @@ void profiler_finalize() {
     fg->end_time    = new_end;
     fg->track_count = 0;
 
-    C8 const **label           = nullptr;
-    ProfilerTrack const *track = nullptr;
-    MAP_EACH_PTR(&g_profiler.track_map, label, track) {
+    U32 const track_count = g_profiler.track_count.load(std::memory_order_acquire);
+    for (U32 i = 0; i < track_count; ++i) {
+        ProfilerTrack const *track = &g_profiler.tracks[i];
         // NOTE:
         // Skipping threads (depth 0) and profiler_finalize itself. We check if it is depth 1 before checking
         // for "profiler_finalize" label to avoid redundant string comparisons with tracks that are definitely
@@ -942,45 +1149,74 @@ void profiler_finalize() {
 }
 
 ProfilerTrack *profiler_get_track(C8 const *label) {
-    return ProfilerTrackMap_get(&g_profiler.track_map, label);
+    i_intern_lock();
+    U32 const id = i_find_track_id(label, hash_cstr(label));
+    i_intern_unlock();
+    return profiler_get_track_by_id(id);
 }
 
-void profiler_track_begin(C8 const *label) {
-    // We get the start related values as soon as possible.
-    F64 const start_time   = time_get_glfw();
-    U64 const start_cycles = GET_CYCLES();
+ProfilerTrack *profiler_get_track_by_id(U32 id) {
+    if (id >= g_profiler.track_count.load(std::memory_order_acquire)) { return nullptr; }
+    return &g_profiler.tracks[id];
+}
+
+U32 profiler_track_intern(C8 const *label) {
+    U64 const hash = hash_cstr(label);
+
+    i_intern_lock();
+    if (g_profiler.track_ids.capacity == 0) { ProfilerTrackIdMap_init(&g_profiler.track_ids, MEMORY_TYPE_ARENA_PERMANENT, PROFILER_TRACK_MAX_COUNT); }
+
+    U32 id = i_find_track_id(label, hash);
+    if (id == PROFILER_TRACK_ID_NONE) {
+        id = g_profiler.track_count.load(std::memory_order_relaxed);
+        if (id >= PROFILER_TRACK_MAX_COUNT) {
+            i_intern_unlock();
+            llw("Profiler track limit of %d reached, not tracking %s", PROFILER_TRACK_MAX_COUNT, label);
+            return PROFILER_TRACK_ID_NONE;
+        }
+
+        ProfilerTrack *track = &g_profiler.tracks[id];
+        ou_strncpy(track->label, label, PROFILER_TRACK_MAX_LABEL_LENGTH - 1);
+        track->label[PROFILER_TRACK_MAX_LABEL_LENGTH - 1] = '\0';
+        i_reset_track(track);
 
-    ProfilerTrack *track = profiler_get_track(label);
-    if (!track) {
-        ProfilerTrack new_track = {};
-        SZ const dest_size = sizeof(new_track.label);
-        ou_strncpy(new_track.label, label, dest_size - 1);
-        new_track.label[dest_size - 1] = '\0';
-        i_reset_track(&new_track);
-        ProfilerTrackMap_insert(&g_profiler.track_map, label, new_track);
-        track = ProfilerTrackMap_get(&g_profiler.track_map, label);
+        if (!ProfilerTrackIdMap_get(&g_profiler.track_ids, hash)) { ProfilerTrackIdMap_insert(&g_profiler.track_ids, hash, id); }
+        g_profiler.track_count.store(id + 1, std::memory_order_release);
     }
+    i_intern_unlock();
 
-    i_start_frame(track, start_time, start_cycles);
+    return id;
 }
 
-void profiler_track_end(C8 const *label) {
-    ProfilerTrack *track = profiler_get_track(label);
-    if (!track) {
-        lle("Track %s not found, cannot end since it was never started", label);
+void profiler_track_begin(U32 id) {
+    if (id == PROFILER_TRACK_ID_NONE) { return; }
+
+    if (!i_is_main_thread) {
+        i_push_event(id, PROFILER_EVENT_BEGIN, time_get_glfw_f64());
         return;
     }
 
-    // We get the end related stuff as late as possible.
-    i_end_frame(track);
+    // We get the start related values as soon as possible.
+    F64 const start_time   = time_get_glfw();
+    U64 const start_cycles = GET_CYCLES();
+
+    i_push_event(id, PROFILER_EVENT_BEGIN, time_get_glfw_f64());
+    i_start_frame(&g_profiler.tracks[id], start_time, start_cycles);
 }
 
-void profiler_reset() {
-    C8 const **label     = nullptr;
-    ProfilerTrack *track = nullptr;
-    MAP_EACH_PTR(&g_profiler.track_map, label, track) {
-        track->want_reset = true;
+void profiler_track_end(U32 id) {
+    if (id == PROFILER_TRACK_ID_NONE) { return; }
+
+    if (i_is_main_thread) {
+        // We get the end related stuff as late as possible.
+        i_end_frame(&g_profiler.tracks[id]);
     }
+    i_push_event(id, PROFILER_EVENT_END, time_get_glfw_f64());
+}
+
+void profiler_reset() {
+    U32 const track_count = g_profiler.track_count.load(std::memory_order_acquire);
+    for (U32 i = 0; i < track_count; ++i) { g_profiler.tracks[i].want_reset = true; }
     g_profiler.flame_graph.want_reset = true;
     time_reset();
 }
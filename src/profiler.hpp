@@ -3,10 +3,17 @@
 #include "common.hpp"
 #include "map.hpp"
 
+#include <atomic>
+
 #define PROFILER_TRACK_MAX_LABEL_LENGTH 256
 #define PROFILER_TRACK_MAX_COUNT 1024
+#define PROFILER_TRACK_ID_NONE U32_MAX
 #define PROFILER_FRAME_TIMES_TIMELINE_MAX_COUNT 256
 #define PROFILER_CALL_STACK_MAX_DEPTH 64
+#define PROFILER_THREAD_MAX_COUNT 32
+#define PROFILER_THREAD_MAX_NAME_LENGTH 32
+#define PROFILER_THREAD_MAX_EVENTS 32768  // Per thread and capture, everything past that is dropped
+#define PROFILER_CAPTURE_FOLDER "traces"
 
 fwd_decl(AFont);
 
@@ -59,11 +66,47 @@ struct ProfilerFlameGraph {
     F64 selected_tracks_max_time[PROFILER_TRACK_MAX_COUNT];
 };
 
-MAP_DECLARE(ProfilerTrackMap, C8 const *, ProfilerTrack, MAP_HASH_CSTR, MAP_EQUAL_CSTR);
+enum ProfilerEventType : U8 {
+    PROFILER_EVENT_BEGIN,
+    PROFILER_EVENT_END,
+};
+
+struct ProfilerEvent {
+    F64 time;
+    U32 track_id;
+    ProfilerEventType type;
+};
+
+// Every thread that hits a track gets one of these on first use, only the owning thread ever writes to it.
+struct alignas(64) ProfilerThread {
+    ProfilerEvent *events;
+    std::atomic<U32> event_count;         // Published with release, [0, event_count) is safe to read
+    std::atomic<U32> dropped_count;
+    std::atomic<U32> capture_generation;  // The owner empties its buffer once this falls behind the capture's
+    C8 name[PROFILER_THREAD_MAX_NAME_LENGTH];
+};
+
+// Events are only recorded while a capture runs, it always spans whole frames and gets exported once done
+struct ProfilerCapture {
+    std::atomic<BOOL> active;
+    std::atomic<U32> generation;
+    U32 requested_frames;  // Starts at the next frame boundary if non zero
+    U32 frame_count;
+    U32 frames_left;
+    F64 start_time;
+};
+
+MAP_DECLARE(ProfilerTrackIdMap, U64, U32, MAP_HASH_U64, MAP_EQUAL_U64);
 
 struct Profiler {
     BOOL initialized;
-    ProfilerTrackMap track_map;
+    ProfilerTrack tracks[PROFILER_TRACK_MAX_COUNT];  // Indexed by track id, the stats are main thread only
+    std::atomic<U32> track_count;
+    ProfilerTrackIdMap track_ids;                    // hash_cstr(label) -> track id, guarded by intern_lock
+    std::atomic_flag intern_lock;
+    ProfilerThread threads[PROFILER_THREAD_MAX_COUNT];
+    std::atomic<U32> thread_count;
+    ProfilerCapture capture;
     SZ current_generation;
     SZ call_stack_depth;
     ProfilerFlameGraph flame_graph;
@@ -77,33 +120,55 @@ void profiler_update();
 void profiler_draw();
 void profiler_finalize();
 ProfilerTrack *profiler_get_track(C8 const *label);
-void profiler_track_begin(C8 const *label);
-void profiler_track_end(C8 const *label);
+ProfilerTrack *profiler_get_track_by_id(U32 id);
+U32 profiler_track_intern(C8 const *label);  // Thread safe, returns the same id for the same label
+void profiler_track_begin(U32 id);
+void profiler_track_end(U32 id);
 void profiler_reset();
+BOOL profiler_capture(U32 frame_count);      // Records all threads for the next frame_count frames and writes a Chrome trace
+BOOL profiler_is_capturing();
 
 #define ML_NAME              "thread_MAIN"
 #define AT_NAME              "thread_ASSET"
 #define CT_NAME              "thread_CVAR"
-#define ML_PROFILE(function) profiler_track_begin(ML_NAME); function; profiler_track_end(ML_NAME)
+
+// Interned once per call site, label has to be a string literal
+#define PROFILER_TRACK_ID(label) ([]() -> U32 { U32 static const id = profiler_track_intern("" label); return id; }())
+
+#define ML_PROFILE(function) do {                 \
+    U32 const ml_id__ = PROFILER_TRACK_ID(ML_NAME); \
+    profiler_track_begin(ml_id__);                \
+    function;                                     \
+    profiler_track_end(ml_id__);                  \
+} while(0)
 
 #if defined(OURO_PROFILE)
-#define PP(function)         profiler_track_begin(#function); function; profiler_track_end(#function)
-#define PBEGIN(name)         profiler_track_begin(name)
-#define PBEGINF(fmt, var) do {                                   \
-    C8 static buffer##__LINE__[PROFILER_TRACK_MAX_LABEL_LENGTH]; \
+#define PP(function) do {                          \
+    U32 const pp_id__ = PROFILER_TRACK_ID(#function); \
+    profiler_track_begin(pp_id__);                 \
+    function;                                      \
+    profiler_track_end(pp_id__);                   \
+} while(0)
+#define PBEGIN(name)         profiler_track_begin(PROFILER_TRACK_ID(name))
+#define PBEGIN_ID(id)        profiler_track_begin(id)
+#define PBEGINF(fmt, var) do {                                                \
+    C8 static thread_local buffer##__LINE__[PROFILER_TRACK_MAX_LABEL_LENGTH]; \
     ou_snprintf(buffer##__LINE__, PROFILER_TRACK_MAX_LABEL_LENGTH, fmt, var); \
-    PBEGIN(buffer##__LINE__); \
+    profiler_track_begin(profiler_track_intern(buffer##__LINE__));           \
 } while(0)
-#define PEND(name)           profiler_track_end(name)
-#define PENDF(fmt, var) do {                                   \
-    C8 static buffer##__LINE__[PROFILER_TRACK_MAX_LABEL_LENGTH]; \
+#define PEND(name)           profiler_track_end(PROFILER_TRACK_ID(name))
+#define PEND_ID(id)          profiler_track_end(id)
+#define PENDF(fmt, var) do {                                                  \
+    C8 static thread_local buffer##__LINE__[PROFILER_TRACK_MAX_LABEL_LENGTH]; \
     ou_snprintf(buffer##__LINE__, PROFILER_TRACK_MAX_LABEL_LENGTH, fmt, var); \
-    PEND(buffer##__LINE__); \
+    profiler_track_end(profiler_track_intern(buffer##__LINE__));             \
 } while(0)
 #else
 #define PP(function)         do { function; } while(0)
 #define PBEGIN(name)         do {} while(0)
 #define PBEGINF(fmt, var)    do {} while(0)
+#define PBEGIN_ID(id)        do {} while(0)
 #define PEND(name)           do {} while(0)
+#define PEND_ID(id)          do {} while(0)
 #define PENDF(fmt, var)      do {} while(0)
 #endif
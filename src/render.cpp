@@ -8,7 +8,9 @@
 #include "particles_2d.hpp"
 #include "particles_3d.hpp"
 #include "profiler.hpp"
+#include "render_bone_palette.hpp"
 #include "render_healthbar.hpp"
+#include "render_instance_ring.hpp"
 #include "render_tooltip.hpp"
 #include "scene.hpp"
 #include "string.hpp"
@@ -82,6 +84,8 @@ RenderTexture static i_create_render_texture_with_depth(S32 width, S32 height) {
 void render_init() {
     g_render.default_material = LoadMaterialDefault();
 
+    for (SZ i = 0; i < RMODE_COUNT; ++i) { g_render.rmode_data[i].profiler_track_id = profiler_track_intern(render_mode_to_cstr((RenderMode)i)); }
+
     RenderSkyboxShader *ss = &g_render.skybox_shader;
     ss->shader             = asset_get_shader("skybox");;
 
@@ -117,6 +121,7 @@ void render_init() {
     mis->mvp_loc                    = GetShaderLocation(mis->shader->base, "mvp");
     mis->view_pos_loc               = GetShaderLocation(mis->shader->base, "viewPos");
     mis->ambient_color_loc          = GetShaderLocation(mis->shader->base, "ambient");
+    mis->instance_transform_loc     = GetShaderLocationAttrib(mis->shader->base, "instanceTransform");
     mis->instance_tint_loc          = GetShaderLocationAttrib(mis->shader->base, "instanceTint");
     mis->is_selected_loc            = GetShaderLocation(mis->shader->base, "isSelected");
     mis->time_loc                   = GetShaderLocation(mis->shader->base, "time");
@@ -138,9 +143,13 @@ void render_init() {
     mais->mvp_loc                            = GetShaderLocation(mais->shader->base, "mvp");
     mais->view_pos_loc                       = GetShaderLocation(mais->shader->base, "viewPos");
     mais->ambient_color_loc                  = GetShaderLocation(mais->shader->base, "ambient");
+    mais->instance_transform_loc             = GetShaderLocationAttrib(mais->shader->base, "instanceTransform");
     mais->instance_tint_loc                  = GetShaderLocationAttrib(mais->shader->base, "instanceTint");
     mais->is_selected_loc                    = GetShaderLocation(mais->shader->base, "isSelected");
     mais->time_loc                           = GetShaderLocation(mais->shader->base, "time");
+    mais->bone_palette_loc                   = GetShaderLocation(mais->shader->base, "bonePalette");
+    mais->palette_offsets_loc                = GetShaderLocation(mais->shader->base, "paletteOffsets");
+    mais->palette_instance_base_loc          = GetShaderLocation(mais->shader->base, "paletteInstanceBase");
     mais->fog.density_loc                    = GetShaderLocation(mais->shader->base, "fog.density");
     mais->fog.color_loc                      = GetShaderLocation(mais->shader->base, "fog.color");
     for (SZ i = 0; i < LIGHTS_MAX; ++i) {
@@ -154,6 +163,12 @@ void render_init() {
         mais->light[i].outer_cutoff_loc = GetShaderLocation(mais->shader->base, TS("lights[%zu].outer_cutoff", i)->c);
     }
 
+    // The palette samplers never move, point them at their units once
+    S32 const bone_palette_unit    = RENDER_BONE_PALETTE_BONES_TEXTURE_UNIT;
+    S32 const palette_offsets_unit = RENDER_BONE_PALETTE_OFFSETS_TEXTURE_UNIT;
+    SetShaderValue(mais->shader->base, mais->bone_palette_loc, &bone_palette_unit, SHADER_UNIFORM_INT);
+    SetShaderValue(mais->shader->base, mais->palette_offsets_loc, &palette_offsets_unit, SHADER_UNIFORM_INT);
+
     render_sketch_set_major_color(RENDER_DEFAULT_MAJOR_COLOR);
     render_sketch_set_minor_color(RENDER_DEFAULT_MINOR_COLOR);
     render_set_accent_color(BLACK);
@@ -179,6 +194,8 @@ void render_init() {
     particles2d_init();
     particles3d_init();
     render_healthbar_init();
+    render_bone_palette_init();
+    render_instance_ring_init(&g_render_instance_ring);
 
     c3d_reset();
     c2d_reset();
@@ -344,13 +361,14 @@ void render_begin() {
 
     ClearBackground(BLANK);
     BeginDrawing();
+    render_instance_ring_begin_frame(&g_render_instance_ring);
     BeginBlendMode(BLEND_CUSTOM_SEPARATE);
 
     for (SZ i = 0; i < RMODE_COUNT; ++i) { g_render.rmode_order[i] = (RenderMode)i; }
 }
 
 void render_begin_render_mode(RenderMode mode) {
-    PBEGIN(render_mode_to_cstr(mode));
+    PBEGIN_ID(g_render.rmode_data[mode].profiler_track_id);
     PBEGIN("BODY_BEGIN_RENDER_MODE");
 
     g_render.begun_rmode = mode;
@@ -441,7 +459,7 @@ void render_end_render_mode() {
     if (g_render.rmode_data[mode].draw_call_count > 0) { g_render.rmode_data[mode].generation = g_profiler.current_generation; }
 
     PEND("BODY_END_RENDER_MODE");
-    PEND(render_mode_to_cstr(mode));
+    PEND_ID(g_render.rmode_data[mode].profiler_track_id);
 }
 
 void static i_set_uniforms() {
@@ -500,6 +518,7 @@ void render_post() {
     PBEGIN("BODY_RENDER_POST");
 
     EndBlendMode();
+    render_instance_ring_end_frame(&g_render_instance_ring);
     EndDrawing();
 
     for (auto mode : g_render.rmode_order) {
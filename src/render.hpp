@@ -72,6 +72,7 @@ struct RenderModeData {
     BOOL begun_but_not_ended;
     Color tint_color;
     RenderTexture target;
+    U32 profiler_track_id;  // Interned in render_init, the mode names are not literals so PBEGIN can't cache them
 };
 
 struct RenderCamera3D {
@@ -122,6 +123,7 @@ struct RenderModelInstancedShader {
     S32 mvp_loc;
     S32 view_pos_loc;
     S32 ambient_color_loc;
+    S32 instance_transform_loc;
     S32 instance_tint_loc;
     S32 is_selected_loc;
     S32 time_loc;
@@ -135,9 +137,13 @@ struct RenderModelAnimatedInstancedShader {
     S32 mvp_loc;
     S32 view_pos_loc;
     S32 ambient_color_loc;
+    S32 instance_transform_loc;
     S32 instance_tint_loc;
     S32 is_selected_loc;
     S32 time_loc;
+    S32 bone_palette_loc;
+    S32 palette_offsets_loc;
+    S32 palette_instance_base_loc;
 
     FogUniforms fog;
     LightUniforms light[LIGHTS_MAX];
@@ -303,8 +309,8 @@ void d3d_model_animated(C8 const *model_name, Vector3 position, F32 rotation, Ve
 void d3d_model_animated_by_hash(U32 model_name_hash, Vector3 position, F32 rotation, Vector3 scale, Color tint, Matrix *bone_matrices, S32 bone_count);
 void d3d_model_instanced(C8 const *model_name, Matrix *transforms, Color *tints, SZ instance_count);
 void d3d_model_instanced_by_hash(U32 model_name_hash, Matrix *transforms, Color *tints, SZ instance_count);
-void d3d_model_animated_instanced(C8 const *model_name, Matrix *transforms, Color *tints, SZ instance_count, Matrix *bone_matrices, S32 bone_count);
-void d3d_model_animated_instanced_by_hash(U32 model_name_hash, Matrix *transforms, Color *tints, SZ instance_count, Matrix *bone_matrices, S32 bone_count);
+void d3d_model_animated_instanced(C8 const *model_name, Matrix *transforms, Color *tints, SZ instance_count, U32 const *palette_offsets, U32 bone_base);
+void d3d_model_animated_instanced_by_hash(U32 model_name_hash, Matrix *transforms, Color *tints, SZ instance_count, U32 const *palette_offsets, U32 bone_base);
 void d3d_mesh_rl(Mesh *mesh, Material *material, Matrix *transform);
 void d3d_mesh_rl_instanced(Mesh *mesh, Material *material, Matrix *transforms, SZ instances);
 void d3d_bounding_box(BoundingBox bb, Color color);
@@ -0,0 +1,139 @@
+#include "render_bone_palette.hpp"
+#include "log.hpp"
+#include "std.hpp"
+
+#include <external/glad.h>
+
+RenderBonePalette g_render_bone_palette = {};
+
+#define I_BONE_REGION_SIZE ((GLsizeiptr)(RENDER_BONE_PALETTE_MAX_BONES * sizeof(Matrix)))
+#define I_OFFSET_REGION_SIZE ((GLsizeiptr)(RENDER_BONE_PALETTE_MAX_INSTANCES * sizeof(U32)))
+
+U32 static i_create_texture_buffer(GLenum format, GLsizeiptr size, U32 *out_texture, void **out_mapped) {
+    U32 buffer = 0;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+
+#ifndef __APPLE__
+    // Same persistent mapping as the healthbar SSBO
+    GLbitfield const flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glBufferStorage(GL_TEXTURE_BUFFER, size, nullptr, flags);
+    *out_mapped = glMapBufferRange(GL_TEXTURE_BUFFER, 0, size, flags);
+#else
+    // No buffer storage on macOS, uploads go through glBufferSubData instead
+    glBufferData(GL_TEXTURE_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    *out_mapped = nullptr;
+#endif
+
+    glGenTextures(1, out_texture);
+    glBindTexture(GL_TEXTURE_BUFFER, *out_texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    return buffer;
+}
+
+void static i_upload(U32 buffer, void *mapped, SZ offset, void const *data, SZ size) {
+    if (mapped) {
+        ou_memcpy((U8 *)mapped + offset, data, size);
+        return;
+    }
+
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+    glBufferSubData(GL_TEXTURE_BUFFER, (GLintptr)offset, (GLsizeiptr)size, data);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void render_bone_palette_init() {
+    RenderBonePalette *p = &g_render_bone_palette;
+
+    void *mapped_bones   = nullptr;
+    void *mapped_offsets = nullptr;
+    p->bone_buffer       = i_create_texture_buffer(GL_RGBA32F, I_BONE_REGION_SIZE * RENDER_BONE_PALETTE_FRAME_COUNT, &p->bone_texture, &mapped_bones);
+    p->offset_buffer     = i_create_texture_buffer(GL_R32UI, I_OFFSET_REGION_SIZE * RENDER_BONE_PALETTE_FRAME_COUNT, &p->offset_texture, &mapped_offsets);
+    p->mapped_bones      = (Matrix *)mapped_bones;
+    p->mapped_offsets    = (U32 *)mapped_offsets;
+
+#ifndef __APPLE__
+    if (!p->mapped_bones || !p->mapped_offsets) {
+        lle("Failed to map bone palette buffers!");
+        return;
+    }
+#endif
+
+    p->region      = 0;
+    p->initialized = true;
+    lli("Bone palette initialized (%d regions of %d bones)", RENDER_BONE_PALETTE_FRAME_COUNT, RENDER_BONE_PALETTE_MAX_BONES);
+}
+
+void render_bone_palette_begin() {
+    RenderBonePalette *p = &g_render_bone_palette;
+    if (!p->initialized) { return; }
+
+    p->region       = (p->region + 1) % RENDER_BONE_PALETTE_FRAME_COUNT;
+    p->bone_count   = 0;
+    p->offset_count = 0;
+
+    // Only blocks when the CPU is more than RENDER_BONE_PALETTE_FRAME_COUNT uses ahead of the GPU
+    auto fence = (GLsync)p->fences[p->region];
+    if (fence) {
+        glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, U64_MAX);
+        glDeleteSync(fence);
+        p->fences[p->region] = nullptr;
+    }
+}
+
+void render_bone_palette_end() {
+    RenderBonePalette *p = &g_render_bone_palette;
+    if (!p->initialized) { return; }
+    if (p->bone_count == 0 && p->offset_count == 0) { return; }
+
+    p->fences[p->region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+BOOL render_bone_palette_upload_bones(Matrix const *bones, SZ count, U32 *out_bone_base) {
+    RenderBonePalette *p = &g_render_bone_palette;
+    if (!p->initialized) { return false; }
+    if (p->bone_count + count > RENDER_BONE_PALETTE_MAX_BONES) {
+        llw("Bone palette full, %zu bones do not fit (Max: %d)", count, RENDER_BONE_PALETTE_MAX_BONES);
+        return false;
+    }
+
+    SZ const index = ((SZ)p->region * RENDER_BONE_PALETTE_MAX_BONES) + p->bone_count;
+    i_upload(p->bone_buffer, p->mapped_bones, index * sizeof(Matrix), bones, count * sizeof(Matrix));
+
+    p->bone_count += count;
+    *out_bone_base = (U32)index;
+    return true;
+}
+
+BOOL render_bone_palette_upload_offsets(U32 const *offsets, SZ count, U32 bone_base, U32 *out_instance_base) {
+    RenderBonePalette *p = &g_render_bone_palette;
+    if (!p->initialized) { return false; }
+    if (p->offset_count + count > RENDER_BONE_PALETTE_MAX_INSTANCES) {
+        llw("Bone palette offsets full, %zu instances do not fit (Max: %d)", count, RENDER_BONE_PALETTE_MAX_INSTANCES);
+        return false;
+    }
+
+    // The offsets are relative to the palette of the draw list, rebase them onto where it landed in the buffer
+    SZ const index = ((SZ)p->region * RENDER_BONE_PALETTE_MAX_INSTANCES) + p->offset_count;
+    U32 *rebased   = mmta(U32 *, count * sizeof(U32));
+    for (SZ i = 0; i < count; ++i) { rebased[i] = offsets[i] + bone_base; }
+    i_upload(p->offset_buffer, p->mapped_offsets, index * sizeof(U32), rebased, count * sizeof(U32));
+
+    p->offset_count += count;
+    *out_instance_base = (U32)index;
+    return true;
+}
+
+void render_bone_palette_bind() {
+    RenderBonePalette const *p = &g_render_bone_palette;
+    if (!p->initialized) { return; }
+
+    glActiveTexture(GL_TEXTURE0 + RENDER_BONE_PALETTE_BONES_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, p->bone_texture);
+    glActiveTexture(GL_TEXTURE0 + RENDER_BONE_PALETTE_OFFSETS_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, p->offset_texture);
+    glActiveTexture(GL_TEXTURE0);
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "common.hpp"
+#include "world.hpp"
+
+#include <raylib.h>
+
+// Per-instance bone palettes for animated instanced drawing. Every animated instance's bone matrices are uploaded back
+// to back into one texture buffer per frame, plus one offset per instance that says where its bones start.
+// The vertex shader reads offsets[instance_base + gl_InstanceID] and fetches its bones from there, so one instanced
+// draw can mix any number of animation states.
+// The buffers are split into RENDER_BONE_PALETTE_FRAME_COUNT regions that are cycled and fenced, so we never write
+// into a region the GPU might still be reading from.
+
+#define RENDER_BONE_PALETTE_FRAME_COUNT 3
+#define RENDER_BONE_PALETTE_MAX_BONES (128 * 1024)  // Per region, 8 MiB of matrices
+#define RENDER_BONE_PALETTE_MAX_INSTANCES WORLD_MAX_ENTITIES
+#define RENDER_BONE_PALETTE_BONES_TEXTURE_UNIT 14    // Above everything raylib binds for material maps
+#define RENDER_BONE_PALETTE_OFFSETS_TEXTURE_UNIT 15
+
+struct RenderBonePalette {
+    BOOL initialized;
+
+    // GPU data, texture buffers over plain buffer objects
+    U32 bone_buffer;
+    U32 bone_texture;
+    U32 offset_buffer;
+    U32 offset_texture;
+    Matrix *mapped_bones;  // Persistently mapped, nullptr where we have to fall back to glBufferSubData
+    U32 *mapped_offsets;
+    void *fences[RENDER_BONE_PALETTE_FRAME_COUNT];  // GLsync
+
+    // State of the region being filled
+    U32 region;
+    SZ bone_count;
+    SZ offset_count;
+};
+
+extern RenderBonePalette g_render_bone_palette;
+
+void render_bone_palette_init();
+void render_bone_palette_begin();  // Moves on to the next region, waits if the GPU is still using it
+void render_bone_palette_end();    // Fences the region after the draws that use it have been submitted
+BOOL render_bone_palette_upload_bones(Matrix const *bones, SZ count, U32 *out_bone_base);
+BOOL render_bone_palette_upload_offsets(U32 const *offsets, SZ count, U32 bone_base, U32 *out_instance_base);
+void render_bone_palette_bind();   // Binds both texture buffers to their units
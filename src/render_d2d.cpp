@@ -1,4 +1,5 @@
 #include "color.hpp"
+#include "command.hpp"
 #include "cvar.hpp"
 #include "loading.hpp"
 #include "message.hpp"
@@ -673,8 +674,13 @@ void d2d_healthbar_batched(EID id) {
     // Health percentage for shader coloring
     F32 const health_perc = glm::clamp((F32)g_world->health[id].current / (F32)g_world->health[id].max, 0.0F, 1.0F);
 
-    // Add to batch render - shader will handle coloring
-    render_healthbar_add(screen_pos, {bar_width, bar_height}, health_perc);
+    // Recorded from the collection job, lands in the batch when the commands get flushed - shader will handle coloring
+    Command cmd                = {};
+    cmd.type                   = COMMAND_TYPE_HEALTHBAR;
+    cmd.healthbar.screen_pos   = screen_pos;
+    cmd.healthbar.bar_size     = {bar_width, bar_height};
+    cmd.healthbar.health_perc  = health_perc;
+    command_push(&cmd);
 }
 
 void d2d_healthbar_draw_batched() {
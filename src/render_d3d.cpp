@@ -7,12 +7,15 @@
 #include "particles_3d.hpp"
 #include "raylib.h"
 #include "render.hpp"
+#include "render_bone_palette.hpp"
+#include "render_instance_ring.hpp"
 #include "std.hpp"
 #include "string.hpp"
 #include "time.hpp"
 #include "world.hpp"
 #include "map.hpp"
 
+#include <external/glad.h>
 #include <raymath.h>
 #include <rlgl.h>
 #include <glm/gtc/type_ptr.hpp>
@@ -116,60 +119,97 @@ void d3d_model_by_hash(U32 model_name_hash, Vector3 position, F32 rotation, Vect
     i_d3d_model_impl(model, position, rotation, scale, tint);
 }
 
-void static inline i_d3d_model_instanced_impl(AModel *model, Matrix *transforms, Color *tints, SZ instance_count) {
-    INCREMENT_DRAW_CALL;
+// Same material setup as raylib's DrawMeshInstanced, but the instance attributes come from the instance ring
+void static i_d3d_draw_mesh_instanced(Mesh const *mesh, Material const *material, Shader shader, S32 transform_loc, S32 tint_loc, SZ first, SZ instance_count) {
+    rlEnableShader(shader.id);
 
-    // Set view-projection matrix uniform
-    Matrix mat_view_proj = g_render.cameras.c3d.mat_view_proj;
-    SetShaderValueMatrix(g_render.model_instanced_shader.shader->base, g_render.model_instanced_shader.mvp_loc, mat_view_proj);
-
-    // Convert colors to F32 array for GPU
-    F32 *instance_colors = mmta(F32 *, instance_count * 4 * sizeof(F32));
-    for (SZ j = 0; j < instance_count; ++j) {
-        instance_colors[(j * 4) + 0] = (F32)tints[j].r / 255.0F;
-        instance_colors[(j * 4) + 1] = (F32)tints[j].g / 255.0F;
-        instance_colors[(j * 4) + 2] = (F32)tints[j].b / 255.0F;
-        instance_colors[(j * 4) + 3] = (F32)tints[j].a / 255.0F;
+    if (shader.locs[SHADER_LOC_COLOR_DIFFUSE] != -1) {
+        Color const c       = material->maps[MATERIAL_MAP_DIFFUSE].color;
+        F32 const values[4] = {(F32)c.r / 255.0F, (F32)c.g / 255.0F, (F32)c.b / 255.0F, (F32)c.a / 255.0F};
+        rlSetUniform(shader.locs[SHADER_LOC_COLOR_DIFFUSE], values, SHADER_UNIFORM_VEC4, 1);
     }
 
-    // Draw each mesh with instancing
-    for (S32 i = 0; i < model->base.meshCount; i++) {
-        Mesh *mesh = &model->base.meshes[i];
+    for (S32 map = 0; map < MAX_MATERIAL_MAPS; ++map) {
+        if (material->maps[map].texture.id == 0) { continue; }
+        rlActiveTextureSlot(map);
+        if (map == MATERIAL_MAP_IRRADIANCE || map == MATERIAL_MAP_PREFILTER || map == MATERIAL_MAP_CUBEMAP) {
+            rlEnableTextureCubemap(material->maps[map].texture.id);
+        } else {
+            rlEnableTexture(material->maps[map].texture.id);
+        }
+        rlSetUniform(shader.locs[SHADER_LOC_MAP_DIFFUSE + map], &map, SHADER_UNIFORM_INT, 1);
+    }
 
+    rlEnableVertexArray(mesh->vaoId);
+
+    // Point the per-instance attributes at this draw's slice of the ring
+    GLsizei const stride = sizeof(RenderInstance);
+    SZ const base        = first * sizeof(RenderInstance);
+    glBindBuffer(GL_ARRAY_BUFFER, g_render_instance_ring.buffer);
+    if (transform_loc >= 0) {
+        for (U32 column = 0; column < 4; ++column) {
+            U32 const loc = (U32)transform_loc + column;
+            glEnableVertexAttribArray(loc);
+            glVertexAttribPointer(loc, 4, GL_FLOAT, GL_FALSE, stride, (void *)(base + (column * 4 * sizeof(F32))));
+            glVertexAttribDivisor(loc, 1);
+        }
+    }
+    if (tint_loc >= 0) {
+        glEnableVertexAttribArray((U32)tint_loc);
+        glVertexAttribPointer((U32)tint_loc, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (void *)(base + offsetof(RenderInstance, tint)));
+        glVertexAttribDivisor((U32)tint_loc, 1);
+    }
 
-        Material *material = &model->base.materials[model->base.meshMaterial[i]];
+    if (mesh->indices) {
+        rlDrawVertexArrayElementsInstanced(0, mesh->triangleCount * 3, nullptr, (S32)instance_count);
+    } else {
+        rlDrawVertexArrayInstanced(0, mesh->vertexCount, (S32)instance_count);
+    }
 
-        // Temporarily assign instanced shader to material
-        Shader original_material_shader = material->shader;
-        material->shader = g_render.model_instanced_shader.shader->base;
+    // The VAO is shared with regular drawing, leave no instance attributes enabled on it
+    if (transform_loc >= 0) {
+        for (U32 column = 0; column < 4; ++column) { glDisableVertexAttribArray((U32)transform_loc + column); }
+    }
+    if (tint_loc >= 0) { glDisableVertexAttribArray((U32)tint_loc); }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    rlDisableVertexArray();
+
+    for (S32 map = 0; map < MAX_MATERIAL_MAPS; ++map) {
+        if (material->maps[map].texture.id == 0) { continue; }
+        rlActiveTextureSlot(map);
+        if (map == MATERIAL_MAP_IRRADIANCE || map == MATERIAL_MAP_PREFILTER || map == MATERIAL_MAP_CUBEMAP) {
+            rlDisableTextureCubemap();
+        } else {
+            rlDisableTexture();
+        }
+    }
 
-        // Use rlgl to draw with custom instance attributes
-        rlEnableShader(material->shader.id);
+    rlDisableShader();
+}
 
-        // Upload transforms (standard instancing)
-        rlEnableVertexArray(mesh->vaoId);
+// Packs the group into the instance ring once and draws every mesh of the model from that slice
+void static i_d3d_model_instanced_draw(AModel *model, Shader shader, S32 transform_loc, S32 tint_loc, Matrix *transforms, Color *tints, SZ instance_count) {
+    SZ first                  = 0;
+    RenderInstance *instances = render_instance_ring_alloc(&g_render_instance_ring, instance_count, &first);
+    if (!instances) { return; }
+    render_instance_pack(instances, transforms, tints, instance_count);
+    render_instance_ring_commit(&g_render_instance_ring, first, instance_count);
 
-        // Set up instance color buffer
-        U32 instance_color_buffer = rlLoadVertexBuffer(instance_colors, (S32)(instance_count * 4U) * (S32)sizeof(F32), false);
-        if (g_render.model_instanced_shader.instance_tint_loc >= 0) {
-            rlEnableVertexBuffer(instance_color_buffer);
-            rlSetVertexAttribute((U32)g_render.model_instanced_shader.instance_tint_loc, 4, RL_FLOAT, false, 0, 0);
-            rlSetVertexAttributeDivisor((U32)g_render.model_instanced_shader.instance_tint_loc, 1);  // 1 = per-instance
-            rlEnableVertexAttribute((U32)g_render.model_instanced_shader.instance_tint_loc);
-        }
+    for (S32 i = 0; i < model->base.meshCount; i++) {
+        i_d3d_draw_mesh_instanced(&model->base.meshes[i], &model->base.materials[model->base.meshMaterial[i]], shader, transform_loc, tint_loc, first, instance_count);
+    }
+}
 
-        // Draw with instancing (using Raylib's built-in transform instancing)
-        DrawMeshInstanced(*mesh, *material, transforms, (S32)instance_count);
+void static inline i_d3d_model_instanced_impl(AModel *model, Matrix *transforms, Color *tints, SZ instance_count) {
+    INCREMENT_DRAW_CALL;
 
-        // Cleanup
-        rlDisableVertexAttribute((U32)g_render.model_instanced_shader.instance_tint_loc);
-        rlDisableVertexBuffer();
-        rlDisableVertexArray();
-        rlUnloadVertexBuffer(instance_color_buffer);
+    RenderModelInstancedShader const *s = &g_render.model_instanced_shader;
 
-        // Restore original shader
-        material->shader = original_material_shader;
-    }
+    // Set view-projection matrix uniform
+    Matrix mat_view_proj = g_render.cameras.c3d.mat_view_proj;
+    SetShaderValueMatrix(s->shader->base, s->mvp_loc, mat_view_proj);
+
+    i_d3d_model_instanced_draw(model, s->shader->base, s->instance_transform_loc, s->instance_tint_loc, transforms, tints, instance_count);
 }
 
 void d3d_model_instanced(C8 const *model_name, Matrix *transforms, Color *tints, SZ instance_count) {
@@ -182,79 +222,33 @@ void d3d_model_instanced_by_hash(U32 model_name_hash, Matrix *transforms, Color
     i_d3d_model_instanced_impl(model, transforms, tints, instance_count);
 }
 
-void static inline i_d3d_model_animated_instanced_impl(AModel *model, Matrix *transforms, Color *tints, SZ instance_count, Matrix *bone_matrices, S32 bone_count) {
+void static inline i_d3d_model_animated_instanced_impl(AModel *model, Matrix *transforms, Color *tints, SZ instance_count, U32 const *palette_offsets, U32 bone_base) {
+    // Every instance fetches its own bones from the palette, see render_bone_palette.hpp
+    U32 instance_base = 0;
+    if (!render_bone_palette_upload_offsets(palette_offsets, instance_count, bone_base, &instance_base)) { return; }
+
     INCREMENT_DRAW_CALL;
 
+    RenderModelAnimatedInstancedShader const *s = &g_render.model_animated_instanced_shader;
+
     // Set view-projection matrix uniform
     Matrix mat_view_proj = g_render.cameras.c3d.mat_view_proj;
-    SetShaderValueMatrix(g_render.model_animated_instanced_shader.shader->base, g_render.model_animated_instanced_shader.mvp_loc, mat_view_proj);
-
-    // Convert colors to F32 array for GPU
-    F32 *instance_colors = mmta(F32 *, instance_count * 4 * sizeof(F32));
-    for (SZ j = 0; j < instance_count; ++j) {
-        instance_colors[(j * 4) + 0] = (F32)tints[j].r / 255.0F;
-        instance_colors[(j * 4) + 1] = (F32)tints[j].g / 255.0F;
-        instance_colors[(j * 4) + 2] = (F32)tints[j].b / 255.0F;
-        instance_colors[(j * 4) + 3] = (F32)tints[j].a / 255.0F;
-    }
-
-    // Draw each mesh with instancing
-    for (S32 i = 0; i < model->base.meshCount; i++) {
-        Mesh *mesh = &model->base.meshes[i];
-        Material *material = &model->base.materials[model->base.meshMaterial[i]];
-
-        // Temporarily set bone matrices on mesh (raylib will upload them automatically)
-        Matrix *original_bone_matrices = mesh->boneMatrices;
-        S32 original_bone_count = mesh->boneCount;
+    SetShaderValueMatrix(s->shader->base, s->mvp_loc, mat_view_proj);
+    S32 const palette_instance_base = (S32)instance_base;
+    SetShaderValue(s->shader->base, s->palette_instance_base_loc, &palette_instance_base, SHADER_UNIFORM_INT);
+    render_bone_palette_bind();
 
-        if (bone_matrices && mesh->boneIds && mesh->boneWeights) {
-            mesh->boneMatrices = bone_matrices;
-            mesh->boneCount = bone_count;
-        }
-
-        // Temporarily assign instanced shader to material
-        Shader original_material_shader = material->shader;
-        material->shader = g_render.model_animated_instanced_shader.shader->base;
-
-        // Use rlgl to draw with custom instance attributes
-        rlEnableShader(material->shader.id);
-
-        // Upload transforms (standard instancing)
-        rlEnableVertexArray(mesh->vaoId);
-
-        // Set up instance color buffer
-        U32 instance_color_buffer = rlLoadVertexBuffer(instance_colors, (S32)(instance_count * 4U) * (S32)sizeof(F32), false);
-        if (g_render.model_animated_instanced_shader.instance_tint_loc >= 0) {
-            rlEnableVertexBuffer(instance_color_buffer);
-            rlSetVertexAttribute((U32)g_render.model_animated_instanced_shader.instance_tint_loc, 4, RL_FLOAT, false, 0, 0);
-            rlSetVertexAttributeDivisor((U32)g_render.model_animated_instanced_shader.instance_tint_loc, 1);  // 1 = per-instance
-            rlEnableVertexAttribute((U32)g_render.model_animated_instanced_shader.instance_tint_loc);
-        }
-
-        // Draw with instancing (using Raylib's built-in transform instancing and bone matrix upload)
-        DrawMeshInstanced(*mesh, *material, transforms, (S32)instance_count);
-
-        // Cleanup
-        rlDisableVertexAttribute((U32)g_render.model_animated_instanced_shader.instance_tint_loc);
-        rlDisableVertexBuffer();
-        rlDisableVertexArray();
-        rlUnloadVertexBuffer(instance_color_buffer);
-
-        // Restore original shader and bone matrices
-        material->shader = original_material_shader;
-        mesh->boneMatrices = original_bone_matrices;
-        mesh->boneCount = original_bone_count;
-    }
+    i_d3d_model_instanced_draw(model, s->shader->base, s->instance_transform_loc, s->instance_tint_loc, transforms, tints, instance_count);
 }
 
-void d3d_model_animated_instanced(C8 const *model_name, Matrix *transforms, Color *tints, SZ instance_count, Matrix *bone_matrices, S32 bone_count) {
+void d3d_model_animated_instanced(C8 const *model_name, Matrix *transforms, Color *tints, SZ instance_count, U32 const *palette_offsets, U32 bone_base) {
     AModel *model = asset_get_model(model_name);
-    i_d3d_model_animated_instanced_impl(model, transforms, tints, instance_count, bone_matrices, bone_count);
+    i_d3d_model_animated_instanced_impl(model, transforms, tints, instance_count, palette_offsets, bone_base);
 }
 
-void d3d_model_animated_instanced_by_hash(U32 model_name_hash, Matrix *transforms, Color *tints, SZ instance_count, Matrix *bone_matrices, S32 bone_count) {
+void d3d_model_animated_instanced_by_hash(U32 model_name_hash, Matrix *transforms, Color *tints, SZ instance_count, U32 const *palette_offsets, U32 bone_base) {
     AModel *model = asset_get_model_by_hash(model_name_hash);
-    i_d3d_model_animated_instanced_impl(model, transforms, tints, instance_count, bone_matrices, bone_count);
+    i_d3d_model_animated_instanced_impl(model, transforms, tints, instance_count, palette_offsets, bone_base);
 }
 
 void static inline i_d3d_model_animated_impl(AModel *model, Vector3 position, Vector3 scale, F32 rotation, Color tint, Matrix *bone_matrices, S32 bone_count) {
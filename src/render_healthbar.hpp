@@ -4,12 +4,6 @@
 #include "world.hpp"
 
 #include <raylib.h>
-#include <tinycthread.h>
-
-// Need for tinycthread on macOS
-#ifdef call_once
-#undef call_once
-#endif
 
 fwd_decl(AShader);
 
@@ -36,12 +30,11 @@ struct RenderHealthbar {
 
     // State
     SZ count;  // Current number of healthbars to draw this frame
-    mtx_t count_mutex;  // Protects count for multithreaded adds
 };
 
 extern RenderHealthbar g_render_healthbar;
 
 void render_healthbar_init();
 void render_healthbar_clear();
-void render_healthbar_add(Vector2 screen_pos, Vector2 bar_size, F32 health_perc);
+void render_healthbar_add(Vector2 screen_pos, Vector2 bar_size, F32 health_perc);  // Main thread only, jobs push COMMAND_TYPE_HEALTHBAR
 void render_healthbar_draw();
@@ -0,0 +1,96 @@
+#include "render_instance_ring.hpp"
+#include "log.hpp"
+#include "memory.hpp"
+#include "std.hpp"
+
+#include <external/glad.h>
+
+RenderInstanceRing g_render_instance_ring = {};
+
+void render_instance_ring_init(RenderInstanceRing *ring) {
+    ring->region_capacity = RENDER_INSTANCE_RING_MAX_INSTANCES;
+    auto const size       = (GLsizeiptr)(sizeof(RenderInstance) * ring->region_capacity * RENDER_INSTANCE_RING_FRAME_COUNT);
+
+    glGenBuffers(1, &ring->buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, ring->buffer);
+
+#ifndef __APPLE__
+    // Same persistent mapping as the healthbar SSBO
+    GLbitfield const flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glBufferStorage(GL_ARRAY_BUFFER, size, nullptr, flags);
+    ring->mapped     = (RenderInstance *)glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags);
+    ring->persistent = true;
+#else
+    // No buffer storage on macOS, pack into a staging copy and upload each group with glBufferSubData
+    glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    ring->mapped     = mmpa(RenderInstance *, (SZ)size);
+    ring->persistent = false;
+#endif
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    if (!ring->mapped) {
+        lle("Failed to map instance ring buffer!");
+        return;
+    }
+
+    ring->region      = 0;
+    ring->count       = 0;
+    ring->initialized = true;
+    lli("Instance ring initialized (%d regions of %zu instances)", RENDER_INSTANCE_RING_FRAME_COUNT, ring->region_capacity);
+}
+
+void render_instance_ring_begin_frame(RenderInstanceRing *ring) {
+    if (!ring->initialized) { return; }
+
+    ring->region = (ring->region + 1) % RENDER_INSTANCE_RING_FRAME_COUNT;
+    ring->count  = 0;
+
+    // Only blocks when the CPU is RENDER_INSTANCE_RING_FRAME_COUNT frames ahead of the GPU
+    auto fence = (GLsync)ring->fences[ring->region];
+    if (fence) {
+        glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, U64_MAX);
+        glDeleteSync(fence);
+        ring->fences[ring->region] = nullptr;
+    }
+}
+
+void render_instance_ring_end_frame(RenderInstanceRing *ring) {
+    if (!ring->initialized) { return; }
+    if (ring->count == 0) { return; }
+
+    ring->fences[ring->region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+RenderInstance *render_instance_ring_alloc(RenderInstanceRing *ring, SZ count, SZ *out_first) {
+    if (!ring->initialized) { return nullptr; }
+    if (ring->count + count > ring->region_capacity) {
+        llw("Instance ring full, %zu instances do not fit (Max: %zu)", count, ring->region_capacity);
+        return nullptr;
+    }
+
+    SZ const first = (ring->region * ring->region_capacity) + ring->count;
+    ring->count   += count;
+    *out_first     = first;
+    return &ring->mapped[first];
+}
+
+void render_instance_ring_commit(RenderInstanceRing *ring, SZ first, SZ count) {
+    if (ring->persistent || count == 0) { return; }
+
+    glBindBuffer(GL_ARRAY_BUFFER, ring->buffer);
+    glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)(first * sizeof(RenderInstance)), (GLsizeiptr)(count * sizeof(RenderInstance)), &ring->mapped[first]);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void render_instance_pack(RenderInstance *dst, Matrix const *transforms, Color const *tints, SZ count) {
+    for (SZ i = 0; i < count; ++i) {
+        Matrix const *m = &transforms[i];
+        F32 *t          = dst[i].transform;
+        t[0]  = m->m0;  t[1]  = m->m1;  t[2]  = m->m2;  t[3]  = m->m3;
+        t[4]  = m->m4;  t[5]  = m->m5;  t[6]  = m->m6;  t[7]  = m->m7;
+        t[8]  = m->m8;  t[9]  = m->m9;  t[10] = m->m10; t[11] = m->m11;
+        t[12] = m->m12; t[13] = m->m13; t[14] = m->m14; t[15] = m->m15;
+        dst[i].tint = tints[i];
+    }
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "common.hpp"
+#include "world.hpp"
+
+#include <raylib.h>
+
+// Per-instance data for instanced model drawing (transform + tint), written once per group straight into one
+// persistently mapped vertex buffer and sub-allocated per draw. The buffer is split into
+// RENDER_INSTANCE_RING_FRAME_COUNT regions, one per frame in flight, each fenced once the frame has been submitted.
+
+#define RENDER_INSTANCE_RING_FRAME_COUNT 3
+#define RENDER_INSTANCE_RING_MAX_INSTANCES (WORLD_MAX_ENTITIES * 2)  // Per frame, every entity plus its backpack
+
+// Must match the instanceTransform/instanceTint attributes the instanced shaders read
+struct RenderInstance {
+    F32 transform[16];  // Column-major, the same as raylib's MatrixToFloatV
+    Color tint;         // Normalized by the attribute pointer, no float conversion needed
+};
+
+struct RenderInstanceRing {
+    BOOL initialized;
+    BOOL persistent;  // False where we stage in CPU memory and upload with glBufferSubData
+
+    // GPU data
+    U32 buffer;
+    RenderInstance *mapped;  // All regions, either the mapped buffer or the staging copy
+    void *fences[RENDER_INSTANCE_RING_FRAME_COUNT];  // GLsync
+
+    // State
+    U32 region;
+    SZ count;  // Instances handed out from the current region
+    SZ region_capacity;
+};
+
+extern RenderInstanceRing g_render_instance_ring;
+
+void render_instance_ring_init(RenderInstanceRing *ring);
+void render_instance_ring_begin_frame(RenderInstanceRing *ring);  // Waits until the GPU is done with the next region
+void render_instance_ring_end_frame(RenderInstanceRing *ring);
+// Returns nullptr if the region is full, out_first is the instance index to point the attributes at
+RenderInstance *render_instance_ring_alloc(RenderInstanceRing *ring, SZ count, SZ *out_first);
+void render_instance_ring_commit(RenderInstanceRing *ring, SZ first, SZ count);  // Uploads when not persistent
+void render_instance_pack(RenderInstance *dst, Matrix const *transforms, Color const *tints, SZ count);
@@ -88,9 +88,7 @@ void static i_reset_lights(void *data) {
 void static i_harvest_trees(void *data) {
     unused(data);
 
-    for (SZ idx = 0; idx < g_world->active_entity_count; ++idx) {
-        EID const i = g_world->active_entities[idx];
-        if (g_world->type[i] != ENTITY_TYPE_NPC) { continue; }
+    WORLD_LIST_EACH(&g_world->type_lists[ENTITY_TYPE_NPC], i) {
         entity_actor_start_looking_for_target(i, ENTITY_TYPE_VEGETATION);
     }
 }
@@ -98,22 +96,11 @@ void static i_harvest_trees(void *data) {
 void static i_gather_at_prop(void *data) {
     unused(data);
 
-    // Find first prop to gather at
-    EID prop_target = INVALID_EID;
-    for (SZ idx = 0; idx < g_world->active_entity_count; ++idx) {
-        EID const i = g_world->active_entities[idx];
-        if (g_world->type[i] == ENTITY_TYPE_PROP) {
-            prop_target = i;
-            break;
-        }
-    }
-
-    if (prop_target == INVALID_EID) { return; }
+    // Only gather if there is a prop to gather at
+    if (g_world->type_lists[ENTITY_TYPE_PROP].count == 0) { return; }
 
     // Command all NPCs to move near the prop from their current position
-    for (SZ idx = 0; idx < g_world->active_entity_count; ++idx) {
-        EID const i = g_world->active_entities[idx];
-        if (g_world->type[i] != ENTITY_TYPE_NPC) { continue; }
+    WORLD_LIST_EACH(&g_world->type_lists[ENTITY_TYPE_NPC], i) {
         entity_actor_start_looking_for_target(i, ENTITY_TYPE_PROP);
     }
 }
@@ -121,9 +108,7 @@ void static i_gather_at_prop(void *data) {
 void static i_just_chill(void *data) {
     unused(data);
 
-    for (SZ idx = 0; idx < g_world->active_entity_count; ++idx) {
-        EID const i = g_world->active_entities[idx];
-        if (g_world->type[i] != ENTITY_TYPE_NPC) { continue; }
+    WORLD_LIST_EACH(&g_world->type_lists[ENTITY_TYPE_NPC], i) {
         entity_actor_behavior_transition_to_state(i, ENTITY_BEHAVIOR_STATE_IDLE, "was told to chill");
     }
 }
@@ -131,15 +116,9 @@ void static i_just_chill(void *data) {
 void static i_attack_other_close_npc(void *data) {
     unused(data);
 
-    // First, collect all NPCs
-    EID npcs[WORLD_MAX_ENTITIES];
-    SZ npc_count = 0;
-
-    for (SZ idx = 0; idx < g_world->active_entity_count; ++idx) {
-        EID const i = g_world->active_entities[idx];
-        if (g_world->type[i] != ENTITY_TYPE_NPC) { continue; }
-        npcs[npc_count++] = i;
-    }
+    // The NPC list is already packed, no need to collect them first
+    EID const *npcs    = g_world->type_lists[ENTITY_TYPE_NPC].entities;
+    SZ const npc_count = g_world->type_lists[ENTITY_TYPE_NPC].count;
 
     // Need at least 2 NPCs to have attacking
     if (npc_count < 2) { return; }
@@ -217,14 +196,12 @@ void static i_test_3d_audio_moving(void *data) {
 
     // Find a random NPC and play a sound at its position
     BOOL found_npc = false;
-    for (SZ idx = 0; idx < g_world->active_entity_count && !found_npc; ++idx) {
-        EID const i = g_world->active_entities[idx];
-        if (g_world->type[i] != ENTITY_TYPE_NPC) { continue; }
-
+    WORLD_LIST_EACH(&g_world->type_lists[ENTITY_TYPE_NPC], i) {
         FMOD::Channel const *channel = audio_play_3d_at_entity(ACG_MUSIC, "haft.ogg", i);
         if (channel) {
             mi(TS("Playing 3D audio at NPC entity %u", i)->c, WHITE);
             found_npc = true;
+            break;
         }
     }
 
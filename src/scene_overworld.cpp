@@ -79,9 +79,7 @@ void static i_reset_lights(void *data) {
 void static i_harvest_trees(void *data) {
     unused(data);
 
-    for (SZ idx = 0; idx < g_world->active_entity_count; ++idx) {
-        EID const i = g_world->active_entities[idx];
-        if (g_world->type[i] != ENTITY_TYPE_NPC) { continue; }
+    WORLD_LIST_EACH(&g_world->type_lists[ENTITY_TYPE_NPC], i) {
         entity_actor_start_looking_for_target(i, ENTITY_TYPE_VEGETATION);
     }
 }
@@ -89,9 +87,7 @@ void static i_harvest_trees(void *data) {
 void static i_just_chill(void *data) {
     unused(data);
 
-    for (SZ idx = 0; idx < g_world->active_entity_count; ++idx) {
-        EID const i = g_world->active_entities[idx];
-        if (g_world->type[i] != ENTITY_TYPE_NPC) { continue; }
+    WORLD_LIST_EACH(&g_world->type_lists[ENTITY_TYPE_NPC], i) {
         entity_actor_behavior_transition_to_state(i, ENTITY_BEHAVIOR_STATE_IDLE, "was told to chill");
     }
 }
@@ -106,9 +102,7 @@ void static i_go_random_position(void *data) {
 
     mqf("Ordering all cesiums to walk to [%.1f, %.1f, %.1f]", pos.x, pos.y, pos.z);
 
-    for (SZ idx = 0; idx < g_world->active_entity_count; ++idx) {
-        EID const i = g_world->active_entities[idx];
-        if (g_world->type[i] != ENTITY_TYPE_NPC) { continue; }
+    WORLD_LIST_EACH(&g_world->type_lists[ENTITY_TYPE_NPC], i) {
         entity_actor_set_move_target(i, pos);
     }
 }
@@ -116,15 +110,9 @@ void static i_go_random_position(void *data) {
 void static i_attack_other_close_npc(void *data) {
     unused(data);
 
-    // First, collect all NPCs
-    EID npcs[WORLD_MAX_ENTITIES];
-    SZ npc_count = 0;
-
-    for (SZ idx = 0; idx < g_world->active_entity_count; ++idx) {
-        EID const i = g_world->active_entities[idx];
-        if (g_world->type[i] != ENTITY_TYPE_NPC) { continue; }
-        npcs[npc_count++] = i;
-    }
+    // The NPC list is already packed, no need to collect them first
+    EID const *npcs    = g_world->type_lists[ENTITY_TYPE_NPC].entities;
+    SZ const npc_count = g_world->type_lists[ENTITY_TYPE_NPC].count;
 
     // Need at least 2 NPCs to have attacking
     if (npc_count < 2) { return; }
@@ -202,14 +190,12 @@ void static i_test_3d_audio_moving(void *data) {
 
     // Find a random NPC and play a sound at its position
     BOOL found_npc = false;
-    for (SZ idx = 0; idx < g_world->active_entity_count && !found_npc; ++idx) {
-        EID const i = g_world->active_entities[idx];
-        if (g_world->type[i] != ENTITY_TYPE_NPC) { continue; }
-
+    WORLD_LIST_EACH(&g_world->type_lists[ENTITY_TYPE_NPC], i) {
         FMOD::Channel const *channel = audio_play_3d_at_entity(ACG_MUSIC, "haft.ogg", i);
         if (channel) {
             mi(TS("Playing 3D audio at NPC entity %u", i)->c, WHITE);
             found_npc = true;
+            break;
         }
     }
 
@@ -1,6 +1,10 @@
 #include "test.hpp"
 #include "common.hpp"
+#include "grid.hpp"
 #include "log.hpp"
+#include "memory.hpp"
+#include "std.hpp"
+#include "world.hpp"
 
 #include <unity.h>
 
@@ -11,14 +15,27 @@ void tearDown() {}
 BOOL test_run() {
     UNITY_BEGIN();
 
+    test_actor();
     test_array();
+    test_audio();
+    test_command();
+    test_dungeon();
+    test_grid();
     test_ini();
+    test_job();
     test_map();
+    test_math();
+    test_nav();
+    test_memory();
     test_ouc();
+    test_particles();
+    test_render();
     test_ring();
     test_runtime();
     test_string();
+    test_terrain();
     test_unit();
+    test_world();
 
     S32 const result = UNITY_END();
     if (result == 0) {
@@ -29,3 +46,40 @@ BOOL test_run() {
 
     return result == 0;
 }
+
+// Permanent so it survives the transient resets between runs of the tests from the console
+World static *i_test_saved_world   = nullptr;
+World static *i_test_scratch_world = nullptr;
+
+void test_scratch_world_begin() {
+    if (!i_test_scratch_world) { i_test_scratch_world = mmpa(World *, sizeof(World)); }
+    ou_memset(i_test_scratch_world, 0, sizeof(World));
+
+    i_test_saved_world = g_world;
+    g_world            = i_test_scratch_world;
+}
+
+void test_scratch_world_end() {
+    g_world = i_test_saved_world;
+    grid_clear();
+}
+
+void test_spawn_entity(EID id, EntityType type, Vector3 position, U32 flags) {
+    g_world->flags[id] |= ENTITY_FLAG_MASK(ENTITY_FLAG_IN_USE) | flags;
+    g_world->generation[id]++;
+    g_world->type[id]                     = type;
+    g_world->position[id]                 = position;
+    g_world->actor[id].behavior.target_id = INVALID_EID;
+    world_register_entity(id);
+}
+
+U32 test_hash(U32 seed) {
+    return seed * 2654435761U;
+}
+
+Vector3 test_scatter_position(U32 seed, F32 width, F32 depth) {
+    U32 const hash = test_hash(seed);
+    F32 const x    = (F32)(hash & 0xFFFF) / 65536.0F;
+    F32 const z    = (F32)(hash >> 16) / 65536.0F;
+    return {x * width, 0.0F, z * depth};
+}
@@ -1,13 +1,38 @@
 #pragma once
 
 #include "common.hpp"
+#include "entity.hpp"
+
+#include <raylib.h>
 
 BOOL test_run();
+void test_actor();
 void test_array();
+void test_audio();
+void test_command();
+void test_dungeon();
+void test_grid();
 void test_ini();
+void test_job();
 void test_map();
+void test_math();
+void test_nav();
+void test_memory();
 void test_ouc();
+void test_particles();
+void test_render();
 void test_ring();
 void test_runtime();
 void test_string();
+void test_terrain();
 void test_unit();
+void test_world();
+
+// Shared by the suites. Systems that work on g_world run against a zeroed scratch World between begin and end,
+// end puts the real one back and clears the grid so it gets rebuilt for it on the next grid_populate.
+void test_scratch_world_begin();
+void test_scratch_world_end();
+// Registers a live entity the way entity_create would, without assets or components. flags come on top of IN_USE.
+void test_spawn_entity(EID id, EntityType type, Vector3 position, U32 flags);
+U32 test_hash(U32 seed);                                        // Cheap deterministic scatter, Knuth's multiplicative hash
+Vector3 test_scatter_position(U32 seed, F32 width, F32 depth);  // Somewhere in [0, width) x [0, depth) on y 0
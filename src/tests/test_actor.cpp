@@ -0,0 +1,234 @@
+#include "entity_actor.hpp"
+#include "entity.hpp"
+#include "grid.hpp"
+#include "job.hpp"
+#include "log.hpp"
+#include "nav.hpp"
+#include "test.hpp"
+#include "time.hpp"
+#include "unit.hpp"
+#include "world.hpp"
+
+#include <raymath.h>
+#include <unity.h>
+
+#define TEST_ACTOR_BENCH_TREE_COUNT 4000
+#define TEST_ACTOR_BENCH_ITERATIONS 5
+
+Vector3 static i_test_actor_cell_position(S32 x, S32 y) {
+    return grid_cell_center(grid_get_cell_index_xy(x, y));
+}
+
+Vector3 static i_test_actor_scattered_position(U32 seed) {
+    return test_scatter_position(seed, g_grid.terrain_size.x, g_grid.terrain_size.y);
+}
+
+// Every NPC of these tests is a harvester
+void static i_test_actor_spawn(EID id, EntityType type, Vector3 position) {
+    test_spawn_entity(id, type, position, type == ENTITY_TYPE_NPC ? ENTITY_FLAG_MASK(ENTITY_FLAG_ACTOR) : 0U);
+}
+
+void static i_test_actor_request(EID id, EntityType target_type) {
+    g_world->actor[id].behavior.target_entity_type = target_type;
+    entity_actor_request_target(id, "Test");
+}
+
+void static test_actor_assign_targets_follower_limit() {
+    test_scratch_world_begin();
+
+    // 4 trees and 20 harvesters in the same spot, only 4 * HARVEST_TARGET_MAX_FOLLOWERS of them get a tree
+    EID const tree_first = 100;
+    for (EID i = 0; i < 4; ++i) { i_test_actor_spawn(tree_first + i, ENTITY_TYPE_VEGETATION, i_test_actor_cell_position(20 + (S32)i, 20)); }
+    for (EID i = 0; i < 20; ++i) { i_test_actor_spawn(i, ENTITY_TYPE_NPC, i_test_actor_cell_position(21, 21)); }
+    grid_rebuild();
+
+    for (EID i = 0; i < 20; ++i) { i_test_actor_request(i, ENTITY_TYPE_VEGETATION); }
+    TEST_ASSERT_EQUAL_UINT64(20, entity_actor_assign_targets());
+
+    SZ going = 0;
+    for (EID i = 0; i < 20; ++i) {
+        EntityBehaviorController const *behavior = &g_world->actor[i].behavior;
+        TEST_ASSERT_FALSE(behavior->target_requested);
+        if (behavior->state == ENTITY_BEHAVIOR_STATE_GOING_TO_TARGET) {
+            TEST_ASSERT_TRUE(behavior->target_id >= tree_first && behavior->target_id < tree_first + 4);
+            going++;
+        } else {
+            TEST_ASSERT_EQUAL_INT(ENTITY_BEHAVIOR_STATE_IDLE, behavior->state);
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT64(4 * HARVEST_TARGET_MAX_FOLLOWERS, going);
+    for (EID i = 0; i < 4; ++i) { TEST_ASSERT_EQUAL_INT(HARVEST_TARGET_MAX_FOLLOWERS, world_followed_by_count(tree_first + i)); }
+    TEST_ASSERT_TRUE(world_target_tracker_validate());
+
+    // Nothing pending, nothing to do
+    TEST_ASSERT_EQUAL_UINT64(0, entity_actor_assign_targets());
+
+    test_scratch_world_end();
+}
+
+void static test_actor_assign_targets_nearest_and_fallback() {
+    test_scratch_world_begin();
+
+    i_test_actor_spawn(0, ENTITY_TYPE_NPC, i_test_actor_cell_position(50, 50));
+    i_test_actor_spawn(1, ENTITY_TYPE_VEGETATION, i_test_actor_cell_position(60, 50));
+    i_test_actor_spawn(2, ENTITY_TYPE_VEGETATION, i_test_actor_cell_position(52, 51));
+    i_test_actor_spawn(3, ENTITY_TYPE_BUILDING_LUMBERYARD, i_test_actor_cell_position(40, 40));
+    grid_rebuild();
+
+    i_test_actor_request(0, ENTITY_TYPE_VEGETATION);
+    entity_actor_assign_targets();
+    TEST_ASSERT_EQUAL_INT(ENTITY_BEHAVIOR_STATE_GOING_TO_TARGET, g_world->actor[0].behavior.state);
+    TEST_ASSERT_EQUAL_INT(2, g_world->actor[0].behavior.target_id);
+
+    // No trees left but wood to deliver, the same pass falls back to the lumberyard
+    for (EID const tree : {(EID)1, (EID)2}) {
+        grid_remove_entity(tree);
+        g_world->flags[tree] = 0;
+    }
+    g_world->actor[0].behavior.wood_count = 1;
+    i_test_actor_request(0, ENTITY_TYPE_VEGETATION);
+    entity_actor_assign_targets();
+    TEST_ASSERT_EQUAL_INT(ENTITY_BEHAVIOR_STATE_GOING_TO_TARGET, g_world->actor[0].behavior.state);
+    TEST_ASSERT_EQUAL_INT(ENTITY_TYPE_BUILDING_LUMBERYARD, g_world->actor[0].behavior.target_entity_type);
+    TEST_ASSERT_EQUAL_INT(3, g_world->actor[0].behavior.target_id);
+
+    test_scratch_world_end();
+}
+
+void static test_actor_assign_targets_contention_is_deterministic() {
+    test_scratch_world_begin();
+
+    // One tree, the far harvesters got spawned first and two pairs stand equally close
+    EID const tree = 200;
+    i_test_actor_spawn(tree, ENTITY_TYPE_VEGETATION, i_test_actor_cell_position(40, 40));
+    i_test_actor_spawn(9, ENTITY_TYPE_NPC, i_test_actor_cell_position(40, 44));
+    i_test_actor_spawn(8, ENTITY_TYPE_NPC, i_test_actor_cell_position(40, 43));
+    i_test_actor_spawn(7, ENTITY_TYPE_NPC, i_test_actor_cell_position(40, 42));
+    i_test_actor_spawn(6, ENTITY_TYPE_NPC, i_test_actor_cell_position(40, 42));
+    i_test_actor_spawn(5, ENTITY_TYPE_NPC, i_test_actor_cell_position(40, 41));
+    i_test_actor_spawn(4, ENTITY_TYPE_NPC, i_test_actor_cell_position(40, 41));
+    grid_rebuild();
+
+    for (EID i = 4; i <= 9; ++i) { i_test_actor_request(i, ENTITY_TYPE_VEGETATION); }
+    entity_actor_assign_targets();
+
+    // The nearest ones win, between equally close ones the lower id
+    for (EID const winner : {(EID)4, (EID)5, (EID)6}) { TEST_ASSERT_EQUAL_INT(tree, g_world->actor[winner].behavior.target_id); }
+    for (EID const loser : {(EID)7, (EID)8, (EID)9}) { TEST_ASSERT_EQUAL_INT(ENTITY_BEHAVIOR_STATE_IDLE, g_world->actor[loser].behavior.state); }
+    TEST_ASSERT_TRUE(world_target_tracker_validate());
+
+    test_scratch_world_end();
+}
+
+void static test_actor_follower_counts_follow_destruction() {
+    test_scratch_world_begin();
+
+    // 4 harvesters, the near tree takes 3 of them and the far one the rest
+    i_test_actor_spawn(10, ENTITY_TYPE_VEGETATION, i_test_actor_cell_position(30, 30));
+    i_test_actor_spawn(11, ENTITY_TYPE_VEGETATION, i_test_actor_cell_position(35, 30));
+    for (EID i = 0; i < 4; ++i) { i_test_actor_spawn(i, ENTITY_TYPE_NPC, i_test_actor_cell_position(30, 31)); }
+    grid_rebuild();
+
+    for (EID i = 0; i < 4; ++i) { i_test_actor_request(i, ENTITY_TYPE_VEGETATION); }
+    entity_actor_assign_targets();
+    TEST_ASSERT_EQUAL_INT(HARVEST_TARGET_MAX_FOLLOWERS, world_followed_by_count(10));
+    TEST_ASSERT_EQUAL_INT(1, world_followed_by_count(11));
+
+    // Follower destroyed
+    EID const follower = g_world->target_trackers[10].actors[0].load() - 1;
+    entity_destroy(follower);
+    TEST_ASSERT_EQUAL_INT(HARVEST_TARGET_MAX_FOLLOWERS - 1, world_followed_by_count(10));
+    TEST_ASSERT_TRUE(world_target_tracker_validate());
+
+    // Target destroyed, its followers let go and ask for a new one
+    world_notify_actors_target_destroyed(10);
+    entity_destroy(10);
+    TEST_ASSERT_EQUAL_INT(0, world_followed_by_count(10));
+    TEST_ASSERT_TRUE(world_target_tracker_validate());
+
+    // The survivors end up at the far tree next to the one that was already there
+    entity_actor_assign_targets();
+    TEST_ASSERT_EQUAL_INT(HARVEST_TARGET_MAX_FOLLOWERS, world_followed_by_count(11));
+    TEST_ASSERT_TRUE(world_target_tracker_validate());
+
+    // Switching targets releases the old one
+    EID const switcher = g_world->target_trackers[11].actors[0].load() - 1;
+    entity_actor_clear_actor_target(switcher);
+    TEST_ASSERT_EQUAL_INT(HARVEST_TARGET_MAX_FOLLOWERS - 1, world_followed_by_count(11));
+    TEST_ASSERT_TRUE(world_target_tracker_validate());
+
+    test_scratch_world_end();
+}
+
+void static test_actor_request_paths_retries_when_pool_is_full() {
+    test_scratch_world_begin();
+
+    // Open headless graph, every request slot already taken by someone else
+    Nav *nav = &g_world->nav;
+    nav_reset(nav);
+    nav_set_graph(nav, 64, 64, 2.0F, {0.0F, 0.0F}, nav, MEMORY_TYPE_ARENA_TRANSIENT);
+    for (U32 i = 0; i < NAV_REQUEST_MAX; ++i) { nav_request_path(nav, {2.0F, 0.0F, 2.0F}, {120.0F, 0.0F, 120.0F}); }
+    TEST_ASSERT_EQUAL_UINT32(0, nav->free_count);
+
+    i_test_actor_spawn(0, ENTITY_TYPE_NPC, {4.0F, 0.0F, 4.0F});
+    EntityMovementController *movement = &g_world->actor[0].movement;
+    movement->goal_type                = ENTITY_MOVEMENT_GOAL_MOVE_TO_POSITION;
+    movement->target_position          = {100.0F, 0.0F, 100.0F};
+    movement->target_id                = INVALID_EID;
+    movement->path_requested           = true;
+
+    // No slot, the actor keeps asking instead of giving up on the path
+    TEST_ASSERT_EQUAL_UINT64(0, entity_actor_request_paths());
+    TEST_ASSERT_EQUAL_UINT32(NAV_INVALID_HANDLE, movement->path);
+    TEST_ASSERT_TRUE(movement->path_requested);
+    TEST_ASSERT_EQUAL_UINT64(0, entity_actor_request_paths());
+    TEST_ASSERT_TRUE(movement->path_requested);
+
+    // Once the slots are back the next frame gets one
+    nav_reset(nav);
+    TEST_ASSERT_EQUAL_UINT64(1, entity_actor_request_paths());
+    TEST_ASSERT_NOT_EQUAL(NAV_INVALID_HANDLE, movement->path);
+    TEST_ASSERT_FALSE(movement->path_requested);
+
+    test_scratch_world_end();
+}
+
+void static test_actor_assign_targets_performance_benchmark() {
+    C8 pretty_buffer[PRETTY_BUFFER_SIZE] = {};
+    U32 const request_counts[]           = {100, 500, 1000, 2500, 5000};
+
+    for (U32 const request_count : request_counts) {
+        F64 total_time = 0.0;
+        for (U32 iteration = 0; iteration < TEST_ACTOR_BENCH_ITERATIONS; ++iteration) {
+            test_scratch_world_begin();
+            for (EID i = 0; i < request_count; ++i) { i_test_actor_spawn(i, ENTITY_TYPE_NPC, i_test_actor_scattered_position(i)); }
+            for (EID i = 0; i < TEST_ACTOR_BENCH_TREE_COUNT; ++i) {
+                i_test_actor_spawn(request_count + i, ENTITY_TYPE_VEGETATION, i_test_actor_scattered_position(request_count + i));
+            }
+            grid_rebuild();
+
+            // Everyone got told to harvest in the same frame
+            for (EID i = 0; i < request_count; ++i) { i_test_actor_request(i, ENTITY_TYPE_VEGETATION); }
+
+            F64 const start_time = time_get_glfw_f64();
+            TEST_ASSERT_EQUAL_UINT64(request_count, entity_actor_assign_targets());
+            total_time += time_get_glfw_f64() - start_time;
+
+            test_scratch_world_end();
+        }
+
+        F64 const frame_time = total_time / TEST_ACTOR_BENCH_ITERATIONS;
+        unit_to_pretty_prefix_f("req/s", (F64)request_count / frame_time, pretty_buffer, PRETTY_BUFFER_SIZE, UNIT_PREFIX_KILO);
+        lli("Target assignment: %u requests against %d trees on %u threads in %.3fms (%s)", request_count, TEST_ACTOR_BENCH_TREE_COUNT,
+            job_system_get_thread_count(), frame_time * 1e3, pretty_buffer);
+    }
+}
+
+void test_actor() {
+    RUN_TEST(test_actor_assign_targets_follower_limit);
+    RUN_TEST(test_actor_assign_targets_nearest_and_fallback);
+    RUN_TEST(test_actor_assign_targets_contention_is_deterministic);
+    RUN_TEST(test_actor_follower_counts_follow_destruction);
+    RUN_TEST(test_actor_request_paths_retries_when_pool_is_full);
+    RUN_TEST(test_actor_assign_targets_performance_benchmark);
+}
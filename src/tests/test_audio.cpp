@@ -0,0 +1,184 @@
+#include "audio_voice.hpp"
+#include "log.hpp"
+#include "math.hpp"
+#include "memory.hpp"
+#include "test.hpp"
+#include "time.hpp"
+#include "unit.hpp"
+
+#include <raymath.h>
+#include <unity.h>
+
+#define TEST_AUDIO_REAL_MAX 4
+#define TEST_AUDIO_SOUND_LIMIT 8
+#define TEST_AUDIO_SOUND_CHOP 1
+#define TEST_AUDIO_SOUND_OTHER 2
+#define TEST_AUDIO_DT (1.0F / 60.0F)
+#define TEST_AUDIO_BENCH_NPC_COUNT 500
+#define TEST_AUDIO_BENCH_CHOPS_PER_SECOND 2.0F
+#define TEST_AUDIO_BENCH_SECONDS 10
+#define TEST_AUDIO_BENCH_REAL_MAX 64
+
+// Voices only go through the null backend, the sound ids do not have to be interned
+AudioVoiceManager static *i_test_audio_manager(U32 real_max) {
+    auto *mgr = mmta(AudioVoiceManager *, sizeof(AudioVoiceManager));
+    audio_voice_init(mgr, audio_voice_null_backend(), real_max, TEST_AUDIO_SOUND_LIMIT);
+    return mgr;
+}
+
+Vector3 static i_test_audio_at(F32 distance) {
+    return {distance, 0.0F, 0.0F};
+}
+
+void static test_audio_voice_sound_limit_steals_lowest() {
+    AudioVoiceManager *mgr = i_test_audio_manager(TEST_AUDIO_SOUND_LIMIT * 2);
+
+    // Fill the limit from far away, another far chop loses against all of them
+    for (U32 i = 0; i < TEST_AUDIO_SOUND_LIMIT; ++i) {
+        TEST_ASSERT_NOT_EQUAL(AUDIO_INVALID_HANDLE, audio_voice_play(mgr, TEST_AUDIO_SOUND_CHOP, ACG_SFX, true, false, i_test_audio_at(100.0F + (F32)i)));
+    }
+    TEST_ASSERT_EQUAL(AUDIO_INVALID_HANDLE, audio_voice_play(mgr, TEST_AUDIO_SOUND_CHOP, ACG_SFX, true, false, i_test_audio_at(150.0F)));
+    TEST_ASSERT_EQUAL_UINT64(1, audio_voice_get_stats(mgr).rejected);
+
+    // A close one replaces the farthest, other sounds are not affected by the chop limit
+    AudioHandle const close = audio_voice_play(mgr, TEST_AUDIO_SOUND_CHOP, ACG_SFX, true, false, i_test_audio_at(1.0F));
+    TEST_ASSERT_NOT_NULL(audio_voice_get(mgr, close));
+    TEST_ASSERT_EQUAL_UINT64(1, audio_voice_get_stats(mgr).stolen);
+    TEST_ASSERT_EQUAL_UINT16(TEST_AUDIO_SOUND_LIMIT, mgr->sound_count[TEST_AUDIO_SOUND_CHOP]);
+    TEST_ASSERT_NOT_EQUAL(AUDIO_INVALID_HANDLE, audio_voice_play(mgr, TEST_AUDIO_SOUND_OTHER, ACG_SFX, true, false, i_test_audio_at(150.0F)));
+
+    for (AudioVoice const &voice : mgr->voices) {
+        if (voice.state != AUDIO_VOICE_STATE_FREE) { TEST_ASSERT_TRUE(voice.position.x < 107.5F || voice.sound_id == TEST_AUDIO_SOUND_OTHER); }
+    }
+}
+
+void static test_audio_voice_group_limit_and_priority() {
+    AudioVoiceManager *mgr = i_test_audio_manager(TEST_AUDIO_REAL_MAX);
+    audio_voice_set_group_limit(mgr, ACG_SFX, 2, 100);
+    audio_voice_set_group_limit(mgr, ACG_VOICE, 2, 150);
+    audio_voice_set_sound_limit(mgr, TEST_AUDIO_SOUND_CHOP, 16);
+
+    audio_voice_play(mgr, TEST_AUDIO_SOUND_CHOP, ACG_SFX, true, false, i_test_audio_at(1.0F));
+    audio_voice_play(mgr, TEST_AUDIO_SOUND_CHOP, ACG_SFX, true, false, i_test_audio_at(2.0F));
+    TEST_ASSERT_EQUAL(AUDIO_INVALID_HANDLE, audio_voice_play(mgr, TEST_AUDIO_SOUND_CHOP, ACG_SFX, true, false, i_test_audio_at(1.0F)));
+    TEST_ASSERT_EQUAL_UINT16(2, mgr->group_count[ACG_SFX]);
+
+    // Fill the channels with higher priority voices, even a far one pushes the close SFX out of its channel
+    audio_voice_play(mgr, TEST_AUDIO_SOUND_OTHER, ACG_VOICE, true, false, i_test_audio_at(50.0F));
+    audio_voice_play(mgr, TEST_AUDIO_SOUND_OTHER, ACG_VOICE, true, false, i_test_audio_at(60.0F));
+    audio_voice_play(mgr, TEST_AUDIO_SOUND_OTHER, ACG_MUSIC, false, true, {});
+    AudioVoiceStats const stats = audio_voice_get_stats(mgr);
+    TEST_ASSERT_EQUAL_UINT32(TEST_AUDIO_REAL_MAX, stats.real_count);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.virtual_count);
+
+    for (AudioVoice const &voice : mgr->voices) {
+        if (voice.state == AUDIO_VOICE_STATE_VIRTUAL) { TEST_ASSERT_EQUAL_INT(ACG_SFX, voice.group); }
+    }
+}
+
+void static test_audio_voice_distance_culling() {
+    AudioVoiceManager *mgr = i_test_audio_manager(TEST_AUDIO_REAL_MAX);
+
+    // Nobody hears a one-shot out of range, a loop might come into range later
+    TEST_ASSERT_EQUAL(AUDIO_INVALID_HANDLE, audio_voice_play(mgr, TEST_AUDIO_SOUND_CHOP, ACG_SFX, true, false, i_test_audio_at(AUDIO_3D_MAX_DISTANCE + 1.0F)));
+    TEST_ASSERT_EQUAL_UINT64(1, audio_voice_get_stats(mgr).culled);
+
+    AudioHandle const loop = audio_voice_play(mgr, TEST_AUDIO_SOUND_OTHER, ACG_AMBIENCE, true, true, i_test_audio_at(AUDIO_3D_MAX_DISTANCE + 1.0F));
+    TEST_ASSERT_EQUAL_INT(AUDIO_VOICE_STATE_VIRTUAL, audio_voice_get(mgr, loop)->state);
+
+    audio_voice_update(mgr, TEST_AUDIO_DT, i_test_audio_at(AUDIO_3D_MAX_DISTANCE));
+    TEST_ASSERT_EQUAL_INT(AUDIO_VOICE_STATE_REAL, audio_voice_get(mgr, loop)->state);
+
+    // Audibility falls off with distance and stays in range
+    TEST_ASSERT_EQUAL_FLOAT(1.0F, audio_voice_audibility(mgr, mgr->listener));
+    F32 const near = audio_voice_audibility(mgr, Vector3Add(mgr->listener, i_test_audio_at(10.0F)));
+    F32 const far  = audio_voice_audibility(mgr, Vector3Add(mgr->listener, i_test_audio_at(100.0F)));
+    TEST_ASSERT_TRUE(near > far && far > 0.0F && near < 1.0F);
+}
+
+void static test_audio_voice_virtual_voices_follow_listener() {
+    AudioVoiceManager *mgr = i_test_audio_manager(TEST_AUDIO_REAL_MAX);
+    audio_voice_set_sound_limit(mgr, TEST_AUDIO_SOUND_OTHER, 16);
+
+    // Loops spread along x, only the ones closest to the listener get a channel
+    AudioHandle handles[12] = {};
+    for (U32 i = 0; i < 12; ++i) { handles[i] = audio_voice_play(mgr, TEST_AUDIO_SOUND_OTHER, ACG_SFX, true, true, i_test_audio_at((F32)i * 10.0F)); }
+    audio_voice_update(mgr, TEST_AUDIO_DT, {});
+    for (U32 i = 0; i < 12; ++i) { TEST_ASSERT_EQUAL_INT(i < TEST_AUDIO_REAL_MAX ? AUDIO_VOICE_STATE_REAL : AUDIO_VOICE_STATE_VIRTUAL, audio_voice_get(mgr, handles[i])->state); }
+
+    // Walk to the other end, the channels move with us and nothing got lost on the way
+    audio_voice_update(mgr, TEST_AUDIO_DT, i_test_audio_at(110.0F));
+    for (U32 i = 0; i < 12; ++i) { TEST_ASSERT_EQUAL_INT(i >= 12 - TEST_AUDIO_REAL_MAX ? AUDIO_VOICE_STATE_REAL : AUDIO_VOICE_STATE_VIRTUAL, audio_voice_get(mgr, handles[i])->state); }
+    AudioVoiceStats const stats = audio_voice_get_stats(mgr);
+    TEST_ASSERT_EQUAL_UINT32(TEST_AUDIO_REAL_MAX, stats.real_count);
+    TEST_ASSERT_EQUAL_UINT32(12 - TEST_AUDIO_REAL_MAX, stats.virtual_count);
+    TEST_ASSERT_TRUE(stats.devirtualized >= TEST_AUDIO_REAL_MAX);
+}
+
+void static test_audio_voice_one_shots_end() {
+    AudioVoiceManager *mgr = i_test_audio_manager(1);
+
+    // One real and one virtual one-shot, both have to end after the length of the sound
+    AudioHandle const a = audio_voice_play(mgr, TEST_AUDIO_SOUND_CHOP, ACG_SFX, true, false, i_test_audio_at(1.0F));
+    AudioHandle const b = audio_voice_play(mgr, TEST_AUDIO_SOUND_CHOP, ACG_SFX, true, false, i_test_audio_at(2.0F));
+    TEST_ASSERT_EQUAL_UINT32(1, audio_voice_get_stats(mgr).virtual_count);
+
+    audio_voice_update(mgr, AUDIO_VOICE_NULL_SOUND_LENGTH * 0.5F, {});
+    TEST_ASSERT_NOT_NULL(audio_voice_get(mgr, a));
+    TEST_ASSERT_NOT_NULL(audio_voice_get(mgr, b));
+
+    audio_voice_update(mgr, AUDIO_VOICE_NULL_SOUND_LENGTH * 0.5F, {});
+    TEST_ASSERT_NULL(audio_voice_get(mgr, a));
+    TEST_ASSERT_NULL(audio_voice_get(mgr, b));
+    TEST_ASSERT_EQUAL_UINT16(0, mgr->sound_count[TEST_AUDIO_SOUND_CHOP]);
+    TEST_ASSERT_EQUAL_UINT32(AUDIO_VOICE_MAX, mgr->free_count);
+}
+
+// 500 harvesters chopping around the listener, what the voice manager has to chew through in the worst case
+void static test_audio_voice_performance_benchmark() {
+    C8 pretty_buffer[PRETTY_BUFFER_SIZE] = {};
+    AudioVoiceManager *mgr                = i_test_audio_manager(TEST_AUDIO_BENCH_REAL_MAX);
+
+    U32 const frame_count = (U32)(TEST_AUDIO_BENCH_SECONDS / TEST_AUDIO_DT);
+    F32 const chance      = TEST_AUDIO_BENCH_CHOPS_PER_SECOND * TEST_AUDIO_DT;
+    U32 max_real          = 0;
+    U32 max_chops         = 0;
+    U64 requests          = 0;
+    U32 seed              = 1337;
+
+    F64 const start_time = time_get_glfw_f64();
+    for (U32 frame = 0; frame < frame_count; ++frame) {
+        for (U32 npc = 0; npc < TEST_AUDIO_BENCH_NPC_COUNT; ++npc) {
+            seed = (seed * 1664525U) + 1013904223U;
+            if ((F32)(seed >> 8) / (F32)(1U << 24) >= chance) { continue; }
+
+            F32 const angle = (F32)npc * 0.37F;
+            F32 const dist  = 5.0F + (F32)(npc % 100) * 3.0F;
+            audio_voice_play(mgr, TEST_AUDIO_SOUND_CHOP, ACG_SFX, true, false, {math_cos_f32(angle) * dist, 0.0F, math_sin_f32(angle) * dist});
+            requests++;
+        }
+        audio_voice_update(mgr, TEST_AUDIO_DT, {});
+
+        AudioVoiceStats const stats = audio_voice_get_stats(mgr);
+        max_real                    = glm::max(max_real, stats.real_count);
+        max_chops                   = glm::max(max_chops, (U32)mgr->sound_count[TEST_AUDIO_SOUND_CHOP]);
+    }
+    F64 const elapsed = time_get_glfw_f64() - start_time;
+
+    TEST_ASSERT_TRUE(max_real <= TEST_AUDIO_BENCH_REAL_MAX);
+    TEST_ASSERT_TRUE(max_chops <= TEST_AUDIO_SOUND_LIMIT);
+
+    AudioVoiceStats const stats = audio_voice_get_stats(mgr);
+    unit_to_pretty_prefix_f("req/s", (F64)requests / elapsed, pretty_buffer, PRETTY_BUFFER_SIZE, UNIT_PREFIX_MEGA);
+    lli("Audio voices: %" PRIu64 " requests from %d NPCs over %u frames in %.8fs (%s), %" PRIu64 " played, %" PRIu64 " rejected, %" PRIu64 " stolen, max %u real",
+        requests, TEST_AUDIO_BENCH_NPC_COUNT, frame_count, elapsed, pretty_buffer, stats.played, stats.rejected, stats.stolen, max_real);
+}
+
+void test_audio() {
+    RUN_TEST(test_audio_voice_sound_limit_steals_lowest);
+    RUN_TEST(test_audio_voice_group_limit_and_priority);
+    RUN_TEST(test_audio_voice_distance_culling);
+    RUN_TEST(test_audio_voice_virtual_voices_follow_listener);
+    RUN_TEST(test_audio_voice_one_shots_end);
+    RUN_TEST(test_audio_voice_performance_benchmark);
+}
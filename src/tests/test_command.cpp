@@ -0,0 +1,201 @@
+#include "command.hpp"
+#include "entity.hpp"
+#include "job.hpp"
+#include "log.hpp"
+#include "memory.hpp"
+#include "test.hpp"
+#include "time.hpp"
+#include "unit.hpp"
+
+#include <tinycthread.h>
+#include <unity.h>
+
+#define TEST_COMMAND_ITEM_COUNT 2000  // Times TEST_COMMAND_PER_ITEM has to fit into a single thread buffer
+#define TEST_COMMAND_PER_ITEM 3
+#define TEST_COMMAND_BENCH_ITERATIONS 100
+
+// Pushes are plain data, the merge never executes them so the ids do not need to be real entities
+void static i_test_command_push_scale(U32 item, U32 index) {
+    Command cmd            = {};
+    cmd.type               = COMMAND_TYPE_ENTITY_SCALE;
+    cmd.entity_scale.id    = item;
+    cmd.entity_scale.scale = {(F32)item, (F32)index, 0.0F};
+    command_push(&cmd);
+}
+
+S32 static i_test_command_record_range(U32 begin, U32 end, void *ctx) {
+    unused(ctx);
+    for (U32 item = begin; item < end; ++item) {
+        command_begin(COMMAND_SOURCE_ACTOR, item);
+        for (U32 i = 0; i < TEST_COMMAND_PER_ITEM; ++i) { i_test_command_push_scale(item, i); }
+    }
+    command_end();
+    return 0;
+}
+
+S32 static i_test_command_foreign_thread(void *arg) {
+    unused(arg);
+    for (U32 i = 0; i < TEST_COMMAND_PER_ITEM; ++i) { i_test_command_push_scale(0, i); }
+    return 0;
+}
+
+// Records the whole range with the given grain and returns the merged (item, index) pairs
+Vector3 static *i_test_command_record(U32 grain, SZ *out_count) {
+    command_clear();
+    job_wait(job_parallel_for(0, TEST_COMMAND_ITEM_COUNT, grain, i_test_command_record_range, nullptr));
+
+    SZ count                 = 0;
+    Command const **commands = command_merge(&count);
+    auto *scales             = mmta(Vector3 *, sizeof(Vector3) * (count > 0 ? count : 1));
+    for (SZ i = 0; i < count; ++i) { scales[i] = commands[i]->entity_scale.scale; }
+
+    command_clear();
+    *out_count = count;
+    return scales;
+}
+
+void static test_command_merge_is_sorted() {
+    command_flush();  // Whatever the game recorded so far should not end up in our merge
+
+    SZ count     = 0;
+    auto *scales = i_test_command_record(16, &count);
+    TEST_ASSERT_EQUAL_UINT64(TEST_COMMAND_ITEM_COUNT * TEST_COMMAND_PER_ITEM, count);
+
+    // Item by item and within one item in push order
+    for (SZ i = 0; i < count; ++i) {
+        TEST_ASSERT_EQUAL_FLOAT((F32)(i / TEST_COMMAND_PER_ITEM), scales[i].x);
+        TEST_ASSERT_EQUAL_FLOAT((F32)(i % TEST_COMMAND_PER_ITEM), scales[i].y);
+    }
+}
+
+void static test_command_merge_independent_of_scheduling() {
+    SZ fine_count   = 0;
+    SZ coarse_count = 0;
+    auto *fine      = i_test_command_record(1, &fine_count);
+    auto *coarse    = i_test_command_record(TEST_COMMAND_ITEM_COUNT, &coarse_count);
+
+    // One chunk per item vs. everything on one thread, the merged order has to be the same
+    SZ const bytes = sizeof(Vector3) * fine_count;
+    TEST_ASSERT_EQUAL_UINT64(fine_count, coarse_count);
+    TEST_ASSERT_EQUAL_MEMORY(fine, coarse, bytes);
+}
+
+S32 static i_test_command_record_second_pass(U32 begin, U32 end, void *ctx) {
+    unused(ctx);
+    for (U32 item = begin; item < end; ++item) {
+        command_begin(COMMAND_SOURCE_ACTOR, item);
+        for (U32 i = 0; i < TEST_COMMAND_PER_ITEM; ++i) { i_test_command_push_scale(item, TEST_COMMAND_PER_ITEM + i); }
+    }
+    command_end();
+    return 0;
+}
+
+void static test_command_phases_keep_passes_apart() {
+    command_clear();
+
+    // Same keys recorded twice in one frame, once on the main thread and once more from jobs after the next phase
+    for (U32 item = 0; item < 64; ++item) {
+        command_begin(COMMAND_SOURCE_ACTOR, item);
+        for (U32 i = 0; i < TEST_COMMAND_PER_ITEM; ++i) { i_test_command_push_scale(item, i); }
+    }
+    command_end();
+    command_next_phase();
+    job_wait(job_parallel_for(0, 64, 1, i_test_command_record_second_pass, nullptr));
+
+    SZ count                 = 0;
+    Command const **commands = command_merge(&count);
+    TEST_ASSERT_EQUAL_UINT64(64 * TEST_COMMAND_PER_ITEM * 2, count);
+
+    // Per item the first pass and then the second one, each in push order
+    for (SZ i = 0; i < count; ++i) {
+        TEST_ASSERT_EQUAL_FLOAT((F32)(i / (TEST_COMMAND_PER_ITEM * 2)), commands[i]->entity_scale.scale.x);
+        TEST_ASSERT_EQUAL_FLOAT((F32)(i % (TEST_COMMAND_PER_ITEM * 2)), commands[i]->entity_scale.scale.y);
+    }
+
+    command_clear();
+}
+
+void static test_command_foreign_thread() {
+    command_clear();
+
+    // The main thread is part of the job system, without command_begin it records unkeyed
+    i_test_command_push_scale(1, 0);
+
+    thrd_t thread;
+    TEST_ASSERT_EQUAL_INT(thrd_success, thrd_create(&thread, i_test_command_foreign_thread, nullptr));
+    thrd_join(thread, nullptr);
+
+    SZ count                 = 0;
+    Command const **commands = command_merge(&count);
+    TEST_ASSERT_EQUAL_UINT64(1 + TEST_COMMAND_PER_ITEM, count);
+
+    // Foreign commands sort after everything else and keep their arrival order
+    TEST_ASSERT_EQUAL_UINT32(COMMAND_SOURCE_UNKEYED, (U32)(commands[0]->key >> 32));
+    for (U32 i = 0; i < TEST_COMMAND_PER_ITEM; ++i) {
+        TEST_ASSERT_EQUAL_UINT32(COMMAND_SOURCE_FOREIGN, (U32)(commands[1 + i]->key >> 32));
+        TEST_ASSERT_EQUAL_FLOAT((F32)i, commands[1 + i]->entity_scale.scale.y);
+    }
+
+    command_clear();
+}
+
+void static test_command_flush_source_keeps_the_rest() {
+    command_clear();
+
+    // Unkeyed ones point at no entity, executing them is a no-op
+    for (U32 item = 0; item < 64; ++item) {
+        command_begin(COMMAND_SOURCE_ACTOR, item);
+        for (U32 i = 0; i < TEST_COMMAND_PER_ITEM; ++i) { i_test_command_push_scale(item, i); }
+        command_end();
+        i_test_command_push_scale(INVALID_EID, item);
+    }
+
+    command_flush_source(COMMAND_SOURCE_UNKEYED);
+
+    SZ count                 = 0;
+    Command const **commands = command_merge(&count);
+    TEST_ASSERT_EQUAL_UINT64(64 * TEST_COMMAND_PER_ITEM, count);
+
+    // Only the actor commands are left, still item by item and in push order
+    for (SZ i = 0; i < count; ++i) {
+        TEST_ASSERT_EQUAL_UINT32(COMMAND_SOURCE_ACTOR, COMMAND_KEY_SOURCE(commands[i]->key));
+        TEST_ASSERT_EQUAL_FLOAT((F32)(i / TEST_COMMAND_PER_ITEM), commands[i]->entity_scale.scale.x);
+        TEST_ASSERT_EQUAL_FLOAT((F32)(i % TEST_COMMAND_PER_ITEM), commands[i]->entity_scale.scale.y);
+    }
+
+    command_clear();
+}
+
+void static test_command_performance_benchmark() {
+    C8 pretty_buffer[PRETTY_BUFFER_SIZE] = {};
+
+    F64 record_time = 0.0;
+    F64 merge_time  = 0.0;
+    for (U32 i = 0; i < TEST_COMMAND_BENCH_ITERATIONS; ++i) {
+        command_clear();
+
+        F64 const record_start = time_get_glfw_f64();
+        job_wait(job_parallel_for(0, TEST_COMMAND_ITEM_COUNT, 64, i_test_command_record_range, nullptr));
+        F64 const merge_start  = time_get_glfw_f64();
+
+        SZ count = 0;
+        command_merge(&count);
+        merge_time  += time_get_glfw_f64() - merge_start;
+        record_time += merge_start - record_start;
+    }
+    command_clear();
+
+    F64 const total = (F64)TEST_COMMAND_ITEM_COUNT * TEST_COMMAND_PER_ITEM * TEST_COMMAND_BENCH_ITERATIONS;
+    unit_to_pretty_prefix_f("cmd/s", total / record_time, pretty_buffer, PRETTY_BUFFER_SIZE, UNIT_PREFIX_MEGA);
+    lli("Command push: %d x %d commands on %u threads in %.8fs (%s), merge took %.8fs", TEST_COMMAND_BENCH_ITERATIONS,
+        TEST_COMMAND_ITEM_COUNT * TEST_COMMAND_PER_ITEM, job_system_get_thread_count(), record_time, pretty_buffer, merge_time);
+}
+
+void test_command() {
+    RUN_TEST(test_command_merge_is_sorted);
+    RUN_TEST(test_command_merge_independent_of_scheduling);
+    RUN_TEST(test_command_phases_keep_passes_apart);
+    RUN_TEST(test_command_foreign_thread);
+    RUN_TEST(test_command_flush_source_keeps_the_rest);
+    RUN_TEST(test_command_performance_benchmark);
+}
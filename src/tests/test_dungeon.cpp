@@ -0,0 +1,336 @@
+#include "dungeon.hpp"
+#include "asset.hpp"
+#include "entity.hpp"
+#include "grid.hpp"
+#include "log.hpp"
+#include "memory.hpp"
+#include "render.hpp"
+#include "std.hpp"
+#include "test.hpp"
+#include "time.hpp"
+#include "unit.hpp"
+#include "world.hpp"
+
+#include <raymath.h>
+#include <unity.h>
+
+#define TEST_DUNGEON_TILE_SIZE 10.0F  // DUNGEON_TILE_SIZE
+#define TEST_DUNGEON_SIZE 320         // Tiles per side, about 30000 walls
+#define TEST_DUNGEON_WALL_PERCENT 30
+#define TEST_DUNGEON_QUERY_COUNT 20000
+#define TEST_DUNGEON_BENCH_ITERATIONS 5
+#define TEST_DUNGEON_OPEN_SIZE 96           // Few pillars, long sight lines for the PVS
+#define TEST_DUNGEON_OPEN_WALL_PERCENT 4
+#define TEST_DUNGEON_PVS_PAIR_COUNT 2000
+#define TEST_DUNGEON_VISIBILITY_ENTITIES 5000
+#define TEST_DUNGEON_DRAW_PASS_COUNT 4      // HUD, 2D debug, 3D draw and 3D debug all used to ray test on their own
+
+struct TestDungeon {
+    C8 *text;
+    Vector3 *walls;  // Centers, for the brute force reference
+    SZ wall_count;
+};
+
+// Border walls and a deterministic scatter of pillars inside, the rest is floor
+TestDungeon static i_test_dungeon_generate(S32 size, S32 wall_percent) {
+    TestDungeon dungeon = {};
+    dungeon.text        = mmta(C8 *, (SZ)(size + 1) * (SZ)size + 1);
+    dungeon.walls       = mmta(Vector3 *, (SZ)size * (SZ)size * sizeof(Vector3));
+
+    SZ cursor = 0;
+    for (S32 y = 0; y < size; ++y) {
+        for (S32 x = 0; x < size; ++x) {
+            U32 const hash     = test_hash((U32)(y * size + x) + 1U);
+            BOOL const border  = x == 0 || y == 0 || x == size - 1 || y == size - 1;
+            BOOL const is_wall = border || (hash >> 16) % 100 < (U32)wall_percent;
+
+            dungeon.text[cursor++] = is_wall ? 'w' : '.';
+            if (is_wall) { dungeon.walls[dungeon.wall_count++] = {(F32)x * TEST_DUNGEON_TILE_SIZE, 0.0F, (F32)y * TEST_DUNGEON_TILE_SIZE}; }
+        }
+        dungeon.text[cursor++] = '\n';
+    }
+    dungeon.text[cursor] = '\0';
+
+    return dungeon;
+}
+
+// What the collision used to do, every wall for every query
+BOOL static i_test_dungeon_colliding_linear(TestDungeon const *dungeon, Vector3 position, F32 radius) {
+    F32 const min_dist = (TEST_DUNGEON_TILE_SIZE * 0.5F) + radius;
+    for (SZ i = 0; i < dungeon->wall_count; ++i) {
+        if (math_abs_f32(position.x - dungeon->walls[i].x) < min_dist && math_abs_f32(position.z - dungeon->walls[i].z) < min_dist) { return true; }
+    }
+    return false;
+}
+
+Vector3 static i_test_dungeon_query_position(U32 seed) {
+    F32 const extent = (F32)TEST_DUNGEON_SIZE * TEST_DUNGEON_TILE_SIZE;
+    return Vector3Subtract(test_scatter_position(seed, extent, extent), {5.0F, 0.0F, 5.0F});
+}
+
+F32 static i_test_dungeon_query_radius(U32 seed) {
+    return 0.5F + (F32)((seed * 40503U) % 8) * 0.5F;
+}
+
+void static test_dungeon_collision_matches_linear() {
+    TestDungeon const dungeon = i_test_dungeon_generate(TEST_DUNGEON_SIZE, TEST_DUNGEON_WALL_PERCENT);
+    dungeon_load_from_text(dungeon.text, MEMORY_TYPE_ARENA_TRANSIENT);
+
+    for (U32 i = 0; i < TEST_DUNGEON_QUERY_COUNT; ++i) {
+        Vector3 const position = i_test_dungeon_query_position(i);
+        F32 const radius       = i_test_dungeon_query_radius(i);
+        TEST_ASSERT_EQUAL(i_test_dungeon_colliding_linear(&dungeon, position, radius), dungeon_is_position_colliding(position, radius));
+    }
+
+    dungeon_unload();
+}
+
+void static test_dungeon_floor_bitmap() {
+    dungeon_load_from_text("www\nw.w\nwww\n", MEMORY_TYPE_ARENA_TRANSIENT);
+
+    // Anywhere on the floor tile, on the floor or on top of the ceiling, never inside a wall or between the two
+    TEST_ASSERT_TRUE(dungeon_is_position_on_floor({10.0F, 0.0F, 10.0F}));
+    TEST_ASSERT_TRUE(dungeon_is_position_on_floor({14.0F, 1.0F, 6.0F}));
+    TEST_ASSERT_TRUE(dungeon_is_position_on_floor({10.0F, 20.0F, 10.0F}));
+    TEST_ASSERT_FALSE(dungeon_is_position_on_floor({10.0F, 8.0F, 10.0F}));
+    TEST_ASSERT_FALSE(dungeon_is_position_on_floor({0.0F, 0.0F, 10.0F}));
+    TEST_ASSERT_FALSE(dungeon_is_position_on_floor({-100.0F, 0.0F, 10.0F}));
+
+    dungeon_unload();
+}
+
+void static test_dungeon_unload_restores_live_dungeon() {
+    // Tests run from the console in the middle of a game, whatever is loaded now has to survive them
+    Vector3 const position = {10.0F, 0.0F, 10.0F};
+    BOOL const live_floor  = dungeon_is_position_on_floor(position);
+
+    dungeon_load_from_text("www\nw.w\nwww\n", MEMORY_TYPE_ARENA_TRANSIENT);
+    TEST_ASSERT_TRUE(dungeon_is_position_on_floor(position));
+    dungeon_load_from_text("www\nwww\nwww\n", MEMORY_TYPE_ARENA_TRANSIENT);
+    TEST_ASSERT_FALSE(dungeon_is_position_on_floor(position));
+    dungeon_unload();
+
+    TEST_ASSERT_EQUAL(live_floor, dungeon_is_position_on_floor(position));
+}
+
+void static test_dungeon_collision_batch() {
+    test_scratch_world_begin();
+
+    dungeon_load_from_text("wwwww\nw...w\nw...w\nwwwww\n", MEMORY_TYPE_ARENA_TRANSIENT);
+    AModel const *model = asset_get_model("greenman.glb");
+
+    for (EID id = 0; id < 2; ++id) {
+        test_spawn_entity(id, ENTITY_TYPE_NPC, {}, ENTITY_FLAG_MASK(ENTITY_FLAG_ACTOR));
+        g_world->scale[id]           = {1.0F, 1.0F, 1.0F};
+        g_world->model_name_hash[id] = model->header.name_hash;
+        entity_set_position(id, {20.0F, 0.0F, 10.0F + (F32)id * 10.0F});
+    }
+
+    // Actor 0 walked into the top wall and slides back along X, actor 1 did not move and stays where it is
+    EntityMovementController *movement = &g_world->actor[0].movement;
+    movement->wall_collision_from      = g_world->position[0];
+    movement->wall_collision_pending   = true;
+    entity_set_position(0, {22.0F, 0.0F, 4.0F});
+
+    dungeon_resolve_wall_collision_batch();
+
+    TEST_ASSERT_FALSE(movement->wall_collision_pending);
+    TEST_ASSERT_EQUAL_FLOAT(22.0F, g_world->position[0].x);
+    TEST_ASSERT_EQUAL_FLOAT(10.0F, g_world->position[0].z);
+    TEST_ASSERT_EQUAL_FLOAT(20.0F, g_world->position[1].z);
+
+    dungeon_unload();
+    test_scratch_world_end();
+}
+
+void static test_dungeon_collision_performance_benchmark() {
+    C8 pretty_buffer[PRETTY_BUFFER_SIZE] = {};
+
+    TestDungeon const dungeon = i_test_dungeon_generate(TEST_DUNGEON_SIZE, TEST_DUNGEON_WALL_PERCENT);
+    F64 const load_start      = time_get_glfw_f64();
+    dungeon_load_from_text(dungeon.text, MEMORY_TYPE_ARENA_TRANSIENT);
+    F64 const load_time       = time_get_glfw_f64() - load_start;
+
+    SZ linear_hits   = 0;
+    F64 linear_start = time_get_glfw_f64();
+    for (U32 i = 0; i < TEST_DUNGEON_QUERY_COUNT / 10; ++i) {
+        linear_hits += i_test_dungeon_colliding_linear(&dungeon, i_test_dungeon_query_position(i), i_test_dungeon_query_radius(i)) ? 1U : 0U;
+    }
+    F64 const linear_time = (time_get_glfw_f64() - linear_start) / (TEST_DUNGEON_QUERY_COUNT / 10);
+
+    SZ grid_hits   = 0;
+    F64 grid_start = time_get_glfw_f64();
+    for (U32 iteration = 0; iteration < TEST_DUNGEON_BENCH_ITERATIONS; ++iteration) {
+        for (U32 i = 0; i < TEST_DUNGEON_QUERY_COUNT; ++i) {
+            grid_hits += dungeon_is_position_colliding(i_test_dungeon_query_position(i), i_test_dungeon_query_radius(i)) ? 1U : 0U;
+        }
+    }
+    F64 const grid_time = (time_get_glfw_f64() - grid_start) / (TEST_DUNGEON_QUERY_COUNT * TEST_DUNGEON_BENCH_ITERATIONS);
+    TEST_ASSERT_TRUE(grid_hits > 0 && linear_hits > 0);
+
+    unit_to_pretty_prefix_f("q/s", 1.0 / grid_time, pretty_buffer, PRETTY_BUFFER_SIZE, UNIT_PREFIX_MEGA);
+    lli("Dungeon collision: %d walls (loaded in %.3fms), linear %.3fus/query, grid %.3fus/query (%s), %.0fx", (S32)dungeon.wall_count,
+        load_time * 1e3, linear_time * 1e6, grid_time * 1e6, pretty_buffer, linear_time / grid_time);
+
+    dungeon_unload();
+}
+
+BOOL static i_test_dungeon_is_wall_tile(TestDungeon const *dungeon, S32 size, F32 x, F32 z) {
+    S32 const tile_x = (S32)math_floor_f32((x / TEST_DUNGEON_TILE_SIZE) + 0.5F);
+    S32 const tile_z = (S32)math_floor_f32((z / TEST_DUNGEON_TILE_SIZE) + 0.5F);
+    return dungeon->text[(tile_z * (size + 1)) + tile_x] == 'w';
+}
+
+// Two 10x10 rooms with 18 tiles of solid rock in between
+C8 static *i_test_dungeon_two_rooms() {
+    S32 const width  = 40;
+    S32 const height = 12;
+    auto *text       = mmta(C8 *, (SZ)((width + 1) * height) + 1);
+
+    SZ cursor = 0;
+    for (S32 y = 0; y < height; ++y) {
+        for (S32 x = 0; x < width; ++x) {
+            BOOL const in_room = y > 0 && y < height - 1 && ((x >= 1 && x <= 10) || (x >= 29 && x <= 38));
+            text[cursor++]     = in_room ? '.' : 'w';
+        }
+        text[cursor++] = '\n';
+    }
+    text[cursor] = '\0';
+
+    return text;
+}
+
+void static test_dungeon_pvs_rejects_closed_rooms() {
+    dungeon_load_from_text(i_test_dungeon_two_rooms(), MEMORY_TYPE_ARENA_TRANSIENT);
+
+    Vector3 const room_a = {50.0F, 2.0F, 50.0F};
+    Vector3 const room_b = {330.0F, 0.0F, 50.0F};
+    TEST_ASSERT_TRUE(dungeon_is_potentially_visible(room_a, {100.0F, 0.0F, 100.0F}));
+    TEST_ASSERT_FALSE(dungeon_is_potentially_visible(room_a, room_b));
+    TEST_ASSERT_FALSE(dungeon_is_potentially_visible(room_b, room_a));
+
+    // Above the walls or outside of the layout the PVS has nothing to say
+    TEST_ASSERT_TRUE(dungeon_is_potentially_visible({50.0F, 30.0F, 50.0F}, room_b));
+    TEST_ASSERT_TRUE(dungeon_is_potentially_visible(room_a, {1000.0F, 0.0F, 50.0F}));
+
+    dungeon_unload();
+}
+
+void static test_dungeon_pvs_is_conservative() {
+    TestDungeon const dungeon = i_test_dungeon_generate(TEST_DUNGEON_OPEN_SIZE, TEST_DUNGEON_OPEN_WALL_PERCENT);
+    dungeon_load_from_text(dungeon.text, MEMORY_TYPE_ARENA_TRANSIENT);
+
+    // Whatever a finely sampled segment gets through unblocked has to be in the PVS
+    F32 const extent = (F32)(TEST_DUNGEON_OPEN_SIZE - 1) * TEST_DUNGEON_TILE_SIZE;
+    SZ clear_count   = 0;
+    for (U32 i = 0; i < TEST_DUNGEON_PVS_PAIR_COUNT; ++i) {
+        Vector3 const a  = Vector3Add(test_scatter_position(i + 1U, extent, extent), {0.0F, 1.0F, 0.0F});
+        Vector3 const b  = Vector3Add(test_scatter_position((i + 1U) * 40503U, extent, extent), {0.0F, 1.0F, 0.0F});
+
+        F32 const length = Vector3Distance(a, b);
+        S32 const steps  = (S32)(length / (TEST_DUNGEON_TILE_SIZE * 0.05F)) + 1;
+        BOOL blocked     = false;
+        for (S32 step = 0; step <= steps && !blocked; ++step) {
+            Vector3 const sample = Vector3Lerp(a, b, (F32)step / (F32)steps);
+            blocked              = i_test_dungeon_is_wall_tile(&dungeon, TEST_DUNGEON_OPEN_SIZE, sample.x, sample.z);
+        }
+        if (blocked) { continue; }
+
+        clear_count++;
+        TEST_ASSERT_TRUE(dungeon_is_potentially_visible(a, b));
+    }
+    TEST_ASSERT_TRUE(clear_count > 0);
+
+    dungeon_unload();
+}
+
+void static test_dungeon_visibility_bitset() {
+    test_scratch_world_begin();
+
+    Camera3D *camera           = c3d_get_ptr();
+    Vector3 const saved_camera = camera->position;
+    camera->position           = {50.0F, 2.0F, 50.0F};
+
+    dungeon_load_from_text(i_test_dungeon_two_rooms(), MEMORY_TYPE_ARENA_TRANSIENT);
+
+    // Same room, other room, other room but off screen
+    Vector3 const positions[] = {{80.0F, 0.0F, 60.0F}, {330.0F, 0.0F, 50.0F}, {330.0F, 0.0F, 80.0F}};
+    for (EID id = 0; id < 3; ++id) { test_spawn_entity(id, ENTITY_TYPE_NPC, positions[id], id != 2 ? ENTITY_FLAG_MASK(ENTITY_FLAG_IN_FRUSTUM) : 0U); }
+
+    dungeon_update_visibility();
+    TEST_ASSERT_FALSE(world_is_entity_occluded(0));
+    TEST_ASSERT_TRUE(world_is_entity_occluded(1));
+    TEST_ASSERT_FALSE(world_is_entity_occluded(2));
+
+    // Walking into the other room flips it around
+    camera->position = {320.0F, 2.0F, 50.0F};
+    dungeon_update_visibility();
+    TEST_ASSERT_TRUE(world_is_entity_occluded(0));
+    TEST_ASSERT_FALSE(world_is_entity_occluded(1));
+
+    dungeon_unload();
+    camera->position = saved_camera;
+    test_scratch_world_end();
+}
+
+void static test_dungeon_visibility_performance_benchmark() {
+    C8 pretty_buffer[PRETTY_BUFFER_SIZE] = {};
+
+    test_scratch_world_begin();
+
+    Camera3D *camera           = c3d_get_ptr();
+    Vector3 const saved_camera = camera->position;
+
+    TestDungeon const dungeon = i_test_dungeon_generate(TEST_DUNGEON_SIZE, TEST_DUNGEON_WALL_PERCENT);
+    F64 const load_start      = time_get_glfw_f64();
+    dungeon_load_from_text(dungeon.text, MEMORY_TYPE_ARENA_TRANSIENT);
+    F64 const load_time = time_get_glfw_f64() - load_start;
+
+    // Entities spread over the floor, the camera in the middle of the map
+    EID count = 0;
+    for (U32 seed = 0; count < TEST_DUNGEON_VISIBILITY_ENTITIES; ++seed) {
+        Vector3 const position = i_test_dungeon_query_position(seed);
+        if (!dungeon_is_position_on_floor(position)) { continue; }
+        test_spawn_entity(count++, ENTITY_TYPE_NPC, position, ENTITY_FLAG_MASK(ENTITY_FLAG_IN_FRUSTUM));
+    }
+    F32 const center = (F32)(TEST_DUNGEON_SIZE / 2) * TEST_DUNGEON_TILE_SIZE;
+    camera->position = {center, 0.0F, center};
+    while (!dungeon_is_position_on_floor(camera->position)) { camera->position.x += TEST_DUNGEON_TILE_SIZE; }
+    camera->position.y = 2.0F;
+
+    // What every draw pass used to do on its own
+    SZ occluded_count    = 0;
+    F64 const pass_start = time_get_glfw_f64();
+    for (U32 pass = 0; pass < TEST_DUNGEON_DRAW_PASS_COUNT; ++pass) {
+        for (EID id = 0; id < count; ++id) { occluded_count += dungeon_is_entity_occluded(id) ? 1U : 0U; }
+    }
+    F64 const pass_time = time_get_glfw_f64() - pass_start;
+
+    F64 const stage_start = time_get_glfw_f64();
+    for (U32 iteration = 0; iteration < TEST_DUNGEON_BENCH_ITERATIONS; ++iteration) { dungeon_update_visibility(); }
+    F64 const stage_time = (time_get_glfw_f64() - stage_start) / TEST_DUNGEON_BENCH_ITERATIONS;
+
+    SZ stage_count = 0;
+    for (EID id = 0; id < count; ++id) { stage_count += world_is_entity_occluded(id) ? 1U : 0U; }
+    TEST_ASSERT_EQUAL_UINT64(occluded_count, stage_count * TEST_DUNGEON_DRAW_PASS_COUNT);
+
+    unit_to_pretty_prefix_f("ent/s", (F64)count / stage_time, pretty_buffer, PRETTY_BUFFER_SIZE, UNIT_PREFIX_MEGA);
+    lli("Dungeon visibility: %u entities, %d occluded, PVS + grid built in %.3fms, %d draw passes %.3fms, visibility stage %.3fms (%s)", count,
+        (S32)stage_count, load_time * 1e3, TEST_DUNGEON_DRAW_PASS_COUNT, pass_time * 1e3, stage_time * 1e3, pretty_buffer);
+
+    dungeon_unload();
+    camera->position = saved_camera;
+    test_scratch_world_end();
+}
+
+void test_dungeon() {
+    RUN_TEST(test_dungeon_collision_matches_linear);
+    RUN_TEST(test_dungeon_floor_bitmap);
+    RUN_TEST(test_dungeon_unload_restores_live_dungeon);
+    RUN_TEST(test_dungeon_collision_batch);
+    RUN_TEST(test_dungeon_collision_performance_benchmark);
+    RUN_TEST(test_dungeon_pvs_rejects_closed_rooms);
+    RUN_TEST(test_dungeon_pvs_is_conservative);
+    RUN_TEST(test_dungeon_visibility_bitset);
+    RUN_TEST(test_dungeon_visibility_performance_benchmark);
+}
@@ -0,0 +1,163 @@
+#include "grid.hpp"
+#include "log.hpp"
+#include "test.hpp"
+#include "time.hpp"
+#include "unit.hpp"
+#include "world.hpp"
+
+#include <unity.h>
+
+#define TEST_GRID_BENCH_FRAMES 100
+#define TEST_GRID_BENCH_MOVED_PERCENT 5
+#define TEST_GRID_QUERY_MAX 512
+
+// The grid works on g_world, so every test runs against the shared scratch world with a freshly built grid
+void static i_test_grid_begin() {
+    test_scratch_world_begin();
+    grid_rebuild();
+}
+
+Vector3 static i_test_grid_position(U32 seed) {
+    return test_scatter_position(seed, g_grid.terrain_size.x, g_grid.terrain_size.y);
+}
+
+void static i_test_grid_spawn(EID id, EntityType type, Vector3 position) {
+    test_spawn_entity(id, type, position, 0U);
+    grid_add_entity(id, type, position);
+}
+
+void static i_test_grid_spawn_scattered(U32 count) {
+    for (EID i = 0; i < count; ++i) { i_test_grid_spawn(i, (EntityType)(1 + (i % (ENTITY_TYPE_COUNT - 1))), i_test_grid_position(i)); }
+}
+
+void static test_grid_cell_has_no_cap() {
+    i_test_grid_begin();
+
+    // Way more than the old fixed 50 per cell and type
+    Vector3 const position = grid_cell_center(grid_get_cell_index_xy(10, 10));
+    for (EID i = 0; i < 300; ++i) { i_test_grid_spawn(i, ENTITY_TYPE_NPC, position); }
+
+    EID out[TEST_GRID_QUERY_MAX] = {};
+    SZ out_count                 = 0;
+    grid_query_entities_in_cell(position, out, &out_count, TEST_GRID_QUERY_MAX);
+    TEST_ASSERT_EQUAL_INT(300, out_count);
+    TEST_ASSERT_EQUAL_INT(300, grid_get_cell(position)->count_per_type[ENTITY_TYPE_NPC]);
+
+    // The caller's limit still applies
+    grid_query_entities_around_cell(position, out, &out_count, 64);
+    TEST_ASSERT_EQUAL_INT(64, out_count);
+
+    test_scratch_world_end();
+}
+
+void static test_grid_populate_relinks_only_moved() {
+    i_test_grid_begin();
+    i_test_grid_spawn_scattered(1000);
+
+    grid_populate();
+    TEST_ASSERT_EQUAL_INT(0, g_grid.relinked_count);
+
+    // Move two entities into a cell neither of them is in yet
+    Vector3 const target = grid_cell_center(grid_get_cell_index_xy(GRID_CELLS_PER_ROW - 1, 0));
+    GridCell const *cell = grid_get_cell(target);
+    TEST_ASSERT_TRUE(g_grid.links[3].cell_index != grid_get_cell_index(target));
+    TEST_ASSERT_TRUE(g_grid.links[7].cell_index != grid_get_cell_index(target));
+
+    SZ before = 0;
+    for (SZ const count : cell->count_per_type) { before += count; }
+    g_world->position[3] = target;
+    g_world->position[7] = target;
+
+    grid_populate();
+    TEST_ASSERT_EQUAL_INT(2, g_grid.relinked_count);
+
+    SZ after = 0;
+    for (SZ const count : cell->count_per_type) { after += count; }
+    TEST_ASSERT_EQUAL_INT(before + 2, after);
+
+    // Every entity must be found exactly in the cell its position maps to
+    SZ total = 0;
+    for (SZ cell_index = 0; cell_index < (SZ)GRID_TOTAL_CELLS; ++cell_index) {
+        GridCell const *c = grid_get_cell_by_index(cell_index);
+        for (SZ type = 0; type < ENTITY_TYPE_COUNT; ++type) {
+            SZ count = 0;
+            GRID_CELL_EACH(c, type, id) {
+                TEST_ASSERT_EQUAL_INT(cell_index, grid_get_cell_index(g_world->position[id]));
+                TEST_ASSERT_EQUAL_INT(type, g_world->type[id]);
+                count++;
+            }
+            TEST_ASSERT_EQUAL_INT(c->count_per_type[type], count);
+            total += count;
+        }
+    }
+    TEST_ASSERT_EQUAL_INT(1000, total);
+
+    test_scratch_world_end();
+}
+
+void static test_grid_remove_entity() {
+    i_test_grid_begin();
+
+    Vector3 const position = grid_cell_center(grid_get_cell_index_xy(20, 20));
+    for (EID i = 0; i < 3; ++i) { i_test_grid_spawn(i, ENTITY_TYPE_VEGETATION, position); }
+
+    // Removing from the middle of the list keeps the neighbours linked
+    grid_remove_entity(1);
+
+    EID out[TEST_GRID_QUERY_MAX] = {};
+    SZ out_count                 = 0;
+    grid_query_entities_in_radius(position, 1.0F, out, &out_count, TEST_GRID_QUERY_MAX);
+    TEST_ASSERT_EQUAL_INT(2, out_count);
+    TEST_ASSERT_TRUE(out[0] != 1 && out[1] != 1);
+
+    // Removing twice is harmless
+    grid_remove_entity(1);
+    TEST_ASSERT_EQUAL_INT(2, grid_get_cell(position)->count_per_type[ENTITY_TYPE_VEGETATION]);
+
+    test_scratch_world_end();
+}
+
+void static i_test_grid_move_some(U32 count, U32 frame) {
+    U32 const moved = count * TEST_GRID_BENCH_MOVED_PERCENT / 100;
+    for (U32 i = 0; i < moved; ++i) {
+        EID const id = ((frame * moved) + i) % count;
+        g_world->position[id] = i_test_grid_position((frame * count) + id);
+    }
+}
+
+void static test_grid_performance_benchmark() {
+    U32 const entity_counts[] = {5000, 15000, 25000};
+
+    for (U32 const count : entity_counts) {
+        i_test_grid_begin();
+        i_test_grid_spawn_scattered(count);
+
+        // Old behaviour, clear everything and reinsert every entity each frame (the old clear also had 23 MB to memset)
+        F64 start_time = time_get_glfw_f64();
+        for (U32 frame = 0; frame < TEST_GRID_BENCH_FRAMES; ++frame) {
+            i_test_grid_move_some(count, frame);
+            grid_rebuild();
+        }
+        F64 const rebuild_time = (time_get_glfw_f64() - start_time) / TEST_GRID_BENCH_FRAMES;
+
+        // Incremental, only the moved entities get relinked
+        start_time = time_get_glfw_f64();
+        for (U32 frame = 0; frame < TEST_GRID_BENCH_FRAMES; ++frame) {
+            i_test_grid_move_some(count, frame + TEST_GRID_BENCH_FRAMES);
+            grid_populate();
+        }
+        F64 const incremental_time = (time_get_glfw_f64() - start_time) / TEST_GRID_BENCH_FRAMES;
+
+        lli("Grid %5u entities (%d%% moving): rebuild %.3fus/frame, incremental %.3fus/frame, %.2fx",
+            count, TEST_GRID_BENCH_MOVED_PERCENT, rebuild_time * 1e6, incremental_time * 1e6, rebuild_time / incremental_time);
+
+        test_scratch_world_end();
+    }
+}
+
+void test_grid() {
+    RUN_TEST(test_grid_cell_has_no_cap);
+    RUN_TEST(test_grid_populate_relinks_only_moved);
+    RUN_TEST(test_grid_remove_entity);
+    RUN_TEST(test_grid_performance_benchmark);
+}
@@ -0,0 +1,128 @@
+#include "job.hpp"
+#include "log.hpp"
+#include "memory.hpp"
+#include "test.hpp"
+#include "time.hpp"
+#include "unit.hpp"
+
+#include <atomic>
+#include <unity.h>
+
+#define TEST_JOB_RANGE_SIZE 100'000
+#define TEST_JOB_CHAIN_LENGTH 8
+#define TEST_JOB_BENCH_ITERATIONS 200
+
+struct TestJobChainData {
+    std::atomic<U32> *step;
+    U32 expected_step;
+    BOOL ok;
+};
+
+S32 static i_test_job_mark_range(U32 begin, U32 end, void *ctx) {
+    auto *hits = (U8 *)ctx;
+    for (U32 i = begin; i < end; ++i) { hits[i]++; }
+    return 0;
+}
+
+S32 static i_test_job_sum_range(U32 begin, U32 end, void *ctx) {
+    auto *sum = (std::atomic<U64> *)ctx;
+    U64 local = 0;
+    for (U32 i = begin; i < end; ++i) { local += i; }
+    sum->fetch_add(local, std::memory_order_relaxed);
+    return 0;
+}
+
+S32 static i_test_job_chain_step(void *arg) {
+    auto *data = (TestJobChainData *)arg;
+    data->ok   = data->step->fetch_add(1, std::memory_order_acq_rel) == data->expected_step;
+    return 0;
+}
+
+S32 static i_test_job_noop(void *arg) {
+    unused(arg);
+    return 0;
+}
+
+void static test_job_parallel_for_covers_range() {
+    auto *hits = mcta(U8 *, TEST_JOB_RANGE_SIZE, sizeof(U8));
+
+    JobHandle const job = job_parallel_for(0, TEST_JOB_RANGE_SIZE, 64, i_test_job_mark_range, hits);
+    job_wait(job);
+    TEST_ASSERT_TRUE(job_is_done(job));
+
+    // Every index exactly once, no gaps and no overlapping chunks
+    for (U32 i = 0; i < TEST_JOB_RANGE_SIZE; ++i) { TEST_ASSERT_EQUAL_UINT8(1, hits[i]); }
+}
+
+void static test_job_parallel_for_tiny_grain_and_empty_range() {
+    std::atomic<U64> sum = 0;
+
+    // A grain of 1 over a big range gets clamped instead of draining the job pool
+    job_wait(job_parallel_for(0, TEST_JOB_RANGE_SIZE, 1, i_test_job_sum_range, &sum));
+    TEST_ASSERT_EQUAL_UINT64((U64)TEST_JOB_RANGE_SIZE * (TEST_JOB_RANGE_SIZE - 1) / 2, sum.load());
+
+    sum = 0;
+    job_wait(job_parallel_for(10, 10, 4, i_test_job_sum_range, &sum));
+    TEST_ASSERT_EQUAL_UINT64(0, sum.load());
+}
+
+void static test_job_dependency_chain_runs_in_order() {
+    std::atomic<U32> step = 0;
+    TestJobChainData data[TEST_JOB_CHAIN_LENGTH] = {};
+    JobHandle jobs[TEST_JOB_CHAIN_LENGTH]        = {};
+
+    for (U32 i = 0; i < TEST_JOB_CHAIN_LENGTH; ++i) {
+        data[i].step          = &step;
+        data[i].expected_step = i;
+        jobs[i]               = job_create(i_test_job_chain_step, &data[i], JOB_PRIORITY_NORMAL);
+        TEST_ASSERT_NOT_NULL(jobs[i].job);
+        if (i > 0) { TEST_ASSERT_TRUE(job_add_dependency(jobs[i], jobs[i - 1])); }
+    }
+
+    // Submit back to front, the dependencies still have to enforce the order
+    for (U32 i = TEST_JOB_CHAIN_LENGTH; i > 0; --i) { job_submit(jobs[i - 1]); }
+    job_wait(jobs[TEST_JOB_CHAIN_LENGTH - 1]);
+
+    TEST_ASSERT_EQUAL_UINT32(TEST_JOB_CHAIN_LENGTH, step.load());
+    for (U32 i = 0; i < TEST_JOB_CHAIN_LENGTH; ++i) {
+        TEST_ASSERT_TRUE(job_is_done(jobs[i]));
+        TEST_ASSERT_TRUE(data[i].ok);
+    }
+}
+
+void static test_job_dependency_on_finished_job() {
+    JobHandle const first = job_run(i_test_job_noop, nullptr, JOB_PRIORITY_HIGH);
+    job_wait(first);
+
+    std::atomic<U32> step = 0;
+    TestJobChainData data = {&step, 0, false};
+    JobHandle const second = job_create(i_test_job_chain_step, &data, JOB_PRIORITY_LOW);
+
+    // Depending on something that already finished must not block the job
+    TEST_ASSERT_TRUE(job_add_dependency(second, first));
+    job_submit(second);
+    job_wait(second);
+    TEST_ASSERT_TRUE(data.ok);
+}
+
+void static test_job_performance_benchmark() {
+    C8 pretty_buffer[PRETTY_BUFFER_SIZE] = {};
+    std::atomic<U64> sum = 0;
+
+    F64 const start_time = time_get_glfw_f64();
+    for (U32 i = 0; i < TEST_JOB_BENCH_ITERATIONS; ++i) {
+        job_wait(job_parallel_for(0, TEST_JOB_RANGE_SIZE, 256, i_test_job_sum_range, &sum));
+    }
+    F64 const elapsed = time_get_glfw_f64() - start_time;
+
+    unit_to_pretty_prefix_f("elem/s", (F64)TEST_JOB_RANGE_SIZE * TEST_JOB_BENCH_ITERATIONS / elapsed, pretty_buffer, PRETTY_BUFFER_SIZE, UNIT_PREFIX_GIGA);
+    lli("Job parallel_for: %d x %d elements on %u threads in %.8fs (%s)", TEST_JOB_BENCH_ITERATIONS, TEST_JOB_RANGE_SIZE, job_system_get_thread_count(), elapsed, pretty_buffer);
+}
+
+void test_job() {
+    RUN_TEST(test_job_parallel_for_covers_range);
+    RUN_TEST(test_job_parallel_for_tiny_grain_and_empty_range);
+    RUN_TEST(test_job_dependency_chain_runs_in_order);
+    RUN_TEST(test_job_dependency_on_finished_job);
+    RUN_TEST(test_job_performance_benchmark);
+}
@@ -0,0 +1,285 @@
+#include "job.hpp"
+#include "log.hpp"
+#include "math.hpp"
+#include "memory.hpp"
+#include "test.hpp"
+#include "time.hpp"
+
+#include <atomic>
+#include <raymath.h>
+#include <unity.h>
+
+#define TEST_MATH_BONE_COUNT 16
+#define TEST_MATH_BONE_CACHE_SETS 4  // Small on purpose, the stress test has to evict constantly
+#define TEST_MATH_STRESS_KEYS 256
+#define TEST_MATH_STRESS_OPS 400'000
+#define TEST_MATH_STRESS_GRAIN 2'000
+#define TEST_MATH_BLEND_BONES 1'000
+#define TEST_MATH_BLEND_BENCH_BONES 100'000
+
+// Every bone of every key has a value that can be told apart, a torn copy shows up as a mismatch
+Matrix static i_test_math_bone(U64 key, S32 bone) {
+    Matrix m = {};
+    m.m0     = (F32)(key & 0xFFFF);
+    m.m5     = (F32)bone;
+    m.m10    = (F32)((key >> 32) & 0xFFFF);
+    m.m15    = (F32)(key & 0xFFFF) + (F32)bone;
+    return m;
+}
+
+void static i_test_math_fill(U64 key, Matrix *out) {
+    for (S32 bone = 0; bone < TEST_MATH_BONE_COUNT; ++bone) { out[bone] = i_test_math_bone(key, bone); }
+}
+
+BOOL static i_test_math_check(U64 key, Matrix const *matrices) {
+    for (S32 bone = 0; bone < TEST_MATH_BONE_COUNT; ++bone) {
+        Matrix const expected = i_test_math_bone(key, bone);
+        if (matrices[bone].m0 != expected.m0 || matrices[bone].m5 != expected.m5 || matrices[bone].m10 != expected.m10 ||
+            matrices[bone].m15 != expected.m15) {
+            return false;
+        }
+    }
+    return true;
+}
+
+SZ static i_test_math_bone_cache_budget(SZ set_count) {
+    return set_count * MATH_BONE_CACHE_WAYS * (sizeof(MathBoneCacheSlot) + (TEST_MATH_BONE_COUNT * (sizeof(Matrix) + sizeof(MathBoneTRS))));
+}
+
+void static test_math_bone_cache_get_put() {
+    MathBoneCache cache = {};
+    math_bone_cache_init(&cache, MEMORY_TYPE_ARENA_TRANSIENT, i_test_math_bone_cache_budget(TEST_MATH_BONE_CACHE_SETS), TEST_MATH_BONE_COUNT);
+    TEST_ASSERT_EQUAL_INT(TEST_MATH_BONE_CACHE_SETS * MATH_BONE_CACHE_WAYS, cache.slot_count);
+
+    Matrix matrices[TEST_MATH_BONE_COUNT] = {};
+    MathBoneTRS trs[TEST_MATH_BONE_COUNT] = {};
+    U64 const key                         = MATH_BONE_CACHE_KEY(0xCAFE, 3, 17);
+    TEST_ASSERT_FALSE(math_bone_cache_get(&cache, key, matrices, TEST_MATH_BONE_COUNT));
+
+    i_test_math_fill(key, matrices);
+    trs[TEST_MATH_BONE_COUNT - 1].translation.x = 7.0F;
+    math_bone_cache_put(&cache, key, matrices, trs, TEST_MATH_BONE_COUNT);
+    math_bone_cache_put(&cache, key, matrices, trs, TEST_MATH_BONE_COUNT);  // Already there, takes no second slot
+
+    Matrix out[TEST_MATH_BONE_COUNT] = {};
+    TEST_ASSERT_TRUE(math_bone_cache_get(&cache, key, out, TEST_MATH_BONE_COUNT));
+    TEST_ASSERT_TRUE(i_test_math_check(key, out));
+
+    // The decomposed bones live in the same slot
+    MathBoneTRS out_trs[TEST_MATH_BONE_COUNT] = {};
+    TEST_ASSERT_TRUE(math_bone_cache_get_trs(&cache, key, out_trs, TEST_MATH_BONE_COUNT));
+    TEST_ASSERT_EQUAL_FLOAT(7.0F, out_trs[TEST_MATH_BONE_COUNT - 1].translation.x);
+
+    // Asking for more bones than were stored is a miss, not a read past the end
+    TEST_ASSERT_FALSE(math_bone_cache_get(&cache, key, out, TEST_MATH_BONE_COUNT + 1));
+
+    MathBoneCacheStats const stats = math_bone_cache_get_stats(&cache);
+    TEST_ASSERT_EQUAL_UINT64(2, stats.hits);
+    TEST_ASSERT_EQUAL_UINT64(2, stats.misses);
+    TEST_ASSERT_EQUAL_INT(1, stats.used_slot_count);
+    TEST_ASSERT_EQUAL_UINT64(0, stats.evictions);
+}
+
+void static test_math_bone_cache_clock_eviction() {
+    // A single set, so every key competes for the same ways
+    MathBoneCache cache = {};
+    math_bone_cache_init(&cache, MEMORY_TYPE_ARENA_TRANSIENT, i_test_math_bone_cache_budget(1), TEST_MATH_BONE_COUNT);
+    TEST_ASSERT_EQUAL_INT(1, cache.set_count);
+
+    Matrix matrices[TEST_MATH_BONE_COUNT] = {};
+    MathBoneTRS trs[TEST_MATH_BONE_COUNT] = {};
+    for (U64 i = 0; i < MATH_BONE_CACHE_WAYS; ++i) {
+        i_test_math_fill(i, matrices);
+        math_bone_cache_put(&cache, i, matrices, trs, TEST_MATH_BONE_COUNT);
+    }
+    TEST_ASSERT_EQUAL_INT(MATH_BONE_CACHE_WAYS, math_bone_cache_get_stats(&cache).used_slot_count);
+
+    // Key 0 keeps getting hit, so CLOCK gives it a second chance and evicts one of the cold keys instead
+    TEST_ASSERT_TRUE(math_bone_cache_get(&cache, 0, matrices, TEST_MATH_BONE_COUNT));
+    i_test_math_fill(100, matrices);
+    math_bone_cache_put(&cache, 100, matrices, trs, TEST_MATH_BONE_COUNT);
+
+    MathBoneCacheStats const stats = math_bone_cache_get_stats(&cache);
+    TEST_ASSERT_EQUAL_UINT64(1, stats.evictions);
+    TEST_ASSERT_TRUE(math_bone_cache_get(&cache, 0, matrices, TEST_MATH_BONE_COUNT));
+    TEST_ASSERT_TRUE(i_test_math_check(0, matrices));
+    TEST_ASSERT_TRUE(math_bone_cache_get(&cache, 100, matrices, TEST_MATH_BONE_COUNT));
+    TEST_ASSERT_TRUE(i_test_math_check(100, matrices));
+}
+
+struct TestMathStressContext {
+    MathBoneCache *cache;
+    std::atomic<U64> corrupt_reads;
+    std::atomic<U64> ops;
+};
+
+// Same pattern as math_compute_entity_bone_matrices, look up, compute on a miss and publish
+S32 static i_test_math_stress_range(U32 begin, U32 end, void *ctx) {
+    auto *stress = (TestMathStressContext *)ctx;
+    U64 state    = ((U64)begin * 0x9E3779B97F4A7C15ULL) | 1;
+    U64 corrupt  = 0;
+
+    Matrix matrices[TEST_MATH_BONE_COUNT] = {};
+    MathBoneTRS trs[TEST_MATH_BONE_COUNT] = {};
+    for (U32 i = begin; i < end; ++i) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+
+        // Skewed towards the low keys so there are hot entries to keep as well as cold ones to evict
+        U64 const r   = state % TEST_MATH_STRESS_KEYS;
+        U64 const key = MATH_BONE_CACHE_KEY(0xB0DE, (r * r) / TEST_MATH_STRESS_KEYS, r);
+
+        if (math_bone_cache_get(stress->cache, key, matrices, TEST_MATH_BONE_COUNT)) {
+            if (!i_test_math_check(key, matrices)) { corrupt++; }
+        } else {
+            i_test_math_fill(key, matrices);
+            math_bone_cache_put(stress->cache, key, matrices, trs, TEST_MATH_BONE_COUNT);
+        }
+    }
+
+    stress->corrupt_reads.fetch_add(corrupt, std::memory_order_relaxed);
+    stress->ops.fetch_add(end - begin, std::memory_order_relaxed);
+    return 0;
+}
+
+void static test_math_bone_cache_stress() {
+    MathBoneCache cache = {};
+    math_bone_cache_init(&cache, MEMORY_TYPE_ARENA_TRANSIENT, i_test_math_bone_cache_budget(TEST_MATH_BONE_CACHE_SETS), TEST_MATH_BONE_COUNT);
+
+    TestMathStressContext stress = {};
+    stress.cache                 = &cache;
+
+    F64 const start_time = time_get_glfw_f64();
+    job_wait(job_parallel_for(0, TEST_MATH_STRESS_OPS, TEST_MATH_STRESS_GRAIN, i_test_math_stress_range, &stress));
+    F64 const elapsed = time_get_glfw_f64() - start_time;
+
+    MathBoneCacheStats const stats = math_bone_cache_get_stats(&cache);
+    TEST_ASSERT_EQUAL_UINT64(TEST_MATH_STRESS_OPS, stress.ops.load());
+    TEST_ASSERT_EQUAL_UINT64(0, stress.corrupt_reads.load());
+    TEST_ASSERT_EQUAL_UINT64(TEST_MATH_STRESS_OPS, stats.hits + stats.misses);
+    TEST_ASSERT_TRUE(stats.hits > 0);
+    TEST_ASSERT_TRUE(stats.evictions > 0);
+    TEST_ASSERT_TRUE(stats.used_slot_count <= stats.slot_count);
+
+    // Every slot still holds exactly what its key says
+    for (SZ i = 0; i < cache.slot_count; ++i) {
+        MathBoneCacheSlot const *slot = &cache.slots[i];
+        if (slot->version.load() == 0) { continue; }
+        TEST_ASSERT_EQUAL_INT(0, slot->version.load() & 1);
+        TEST_ASSERT_TRUE(i_test_math_check(slot->key.load(), slot->bone_matrices));
+    }
+
+    lli("Bone cache stress on %u threads: %d ops in %.3fms, %" PRIu64 " hits, %" PRIu64 " misses, %" PRIu64 " evictions, %" PRIu64 " skipped",
+        job_system_get_thread_count(), TEST_MATH_STRESS_OPS, elapsed * 1e3, stats.hits, stats.misses, stats.evictions, stats.skipped_inserts);
+}
+
+// Random but valid bone: unit rotation, positive scale
+MathBoneTRS static i_test_math_random_trs(U64 *state) {
+    F32 v[10];
+    for (F32 &f : v) {
+        *state ^= *state << 13;
+        *state ^= *state >> 7;
+        *state ^= *state << 17;
+        f        = ((F32)(*state % 20'001) / 10'000.0F) - 1.0F;
+    }
+    MathBoneTRS trs = {};
+    trs.translation = {v[0] * 5.0F, v[1] * 5.0F, v[2] * 5.0F};
+    trs.rotation    = QuaternionNormalize({v[3], v[4], v[5], v[6] + 0.01F});
+    trs.scale       = {1.5F + v[7], 1.5F + v[8], 1.5F + v[9]};
+    return trs;
+}
+
+// What blending did before batching, QuaternionSlerp and matrix multiplies per bone
+Matrix static i_test_math_blend_reference(MathBoneTRS const *prev, MathBoneTRS const *next, F32 t) {
+    Vector3 const translation = Vector3Lerp(prev->translation, next->translation, t);
+    Quaternion const rotation = QuaternionSlerp(prev->rotation, next->rotation, t);
+    Vector3 const scale       = Vector3Lerp(prev->scale, next->scale, t);
+    return MatrixMultiply(MatrixMultiply(MatrixScale(scale.x, scale.y, scale.z), QuaternionToMatrix(rotation)),
+                          MatrixTranslate(translation.x, translation.y, translation.z));
+}
+
+void static test_math_bone_blend_batch() {
+    auto *prev     = mmta(MathBoneTRS *, sizeof(MathBoneTRS) * TEST_MATH_BLEND_BONES);
+    auto *next     = mmta(MathBoneTRS *, sizeof(MathBoneTRS) * TEST_MATH_BLEND_BONES);
+    auto *t        = mmta(F32 *, sizeof(F32) * TEST_MATH_BLEND_BONES);
+    auto *out      = mmta(Matrix *, sizeof(Matrix) * TEST_MATH_BLEND_BONES);
+    U64 state      = 0x5EED;
+    for (SZ i = 0; i < TEST_MATH_BLEND_BONES; ++i) {
+        prev[i] = i_test_math_random_trs(&state);
+        next[i] = i_test_math_random_trs(&state);
+        t[i]    = (F32)(i % 101) / 100.0F;  // Includes both ends
+    }
+
+    // Not a multiple of the batch or the SIMD width, so the automatic flush and the padded lanes both get hit
+    auto *batch  = mmta(MathBoneBlendBatch *, sizeof(MathBoneBlendBatch));
+    batch->count = 0;
+    for (SZ i = 0; i < TEST_MATH_BLEND_BONES; ++i) { math_bone_blend_batch_add(batch, &prev[i], &next[i], t[i], &out[i]); }
+    TEST_ASSERT_TRUE(batch->count > 0);
+    math_bone_blend_batch_flush(batch);
+    TEST_ASSERT_EQUAL_INT(0, batch->count);
+
+    F32 max_error = 0.0F;
+    for (SZ i = 0; i < TEST_MATH_BLEND_BONES; ++i) {
+        float16 const expected = MatrixToFloatV(i_test_math_blend_reference(&prev[i], &next[i], t[i]));
+        float16 const actual   = MatrixToFloatV(out[i]);
+        for (SZ j = 0; j < 16; ++j) { max_error = glm::max(max_error, glm::abs(expected.v[j] - actual.v[j])); }
+    }
+
+    // The slerp is approximated, scale goes up to 2.5 and translation up to 5
+    lli("Bone blend batch: max error %.6f against QuaternionSlerp over %d bones", max_error, TEST_MATH_BLEND_BONES);
+    TEST_ASSERT_TRUE(max_error < 5e-3F);
+
+    // t = 0 is the previous pose, t = 1 the next one
+    Matrix const at_prev = i_test_math_blend_reference(&prev[0], &prev[0], 0.0F);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4F, at_prev.m12, out[0].m12);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4F, at_prev.m0, out[0].m0);
+    TEST_ASSERT_EQUAL_FLOAT(1.0F, out[0].m15);
+    TEST_ASSERT_EQUAL_FLOAT(0.0F, out[0].m3);
+}
+
+void static test_math_bone_blend_performance_benchmark() {
+    auto *prev  = mmta(MathBoneTRS *, sizeof(MathBoneTRS) * TEST_MATH_BLEND_BENCH_BONES);
+    auto *next  = mmta(MathBoneTRS *, sizeof(MathBoneTRS) * TEST_MATH_BLEND_BENCH_BONES);
+    auto *prevm = mmta(Matrix *, sizeof(Matrix) * TEST_MATH_BLEND_BENCH_BONES);
+    auto *nextm = mmta(Matrix *, sizeof(Matrix) * TEST_MATH_BLEND_BENCH_BONES);
+    auto *out   = mmta(Matrix *, sizeof(Matrix) * TEST_MATH_BLEND_BENCH_BONES);
+    U64 state   = 0xB1E4D;
+    for (SZ i = 0; i < TEST_MATH_BLEND_BENCH_BONES; ++i) {
+        prev[i]  = i_test_math_random_trs(&state);
+        next[i]  = i_test_math_random_trs(&state);
+        prevm[i] = i_test_math_blend_reference(&prev[i], &prev[i], 0.0F);
+        nextm[i] = i_test_math_blend_reference(&next[i], &next[i], 0.0F);
+    }
+
+    // Old path, decompose both matrices of every bone every frame, then slerp and multiply back together
+    F64 start_time = time_get_glfw_f64();
+    for (SZ i = 0; i < TEST_MATH_BLEND_BENCH_BONES; ++i) {
+        MathBoneTRS a = {};
+        MathBoneTRS b = {};
+        math_bone_trs_from_matrix(prevm[i], &a);
+        math_bone_trs_from_matrix(nextm[i], &b);
+        out[i] = i_test_math_blend_reference(&a, &b, 0.5F);
+    }
+    F64 const scalar_time = time_get_glfw_f64() - start_time;
+    Matrix const scalar_last = out[TEST_MATH_BLEND_BENCH_BONES - 1];
+
+    auto *batch  = mmta(MathBoneBlendBatch *, sizeof(MathBoneBlendBatch));
+    batch->count = 0;
+    start_time   = time_get_glfw_f64();
+    for (SZ i = 0; i < TEST_MATH_BLEND_BENCH_BONES; ++i) { math_bone_blend_batch_add(batch, &prev[i], &next[i], 0.5F, &out[i]); }
+    math_bone_blend_batch_flush(batch);
+    F64 const batch_time = time_get_glfw_f64() - start_time;
+
+    TEST_ASSERT_FLOAT_WITHIN(1e-2F, scalar_last.m12, out[TEST_MATH_BLEND_BENCH_BONES - 1].m12);
+    lli("Blending %d bones: scalar %.1f bones/us, batch %.1f bones/us", TEST_MATH_BLEND_BENCH_BONES,
+        (F64)TEST_MATH_BLEND_BENCH_BONES / glm::max(scalar_time * 1e6, 1e-3), (F64)TEST_MATH_BLEND_BENCH_BONES / glm::max(batch_time * 1e6, 1e-3));
+}
+
+void test_math() {
+    RUN_TEST(test_math_bone_cache_get_put);
+    RUN_TEST(test_math_bone_cache_clock_eviction);
+    RUN_TEST(test_math_bone_cache_stress);
+    RUN_TEST(test_math_bone_blend_batch);
+    RUN_TEST(test_math_bone_blend_performance_benchmark);
+}
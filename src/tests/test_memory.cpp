@@ -0,0 +1,205 @@
+#include "job.hpp"
+#include "log.hpp"
+#include "memory.hpp"
+#include "std.hpp"
+#include "test.hpp"
+#include "time.hpp"
+#include "unit.hpp"
+
+#include <unity.h>
+
+#define TEST_MEMORY_BENCH_ALLOCS_PER_JOB 100'000
+#define TEST_MEMORY_BENCH_ALLOC_SIZE 48
+
+struct TestMemoryJobData {
+    BOOL use_shared;
+    U32 job_index;
+    U32 alloc_count;
+    U8 **ptrs;
+    BOOL ok;
+};
+
+S32 static i_test_memory_alloc_job(void *arg) {
+    auto *data = (TestMemoryJobData *)arg;
+    data->ok   = true;
+
+    for (U32 i = 0; i < data->alloc_count; ++i) {
+        U8 *ptr = data->use_shared ? (U8 *)memory_malloc_shared(TEST_MEMORY_BENCH_ALLOC_SIZE, MEMORY_TYPE_ARENA_TRANSIENT)
+                                   : (U8 *)memory_malloc(TEST_MEMORY_BENCH_ALLOC_SIZE, MEMORY_TYPE_ARENA_TRANSIENT);
+        if (!ptr) {
+            data->ok = false;
+            return 1;
+        }
+
+        // Stamp the allocation so that overlapping handouts between threads show up afterwards.
+        ou_memset(ptr, (S32)(data->job_index + 1), TEST_MEMORY_BENCH_ALLOC_SIZE);
+        if (data->ptrs) { data->ptrs[i] = ptr; }
+    }
+
+    return 0;
+}
+
+// NOTE: The calling thread might be at the very end of its chunk, a refill then lands in between the allocations.
+// A fresh chunk always fits the whole sequence so one retry is enough to see the in-chunk behaviour.
+#define TEST_MEMORY_CHUNK_ATTEMPTS 2
+
+void static test_memory_thread_chunk_bump() {
+    BOOL contiguous = false;
+
+    for (U32 attempt = 0; attempt < TEST_MEMORY_CHUNK_ATTEMPTS && !contiguous; ++attempt) {
+        auto *a = mmta(U8 *, 24);
+        auto *b = mmta(U8 *, 24);
+        TEST_ASSERT_NOT_NULL(a);
+        TEST_ASSERT_NOT_NULL(b);
+        TEST_ASSERT_EQUAL_INT(0, (SZ)a % 64);
+        TEST_ASSERT_EQUAL_INT(0, (SZ)b % 64);
+
+        // Consecutive small allocations on one thread come out of the same chunk back to back.
+        contiguous = b == a + 64;
+    }
+
+    TEST_ASSERT_TRUE(contiguous);
+}
+
+void static test_memory_thread_chunk_realloc_in_place() {
+    BOOL in_place = false;
+    U8 *grown     = nullptr;
+
+    for (U32 attempt = 0; attempt < TEST_MEMORY_CHUNK_ATTEMPTS && !in_place; ++attempt) {
+        auto *a = mmta(U8 *, 32);
+        TEST_ASSERT_NOT_NULL(a);
+        ou_memset(a, 7, 32);
+
+        // The last allocation of a chunk grows without moving.
+        grown    = mrta(U8 *, a, 32, 512);
+        in_place = grown == a;
+        TEST_ASSERT_EQUAL_INT(7, grown[31]);
+    }
+
+    TEST_ASSERT_TRUE(in_place);
+
+    // Once something else was allocated after it, realloc has to copy.
+    auto *other = mmta(U8 *, 16);
+    auto *moved = mrta(U8 *, grown, 512, 1024);
+    TEST_ASSERT_NOT_NULL(other);
+    TEST_ASSERT_TRUE(moved != grown);
+    TEST_ASSERT_EQUAL_INT(7, moved[0]);
+    TEST_ASSERT_EQUAL_INT(7, moved[31]);
+}
+
+void static test_memory_large_allocation_bypasses_chunk() {
+    BOOL contiguous = false;
+
+    for (U32 attempt = 0; attempt < TEST_MEMORY_CHUNK_ATTEMPTS && !contiguous; ++attempt) {
+        auto *small = mmta(U8 *, 16);
+        auto *large = mmta(U8 *, ARENA_THREAD_CHUNK_MAX_ALLOC + 1);
+        auto *next  = mmta(U8 *, 16);
+        TEST_ASSERT_NOT_NULL(small);
+        TEST_ASSERT_NOT_NULL(large);
+
+        // The large one came from the shared arenas, so the chunk keeps bumping where it left off.
+        contiguous = next == small + 64;
+    }
+
+    TEST_ASSERT_TRUE(contiguous);
+}
+
+void static test_memory_thread_chunks_do_not_overlap() {
+    U32 const worker_count = job_system_get_worker_count();
+    if (worker_count == 0) { return; }
+
+    U32 const allocs_per_job = 4096;
+    auto *job_data = mcta(TestMemoryJobData *, worker_count, sizeof(TestMemoryJobData));
+
+    for (U32 i = 0; i < worker_count; ++i) {
+        job_data[i].job_index   = i;
+        job_data[i].alloc_count = allocs_per_job;
+        job_data[i].ptrs        = mmta(U8 **, sizeof(U8 *) * allocs_per_job);
+        job_system_submit(i_test_memory_alloc_job, &job_data[i]);
+    }
+    job_system_wait();
+
+    // Every allocation still has to carry the stamp of the job that got it.
+    for (U32 i = 0; i < worker_count; ++i) {
+        TEST_ASSERT_TRUE(job_data[i].ok);
+        for (U32 j = 0; j < allocs_per_job; ++j) {
+            U8 const *ptr = job_data[i].ptrs[j];
+            TEST_ASSERT_EQUAL_INT((S32)(i + 1), ptr[0]);
+            TEST_ASSERT_EQUAL_INT((S32)(i + 1), ptr[TEST_MEMORY_BENCH_ALLOC_SIZE - 1]);
+        }
+    }
+}
+
+void static test_memory_allocation_count() {
+    // Enough small allocations to refill the chunk a few times, every single one counts and the refills do not
+    SZ const small_count = (3 * ARENA_THREAD_CHUNK_SIZE) / 64;
+    SZ const before      = memory_get_current_arena_stats(MEMORY_TYPE_ARENA_TRANSIENT).total_allocation_count;
+    for (SZ i = 0; i < small_count; ++i) { TEST_ASSERT_NOT_NULL(mmta(U8 *, 16)); }
+    TEST_ASSERT_NOT_NULL(mmta(U8 *, ARENA_THREAD_CHUNK_MAX_ALLOC + 1));
+    SZ const after = memory_get_current_arena_stats(MEMORY_TYPE_ARENA_TRANSIENT).total_allocation_count;
+    TEST_ASSERT_EQUAL_UINT64(small_count + 1, after - before);
+
+    // Worker threads count the same, whether their chunks refill or not
+    U32 const worker_count = job_system_get_worker_count();
+    if (worker_count == 0) { return; }
+
+    auto *job_data = mcta(TestMemoryJobData *, worker_count, sizeof(TestMemoryJobData));
+    SZ const start = memory_get_current_arena_stats(MEMORY_TYPE_ARENA_TRANSIENT).total_allocation_count;
+    for (U32 i = 0; i < worker_count; ++i) {
+        job_data[i].job_index   = i;
+        job_data[i].alloc_count = 1000 + i;
+        job_system_submit(i_test_memory_alloc_job, &job_data[i]);
+    }
+    job_system_wait();
+
+    SZ expected = 0;
+    for (U32 i = 0; i < worker_count; ++i) {
+        TEST_ASSERT_TRUE(job_data[i].ok);
+        expected += job_data[i].alloc_count;
+    }
+    TEST_ASSERT_EQUAL_UINT64(expected, memory_get_current_arena_stats(MEMORY_TYPE_ARENA_TRANSIENT).total_allocation_count - start);
+}
+
+F64 static i_test_memory_run_contention(BOOL use_shared, U32 worker_count) {
+    auto *job_data = mcta(TestMemoryJobData *, worker_count, sizeof(TestMemoryJobData));
+
+    F64 const start_time = time_get_glfw_f64();
+    for (U32 i = 0; i < worker_count; ++i) {
+        job_data[i].use_shared  = use_shared;
+        job_data[i].job_index   = i;
+        job_data[i].alloc_count = TEST_MEMORY_BENCH_ALLOCS_PER_JOB;
+        job_system_submit(i_test_memory_alloc_job, &job_data[i]);
+    }
+    job_system_wait();
+    F64 const elapsed = time_get_glfw_f64() - start_time;
+
+    for (U32 i = 0; i < worker_count; ++i) { TEST_ASSERT_TRUE(job_data[i].ok); }
+
+    return elapsed;
+}
+
+void static test_memory_contention_performance_benchmark() {
+    U32 const worker_count = job_system_get_worker_count();
+    if (worker_count == 0) { return; }
+
+    C8 pretty_buffer_shared[PRETTY_BUFFER_SIZE] = {};
+    C8 pretty_buffer_thread[PRETTY_BUFFER_SIZE] = {};
+
+    F64 const total_allocs = (F64)worker_count * TEST_MEMORY_BENCH_ALLOCS_PER_JOB;
+    F64 const shared_time  = i_test_memory_run_contention(true, worker_count);
+    F64 const thread_time  = i_test_memory_run_contention(false, worker_count);
+
+    unit_to_pretty_prefix_f("op/s", total_allocs / shared_time, pretty_buffer_shared, PRETTY_BUFFER_SIZE, UNIT_PREFIX_MEGA);
+    unit_to_pretty_prefix_f("op/s", total_allocs / thread_time, pretty_buffer_thread, PRETTY_BUFFER_SIZE, UNIT_PREFIX_MEGA);
+    lli("Memory Contention: %u threads x %d allocs, shared lock %.8fs (%s), thread chunks %.8fs (%s), %.2fx",
+        worker_count, TEST_MEMORY_BENCH_ALLOCS_PER_JOB, shared_time, pretty_buffer_shared, thread_time, pretty_buffer_thread, shared_time / thread_time);
+}
+
+void test_memory() {
+    RUN_TEST(test_memory_thread_chunk_bump);
+    RUN_TEST(test_memory_thread_chunk_realloc_in_place);
+    RUN_TEST(test_memory_large_allocation_bypasses_chunk);
+    RUN_TEST(test_memory_thread_chunks_do_not_overlap);
+    RUN_TEST(test_memory_allocation_count);
+    RUN_TEST(test_memory_contention_performance_benchmark);
+}
@@ -0,0 +1,317 @@
+#include "asset.hpp"
+#include "job.hpp"
+#include "log.hpp"
+#include "memory.hpp"
+#include "nav.hpp"
+#include "std.hpp"
+#include "test.hpp"
+#include "time.hpp"
+#include "unit.hpp"
+
+#include <glm/common.hpp>
+#include <raymath.h>
+#include <unity.h>
+
+#define TEST_NAV_CELL_SIZE 2.0F
+#define TEST_NAV_FLOW_WALK_STEPS 200
+#define TEST_NAV_TERRAIN_SIZE 256.0F
+#define TEST_NAV_TERRAIN_SAMPLES 65
+#define TEST_NAV_BENCH_SIZE 150
+#define TEST_NAV_BENCH_BLOCKED_PERCENT 15
+#define TEST_NAV_BENCH_LATENCY_PATHS 500
+#define TEST_NAV_BENCH_REQUEST_COUNT 2000
+#define TEST_NAV_BENCH_FRAME_BUDGET 0.002  // Same as the world__path_budget_ms default
+
+// Headless graphs only, cell x/z sits at x/z * TEST_NAV_CELL_SIZE
+Nav static *i_test_nav_create(S32 width, S32 height) {
+    auto *nav = mmta(Nav *, sizeof(Nav));
+    ou_memset(nav, 0, sizeof(Nav));
+    nav_reset(nav);
+    nav_set_graph(nav, width, height, TEST_NAV_CELL_SIZE, {0.0F, 0.0F}, nav, MEMORY_TYPE_ARENA_TRANSIENT);
+    return nav;
+}
+
+Vector3 static i_test_nav_at(S32 x, S32 z) {
+    return {(F32)x * TEST_NAV_CELL_SIZE, 0.0F, (F32)z * TEST_NAV_CELL_SIZE};
+}
+
+// Samples every segment in quarter cells, none of them may cross a blocked cell other than the goal
+BOOL static i_test_nav_path_is_walkable(Nav const *nav, Vector3 from, NavPath const *path) {
+    S32 const goal = nav_get_cell(nav, path->points[path->count - 1]);
+    Vector3 prev   = from;
+    for (U32 i = 0; i < path->count; ++i) {
+        Vector3 const next = {path->points[i].x, 0.0F, path->points[i].z};
+        S32 const steps    = (S32)(Vector3Distance(prev, next) / (nav->graph.cell_size * 0.25F)) + 1;
+        for (S32 step = 0; step <= steps; ++step) {
+            S32 const cell = nav_get_cell(nav, Vector3Lerp(prev, next, (F32)step / (F32)steps));
+            if (cell != goal && cell != nav_get_cell(nav, from) && nav->graph.cost[cell] == NAV_COST_BLOCKED) { return false; }
+        }
+        prev = next;
+    }
+    return true;
+}
+
+void static test_nav_path_around_wall() {
+    // Wall down the middle with a gap at the top
+    Nav *nav = i_test_nav_create(32, 32);
+    for (S32 z = 0; z < 28; ++z) { nav_set_cell_cost(nav, 16, z, NAV_COST_BLOCKED); }
+
+    Vector3 const from = i_test_nav_at(4, 4);
+    Vector3 const to   = i_test_nav_at(28, 4);
+    NavPath path       = {};
+    TEST_ASSERT_TRUE(nav_find_path(nav, from, to, &path));
+    TEST_ASSERT_FALSE(path.partial);
+    TEST_ASSERT_TRUE(path.count >= 2);
+    TEST_ASSERT_TRUE(i_test_nav_path_is_walkable(nav, from, &path));
+    TEST_ASSERT_EQUAL_FLOAT(to.x, path.points[path.count - 1].x);
+    TEST_ASSERT_EQUAL_FLOAT(to.z, path.points[path.count - 1].z);
+
+    // Smoothed down to the corners around the end of the wall
+    BOOL through_gap = false;
+    for (U32 i = 0; i < path.count; ++i) { through_gap |= path.points[i].z >= 27.0F * TEST_NAV_CELL_SIZE; }
+    TEST_ASSERT_TRUE(through_gap);
+    TEST_ASSERT_TRUE(path.count <= 4);
+
+    // Same cell, only the goal itself
+    TEST_ASSERT_TRUE(nav_find_path(nav, from, {from.x + 0.1F, 0.0F, from.z}, &path));
+    TEST_ASSERT_EQUAL_UINT32(1, path.count);
+}
+
+void static test_nav_unreachable_fails() {
+    // Goal boxed in, diagonal corners included
+    Nav *nav = i_test_nav_create(16, 16);
+    for (S32 z = 9; z <= 11; ++z) {
+        for (S32 x = 9; x <= 11; ++x) {
+            if (x != 10 || z != 10) { nav_set_cell_cost(nav, x, z, NAV_COST_BLOCKED); }
+        }
+    }
+
+    NavPath path = {};
+    TEST_ASSERT_FALSE(nav_find_path(nav, i_test_nav_at(1, 1), i_test_nav_at(10, 10), &path));
+
+    NavHandle const handle = nav_request_path(nav, i_test_nav_at(1, 1), i_test_nav_at(10, 10));
+    TEST_ASSERT_EQUAL_INT(NAV_STATE_QUEUED, nav_get_state(nav, handle));
+    nav_update(nav, 1.0);
+    TEST_ASSERT_EQUAL_INT(NAV_STATE_FAILED, nav_get_state(nav, handle));
+    TEST_ASSERT_NULL(nav_get_path(nav, handle));
+    TEST_ASSERT_EQUAL_UINT64(1, nav_get_stats(nav).paths_failed);
+
+    // Standing in a blocked cell is no reason to fail, it can always be left
+    TEST_ASSERT_TRUE(nav_find_path(nav, i_test_nav_at(9, 9), i_test_nav_at(1, 1), &path));
+
+    nav_release(nav, handle);
+    TEST_ASSERT_EQUAL_INT(NAV_STATE_FREE, nav_get_state(nav, handle));
+}
+
+void static test_nav_terrain_slope_costs() {
+    // Ridge across the middle with a way around its end, a gentle ramp in one corner
+    auto *height_field = mcta(F32 *, TEST_NAV_TERRAIN_SAMPLES * TEST_NAV_TERRAIN_SAMPLES, sizeof(F32));
+    F32 const spacing  = TEST_NAV_TERRAIN_SIZE / (F32)(TEST_NAV_TERRAIN_SAMPLES - 1);
+    for (S32 z = 0; z < TEST_NAV_TERRAIN_SAMPLES; ++z) {
+        for (S32 x = 0; x < TEST_NAV_TERRAIN_SAMPLES; ++x) {
+            F32 const world_x = (F32)x * spacing;
+            F32 const world_z = (F32)z * spacing;
+            F32 height        = 0.0F;
+            if (world_x >= 128.0F && world_x < 136.0F && world_z < 192.0F) { height = 40.0F; }
+            if (world_x < 64.0F && world_z < 48.0F) { height = world_x * 0.3F; }
+            height_field[(z * TEST_NAV_TERRAIN_SAMPLES) + x] = height;
+        }
+    }
+
+    ATerrain terrain            = {};
+    terrain.dimensions          = {TEST_NAV_TERRAIN_SIZE, 40.0F, TEST_NAV_TERRAIN_SIZE};
+    terrain.height_field        = height_field;
+    terrain.height_field_width  = TEST_NAV_TERRAIN_SAMPLES;
+    terrain.height_field_height = TEST_NAV_TERRAIN_SAMPLES;
+
+    auto *nav = mmta(Nav *, sizeof(Nav));
+    ou_memset(nav, 0, sizeof(Nav));
+    nav_reset(nav);
+    nav_build_from_terrain(nav, &terrain, 64, MEMORY_TYPE_ARENA_TRANSIENT);
+    TEST_ASSERT_EQUAL_INT(64, nav->graph.width);
+    TEST_ASSERT_EQUAL_FLOAT(4.0F, nav->graph.cell_size);
+
+    U8 const flat  = nav->graph.cost[nav_get_cell(nav, {100.0F, 0.0F, 230.0F})];
+    U8 const ramp  = nav->graph.cost[nav_get_cell(nav, {30.0F, 0.0F, 20.0F})];
+    U8 const cliff = nav->graph.cost[nav_get_cell(nav, {126.0F, 0.0F, 100.0F})];
+    TEST_ASSERT_EQUAL_UINT8(NAV_COST_FLAT, flat);
+    TEST_ASSERT_TRUE(ramp > NAV_COST_FLAT && ramp < NAV_COST_SLOPE_MAX);
+    TEST_ASSERT_EQUAL_UINT8(NAV_COST_BLOCKED, cliff);
+
+    // Building from the same terrain again keeps the graph
+    U32 const version = nav->graph.version;
+    nav_build_from_terrain(nav, &terrain, 64, MEMORY_TYPE_ARENA_TRANSIENT);
+    TEST_ASSERT_EQUAL_UINT32(version, nav->graph.version);
+
+    // Over the ridge is no option, around its end is
+    Vector3 const from = {60.0F, 0.0F, 100.0F};
+    Vector3 const to   = {120.0F, 0.0F, 100.0F};
+    NavPath path       = {};
+    TEST_ASSERT_TRUE(nav_find_path(nav, from, {200.0F, 0.0F, 100.0F}, &path));
+    TEST_ASSERT_TRUE(i_test_nav_path_is_walkable(nav, from, &path));
+    BOOL around = false;
+    for (U32 i = 0; i < path.count; ++i) { around |= path.points[i].z >= 188.0F; }
+    TEST_ASSERT_TRUE(around);
+
+    // Open flat ground is a single straight segment
+    TEST_ASSERT_TRUE(nav_find_path(nav, from, to, &path));
+    TEST_ASSERT_EQUAL_UINT32(1, path.count);
+}
+
+void static test_nav_flow_field_shared() {
+    // Scattered obstacles, the field has to lead everyone around them
+    Nav *nav = i_test_nav_create(48, 48);
+    for (S32 i = 0; i < 200; ++i) {
+        U32 const hash = test_hash((U32)i + 1U);
+        nav_set_cell_cost(nav, (S32)(hash % 48), (S32)((hash >> 8) % 48), NAV_COST_BLOCKED);
+    }
+    Vector3 const goal = i_test_nav_at(24, 24);
+    nav_set_cell_cost(nav, 24, 24, NAV_COST_FLAT);
+
+    NavHandle const first  = nav_acquire_flow_field(nav, goal);
+    NavHandle const second = nav_acquire_flow_field(nav, {goal.x + 0.5F, 0.0F, goal.z});
+    TEST_ASSERT_NOT_EQUAL(NAV_INVALID_HANDLE, first);
+    TEST_ASSERT_EQUAL_UINT32(first, second);
+    TEST_ASSERT_EQUAL_INT(NAV_STATE_QUEUED, nav_get_flow_field_state(nav, first));
+
+    nav_update(nav, 1.0);
+    TEST_ASSERT_EQUAL_INT(NAV_STATE_READY, nav_get_flow_field_state(nav, first));
+    TEST_ASSERT_EQUAL_UINT64(1, nav_get_stats(nav).fields_solved);
+
+    // Walking from waypoint to waypoint reaches the goal from anywhere the goal can be reached from
+    S32 walkers = 0;
+    for (S32 i = 0; i < 64; ++i) {
+        U32 const hash   = test_hash((U32)(1001 + i));
+        Vector3 position = i_test_nav_at((S32)(hash % 48), (S32)((hash >> 8) % 48));
+        NavPath reference = {};
+        if (!nav_find_path(nav, position, goal, &reference)) { continue; }
+
+        walkers++;
+        Vector3 waypoint = position;
+        for (S32 step = 0; step < TEST_NAV_FLOW_WALK_STEPS && nav_get_cell(nav, position) != nav_get_cell(nav, goal); ++step) {
+            TEST_ASSERT_TRUE(nav_flow_field_steer(nav, first, position, &waypoint));
+            position = {waypoint.x, 0.0F, waypoint.z};
+        }
+        TEST_ASSERT_EQUAL_INT(nav_get_cell(nav, goal), nav_get_cell(nav, position));
+    }
+    TEST_ASSERT_TRUE(walkers > 0);
+
+    // Every slot held for another goal, nothing left to hand out until one of them lets go
+    nav_release_flow_field(nav, first);
+    nav_release_flow_field(nav, second);
+    NavHandle held[NAV_FLOW_FIELD_MAX] = {};
+    for (S32 i = 0; i < NAV_FLOW_FIELD_MAX; ++i) {
+        held[i] = nav_acquire_flow_field(nav, i_test_nav_at(i, 0));
+        TEST_ASSERT_NOT_EQUAL(NAV_INVALID_HANDLE, held[i]);
+    }
+    TEST_ASSERT_EQUAL_INT(NAV_STATE_FREE, nav_get_flow_field_state(nav, first));
+    TEST_ASSERT_EQUAL_UINT32(NAV_INVALID_HANDLE, nav_acquire_flow_field(nav, i_test_nav_at(40, 40)));
+
+    nav_release_flow_field(nav, held[3]);
+    NavHandle const replacement = nav_acquire_flow_field(nav, i_test_nav_at(40, 40));
+    TEST_ASSERT_NOT_EQUAL(NAV_INVALID_HANDLE, replacement);
+    TEST_ASSERT_EQUAL_INT(NAV_STATE_FREE, nav_get_flow_field_state(nav, held[3]));
+}
+
+void static test_nav_budget_keeps_requests_queued() {
+    Nav *nav = i_test_nav_create(64, 64);
+
+    NavHandle handles[200] = {};
+    for (U32 i = 0; i < 200; ++i) {
+        U32 const hash = test_hash(i + 1U);
+        handles[i]     = nav_request_path(nav, i_test_nav_at((S32)(hash % 64), 0), i_test_nav_at((S32)((hash >> 8) % 64), 63));
+    }
+
+    // A cancelled request never gets solved and gives its slot back once the queue got to it
+    nav_release(nav, handles[0]);
+    TEST_ASSERT_EQUAL_INT(NAV_STATE_FREE, nav_get_state(nav, handles[0]));
+
+    // No budget still runs one batch, so nothing starves
+    nav_update(nav, 0.0);
+    NavStats stats = nav_get_stats(nav);
+    TEST_ASSERT_EQUAL_UINT64(1, stats.batches);
+    TEST_ASSERT_TRUE(stats.paths_solved > 0);
+    TEST_ASSERT_EQUAL_UINT32(199 - stats.paths_solved, stats.queued);
+    TEST_ASSERT_EQUAL_INT(NAV_STATE_READY, nav_get_state(nav, handles[1]));
+    TEST_ASSERT_EQUAL_INT(NAV_STATE_QUEUED, nav_get_state(nav, handles[199]));
+
+    // Oldest first, the waiting shows in the stats
+    for (S32 frame = 0; frame < 200 && nav_get_stats(nav).queued > 0; ++frame) { nav_update(nav, 0.0); }
+    stats = nav_get_stats(nav);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.queued);
+    TEST_ASSERT_EQUAL_UINT64(199, stats.paths_solved);
+    TEST_ASSERT_TRUE(stats.max_wait_frames > 0);
+
+    for (U32 i = 1; i < 200; ++i) {
+        NavPath const *path = nav_get_path(nav, handles[i]);
+        TEST_ASSERT_NOT_NULL(path);
+        nav_release(nav, handles[i]);
+    }
+    TEST_ASSERT_EQUAL_UINT32(NAV_REQUEST_MAX, nav->free_count);
+}
+
+void static test_nav_performance_benchmark() {
+    C8 pretty_buffer[PRETTY_BUFFER_SIZE] = {};
+
+    // Overworld sized grid with scattered blocked cells
+    Nav *nav = i_test_nav_create(TEST_NAV_BENCH_SIZE, TEST_NAV_BENCH_SIZE);
+    for (S32 z = 0; z < TEST_NAV_BENCH_SIZE; ++z) {
+        for (S32 x = 0; x < TEST_NAV_BENCH_SIZE; ++x) {
+            U32 const hash = test_hash((U32)((z * TEST_NAV_BENCH_SIZE) + x) + 1U);
+            if ((hash >> 16) % 100 < TEST_NAV_BENCH_BLOCKED_PERCENT) { nav_set_cell_cost(nav, x, z, NAV_COST_BLOCKED); }
+        }
+    }
+    auto const random_position = [](U32 seed) {
+        U32 const hash = test_hash(seed + 1U);
+        return i_test_nav_at((S32)(hash % TEST_NAV_BENCH_SIZE), (S32)((hash >> 8) % TEST_NAV_BENCH_SIZE));
+    };
+
+    // Latency, one path at a time on this thread
+    NavPath path         = {};
+    U64 const expanded   = nav_get_stats(nav).cells_expanded;
+    F64 const start_time = time_get_glfw_f64();
+    for (U32 i = 0; i < TEST_NAV_BENCH_LATENCY_PATHS; ++i) { nav_find_path(nav, random_position(2 * i), random_position((2 * i) + 1), &path); }
+    F64 const latency = (time_get_glfw_f64() - start_time) / TEST_NAV_BENCH_LATENCY_PATHS;
+    lli("Nav latency: %.1fus per path on a %dx%d grid (%llu cells expanded on average)", latency * 1e6, TEST_NAV_BENCH_SIZE, TEST_NAV_BENCH_SIZE,
+        (unsigned long long)((nav_get_stats(nav).cells_expanded - expanded) / TEST_NAV_BENCH_LATENCY_PATHS));
+
+    // Throughput, a burst of requests solved in one go
+    for (U32 i = 0; i < TEST_NAV_BENCH_REQUEST_COUNT; ++i) { nav_request_path(nav, random_position(2 * i), random_position((2 * i) + 1)); }
+    F64 const burst_start = time_get_glfw_f64();
+    nav_update(nav, 1000.0);
+    F64 const burst_time = time_get_glfw_f64() - burst_start;
+    TEST_ASSERT_EQUAL_UINT32(0, nav_get_stats(nav).queued);
+    unit_to_pretty_prefix_f("paths/s", (F64)TEST_NAV_BENCH_REQUEST_COUNT / burst_time, pretty_buffer, PRETTY_BUFFER_SIZE, UNIT_PREFIX_KILO);
+    lli("Nav throughput: %d requests on %u threads in %.3fms (%s)", TEST_NAV_BENCH_REQUEST_COUNT, job_system_get_thread_count(), burst_time * 1e3, pretty_buffer);
+
+    // The same burst spread over frames with the default budget
+    for (NavRequest &request : nav->requests) { nav_release(nav, request.handle); }
+    for (U32 i = 0; i < TEST_NAV_BENCH_REQUEST_COUNT; ++i) { nav_request_path(nav, random_position(2 * i), random_position((2 * i) + 1)); }
+    S32 frames          = 0;
+    F64 worst_frame     = 0.0;
+    U32 worst_wait      = 0;
+    for (; nav_get_stats(nav).queued > 0 || frames == 0; ++frames) {
+        nav_update(nav, TEST_NAV_BENCH_FRAME_BUDGET);
+        worst_frame = glm::max(worst_frame, nav_get_stats(nav).last_update_time);
+        worst_wait  = glm::max(worst_wait, nav_get_stats(nav).max_wait_frames);
+    }
+    lli("Nav frame budget: %d requests in %d frames of %.1fms, worst frame %.3fms, longest wait %u frames", TEST_NAV_BENCH_REQUEST_COUNT, frames,
+        TEST_NAV_BENCH_FRAME_BUDGET * 1e3, worst_frame * 1e3, worst_wait);
+
+    // One flow field against the same number of separate paths to the same goal
+    NavHandle const field     = nav_acquire_flow_field(nav, random_position(0));
+    F64 const field_start     = time_get_glfw_f64();
+    nav_update(nav, 1000.0);
+    F64 const field_time      = time_get_glfw_f64() - field_start;
+    TEST_ASSERT_EQUAL_INT(NAV_STATE_READY, nav_get_flow_field_state(nav, field));
+    lli("Nav flow field: %dx%d cells in %.3fms, %.1f paths worth", TEST_NAV_BENCH_SIZE, TEST_NAV_BENCH_SIZE, field_time * 1e3, field_time / latency);
+}
+
+void test_nav() {
+    RUN_TEST(test_nav_path_around_wall);
+    RUN_TEST(test_nav_unreachable_fails);
+    RUN_TEST(test_nav_terrain_slope_costs);
+    RUN_TEST(test_nav_flow_field_shared);
+    RUN_TEST(test_nav_budget_keeps_requests_queued);
+    RUN_TEST(test_nav_performance_benchmark);
+}
@@ -0,0 +1,239 @@
+#include "cvar.hpp"
+#include "log.hpp"
+#include "math.hpp"
+#include "memory.hpp"
+#include "particles_3d.hpp"
+#include "scene.hpp"
+#include "test.hpp"
+#include "time.hpp"
+#include "unit.hpp"
+
+#include <unity.h>
+
+#define TEST_PARTICLES_COUNT 1000  // Not a multiple of any SIMD width, so the scalar tail runs too
+#define TEST_PARTICLES_DT (1.0F / 60.0F)
+#define TEST_PARTICLES_FRAMES 30
+#define TEST_PARTICLES_EPSILON 0.001F
+#define TEST_PARTICLES_BENCH_BURSTS 100
+#define TEST_PARTICLES_BENCH_BURST_SIZE 1000
+#define TEST_PARTICLES_BENCH_FRAMES 60
+
+// Everything runs on the CPU backend in the real current scene, the previous backend and scene get put back afterwards
+BOOL static i_test_particles_saved_cpu                = false;
+SceneType static i_test_particles_saved_scene         = SCENE_NONE;
+SceneType static i_test_particles_saved_overlay_scene = SCENE_NONE;
+
+void static i_test_particles_begin() {
+    i_test_particles_saved_cpu           = c_render__particles3d_cpu;
+    i_test_particles_saved_scene         = g_scenes.current_scene_type;
+    i_test_particles_saved_overlay_scene = g_scenes.current_overlay_scene_type;
+    c_render__particles3d_cpu            = true;
+    g_scenes.current_overlay_scene_type  = SCENE_NONE;
+    particles3d_set_backend(PARTICLE3D_BACKEND_CPU);
+}
+
+void static i_test_particles_end() {
+    c_render__particles3d_cpu           = i_test_particles_saved_cpu;
+    g_scenes.current_scene_type         = i_test_particles_saved_scene;
+    g_scenes.current_overlay_scene_type = i_test_particles_saved_overlay_scene;
+    particles3d_set_backend(c_render__particles3d_cpu ? PARTICLE3D_BACKEND_CPU : PARTICLE3D_BACKEND_GPU);
+}
+
+struct TestParticlesBatch {
+    Vector3 *positions;
+    Vector3 *velocities;
+    Vector3 *accelerations;
+    F32 *sizes;
+    Color *start_colors;
+    Color *end_colors;
+    F32 *lives;
+    U32 *texture_indices;
+    F32 *gravities;
+    F32 *rotation_speeds;
+    F32 *air_resistances;
+    U32 *billboard_modes;
+    F32 *stretch_factors;
+};
+
+TestParticlesBatch static i_test_particles_batch(SZ count) {
+    TestParticlesBatch b = {};
+    b.positions          = mcta(Vector3 *, count, sizeof(Vector3));
+    b.velocities         = mcta(Vector3 *, count, sizeof(Vector3));
+    b.accelerations      = mcta(Vector3 *, count, sizeof(Vector3));
+    b.sizes              = mcta(F32 *, count, sizeof(F32));
+    b.start_colors       = mcta(Color *, count, sizeof(Color));
+    b.end_colors         = mcta(Color *, count, sizeof(Color));
+    b.lives              = mcta(F32 *, count, sizeof(F32));
+    b.texture_indices    = mcta(U32 *, count, sizeof(U32));
+    b.gravities          = mcta(F32 *, count, sizeof(F32));
+    b.rotation_speeds    = mcta(F32 *, count, sizeof(F32));
+    b.air_resistances    = mcta(F32 *, count, sizeof(F32));
+    b.billboard_modes    = mcta(U32 *, count, sizeof(U32));
+    b.stretch_factors    = mcta(F32 *, count, sizeof(F32));
+
+    for (SZ i = 0; i < count; ++i) {
+        F32 const f          = (F32)i;
+        b.positions[i]       = {f * 0.1F, 1.0F, -f * 0.05F};
+        b.velocities[i]      = {math_sin_f32(f) * 5.0F, 3.0F + math_cos_f32(f), 1.0F};
+        b.accelerations[i]   = {0.5F, 0.0F, -0.25F};
+        b.sizes[i]           = 1.0F + (F32)(i % 7);
+        b.start_colors[i]    = WHITE;
+        b.end_colors[i]      = RED;
+        b.lives[i]           = 1.0F + (F32)(i % 5);
+        b.gravities[i]       = 9.81F;
+        b.air_resistances[i] = 0.01F * (F32)(i % 4);
+        b.billboard_modes[i] = PARTICLE3D_BILLBOARD_CAMERA_FACING;
+        b.stretch_factors[i] = (i % 2) ? 1.5F : 0.0F;
+    }
+
+    return b;
+}
+
+void static i_test_particles_add(TestParticlesBatch const *b, SZ count) {
+    particles3d_add(b->positions, b->velocities, b->accelerations, b->sizes, b->start_colors, b->end_colors, b->lives, b->texture_indices,
+                    b->gravities, b->rotation_speeds, b->air_resistances, b->billboard_modes, b->stretch_factors, count);
+}
+
+void static test_particles_cpu_matches_shader() {
+    i_test_particles_begin();
+
+    TestParticlesBatch const b = i_test_particles_batch(TEST_PARTICLES_COUNT);
+    i_test_particles_add(&b, TEST_PARTICLES_COUNT);
+    TEST_ASSERT_EQUAL_INT(TEST_PARTICLES_COUNT, g_particles3d.live_count);
+
+    for (U32 frame = 0; frame < TEST_PARTICLES_FRAMES; ++frame) { particles3d_update(TEST_PARTICLES_DT); }
+
+    // Nothing dies within half a second, so the slots are still in spawn order
+    TEST_ASSERT_EQUAL_INT(TEST_PARTICLES_COUNT, g_particles3d.live_count);
+
+    // Reference is the compute shader, step by step
+    Particle3DSoA const *soa = &g_particles3d.soa;
+    for (SZ i = 0; i < TEST_PARTICLES_COUNT; ++i) {
+        Vector3 p = b.positions[i];
+        Vector3 v = b.velocities[i];
+        F32 life  = b.lives[i];
+        for (U32 frame = 0; frame < TEST_PARTICLES_FRAMES; ++frame) {
+            life -= TEST_PARTICLES_DT;
+            v.x  += b.accelerations[i].x * TEST_PARTICLES_DT;
+            v.y  += b.accelerations[i].y * TEST_PARTICLES_DT;
+            v.z  += b.accelerations[i].z * TEST_PARTICLES_DT;
+            v.y  -= b.gravities[i] * TEST_PARTICLES_DT;
+            F32 const damping = math_pow_f32(1.0F - b.air_resistances[i], TEST_PARTICLES_DT * 60.0F);
+            v.x *= damping;
+            v.y *= damping;
+            v.z *= damping;
+            p.x += v.x * TEST_PARTICLES_DT;
+            p.y += v.y * TEST_PARTICLES_DT;
+            p.z += v.z * TEST_PARTICLES_DT;
+        }
+        F32 const t    = 1.0F - (life / b.lives[i]);
+        F32 const size = b.stretch_factors[i] > 0.0F ? b.sizes[i] * math_lerp_f32(1.0F, 0.1F, t) : b.sizes[i];
+
+        TEST_ASSERT_FLOAT_WITHIN(TEST_PARTICLES_EPSILON, life, soa->life[i]);
+        TEST_ASSERT_FLOAT_WITHIN(TEST_PARTICLES_EPSILON, p.x, soa->position_x[i]);
+        TEST_ASSERT_FLOAT_WITHIN(TEST_PARTICLES_EPSILON, p.y, soa->position_y[i]);
+        TEST_ASSERT_FLOAT_WITHIN(TEST_PARTICLES_EPSILON, p.z, soa->position_z[i]);
+        TEST_ASSERT_FLOAT_WITHIN(TEST_PARTICLES_EPSILON, v.y, soa->velocity_y[i]);
+        TEST_ASSERT_FLOAT_WITHIN(TEST_PARTICLES_EPSILON, size, soa->size[i]);
+        if (b.stretch_factors[i] > 0.0F) { TEST_ASSERT_FLOAT_WITHIN(TEST_PARTICLES_EPSILON, 1.0F - (t * t * t), soa->alpha[i]); }
+    }
+
+    i_test_particles_end();
+}
+
+void static test_particles_compaction_keeps_only_alive() {
+    i_test_particles_begin();
+
+    // Every other particle dies on the first update
+    TestParticlesBatch const b = i_test_particles_batch(TEST_PARTICLES_COUNT);
+    for (SZ i = 0; i < TEST_PARTICLES_COUNT; ++i) {
+        b.lives[i]           = (i % 2) ? 10.0F : TEST_PARTICLES_DT * 0.5F;
+        b.sizes[i]           = (F32)i;  // Identifies the particle after it got moved
+        b.stretch_factors[i] = 0.0F;
+    }
+    b.lives[0] = 0.0F;  // Rejected on spawn
+    i_test_particles_add(&b, TEST_PARTICLES_COUNT);
+    TEST_ASSERT_EQUAL_INT(TEST_PARTICLES_COUNT - 1, g_particles3d.live_count);
+
+    particles3d_update(TEST_PARTICLES_DT);
+    TEST_ASSERT_EQUAL_INT(TEST_PARTICLES_COUNT / 2, g_particles3d.live_count);
+
+    // Exactly the odd ones survived, each once
+    auto *seen = mcta(U8 *, TEST_PARTICLES_COUNT, sizeof(U8));
+    for (SZ i = 0; i < g_particles3d.live_count; ++i) {
+        TEST_ASSERT_TRUE(g_particles3d.soa.life[i] > 0.0F);
+        SZ const id = (SZ)g_particles3d.soa.initial_size[i];
+        TEST_ASSERT_EQUAL_INT(1, id % 2);
+        TEST_ASSERT_EQUAL_UINT8(0, seen[id]);
+        seen[id] = 1;
+    }
+
+    // Particles of a scene that isn't active are frozen, clearing their scene removes them
+    g_scenes.current_scene_type = SCENE_MENU;
+    particles3d_update(TEST_PARTICLES_DT);
+    TEST_ASSERT_EQUAL_INT(TEST_PARTICLES_COUNT / 2, g_particles3d.live_count);
+    TEST_ASSERT_FLOAT_WITHIN(TEST_PARTICLES_EPSILON, 10.0F - TEST_PARTICLES_DT, g_particles3d.soa.life[0]);
+
+    particles3d_clear_scene(i_test_particles_saved_scene);
+    TEST_ASSERT_EQUAL_INT(0, g_particles3d.live_count);
+
+    i_test_particles_end();
+}
+
+void static test_particles_effects_die_out() {
+    i_test_particles_begin();
+
+    Vector3 const center = {10.0F, 0.0F, 10.0F};
+    particles3d_add_explosion(center, 5.0F, ORANGE, RED, 1.0F, 300);
+    particles3d_add_smoke(center, 3.0F, GRAY, DARKGRAY, 1.0F, 200);
+    particles3d_add_harvest_impact(center, BROWN, BEIGE, 1.0F, 100);
+    TEST_ASSERT_EQUAL_INT(600, g_particles3d.live_count);
+
+    // Smoke lives the longest with at most 5 seconds
+    for (U32 frame = 0; frame < 6 * 60; ++frame) { particles3d_update(TEST_PARTICLES_DT); }
+    TEST_ASSERT_EQUAL_INT(0, g_particles3d.live_count);
+
+    i_test_particles_end();
+}
+
+void static test_particles_performance_benchmark() {
+    C8 spawn_buffer[PRETTY_BUFFER_SIZE]  = {};
+    C8 update_buffer[PRETTY_BUFFER_SIZE] = {};
+    i_test_particles_begin();
+
+    Vector3 const center = {10.0F, 0.0F, 10.0F};
+    F64 start_time       = time_get_glfw_f64();
+    for (U32 i = 0; i < TEST_PARTICLES_BENCH_BURSTS; ++i) {
+        particles3d_add_explosion(center, 5.0F, ORANGE, RED, 1.0F, TEST_PARTICLES_BENCH_BURST_SIZE);
+        particles3d_add_smoke(center, 3.0F, GRAY, DARKGRAY, 1.0F, TEST_PARTICLES_BENCH_BURST_SIZE);
+        particles3d_add_harvest_impact(center, BROWN, BEIGE, 1.0F, TEST_PARTICLES_BENCH_BURST_SIZE);
+    }
+    F64 const spawn_time = time_get_glfw_f64() - start_time;
+    SZ const spawned     = (SZ)TEST_PARTICLES_BENCH_BURSTS * TEST_PARTICLES_BENCH_BURST_SIZE * 3;
+
+    // Particles die off over the run, so this is per particle that was actually alive
+    SZ updated = 0;
+    start_time = time_get_glfw_f64();
+    for (U32 frame = 0; frame < TEST_PARTICLES_BENCH_FRAMES; ++frame) {
+        updated += g_particles3d.live_count;
+        particles3d_update(TEST_PARTICLES_DT);
+    }
+    F64 const update_time = time_get_glfw_f64() - start_time;
+
+    unit_to_pretty_time_f(BASE_TO_NANO(spawn_time / (F64)spawned), spawn_buffer, PRETTY_BUFFER_SIZE, UNIT_TIME_SECONDS);
+    unit_to_pretty_time_f(BASE_TO_NANO(update_time / (F64)updated), update_buffer, PRETTY_BUFFER_SIZE, UNIT_TIME_SECONDS);
+    lli("Particles3D CPU (SIMD x%d, %s): spawn %zu in %.3fms (%s/particle), %d frames update%s %zu particles in %.3fms (%s/particle)",
+        PARTICLES_3D_SIMD_WIDTH, g_particles3d.gpu_ready ? "uploading" : "headless", spawned, spawn_time * 1e3, spawn_buffer,
+        TEST_PARTICLES_BENCH_FRAMES, g_particles3d.gpu_ready ? " + upload" : "", updated, update_time * 1e3, update_buffer);
+
+    i_test_particles_end();
+}
+
+void test_particles() {
+#ifndef __APPLE__
+    RUN_TEST(test_particles_cpu_matches_shader);
+    RUN_TEST(test_particles_compaction_keeps_only_alive);
+    RUN_TEST(test_particles_effects_die_out);
+    RUN_TEST(test_particles_performance_benchmark);
+#endif
+}
@@ -0,0 +1,124 @@
+#include "log.hpp"
+#include "memory.hpp"
+#include "render_instance_ring.hpp"
+#include "test.hpp"
+#include "time.hpp"
+
+#include <raymath.h>
+#include <unity.h>
+
+#define TEST_RENDER_RING_CAPACITY 8
+#define TEST_RENDER_BENCH_INSTANCES 20000
+#define TEST_RENDER_BENCH_FRAMES 100
+
+// A ring over plain memory, never initialized through GL. Without fences begin_frame does not touch the driver either.
+RenderInstanceRing static i_test_render_ring(RenderInstance *memory) {
+    RenderInstanceRing ring = {};
+    ring.initialized        = true;
+    ring.persistent         = true;
+    ring.mapped             = memory;
+    ring.region_capacity    = TEST_RENDER_RING_CAPACITY;
+    return ring;
+}
+
+void static test_render_instance_pack() {
+    Matrix const transforms[2] = {
+        MatrixMultiply(MatrixRotateY(0.5F), MatrixTranslate(1.0F, 2.0F, 3.0F)),
+        MatrixScale(2.0F, 3.0F, 4.0F),
+    };
+    Color const tints[2] = {{10, 20, 30, 40}, {255, 0, 128, 255}};
+
+    RenderInstance packed[2] = {};
+    render_instance_pack(packed, transforms, tints, 2);
+
+    for (SZ i = 0; i < 2; ++i) {
+        // Column-major, exactly what raylib uploads for instanceTransform
+        float16 const expected = MatrixToFloatV(transforms[i]);
+        for (SZ j = 0; j < 16; ++j) { TEST_ASSERT_EQUAL_FLOAT(expected.v[j], packed[i].transform[j]); }
+        TEST_ASSERT_EQUAL_UINT8(tints[i].r, packed[i].tint.r);
+        TEST_ASSERT_EQUAL_UINT8(tints[i].g, packed[i].tint.g);
+        TEST_ASSERT_EQUAL_UINT8(tints[i].b, packed[i].tint.b);
+        TEST_ASSERT_EQUAL_UINT8(tints[i].a, packed[i].tint.a);
+    }
+
+    // The translation ends up in the last column
+    TEST_ASSERT_EQUAL_FLOAT(1.0F, packed[0].transform[12]);
+    TEST_ASSERT_EQUAL_FLOAT(2.0F, packed[0].transform[13]);
+    TEST_ASSERT_EQUAL_FLOAT(3.0F, packed[0].transform[14]);
+    TEST_ASSERT_EQUAL_INT(68, sizeof(RenderInstance));
+}
+
+void static test_render_instance_ring_alloc() {
+    auto *memory            = mmta(RenderInstance *, sizeof(RenderInstance) * TEST_RENDER_RING_CAPACITY * RENDER_INSTANCE_RING_FRAME_COUNT);
+    RenderInstanceRing ring = i_test_render_ring(memory);
+
+    // Draws in the same frame get consecutive slices of one region
+    render_instance_ring_begin_frame(&ring);
+    SZ first_a = 0;
+    SZ first_b = 0;
+    RenderInstance *a = render_instance_ring_alloc(&ring, 3, &first_a);
+    RenderInstance *b = render_instance_ring_alloc(&ring, 5, &first_b);
+    TEST_ASSERT_NOT_NULL(a);
+    TEST_ASSERT_NOT_NULL(b);
+    TEST_ASSERT_EQUAL_INT(ring.region * TEST_RENDER_RING_CAPACITY, first_a);
+    TEST_ASSERT_EQUAL_INT(first_a + 3, first_b);
+    TEST_ASSERT_EQUAL_PTR(&memory[first_b], b);
+
+    // The region is full now, nothing spills into the one the GPU may still be reading
+    SZ first_c = 0;
+    TEST_ASSERT_NULL(render_instance_ring_alloc(&ring, 1, &first_c));
+    TEST_ASSERT_EQUAL_INT(TEST_RENDER_RING_CAPACITY, ring.count);
+
+    // Every frame moves on to the next region and wraps around after the last one
+    U32 const start_region = ring.region;
+    for (U32 frame = 1; frame <= RENDER_INSTANCE_RING_FRAME_COUNT; ++frame) {
+        render_instance_ring_begin_frame(&ring);
+        TEST_ASSERT_EQUAL_INT((start_region + frame) % RENDER_INSTANCE_RING_FRAME_COUNT, ring.region);
+        TEST_ASSERT_EQUAL_INT(0, ring.count);
+        TEST_ASSERT_NOT_NULL(render_instance_ring_alloc(&ring, TEST_RENDER_RING_CAPACITY, &first_c));
+        TEST_ASSERT_EQUAL_INT(ring.region * TEST_RENDER_RING_CAPACITY, first_c);
+    }
+
+    // Not initialized through GL, nothing to hand out
+    RenderInstanceRing empty = {};
+    TEST_ASSERT_NULL(render_instance_ring_alloc(&empty, 1, &first_c));
+}
+
+void static test_render_instance_pack_performance_benchmark() {
+    auto *transforms = mmta(Matrix *, sizeof(Matrix) * TEST_RENDER_BENCH_INSTANCES);
+    auto *tints      = mmta(Color *, sizeof(Color) * TEST_RENDER_BENCH_INSTANCES);
+    auto *packed     = mmta(RenderInstance *, sizeof(RenderInstance) * TEST_RENDER_BENCH_INSTANCES);
+    auto *colors     = mmta(F32 *, sizeof(F32) * 4 * TEST_RENDER_BENCH_INSTANCES);
+    auto *floats     = mmta(float16 *, sizeof(float16) * TEST_RENDER_BENCH_INSTANCES);
+    for (SZ i = 0; i < TEST_RENDER_BENCH_INSTANCES; ++i) {
+        transforms[i] = MatrixTranslate((F32)i, 0.0F, (F32)i);
+        tints[i]      = {(U8)i, (U8)(i >> 8), 255, 255};
+    }
+
+    // Old behaviour, float colors here and raylib's float16 copy of the transforms inside DrawMeshInstanced
+    F64 start_time = time_get_glfw_f64();
+    for (U32 frame = 0; frame < TEST_RENDER_BENCH_FRAMES; ++frame) {
+        for (SZ j = 0; j < TEST_RENDER_BENCH_INSTANCES; ++j) {
+            colors[(j * 4) + 0] = (F32)tints[j].r / 255.0F;
+            colors[(j * 4) + 1] = (F32)tints[j].g / 255.0F;
+            colors[(j * 4) + 2] = (F32)tints[j].b / 255.0F;
+            colors[(j * 4) + 3] = (F32)tints[j].a / 255.0F;
+            floats[j]           = MatrixToFloatV(transforms[j]);
+        }
+    }
+    F64 const convert_time = (time_get_glfw_f64() - start_time) / TEST_RENDER_BENCH_FRAMES;
+
+    start_time = time_get_glfw_f64();
+    for (U32 frame = 0; frame < TEST_RENDER_BENCH_FRAMES; ++frame) { render_instance_pack(packed, transforms, tints, TEST_RENDER_BENCH_INSTANCES); }
+    F64 const pack_time = (time_get_glfw_f64() - start_time) / TEST_RENDER_BENCH_FRAMES;
+
+    TEST_ASSERT_EQUAL_FLOAT(floats[TEST_RENDER_BENCH_INSTANCES - 1].v[12], packed[TEST_RENDER_BENCH_INSTANCES - 1].transform[12]);
+    lli("Packing %d instances: convert %.3fus/frame, pack %.3fus/frame (%zu bytes per instance, was %zu)", TEST_RENDER_BENCH_INSTANCES,
+        convert_time * 1e6, pack_time * 1e6, sizeof(RenderInstance), sizeof(float16) + (4 * sizeof(F32)));
+}
+
+void test_render() {
+    RUN_TEST(test_render_instance_pack);
+    RUN_TEST(test_render_instance_ring_alloc);
+    RUN_TEST(test_render_instance_pack_performance_benchmark);
+}
@@ -0,0 +1,116 @@
+#include "asset.hpp"
+#include "log.hpp"
+#include "math.hpp"
+#include "memory.hpp"
+#include "test.hpp"
+#include "time.hpp"
+#include "unit.hpp"
+
+#include <raymath.h>
+#include <unity.h>
+
+#define TEST_TERRAIN_IMAGE_SIZE 64
+#define TEST_TERRAIN_SAMPLE_RATE 128
+#define TEST_TERRAIN_EPSILON 0.01F
+#define TEST_TERRAIN_BENCH_IMAGE_SIZE 512
+
+ATerrain static i_test_terrain_create(S32 image_size, Vector3 dimensions) {
+    Image const image = GenImagePerlinNoise(image_size, image_size, 0, 0, 4.0F);
+
+    ATerrain terrain   = {};
+    terrain.dimensions = dimensions;
+    terrain.transform  = MatrixIdentity();
+    terrain.mesh       = GenMeshHeightmap(image, dimensions);
+
+    UnloadImage(image);
+    return terrain;
+}
+
+void static test_terrain_height_field_matches_raycast() {
+    ATerrain terrain = i_test_terrain_create(TEST_TERRAIN_IMAGE_SIZE, {256.0F, 64.0F, 256.0F});
+
+    SZ const sample_count = (SZ)TEST_TERRAIN_SAMPLE_RATE * TEST_TERRAIN_SAMPLE_RATE;
+    auto *raster          = mmta(F32 *, sizeof(F32) * sample_count);
+    auto *raycast         = mmta(F32 *, sizeof(F32) * sample_count);
+    asset_terrain_build_height_field(&terrain, TEST_TERRAIN_SAMPLE_RATE, raster);
+    asset_terrain_build_height_field_raycast(&terrain, TEST_TERRAIN_SAMPLE_RATE, raycast);
+
+    // The outermost samples sit exactly on the mesh border where the ray test is hit or miss, everything inside has to match
+    F32 max_error = 0.0F;
+    for (U32 z = 1; z < TEST_TERRAIN_SAMPLE_RATE - 1; ++z) {
+        for (U32 x = 1; x < TEST_TERRAIN_SAMPLE_RATE - 1; ++x) {
+            SZ const idx = ((SZ)z * TEST_TERRAIN_SAMPLE_RATE) + x;
+            max_error    = glm::max(max_error, glm::abs(raster[idx] - raycast[idx]));
+        }
+    }
+    TEST_ASSERT_FLOAT_WITHIN(TEST_TERRAIN_EPSILON, 0.0F, max_error);
+
+    // Same layout as the lookup expects, a sample position returns the sample
+    terrain.height_field        = raster;
+    terrain.height_field_width  = TEST_TERRAIN_SAMPLE_RATE;
+    terrain.height_field_height = TEST_TERRAIN_SAMPLE_RATE;
+    U32 const x = 37;
+    U32 const z = 91;
+    F32 const world_x = ((F32)x / (F32)(TEST_TERRAIN_SAMPLE_RATE - 1)) * terrain.dimensions.x;
+    F32 const world_z = ((F32)z / (F32)(TEST_TERRAIN_SAMPLE_RATE - 1)) * terrain.dimensions.z;
+    TEST_ASSERT_FLOAT_WITHIN(TEST_TERRAIN_EPSILON, raycast[(z * TEST_TERRAIN_SAMPLE_RATE) + x], math_get_terrain_height(&terrain, world_x, world_z));
+
+    UnloadMesh(terrain.mesh);
+}
+
+void static test_terrain_height_field_outside_mesh_is_zero() {
+    ATerrain terrain = i_test_terrain_create(TEST_TERRAIN_IMAGE_SIZE, {128.0F, 32.0F, 128.0F});
+
+    // Spread the samples over twice the mesh so that the far half is not covered
+    terrain.dimensions = {256.0F, 32.0F, 256.0F};
+    auto *raster       = mmta(F32 *, sizeof(F32) * TEST_TERRAIN_SAMPLE_RATE * TEST_TERRAIN_SAMPLE_RATE);
+    asset_terrain_build_height_field(&terrain, TEST_TERRAIN_SAMPLE_RATE, raster);
+
+    TEST_ASSERT_EQUAL_FLOAT(0.0F, raster[(SZ)TEST_TERRAIN_SAMPLE_RATE * TEST_TERRAIN_SAMPLE_RATE - 1]);
+    TEST_ASSERT_EQUAL_FLOAT(0.0F, raster[TEST_TERRAIN_SAMPLE_RATE - 1]);
+
+    UnloadMesh(terrain.mesh);
+}
+
+void static test_terrain_height_field_performance_benchmark() {
+    C8 pretty_raster[PRETTY_BUFFER_SIZE]  = {};
+    C8 pretty_raycast[PRETTY_BUFFER_SIZE] = {};
+
+    // Same small terrain for both, the raycast path does not finish in reasonable time at the real size
+    ATerrain terrain      = i_test_terrain_create(TEST_TERRAIN_IMAGE_SIZE, {256.0F, 64.0F, 256.0F});
+    SZ const sample_count = (SZ)TEST_TERRAIN_SAMPLE_RATE * TEST_TERRAIN_SAMPLE_RATE;
+    auto *height_field    = mmta(F32 *, sizeof(F32) * sample_count);
+
+    F64 start_time = time_get_glfw_f64();
+    asset_terrain_build_height_field_raycast(&terrain, TEST_TERRAIN_SAMPLE_RATE, height_field);
+    F64 const raycast_time = time_get_glfw_f64() - start_time;
+
+    start_time = time_get_glfw_f64();
+    asset_terrain_build_height_field(&terrain, TEST_TERRAIN_SAMPLE_RATE, height_field);
+    F64 const raster_time = time_get_glfw_f64() - start_time;
+
+    unit_to_pretty_time_f(BASE_TO_NANO(raycast_time), pretty_raycast, PRETTY_BUFFER_SIZE, UNIT_TIME_SECONDS);
+    unit_to_pretty_time_f(BASE_TO_NANO(raster_time), pretty_raster, PRETTY_BUFFER_SIZE, UNIT_TIME_SECONDS);
+    lli("Terrain height field %dx%d samples, %d triangles: raycast %s, raster %s, %.2fx",
+        TEST_TERRAIN_SAMPLE_RATE, TEST_TERRAIN_SAMPLE_RATE, terrain.mesh.triangleCount, pretty_raycast, pretty_raster, raycast_time / raster_time);
+    UnloadMesh(terrain.mesh);
+
+    // Cold start of a real sized terrain, this is what a load without a height cache pays
+    terrain                 = i_test_terrain_create(TEST_TERRAIN_BENCH_IMAGE_SIZE, {A_TERRAIN_DEFAULT_SIZE, 128.0F, A_TERRAIN_DEFAULT_SIZE});
+    SZ const full_count     = (SZ)A_TERRAIN_SAMPLE_RATE * A_TERRAIN_SAMPLE_RATE;
+    auto *full_height_field = mmta(F32 *, sizeof(F32) * full_count);
+
+    start_time = time_get_glfw_f64();
+    asset_terrain_build_height_field(&terrain, A_TERRAIN_SAMPLE_RATE, full_height_field);
+    F64 const cold_time = time_get_glfw_f64() - start_time;
+
+    unit_to_pretty_time_f(BASE_TO_NANO(cold_time), pretty_raster, PRETTY_BUFFER_SIZE, UNIT_TIME_SECONDS);
+    lli("Terrain cold start %dx%d samples, %d triangles: raster %s", A_TERRAIN_SAMPLE_RATE, A_TERRAIN_SAMPLE_RATE, terrain.mesh.triangleCount, pretty_raster);
+    UnloadMesh(terrain.mesh);
+}
+
+void test_terrain() {
+    RUN_TEST(test_terrain_height_field_matches_raycast);
+    RUN_TEST(test_terrain_height_field_outside_mesh_is_zero);
+    RUN_TEST(test_terrain_height_field_performance_benchmark);
+}
@@ -0,0 +1,352 @@
+#include "entity.hpp"
+#include "log.hpp"
+#include "math.hpp"
+#include "memory.hpp"
+#include "std.hpp"
+#include "test.hpp"
+#include "time.hpp"
+#include "world.hpp"
+
+#include <raymath.h>
+#include <unity.h>
+
+#define TEST_WORLD_BENCH_FRAMES 3  // The linear scan is slow enough that a few frames are plenty
+#define TEST_WORLD_BENCH_SELECTED 5000
+#define TEST_WORLD_CROWD_COUNT 2000
+#define TEST_WORLD_CROWD_MODEL_COUNT 2
+#define TEST_WORLD_CROWD_ANIM_COUNT 6
+#define TEST_WORLD_CROWD_BONE_COUNT 20
+
+void static i_test_world_kill(EID id) {
+    g_world->flags[id] = 0;
+}
+
+void static test_world_selection_add_remove() {
+    test_scratch_world_begin();
+    for (EID i = 0; i < 10; ++i) { test_spawn_entity(i, ENTITY_TYPE_NONE, {}, 0U); }
+
+    world_selection_add(3);
+    world_selection_add(5);
+    world_selection_add(7);
+    world_selection_add(5);  // Adding twice is harmless
+    TEST_ASSERT_EQUAL_INT(3, g_world->selected_entity_count);
+    TEST_ASSERT_TRUE(world_is_entity_selected(5));
+    TEST_ASSERT_FALSE(world_is_entity_selected(4));
+
+    // Removing from the middle keeps the primary and moves the last entry into the hole
+    world_selection_remove(5);
+    TEST_ASSERT_EQUAL_INT(2, g_world->selected_entity_count);
+    TEST_ASSERT_EQUAL_INT(3, g_world->selected_entities[0]);
+    TEST_ASSERT_EQUAL_INT(7, g_world->selected_entities[1]);
+    TEST_ASSERT_FALSE(world_is_entity_selected(5));
+    world_selection_remove(5);
+    TEST_ASSERT_EQUAL_INT(2, g_world->selected_entity_count);
+
+    world_selection_toggle(7);
+    world_selection_toggle(9);
+    TEST_ASSERT_FALSE(world_is_entity_selected(7));
+    TEST_ASSERT_TRUE(world_is_entity_selected(9));
+
+    world_selection_clear();
+    TEST_ASSERT_EQUAL_INT(0, g_world->selected_entity_count);
+    TEST_ASSERT_FALSE(world_is_entity_selected(3));
+    TEST_ASSERT_FALSE(world_is_entity_selected(9));
+
+    test_scratch_world_end();
+}
+
+void static test_world_selection_generation() {
+    test_scratch_world_begin();
+    for (EID i = 0; i < 4; ++i) { test_spawn_entity(i, ENTITY_TYPE_NONE, {}, 0U); }
+
+    world_selection_add(1);
+    world_selection_add(2);
+
+    // The slot gets reused without going through entity_destroy, the new entity must not inherit the selection
+    i_test_world_kill(1);
+    test_spawn_entity(1, ENTITY_TYPE_NONE, {}, 0U);
+    TEST_ASSERT_FALSE(world_is_entity_selected(1));
+    TEST_ASSERT_TRUE(world_is_entity_selected(2));
+
+    world_selection_validate();
+    TEST_ASSERT_EQUAL_INT(1, g_world->selected_entity_count);
+    TEST_ASSERT_EQUAL_INT(2, g_world->selected_entities[0]);
+
+    // Dead entities are never selected either
+    i_test_world_kill(2);
+    TEST_ASSERT_FALSE(world_is_entity_selected(2));
+    world_selection_validate();
+    TEST_ASSERT_EQUAL_INT(0, g_world->selected_entity_count);
+
+    // Selecting a recycled slot again works
+    world_selection_add(1);
+    TEST_ASSERT_TRUE(world_is_entity_selected(1));
+    TEST_ASSERT_EQUAL_INT(1, g_world->selected_entity_count);
+
+    test_scratch_world_end();
+}
+
+void static test_world_selection_performance_benchmark() {
+    test_scratch_world_begin();
+    for (EID i = 0; i < WORLD_MAX_ENTITIES; ++i) { test_spawn_entity(i, ENTITY_TYPE_NONE, {}, 0U); }
+    for (EID i = 0; i < TEST_WORLD_BENCH_SELECTED; ++i) { world_selection_add((i * 5) % WORLD_MAX_ENTITIES); }
+
+    // Old behaviour, a linear scan of the selection for every entity that gets drawn
+    SZ linear_hits = 0;
+    F64 start_time = time_get_glfw_f64();
+    for (U32 frame = 0; frame < TEST_WORLD_BENCH_FRAMES; ++frame) {
+        for (EID id = 0; id < WORLD_MAX_ENTITIES; ++id) {
+            for (SZ i = 0; i < g_world->selected_entity_count; ++i) {
+                if (g_world->selected_entities[i] == id) {
+                    linear_hits++;
+                    break;
+                }
+            }
+        }
+    }
+    F64 const linear_time = (time_get_glfw_f64() - start_time) / TEST_WORLD_BENCH_FRAMES;
+
+    SZ bitset_hits = 0;
+    start_time     = time_get_glfw_f64();
+    for (U32 frame = 0; frame < TEST_WORLD_BENCH_FRAMES; ++frame) {
+        for (EID id = 0; id < WORLD_MAX_ENTITIES; ++id) { bitset_hits += world_is_entity_selected(id) ? 1U : 0U; }
+    }
+    F64 const bitset_time = (time_get_glfw_f64() - start_time) / TEST_WORLD_BENCH_FRAMES;
+
+    TEST_ASSERT_EQUAL_INT(linear_hits, bitset_hits);
+    lli("Selection test of %d entities with %d selected: linear %.3fus/frame, bitset %.3fus/frame, %.2fx", WORLD_MAX_ENTITIES,
+        TEST_WORLD_BENCH_SELECTED, linear_time * 1e6, bitset_time * 1e6, linear_time / bitset_time);
+
+    test_scratch_world_end();
+}
+
+void static i_test_world_unregister(EID id) {
+    world_unregister_entity(id);
+    g_world->flags[id] = 0;
+    g_world->type[id]  = ENTITY_TYPE_NONE;
+}
+
+void static test_world_entity_lists() {
+    test_scratch_world_begin();
+
+    for (EID i = 0; i < 6; ++i) { test_spawn_entity(i, i % 2 == 0 ? ENTITY_TYPE_NPC : ENTITY_TYPE_VEGETATION, {}, 0U); }
+    TEST_ASSERT_EQUAL_INT(6, g_world->active_entity_count);
+    TEST_ASSERT_EQUAL_INT(3, g_world->type_lists[ENTITY_TYPE_NPC].count);
+    TEST_ASSERT_EQUAL_INT(3, g_world->type_lists[ENTITY_TYPE_VEGETATION].count);
+
+    world_set_entity_flag(2, ENTITY_FLAG_ACTOR);
+    world_set_entity_flag(4, ENTITY_FLAG_ACTOR);
+    world_set_entity_flag(4, ENTITY_FLAG_ACTOR);  // Setting twice is harmless
+    TEST_ASSERT_EQUAL_INT(2, g_world->actor_list.count);
+
+    // Swap-remove out of the middle of every list the entity is in
+    i_test_world_unregister(2);
+    TEST_ASSERT_EQUAL_INT(5, g_world->active_entity_count);
+    TEST_ASSERT_EQUAL_INT(2, g_world->type_lists[ENTITY_TYPE_NPC].count);
+    TEST_ASSERT_EQUAL_INT(1, g_world->actor_list.count);
+    TEST_ASSERT_FALSE(world_entity_list_contains(&g_world->type_lists[ENTITY_TYPE_NPC], 2));
+    TEST_ASSERT_TRUE(world_entity_list_contains(&g_world->type_lists[ENTITY_TYPE_NPC], 4));
+    TEST_ASSERT_TRUE(world_entity_list_contains(&g_world->actor_list, 4));
+
+    world_clear_entity_flag(4, ENTITY_FLAG_ACTOR);
+    TEST_ASSERT_EQUAL_INT(0, g_world->actor_list.count);
+
+    // Every list holds exactly the entities that match it
+    SZ seen = 0;
+    for (SZ idx = 0; idx < g_world->active_entity_count; ++idx) {
+        EID const id = g_world->active_entities[idx];
+        TEST_ASSERT_TRUE(ENTITY_HAS_FLAG(g_world->flags[id], ENTITY_FLAG_IN_USE));
+        TEST_ASSERT_TRUE(world_entity_list_contains(&g_world->type_lists[g_world->type[id]], id));
+        seen++;
+    }
+    TEST_ASSERT_EQUAL_INT(5, seen);
+
+    // The slot comes back as a different type
+    test_spawn_entity(2, ENTITY_TYPE_PROP, {}, 0U);
+    TEST_ASSERT_EQUAL_INT(6, g_world->active_entity_count);
+    TEST_ASSERT_EQUAL_INT(2, g_world->type_lists[ENTITY_TYPE_NPC].count);
+    TEST_ASSERT_EQUAL_INT(1, g_world->type_lists[ENTITY_TYPE_PROP].count);
+
+    test_scratch_world_end();
+}
+
+void static test_world_entity_lists_performance_benchmark() {
+    test_scratch_world_begin();
+    for (EID i = 0; i < WORLD_MAX_ENTITIES; ++i) { test_spawn_entity(i, i % 10 == 0 ? ENTITY_TYPE_NPC : ENTITY_TYPE_VEGETATION, {}, 0U); }
+
+    // Old behaviour, the full scan to rebuild the active list and a filtered pass over it to find the NPCs
+    SZ scan_hits   = 0;
+    F64 start_time = time_get_glfw_f64();
+    for (U32 frame = 0; frame < TEST_WORLD_BENCH_FRAMES * 100; ++frame) {
+        U32 active_count = 0;
+        for (EID i = 0; i < WORLD_MAX_ENTITIES; ++i) {
+            if (ENTITY_HAS_FLAG(g_world->flags[i], ENTITY_FLAG_IN_USE)) { g_world->active_entities[active_count++] = i; }
+        }
+        for (U32 idx = 0; idx < active_count; ++idx) { scan_hits += g_world->type[g_world->active_entities[idx]] == ENTITY_TYPE_NPC ? 1U : 0U; }
+    }
+    F64 const scan_time = (time_get_glfw_f64() - start_time) / (TEST_WORLD_BENCH_FRAMES * 100);
+
+    SZ list_hits = 0;
+    start_time   = time_get_glfw_f64();
+    for (U32 frame = 0; frame < TEST_WORLD_BENCH_FRAMES * 100; ++frame) {
+        WORLD_LIST_EACH(&g_world->type_lists[ENTITY_TYPE_NPC], id) { list_hits += g_world->type[id] == ENTITY_TYPE_NPC ? 1U : 0U; }
+    }
+    F64 const list_time = (time_get_glfw_f64() - start_time) / (TEST_WORLD_BENCH_FRAMES * 100);
+
+    TEST_ASSERT_EQUAL_INT(scan_hits, list_hits);
+    lli("All NPCs out of %d entities: scan %.3fus/frame, type list %.3fus/frame, %.2fx", WORLD_MAX_ENTITIES, scan_time * 1e6, list_time * 1e6,
+        scan_time / list_time);
+
+    test_scratch_world_end();
+}
+
+struct TestWorldAnimationStateKey {
+    U32 model_hash;
+    U32 anim_index;
+    BOOL is_blending;
+    U32 prev_anim_index;
+    SZ counts[2];  // Per selection state
+};
+
+// What the draw list used to cost, one instanced group per distinct animation state (or one draw per entity below
+// WORLD_DRAW_MIN_INSTANCE_COUNT), every instance skinned with the first entity's pose
+SZ static i_test_world_get_state_grouped_draw_call_count() {
+    auto *keys     = mmta(TestWorldAnimationStateKey *, sizeof(TestWorldAnimationStateKey) * TEST_WORLD_CROWD_COUNT);
+    SZ key_count   = 0;
+    for (SZ idx = 0; idx < g_world->active_entity_count; ++idx) {
+        EID const id             = g_world->active_entities[idx];
+        EntityAnimation const *a = &g_world->animation[id];
+
+        TestWorldAnimationStateKey *key = nullptr;
+        for (SZ k = 0; k < key_count; ++k) {
+            TestWorldAnimationStateKey *candidate = &keys[k];
+            if (candidate->model_hash == g_world->model_name_hash[id] && candidate->anim_index == a->anim_index &&
+                candidate->is_blending == a->is_blending && candidate->prev_anim_index == a->prev_anim_index) {
+                key = candidate;
+                break;
+            }
+        }
+        if (!key) {
+            key  = &keys[key_count++];
+            *key = {g_world->model_name_hash[id], a->anim_index, a->is_blending, a->prev_anim_index, {0, 0}};
+        }
+        key->counts[world_is_entity_selected(id) ? 1 : 0]++;
+    }
+
+    SZ count = 0;
+    for (SZ k = 0; k < key_count; ++k) {
+        SZ const total = keys[k].counts[0] + keys[k].counts[1];
+        if (total < WORLD_DRAW_MIN_INSTANCE_COUNT) {
+            count += total;
+            continue;
+        }
+        for (SZ selected = 0; selected < 2; ++selected) { count += keys[k].counts[selected] > 0 ? 1 : 0; }
+    }
+    return count;
+}
+
+void static test_world_draw_list_bone_palette() {
+    test_scratch_world_begin();
+
+    // The test writes poses into the real bone data, keep what was there
+    auto *saved_bones = mmta(Matrix *, sizeof(Matrix) * TEST_WORLD_CROWD_COUNT * TEST_WORLD_CROWD_BONE_COUNT);
+    for (EID i = 0; i < TEST_WORLD_CROWD_COUNT; ++i) {
+        ou_memcpy(&saved_bones[i * TEST_WORLD_CROWD_BONE_COUNT], g_animation_bones[i].bone_matrices, sizeof(Matrix) * TEST_WORLD_CROWD_BONE_COUNT);
+    }
+
+    // A crowd of NPCs sharing two models, spread over every combination of animation and blend
+    for (EID i = 0; i < TEST_WORLD_CROWD_COUNT; ++i) {
+        test_spawn_entity(i, ENTITY_TYPE_NPC, {(F32)i, 0.0F, 0.0F}, ENTITY_FLAG_MASK(ENTITY_FLAG_IN_FRUSTUM));
+        g_world->model_name_hash[i]           = 1000 + (i % TEST_WORLD_CROWD_MODEL_COUNT);
+        g_world->scale[i]                     = {1.0F, 1.0F, 1.0F};
+        g_world->tint[i]                      = WHITE;
+        g_world->animation[i].has_animations  = true;
+        g_world->animation[i].bone_count      = TEST_WORLD_CROWD_BONE_COUNT;
+        g_world->animation[i].anim_index      = (i / TEST_WORLD_CROWD_MODEL_COUNT) % TEST_WORLD_CROWD_ANIM_COUNT;
+        g_world->animation[i].is_blending     = i % 3 == 0;
+        g_world->animation[i].prev_anim_index = (i / 7) % TEST_WORLD_CROWD_ANIM_COUNT;
+        for (S32 bone = 0; bone < TEST_WORLD_CROWD_BONE_COUNT; ++bone) { g_animation_bones[i].bone_matrices[bone] = MatrixTranslate((F32)i, (F32)bone, 0.0F); }
+        if (i % 50 == 0) { world_selection_add(i); }
+    }
+
+    F64 const start_time = time_get_glfw_f64();
+    WorldDrawList list   = {};
+    world_draw_3d_sketch_prepare(&list);
+    F64 const prepare_time = time_get_glfw_f64() - start_time;
+
+    // Every instance finds exactly its own pose through its offset
+    TEST_ASSERT_EQUAL_INT(TEST_WORLD_CROWD_COUNT * TEST_WORLD_CROWD_BONE_COUNT, list.bone_palette.count);
+    SZ instance_count = 0;
+    for (SZ group_idx = 0; group_idx < list.groups.count; ++group_idx) {
+        WorldDrawGroup const *group = &list.groups.data[group_idx];
+        TEST_ASSERT_TRUE(group->animated);
+        TEST_ASSERT_TRUE(group->instanced);
+
+        SZ next[2] = {};
+        for (SZ j = 0; j < group->entities.count; ++j) {
+            EID const id       = group->entities.data[j];
+            SZ const selected  = world_is_entity_selected(id) ? 1 : 0;
+            U32 const offset   = group->palette_offsets[selected].data[next[selected]++];
+            TEST_ASSERT_EQUAL_INT(group->model_hash, g_world->model_name_hash[id]);
+            TEST_ASSERT_TRUE(offset + TEST_WORLD_CROWD_BONE_COUNT <= list.bone_palette.count);
+            for (S32 bone = 0; bone < TEST_WORLD_CROWD_BONE_COUNT; ++bone) {
+                TEST_ASSERT_EQUAL_FLOAT((F32)id, list.bone_palette.data[offset + (U32)bone].m12);
+                TEST_ASSERT_EQUAL_FLOAT((F32)bone, list.bone_palette.data[offset + (U32)bone].m13);
+            }
+        }
+        for (SZ selected = 0; selected < 2; ++selected) { TEST_ASSERT_EQUAL_INT(group->transforms[selected].count, group->palette_offsets[selected].count); }
+        instance_count += group->entities.count;
+    }
+    TEST_ASSERT_EQUAL_INT(TEST_WORLD_CROWD_COUNT, instance_count);
+
+    // One draw per model and selection state, no matter how many animation states the crowd is in
+    SZ const state_grouped_draw_calls = i_test_world_get_state_grouped_draw_call_count();
+    SZ const palette_draw_calls       = world_draw_list_get_draw_call_count(&list);
+    TEST_ASSERT_EQUAL_INT(TEST_WORLD_CROWD_MODEL_COUNT * 2, palette_draw_calls);
+    TEST_ASSERT_TRUE(palette_draw_calls < state_grouped_draw_calls);
+    lli("Crowd of %d animated NPCs: %zu draw calls grouped by animation state, %zu with bone palettes (%zu bones, prepare %.3fms)",
+        TEST_WORLD_CROWD_COUNT, state_grouped_draw_calls, palette_draw_calls, list.bone_palette.count, prepare_time * 1e3);
+
+    for (EID i = 0; i < TEST_WORLD_CROWD_COUNT; ++i) {
+        ou_memcpy(g_animation_bones[i].bone_matrices, &saved_bones[i * TEST_WORLD_CROWD_BONE_COUNT], sizeof(Matrix) * TEST_WORLD_CROWD_BONE_COUNT);
+    }
+    test_scratch_world_end();
+}
+
+void static test_world_entity_socket() {
+    test_scratch_world_begin();
+    AnimationBoneData *bones = &g_animation_bones[0];
+    Matrix const saved_hat   = bones->socket_transforms[A_MODEL_SOCKET_HAT];
+    U8 const saved_mask      = bones->socket_mask;
+
+    // What the animation phase would have left behind, a hat socket one unit up and one forward in entity space
+    bones->socket_transforms[A_MODEL_SOCKET_HAT] = MatrixTranslate(0.0F, 1.0F, 1.0F);
+    bones->socket_mask                           = 1U << A_MODEL_SOCKET_HAT;
+    g_world->position[0]                         = {10.0F, 0.0F, 5.0F};
+    g_world->scale[0]                            = {2.0F, 2.0F, 2.0F};
+    g_world->rotation[0]                         = 90.0F;
+
+    // The entity moved after the sockets were computed, reading them still follows it
+    Vector3 position = {};
+    TEST_ASSERT_TRUE(math_get_entity_socket_position(0, A_MODEL_SOCKET_HAT, &position));
+    TEST_ASSERT_FLOAT_WITHIN(1e-4F, 12.0F, position.x);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4F, 2.0F, position.y);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4F, 5.0F, position.z);
+
+    // A socket the model does not have is never filled in
+    TEST_ASSERT_FALSE(math_get_entity_socket_position(0, A_MODEL_SOCKET_HAND_L, &position));
+
+    bones->socket_transforms[A_MODEL_SOCKET_HAT] = saved_hat;
+    bones->socket_mask                           = saved_mask;
+    test_scratch_world_end();
+}
+
+void test_world() {
+    RUN_TEST(test_world_selection_add_remove);
+    RUN_TEST(test_world_selection_generation);
+    RUN_TEST(test_world_selection_performance_benchmark);
+    RUN_TEST(test_world_entity_lists);
+    RUN_TEST(test_world_entity_lists_performance_benchmark);
+    RUN_TEST(test_world_draw_list_bone_palette);
+    RUN_TEST(test_world_entity_socket);
+}
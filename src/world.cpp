@@ -1,7 +1,9 @@
 #include "world.hpp"
+#include "assert.hpp"
 #include "asset.hpp"
 #include "audio.hpp"
 #include "color.hpp"
+#include "command.hpp"
 #include "cvar.hpp"
 #include "dungeon.hpp"
 #include "edit.hpp"
@@ -14,14 +16,13 @@
 #include "particles_3d.hpp"
 #include "profiler.hpp"
 #include "render.hpp"
+#include "render_bone_palette.hpp"
 #include "std.hpp"
 #include "string.hpp"
 #include "time.hpp"
 
-#include <errno.h>
 #include <raymath.h>
 #include <string.h>
-#include <sys/stat.h>
 
 WorldState g_world_state = {};
 World* g_world = g_world_state.current;
@@ -49,6 +50,7 @@ void world_init() {
 
     // Initialize job system for multithreaded work (0 = auto-detect CPU cores)
     job_system_init(0);
+    command_init();
 
     player_init();
 }
@@ -72,11 +74,14 @@ void world_reset() {
         g_world->talker[i]         = {};
         g_world->building[i]       = {};
         g_world->name[i][0]        = '\0';
+        entity_actor_clear_target_tracker(i);
     }
 
-    g_world->active_entity_count   = 0;
-    g_world->max_gen               = 0;
-    g_world->selected_entity_count = 0;
+    g_world->active_entity_count = 0;
+    g_world->max_gen             = 0;
+    for (WorldEntityList &list : g_world->type_lists) { list.count = 0; }
+    g_world->actor_list.count = 0;
+    world_selection_clear();
 
     // Initialize multithreading synchronization
     g_world->mt_sync.destruction_count = 0;
@@ -84,85 +89,105 @@ void world_reset() {
     mtx_init(&g_world->mt_sync.building_mutex, mtx_plain);
     mtx_init(&g_world->mt_sync.entity_mutation_mutex, mtx_plain);
 
+    nav_reset(&g_world->nav);
     grid_clear();
 }
 
-// Animation update job data
+#define WORLD_UPDATE_ENTITY_GRAIN 64  // Entity and animation update share their chunks
+#define WORLD_UPDATE_ACTOR_GRAIN 128
+#define WORLD_HEALTHBAR_GRAIN 64
+
+// Per-thread counters of the entity update, padded so threads do not share cache lines
+struct alignas(64) EntityUpdateThreadCounters {
+    U32 entity_type_counts[ENTITY_TYPE_COUNT];
+    U32 visible_vertex_count;
+};
+
 // Entity update job data (lifetime, frustum, counting)
 struct EntityUpdateJobData {
     F32 dt;
-    U32 start_idx;
-    U32 end_idx;
-    U32 entity_type_counts[ENTITY_TYPE_COUNT];  // Per-thread counters
-    U32 visible_vertex_count;                    // Per-thread counter
+    EntityUpdateThreadCounters *per_thread;  // Indexed by job_system_get_thread_index()
+    U32 thread_count;                        // At least 1, threads outside the job system use the last slot
 };
 
+// Animation update job data
 struct AnimationUpdateJobData {
     F32 dt;
-    U32 start_idx;
-    U32 end_idx;
+};
+
+// Both phases of one chunk, see i_entity_animation_update_range()
+struct EntityAnimationUpdateJobData {
+    EntityUpdateJobData *entity;
+    AnimationUpdateJobData *animation;
 };
 
 // Actor update job data
 struct ActorUpdateJobData {
     F32 dt;
-    U32 start_idx;
-    U32 end_idx;
 };
 
-// Healthbar collection job data
-struct HealthbarCollectionJobData {
-    U32 start_idx;       // Start index in selected entities array
-    U32 end_idx;         // End index in selected entities array
-    EID *selected_eids;  // Pointer to selected entities array
-};
+// Submits and waits for the job, or runs its range right here if it could not be created
+void static i_run_phase(JobHandle job, U32 count, JobRangeFunc func, void *ctx) {
+    if (!job.job) {
+        S32 const result = func(0, count, ctx);
+        if (result != 0) { lle("Inline world update range failed with error %d", result); }
+        return;
+    }
 
-// Worker function for healthbar collection (executed by job system)
-S32 static i_healthbar_collection_worker(void *arg) {
-    auto *data = (HealthbarCollectionJobData *)arg;
+    job_submit(job);
+    job_wait(job);
+}
 
-    // Process each selected entity in this worker's range
-    for (U32 idx = data->start_idx; idx < data->end_idx; ++idx) {
-        EID const id = data->selected_eids[idx];
+// Range function for healthbar collection (executed by job system), ctx is the selected entities array
+S32 static i_healthbar_collection_range(U32 begin, U32 end, void *ctx) {
+    auto *selected_eids = (EID *)ctx;
+
+    // Process each selected entity in this chunk
+    for (U32 idx = begin; idx < end; ++idx) {
+        EID const id = selected_eids[idx];
 
         // Only process NPC entities
         if (g_world->type[id] != ENTITY_TYPE_NPC) { continue; }
 
-        // d2d_healthbar_batched() will do all validation and add to buffer
-        // (thread-safe via mutex in render_healthbar_add)
+        // d2d_healthbar_batched() will do all validation and record the healthbar, keyed by the selection order
+        command_begin(COMMAND_SOURCE_HEALTHBAR, idx);
         d2d_healthbar_batched(id);
     }
+    command_end();
 
     return 0;
 }
 
-// Worker function for entity updates (executed by job system)
-S32 static i_entity_update_worker(void *arg) {
-    auto *data = (EntityUpdateJobData *)arg;
-    F32 const dt = data->dt;
+// Range function for entity updates (executed by job system)
+S32 static i_entity_update_range(U32 begin, U32 end, void *ctx) {
+    auto *data                           = (EntityUpdateJobData *)ctx;
+    F32 const dt                         = data->dt;
+    U32 const thread_index               = job_system_get_thread_index();
+    _assert_(thread_index < data->thread_count || thread_index == JOB_THREAD_INDEX_NONE, "Entity update on an unknown thread");
 
-    // Initialize per-thread counters to zero
-    for (U32 i = 0; i < ENTITY_TYPE_COUNT; ++i) {
-        data->entity_type_counts[i] = 0;
-    }
-    data->visible_vertex_count = 0;
+    // Only the thread running world_update can be outside the job system, and only when the ranges run inline
+    EntityUpdateThreadCounters *counters = &data->per_thread[glm::min(thread_index, data->thread_count - 1)];
 
-    for (U32 idx = data->start_idx; idx < data->end_idx; ++idx) {
+    PBEGIN("i_entity_update_range");
+    for (U32 idx = begin; idx < end; ++idx) {
         EID const i = g_world->active_entities[idx];
         if (!ENTITY_HAS_FLAG(g_world->flags[i], ENTITY_FLAG_IN_USE)) { continue; }
 
         g_world->lifetime[i] += dt;
-        data->entity_type_counts[g_world->type[i]]++;
+        counters->entity_type_counts[g_world->type[i]]++;
 
         c3d_is_obb_in_frustum(g_world->obb[i]) ? ENTITY_SET_FLAG(g_world->flags[i], ENTITY_FLAG_IN_FRUSTUM)
                                               : ENTITY_CLEAR_FLAG(g_world->flags[i], ENTITY_FLAG_IN_FRUSTUM);
 
         if (ENTITY_HAS_FLAG(g_world->flags[i], ENTITY_FLAG_IN_FRUSTUM)) {
-            data->visible_vertex_count += asset_get_model_by_hash(g_world->model_name_hash[i])->vertex_count;
+            counters->visible_vertex_count += asset_get_model_by_hash(g_world->model_name_hash[i])->vertex_count;
         }
 
         if (g_world->type[i] == ENTITY_TYPE_BUILDING_LUMBERYARD) {
+            // The smoke is keyed by the building, otherwise it would sort by whichever worker ran the chunk
+            command_begin(COMMAND_SOURCE_BUILDING, i);
             entity_building_update(i, dt);
+            command_end();
         }
 
 #if OURO_TALK
@@ -173,15 +198,22 @@ S32 static i_entity_update_worker(void *arg) {
 #endif
     }
 
+    PEND("i_entity_update_range");
+
     return 0;
 }
 
-// Worker function for animation updates (executed by job system)
-S32 static i_animation_update_worker(void *arg) {
-    auto *data = (AnimationUpdateJobData *)arg;
+// Range function for animation updates (executed by job system)
+S32 static i_animation_update_range(U32 begin, U32 end, void *ctx) {
+    auto *data = (AnimationUpdateJobData *)ctx;
     F32 const dt = data->dt;
 
-    for (U32 idx = data->start_idx; idx < data->end_idx; ++idx) {
+    // Blending bones of the whole range get blended together at the end
+    MathBoneBlendBatch blend_batch;
+    blend_batch.count = 0;
+
+    PBEGIN("i_animation_update_range");
+    for (U32 idx = begin; idx < end; ++idx) {
         EID const id = g_world->active_entities[idx];
 
         if (!g_world->animation[id].has_animations) { continue; }
@@ -232,128 +264,133 @@ S32 static i_animation_update_worker(void *arg) {
         }
 
         // Compute bone matrices for this entity
-        math_compute_entity_bone_matrices(id);
+        math_compute_entity_bone_matrices(id, &blend_batch);
     }
 
+    math_bone_blend_batch_flush(&blend_batch);
+
+    PEND("i_animation_update_range");
+
     return 0;
 }
 
-// Worker function for actor updates (executed by job system)
-S32 static i_actor_update_worker(void *arg) {
-    auto *data = (ActorUpdateJobData *)arg;
+// Range function for the entity update and right after it the animation update of the same entities (executed by job
+// system). Animation only reads the frustum flags of its own entities, so a chunk never waits for any other chunk.
+S32 static i_entity_animation_update_range(U32 begin, U32 end, void *ctx) {
+    auto *data = (EntityAnimationUpdateJobData *)ctx;
+
+    S32 const result = i_entity_update_range(begin, end, data->entity);
+    if (result != 0) { return result; }
+
+    return i_animation_update_range(begin, end, data->animation);
+}
+
+// Range function for actor updates (executed by job system)
+S32 static i_actor_update_range(U32 begin, U32 end, void *ctx) {
+    auto *data = (ActorUpdateJobData *)ctx;
     F32 const dt = data->dt;
 
-    for (U32 idx = data->start_idx; idx < data->end_idx; ++idx) {
+    PBEGIN("i_actor_update_range");
+    for (U32 idx = begin; idx < end; ++idx) {
         EID const id = g_world->active_entities[idx];
 
         if (!ENTITY_HAS_FLAG(g_world->flags[id], ENTITY_FLAG_ACTOR)) { continue; }
 
+        // Everything the actor records gets executed in entity order, no matter which worker ran it
+        command_begin(COMMAND_SOURCE_ACTOR, id);
         entity_actor_update(id, dt);
     }
+    command_end();
+
+    PEND("i_actor_update_range");
 
     return 0;
 }
 
+// The graph follows what the current world walks on, the builders skip the work if that did not change
+void static i_sync_nav_graph() {
+    if (g_scenes.current_scene_type == SCENE_DUNGEON) {
+        dungeon_build_nav_graph(&g_world->nav, MEMORY_TYPE_ARENA_PERMANENT);
+    } else if (g_world->base_terrain) {
+        nav_build_from_terrain(&g_world->nav, g_world->base_terrain, GRID_CELLS_PER_ROW, MEMORY_TYPE_ARENA_PERMANENT);
+    }
+}
+
 void world_update(F32 dt, F32 dtu) {
     g_render.visible_vertex_count = 0;
 
     world_recorder_update();  // WARN: This needs to happen before anything that changes the world.
     grid_populate();
+    entity_actor_assign_targets();  // Before the actor phase, the requests of the last frame need the fresh grid
+    i_sync_nav_graph();
+    entity_actor_request_paths();   // After the targets got assigned, the actor phase only reads the paths
+    nav_update(&g_world->nav, (F64)c_world__path_budget_ms / 1000.0);
+    world_selection_validate();
     edit_update(dt, dtu);
     c3d_update_frustum();
 
     for (U32 &count : g_world->entity_type_counts) { count = 0; }
 
-    // Multithreaded entity updates (lifetime, frustum culling, counting)
+    // The target assignment above already recorded for some actors, whatever the actor jobs add for them goes after it
+    command_next_phase();
+
+    // Multithreaded entity (lifetime, frustum culling, counting), animation and actor updates.
+    // Animation needs the frustum flags of the entity update, chunk by chunk, so both run in the same job and the
+    // chunks overlap freely. Actors read other entities though (lumberyard state and scale, the flags of their targets),
+    // so the actor phase depends on all of the chunks and we only wait once for it.
     if (g_world->active_entity_count > 0) {
-        PBEGIN("entity_update_MT");
-        U32 const worker_count = job_system_get_worker_count();
-        U32 const entities_per_worker = (g_world->active_entity_count + worker_count - 1) / worker_count;
+        PBEGIN("world_update_MT");
+        U32 const thread_count = glm::max(job_system_get_thread_count(), 1U);
+        U32 const count        = g_world->active_entity_count;
 
-        auto *job_data = mmta(EntityUpdateJobData *, sizeof(EntityUpdateJobData) * worker_count);
+        auto *entity_data         = mmta(EntityUpdateJobData *, sizeof(EntityUpdateJobData));
+        entity_data->dt           = dt;
+        entity_data->per_thread   = mcta(EntityUpdateThreadCounters *, thread_count, sizeof(EntityUpdateThreadCounters));
+        entity_data->thread_count = thread_count;
 
-        for (U32 i = 0; i < worker_count; ++i) {
-            U32 const start_idx = i * entities_per_worker;
-            U32 const end_idx = glm::min(start_idx + entities_per_worker, g_world->active_entity_count);
+        auto *animation_data = mmta(AnimationUpdateJobData *, sizeof(AnimationUpdateJobData));
+        animation_data->dt   = dt;
 
-            if (start_idx >= g_world->active_entity_count) { break; }
+        auto *entity_animation_data      = mmta(EntityAnimationUpdateJobData *, sizeof(EntityAnimationUpdateJobData));
+        entity_animation_data->entity    = entity_data;
+        entity_animation_data->animation = animation_data;
 
-            job_data[i].dt = dt;
-            job_data[i].start_idx = (U32)start_idx;
-            job_data[i].end_idx = (U32)end_idx;
+        auto *actor_data = mmta(ActorUpdateJobData *, sizeof(ActorUpdateJobData));
+        actor_data->dt   = dt;
 
-            job_system_submit(i_entity_update_worker, &job_data[i]);
-        }
+        JobHandle const entity_job = job_parallel_for_create(0, count, WORLD_UPDATE_ENTITY_GRAIN, i_entity_animation_update_range, entity_animation_data, JOB_PRIORITY_HIGH);
+        JobHandle const actor_job  = job_parallel_for_create(0, count, WORLD_UPDATE_ACTOR_GRAIN, i_actor_update_range, actor_data, JOB_PRIORITY_HIGH);
 
-        job_system_wait();
+        if (entity_job.job && actor_job.job) {
+            job_add_dependency(actor_job, entity_job);
 
-        // Merge per-thread counters
-        for (U32 i = 0; i < worker_count; ++i) {
-            if (job_data[i].start_idx >= g_world->active_entity_count) { break; }
+            job_submit(actor_job);
+            job_submit(entity_job);
 
-            for (U32 type_idx = 0; type_idx < ENTITY_TYPE_COUNT; ++type_idx) {
-                g_world->entity_type_counts[type_idx] += job_data[i].entity_type_counts[type_idx];
-            }
-            g_render.visible_vertex_count += job_data[i].visible_vertex_count;
+            job_wait(actor_job);
+        } else {
+            // Out of jobs, every phase still has to run and in order. The ones that did get created go one by one.
+            llw("Could not create every world update job, running the phases one after the other");
+            i_run_phase(entity_job, count, i_entity_animation_update_range, entity_animation_data);
+            i_run_phase(actor_job, count, i_actor_update_range, actor_data);
         }
 
-        PEND("entity_update_MT");
-    }
-
-    // Build active entities array for draw functions to use
-    g_world->active_entity_count = 0;
-    for (EID i = 0; i < WORLD_MAX_ENTITIES; ++i) {
-        if (ENTITY_HAS_FLAG(g_world->flags[i], ENTITY_FLAG_IN_USE)) { g_world->active_entities[g_world->active_entity_count++] = i; }
-    }
-
-    // Update all entity animations (multithreaded)
-    if (g_world->active_entity_count > 0) {
-        PBEGIN("anim_update_MT");
-        U32 const worker_count = job_system_get_worker_count();
-        U32 const entities_per_worker = (g_world->active_entity_count + worker_count - 1) / worker_count;
-
-        auto *job_data = mmta(AnimationUpdateJobData *, sizeof(AnimationUpdateJobData) * worker_count);
-
-        for (U32 i = 0; i < worker_count; ++i) {
-            U32 const start_idx = i * entities_per_worker;
-            U32 const end_idx = glm::min(start_idx + entities_per_worker, g_world->active_entity_count);
-
-            if (start_idx >= g_world->active_entity_count) { break; }
-
-            job_data[i].dt = dt;
-            job_data[i].start_idx = (U32)start_idx;
-            job_data[i].end_idx = (U32)end_idx;
-
-            job_system_submit(i_animation_update_worker, &job_data[i]);
+        // Actors only moved, the walls get resolved for all of them in one go. With the positions final the occlusion
+        // is worked out once for every draw pass of the frame.
+        if (g_scenes.current_scene_type == SCENE_DUNGEON) {
+            dungeon_resolve_wall_collision_batch();
+            dungeon_update_visibility();
         }
 
-        job_system_wait();
-        PEND("anim_update_MT");
-    }
-
-    // Update all entity actors (multithreaded)
-    if (g_world->active_entity_count > 0) {
-        PBEGIN("actor_update_MT");
-        U32 const worker_count = job_system_get_worker_count();
-        U32 const entities_per_worker = (g_world->active_entity_count + worker_count - 1) / worker_count;
-
-        auto *job_data = mmta(ActorUpdateJobData *, sizeof(ActorUpdateJobData) * worker_count);
-
-        for (U32 i = 0; i < worker_count; ++i) {
-            U32 const start_idx = i * entities_per_worker;
-            U32 const end_idx = glm::min(start_idx + entities_per_worker, g_world->active_entity_count);
-
-            if (start_idx >= g_world->active_entity_count) { break; }
-
-            job_data[i].dt = dt;
-            job_data[i].start_idx = (U32)start_idx;
-            job_data[i].end_idx = (U32)end_idx;
-
-            job_system_submit(i_actor_update_worker, &job_data[i]);
+        // Merge per-thread counters
+        for (U32 i = 0; i < thread_count; ++i) {
+            for (U32 type_idx = 0; type_idx < ENTITY_TYPE_COUNT; ++type_idx) {
+                g_world->entity_type_counts[type_idx] += entity_data->per_thread[i].entity_type_counts[type_idx];
+            }
+            g_render.visible_vertex_count += entity_data->per_thread[i].visible_vertex_count;
         }
 
-        job_system_wait();
-        PEND("actor_update_MT");
+        PEND("world_update_MT");
 
         // Process deferred entity destructions (must happen after all actor jobs complete)
         mtx_lock(&g_world->mt_sync.destruction_mutex);
@@ -364,6 +401,9 @@ void world_update(F32 dt, F32 dtu) {
         }
         g_world->mt_sync.destruction_count = 0;
         mtx_unlock(&g_world->mt_sync.destruction_mutex);
+
+        // Recounting all followers every frame is too slow for devel builds
+        if (OURO_IS_DEBUG_NO_DEVEL) { _assert_(world_target_tracker_validate(), "Follower counts out of sync with the actor targets"); }
     }
 }
 
@@ -386,9 +426,7 @@ void world_draw_2d_hud() {
         if (!ENTITY_HAS_FLAG(g_world->flags[i], ENTITY_FLAG_IN_FRUSTUM)) { continue; }
 
         // Check occlusion by dungeon walls (only in dungeon scene)
-        if (g_scenes.current_scene_type == SCENE_DUNGEON) {
-            if (dungeon_is_entity_occluded(i)) { continue; }
-        }
+        if (g_scenes.current_scene_type == SCENE_DUNGEON && world_is_entity_occluded(i)) { continue; }
 
         if (g_world->type[i] == ENTITY_TYPE_NPC) {
             entity_actor_draw_2d_hud(i);
@@ -403,25 +441,9 @@ void world_draw_2d_hud() {
     // For multi-selection: collect healthbars in parallel, then draw
     if (g_world->selected_entity_count > 1) {
         PBEGIN("healthbar_collection_MT");
-        U32 const worker_count = job_system_get_worker_count();
-        SZ const entities_per_worker = (g_world->selected_entity_count + worker_count - 1) / worker_count;
-
-        auto *job_data = mmta(HealthbarCollectionJobData *, sizeof(HealthbarCollectionJobData) * worker_count);
-
-        for (U32 i = 0; i < worker_count; ++i) {
-            SZ const start_idx = i * entities_per_worker;
-            SZ const end_idx = glm::min(start_idx + entities_per_worker, g_world->selected_entity_count);
-
-            if (start_idx >= g_world->selected_entity_count) { break; }
-
-            job_data[i].start_idx = (U32)start_idx;
-            job_data[i].end_idx = (U32)end_idx;
-            job_data[i].selected_eids = g_world->selected_entities;
-
-            job_system_submit(i_healthbar_collection_worker, &job_data[i]);
-        }
-
-        job_system_wait();
+        JobHandle const healthbar_job = job_parallel_for(0, (U32)g_world->selected_entity_count, WORLD_HEALTHBAR_GRAIN, i_healthbar_collection_range, g_world->selected_entities);
+        job_wait(healthbar_job);
+        command_flush_source(COMMAND_SOURCE_HEALTHBAR);  // Into the batch for this frame, the rest waits for core_update
         PEND("healthbar_collection_MT");
 
         // Draw all collected healthbars in one instanced draw call
@@ -441,18 +463,9 @@ void world_draw_2d_dbg() {
         if (!ENTITY_HAS_FLAG(g_world->flags[i], ENTITY_FLAG_IN_FRUSTUM)) { continue; }
 
         // Check occlusion by dungeon walls (only in dungeon scene)
-        if (g_scenes.current_scene_type == SCENE_DUNGEON) {
-            if (dungeon_is_entity_occluded(i)) { continue; }
-        }
+        if (g_scenes.current_scene_type == SCENE_DUNGEON && world_is_entity_occluded(i)) { continue; }
 
-        // Check if entity is in selection
-        BOOL is_selected = false;
-        for (SZ sel_idx = 0; sel_idx < g_world->selected_entity_count; ++sel_idx) {
-            if (g_world->selected_entities[sel_idx] == i) {
-                is_selected = true;
-                break;
-            }
-        }
+        BOOL const is_selected = world_is_entity_selected(i);
 
         if (c_debug__gizmo_info && is_selected) { d2d_gizmo(i); }
 
@@ -476,60 +489,83 @@ void world_draw_3d() {
 #define BACKPACK_OFFSET_UPWARD -0.3F
 // Scale of the backpack relative to actor scale
 #define BACKPACK_MAX_SCALE  0.2F
-// Minimum number of instances to use instanced rendering (avoids overhead for single entities)
-#define MIN_INSTANCE_COUNT 2
 
 // Instanced rendering: map from model name to array of entity IDs
 MAP_DECLARE(InstanceGroupMap, U32, EIDArray, MAP_HASH_U32, MAP_EQUAL_U32);
 
-struct AnimationStateKey {
-    U32 model_hash;
-    U32 anim_index;
-    S32 bone_count;
-    BOOL is_blending;
-    U32 prev_anim_index;
-};
+void static i_draw_group_add_instance(WorldDrawList *list, WorldDrawGroup *group, EID i) {
+    Matrix mat_scale = MatrixScale(g_world->scale[i].x, g_world->scale[i].y, g_world->scale[i].z);
+    Matrix mat_rot = MatrixRotate((Vector3){0, 1, 0}, g_world->rotation[i] * DEG2RAD);
+    Matrix mat_trans = MatrixTranslate(g_world->position[i].x, g_world->position[i].y, g_world->position[i].z);
+    Matrix transform = MatrixMultiply(MatrixMultiply(mat_scale, mat_rot), mat_trans);
+
+    SZ const selected = world_is_entity_selected(i) ? 1 : 0;
+    array_push(&group->transforms[selected], transform);
+    array_push(&group->tints[selected], g_world->tint[i]);
+
+    if (group->animated) {
+        // Each instance gets its own copy of its current pose, the shader finds it through the offset
+        array_push(&group->palette_offsets[selected], (U32)list->bone_palette.count);
+        S32 const bone_count = g_world->animation[i].bone_count;
+        for (S32 bone = 0; bone < bone_count; ++bone) { array_push(&list->bone_palette, g_animation_bones[i].bone_matrices[bone]); }
+    }
+}
+
+void static i_draw_group_finish(WorldDrawList *list, U32 model_hash, BOOL animated, EIDArray entities) {
+    // Validate group has data and count before processing
+    if (!entities.data || entities.count == 0) { return; }
+
+    WorldDrawGroup group = {};
+    group.model_hash     = model_hash;
+    group.animated       = animated;
+    group.instanced      = entities.count >= WORLD_DRAW_MIN_INSTANCE_COUNT;
+    group.entities       = entities;
+
+    if (group.instanced) {
+        // Build transform, color and palette offset arrays, split by selection state
+        for (SZ selected = 0; selected < 2; ++selected) {
+            array_init(MEMORY_TYPE_ARENA_TRANSIENT, &group.transforms[selected], entities.count);
+            array_init(MEMORY_TYPE_ARENA_TRANSIENT, &group.tints[selected], entities.count);
+            if (animated) { array_init(MEMORY_TYPE_ARENA_TRANSIENT, &group.palette_offsets[selected], entities.count); }
+        }
+        for (SZ j = 0; j < entities.count; ++j) { i_draw_group_add_instance(list, &group, entities.data[j]); }
+    }
 
-static inline U32 animation_state_key_hash(AnimationStateKey key) {
-    U32 hash = 2166136261u;
-    hash ^= key.model_hash;
-    hash *= 16777619u;
-    hash ^= key.anim_index;
-    hash *= 16777619u;
-    hash ^= (U32)key.bone_count;
-    hash *= 16777619u;
-    hash ^= (U32)key.is_blending;
-    hash *= 16777619u;
-    hash ^= key.prev_anim_index;
-    hash *= 16777619u;
-    return hash;
+    array_push(&list->groups, group);
 }
 
-static inline BOOL animation_state_key_equal(AnimationStateKey a, AnimationStateKey b) {
-    return a.model_hash == b.model_hash &&
-           a.anim_index == b.anim_index &&
-           a.bone_count == b.bone_count &&
-           a.is_blending == b.is_blending &&
-           a.prev_anim_index == b.prev_anim_index;
+SZ world_draw_list_get_draw_call_count(WorldDrawList const *list) {
+    // Per draw call, not per mesh, same as what INCREMENT_DRAW_CALL counts
+    SZ count = 0;
+    for (SZ group_idx = 0; group_idx < list->groups.count; ++group_idx) {
+        WorldDrawGroup const *group = &list->groups.data[group_idx];
+        if (!group->instanced) {
+            count += group->entities.count;
+            continue;
+        }
+        for (SZ selected = 0; selected < 2; ++selected) { count += group->transforms[selected].count > 0 ? 1 : 0; }
+    }
+    if (list->backpack_transforms.count > 0) { count++; }
+    return count;
 }
 
-MAP_DECLARE(AnimatedInstanceGroupMap, AnimationStateKey, EIDArray, animation_state_key_hash, animation_state_key_equal);
-void world_draw_3d_sketch() {
+void world_draw_3d_sketch_prepare(WorldDrawList *list) {
     F32 const bp_base_scale = BACKPACK_MAX_SCALE*0.5F;
 
     // Group static entities by model name for instanced rendering
     InstanceGroupMap instance_groups;
     InstanceGroupMap_init(&instance_groups, MEMORY_TYPE_ARENA_TRANSIENT, 32);
 
-    // Group animated entities by animation state for instanced rendering
-    AnimatedInstanceGroupMap animated_instance_groups;
-    AnimatedInstanceGroupMap_init(&animated_instance_groups, MEMORY_TYPE_ARENA_TRANSIENT, 32);
+    // Group animated entities by model as well, each instance brings its own bones
+    InstanceGroupMap animated_instance_groups;
+    InstanceGroupMap_init(&animated_instance_groups, MEMORY_TYPE_ARENA_TRANSIENT, 32);
 
     // Collect backpack instances for batch rendering
-    MatrixArray backpack_transforms;
-    ColorArray backpack_tints;
-    array_init(MEMORY_TYPE_ARENA_TRANSIENT, &backpack_transforms, 1024);
-    array_init(MEMORY_TYPE_ARENA_TRANSIENT, &backpack_tints, 1024);
+    *list = {};
+    array_init(MEMORY_TYPE_ARENA_TRANSIENT, &list->groups, 64);
+    array_init(MEMORY_TYPE_ARENA_TRANSIENT, &list->bone_palette, 4096);
+    array_init(MEMORY_TYPE_ARENA_TRANSIENT, &list->backpack_transforms, 1024);
+    array_init(MEMORY_TYPE_ARENA_TRANSIENT, &list->backpack_tints, 1024);
 
     // First pass: Group entities by rendering state
     for (SZ idx = 0; idx < g_world->active_entity_count; ++idx) {
@@ -537,25 +573,16 @@ void world_draw_3d_sketch() {
         if (!ENTITY_HAS_FLAG(g_world->flags[i], ENTITY_FLAG_IN_FRUSTUM)) { continue; }
 
         // Check occlusion by dungeon walls (only in dungeon scene)
-        if (g_scenes.current_scene_type == SCENE_DUNGEON) {
-            if (dungeon_is_entity_occluded(i)) { continue; }
-        }
+        if (g_scenes.current_scene_type == SCENE_DUNGEON && world_is_entity_occluded(i)) { continue; }
 
         if (g_world->animation[i].has_animations) {
-            AnimationStateKey key = {
-                .model_hash = g_world->model_name_hash[i],
-                .anim_index = g_world->animation[i].anim_index,
-                .bone_count = g_world->animation[i].bone_count,
-                .is_blending = g_world->animation[i].is_blending,
-                .prev_anim_index = g_world->animation[i].prev_anim_index
-            };
-
-            EIDArray *group = AnimatedInstanceGroupMap_get(&animated_instance_groups, key);
+            U32 const model_name_hash = g_world->model_name_hash[i];
+            EIDArray *group = InstanceGroupMap_get(&animated_instance_groups, model_name_hash);
             if (!group) {
                 EIDArray new_group = {};
                 array_init(MEMORY_TYPE_ARENA_TRANSIENT, &new_group, 64);
-                AnimatedInstanceGroupMap_insert(&animated_instance_groups, key, new_group);
-                group = AnimatedInstanceGroupMap_get(&animated_instance_groups, key);
+                InstanceGroupMap_insert(&animated_instance_groups, model_name_hash, new_group);
+                group = InstanceGroupMap_get(&animated_instance_groups, model_name_hash);
             }
 
             if (group) {
@@ -584,12 +611,8 @@ void world_draw_3d_sketch() {
                 Vector3 scale = g_world->scale[i];
                 Vector3 backpack_pos;
 
-                // Attach to bone - skip if bone not found
-                C8 const *bone_name = "socket_hat";
-                if (!math_get_bone_world_position_by_name(i, bone_name, &backpack_pos)) {
-                    llw("Could not find bone to attach backpack");
-                    continue;  // Skip this backpack if we can't find the bone
-                }
+                // Attach to the hat socket the animation update already computed - skip if the model has none
+                if (!math_get_entity_socket_position(i, A_MODEL_SOCKET_HAT, &backpack_pos)) { continue; }
 
                 // Offset backpack backwards and down
                 F32 const rotation_rad = rotation * DEG2RAD;
@@ -632,152 +655,88 @@ void world_draw_3d_sketch() {
                 Matrix mat_trans = MatrixTranslate(backpack_pos.x, backpack_pos.y, backpack_pos.z);
                 Matrix transform = MatrixMultiply(MatrixMultiply(mat_scale, mat_rot), mat_trans);
 
-                array_push(&backpack_transforms, transform);
-                array_push(&backpack_tints, wood_color);
+                array_push(&list->backpack_transforms, transform);
+                array_push(&list->backpack_tints, wood_color);
             }
         }
     }
 
-    // Second pass: Batch render animated entity groups
-    AnimationStateKey anim_key = {};
+    // Second pass: Build the animated groups and their bone palette
+    U32 anim_model_hash = 0;
     EIDArray anim_group = {};
-    MAP_EACH(&animated_instance_groups, anim_key, anim_group) {
-        // Validate group has data and count before processing
-        if (!anim_group.data || anim_group.count == 0) { continue; }
-
-        if (anim_group.count < MIN_INSTANCE_COUNT) {
-            // Not worth instancing for single/few entities - use regular rendering
-            for (SZ j = 0; j < anim_group.count; ++j) {
-                EID const i = anim_group.data[j];
-                S32 is_selected = world_is_entity_selected(i) ? 1 : 0;
-                SetShaderValue(g_render.model_shader.shader->base, g_render.model_shader.is_selected_loc, &is_selected, SHADER_UNIFORM_INT);
-
-                d3d_model_animated_by_hash(
-                    g_world->model_name_hash[i],
-                    g_world->position[i],
-                    g_world->rotation[i],
-                    g_world->scale[i],
-                    g_world->tint[i],
-                    g_animation_bones[i].bone_matrices,
-                    g_world->animation[i].bone_count
-                );
-            }
-        } else {
-            // Build transform and color arrays, split by selection state
-            MatrixArray transforms_selected;
-            ColorArray tints_selected;
-            MatrixArray transforms_unselected;
-            ColorArray tints_unselected;
-            array_init(MEMORY_TYPE_ARENA_TRANSIENT, &transforms_selected, anim_group.count);
-            array_init(MEMORY_TYPE_ARENA_TRANSIENT, &tints_selected, anim_group.count);
-            array_init(MEMORY_TYPE_ARENA_TRANSIENT, &transforms_unselected, anim_group.count);
-            array_init(MEMORY_TYPE_ARENA_TRANSIENT, &tints_unselected, anim_group.count);
-
-            // Get bone matrices from first entity in group (they all share the same animation state)
-            EID const first_entity = anim_group.data[0];
-            Matrix *bone_matrices = g_animation_bones[first_entity].bone_matrices;
-            S32 bone_count = g_world->animation[first_entity].bone_count;
-
-            for (SZ j = 0; j < anim_group.count; ++j) {
-                EID const i = anim_group.data[j];
-                Matrix mat_scale = MatrixScale(g_world->scale[i].x, g_world->scale[i].y, g_world->scale[i].z);
-                Matrix mat_rot = MatrixRotate((Vector3){0, 1, 0}, g_world->rotation[i] * DEG2RAD);
-                Matrix mat_trans = MatrixTranslate(g_world->position[i].x, g_world->position[i].y, g_world->position[i].z);
-                Matrix transform = MatrixMultiply(MatrixMultiply(mat_scale, mat_rot), mat_trans);
+    MAP_EACH(&animated_instance_groups, anim_model_hash, anim_group) { i_draw_group_finish(list, anim_model_hash, true, anim_group); }
 
-                if (world_is_entity_selected(i)) {
-                    array_push(&transforms_selected, transform);
-                    array_push(&tints_selected, g_world->tint[i]);
-                } else {
-                    array_push(&transforms_unselected, transform);
-                    array_push(&tints_unselected, g_world->tint[i]);
-                }
-            }
+    // Third pass: Build the static groups
+    U32 model_name_hash = 0;
+    EIDArray group = {};
+    MAP_EACH(&instance_groups, model_name_hash, group) { i_draw_group_finish(list, model_name_hash, false, group); }
+}
 
-            // Draw non-selected animated instances (with NULL check)
-            if (transforms_unselected.count > 0 && transforms_unselected.data && tints_unselected.data) {
-                S32 is_selected = 0;
-                SetShaderValue(g_render.model_animated_instanced_shader.shader->base, g_render.model_animated_instanced_shader.is_selected_loc, &is_selected, SHADER_UNIFORM_INT);
-                d3d_model_animated_instanced_by_hash(anim_key.model_hash, transforms_unselected.data, tints_unselected.data, transforms_unselected.count, bone_matrices, bone_count);
-            }
+void world_draw_3d_sketch() {
+    WorldDrawList list = {};
+    world_draw_3d_sketch_prepare(&list);
 
-            // Draw selected animated instances (with NULL check)
-            if (transforms_selected.count > 0 && transforms_selected.data && tints_selected.data) {
-                S32 is_selected = 1;
-                SetShaderValue(g_render.model_animated_instanced_shader.shader->base, g_render.model_animated_instanced_shader.is_selected_loc, &is_selected, SHADER_UNIFORM_INT);
-                d3d_model_animated_instanced_by_hash(anim_key.model_hash, transforms_selected.data, tints_selected.data, transforms_selected.count, bone_matrices, bone_count);
-            }
-        }
-    }
+    // One upload of every animated instance's bones for the whole frame
+    render_bone_palette_begin();
+    U32 bone_base            = 0;
+    BOOL const palette_ready = list.bone_palette.count == 0 || render_bone_palette_upload_bones(list.bone_palette.data, list.bone_palette.count, &bone_base);
 
-    // Third pass: Batch render static entity groups
-    U32 model_name_hash = 0;
-    EIDArray group = {};
-    MAP_EACH(&instance_groups, model_name_hash, group) {
-        // Validate group has data and count before processing
-        if (!group.data || group.count == 0) { continue; }
+    for (SZ group_idx = 0; group_idx < list.groups.count; ++group_idx) {
+        WorldDrawGroup const *group = &list.groups.data[group_idx];
 
-        if (group.count < MIN_INSTANCE_COUNT) {
+        // Without the palette the instanced shader has no bones, draw these one by one instead
+        if (!group->instanced || (group->animated && !palette_ready)) {
             // Not worth instancing for single/few entities - use regular rendering
-            for (SZ j = 0; j < group.count; ++j) {
-                EID const i = group.data[j];
+            for (SZ j = 0; j < group->entities.count; ++j) {
+                EID const i = group->entities.data[j];
                 S32 is_selected = world_is_entity_selected(i) ? 1 : 0;
                 SetShaderValue(g_render.model_shader.shader->base, g_render.model_shader.is_selected_loc, &is_selected, SHADER_UNIFORM_INT);
 
-                d3d_model_by_hash(
-                    model_name_hash,
-                    g_world->position[i],
-                    g_world->rotation[i],
-                    g_world->scale[i],
-                    g_world->tint[i]
-                );
-            }
-        } else {
-            // Build transform and color arrays, split by selection state
-            MatrixArray transforms_selected;
-            ColorArray tints_selected;
-            MatrixArray transforms_unselected;
-            ColorArray tints_unselected;
-            array_init(MEMORY_TYPE_ARENA_TRANSIENT, &transforms_selected, group.count);
-            array_init(MEMORY_TYPE_ARENA_TRANSIENT, &tints_selected, group.count);
-            array_init(MEMORY_TYPE_ARENA_TRANSIENT, &transforms_unselected, group.count);
-            array_init(MEMORY_TYPE_ARENA_TRANSIENT, &tints_unselected, group.count);
-
-            for (SZ j = 0; j < group.count; ++j) {
-                EID const i = group.data[j];
-                Matrix mat_scale = MatrixScale(g_world->scale[i].x, g_world->scale[i].y, g_world->scale[i].z);
-                Matrix mat_rot = MatrixRotate((Vector3){0, 1, 0}, g_world->rotation[i] * DEG2RAD);
-                Matrix mat_trans = MatrixTranslate(g_world->position[i].x, g_world->position[i].y, g_world->position[i].z);
-                Matrix transform = MatrixMultiply(MatrixMultiply(mat_scale, mat_rot), mat_trans);
-
-                if (world_is_entity_selected(i)) {
-                    array_push(&transforms_selected, transform);
-                    array_push(&tints_selected, g_world->tint[i]);
+                if (group->animated) {
+                    d3d_model_animated_by_hash(
+                        g_world->model_name_hash[i],
+                        g_world->position[i],
+                        g_world->rotation[i],
+                        g_world->scale[i],
+                        g_world->tint[i],
+                        g_animation_bones[i].bone_matrices,
+                        g_world->animation[i].bone_count
+                    );
                 } else {
-                    array_push(&transforms_unselected, transform);
-                    array_push(&tints_unselected, g_world->tint[i]);
+                    d3d_model_by_hash(
+                        group->model_hash,
+                        g_world->position[i],
+                        g_world->rotation[i],
+                        g_world->scale[i],
+                        g_world->tint[i]
+                    );
                 }
             }
+            continue;
+        }
 
-            // Draw non-selected instances (with NULL check)
-            if (transforms_unselected.count > 0 && transforms_unselected.data && tints_unselected.data) {
-                S32 is_selected = 0;
-                SetShaderValue(g_render.model_instanced_shader.shader->base, g_render.model_instanced_shader.is_selected_loc, &is_selected, SHADER_UNIFORM_INT);
-                d3d_model_instanced_by_hash(model_name_hash, transforms_unselected.data, tints_unselected.data, transforms_unselected.count);
-            }
-
-            // Draw selected instances (with NULL check)
-            if (transforms_selected.count > 0 && transforms_selected.data && tints_selected.data) {
-                S32 is_selected = 1;
-                SetShaderValue(g_render.model_instanced_shader.shader->base, g_render.model_instanced_shader.is_selected_loc, &is_selected, SHADER_UNIFORM_INT);
-                d3d_model_instanced_by_hash(model_name_hash, transforms_selected.data, tints_selected.data, transforms_selected.count);
+        // Non-selected instances first, then the selected ones (with NULL check)
+        Shader const shader = group->animated ? g_render.model_animated_instanced_shader.shader->base : g_render.model_instanced_shader.shader->base;
+        S32 const selected_loc = group->animated ? g_render.model_animated_instanced_shader.is_selected_loc : g_render.model_instanced_shader.is_selected_loc;
+        for (S32 is_selected = 0; is_selected < 2; ++is_selected) {
+            MatrixArray const *transforms = &group->transforms[is_selected];
+            ColorArray const *tints       = &group->tints[is_selected];
+            if (transforms->count == 0 || !transforms->data || !tints->data) { continue; }
+
+            SetShaderValue(shader, selected_loc, &is_selected, SHADER_UNIFORM_INT);
+            if (group->animated) {
+                d3d_model_animated_instanced_by_hash(group->model_hash, transforms->data, tints->data, transforms->count, group->palette_offsets[is_selected].data, bone_base);
+            } else {
+                d3d_model_instanced_by_hash(group->model_hash, transforms->data, tints->data, transforms->count);
             }
         }
     }
 
+    render_bone_palette_end();
+
     // Fourth pass: Batch render all backpacks
-    if (backpack_transforms.count > 0) {
-        d3d_model_instanced("wood.glb", backpack_transforms.data, backpack_tints.data, backpack_transforms.count);
+    if (list.backpack_transforms.count > 0) {
+        d3d_model_instanced("wood.glb", list.backpack_transforms.data, list.backpack_tints.data, list.backpack_transforms.count);
     }
 
     // Reset isSelected to 0 after entity rendering
@@ -802,9 +761,7 @@ void world_draw_3d_dbg() {
         if (!ENTITY_HAS_FLAG(g_world->flags[i], ENTITY_FLAG_IN_FRUSTUM)) { continue; }
 
         // Check occlusion by dungeon walls (only in dungeon scene)
-        if (g_scenes.current_scene_type == SCENE_DUNGEON) {
-            if (dungeon_is_entity_occluded(i)) { continue; }
-        }
+        if (g_scenes.current_scene_type == SCENE_DUNGEON && world_is_entity_occluded(i)) { continue; }
 
         F32 gizmos_alpha       = 1.0F;
         BOOL const is_selected = world_is_entity_selected(i);
@@ -849,19 +806,125 @@ void world_set_selected_entity(EID id) {
     }
 
     // Clear previous selection and select this entity
+    world_selection_clear();
+    world_selection_add(id);
+
+    audio_play(ACG_SFX, "selected_0.ogg");
+}
+
+BOOL static i_selection_bit(EID id) {
+    return (g_world->selected_bits[id / 64] >> (id % 64)) & 1;
+}
+
+void world_selection_clear() {
+    ou_memset(g_world->selected_bits, 0, sizeof(g_world->selected_bits));
     g_world->selected_entity_count = 0;
+}
+
+void world_selection_add(EID id) {
+    if (id >= WORLD_MAX_ENTITIES) { return; }
+
+    // A set bit with an old generation is a dead entity whose slot got reused, the entry can simply be taken over
+    g_world->selected_generation[id] = g_world->generation[id];
+    if (i_selection_bit(id)) { return; }
+
+    g_world->selected_bits[id / 64]                              |= 1ULL << (id % 64);
+    g_world->selected_index[id]                                   = (U32)g_world->selected_entity_count;
     g_world->selected_entities[g_world->selected_entity_count++] = id;
+}
 
-    audio_play(ACG_SFX, "selected_0.ogg");
+void world_selection_remove(EID id) {
+    if (id >= WORLD_MAX_ENTITIES || !i_selection_bit(id)) { return; }
+
+    U32 const index = g_world->selected_index[id];
+    EID const last  = g_world->selected_entities[--g_world->selected_entity_count];
+
+    g_world->selected_entities[index] = last;
+    g_world->selected_index[last]     = index;
+    g_world->selected_bits[id / 64]  &= ~(1ULL << (id % 64));
 }
 
-BOOL world_is_entity_selected(EID id) {
-    for (SZ i = 0; i < g_world->selected_entity_count; ++i) {
-        if (g_world->selected_entities[i] == id) {
-            return true;
-        }
+void world_selection_toggle(EID id) {
+    if (world_is_entity_selected(id)) {
+        world_selection_remove(id);
+    } else {
+        world_selection_add(id);
     }
-    return false;
+}
+
+void world_selection_validate() {
+    // Backwards so the swap-remove only ever moves entries we already looked at
+    for (SZ i = g_world->selected_entity_count; i-- > 0;) {
+        EID const id = g_world->selected_entities[i];
+        if (!world_is_entity_selected(id)) { world_selection_remove(id); }
+    }
+}
+
+// ====== ENTITY LISTS ======
+
+BOOL static i_dense_contains(EID const *entities, U32 count, U32 const *index, EID id) {
+    return index[id] < count && entities[index[id]] == id;
+}
+
+void static i_dense_add(EID *entities, U32 *count, U32 *index, EID id) {
+    if (i_dense_contains(entities, *count, index, id)) { return; }
+
+    index[id]        = *count;
+    entities[*count] = id;
+    (*count)++;
+}
+
+void static i_dense_remove(EID *entities, U32 *count, U32 *index, EID id) {
+    if (!i_dense_contains(entities, *count, index, id)) { return; }
+
+    U32 const position = index[id];
+    EID const last     = entities[--(*count)];
+    entities[position] = last;
+    index[last]        = position;
+}
+
+void world_entity_list_add(WorldEntityList *list, EID id) {
+    i_dense_add(list->entities, &list->count, list->index, id);
+}
+
+void world_entity_list_remove(WorldEntityList *list, EID id) {
+    i_dense_remove(list->entities, &list->count, list->index, id);
+}
+
+BOOL world_entity_list_contains(WorldEntityList const *list, EID id) {
+    return id < WORLD_MAX_ENTITIES && i_dense_contains(list->entities, list->count, list->index, id);
+}
+
+void world_register_entity(EID id) {
+    g_world->occluded_bits[id / 64] &= ~(1ULL << (id % 64));  // A recycled id must not inherit last frame's occlusion
+    i_dense_add(g_world->active_entities, &g_world->active_entity_count, g_world->active_index, id);
+    world_entity_list_add(&g_world->type_lists[g_world->type[id]], id);
+    if (ENTITY_HAS_FLAG(g_world->flags[id], ENTITY_FLAG_ACTOR)) { world_entity_list_add(&g_world->actor_list, id); }
+}
+
+void world_unregister_entity(EID id) {
+    i_dense_remove(g_world->active_entities, &g_world->active_entity_count, g_world->active_index, id);
+    world_entity_list_remove(&g_world->type_lists[g_world->type[id]], id);
+    world_entity_list_remove(&g_world->actor_list, id);
+}
+
+void world_set_entity_flag(EID id, EntityFlagBits flag) {
+    ENTITY_SET_FLAG(g_world->flags[id], flag);
+    if (flag == ENTITY_FLAG_ACTOR) { world_entity_list_add(&g_world->actor_list, id); }
+}
+
+void world_clear_entity_flag(EID id, EntityFlagBits flag) {
+    ENTITY_CLEAR_FLAG(g_world->flags[id], flag);
+    if (flag == ENTITY_FLAG_ACTOR) { world_entity_list_remove(&g_world->actor_list, id); }
+}
+
+BOOL world_is_entity_selected(EID id) {
+    if (id >= WORLD_MAX_ENTITIES || !i_selection_bit(id)) { return false; }
+    return g_world->selected_generation[id] == g_world->generation[id] && ENTITY_HAS_FLAG(g_world->flags[id], ENTITY_FLAG_IN_USE);
+}
+
+BOOL world_is_entity_occluded(EID id) {
+    return (g_world->occluded_bits[id / 64] >> (id % 64)) & 1;
 }
 
 void world_vegetation_collision() {
@@ -958,340 +1021,67 @@ void world_set_dungeon(ATerrain *terrain) {
     if (!g_world_state.initialized) { world_init(); }
 }
 
-#define WORLD_RECORDER_FOLDER "state"
-#define WORLD_RECORDER_BASE_FILE_NAME "world"
-#define WORLD_RECORDER_FILE_EXTENSION "ws"
-#define WORLD_RECORDER_MESSAGE_EVERY_N_MSEC 500.0F
-
-// NOTE: We store the world recorder not in the world, but as a global variable to avoid copying it when saving/loading the world state.
-
-WorldRecorder static i_rec = {};
-
-void world_recorder_init() {
-    world_recorder_clear();
-}
-
-void world_recorder_draw_2d_hud() {
-    Vector2 const res    = render_get_render_resolution();
-    Vector2 const center = {res.x / 2.0F, res.y / 4.0F};
-
-    if (i_rec.record_world_state) {
-        F32 const radius = ui_scale_x(0.5F);
-        d2d_circle(center, radius, Fade(RED, 0.75F));
-    } else if (i_rec.keep_looping) {
-        F32 const size = ui_scale_x(1.0F);
-        Vector2 const p1 = {center.x - (size / 3.0F), center.y - (size / 2.0F)};  // Top point
-        Vector2 const p2 = {center.x - (size / 3.0F), center.y + (size / 2.0F)};  // Bottom point
-        Vector2 const p3 = {center.x + (2.0F * size / 3.0F), center.y};           // Right point
-        d2d_triangle(p1, p2, p3, Fade(GREEN, 0.75F));
-    }
-}
-
-void world_recorder_update() {
-    if (i_rec.world_state_go_back) {
-        i_rec.world_state_go_back = false;
-
-        // Return if nothing recorded yet.
-        if (i_rec.record_world_state_cursor == 0) { return; }
-
-        if (i_rec.world_state_cursor > 0) { i_rec.world_state_cursor--; }
-
-        C8 const *file_path = TS("%s/%s_%zu.%s", WORLD_RECORDER_FOLDER, WORLD_RECORDER_BASE_FILE_NAME, i_rec.world_state_cursor, WORLD_RECORDER_FILE_EXTENSION)->c;
-        world_recorder_load_state_to_file(file_path);
-    }
-
-    if (i_rec.world_state_go_forward) {
-        i_rec.world_state_go_forward = false;
-
-        // Return if nothing recorded yet.
-        if (i_rec.record_world_state_cursor == 0) { return; }
-
-        if (i_rec.world_state_cursor != i_rec.record_world_state_cursor - 1) { i_rec.world_state_cursor++; }
-
-        C8 const *file_path = TS("%s/%s_%zu.%s", WORLD_RECORDER_FOLDER, WORLD_RECORDER_BASE_FILE_NAME, i_rec.world_state_cursor, WORLD_RECORDER_FILE_EXTENSION)->c;
-        world_recorder_load_state_to_file(file_path);
-    }
-
-    if (i_rec.keep_looping) {
-        if (i_rec.world_state_cursor == i_rec.record_world_state_cursor - 1) { i_rec.world_state_cursor = 0; }
-
-        C8 const *file_path = TS("%s/%s_%zu.%s", WORLD_RECORDER_FOLDER, WORLD_RECORDER_BASE_FILE_NAME, i_rec.world_state_cursor, WORLD_RECORDER_FILE_EXTENSION)->c;
-        world_recorder_load_state_to_file(file_path);
-
-        i_rec.world_state_cursor++;
-    }
-
-    if (i_rec.record_world_state) {
-        C8 const *file_path = TS("%s/%s_%zu.%s", WORLD_RECORDER_FOLDER, WORLD_RECORDER_BASE_FILE_NAME, i_rec.record_world_state_cursor, WORLD_RECORDER_FILE_EXTENSION)->c;
-        world_recorder_save_state_to_file(file_path);
-
-        i_rec.record_world_state_cursor++;
-    }
-}
-
-void world_recorder_toggle_record_state() {
-    i_rec.record_world_state = !i_rec.record_world_state;
-
-    if (i_rec.keep_looping) { i_rec.keep_looping = false; }
-
-    if (i_rec.record_world_state) {
-        mi(TS("Recording starting from frame: %zu", i_rec.record_world_state_cursor)->c, RED);
-    } else {
-        mi(TS("Recorded %zu frames", i_rec.record_world_state_cursor)->c, GREEN);
-    }
-}
-
-void world_recorder_toggle_loop_state() {
-    // Abort if nothing has been recorded yet.
-    if (i_rec.record_world_state_cursor == 0) {
-        mi("Nothing to loop", RED);
-        return;
-    }
-
-    i_rec.record_world_state = false;
-    i_rec.keep_looping = !i_rec.keep_looping;
-
-    mi(TS("Looping: %s", i_rec.keep_looping ? "ON" : "OFF")->c, i_rec.keep_looping ? GREEN : RED);
-}
-
-void world_recorder_backward_state() {
-    if (i_rec.record_world_state) { world_recorder_toggle_record_state(); }
-
-    i_rec.world_state_go_back = true;
-
-    F32 const message_every_n_msec = WORLD_RECORDER_MESSAGE_EVERY_N_MSEC;
-    F32 static time_passed         = message_every_n_msec;
-
-    time_passed += time_get();
-    if (time_passed > message_every_n_msec) {
-        mi(TS("<< Frame: %zu", i_rec.world_state_cursor)->c, YELLOW);
-        time_passed = 0.0F;
-    }
-}
-
-void world_recorder_forward_state() {
-    if (i_rec.record_world_state) { world_recorder_toggle_record_state(); }
-
-    i_rec.world_state_go_forward = true;
-
-    F32 const message_every_n_msec = WORLD_RECORDER_MESSAGE_EVERY_N_MSEC;
-    F32 static time_passed         = message_every_n_msec;
-
-    time_passed += time_get();
-    if (time_passed > message_every_n_msec) {
-        mi(TS(">> Frame: %zu", i_rec.world_state_cursor)->c, YELLOW);
-        time_passed = 0.0F;
-    }
-}
-
-void world_recorder_clear() {
-    i_rec.record_world_state        = false;
-    i_rec.record_world_state_cursor = 0;
-
-    i_rec.world_state_go_back    = false;
-    i_rec.world_state_go_forward = false;
-    i_rec.world_state_cursor     = 0;
-
-    i_rec.keep_looping = false;
+S32 world_followed_by_count(EID id) {
+    return (S32)g_world->target_trackers[id].count.load(std::memory_order_relaxed);
 }
 
-void world_recorder_delete_recorded_state() {
-    // Before we do anything, we make sure that the WORLD_RECORDER_FOLDER exists.
-    // If it does not, we can safely return and do nothing.
-    if (!DirectoryExists(WORLD_RECORDER_FOLDER "/")) {
-        llw("World state folder does not exist: %s, nothing to delete", WORLD_RECORDER_FOLDER);
-        return;
-    }
-
-    FilePathList const list = LoadDirectoryFiles(WORLD_RECORDER_FOLDER);
+void world_target_tracker_add(EID target_id, EID actor_id) {
+    if (target_id == INVALID_EID || target_id >= WORLD_MAX_ENTITIES) { return; }
 
-    if (list.count == 0) {
-        mi("No world state files to delete", RED);
-        return;
-    }
+    auto *tracker = &g_world->target_trackers[target_id];
+    tracker->count.fetch_add(1, std::memory_order_relaxed);
 
-    SZ deleted_files = 0;
-    for (SZ i = 0; i < list.count; ++i) {
-        C8 const *file_path = list.paths[i];
-        llt("Deleting world state file: %s", file_path);
-        S32 const result = remove(file_path);
-        if (result != 0) {
-            lle("Failed to delete world state file: %s", file_path);
-            continue;
-        }
-        deleted_files++;
-        world_recorder_clear();
+    // Remember the follower if there's space, the slots only ever get claimed and released by their own actor
+    for (auto &slot : tracker->actors) {
+        EID expected = 0;
+        if (slot.compare_exchange_strong(expected, actor_id + 1, std::memory_order_relaxed)) { return; }
     }
-
-    mi(TS("Deleted %zu world state files", deleted_files)->c, RED);
-
-    UnloadDirectoryFiles(list);
-}
-
-BOOL world_recorder_is_recording_state() {
-    return i_rec.record_world_state;
 }
 
-BOOL world_recorder_is_looping_state() {
-    return i_rec.keep_looping;
-}
-
-SZ world_recorder_get_record_cursor() {
-    return i_rec.record_world_state_cursor;
-}
-
-SZ world_recorder_get_playback_cursor() {
-    return i_rec.world_state_cursor;
-}
-
-SZ *world_recorder_get_playback_cursor_ptr() {
-    return &i_rec.world_state_cursor;
-}
-
-void world_recorder_save_state_to_file(C8 const *file_path) {
-    llt("Saving world state to file: %s", file_path);
-
-    if (!DirectoryExists(WORLD_RECORDER_FOLDER "/")) {
-        llt("World state folder does not exist, creating it: %s", WORLD_RECORDER_FOLDER);
-        if (mkdir(WORLD_RECORDER_FOLDER, 0777) != 0) {
-            lle("Failed to create world state folder: %s", WORLD_RECORDER_FOLDER);
-            return;
-        }
-    }
+void world_target_tracker_remove(EID target_id, EID actor_id) {
+    if (target_id == INVALID_EID || target_id >= WORLD_MAX_ENTITIES) { return; }
 
-    FILE *f = fopen(file_path, "wb");
-    if (!f) {
-        lle("Failed to open file for writing: %s", file_path);
-        return;
-    }
+    auto *tracker = &g_world->target_trackers[target_id];
+    tracker->count.fetch_sub(1, std::memory_order_relaxed);
 
-    SZ const num_elements         = 1;
-    SZ const num_elements_written = fwrite(g_world, sizeof(World), num_elements, f);
-    if (num_elements_written != num_elements) {
-        lle("Failed to write world state to file: %s", file_path);
-        // We want to close either way.
+    for (auto &slot : tracker->actors) {
+        EID expected = actor_id + 1;
+        if (slot.compare_exchange_strong(expected, 0, std::memory_order_relaxed)) { return; }
     }
-
-    if (fclose(f) != 0) { lle("Failed to close file: %s, %s", file_path, strerror(errno)); }
 }
 
-void world_recorder_load_state_to_file(C8 const *file_path) {
-    llt("Loading world state from file: %s", file_path);
+BOOL world_target_tracker_validate() {
+    auto *counts = mcta(U16 *, WORLD_MAX_ENTITIES, sizeof(U16));
 
-    FILE *file = fopen(file_path, "rb");
-    if (!file) {
-        lle("Failed to open file for reading: %s", file_path);
-        return;
+    WORLD_LIST_EACH(&g_world->actor_list, id) {
+        EntityBehaviorController const *behavior = &g_world->actor[id].behavior;
+        if (!entity_is_valid(behavior->target_id) || g_world->generation[behavior->target_id] != behavior->target_gen) { continue; }
+        counts[behavior->target_id]++;
     }
 
-    SZ const num_elements = 1;
-    if (fread(g_world, sizeof(World), num_elements, file) != num_elements) {
-        lle("Failed to read world state from file: %s", file_path);
-        // We want to close either way.
-    }
-
-    if (fclose(file) != 0) { lle("Failed to close file: %s, %s", file_path, strerror(errno)); }
-
-    // Recompute bone matrices for all animated entities
-    for (SZ idx = 0; idx < g_world->active_entity_count; ++idx) {
-        EID const id = g_world->active_entities[idx];
-        if (!g_world->animation[id].has_animations) { continue; }
-        if (!g_world->animation[id].anim_playing)   { continue; }
-        math_compute_entity_bone_matrices(id);
-    }
-}
-
-SZ world_recorder_get_state_size_bytes() {
-    return sizeof(World);
-}
-
-SZ world_recorder_get_total_recorded_size_bytes() {
-    return sizeof(World) * i_rec.record_world_state_cursor;
-}
-
-SZ world_recorder_get_actual_disk_usage_bytes() {
-    if (!DirectoryExists(WORLD_RECORDER_FOLDER "/")) { return 0; }
-
-    FilePathList const list = LoadDirectoryFiles(WORLD_RECORDER_FOLDER);
-    SZ total_size           = 0;
+    BOOL valid = true;
+    for (EID i = 0; i < WORLD_MAX_ENTITIES; ++i) {
+        auto const *tracker = &g_world->target_trackers[i];
 
-    for (SZ i = 0; i < list.count; ++i) {
-        C8 const *file_path = list.paths[i];
-        // Only count .ws files to avoid counting other files in the directory
-        if (ou_strstr(file_path, "." WORLD_RECORDER_FILE_EXTENSION) != nullptr) {
-            struct stat st;
-            if (stat(file_path, &st) == 0) { total_size += (SZ)st.st_size; }
+        U16 const count = tracker->count.load(std::memory_order_relaxed);
+        if (count != counts[i]) {
+            lle("Target %04u is followed by %u actors but tracked with %u", i, counts[i], count);
+            valid = false;
         }
-    }
-
-    UnloadDirectoryFiles(list);
-    return total_size;
-}
-
-void world_update_follower_cache() {
-    if (!g_world->follower_cache.dirty) { return; }
 
-    for (U8 &count : g_world->follower_cache.follower_counts) { count = 0; }
+        for (auto const &slot : tracker->actors) {
+            EID const follower = slot.load(std::memory_order_relaxed);
+            if (follower == 0) { continue; }
 
-    for (SZ cell_idx = 0; cell_idx < (SZ)GRID_TOTAL_CELLS; ++cell_idx) {
-        GridCell *cell = grid_get_cell_by_index(cell_idx);
-        if (!cell) { continue; }
-
-        SZ const count = cell->count_per_type[ENTITY_TYPE_NPC];
-        for (SZ i = 0; i < count; ++i) {
-            EID const entity_id = cell->entities_by_type[ENTITY_TYPE_NPC][i];
-            if (!ENTITY_HAS_FLAG(g_world->flags[entity_id], ENTITY_FLAG_IN_USE)) { continue; }
-
-            EntityBehaviorController const *behavior = &g_world->actor[entity_id].behavior;
-            if (behavior->target_id != INVALID_EID && g_world->generation[behavior->target_id] == behavior->target_gen) {
-                g_world->follower_cache.follower_counts[behavior->target_id]++;
+            EntityBehaviorController const *behavior = &g_world->actor[follower - 1].behavior;
+            if (behavior->target_id != i) {
+                lle("Target %04u lists %04u as follower but it follows %04u", i, follower - 1, behavior->target_id);
+                valid = false;
             }
         }
     }
 
-    g_world->follower_cache.dirty = false;
-}
-
-S32 world_followed_by_count(EID id) {
-    world_update_follower_cache();
-    return (S32)g_world->follower_cache.follower_counts[id];
-}
-
-void world_mark_follower_cache_dirty() {
-    g_world->follower_cache.dirty = true;
-}
-
-void world_target_tracker_add(EID target_id, EID actor_id) {
-    if (target_id == INVALID_EID || target_id >= WORLD_MAX_ENTITIES) { return; }
-
-    auto *tracker = &g_world->target_trackers[target_id];
-
-    // Check if already tracking
-    for (U8 i = 0; i < tracker->count; i++) {
-        if (tracker->actors[i] == actor_id) { return; }
-    }
-
-    // Add if there's space
-    if (tracker->count < MAX_ACTORS_PER_TARGET) {
-        tracker->actors[tracker->count] = actor_id;
-        tracker->count++;
-    }
-}
-
-void world_target_tracker_remove(EID target_id, EID actor_id) {
-    if (target_id == INVALID_EID || target_id >= WORLD_MAX_ENTITIES) { return; }
-
-    auto *tracker = &g_world->target_trackers[target_id];
-
-    // Find and remove
-    for (U8 i = 0; i < tracker->count; i++) {
-        if (tracker->actors[i] == actor_id) {
-            // Move last element to this position
-            tracker->count--;
-            tracker->actors[i] = tracker->actors[tracker->count];
-            return;
-        }
-    }
+    return valid;
 }
 
 void world_notify_actors_target_destroyed(EID destroyed_target_id) {
@@ -1300,8 +1090,11 @@ void world_notify_actors_target_destroyed(EID destroyed_target_id) {
     String const *reason = TS("%04d destroyed by others", destroyed_target_id);
     auto *tracker        = &g_world->target_trackers[destroyed_target_id];
 
-    for (U8 i = 0; i < tracker->count; i++) {
-        EID const actor_id = tracker->actors[i];
+    // Clearing the target releases the slot, followers beyond the list stay counted until the target is gone
+    for (auto &slot : tracker->actors) {
+        EID const follower = slot.load(std::memory_order_relaxed);
+        if (follower == 0) { continue; }
+        EID const actor_id = follower - 1;
 
         if (!ENTITY_HAS_FLAG(g_world->flags[actor_id], ENTITY_FLAG_IN_USE)) { continue; }
         if (g_world->type[actor_id] != ENTITY_TYPE_NPC)                     { continue; }
@@ -1312,7 +1105,7 @@ void world_notify_actors_target_destroyed(EID destroyed_target_id) {
         switch (actor->behavior.state) {
             case ENTITY_BEHAVIOR_STATE_GOING_TO_TARGET:
             case ENTITY_BEHAVIOR_STATE_HARVESTING_TARGET: {
-                entity_actor_search_and_transition_to_target(actor_id, reason->c);
+                entity_actor_request_target(actor_id, reason->c);
             } break;
 
             case ENTITY_BEHAVIOR_STATE_DELIVERING_TO_LUMBERYARD:
@@ -1325,7 +1118,4 @@ void world_notify_actors_target_destroyed(EID destroyed_target_id) {
             }
         }
     }
-
-    // Clear the tracker
-    tracker->count = 0;
 }
@@ -7,10 +7,13 @@
 #include "entity_building.hpp"
 #include "grid.hpp"
 #include "math.hpp"
+#include "nav.hpp"
 #include "player.hpp"
 #include "talk.hpp"
 
+#include <atomic>
 #include <raylib.h>
+#include <stdio.h>
 #include <tinycthread.h>
 
 // Need for tinycthread on macOS
@@ -20,23 +23,48 @@
 
 #define WORLD_MAX_ENTITIES 25000
 #define WORLD_MAX_DEFERRED_DESTRUCTIONS 1024
+#define WORLD_ENTITY_WORD_COUNT ((WORLD_MAX_ENTITIES + 63) / 64)
+#define WORLD_DRAW_MIN_INSTANCE_COUNT 2  // Fewer entities of a model than this are drawn one by one
+
+// Iterate a dense entity list, e.g. WORLD_LIST_EACH(&g_world->type_lists[ENTITY_TYPE_NPC], id) { ... }
+// NOTE: Destroying entities while iterating forwards skips entries, iterate backwards with count and entities for that.
+#define WORLD_LIST_EACH(list, id) for (U32 id##_idx = 0, id = 0; id##_idx < (list)->count && ((id = (list)->entities[id##_idx]), true); ++id##_idx)
 
 fwd_decl(ATerrain);
 fwd_decl(ASound);
 fwd_decl(AModel);
 
+// Packed entity ids with O(1) add and swap-remove through a back-index, order is not stable
+struct WorldEntityList {
+    EID entities[WORLD_MAX_ENTITIES];
+    U32 count;
+    U32 index[WORLD_MAX_ENTITIES];  // Position of an entity in entities, only meaningful while it is in the list
+};
+
 struct World {
     ATerrain *base_terrain;
     U32 entity_type_counts[ENTITY_TYPE_COUNT];
     U32 max_gen;
 
-    // Multi-selection support
+    // Multi-selection support. selected_entities is the dense list for iteration (primary first), the bitset and
+    // back-index make add/remove/test O(1). Use the world_selection_* functions, never write these directly.
     EID selected_entities[WORLD_MAX_ENTITIES];
     SZ selected_entity_count;
+    U64 selected_bits[WORLD_ENTITY_WORD_COUNT];
+    U32 selected_index[WORLD_MAX_ENTITIES];       // Position in selected_entities, only valid while the bit is set
+    U32 selected_generation[WORLD_MAX_ENTITIES];  // generation[id] at the time of selection, a mismatch means the entity died
 
-    // Active entity optimization: array of active entity IDs for fast iteration
+    // Entities in the frustum that are hidden behind dungeon walls, computed once per frame by dungeon_update_visibility
+    U64 occluded_bits[WORLD_ENTITY_WORD_COUNT];
+
+    // Active entity optimization: array of active entity IDs for fast iteration, kept up to date by entity_create and
+    // entity_destroy through world_register_entity/world_unregister_entity
     EID active_entities[WORLD_MAX_ENTITIES];
     U32 active_entity_count;
+    U32 active_index[WORLD_MAX_ENTITIES];  // Position in active_entities
+
+    WorldEntityList type_lists[ENTITY_TYPE_COUNT];
+    WorldEntityList actor_list;  // ENTITY_FLAG_ACTOR, the only flag the update loops iterate. Others just get tested.
 
     alignas(32) U32 flags[WORLD_MAX_ENTITIES];
     alignas(32) U32 generation[WORLD_MAX_ENTITIES];
@@ -60,14 +88,11 @@ struct World {
     alignas(32) EntityTalker talker[WORLD_MAX_ENTITIES];
     alignas(32) EntityBuilding building[WORLD_MAX_ENTITIES];
 
+    // Who follows whom, updated whenever an actor sets or clears its target and when either of them gets destroyed.
+    // The count is exact, the list only holds the first MAX_ACTORS_PER_TARGET followers.
     struct {
-        U8 follower_counts[WORLD_MAX_ENTITIES];
-        BOOL dirty;
-    } follower_cache;
-
-    struct {
-        EID actors[MAX_ACTORS_PER_TARGET];
-        U8 count;
+        std::atomic<EID> actors[MAX_ACTORS_PER_TARGET];  // Follower + 1, 0 is a free slot
+        std::atomic<U16> count;
     } target_trackers[WORLD_MAX_ENTITIES];
 
     // Multithreading synchronization for actor updates
@@ -80,9 +105,34 @@ struct World {
         // Mutex for building modifications (e.g., lumberyard wood count)
         mtx_t building_mutex;
 
-        // Mutex for entity scale modifications during harvesting
+        // Mutex for health modifications from entity_damage()
         mtx_t entity_mutation_mutex;
     } mt_sync;
+
+    // Behind mt_sync so the recorder leaves it alone, actors restored by a seek just find their handles stale
+    Nav nav;
+};
+
+// One model's worth of entities in the 3D sketch pass, built on the CPU before anything gets submitted.
+// Groups below WORLD_DRAW_MIN_INSTANCE_COUNT are drawn per entity straight from entities, the rest gets instanced.
+// Animated entities are grouped by model only, every instance brings its own bones through the bone palette.
+struct WorldDrawGroup {
+    U32 model_hash;
+    BOOL animated;
+    BOOL instanced;
+    EIDArray entities;
+    MatrixArray transforms[2];    // Indexed by selection state, only filled for instanced groups
+    ColorArray tints[2];
+    U32Array palette_offsets[2];  // Animated instanced groups only, where each instance's bones start in bone_palette
+};
+
+ARRAY_DECLARE(WorldDrawGroupArray, WorldDrawGroup);
+
+struct WorldDrawList {
+    WorldDrawGroupArray groups;  // Animated groups first, then static ones
+    MatrixArray bone_palette;    // Bone matrices of every animated instance back to back, uploaded once per frame
+    MatrixArray backpack_transforms;
+    ColorArray backpack_tints;
 };
 
 struct WorldState {
@@ -104,9 +154,23 @@ void world_draw_2d_hud();
 void world_draw_2d_dbg();
 void world_draw_3d();
 void world_draw_3d_sketch();
+void world_draw_3d_sketch_prepare(WorldDrawList *list);  // CPU side of world_draw_3d_sketch, everything is transient
+SZ world_draw_list_get_draw_call_count(WorldDrawList const *list);
 void world_draw_3d_hud();
 void world_draw_3d_dbg();
 void world_set_selected_entity(EID id);
+void world_selection_clear();
+void world_selection_add(EID id);
+void world_selection_remove(EID id);  // Swap-remove, the primary only changes if it is the one removed
+void world_selection_toggle(EID id);
+void world_selection_validate();      // Drops entries whose entity got destroyed or recycled since they were selected
+void world_register_entity(EID id);    // Adds a freshly created entity to the active, type and actor lists
+void world_unregister_entity(EID id);  // Takes an entity out of every list, call before its type and flags are cleared
+void world_set_entity_flag(EID id, EntityFlagBits flag);
+void world_clear_entity_flag(EID id, EntityFlagBits flag);
+void world_entity_list_add(WorldEntityList *list, EID id);
+void world_entity_list_remove(WorldEntityList *list, EID id);
+BOOL world_entity_list_contains(WorldEntityList const *list, EID id);
 void world_vegetation_collision();
 F32 world_get_distance_to_player(Vector3 position);
 void world_randomly_rotate_entities();
@@ -115,6 +179,14 @@ void world_dump_all_entities_cb(void *data);
 void world_set_overworld(ATerrain *terrain);
 void world_set_dungeon(ATerrain *terrain);
 
+// One entry per recorded frame, points into the single recording file
+struct WorldRecorderFrame {
+    SZ file_offset;
+    U32 compressed_size;
+    U32 raw_size;
+    BOOL keyframe;
+};
+
 struct WorldRecorder {
     BOOL record_world_state;
     SZ record_world_state_cursor;
@@ -122,9 +194,40 @@ struct WorldRecorder {
     BOOL world_state_go_forward;
     SZ world_state_cursor;
     BOOL keep_looping;
+
+    // The shadow holds the last recorded frame while recording and the last loaded frame during playback
+    World *shadow;
+    SZ shadow_frame;  // WORLD_RECORDER_FRAME_NONE if the shadow matches no recorded frame
+    BOOL force_keyframe;
+    U32 frames_since_keyframe;
+    U8 *dirty_blocks;
+    U32 *dirty_block_ids;
+
+    // Raw frames waiting for the writer thread, head is only moved by the main thread and tail only by the writer
+    U8 *ring;
+    std::atomic<SZ> ring_head;
+    std::atomic<SZ> ring_tail;
+
+    // Writer thread, it compresses the frames and appends them to the file
+    thrd_t writer_thread;
+    mtx_t mutex;
+    cnd_t work_cond;
+    cnd_t drained_cond;
+    std::atomic<BOOL> stop_writer;
+    FILE *file;
+    SZ file_size;
+    WorldRecorderFrame *frames;
+    std::atomic<SZ> written_frame_count;
+
+    // Stats
+    SZ last_raw_size;
+    std::atomic<SZ> total_compressed_size;
+    F64 total_record_time;
+    SZ timed_frame_count;
 };
 
 void world_recorder_init();
+void world_recorder_quit();
 void world_recorder_draw_2d_hud();
 void world_recorder_update();
 void world_recorder_toggle_record_state();
@@ -138,16 +241,18 @@ BOOL world_recorder_is_looping_state();
 SZ world_recorder_get_record_cursor();
 SZ world_recorder_get_playback_cursor();
 SZ *world_recorder_get_playback_cursor_ptr();
-void world_recorder_save_state_to_file(C8 const *file_path);
-void world_recorder_load_state_to_file(C8 const *file_path);
-SZ world_recorder_get_state_size_bytes();
+void world_recorder_seek(SZ frame);
+SZ world_recorder_get_last_frame_raw_bytes();
+SZ world_recorder_get_bytes_per_frame();
+F64 world_recorder_get_time_per_frame();
+SZ world_recorder_get_pending_bytes();
 SZ world_recorder_get_total_recorded_size_bytes();
 SZ world_recorder_get_actual_disk_usage_bytes();
 
-void world_update_follower_cache();
 S32 world_followed_by_count(EID id);
-void world_mark_follower_cache_dirty();
-void world_target_tracker_add(EID target_id, EID actor_id);
-void world_target_tracker_remove(EID target_id, EID actor_id);
+void world_target_tracker_add(EID target_id, EID actor_id);     // Only for a valid target
+void world_target_tracker_remove(EID target_id, EID actor_id);  // Only while the target is still the one that got added
+BOOL world_target_tracker_validate();  // Debug, recounts all followers from the actors and compares
 void world_notify_actors_target_destroyed(EID destroyed_target_id);
 BOOL world_is_entity_selected(EID id);
+BOOL world_is_entity_occluded(EID id);
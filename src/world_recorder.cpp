@@ -0,0 +1,673 @@
+#include "job.hpp"
+#include "log.hpp"
+#include "math.hpp"
+#include "memory.hpp"
+#include "message.hpp"
+#include "render.hpp"
+#include "std.hpp"
+#include "string.hpp"
+#include "time.hpp"
+#include "world.hpp"
+
+#include <errno.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define WORLD_RECORDER_FOLDER "state"
+#define WORLD_RECORDER_FILE_NAME "world"
+#define WORLD_RECORDER_FILE_EXTENSION "wrec"
+#define WORLD_RECORDER_FILE_PATH WORLD_RECORDER_FOLDER "/" WORLD_RECORDER_FILE_NAME "." WORLD_RECORDER_FILE_EXTENSION
+#define WORLD_RECORDER_FILE_MAGIC 0x43455257  // "WREC"
+#define WORLD_RECORDER_FILE_VERSION 1
+#define WORLD_RECORDER_MESSAGE_EVERY_N_MSEC 500.0F
+
+#define WORLD_RECORDER_BLOCK_SIZE 4096
+#define WORLD_RECORDER_KEYFRAME_INTERVAL 300
+#define WORLD_RECORDER_RING_SIZE (64 * 1024 * 1024)  // Has to fit a few keyframes
+#define WORLD_RECORDER_MAX_FRAMES 65536
+#define WORLD_RECORDER_FRAME_NONE SZ_MAX
+
+// Everything before the mutexes gets recorded, the deferred destruction queue is empty between frames anyway
+#define WORLD_RECORDER_RECORDED_SIZE offsetof(World, mt_sync)
+#define WORLD_RECORDER_BLOCK_COUNT ((WORLD_RECORDER_RECORDED_SIZE + WORLD_RECORDER_BLOCK_SIZE - 1) / WORLD_RECORDER_BLOCK_SIZE)
+
+// A frame is the header, the ids of the blocks that changed and then the blocks.
+// Keyframes store every block as is, all other frames store the changed blocks XORed with the previous frame.
+// Applying a delta frame again undoes it, so stepping backwards is as cheap as stepping forwards.
+struct WorldRecorderFrameHeader {
+    U32 frame;
+    U32 block_count;
+    BOOL keyframe;
+};
+
+// A keyframe is the biggest a frame gets: the size prefix, the header and ids padded to 8 bytes and then every block.
+// If it did not fit the ring i_ring_reserve() would wait forever for space the writer can never free.
+#define WORLD_RECORDER_KEYFRAME_SIZE                                                                                            \
+    (sizeof(SZ) + sizeof(WorldRecorderFrameHeader) + (WORLD_RECORDER_BLOCK_COUNT * (sizeof(U32) + WORLD_RECORDER_BLOCK_SIZE)) + 16)
+static_assert(WORLD_RECORDER_KEYFRAME_SIZE <= WORLD_RECORDER_RING_SIZE, "World grew too big for the recorder ring, raise WORLD_RECORDER_RING_SIZE");
+
+struct WorldRecorderFileHeader {
+    U32 magic;
+    U32 version;
+    U32 block_size;
+    U32 recorded_size;
+    U64 frame_count;
+    U64 index_offset;  // The WorldRecorderFrame index sits at the end of the file, 0 while it was not written yet
+};
+
+// NOTE: We store the world recorder not in the world, but as a global variable to avoid copying it when saving/loading the world state.
+
+WorldRecorder static i_rec = {};
+
+SZ static inline i_align_8(SZ size) {
+    return (size + 7) & ~(SZ)7;
+}
+
+SZ static inline i_block_length(SZ block) {
+    SZ const offset = block * WORLD_RECORDER_BLOCK_SIZE;
+    return glm::min((SZ)WORLD_RECORDER_BLOCK_SIZE, WORLD_RECORDER_RECORDED_SIZE - offset);
+}
+
+SZ static inline i_frame_data_offset(SZ block_count) {
+    return i_align_8(sizeof(WorldRecorderFrameHeader) + (block_count * sizeof(U32)));
+}
+
+void static i_xor_block(U8 *dst, U8 const *a, U8 const *b, SZ length) {
+    SZ const words = length / sizeof(U64);
+    auto *dst_words   = (U64 *)dst;
+    auto const *a_words = (U64 const *)a;
+    auto const *b_words = (U64 const *)b;
+    for (SZ i = 0; i < words; ++i) { dst_words[i] = a_words[i] ^ b_words[i]; }
+    for (SZ i = words * sizeof(U64); i < length; ++i) { dst[i] = a[i] ^ b[i]; }
+}
+
+// ====== WRITER ======
+
+void static i_write_next_frame() {
+    SZ const tail   = i_rec.ring_tail.load(std::memory_order_relaxed);
+    SZ const offset = tail % WORLD_RECORDER_RING_SIZE;
+    SZ const size   = *(SZ *)(i_rec.ring + offset);
+
+    // Padding up to the end of the ring, the next frame starts at the beginning
+    if (size == 0) {
+        i_rec.ring_tail.store(tail + WORLD_RECORDER_RING_SIZE - offset, std::memory_order_release);
+        return;
+    }
+
+    U8 const *raw   = i_rec.ring + offset + sizeof(SZ);
+    auto const *hdr = (WorldRecorderFrameHeader const *)raw;
+
+    S32 compressed_size = 0;
+    U8 *compressed      = CompressData(raw, (S32)size, &compressed_size);
+    if (!compressed) {
+        lle("Failed to compress recorded world frame %u", hdr->frame);
+    } else {
+        if (fseek(i_rec.file, (long)i_rec.file_size, SEEK_SET) != 0 || fwrite(compressed, (SZ)compressed_size, 1, i_rec.file) != 1) {
+            lle("Failed to write recorded world frame %u: %s", hdr->frame, strerror(errno));
+        } else {
+            WorldRecorderFrame *entry = &i_rec.frames[hdr->frame];
+            entry->file_offset        = i_rec.file_size;
+            entry->compressed_size    = (U32)compressed_size;
+            entry->raw_size           = (U32)size;
+            entry->keyframe           = hdr->keyframe;
+
+            i_rec.file_size += (SZ)compressed_size;
+            i_rec.total_compressed_size.fetch_add((SZ)compressed_size, std::memory_order_relaxed);
+            i_rec.written_frame_count.store(hdr->frame + 1, std::memory_order_relaxed);
+        }
+        MemFree(compressed);
+    }
+
+    i_rec.ring_tail.store(tail + i_align_8(sizeof(SZ) + size), std::memory_order_release);
+}
+
+S32 static i_writer_thread(void *data) {
+    unused(data);
+
+    for (;;) {
+        mtx_lock(&i_rec.mutex);
+        while (!i_rec.stop_writer && i_rec.ring_tail.load(std::memory_order_relaxed) == i_rec.ring_head.load(std::memory_order_acquire)) {
+            cnd_wait(&i_rec.work_cond, &i_rec.mutex);
+        }
+        BOOL const stop = i_rec.stop_writer && i_rec.ring_tail.load(std::memory_order_relaxed) == i_rec.ring_head.load(std::memory_order_acquire);
+        mtx_unlock(&i_rec.mutex);
+
+        if (stop) { break; }
+
+        i_write_next_frame();
+
+        mtx_lock(&i_rec.mutex);
+        cnd_broadcast(&i_rec.drained_cond);
+        mtx_unlock(&i_rec.mutex);
+    }
+
+    return 0;
+}
+
+// Blocks until the writer wrote everything that was recorded so far
+void static i_flush() {
+    mtx_lock(&i_rec.mutex);
+    while (i_rec.ring_tail.load(std::memory_order_acquire) != i_rec.ring_head.load(std::memory_order_relaxed)) { cnd_wait(&i_rec.drained_cond, &i_rec.mutex); }
+    mtx_unlock(&i_rec.mutex);
+}
+
+BOOL static i_open_file() {
+    if (i_rec.file) { return true; }
+
+    if (!DirectoryExists(WORLD_RECORDER_FOLDER "/")) {
+        llt("World state folder does not exist, creating it: %s", WORLD_RECORDER_FOLDER);
+        if (mkdir(WORLD_RECORDER_FOLDER, 0777) != 0) {
+            lle("Failed to create world state folder: %s", WORLD_RECORDER_FOLDER);
+            return false;
+        }
+    }
+
+    i_rec.file = fopen(WORLD_RECORDER_FILE_PATH, "w+b");
+    if (!i_rec.file) {
+        lle("Failed to open file for writing: %s, %s", WORLD_RECORDER_FILE_PATH, strerror(errno));
+        return false;
+    }
+
+    WorldRecorderFileHeader const header = {WORLD_RECORDER_FILE_MAGIC, WORLD_RECORDER_FILE_VERSION, WORLD_RECORDER_BLOCK_SIZE, (U32)WORLD_RECORDER_RECORDED_SIZE, 0, 0};
+    if (fwrite(&header, sizeof(header), 1, i_rec.file) != 1) { lle("Failed to write world state header to file: %s", WORLD_RECORDER_FILE_PATH); }
+    i_rec.file_size = sizeof(header);
+
+    return true;
+}
+
+// Appends the frame index and points the header at it, frames recorded later overwrite the index and write it again
+void static i_write_index() {
+    if (!i_rec.file) { return; }
+
+    i_flush();
+
+    SZ const frame_count = i_rec.written_frame_count.load(std::memory_order_relaxed);
+    WorldRecorderFileHeader const header = {WORLD_RECORDER_FILE_MAGIC, WORLD_RECORDER_FILE_VERSION, WORLD_RECORDER_BLOCK_SIZE, (U32)WORLD_RECORDER_RECORDED_SIZE,
+                                            frame_count, i_rec.file_size};
+
+    BOOL ok = fseek(i_rec.file, (long)i_rec.file_size, SEEK_SET) == 0;
+    ok      = ok && (frame_count == 0 || fwrite(i_rec.frames, sizeof(WorldRecorderFrame) * frame_count, 1, i_rec.file) == 1);
+    ok      = ok && fseek(i_rec.file, 0, SEEK_SET) == 0;
+    ok      = ok && fwrite(&header, sizeof(header), 1, i_rec.file) == 1;
+    ok      = ok && fflush(i_rec.file) == 0;
+    if (!ok) { lle("Failed to write world state index to file: %s, %s", WORLD_RECORDER_FILE_PATH, strerror(errno)); }
+}
+
+void static i_close_file() {
+    if (!i_rec.file) { return; }
+
+    i_flush();
+    if (fclose(i_rec.file) != 0) { lle("Failed to close file: %s, %s", WORLD_RECORDER_FILE_PATH, strerror(errno)); }
+    i_rec.file      = nullptr;
+    i_rec.file_size = 0;
+}
+
+// ====== RECORDING ======
+
+// Reserves size bytes in the ring, waits for the writer if it is too far behind.
+// Returns where the frame goes, the caller publishes it with the new head.
+U8 static *i_ring_reserve(SZ size, SZ *new_head) {
+    SZ head         = i_rec.ring_head.load(std::memory_order_relaxed);
+    SZ const offset = head % WORLD_RECORDER_RING_SIZE;
+    SZ const pad    = offset + size > WORLD_RECORDER_RING_SIZE ? WORLD_RECORDER_RING_SIZE - offset : 0;
+
+    mtx_lock(&i_rec.mutex);
+    while (head + pad + size - i_rec.ring_tail.load(std::memory_order_acquire) > WORLD_RECORDER_RING_SIZE) { cnd_wait(&i_rec.drained_cond, &i_rec.mutex); }
+    mtx_unlock(&i_rec.mutex);
+
+    if (pad > 0) {
+        *(SZ *)(i_rec.ring + offset) = 0;
+        head += pad;
+    }
+
+    *new_head = head + size;
+    return i_rec.ring + (head % WORLD_RECORDER_RING_SIZE);
+}
+
+void static i_ring_publish(SZ new_head) {
+    mtx_lock(&i_rec.mutex);
+    i_rec.ring_head.store(new_head, std::memory_order_release);
+    cnd_signal(&i_rec.work_cond);
+    mtx_unlock(&i_rec.mutex);
+}
+
+S32 static i_find_dirty_blocks(U32 begin, U32 end, void *ctx) {
+    unused(ctx);
+
+    auto const *current = (U8 const *)g_world;
+    auto const *shadow  = (U8 const *)i_rec.shadow;
+    for (U32 block = begin; block < end; ++block) {
+        SZ const offset           = (SZ)block * WORLD_RECORDER_BLOCK_SIZE;
+        i_rec.dirty_blocks[block] = ou_memcmp(current + offset, shadow + offset, i_block_length(block)) != 0;
+    }
+
+    return 0;
+}
+
+struct WorldRecorderPackContext {
+    U8 *data;
+    BOOL keyframe;
+};
+
+S32 static i_pack_blocks(U32 begin, U32 end, void *ctx) {
+    auto const *pack = (WorldRecorderPackContext *)ctx;
+
+    for (U32 i = begin; i < end; ++i) {
+        SZ const block  = i_rec.dirty_block_ids[i];
+        SZ const offset = block * WORLD_RECORDER_BLOCK_SIZE;
+        SZ const length = i_block_length(block);
+        U8 const *src   = (U8 const *)g_world + offset;
+        U8 *shadow      = (U8 *)i_rec.shadow + offset;
+        U8 *dst         = pack->data + ((SZ)i * WORLD_RECORDER_BLOCK_SIZE);
+
+        if (pack->keyframe) {
+            ou_memcpy(dst, src, length);
+        } else {
+            i_xor_block(dst, src, shadow, length);
+        }
+        if (length < WORLD_RECORDER_BLOCK_SIZE) { ou_memset(dst + length, 0, WORLD_RECORDER_BLOCK_SIZE - length); }
+
+        ou_memcpy(shadow, src, length);
+    }
+
+    return 0;
+}
+
+void static i_record_frame() {
+    F64 const start_time = time_get_glfw_f64();
+    SZ const frame       = i_rec.record_world_state_cursor;
+
+    if (frame >= WORLD_RECORDER_MAX_FRAMES) {
+        mi(TS("Recorder is full (%d frames)", WORLD_RECORDER_MAX_FRAMES)->c, RED);
+        world_recorder_toggle_record_state();
+        return;
+    }
+    if (!i_open_file()) {
+        world_recorder_toggle_record_state();
+        return;
+    }
+
+    BOOL const keyframe = i_rec.force_keyframe || i_rec.frames_since_keyframe >= WORLD_RECORDER_KEYFRAME_INTERVAL;
+
+    if (keyframe) {
+        ou_memset(i_rec.dirty_blocks, 1, WORLD_RECORDER_BLOCK_COUNT);
+    } else {
+        job_wait(job_parallel_for(0, WORLD_RECORDER_BLOCK_COUNT, 64, i_find_dirty_blocks, nullptr));
+    }
+
+    U32 block_count = 0;
+    for (U32 block = 0; block < WORLD_RECORDER_BLOCK_COUNT; ++block) {
+        if (i_rec.dirty_blocks[block]) { i_rec.dirty_block_ids[block_count++] = block; }
+    }
+
+    SZ const data_offset = i_frame_data_offset(block_count);
+    SZ const raw_size    = data_offset + ((SZ)block_count * WORLD_RECORDER_BLOCK_SIZE);
+    SZ new_head          = 0;
+    U8 *dst              = i_ring_reserve(i_align_8(sizeof(SZ) + raw_size), &new_head);
+
+    *(SZ *)dst = raw_size;
+    U8 *raw    = dst + sizeof(SZ);
+
+    auto *header        = (WorldRecorderFrameHeader *)raw;
+    header->frame       = (U32)frame;
+    header->block_count = block_count;
+    header->keyframe    = keyframe;
+    ou_memcpy(raw + sizeof(WorldRecorderFrameHeader), i_rec.dirty_block_ids, block_count * sizeof(U32));
+
+    WorldRecorderPackContext pack = {raw + data_offset, keyframe};
+    job_wait(job_parallel_for(0, block_count, 16, i_pack_blocks, &pack));
+
+    i_ring_publish(new_head);
+
+    i_rec.force_keyframe        = false;
+    i_rec.frames_since_keyframe = keyframe ? 1 : i_rec.frames_since_keyframe + 1;
+    i_rec.shadow_frame          = frame;
+    i_rec.last_raw_size         = raw_size;
+    i_rec.record_world_state_cursor++;
+
+    i_rec.total_record_time += time_get_glfw_f64() - start_time;
+    i_rec.timed_frame_count++;
+}
+
+// ====== PLAYBACK ======
+
+// Applies a recorded frame to the shadow, keyframes overwrite it and delta frames toggle the changed bytes.
+BOOL static i_apply_frame(SZ frame) {
+    WorldRecorderFrame const *entry = &i_rec.frames[frame];
+    if (entry->compressed_size == 0) {
+        lle("Recorded world frame %zu is missing", frame);
+        return false;
+    }
+
+    auto *compressed = mmta(U8 *, entry->compressed_size);
+    BOOL const read  = fseek(i_rec.file, (long)entry->file_offset, SEEK_SET) == 0 && fread(compressed, entry->compressed_size, 1, i_rec.file) == 1;
+    if (!read) {
+        lle("Failed to read recorded world frame %zu from file: %s", frame, WORLD_RECORDER_FILE_PATH);
+        return false;
+    }
+
+    S32 raw_size = 0;
+    U8 *raw      = DecompressData(compressed, (S32)entry->compressed_size, &raw_size);
+    if (!raw || (U32)raw_size != entry->raw_size) {
+        lle("Failed to decompress recorded world frame %zu", frame);
+        if (raw) { MemFree(raw); }
+        return false;
+    }
+
+    auto const *header   = (WorldRecorderFrameHeader const *)raw;
+    auto const *ids      = (U32 const *)(raw + sizeof(WorldRecorderFrameHeader));
+    U8 const *data       = raw + i_frame_data_offset(header->block_count);
+    auto *shadow         = (U8 *)i_rec.shadow;
+
+    for (U32 i = 0; i < header->block_count; ++i) {
+        SZ const offset  = (SZ)ids[i] * WORLD_RECORDER_BLOCK_SIZE;
+        SZ const length  = i_block_length(ids[i]);
+        U8 const *block  = data + ((SZ)i * WORLD_RECORDER_BLOCK_SIZE);
+        if (header->keyframe) {
+            ou_memcpy(shadow + offset, block, length);
+        } else {
+            i_xor_block(shadow + offset, shadow + offset, block, length);
+        }
+    }
+
+    MemFree(raw);
+    return true;
+}
+
+void world_recorder_seek(SZ frame) {
+    if (i_rec.record_world_state) { return; }
+
+    i_flush();
+
+    SZ const frame_count = i_rec.written_frame_count.load(std::memory_order_relaxed);
+    if (frame >= frame_count || !i_rec.file) { return; }
+
+    SZ const current = i_rec.shadow_frame;
+    BOOL ok          = true;
+
+    if (current == frame) {
+        // Nothing to apply, the shadow already is that frame
+    } else if (current != WORLD_RECORDER_FRAME_NONE && frame == current + 1 && !i_rec.frames[frame].keyframe) {
+        ok = i_apply_frame(frame);
+    } else if (current != WORLD_RECORDER_FRAME_NONE && frame + 1 == current && !i_rec.frames[current].keyframe) {
+        ok = i_apply_frame(current);
+    } else {
+        SZ keyframe = frame;
+        while (keyframe > 0 && !i_rec.frames[keyframe].keyframe) { keyframe--; }
+        for (SZ f = keyframe; f <= frame && ok; ++f) { ok = i_apply_frame(f); }
+    }
+
+    if (!ok) {
+        i_rec.shadow_frame = WORLD_RECORDER_FRAME_NONE;
+        return;
+    }
+
+    i_rec.shadow_frame = frame;
+    ou_memcpy(g_world, i_rec.shadow, WORLD_RECORDER_RECORDED_SIZE);
+
+    // Every entity might have moved, been created or destroyed, so the grid links get rebuilt on the next populate
+    grid_clear();
+
+    // The nav is not recorded but the path handles of the actors are. The restored handles belong to the recorded frame,
+    // so the nav starts over and the actors ask again. Otherwise every seek leaks whatever the actors were holding.
+    entity_actor_reset_paths();
+
+    // Recompute bone matrices for all animated entities
+    MathBoneBlendBatch blend_batch = {};
+    for (SZ idx = 0; idx < g_world->active_entity_count; ++idx) {
+        EID const id = g_world->active_entities[idx];
+        if (!g_world->animation[id].has_animations) { continue; }
+        if (!g_world->animation[id].anim_playing)   { continue; }
+        math_compute_entity_bone_matrices(id, &blend_batch);
+    }
+    math_bone_blend_batch_flush(&blend_batch);
+}
+
+// ====== PUBLIC ======
+
+void world_recorder_init() {
+    i_rec.shadow          = mmpa(World *, sizeof(World));
+    i_rec.dirty_blocks    = mmpa(U8 *, WORLD_RECORDER_BLOCK_COUNT);
+    i_rec.dirty_block_ids = mmpa(U32 *, WORLD_RECORDER_BLOCK_COUNT * sizeof(U32));
+    i_rec.ring            = mmpa(U8 *, WORLD_RECORDER_RING_SIZE);
+    i_rec.frames          = mcpa(WorldRecorderFrame *, WORLD_RECORDER_MAX_FRAMES, sizeof(WorldRecorderFrame));
+
+    mtx_init(&i_rec.mutex, mtx_plain);
+    cnd_init(&i_rec.work_cond);
+    cnd_init(&i_rec.drained_cond);
+
+    if (thrd_create(&i_rec.writer_thread, i_writer_thread, nullptr) != thrd_success) { lle("Could not create world recorder writer thread"); }
+
+    world_recorder_clear();
+}
+
+void world_recorder_quit() {
+    if (i_rec.record_world_state) { world_recorder_toggle_record_state(); }
+
+    i_close_file();
+
+    mtx_lock(&i_rec.mutex);
+    i_rec.stop_writer = true;
+    cnd_signal(&i_rec.work_cond);
+    mtx_unlock(&i_rec.mutex);
+    thrd_join(i_rec.writer_thread, nullptr);
+}
+
+void world_recorder_draw_2d_hud() {
+    Vector2 const res    = render_get_render_resolution();
+    Vector2 const center = {res.x / 2.0F, res.y / 4.0F};
+
+    if (i_rec.record_world_state) {
+        F32 const radius = ui_scale_x(0.5F);
+        d2d_circle(center, radius, Fade(RED, 0.75F));
+    } else if (i_rec.keep_looping) {
+        F32 const size = ui_scale_x(1.0F);
+        Vector2 const p1 = {center.x - (size / 3.0F), center.y - (size / 2.0F)};  // Top point
+        Vector2 const p2 = {center.x - (size / 3.0F), center.y + (size / 2.0F)};  // Bottom point
+        Vector2 const p3 = {center.x + (2.0F * size / 3.0F), center.y};           // Right point
+        d2d_triangle(p1, p2, p3, Fade(GREEN, 0.75F));
+    }
+}
+
+void world_recorder_update() {
+    if (i_rec.record_world_state) {
+        i_record_frame();
+        return;
+    }
+
+    // Return if nothing recorded yet.
+    if (i_rec.record_world_state_cursor == 0) {
+        i_rec.world_state_go_back    = false;
+        i_rec.world_state_go_forward = false;
+        return;
+    }
+
+    SZ const last_frame = i_rec.record_world_state_cursor - 1;
+
+    if (i_rec.world_state_go_back) {
+        i_rec.world_state_go_back = false;
+        if (i_rec.world_state_cursor > 0) { i_rec.world_state_cursor--; }
+    }
+
+    if (i_rec.world_state_go_forward) {
+        i_rec.world_state_go_forward = false;
+        if (i_rec.world_state_cursor < last_frame) { i_rec.world_state_cursor++; }
+    }
+
+    if (i_rec.keep_looping) { i_rec.world_state_cursor = i_rec.world_state_cursor >= last_frame ? 0 : i_rec.world_state_cursor + 1; }
+
+    // Also picks up the cursor being dragged in the debug window
+    if (i_rec.world_state_cursor > last_frame) { i_rec.world_state_cursor = last_frame; }
+    if (i_rec.world_state_cursor != i_rec.shadow_frame) { world_recorder_seek(i_rec.world_state_cursor); }
+}
+
+void world_recorder_toggle_record_state() {
+    i_rec.record_world_state = !i_rec.record_world_state;
+
+    if (i_rec.keep_looping) { i_rec.keep_looping = false; }
+
+    if (i_rec.record_world_state) {
+        // The world might not match the shadow anymore (played back, switched worlds, ...) so we start with a keyframe
+        i_rec.force_keyframe = true;
+        mi(TS("Recording starting from frame: %zu", i_rec.record_world_state_cursor)->c, RED);
+    } else {
+        // Playback continues from the frame we just recorded
+        if (i_rec.record_world_state_cursor > 0) { i_rec.world_state_cursor = i_rec.record_world_state_cursor - 1; }
+        i_write_index();
+        mi(TS("Recorded %zu frames", i_rec.record_world_state_cursor)->c, GREEN);
+    }
+}
+
+void world_recorder_toggle_loop_state() {
+    // Abort if nothing has been recorded yet.
+    if (i_rec.record_world_state_cursor == 0) {
+        mi("Nothing to loop", RED);
+        return;
+    }
+
+    if (i_rec.record_world_state) { world_recorder_toggle_record_state(); }
+    i_rec.keep_looping = !i_rec.keep_looping;
+
+    mi(TS("Looping: %s", i_rec.keep_looping ? "ON" : "OFF")->c, i_rec.keep_looping ? GREEN : RED);
+}
+
+void world_recorder_backward_state() {
+    if (i_rec.record_world_state) { world_recorder_toggle_record_state(); }
+
+    i_rec.world_state_go_back = true;
+
+    F32 const message_every_n_msec = WORLD_RECORDER_MESSAGE_EVERY_N_MSEC;
+    F32 static time_passed         = message_every_n_msec;
+
+    time_passed += time_get();
+    if (time_passed > message_every_n_msec) {
+        mi(TS("<< Frame: %zu", i_rec.world_state_cursor)->c, YELLOW);
+        time_passed = 0.0F;
+    }
+}
+
+void world_recorder_forward_state() {
+    if (i_rec.record_world_state) { world_recorder_toggle_record_state(); }
+
+    i_rec.world_state_go_forward = true;
+
+    F32 const message_every_n_msec = WORLD_RECORDER_MESSAGE_EVERY_N_MSEC;
+    F32 static time_passed         = message_every_n_msec;
+
+    time_passed += time_get();
+    if (time_passed > message_every_n_msec) {
+        mi(TS(">> Frame: %zu", i_rec.world_state_cursor)->c, YELLOW);
+        time_passed = 0.0F;
+    }
+}
+
+void world_recorder_clear() {
+    // The next recording truncates the file
+    i_close_file();
+
+    i_rec.record_world_state        = false;
+    i_rec.record_world_state_cursor = 0;
+
+    i_rec.world_state_go_back    = false;
+    i_rec.world_state_go_forward = false;
+    i_rec.world_state_cursor     = 0;
+
+    i_rec.keep_looping = false;
+
+    i_rec.shadow_frame          = WORLD_RECORDER_FRAME_NONE;
+    i_rec.force_keyframe        = true;
+    i_rec.frames_since_keyframe = 0;
+    i_rec.written_frame_count.store(0, std::memory_order_relaxed);
+    i_rec.total_compressed_size.store(0, std::memory_order_relaxed);
+    i_rec.last_raw_size     = 0;
+    i_rec.total_record_time = 0.0;
+    i_rec.timed_frame_count = 0;
+    ou_memset(i_rec.frames, 0, sizeof(WorldRecorderFrame) * WORLD_RECORDER_MAX_FRAMES);
+}
+
+void world_recorder_delete_recorded_state() {
+    // Before we do anything, we make sure that the WORLD_RECORDER_FOLDER exists.
+    // If it does not, we can safely return and do nothing.
+    if (!DirectoryExists(WORLD_RECORDER_FOLDER "/")) {
+        llw("World state folder does not exist: %s, nothing to delete", WORLD_RECORDER_FOLDER);
+        return;
+    }
+
+    // Closes the recording file so that it can be deleted as well
+    world_recorder_clear();
+
+    FilePathList const list = LoadDirectoryFiles(WORLD_RECORDER_FOLDER);
+
+    if (list.count == 0) {
+        mi("No world state files to delete", RED);
+        UnloadDirectoryFiles(list);
+        return;
+    }
+
+    SZ deleted_files = 0;
+    for (SZ i = 0; i < list.count; ++i) {
+        C8 const *file_path = list.paths[i];
+        llt("Deleting world state file: %s", file_path);
+        S32 const result = remove(file_path);
+        if (result != 0) {
+            lle("Failed to delete world state file: %s", file_path);
+            continue;
+        }
+        deleted_files++;
+    }
+
+    mi(TS("Deleted %zu world state files", deleted_files)->c, RED);
+
+    UnloadDirectoryFiles(list);
+}
+
+BOOL world_recorder_is_recording_state() {
+    return i_rec.record_world_state;
+}
+
+BOOL world_recorder_is_looping_state() {
+    return i_rec.keep_looping;
+}
+
+SZ world_recorder_get_record_cursor() {
+    return i_rec.record_world_state_cursor;
+}
+
+SZ world_recorder_get_playback_cursor() {
+    return i_rec.world_state_cursor;
+}
+
+SZ *world_recorder_get_playback_cursor_ptr() {
+    return &i_rec.world_state_cursor;
+}
+
+SZ world_recorder_get_last_frame_raw_bytes() {
+    return i_rec.last_raw_size;
+}
+
+SZ world_recorder_get_bytes_per_frame() {
+    SZ const frame_count = i_rec.written_frame_count.load(std::memory_order_relaxed);
+    return frame_count > 0 ? i_rec.total_compressed_size.load(std::memory_order_relaxed) / frame_count : 0;
+}
+
+F64 world_recorder_get_time_per_frame() {
+    return i_rec.timed_frame_count > 0 ? i_rec.total_record_time / (F64)i_rec.timed_frame_count : 0.0;
+}
+
+SZ world_recorder_get_pending_bytes() {
+    return i_rec.ring_head.load(std::memory_order_relaxed) - i_rec.ring_tail.load(std::memory_order_relaxed);
+}
+
+SZ world_recorder_get_total_recorded_size_bytes() {
+    return i_rec.total_compressed_size.load(std::memory_order_relaxed);
+}
+
+SZ world_recorder_get_actual_disk_usage_bytes() {
+    if (!DirectoryExists(WORLD_RECORDER_FOLDER "/")) { return 0; }
+
+    struct stat st;
+    if (stat(WORLD_RECORDER_FILE_PATH, &st) != 0) { return 0; }
+
+    return (SZ)st.st_size;
+}